@@ -0,0 +1,128 @@
+#!/bin/bash
+
+# compiles every file in the corpus a number of times with -T, takes the median of each measurement over the runs, and
+# compares the medians against a baseline. times only count as a regression when they're both over the threshold and
+# more than a millisecond worse, so phases too quick to time reliably don't set it off.
+#
+# usage: ./bench.sh [-n runs] [-p threshold percent] [-b baseline file] [-w] corpus/*.c
+# with -w the medians are written to the baseline instead of compared against it.
+
+declare -i runs=3
+declare -i threshold=10
+baseline=baseline.txt
+write=0
+
+while getopts "n:p:b:w" opt
+do
+    case $opt in
+        n) runs=$OPTARG ;;
+        p) threshold=$OPTARG ;;
+        b) baseline=$OPTARG ;;
+        w) write=1 ;;
+        *) exit 2 ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+mkdir -p out
+results=out/results.txt
+> $results
+declare -i failed=0
+
+printf "*** BENCHMARK RESULTS (median of %d) ***\n" $runs
+
+for filepath in "$@"
+do
+    filename=$(basename $filepath)
+    base=${filename%.*}
+    reportfile=out/$base.json
+    > $reportfile
+
+    for ((i = 0; i < runs; ++i))
+    do
+        if ! ../ecc -S -T $reportfile -o out/$base.s $filepath &> out/$base.txt; then
+            printf " - %s: FAIL, compilation error:\n%s\n" $filename "$(cat out/$base.txt)"
+            failed=1
+            continue 2
+        fi
+    done
+
+    # one "file metric value" line for each measurement: every phase's wall time, then the totals
+    awk -v file=$filename '
+        function field(obj, name,    m) {
+            if (!match(obj, "\"" name "\":[0-9.]+")) return 0
+            m = substr(obj, RSTART, RLENGTH)
+            sub(/.*:/, "", m)
+            return m
+        }
+        function median(key,    n, i, j, t, v) {
+            n = count[key]
+            for (i = 0; i < n; ++i) v[i] = values[key, i]
+            for (i = 1; i < n; ++i)
+                for (j = i; j > 0 && v[j - 1] > v[j]; --j) { t = v[j]; v[j] = v[j - 1]; v[j - 1] = t }
+            return n % 2 ? v[int(n / 2)] : (v[n / 2 - 1] + v[n / 2]) / 2
+        }
+        function add(key, value) {
+            if (!(key in count)) order[keys++] = key
+            values[key, count[key]++] = value
+        }
+        {
+            phases = $0
+            sub(/.*"phases":\[/, "", phases)
+            sub(/\].*/, "", phases)
+            n = split(phases, list, "},")
+            for (i = 1; i <= n; ++i)
+            {
+                name = list[i]
+                sub(/.*"name":"/, "", name)
+                sub(/".*/, "", name)
+                add(name "_ms", field(list[i], "wall_ms"))
+            }
+            total = $0
+            sub(/.*"total":/, "", total)
+            add("wall_ms", field(total, "wall_ms"))
+            add("cpu_ms", field(total, "cpu_ms"))
+            add("heap_bytes", field(total, "heap_bytes"))
+            add("peak_rss_kb", field($0, "peak_rss_kb"))
+        }
+        END {
+            for (i = 0; i < keys; ++i)
+                printf "%s %s %s\n", file, order[i], median(order[i])
+        }' $reportfile >> $results
+
+    grep "^$filename " $results | awk '{ printf " - %s: %s %s\n", $1, $2, $3 }' | grep -E " (wall_ms|cpu_ms|heap_bytes|peak_rss_kb) "
+done
+
+if [[ $write -eq 1 ]]; then
+    cp $results $baseline
+    printf "wrote %s\n" $baseline
+    exit $failed
+fi
+
+if [[ ! -a $baseline ]]; then
+    printf "no baseline at %s to compare against, make one with -w\n" $baseline
+    exit $failed
+fi
+
+printf "*** COMPARED TO %s (threshold %d%%) ***\n" $baseline $threshold
+
+awk -v threshold=$threshold '
+    NR == FNR { old[$1, $2] = $3; next }
+    !(($1, $2) in old) { next }
+    {
+        before = old[$1, $2]
+        change = before > 0 ? ($3 - before) * 100 / before : 0
+        slower = change > threshold
+        if ($2 ~ /_ms$/ && $3 - before <= 1)
+            slower = 0
+        if (slower)
+        {
+            printf " - %s: %s regressed %.1f%% (%s -> %s)\n", $1, $2, change, before, $3
+            regressed = 1
+        }
+        else if ($2 !~ /_ms$/ || $2 == "wall_ms" || $2 == "cpu_ms")
+            printf " - %s: %s %+.1f%%\n", $1, $2, change
+    }
+    END { exit regressed }' $baseline $results || failed=1
+
+exit $failed
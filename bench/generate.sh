@@ -0,0 +1,106 @@
+#!/bin/bash
+
+# writes the benchmark corpus into the directory given: large synthetic translation units, each stressing a different
+# part of the compiler. sizes scale with the second argument (a percentage, 100 by default) for quicker runs.
+
+dir=${1:-corpus}
+declare -i scale=${2:-100}
+
+mkdir -p $dir/include
+
+# many small functions, sharing parameter and local names like real code does
+awk -v n=$((10000 * scale / 100)) 'BEGIN {
+    for (i = 0; i < n; ++i)
+    {
+        printf "int f%d(int a, int b)\n{\n", i
+        printf "    int t = a * %d + b;\n", i % 7 + 1
+        printf "    if (t > %d)\n        t -= b;\n", i
+        printf "    for (int j = 0; j < %d; ++j)\n        t += j & a;\n", i % 5 + 1
+        printf "    return t ^ %d;\n}\n\n", i
+    }
+}' > $dir/functions.c
+
+# long chains of object-like macros, each expanding the one before it, and function-like macros nested deep in each
+# other's arguments. the replacement lists leave out the parentheses they'd usually have, since the parser backtracks
+# once per level of nested parentheses and that would be all this ended up measuring.
+awk -v depth=$((256 * scale / 100 + 1)) -v uses=$((200 * scale / 100 + 1)) 'BEGIN {
+    printf "#define C0 0\n"
+    for (i = 1; i < depth; ++i)
+        printf "#define C%d C%d + %d\n", i, i - 1, i
+    printf "#define F(x) x + C1\n#define G(x, y) x * y - C2\n\n"
+    for (i = 0; i < uses; ++i)
+    {
+        printf "int m%d(int v)\n{\n    return C%d - ", i, i % depth
+        for (j = 0; j < depth; ++j)
+            printf j % 2 ? "G(%d, " : "F(", j
+        printf "v"
+        for (j = 0; j < depth; ++j)
+            printf ")"
+        printf ";\n}\n\n"
+    }
+}' > $dir/macros.c
+
+# a few functions that are each one long switch statement
+awk -v functions=$((8 * scale / 100 + 1)) -v cases=$((2000 * scale / 100)) 'BEGIN {
+    for (f = 0; f < functions; ++f)
+    {
+        printf "int s%d(int x)\n{\n    int r = 0;\n    switch (x)\n    {\n", f
+        for (i = 0; i < cases; ++i)
+        {
+            if (i % 3 == 0)
+                printf "        case %d: r = x * %d; break;\n", i * (f + 1), i
+            else
+                printf "        case %d: r += %d;\n", i * (f + 1), i
+        }
+        printf "        default: r = -1;\n    }\n    return r;\n}\n\n"
+    }
+}' > $dir/switch.c
+
+# big initializer lists, flat and nested, scalar and aggregate
+awk -v n=$((65536 * scale / 100 + 1)) -v m=$((8192 * scale / 100 + 1)) 'BEGIN {
+    printf "struct entry\n{\n    int key;\n    const char* name;\n    double weight;\n    short pair[2];\n};\n\n"
+    printf "const int table[%d] = {\n", n
+    for (i = 0; i < n; ++i)
+        printf "    %d,%s", (i * 2654435761) % 1000003, i % 8 == 7 ? "\n" : ""
+    printf "\n};\n\n"
+    printf "struct entry entries[%d] = {\n", m
+    for (i = 0; i < m; ++i)
+        printf "    { %d, \"entry%d\", %d.5, { %d, %d } },\n", i, i, i % 100, i % 13, i % 17
+    printf "};\n\n"
+    printf "int grid[%d][4] = {\n", m
+    for (i = 0; i < m; ++i)
+        printf "    [%d] = { %d, [2] = %d },\n", i, i, -i
+    printf "};\n\n"
+    printf "int lookup(int i)\n{\n    return table[i] + entries[i].key + grid[i][2];\n}\n"
+}' > $dir/initializers.c
+
+# a file that's mostly what it includes, with every header pulling in a shared one again behind its guard
+declare -i headers=$((100 * scale / 100 + 1))
+awk 'BEGIN {
+    printf "#ifndef COMMON_H\n#define COMMON_H\n\ntypedef unsigned long size_type;\n"
+    for (i = 0; i < 200; ++i)
+        printf "#define COMMON_%d (%d * sizeof(size_type))\n", i, i
+    printf "\n#endif\n"
+}' > $dir/include/common.h
+> $dir/headers.c
+for ((h = 0; h < headers; ++h))
+do
+    awk -v h=$h 'BEGIN {
+        printf "#ifndef H%d_H\n#define H%d_H\n\n#include \"common.h\"\n\n", h, h
+        for (i = 0; i < 50; ++i)
+            printf "#define H%d_M%d(a, b) ((a) * %d + (b) - COMMON_%d)\n", h, i, i, i
+        printf "\n"
+        for (i = 0; i < 20; ++i)
+            printf "typedef struct h%d_s%d\n{\n    int x;\n    long y;\n    size_type z[%d];\n} h%d_s%d_t;\n\n", h, i, i + 1, h, i
+        for (i = 0; i < 50; ++i)
+            printf "int h%d_f%d(h%d_s%d_t* s, int n);\n", h, i, h, i % 20
+        printf "\n#endif\n"
+    }' > $dir/include/h$h.h
+    printf "#include \"include/h%d.h\"\n#include \"include/h%d.h\"\n" $h $h >> $dir/headers.c
+done
+printf "\nint headers(void)\n{\n    int r = 0;\n" >> $dir/headers.c
+for ((h = 0; h < headers; ++h))
+do
+    printf "    r += H%d_M%d(r, %d);\n" $h $((h % 50)) $h >> $dir/headers.c
+done
+printf "    return r;\n}\n" >> $dir/headers.c
@@ -0,0 +1,9 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// does the kernel's work once and returns something that depends on all of it, so that none of it can be left out
+unsigned long kernel(void);
+
+unsigned long bench_cycles(void);
+
+#endif
@@ -0,0 +1,11 @@
+    # the time stamp counter, fenced so that nothing before it is still running when it's read and nothing after it
+    # has started
+    .text
+    .globl bench_cycles
+bench_cycles:
+    lfence
+    rdtsc
+    lfence
+    shlq $32, %rdx
+    orq %rdx, %rax
+    ret
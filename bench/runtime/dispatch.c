@@ -0,0 +1,62 @@
+#include "bench.h"
+
+// a bytecode interpreter: one switch in a loop, dispatching on every instruction
+
+enum
+{
+    OP_PUSH,
+    OP_LOAD,
+    OP_STORE,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_AND,
+    OP_XOR,
+    OP_SHR,
+    OP_DUP,
+    OP_JNZ,
+    OP_HALT
+};
+
+// computes a hash of the counter in register 1 while counting register 0 down to zero
+static const int program[] = {
+    OP_PUSH, 100000, OP_STORE, 0,
+    OP_PUSH, 7, OP_STORE, 1,
+    // loop:
+    OP_LOAD, 1, OP_PUSH, 31, OP_MUL, OP_LOAD, 0, OP_XOR, OP_PUSH, 0xFFFFFF, OP_AND, OP_STORE, 1,
+    OP_LOAD, 1, OP_PUSH, 3, OP_SHR, OP_LOAD, 1, OP_ADD, OP_STORE, 1,
+    OP_LOAD, 0, OP_PUSH, 1, OP_SUB, OP_DUP, OP_STORE, 0,
+    OP_JNZ, 8,
+    OP_HALT
+};
+
+unsigned long kernel(void)
+{
+    long stack[16];
+    long registers[4] = {0};
+    int sp = 0;
+    int pc = 0;
+    for (;;)
+    {
+        switch (program[pc++])
+        {
+            case OP_PUSH: stack[sp++] = program[pc++]; break;
+            case OP_LOAD: stack[sp++] = registers[program[pc++]]; break;
+            case OP_STORE: registers[program[pc++]] = stack[--sp]; break;
+            case OP_ADD: --sp; stack[sp - 1] += stack[sp]; break;
+            case OP_SUB: --sp; stack[sp - 1] -= stack[sp]; break;
+            case OP_MUL: --sp; stack[sp - 1] *= stack[sp]; break;
+            case OP_AND: --sp; stack[sp - 1] &= stack[sp]; break;
+            case OP_XOR: --sp; stack[sp - 1] ^= stack[sp]; break;
+            case OP_SHR: --sp; stack[sp - 1] >>= stack[sp]; break;
+            case OP_DUP: stack[sp] = stack[sp - 1]; ++sp; break;
+            case OP_JNZ:
+                if (stack[--sp])
+                    pc = program[pc];
+                else
+                    ++pc;
+                break;
+            case OP_HALT: return registers[1];
+        }
+    }
+}
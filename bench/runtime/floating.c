@@ -0,0 +1,44 @@
+#include "bench.h"
+
+// double precision arithmetic: a mandelbrot set, newton's method square roots, and a numerical integral
+
+static double root(double x)
+{
+    double r = x > 1 ? x / 2 : 1;
+    for (int i = 0; i < 20; ++i)
+        r = (r + x / r) / 2;
+    return r;
+}
+
+unsigned long kernel(void)
+{
+    unsigned long result = 0;
+    for (int py = 0; py < 60; ++py)
+    {
+        for (int px = 0; px < 80; ++px)
+        {
+            double cx = -2.0 + px * 2.5 / 80;
+            double cy = -1.25 + py * 2.5 / 60;
+            double x = 0, y = 0;
+            int i = 0;
+            for (; i < 200 && x * x + y * y <= 4; ++i)
+            {
+                double t = x * x - y * y + cx;
+                y = 2 * x * y + cy;
+                x = t;
+            }
+            result += i;
+        }
+    }
+    double sum = 0;
+    for (int i = 1; i <= 5000; ++i)
+        sum += root(i);
+    double integral = 0;
+    double h = 1.0 / 100000;
+    for (int i = 0; i < 100000; ++i)
+    {
+        double x = (i + 0.5) * h;
+        integral += 4 / (1 + x * x) * h;
+    }
+    return result * 1000003 + (unsigned long) sum + (unsigned long) (integral * 1000000);
+}
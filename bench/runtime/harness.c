@@ -0,0 +1,44 @@
+#include <stdio.h>
+
+#include "bench.h"
+
+/*
+
+runs a kernel a few times and prints the fewest cycles a run took, then what the kernel returned. the fastest run is
+the one least disturbed by whatever else the machine was doing. what it returned has to come out the same whichever
+compiler built it.
+
+*/
+
+#define BENCH_RUNS 5
+
+// libc's printf only knows ints
+static void print_number(unsigned long n)
+{
+    char digits[21];
+    int i = sizeof digits - 1;
+    digits[i] = '\0';
+    do
+        digits[--i] = '0' + n % 10;
+    while (n /= 10);
+    fputs(digits + i, stdout);
+}
+
+int main(void)
+{
+    unsigned long best = 0;
+    unsigned long result = 0;
+    for (int i = 0; i < BENCH_RUNS; ++i)
+    {
+        unsigned long start = bench_cycles();
+        result = kernel();
+        unsigned long cycles = bench_cycles() - start;
+        if (!i || cycles < best)
+            best = cycles;
+    }
+    print_number(best);
+    putchar(' ');
+    print_number(result);
+    putchar('\n');
+    return 0;
+}
@@ -0,0 +1,34 @@
+#include "bench.h"
+
+// a sieve of eratosthenes, then collatz sequences: tight loops of integer arithmetic, compares, and array accesses
+
+#define LIMIT 200000
+
+static char composite[LIMIT];
+
+unsigned long kernel(void)
+{
+    unsigned long result = 0;
+    for (int i = 0; i < LIMIT; ++i)
+        composite[i] = 0;
+    for (int i = 2; i < LIMIT; ++i)
+    {
+        if (composite[i])
+            continue;
+        result += i;
+        for (int j = i * 2; j < LIMIT; j += i)
+            composite[j] = 1;
+    }
+    for (unsigned long start = 1; start < 30000; ++start)
+    {
+        unsigned long n = start;
+        int steps = 0;
+        while (n != 1)
+        {
+            n = n & 1 ? n * 3 + 1 : n / 2;
+            ++steps;
+        }
+        result = result * 31 + steps;
+    }
+    return result;
+}
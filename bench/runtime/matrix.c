@@ -0,0 +1,36 @@
+#include "bench.h"
+
+// square integer matrix multiplication, the naive way: three nested loops over two-dimensional arrays
+
+#define N 96
+
+static int a[N][N];
+static int b[N][N];
+static int c[N][N];
+
+unsigned long kernel(void)
+{
+    for (int i = 0; i < N; ++i)
+    {
+        for (int j = 0; j < N; ++j)
+        {
+            a[i][j] = (i * 7 + j * 3) % 17 - 8;
+            b[i][j] = (i * 5 - j * 11) % 13;
+        }
+    }
+    for (int i = 0; i < N; ++i)
+    {
+        for (int j = 0; j < N; ++j)
+        {
+            int sum = 0;
+            for (int k = 0; k < N; ++k)
+                sum += a[i][k] * b[k][j];
+            c[i][j] = sum;
+        }
+    }
+    unsigned long result = 0;
+    for (int i = 0; i < N; ++i)
+        for (int j = 0; j < N; ++j)
+            result = result * 33 + (unsigned) c[i][j];
+    return result;
+}
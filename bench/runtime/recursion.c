@@ -0,0 +1,58 @@
+#include "bench.h"
+
+// deep and wide recursion: naive fibonacci, ackermann, and a recursive quicksort
+
+#define ELEMENTS 20000
+
+static int values[ELEMENTS];
+
+static int fibonacci(int n)
+{
+    return n < 2 ? n : fibonacci(n - 1) + fibonacci(n - 2);
+}
+
+static int ackermann(int m, int n)
+{
+    if (!m)
+        return n + 1;
+    if (!n)
+        return ackermann(m - 1, 1);
+    return ackermann(m - 1, ackermann(m, n - 1));
+}
+
+static void quicksort(int* a, int low, int high)
+{
+    if (low >= high)
+        return;
+    int pivot = a[(low + high) / 2];
+    int i = low, j = high;
+    while (i <= j)
+    {
+        while (a[i] < pivot) ++i;
+        while (a[j] > pivot) --j;
+        if (i <= j)
+        {
+            int t = a[i];
+            a[i++] = a[j];
+            a[j--] = t;
+        }
+    }
+    quicksort(a, low, j);
+    quicksort(a, i, high);
+}
+
+unsigned long kernel(void)
+{
+    unsigned long result = fibonacci(24);
+    result = result * 31 + ackermann(2, 300);
+    unsigned seed = 1;
+    for (int i = 0; i < ELEMENTS; ++i)
+    {
+        seed = seed * 1664525 + 1013904223;
+        values[i] = seed >> 8;
+    }
+    quicksort(values, 0, ELEMENTS - 1);
+    for (int i = 0; i < ELEMENTS; i += 97)
+        result = result * 31 + values[i];
+    return result;
+}
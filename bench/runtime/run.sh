@@ -0,0 +1,91 @@
+#!/bin/bash
+
+# builds every kernel with ecc against its own libc and prints the fewest cycles a run of it took. with -c, each kernel
+# is built by that compiler as well (with the flags given to -f, -O2 by default) against the system's C library to be
+# shown side by side, and a kernel that computes something different under the two fails.
+#
+# usage: bench/runtime/run.sh [-c compiler] [-f flags] [kernel.c...]
+# kernels are given relative to the top of the repository.
+
+compiler=
+flags=-O2
+
+while getopts "c:f:" opt
+do
+    case $opt in
+        c) compiler=$OPTARG ;;
+        f) flags=$OPTARG ;;
+        *) exit 2 ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+# ecc looks for its headers and libraries relative to where it runs
+cd "$(dirname "$0")/../.."
+dir=bench/runtime
+out=$dir/out
+mkdir -p $out
+
+kernels=("$@")
+if [[ ${#kernels[@]} -eq 0 ]]; then
+    for kernel in integers matrix strings structs recursion dispatch floating
+    do
+        kernels+=($dir/$kernel.c)
+    done
+fi
+
+as -o $out/cycles.o $dir/cycles.s || exit 1
+if ! ./ecc -c -o $out/harness.o $dir/harness.c; then
+    printf "the harness failed to compile\n"
+    exit 1
+fi
+
+declare -i failed=0
+
+if [[ -n $compiler ]]; then
+    printf "*** RUNTIME RESULTS (fewest cycles of 5 runs, ecc vs. %s %s) ***\n" $compiler "$flags"
+else
+    printf "*** RUNTIME RESULTS (fewest cycles of 5 runs) ***\n"
+fi
+
+for filepath in "${kernels[@]}"
+do
+    filename=$(basename $filepath)
+    base=${filename%.*}
+    execfile=$out/$base
+
+    if ! ./ecc -c -o $out/$base.o $filepath &> $out/$base.txt; then
+        printf " - %s: FAIL, compilation error:\n%s\n" $base "$(cat $out/$base.txt)"
+        failed=1
+        continue
+    fi
+    ld -o $execfile $out/$base.o $out/harness.o $out/cycles.o libc/libc.a libecc/libecc.a &> /dev/null
+    output=$($execfile)
+    status=$?
+    read cycles result <<< "$output"
+    if [[ $status -ne 0 || -z $result ]]; then
+        printf " - %s: FAIL, the program didn't finish\n" $base
+        failed=1
+        continue
+    fi
+
+    if [[ -z $compiler ]]; then
+        printf " - %s: %s\n" $base $cycles
+        continue
+    fi
+
+    if ! $compiler $flags -I $dir -o $execfile.ref $filepath $dir/harness.c $dir/cycles.s &> $out/$base.ref.txt; then
+        printf " - %s: %s, %s failed to compile it:\n%s\n" $base $cycles $compiler "$(cat $out/$base.ref.txt)"
+        failed=1
+        continue
+    fi
+    read refcycles refresult <<< "$($execfile.ref)"
+    if [[ $result != $refresult ]]; then
+        printf " - %s: FAIL, computed %s instead of %s\n" $base $result $refresult
+        failed=1
+        continue
+    fi
+    printf " - %s: %s vs. %s (%s)\n" $base $cycles $refcycles "$(awk -v a=$cycles -v b=$refcycles 'BEGIN { printf "%.2fx", a / b }')"
+done
+
+exit $failed
@@ -0,0 +1,61 @@
+#include <string.h>
+
+#include "bench.h"
+
+// building, hashing, searching, reversing, and comparing strings a character at a time and through libc
+
+#define LINES 2000
+#define WIDTH 48
+
+static char text[LINES][WIDTH];
+
+static void build(char* line, unsigned seed)
+{
+    int length = 8 + seed % (WIDTH - 9);
+    for (int i = 0; i < length; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        line[i] = 'a' + (seed >> 16 & 0x7FFF) % 26;
+    }
+    line[length] = '\0';
+}
+
+static unsigned long hash(const char* s)
+{
+    unsigned long h = 14695981039346656037UL;
+    for (; *s; ++s)
+        h = (h ^ (unsigned char) *s) * 1099511628211UL;
+    return h;
+}
+
+static void reverse(char* s)
+{
+    char* end = s + strlen(s) - 1;
+    for (; s < end; ++s, --end)
+    {
+        char c = *s;
+        *s = *end;
+        *end = c;
+    }
+}
+
+unsigned long kernel(void)
+{
+    unsigned long result = 0;
+    for (int i = 0; i < LINES; ++i)
+        build(text[i], i);
+    for (int round = 0; round < 10; ++round)
+    {
+        for (int i = 0; i < LINES; ++i)
+        {
+            reverse(text[i]);
+            result += hash(text[i]);
+            char* e = strchr(text[i], 'e');
+            if (e)
+                result += e - text[i];
+            if (i && strcmp(text[i - 1], text[i]) < 0)
+                ++result;
+        }
+    }
+    return result;
+}
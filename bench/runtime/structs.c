@@ -0,0 +1,67 @@
+#include "bench.h"
+
+// a particle simulation in fixed point: arrays of structs, members read and written through pointers, and small
+// structs copied whole
+
+#define PARTICLES 1000
+
+typedef struct vector
+{
+    int x;
+    int y;
+} vector_t;
+
+typedef struct particle
+{
+    vector_t position;
+    vector_t velocity;
+    short mass;
+    char bounces;
+} particle_t;
+
+static particle_t particles[PARTICLES];
+
+static void add(vector_t* a, const vector_t* b)
+{
+    a->x += b->x;
+    a->y += b->y;
+}
+
+static void step(particle_t* p)
+{
+    vector_t last = p->position;
+    p->velocity.y -= p->mass;
+    add(&p->position, &p->velocity);
+    if (p->position.y < 0)
+    {
+        p->position.y = -p->position.y;
+        p->velocity.y = -p->velocity.y / 2;
+        ++p->bounces;
+    }
+    if (p->position.x < 0 || p->position.x > 100000)
+    {
+        p->position = last;
+        p->velocity.x = -p->velocity.x;
+    }
+}
+
+unsigned long kernel(void)
+{
+    for (int i = 0; i < PARTICLES; ++i)
+    {
+        particle_t* p = &particles[i];
+        p->position.x = i * 97 % 100000;
+        p->position.y = 1000 + i % 5000;
+        p->velocity.x = i % 21 - 10;
+        p->velocity.y = 0;
+        p->mass = 1 + i % 3;
+        p->bounces = 0;
+    }
+    for (int t = 0; t < 400; ++t)
+        for (int i = 0; i < PARTICLES; ++i)
+            step(&particles[i]);
+    unsigned long result = 0;
+    for (int i = 0; i < PARTICLES; ++i)
+        result = result * 31 + particles[i].position.x + particles[i].position.y * 7 + particles[i].bounces;
+    return result;
+}
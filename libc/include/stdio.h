@@ -2,22 +2,50 @@
 #define _STDIO_H
 
 #include "stdint.h"
+#include "stdlib.h"
 
 #define FOPEN_MAX 16
 #define EOF (-1)
+#define BUFSIZ 4096
+
+#define _IOFBF 1
+#define _IOLBF 2
+#define _IONBF 3
 
 typedef struct __ecc_file
 {
     int __fd;
     uint8_t __loc;
+    uint8_t __mode; // _IOFBF, _IOLBF, or _IONBF, chosen on first use
+    uint8_t __flags;
+    size_t __pos; // the next byte to read, or how many are waiting to be written
+    size_t __len; // how many bytes were read into the buffer
 } FILE;
 
+extern FILE __ecc_standard_files[3];
+
+#define stdin (__ecc_standard_files)
+#define stdout (__ecc_standard_files + 1)
+#define stderr (__ecc_standard_files + 2)
+
 FILE* fopen(const char* filename, const char* mode);
 
 int fclose(FILE* stream);
 
+int fflush(FILE* stream);
+
 int fgetc(FILE* stream);
 
+int getchar(void);
+
+int fputc(int c, FILE* stream);
+
+int fputs(const char* str, FILE* stream);
+
+size_t fread(void* ptr, size_t size, size_t nmemb, FILE* stream);
+
+size_t fwrite(const void* ptr, size_t size, size_t nmemb, FILE* stream);
+
 int putchar(int c);
 
 int puts(const char* str);
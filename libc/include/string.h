@@ -3,6 +3,20 @@
 
 #include "stdlib.h"
 
+void* memcpy(void* restrict s1, const void* restrict s2, size_t n);
+
+void* memmove(void* s1, const void* s2, size_t n);
+
+int memcmp(const void* s1, const void* s2, size_t n);
+
+void* memchr(const void* s, int c, size_t n);
+
+void* memset(void* s, int c, size_t n);
+
+int strcmp(const char* s1, const char* s2);
+
+char* strchr(const char* s, int c);
+
 size_t strlen(const char* str);
 
 #endif
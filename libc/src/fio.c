@@ -3,8 +3,28 @@
 #include "../include/string.h"
 #include "../include/stdlib.h"
 
+#define TCGETS 0x5401
+
+#define F_EOF 1
+#define F_ERROR 2
+#define F_OPEN 4
+
+// crt0 calls this after main returns, once something has been buffered
+extern void (*__ecc_exit_hook)(void);
+
+FILE __ecc_standard_files[3] = {
+    { 0, FOPEN_MAX },
+    { 1, FOPEN_MAX + 1 },
+    { 2, FOPEN_MAX + 2 }
+};
+
 static FILE files[FOPEN_MAX];
 
+// one BUFSIZ buffer per stream: (FOPEN_MAX + 3) * BUFSIZ
+static unsigned char buffers[77824];
+
+#define BUFFER(stream) (buffers + (stream)->__loc * BUFSIZ)
+
 static uint8_t istack[] = {
     15, 14, 13, 12, 11, 10, 9, 8,
     7, 6, 5, 4, 3, 2, 1, 0
@@ -12,6 +32,60 @@ static uint8_t istack[] = {
 
 static size_t istackloc = 16;
 
+static int flush_writes(FILE* stream)
+{
+    unsigned char* buffer = BUFFER(stream);
+    size_t done = 0;
+    while (done < stream->__pos)
+    {
+        long written = __ecc_lsys_write(stream->__fd, (const char*) (buffer + done), stream->__pos - done);
+        if (written <= 0)
+        {
+            stream->__flags |= F_ERROR;
+            stream->__pos = 0;
+            return EOF;
+        }
+        done += written;
+    }
+    stream->__pos = 0;
+    return 0;
+}
+
+static void flush_all(void)
+{
+    fflush(NULL);
+}
+
+// terminals get a line at a time and stderr gets everything right away, like everyone expects
+static void choose_buffering(FILE* stream)
+{
+    char termios[64];
+    if (stream == stderr)
+        stream->__mode = _IONBF;
+    else if (__ecc_lsys_ioctl(stream->__fd, TCGETS, termios) == 0)
+        stream->__mode = _IOLBF;
+    else
+        stream->__mode = _IOFBF;
+    __ecc_exit_hook = flush_all;
+}
+
+static int refill(FILE* stream)
+{
+    // a prompt should show up before waiting on its answer
+    if (stream->__mode == _IOLBF)
+        fflush(stdout);
+    long count = __ecc_lsys_read(stream->__fd, (char*) BUFFER(stream), BUFSIZ);
+    stream->__pos = 0;
+    if (count <= 0)
+    {
+        stream->__len = 0;
+        stream->__flags |= count ? F_ERROR : F_EOF;
+        return EOF;
+    }
+    stream->__len = count;
+    return 0;
+}
+
 FILE* fopen(const char* filename, const char* mode)
 {
     if (istackloc == 0)
@@ -32,10 +106,14 @@ FILE* fopen(const char* filename, const char* mode)
         return NULL;
 
     uint8_t i = istack[--istackloc];
-    
+
     FILE* file = files + i;
     file->__fd = fd;
     file->__loc = i;
+    file->__mode = 0;
+    file->__flags = F_OPEN;
+    file->__pos = 0;
+    file->__len = 0;
 
     return file;
 }
@@ -44,16 +122,158 @@ int fclose(FILE* stream)
 {
     if (!stream)
         return EOF;
+    int flushed = fflush(stream);
+    stream->__flags = 0;
     istack[istackloc++] = stream->__loc;
-    return __ecc_lsys_close(stream->__fd);
+    if (__ecc_lsys_close(stream->__fd) || flushed)
+        return EOF;
+    return 0;
+}
+
+int fflush(FILE* stream)
+{
+    if (stream)
+    {
+        // only written bytes are waiting, anything read ahead stays for the next read
+        if (stream->__len)
+            return 0;
+        return flush_writes(stream);
+    }
+    int result = 0;
+    for (int i = 0; i < 3; ++i)
+    {
+        if (fflush(__ecc_standard_files + i))
+            result = EOF;
+    }
+    for (int i = 0; i < FOPEN_MAX; ++i)
+    {
+        if ((files[i].__flags & F_OPEN) && fflush(files + i))
+            result = EOF;
+    }
+    return result;
 }
 
 int fgetc(FILE* stream)
 {
     if (!stream)
         return EOF;
-    char c;
-    if (__ecc_lsys_read(stream->__fd, &c, 1) == 0)
+    if (!stream->__mode)
+        choose_buffering(stream);
+    if (stream->__pos == stream->__len && refill(stream))
+        return EOF;
+    return BUFFER(stream)[stream->__pos++];
+}
+
+int getchar(void)
+{
+    return fgetc(stdin);
+}
+
+size_t fread(void* ptr, size_t size, size_t nmemb, FILE* stream)
+{
+    size_t total = size * nmemb;
+    if (!stream || !total)
+        return 0;
+    if (!stream->__mode)
+        choose_buffering(stream);
+    unsigned char* bytes = ptr;
+    unsigned char* buffer = BUFFER(stream);
+    size_t done = 0;
+    while (done < total)
+    {
+        if (stream->__pos == stream->__len)
+        {
+            // big reads go straight to the caller instead of through the buffer
+            if (total - done >= BUFSIZ)
+            {
+                long count = __ecc_lsys_read(stream->__fd, (char*) (bytes + done), total - done);
+                if (count <= 0)
+                {
+                    stream->__flags |= count ? F_ERROR : F_EOF;
+                    break;
+                }
+                done += count;
+                continue;
+            }
+            if (refill(stream))
+                break;
+        }
+        for (; done < total && stream->__pos < stream->__len; ++done)
+            bytes[done] = buffer[stream->__pos++];
+    }
+    return done / size;
+}
+
+int fputc(int c, FILE* stream)
+{
+    if (!stream)
+        return EOF;
+    if (!stream->__mode)
+        choose_buffering(stream);
+    BUFFER(stream)[stream->__pos++] = (unsigned char) c;
+    if (stream->__pos == BUFSIZ || stream->__mode == _IONBF || (stream->__mode == _IOLBF && c == '\n'))
+    {
+        if (flush_writes(stream))
+            return EOF;
+    }
+    return (unsigned char) c;
+}
+
+size_t fwrite(const void* ptr, size_t size, size_t nmemb, FILE* stream)
+{
+    size_t total = size * nmemb;
+    if (!stream || !total)
+        return 0;
+    if (!stream->__mode)
+        choose_buffering(stream);
+    const unsigned char* bytes = ptr;
+    unsigned char* buffer = BUFFER(stream);
+    size_t done = 0;
+    int newline = 0;
+    while (done < total)
+    {
+        // big writes go straight out once what's already waiting is
+        if (!stream->__pos && total - done >= BUFSIZ)
+        {
+            long written = __ecc_lsys_write(stream->__fd, (const char*) (bytes + done), total - done);
+            if (written <= 0)
+            {
+                stream->__flags |= F_ERROR;
+                return done / size;
+            }
+            done += written;
+            continue;
+        }
+        for (; done < total && stream->__pos < BUFSIZ; ++done)
+        {
+            unsigned char c = bytes[done];
+            buffer[stream->__pos++] = c;
+            newline = newline || c == '\n';
+        }
+        if (stream->__pos == BUFSIZ && flush_writes(stream))
+            return done / size;
+    }
+    if (stream->__mode == _IONBF || (stream->__mode == _IOLBF && newline))
+        flush_writes(stream);
+    return done / size;
+}
+
+int fputs(const char* str, FILE* stream)
+{
+    size_t len = strlen(str);
+    if (fwrite(str, 1, len, stream) != len)
+        return EOF;
+    return 0;
+}
+
+int putchar(int c)
+{
+    return fputc(c, stdout);
+}
+
+int puts(const char* str)
+{
+    if (fputs(str, stdout) == EOF)
         return EOF;
-    return (int) (unsigned char) c;
+    return fputc('\n', stdout) == EOF ? EOF : 0;
 }
@@ -0,0 +1,50 @@
+    # aligned blocks like strlen, counting down how many of the n bytes are left past each one
+    .text
+    .globl memchr
+memchr:
+    testq %rdx, %rdx
+    jz .L4
+    movd %esi, %xmm1
+    punpcklbw %xmm1, %xmm1
+    punpcklwd %xmm1, %xmm1
+    pshufd $0, %xmm1, %xmm1
+    movq %rdi, %rax
+    andq $-16, %rax
+    movl %edi, %ecx
+    andl $15, %ecx
+    movdqa (%rax), %xmm2
+    pcmpeqb %xmm1, %xmm2
+    pmovmskb %xmm2, %r8d
+    shrl %cl, %r8d
+    testl %r8d, %r8d
+    jz .L1
+    bsfl %r8d, %r8d
+    cmpq %rdx, %r8
+    jae .L4
+    leaq (%rdi, %r8), %rax
+    ret
+.L1:
+    movl $16, %r9d
+    subl %ecx, %r9d
+    cmpq %r9, %rdx
+    jbe .L4
+    subq %r9, %rdx
+.L2:
+    addq $16, %rax
+    movdqa (%rax), %xmm2
+    pcmpeqb %xmm1, %xmm2
+    pmovmskb %xmm2, %r8d
+    testl %r8d, %r8d
+    jnz .L3
+    subq $16, %rdx
+    ja .L2
+    jmp .L4
+.L3:
+    bsfl %r8d, %r8d
+    cmpq %rdx, %r8
+    jae .L4
+    addq %r8, %rax
+    ret
+.L4:
+    xorl %eax, %eax
+    ret
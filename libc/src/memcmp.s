@@ -0,0 +1,42 @@
+    .text
+    .globl memcmp
+memcmp:
+    cmpq $16, %rdx
+    jb .L2
+.L1:
+    movdqu (%rdi), %xmm0
+    movdqu (%rsi), %xmm1
+    pcmpeqb %xmm1, %xmm0
+    pmovmskb %xmm0, %eax
+    cmpl $0xFFFF, %eax
+    jne .L4
+    addq $16, %rdi
+    addq $16, %rsi
+    subq $16, %rdx
+    cmpq $16, %rdx
+    jae .L1
+.L2:
+    testq %rdx, %rdx
+    jz .L5
+.L3:
+    movzbl (%rdi), %eax
+    movzbl (%rsi), %ecx
+    subl %ecx, %eax
+    jnz .L6
+    incq %rdi
+    incq %rsi
+    decq %rdx
+    jnz .L3
+    ret
+.L4:
+    notl %eax
+    bsfl %eax, %eax
+    movzbl (%rdi, %rax), %edx
+    movzbl (%rsi, %rax), %ecx
+    movl %edx, %eax
+    subl %ecx, %eax
+    ret
+.L5:
+    xorl %eax, %eax
+.L6:
+    ret
@@ -0,0 +1,27 @@
+    # the last 16 bytes are loaded up front and stored at the end, covering whatever the loop leaves over
+    .text
+    .globl memcpy
+memcpy:
+    movq %rdi, %rax
+    cmpq $16, %rdx
+    jb .L2
+    movdqu -16(%rsi, %rdx), %xmm1
+    leaq -16(%rdi, %rdx), %rcx
+.L1:
+    movdqu (%rsi), %xmm0
+    movdqu %xmm0, (%rdi)
+    addq $16, %rsi
+    addq $16, %rdi
+    cmpq %rcx, %rdi
+    jb .L1
+    movdqu %xmm1, (%rcx)
+    ret
+.L2:
+    testq %rdx, %rdx
+    jz .L3
+    movb -1(%rsi, %rdx), %cl
+    movb %cl, -1(%rdi, %rdx)
+    decq %rdx
+    jmp .L2
+.L3:
+    ret
@@ -0,0 +1,58 @@
+    # copies forward unless the destination starts inside the source, then backward. either way the
+    # block the loop would finish on is loaded before anything is stored, so overlap can't corrupt it
+    .text
+    .globl memmove
+memmove:
+    movq %rdi, %rax
+    movq %rdi, %rcx
+    subq %rsi, %rcx
+    cmpq %rdx, %rcx
+    jb .L4
+    cmpq $16, %rdx
+    jb .L2
+    movdqu -16(%rsi, %rdx), %xmm1
+    leaq -16(%rdi, %rdx), %rcx
+.L1:
+    movdqu (%rsi), %xmm0
+    movdqu %xmm0, (%rdi)
+    addq $16, %rsi
+    addq $16, %rdi
+    cmpq %rcx, %rdi
+    jb .L1
+    movdqu %xmm1, (%rcx)
+    ret
+.L2:
+    testq %rdx, %rdx
+    jz .L3
+    movb (%rsi), %cl
+    movb %cl, (%rdi)
+    incq %rsi
+    incq %rdi
+    decq %rdx
+    jmp .L2
+.L3:
+    ret
+.L4:
+    cmpq $16, %rdx
+    jb .L6
+    movdqu (%rsi), %xmm1
+    movq %rdi, %r8
+    addq %rdx, %rsi
+    addq %rdx, %rdi
+    leaq 16(%r8), %rcx
+.L5:
+    subq $16, %rsi
+    subq $16, %rdi
+    movdqu (%rsi), %xmm0
+    movdqu %xmm0, (%rdi)
+    cmpq %rcx, %rdi
+    ja .L5
+    movdqu %xmm1, (%r8)
+    ret
+.L6:
+    testq %rdx, %rdx
+    jz .L3
+    movb -1(%rsi, %rdx), %cl
+    movb %cl, -1(%rdi, %rdx)
+    decq %rdx
+    jmp .L6
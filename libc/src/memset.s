@@ -0,0 +1,27 @@
+    # whole 16-byte stores, with the last one overlapping the one before it instead of finishing bytewise
+    .text
+    .globl memset
+memset:
+    movq %rdi, %rax
+    cmpq $16, %rdx
+    jb .L2
+    movd %esi, %xmm0
+    punpcklbw %xmm0, %xmm0
+    punpcklwd %xmm0, %xmm0
+    pshufd $0, %xmm0, %xmm0
+    leaq -16(%rdi, %rdx), %rcx
+.L1:
+    movdqu %xmm0, (%rdi)
+    addq $16, %rdi
+    cmpq %rcx, %rdi
+    jb .L1
+    movdqu %xmm0, (%rcx)
+    ret
+.L2:
+    testq %rdx, %rdx
+    jz .L3
+    movb %sil, -1(%rdi, %rdx)
+    decq %rdx
+    jmp .L2
+.L3:
+    ret
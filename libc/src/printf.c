@@ -43,7 +43,7 @@ int printf(const char* fmt, ...)
             if (c == 'd')
                 __ecc_printf_int(va_arg(list, int));
             else if (c == 's')
-                puts(va_arg(list, char*));
+                fputs(va_arg(list, char*), stdout);
         }
         else
             putchar(c);
@@ -0,0 +1,44 @@
+    # stops at the first byte that's either c or the terminator, then checks which one it was
+    .text
+    .globl strchr
+strchr:
+    movd %esi, %xmm1
+    punpcklbw %xmm1, %xmm1
+    punpcklwd %xmm1, %xmm1
+    pshufd $0, %xmm1, %xmm1
+    pxor %xmm0, %xmm0
+    movq %rdi, %rax
+    andq $-16, %rax
+    movl %edi, %ecx
+    andl $15, %ecx
+    movdqa (%rax), %xmm2
+    movdqa %xmm2, %xmm3
+    pcmpeqb %xmm1, %xmm2
+    pcmpeqb %xmm0, %xmm3
+    por %xmm3, %xmm2
+    pmovmskb %xmm2, %edx
+    shrl %cl, %edx
+    testl %edx, %edx
+    jz .L1
+    bsfl %edx, %edx
+    leaq (%rdi, %rdx), %rax
+    jmp .L2
+.L1:
+    addq $16, %rax
+    movdqa (%rax), %xmm2
+    movdqa %xmm2, %xmm3
+    pcmpeqb %xmm1, %xmm2
+    pcmpeqb %xmm0, %xmm3
+    por %xmm3, %xmm2
+    pmovmskb %xmm2, %edx
+    testl %edx, %edx
+    jz .L1
+    bsfl %edx, %edx
+    addq %rdx, %rax
+.L2:
+    cmpb %sil, (%rax)
+    jne .L3
+    ret
+.L3:
+    xorl %eax, %eax
+    ret
@@ -0,0 +1,52 @@
+    # 16 bytes at a time with unaligned loads, as long as neither load would run onto the next page;
+    # near the end of a page it falls back to comparing those 16 bytes one at a time
+    .text
+    .globl strcmp
+strcmp:
+    pxor %xmm0, %xmm0
+.L1:
+    movl %edi, %eax
+    andl $4095, %eax
+    cmpl $4080, %eax
+    ja .L3
+    movl %esi, %eax
+    andl $4095, %eax
+    cmpl $4080, %eax
+    ja .L3
+    movdqu (%rdi), %xmm1
+    movdqu (%rsi), %xmm2
+    movdqa %xmm1, %xmm3
+    pcmpeqb %xmm2, %xmm3
+    pcmpeqb %xmm0, %xmm1
+    pmovmskb %xmm3, %eax
+    pmovmskb %xmm1, %ecx
+    notl %eax
+    orl %ecx, %eax
+    andl $0xFFFF, %eax
+    jnz .L2
+    addq $16, %rdi
+    addq $16, %rsi
+    jmp .L1
+.L2:
+    bsfl %eax, %eax
+    movzbl (%rdi, %rax), %edx
+    movzbl (%rsi, %rax), %ecx
+    movl %edx, %eax
+    subl %ecx, %eax
+    ret
+.L3:
+    movl $16, %r8d
+.L4:
+    movzbl (%rdi), %eax
+    movzbl (%rsi), %ecx
+    subl %ecx, %eax
+    jnz .L5
+    testl %ecx, %ecx
+    jz .L5
+    incq %rdi
+    incq %rsi
+    decl %r8d
+    jnz .L4
+    jmp .L1
+.L5:
+    ret
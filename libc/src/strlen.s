@@ -1,15 +1,29 @@
+    # the string is read 16 aligned bytes at a time, and an aligned load never crosses a page
+    # boundary, so nothing past the terminator's page is ever touched
     .text
     .globl strlen
 strlen:
-    pushq %rbp
-	movq %rsp, %rbp
-    xor %rax, %rax
-    jmp .L2
+    movq %rdi, %rax
+    andq $-16, %rax
+    movl %edi, %ecx
+    andl $15, %ecx
+    pxor %xmm0, %xmm0
+    movdqa (%rax), %xmm1
+    pcmpeqb %xmm0, %xmm1
+    pmovmskb %xmm1, %edx
+    shrl %cl, %edx
+    testl %edx, %edx
+    jz .L1
+    bsfl %edx, %eax
+    ret
 .L1:
-    addq $1, %rax
-    addq $1, %rdi
-.L2:
-    cmpb $0, (%rdi)
-    jne .L1
-    leave
+    addq $16, %rax
+    movdqa (%rax), %xmm1
+    pcmpeqb %xmm0, %xmm1
+    pmovmskb %xmm1, %edx
+    testl %edx, %edx
+    jz .L1
+    bsfl %edx, %edx
+    addq %rdx, %rax
+    subq %rdi, %rax
     ret
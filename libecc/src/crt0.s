@@ -7,6 +7,56 @@ _start:
     leaq 16(%rsp, %rdi, 8), %rdx
     xorl %eax, %eax
     call main
-    movl %eax, %edi
+    movl %eax, %ebx
+    # libc points this at whatever flushes its streams
+    movq __ecc_exit_hook(%rip), %rax
+    testq %rax, %rax
+    je 4f
+    call *%rax
+4:
+    # objects compiled with -b keep their branch counters in ecc_profile, which is dumped to ecc.profile
+    movq $__start_ecc_profile, %r12
+    movq $__stop_ecc_profile, %r13
+    cmpq %r12, %r13
+    je 3f
+    movl $2, %eax
+    leaq profile_path(%rip), %rdi
+    movl $0x241, %esi
+    movl $0x1a4, %edx
+    syscall
+    testl %eax, %eax
+    js 3f
+    movl %eax, %r14d
+1:
+    movq %r13, %rdx
+    subq %r12, %rdx
+    je 2f
+    movl %r14d, %edi
+    movq %r12, %rsi
+    movl $1, %eax
+    syscall
+    testq %rax, %rax
+    jle 2f
+    addq %rax, %r12
+    jmp 1b
+2:
+    movl %r14d, %edi
+    movl $3, %eax
+    syscall
+3:
+    movl %ebx, %edi
     movq $0x3c, %rax
     syscall
+
+    .weak __start_ecc_profile
+    .weak __stop_ecc_profile
+
+    .data
+    .globl __ecc_exit_hook
+    .align 8
+__ecc_exit_hook:
+    .quad 0
+
+    .section .rodata
+profile_path:
+    .asciz "ecc.profile"
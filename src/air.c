@@ -17,6 +17,102 @@ typedef struct airinizing_syntax_traverser
 #define NEXT_VIRTUAL_REGISTER (AIRINIZING_TRAVERSER->air->next_available_temporary++)
 #define NEXT_LABEL (AIRINIZING_TRAVERSER->next_label++)
 
+// instructions and operands of the AIR currently being built and transformed are allocated from its arena
+static air_t* current_air = NULL;
+
+/*
+
+the back end lowers routines one at a time, maybe several at once on different threads. while a thread lowers a
+routine, the instructions and operands it makes come from an arena of the routine's own, and the registers and
+instructions it makes are numbered from where the whole AIR left off, separately for every routine. numbers only have
+to be unique within a routine by then, and this way they don't depend on which thread got which routine or in what
+order, so neither does the code that comes out.
+
+*/
+
+// the routine this thread is lowering, if any
+static __thread air_routine_t* lowered_routine = NULL;
+
+#define AIR_LOWERING_CHUNK_SIZE (16 * 1024)
+
+// makes this thread lower the routine from here on, returning the one it was lowering before
+air_routine_t* air_lower(air_t* air, air_routine_t* routine)
+{
+    air_routine_t* previous = lowered_routine;
+    if (routine && !routine->lowering)
+    {
+        air_lowering_t* lowering = calloc(1, sizeof *lowering);
+        lowering->arena = arena_init();
+        lowering->arena->chunk_size = AIR_LOWERING_CHUNK_SIZE;
+        lowering->insns = vector_init();
+        lowering->operands = vector_init();
+        lowering->next_available_temporary = air->next_available_temporary;
+        lowering->next_insn_id = air->insns->size;
+        routine->lowering = lowering;
+    }
+    lowered_routine = routine;
+    return previous;
+}
+
+regid_t air_next_register(air_t* air)
+{
+    if (lowered_routine)
+        return lowered_routine->lowering->next_available_temporary++;
+    return air->next_available_temporary++;
+}
+
+// releases everything lowering the routine made, which is gone along with its instructions
+void air_routine_release(air_routine_t* routine)
+{
+    air_lowering_t* lowering = routine->lowering;
+    if (!lowering) return;
+    VECTOR_FOR(air_insn_t*, insn, lowering->insns)
+        type_delete(insn->ct);
+    VECTOR_FOR(air_insn_operand_t*, op, lowering->operands)
+        type_delete(op->ct);
+    vector_delete(lowering->insns);
+    vector_delete(lowering->operands);
+    arena_delete(lowering->arena);
+    free(lowering);
+    air_cfg_delete(routine->cfg);
+    routine->cfg = NULL;
+    routine->insns = NULL;
+    routine->lowering = NULL;
+}
+
+// types never change once they're part of AIR, so equal ones share a node interned in the translation unit
+c_type_t* air_type(c_type_t* ct)
+{
+    if (!current_air || !current_air->st)
+        return type_copy(ct);
+    pool_lock();
+    c_type_t* interned = type_intern(current_air->st, ct);
+    pool_unlock();
+    return interned;
+}
+
+c_type_t* air_basic_type(c_type_class_t class)
+{
+    if (!current_air || !current_air->st)
+        return make_basic_type(class);
+    pool_lock();
+    c_type_t* interned = type_intern_basic(current_air->st, class);
+    pool_unlock();
+    return interned;
+}
+
+c_type_t* air_reference_type(c_type_t* ct)
+{
+    c_type_t* ref = make_reference_type(ct);
+    if (!current_air || !current_air->st)
+        return ref;
+    pool_lock();
+    c_type_t* interned = type_intern(current_air->st, ref);
+    pool_unlock();
+    type_delete(ref);
+    return interned;
+}
+
 void air_data_delete(air_data_t* ad)
 {
     if (!ad) return;
@@ -25,11 +121,13 @@ void air_data_delete(air_data_t* ad)
     free(ad);
 }
 
+// instructions and operands are arena-allocated, so deleting them only releases the types they own.
+// anything not deleted this way has its types released by air_delete.
 void air_insn_operand_delete(air_insn_operand_t* op)
 {
     if (!op) return;
     type_delete(op->ct);
-    free(op);
+    op->ct = NULL;
 }
 
 void air_insn_delete(air_insn_t* insn)
@@ -37,34 +135,114 @@ void air_insn_delete(air_insn_t* insn)
     if (!insn) return;
     for (size_t i = 0; i < insn->noops; ++i)
         air_insn_operand_delete(insn->ops[i]);
-    free(insn->ops);
     type_delete(insn->ct);
-    free(insn);
+    insn->ct = NULL;
 }
 
 void air_insn_delete_all(air_insn_t* insns)
 {
-    if (!insns) return;
-    air_insn_delete_all(insns->next);
-    air_insn_delete(insns);
+    while (insns)
+    {
+        air_insn_t* next = insns->next;
+        air_insn_delete(insns);
+        insns = next;
+    }
 }
 
 void air_routine_delete(air_routine_t* routine)
 {
     if (!routine) return;
-    air_insn_delete_all(routine->insns);
+    air_routine_release(routine);
+    air_cfg_delete(routine->cfg);
     free(routine);
 }
 
+// this also releases the code attached to the syntax tree the AIR was built from
 void air_delete(air_t* air)
 {
     if (!air) return;
     vector_deep_delete(air->rodata, (void (*)(void*)) air_data_delete);
     vector_deep_delete(air->data, (void (*)(void*)) air_data_delete);
+    vector_deep_delete(air->profile, (void (*)(void*)) air_data_delete);
     vector_deep_delete(air->routines, (void (*)(void*)) air_routine_delete);
+    VECTOR_FOR(air_insn_t*, insn, air->insns)
+        type_delete(insn->ct);
+    VECTOR_FOR(air_insn_operand_t*, op, air->operands)
+        type_delete(op->ct);
+    vector_delete(air->insns);
+    vector_delete(air->operands);
+    if (current_air == air)
+        current_air = NULL;
+    arena_delete(air->arena);
     free(air);
 }
 
+// the highest label the routines use, each translation unit numbering its own from 1
+static unsigned long long last_label(air_t* air)
+{
+    unsigned long long last = 0;
+    VECTOR_FOR(air_routine_t*, routine, air->routines)
+    {
+        for (air_insn_t* insn = routine->insns; insn; insn = insn->next)
+        {
+            for (size_t i = 0; i < insn->noops; ++i)
+            {
+                air_insn_operand_t* op = insn->ops[i];
+                if (op && op->type == AOP_LABEL)
+                    last = max(last, op->content.label.id);
+            }
+        }
+    }
+    return last;
+}
+
+// moves the AIR of another translation unit into this one, leaving from to be freed. its labels are moved past the
+// ones already here, and its instructions are numbered after them, but the symbols are left for the caller to sort
+// out (see program.c)
+void air_merge(air_t* into, air_t* from)
+{
+    unsigned long long labels = last_label(into);
+    VECTOR_FOR(air_routine_t*, routine, from->routines)
+    {
+        for (air_insn_t* insn = routine->insns; insn; insn = insn->next)
+        {
+            for (size_t i = 0; i < insn->noops; ++i)
+            {
+                air_insn_operand_t* op = insn->ops[i];
+                if (op && op->type == AOP_LABEL)
+                    op->content.label.id += labels;
+            }
+        }
+        if (routine->cold_label)
+            routine->cold_label += labels;
+    }
+    VECTOR_FOR(air_insn_t*, insn, from->insns)
+    {
+        insn->id = into->insns->size;
+        vector_add(into->insns, insn);
+    }
+    vector_concat(into->operands, from->operands);
+    vector_concat(into->routines, from->routines);
+    vector_concat(into->data, from->data);
+    vector_concat(into->rodata, from->rodata);
+    vector_concat(into->profile, from->profile);
+    into->next_available_temporary = max(into->next_available_temporary, from->next_available_temporary);
+    into->next_available_lv = max(into->next_available_lv, from->next_available_lv);
+    into->next_available_folded_constant = max(into->next_available_folded_constant, from->next_available_folded_constant);
+    into->next_available_inlined_label = max(into->next_available_inlined_label, from->next_available_inlined_label);
+    into->next_available_vectorized_label = max(into->next_available_vectorized_label, from->next_available_vectorized_label);
+    into->next_available_layout_label = max(into->next_available_layout_label, from->next_available_layout_label);
+    arena_absorb(into->arena, from->arena);
+    vector_delete(from->insns);
+    vector_delete(from->operands);
+    vector_delete(from->routines);
+    vector_delete(from->data);
+    vector_delete(from->rodata);
+    vector_delete(from->profile);
+    free(from);
+    current_air = into;
+}
+
 void air_data_print(air_data_t* ad, air_t* air, int (*printer)(const char* fmt, ...))
 {
     if (!ad)
@@ -168,10 +346,10 @@ void air_insn_operand_print(air_insn_operand_t* op, c_type_t* ict, air_t* air, i
                     printer(" + ");
                     register_print(op->content.inreg.roffset, op->ct ? op->ct : ict, air, printer);
                 }
-                if (op->content.inreg.offset != 0)
-                    printer(" + %lld", op->content.inreg.offset);
                 if (op->content.inreg.factor != 1)
                     printer(" * %lld", op->content.inreg.factor);
+                if (op->content.inreg.offset != 0)
+                    printer(" + %lld", op->content.inreg.offset);
                 if (op->content.inreg.factor != 1 || op->content.inreg.offset != 0 || op->content.inreg.roffset != INVALID_VREGID)
                     printer(")");
             }
@@ -230,7 +408,7 @@ void air_insn_print(air_insn_t* insn, air_t* air, int (*printer)(const char* fmt
         case AIR_FUNC_CALL:
             if (air->locale == LOC_X86_64 && insn->ops[0]->type == AOP_REGISTER && insn->ops[0]->content.reg == INVALID_VREGID)
             {
-                printer("call"); LPAREN OP(1) RPAREN SEMICOLON
+                printer(insn->metadata.fcall_tail ? "tail call" : "call"); LPAREN OP(1) RPAREN SEMICOLON
                 break;
             }
             TYPE OP(0) EQUALS
@@ -381,6 +559,16 @@ void air_insn_print(air_insn_t* insn, air_t* air, int (*printer)(const char* fmt
         case AIR_JMP:
             printer("jmp"); LPAREN OP(0) RPAREN SEMICOLON
             break;
+        case AIR_JMP_TABLE:
+            printer("jmp_table");
+            LPAREN
+            for (size_t i = 0; i < insn->noops; ++i)
+            {
+                if (i != 0) COMMA
+                OP(i)
+            }
+            RPAREN SEMICOLON
+            break;
         case AIR_LABEL:
             OP(0) printer(":");
             break;
@@ -518,6 +706,11 @@ void air_print(air_t* air, int (*printer)(const char* fmt, ...))
         air_data_print(d, air, printer);
         printer("\n");
     }
+    VECTOR_FOR(air_data_t*, pd, air->profile)
+    {
+        air_data_print(pd, air, printer);
+        printer("\n");
+    }
     VECTOR_FOR(air_routine_t*, routine, air->routines)
     {
         air_routine_print(routine, air, printer);
@@ -525,9 +718,17 @@ void air_print(air_t* air, int (*printer)(const char* fmt, ...))
     }
 }
 
+static air_insn_operand_t* air_insn_operand_alloc(void)
+{
+    air_lowering_t* lowering = lowered_routine ? lowered_routine->lowering : NULL;
+    air_insn_operand_t* op = arena_alloc(lowering ? lowering->arena : current_air->arena, sizeof *op);
+    vector_add(lowering ? lowering->operands : current_air->operands, op);
+    return op;
+}
+
 air_insn_operand_t* air_insn_operand_init(air_insn_operand_type_t type)
 {
-    air_insn_operand_t* op = calloc(1, sizeof *op);
+    air_insn_operand_t* op = air_insn_operand_alloc();
     op->type = type;
     return op;
 }
@@ -535,9 +736,9 @@ air_insn_operand_t* air_insn_operand_init(air_insn_operand_type_t type)
 air_insn_operand_t* air_insn_operand_copy(air_insn_operand_t* op)
 {
     if (!op) return NULL;
-    air_insn_operand_t* n = calloc(1, sizeof *n);
+    air_insn_operand_t* n = air_insn_operand_alloc();
     n->type = op->type;
-    n->ct = type_copy(op->ct);
+    n->ct = air_type(op->ct);
     switch (n->type)
     {
         case AOP_SYMBOL:
@@ -590,7 +791,7 @@ air_insn_operand_t* air_insn_register_operand_init(regid_t reg)
 air_insn_operand_t* air_insn_type_operand_init(c_type_t* ct)
 {
     air_insn_operand_t* op = air_insn_operand_init(AOP_TYPE);
-    op->content.ct = type_copy(ct);
+    op->content.ct = air_type(ct);
     return op;
 }
 
@@ -634,26 +835,44 @@ air_insn_operand_t* air_insn_label_operand_init(unsigned long long label, char d
     return op;
 }
 
+// the operand slots are laid out right behind the instruction, and the instruction's id is its index in air->insns
+// unless it was made while lowering a routine
+static air_insn_t* air_insn_alloc(size_t noops)
+{
+    air_lowering_t* lowering = lowered_routine ? lowered_routine->lowering : NULL;
+    air_insn_t* insn = arena_alloc(lowering ? lowering->arena : current_air->arena, sizeof *insn + noops * sizeof(air_insn_operand_t*));
+    if (lowering)
+    {
+        insn->id = lowering->next_insn_id++;
+        vector_add(lowering->insns, insn);
+    }
+    else
+    {
+        insn->id = current_air->insns->size;
+        vector_add(current_air->insns, insn);
+    }
+    insn->noops = noops;
+    insn->ops = (air_insn_operand_t**) (insn + 1);
+    return insn;
+}
+
 air_insn_t* air_insn_init(air_insn_type_t type, size_t noops)
 {
-    air_insn_t* insn = calloc(1, sizeof *insn);
+    air_insn_t* insn = air_insn_alloc(noops);
     insn->type = type;
-    insn->noops = noops;
-    insn->ops = calloc(noops, sizeof(air_insn_operand_t));
     return insn;
 }
 
 air_insn_t* air_insn_copy(air_insn_t* insn)
 {
     if (!insn) return NULL;
-    air_insn_t* n = calloc(1, sizeof *n);
+    air_insn_t* n = air_insn_alloc(insn->noops);
     n->type = insn->type;
-    n->ct = type_copy(insn->ct);
+    n->ct = air_type(insn->ct);
     n->prev = insn->prev;
     n->next = insn->next;
-    n->noops = insn->noops;
-    n->ops = calloc(n->noops, sizeof(air_insn_operand_t));
     n->metadata.fcall_sret = insn->metadata.fcall_sret;
+    n->metadata.fcall_counts_vectors = insn->metadata.fcall_counts_vectors;
     for (size_t i = 0; i < n->noops; ++i)
         n->ops[i] = air_insn_operand_copy(insn->ops[i]);
     return n;
@@ -682,6 +901,7 @@ bool air_insn_creates_temporary(air_insn_t* insn)
         case AIR_JZ:
         case AIR_JNZ:
         case AIR_JMP:
+        case AIR_JMP_TABLE:
         case AIR_LABEL:
         case AIR_PUSH:
         case AIR_SEQUENCE_POINT:
@@ -748,6 +968,7 @@ bool air_insn_assigns(air_insn_t* insn)
         case AIR_JZ:
         case AIR_JNZ:
         case AIR_JMP:
+        case AIR_JMP_TABLE:
         case AIR_LABEL:
         case AIR_PUSH:
         case AIR_SEQUENCE_POINT:
@@ -851,6 +1072,7 @@ bool air_insn_produces_side_effect(air_insn_t* insn)
         case AIR_RETURN:
         case AIR_JZ:
         case AIR_JNZ:
+        case AIR_JMP_TABLE:
         case AIR_PUSH:
         case AIR_ASSIGN:
         case AIR_DIRECT_ADD:
@@ -1078,8 +1300,7 @@ static air_insn_t* copy_air_insn_sequence(air_insn_t* code)
 }
 
 #define SETUP_LINEARIZE \
-    air_insn_t* dummy = calloc(1, sizeof *dummy); \
-    dummy->type = AIR_NOP; \
+    air_insn_t* dummy = air_insn_init(AIR_NOP, 0); \
     air_insn_t* code = dummy;
 
 #define COPY_CODE(s) code = copy_code_impl(s, code)
@@ -1117,9 +1338,13 @@ static regid_t convert(syntax_traverser_t* trav, c_type_t* from, c_type_t* to, r
     bool tf = to->class == CTC_FLOAT;
     bool td = to->class == CTC_DOUBLE || to->class == CTC_LONG_DOUBLE;
 
+    // plain char is signed on the platforms we target
+    bool fs = type_is_signed_integer(from) || from->class == CTC_CHAR;
+    bool ts = type_is_signed_integer(to) || to->class == CTC_CHAR;
+
     int operands = 2;
     
-    if ((type_is_signed_integer(from) || from->class == CTC_CHAR) && type_is_integer(to) && 
+    if (fs && type_is_integer(to) && 
         get_integer_conversion_rank(to) > get_integer_conversion_rank(from))
         type = AIR_SEXT;
     else if (type_is_unsigned_integer(from) && (type_is_integer(to) || to->class == CTC_CHAR) && 
@@ -1129,19 +1354,19 @@ static regid_t convert(syntax_traverser_t* trav, c_type_t* from, c_type_t* to, r
         type = AIR_S2D;
     else if (fd && tf)
         type = AIR_D2S;
-    else if (ff && type_is_signed_integer(to))
+    else if (ff && ts)
         type = AIR_S2SI;
     else if (ff && type_is_unsigned_integer(to))
         type = AIR_S2UI;
-    else if (fd && type_is_signed_integer(to))
+    else if (fd && ts)
         type = AIR_D2SI;
     else if (fd && type_is_unsigned_integer(to))
         type = AIR_D2UI;
-    else if (type_is_signed_integer(from) && tf)
+    else if (fs && tf)
         type = AIR_SI2S;
     else if (type_is_unsigned_integer(from) && tf)
         type = AIR_UI2S;
-    else if (type_is_signed_integer(from) && td)
+    else if (fs && td)
         type = AIR_SI2D;
     else if (type_is_unsigned_integer(from) && td)
         type = AIR_UI2D;
@@ -1150,11 +1375,11 @@ static regid_t convert(syntax_traverser_t* trav, c_type_t* from, c_type_t* to, r
     if (type != AIR_NOP)
     {
         air_insn_t* insn = air_insn_init(type, operands);
-        insn->ct = type_copy(to);
+        insn->ct = air_type(to);
         result = NEXT_VIRTUAL_REGISTER;
         insn->ops[0] = air_insn_register_operand_init(result);
         insn->ops[1] = air_insn_register_operand_init(reg);
-        insn->ops[1]->ct = type_copy(from);
+        insn->ops[1]->ct = air_type(from);
         ADD_CODE(insn);
     }
     *c = code;
@@ -1202,12 +1427,12 @@ static void linearize_function_definition_after(syntax_traverser_t* trav, syntax
         {
             regid_t reg = NEXT_VIRTUAL_REGISTER;
             air_insn_t* ld = air_insn_init(AIR_LOAD, 2);
-            ld->ct = make_basic_type(CTC_INT);
+            ld->ct = air_basic_type(CTC_INT);
             ld->ops[0] = air_insn_register_operand_init(reg);
             ld->ops[1] = air_insn_integer_constant_operand_init(0);
             last = air_insn_insert_after(ld, last);
             air_insn_t* ret = air_insn_init(AIR_RETURN, 1);
-            ret->ct = make_basic_type(CTC_INT);
+            ret->ct = air_basic_type(CTC_INT);
             ret->ops[0] = air_insn_register_operand_init(reg);
             last = air_insn_insert_after(ret, last);
         }
@@ -1265,12 +1490,12 @@ static void linearize_primary_expression_identifier_after(syntax_traverser_t* tr
     if (!syntax_is_in_lvalue_context(syn) && !type_is_sua(sy->type) && sy->type->class != CTC_FUNCTION)
     {
         insn = air_insn_init(AIR_LOAD, 2);
-        insn->ct = type_copy(syn->ctype);
+        insn->ct = air_type(syn->ctype);
     }
     else
     {
         insn = air_insn_init(AIR_LOAD_ADDR, 2);
-        insn->ct = make_reference_type(sy->type);
+        insn->ct = air_reference_type(sy->type);
     }
     insn->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
     insn->ops[1] = air_insn_symbol_operand_init(sy);
@@ -1286,7 +1511,7 @@ static void linearize_primary_expression_enumeration_constant_after(syntax_trave
     if (!sy) report_return;
     SETUP_LINEARIZE;
     air_insn_t* insn = air_insn_init(AIR_LOAD, 2);
-    insn->ct = type_copy(syn->ctype);
+    insn->ct = air_type(syn->ctype);
     insn->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
     insn->ops[1] = air_insn_integer_constant_operand_init(sy->declarer->parent->enumr_value);
     ADD_CODE(insn);
@@ -1297,7 +1522,7 @@ static void linearize_integer_constant_after(syntax_traverser_t* trav, syntax_co
 {
     SETUP_LINEARIZE;
     air_insn_t* insn = air_insn_init(AIR_LOAD, 2);
-    insn->ct = type_copy(syn->ctype);
+    insn->ct = air_type(syn->ctype);
     insn->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
     insn->ops[1] = air_insn_integer_constant_operand_init(syn->intc);
     ADD_CODE(insn);
@@ -1308,7 +1533,7 @@ static void linearize_character_constant_after(syntax_traverser_t* trav, syntax_
 {
     SETUP_LINEARIZE;
     air_insn_t* insn = air_insn_init(AIR_LOAD, 2);
-    insn->ct = type_copy(syn->ctype);
+    insn->ct = air_type(syn->ctype);
     insn->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
     insn->ops[1] = air_insn_integer_constant_operand_init(syn->charc_value);
     ADD_CODE(insn);
@@ -1341,7 +1566,7 @@ static void linearize_floating_constant_after(syntax_traverser_t* trav, syntax_c
 
     SETUP_LINEARIZE;
     air_insn_t* insn = air_insn_init(AIR_LOAD, 2);
-    insn->ct = type_copy(syn->ctype);
+    insn->ct = air_type(syn->ctype);
     insn->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
     insn->ops[1] = air_insn_symbol_operand_init(data->sy);
     ADD_CODE(insn);
@@ -1430,11 +1655,120 @@ static void linearize_array_declarator_after(syntax_traverser_t* trav, syntax_co
     FINALIZE_LINEARIZE;
 }
 
-static void initialize_string_literal(syntax_component_t* strl, symbol_t* sy, int64_t base_offset, air_insn_t** c)
+// copies and fills of more bytes than this call memcpy and memset instead of being spelled out
+#define AIR_INLINE_COPY_LIMIT 128
+
+// the libc routine by this name, made the first time it's needed. it's keyed apart from the name so that it can't be
+// found by lookups of identifiers in the program
+static symbol_t* library_routine(syntax_traverser_t* trav, symbol_t** routine, char* name)
+{
+    if (*routine)
+        return *routine;
+    char key[32];
+    snprintf(key, sizeof key, "__ecc_%s", name);
+    symbol_t* sy = symbol_table_add(AIRINIZING_TRAVERSER->air->st, key, symbol_init(NULL));
+    sy->name = strdup(name);
+    sy->type = make_basic_type(CTC_FUNCTION);
+    sy->type->derived_from = make_basic_type(CTC_POINTER);
+    sy->type->derived_from->derived_from = make_basic_type(CTC_VOID);
+    sy->sd = SD_STATIC;
+    return *routine = sy;
+}
+
+// the address of the symbol plus the offset if there is one, otherwise the address in dest plus the offset
+static regid_t aggregate_address(syntax_traverser_t* trav, symbol_t* sy, regid_t dest, int64_t offset, air_insn_t** c)
 {
     air_insn_t* code = *c;
-    int64_t array_size = type_size(sy->type);
-    unsigned long long size = (strl->strl_length->intc + 1) * (strl->strl_reg ? UNSIGNED_CHAR_WIDTH : C_TYPE_WCHAR_T_WIDTH);
+    if (sy)
+    {
+        air_insn_t* ld = air_insn_init(AIR_LOAD_ADDR, 2);
+        ld->ct = air_reference_type(sy->type);
+        ld->ops[0] = air_insn_register_operand_init(dest = NEXT_VIRTUAL_REGISTER);
+        ld->ops[1] = air_insn_symbol_operand_init(sy);
+        ADD_CODE(ld);
+    }
+    if (offset)
+    {
+        air_insn_t* add = air_insn_init(AIR_ADD, 3);
+        c_type_t* bytes = make_basic_type(CTC_UNSIGNED_CHAR);
+        add->ct = air_reference_type(bytes);
+        type_delete(bytes);
+        add->ops[0] = air_insn_register_operand_init(NEXT_VIRTUAL_REGISTER);
+        add->ops[1] = air_insn_register_operand_init(dest);
+        add->ops[2] = air_insn_integer_constant_operand_init(offset);
+        dest = add->ops[0]->content.reg;
+        ADD_CODE(add);
+    }
+    *c = code;
+    return dest;
+}
+
+// calls memcpy(dest, src, size) or memset(dest, value, size), whichever is given, where value is the register
+// holding an int
+static void call_library_routine(syntax_traverser_t* trav, symbol_t* routine, regid_t dest, regid_t src, long long size, air_insn_t** c)
+{
+    air_insn_t* code = *c;
+    air_insn_t* ldn = air_insn_init(AIR_LOAD, 2);
+    ldn->ct = air_basic_type(C_TYPE_SIZE_T);
+    ldn->ops[0] = air_insn_register_operand_init(NEXT_VIRTUAL_REGISTER);
+    ldn->ops[1] = air_insn_integer_constant_operand_init(size);
+    ADD_CODE(ldn);
+    air_insn_t* call = air_insn_init(AIR_FUNC_CALL, 5);
+    call->ct = air_type(routine->type->derived_from);
+    call->ops[0] = air_insn_register_operand_init(NEXT_VIRTUAL_REGISTER);
+    call->ops[1] = air_insn_symbol_operand_init(routine);
+    call->ops[2] = air_insn_register_operand_init(dest);
+    call->ops[3] = air_insn_register_operand_init(src);
+    call->ops[4] = air_insn_register_operand_init(ldn->ops[0]->content.reg);
+    ADD_CODE(call);
+    *c = code;
+}
+
+// copies a struct or union from the address in src, an eightbyte at a time with a narrower tail. the destination is
+// the symbol at the offset if there is one, otherwise the offset from the address in dest
+static void copy_aggregate(syntax_traverser_t* trav, symbol_t* sy, regid_t dest, int64_t base_offset, regid_t src, long long size, air_insn_t** c)
+{
+    if (size > AIR_INLINE_COPY_LIMIT)
+    {
+        symbol_t* memcpy_routine = library_routine(trav, &AIRINIZING_TRAVERSER->air->memcpy_routine, "memcpy");
+        dest = aggregate_address(trav, sy, dest, base_offset, c);
+        call_library_routine(trav, memcpy_routine, dest, src, size, c);
+        return;
+    }
+    air_insn_t* code = *c;
+    for (long long copied = 0; copied < size;)
+    {
+        long long remaining = size - copied;
+        c_type_class_t class = CTC_UNSIGNED_LONG_LONG_INT;
+        if (remaining < UNSIGNED_SHORT_INT_WIDTH)
+            class = CTC_UNSIGNED_CHAR;
+        else if (remaining < UNSIGNED_INT_WIDTH)
+            class = CTC_UNSIGNED_SHORT_INT;
+        else if (remaining < UNSIGNED_LONG_LONG_INT_WIDTH)
+            class = CTC_UNSIGNED_INT;
+        air_insn_t* loadsrc = air_insn_init(AIR_LOAD, 2);
+        loadsrc->ct = air_basic_type(class);
+        regid_t srcreg = NEXT_VIRTUAL_REGISTER;
+        loadsrc->ops[0] = air_insn_register_operand_init(srcreg);
+        loadsrc->ops[1] = air_insn_indirect_register_operand_init(src, copied, INVALID_VREGID, 1);
+        ADD_CODE(loadsrc);
+        air_insn_t* loaddest = air_insn_init(AIR_ASSIGN, 2);
+        loaddest->ct = air_basic_type(class);
+        loaddest->ops[0] = sy ? air_insn_indirect_symbol_operand_init(sy, base_offset + copied) :
+            air_insn_indirect_register_operand_init(dest, base_offset + copied, INVALID_VREGID, 1);
+        loaddest->ops[1] = air_insn_register_operand_init(srcreg);
+        ADD_CODE(loaddest);
+        copied += type_size(loadsrc->ct);
+    }
+    *c = code;
+}
+
+// the length of a string literal already counts its null terminator
+static void initialize_string_literal(syntax_component_t* strl, symbol_t* sy, c_type_t* ct, int64_t base_offset, air_insn_t** c)
+{
+    air_insn_t* code = *c;
+    int64_t array_size = type_size(ct);
+    unsigned long long size = strl->strl_length->intc * (strl->strl_reg ? UNSIGNED_CHAR_WIDTH : C_TYPE_WCHAR_T_WIDTH);
     if (array_size != -1)
         size = min(size, array_size);
     char* str = strl->strl_reg ? strl->strl_reg : (char*) strl->strl_wide;
@@ -1449,7 +1783,7 @@ static void initialize_string_literal(syntax_component_t* strl, symbol_t* sy, in
         else if (remaining < UNSIGNED_LONG_LONG_INT_WIDTH)
             class = CTC_UNSIGNED_INT;
         air_insn_t* loaddest = air_insn_init(AIR_ASSIGN, 2);
-        loaddest->ct = make_basic_type(class);
+        loaddest->ct = air_basic_type(class);
         loaddest->ops[0] = air_insn_indirect_symbol_operand_init(sy, base_offset + copied);
         unsigned long long value = 0;
         switch (class)
@@ -1493,13 +1827,13 @@ static void initialize(syntax_traverser_t* trav, syntax_component_t* initializer
         COPY_CODE(initializer);
         regid_t reg = convert(trav, initializer->ctype, initializer->initializer_ctype, initializer->expr_reg, &code);
         air_insn_t* assign = air_insn_init(AIR_ASSIGN, 2);
-        assign->ct = type_copy(ct);
+        assign->ct = air_type(ct);
         assign->ops[0] = air_insn_indirect_symbol_operand_init(sy, base_offset + initializer->initializer_offset);
         assign->ops[1] = air_insn_register_operand_init(reg);
         ADD_CODE(assign);
     }
     else if (initializer->type == SC_STRING_LITERAL && initializer->strl_reg && ct->class == CTC_ARRAY && type_is_character(ct->derived_from))
-        initialize_string_literal(initializer, sy, base_offset + initializer->initializer_offset, &code);
+        initialize_string_literal(initializer, sy, ct, base_offset + initializer->initializer_offset, &code);
     else if (initializer->type == SC_STRING_LITERAL && initializer->strl_wide && ct->class == CTC_ARRAY && type_is_wchar_compatible(ct->derived_from))
         // TODO
         report_return;
@@ -1560,12 +1894,27 @@ static void linearize_initializer_list_after(syntax_traverser_t* trav, syntax_co
 
     SETUP_LINEARIZE;
 
-    air_insn_t* ms = air_insn_init(AIR_MEMSET, 3);
-    ms->ct = make_reference_type(sy->type);
-    ms->ops[0] = air_insn_integer_constant_operand_init(0);
-    ms->ops[1] = air_insn_symbol_operand_init(sy);
-    ms->ops[2] = air_insn_integer_constant_operand_init(type_size(sy->type));
-    ADD_CODE(ms);
+    long long size = type_size(sy->type);
+    if (size > AIR_INLINE_COPY_LIMIT)
+    {
+        symbol_t* memset_routine = library_routine(trav, &AIRINIZING_TRAVERSER->air->memset_routine, "memset");
+        regid_t dest = aggregate_address(trav, sy, INVALID_VREGID, 0, &code);
+        air_insn_t* ldv = air_insn_init(AIR_LOAD, 2);
+        ldv->ct = air_basic_type(CTC_INT);
+        ldv->ops[0] = air_insn_register_operand_init(NEXT_VIRTUAL_REGISTER);
+        ldv->ops[1] = air_insn_integer_constant_operand_init(0);
+        ADD_CODE(ldv);
+        call_library_routine(trav, memset_routine, dest, ldv->ops[0]->content.reg, size, &code);
+    }
+    else
+    {
+        air_insn_t* ms = air_insn_init(AIR_MEMSET, 3);
+        ms->ct = air_reference_type(sy->type);
+        ms->ops[0] = air_insn_integer_constant_operand_init(0);
+        ms->ops[1] = air_insn_symbol_operand_init(sy);
+        ms->ops[2] = air_insn_integer_constant_operand_init(size);
+        ADD_CODE(ms);
+    }
 
     initialize(trav, syn, sy, 0, &code);
 
@@ -1574,12 +1923,45 @@ static void linearize_initializer_list_after(syntax_traverser_t* trav, syntax_co
     FINALIZE_LINEARIZE;
 }
 
+// whether a static declaration without an initializer leaves the storage to some other declaration
+// ISO: 6.9.2 (2)
+static bool static_declaration_is_deferred(syntax_component_t* syn, symbol_t* sy)
+{
+    if (syn->ideclr_initializer)
+        return false;
+    // extern declarations only refer to an object, wherever it's defined
+    if (syntax_has_specifier(syn->parent->decl_declaration_specifiers, SC_STORAGE_CLASS_SPECIFIER, SCS_EXTERN))
+        return true;
+    syntax_component_t* scope = symbol_get_scope(sy);
+    if (!scope || scope->type != SC_TRANSLATION_UNIT)
+        return false;
+    // tentative definitions give way to a real definition, or else to the first of them
+    bool earlier = true;
+    for (symbol_t* other = symbol_table_get_all(SYMBOL_TABLE, symbol_get_name(sy)); other; other = other->next)
+    {
+        if (other == sy)
+        {
+            earlier = false;
+            continue;
+        }
+        if (symbol_get_scope(other) != scope || other->type->class == CTC_FUNCTION)
+            continue;
+        syntax_component_t* ideclr = syntax_get_full_declarator(other->declarer);
+        if (!ideclr || ideclr->type != SC_INIT_DECLARATOR)
+            continue;
+        if (ideclr->ideclr_initializer || (earlier && syntax_is_tentative_definition(other->declarer)))
+            return true;
+    }
+    return false;
+}
+
 static void linearize_static_init_declarator_after(syntax_traverser_t* trav, syntax_component_t* syn, symbol_t* sy, air_insn_t** c)
 {
     air_insn_t* code = *c;
 
     if (sy->type->class == CTC_FUNCTION ||
-        syntax_has_specifier(syn->parent->decl_declaration_specifiers, SC_STORAGE_CLASS_SPECIFIER, SCS_TYPEDEF))
+        syntax_has_specifier(syn->parent->decl_declaration_specifiers, SC_STORAGE_CLASS_SPECIFIER, SCS_TYPEDEF) ||
+        static_declaration_is_deferred(syn, sy))
         return;
 
     air_data_t* data = calloc(1, sizeof *data);
@@ -1651,7 +2033,7 @@ static void linearize_init_declarator_after(syntax_traverser_t* trav, syntax_com
     {
         regid_t reg = convert(trav, init->ctype, sy->type, init->expr_reg, &code);
         air_insn_t* insn = air_insn_init(AIR_ASSIGN, 2);
-        insn->ct = type_copy(sy->type);
+        insn->ct = air_type(sy->type);
         insn->ops[0] = air_insn_symbol_operand_init(sy);
         insn->ops[1] = air_insn_register_operand_init(reg);
         ADD_CODE(insn);
@@ -1659,36 +2041,13 @@ static void linearize_init_declarator_after(syntax_traverser_t* trav, syntax_com
 
     // ISO: 6.7.8 (14), 6.7.8 (15)
     else if (is_char_array || is_wchar_array)
-        initialize_string_literal(init, sy, 0, &code);
+        initialize_string_literal(init, sy, sy->type, 0, &code);
 
     // ISO: 6.7.8 (13)
     else
     {
         if (sy->type->class != CTC_STRUCTURE && sy->type->class != CTC_UNION) report_return;
-        long long size = type_size(sy->type);
-        for (long long copied = 0; copied < size;)
-        {
-            long long remaining = size - copied;
-            c_type_class_t class = CTC_UNSIGNED_LONG_LONG_INT;
-            if (remaining < UNSIGNED_SHORT_INT_WIDTH)
-                class = CTC_UNSIGNED_CHAR;
-            else if (remaining < UNSIGNED_INT_WIDTH)
-                class = CTC_UNSIGNED_SHORT_INT;
-            else if (remaining < UNSIGNED_LONG_LONG_INT_WIDTH)
-                class = CTC_UNSIGNED_INT;
-            air_insn_t* loadsrc = air_insn_init(AIR_LOAD, 2);
-            loadsrc->ct = make_basic_type(class);
-            regid_t srcreg = NEXT_VIRTUAL_REGISTER;
-            loadsrc->ops[0] = air_insn_register_operand_init(srcreg);
-            loadsrc->ops[1] = air_insn_indirect_register_operand_init(init->expr_reg, copied, INVALID_VREGID, 1);
-            ADD_CODE(loadsrc);
-            air_insn_t* loaddest = air_insn_init(AIR_ASSIGN, 2);
-            loaddest->ct = make_basic_type(class);
-            loaddest->ops[0] = air_insn_indirect_symbol_operand_init(sy, copied);
-            loaddest->ops[1] = air_insn_register_operand_init(srcreg);
-            ADD_CODE(loaddest);
-            copied += type_size(loadsrc->ct);
-        }
+        copy_aggregate(trav, sy, INVALID_VREGID, 0, init->expr_reg, type_size(sy->type), &code);
     }
 
     ADD_SEQUENCE_POINT;
@@ -1718,13 +2077,17 @@ static void linearize_subscript_expression_after(syntax_traverser_t* trav, synta
         obj = idx;
         idx = tmp;
     }
+    // the index is widened to the pointer's width before it's scaled, like in pointer arithmetic
+    c_type_t* ptrsize = make_basic_type(C_TYPE_PTRSIZE_T);
+    regid_t ireg = convert(trav, idx->ctype, ptrsize, idx->expr_reg, &code);
     air_insn_t* sizeup = air_insn_init(AIR_MULTIPLY, 3);
-    sizeup->ct = type_copy(idx->ctype);
+    sizeup->ct = air_type(ptrsize);
     regid_t sureg = NEXT_VIRTUAL_REGISTER;
     sizeup->ops[0] = air_insn_register_operand_init(sureg);
-    sizeup->ops[1] = air_insn_register_operand_init(idx->expr_reg);
+    sizeup->ops[1] = air_insn_register_operand_init(ireg);
     sizeup->ops[2] = air_insn_integer_constant_operand_init(type_size(obj->ctype->derived_from));
     ADD_CODE(sizeup);
+    type_delete(ptrsize);
     air_insn_t* insn = NULL;
     c_type_t* mt = obj->ctype->derived_from;
     if (syntax_is_in_lvalue_context(syn) ||
@@ -1733,11 +2096,11 @@ static void linearize_subscript_expression_after(syntax_traverser_t* trav, synta
     {
         insn = air_insn_init(AIR_ADD, 3);
         if (mt->class == CTC_ARRAY)
-            insn->ct = type_copy(syn->ctype);
+            insn->ct = air_type(syn->ctype);
         else if (mt->class == CTC_STRUCTURE || mt->class == CTC_UNION)
-            insn->ct = make_reference_type(syn->ctype);
+            insn->ct = air_reference_type(syn->ctype);
         else
-            insn->ct = type_copy(obj->ctype);
+            insn->ct = air_type(obj->ctype);
         insn->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
         insn->ops[1] = air_insn_register_operand_init(syn->bexpr_lhs->expr_reg);
         insn->ops[2] = air_insn_register_operand_init(sureg);
@@ -1745,7 +2108,7 @@ static void linearize_subscript_expression_after(syntax_traverser_t* trav, synta
     else
     {
         insn = air_insn_init(AIR_LOAD, 2);
-        insn->ct = type_copy(syn->ctype);
+        insn->ct = air_type(syn->ctype);
         insn->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
         insn->ops[1] = air_insn_indirect_register_operand_init(syn->bexpr_lhs->expr_reg, 0, sureg, 1);
     }
@@ -1773,18 +2136,18 @@ static void linearize_string_literal_after(syntax_traverser_t* trav, syntax_comp
     data->sy = symbol_table_get_syn_id(SYMBOL_TABLE, syn);
     if (syn->strl_reg)
     {
-        data->data = calloc(syn->strl_length->intc + 1, sizeof(unsigned char));
-        memcpy(data->data, syn->strl_reg, syn->strl_length->intc + 1);
+        data->data = calloc(syn->strl_length->intc, sizeof(unsigned char));
+        memcpy(data->data, syn->strl_reg, syn->strl_length->intc);
     }
     else
     {
-        data->data = calloc(syn->strl_length->intc + 1, sizeof(int));
-        memcpy(data->data, syn->strl_wide, sizeof(int) * (syn->strl_length->intc + 1));
+        data->data = calloc(syn->strl_length->intc, sizeof(int));
+        memcpy(data->data, syn->strl_wide, sizeof(int) * syn->strl_length->intc);
     }
     vector_add(air->rodata, data);
     SETUP_LINEARIZE;
     air_insn_t* insn = air_insn_init(AIR_LOAD_ADDR, 2);
-    insn->ct = type_copy(syn->ctype);
+    insn->ct = air_type(syn->ctype);
     insn->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
     insn->ops[1] = air_insn_symbol_operand_init(data->sy);
     ADD_CODE(insn);
@@ -1834,13 +2197,15 @@ static void linearize_function_call_expression_after(syntax_traverser_t* trav, s
     }
     ADD_SEQUENCE_POINT;
     COPY_CODE(syn->fcallexpr_expression);
+    c_type_t* ftype = syn->fcallexpr_expression->ctype->derived_from;
+    insn->metadata.fcall_counts_vectors = !ftype->function.param_types || ftype->function.variadic;
     if (syn->ctype->class == CTC_STRUCTURE || syn->ctype->class == CTC_UNION)
     {
-        insn->ct = make_reference_type(syn->ctype);
+        insn->ct = air_reference_type(syn->ctype);
         insn->metadata.fcall_sret = true;
     }
     else
-        insn->ct = type_copy(syn->ctype);
+        insn->ct = air_type(syn->ctype);
     insn->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
     insn->ops[1] = air_insn_register_operand_init(syn->fcallexpr_expression->expr_reg);
     ADD_CODE(insn);
@@ -1865,9 +2230,9 @@ static void linearize_member_expression_after(syntax_traverser_t* trav, syntax_c
     {
         insn = air_insn_init(AIR_ADD, 3);
         if (mt->class == CTC_ARRAY)
-            insn->ct = type_copy(syn->ctype);
+            insn->ct = air_type(syn->ctype);
         else
-            insn->ct = make_reference_type(mt);
+            insn->ct = air_reference_type(mt);
         insn->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
         insn->ops[1] = air_insn_register_operand_init(syn->memexpr_expression->expr_reg);
         insn->ops[2] = air_insn_integer_constant_operand_init(offset);
@@ -1875,7 +2240,7 @@ static void linearize_member_expression_after(syntax_traverser_t* trav, syntax_c
     else
     {
         insn = air_insn_init(AIR_LOAD, 2);
-        insn->ct = type_copy(syn->ctype);
+        insn->ct = air_type(syn->ctype);
         insn->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
         insn->ops[1] = air_insn_indirect_register_operand_init(syn->bexpr_lhs->expr_reg, offset, INVALID_VREGID, 1);
     }
@@ -1897,11 +2262,11 @@ static void linearize_increment_decrement_expression_after(syntax_traverser_t* t
     bool add = syn->type == SC_PREFIX_INCREMENT_EXPRESSION || syn->type == SC_POSTFIX_INCREMENT_EXPRESSION;
     bool prefix = syn->type == SC_PREFIX_INCREMENT_EXPRESSION || syn->type == SC_PREFIX_DECREMENT_EXPRESSION;
     air_insn_t* chg = air_insn_init(add ? AIR_DIRECT_ADD : AIR_DIRECT_SUBTRACT, 2);
-    chg->ct = type_copy(syn->uexpr_operand->ctype);
+    chg->ct = air_type(syn->uexpr_operand->ctype);
     chg->ops[0] = air_insn_indirect_register_operand_init(syn->uexpr_operand->expr_reg, 0, INVALID_VREGID, 1);
     chg->ops[1] = air_insn_integer_constant_operand_init(syn->uexpr_operand->ctype->class == CTC_POINTER ? type_size(syn->uexpr_operand->ctype->derived_from) : 1);
     air_insn_t* access = air_insn_init(AIR_LOAD, 2);
-    access->ct = type_copy(syn->uexpr_operand->ctype);
+    access->ct = air_type(syn->uexpr_operand->ctype);
     access->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
     access->ops[1] = air_insn_indirect_register_operand_init(syn->uexpr_operand->expr_reg, 0, INVALID_VREGID, 1);
     if (prefix)
@@ -1921,13 +2286,13 @@ static void linearize_automatic_compound_literal_after(syntax_traverser_t* trav,
 {
     SETUP_LINEARIZE;
     air_insn_t* decl = air_insn_init(AIR_DECLARE, 1);
-    decl->ct = type_copy(sy->type);
+    decl->ct = air_type(sy->type);
     decl->ops[0] = air_insn_symbol_operand_init(sy);
     ADD_CODE(decl);
     COPY_CODE(syn->cl_type_name);
     COPY_CODE(syn->cl_inlist);
     air_insn_t* insn = air_insn_init(AIR_LOAD_ADDR, 2);
-    insn->ct = make_reference_type(sy->type);
+    insn->ct = air_reference_type(sy->type);
     insn->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
     insn->ops[1] = air_insn_symbol_operand_init(sy);
     ADD_CODE(insn);
@@ -1978,6 +2343,13 @@ static void linearize_unary_expression_after(syntax_traverser_t* trav, syntax_co
 {
     SETUP_LINEARIZE;
     COPY_CODE(syn->uexpr_operand);
+    // an lvalue like *p = x is stored through the pointer itself, there's nothing to load
+    if (syn->type == SC_DEREFERENCE_EXPRESSION && syntax_is_in_lvalue_context(syn))
+    {
+        syn->expr_reg = syn->uexpr_operand->expr_reg;
+        FINALIZE_LINEARIZE;
+        return;
+    }
     air_insn_type_t type = AIR_NOP;
     switch (syn->type)
     {
@@ -1989,7 +2361,7 @@ static void linearize_unary_expression_after(syntax_traverser_t* trav, syntax_co
         default: report_return;
     }
     air_insn_t* insn = air_insn_init(type, 2);
-    insn->ct = type_copy(syn->ctype);
+    insn->ct = air_type(syn->ctype);
     insn->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
     regid_t srcreg = syn->uexpr_operand->expr_reg;
     c_type_t* ut = NULL;
@@ -2009,7 +2381,7 @@ static void linearize_unary_expression_after(syntax_traverser_t* trav, syntax_co
         if (dt->class == CTC_STRUCTURE || dt->class == CTC_UNION)
         {
             type_delete(insn->ct);
-            insn->ct = make_reference_type(dt);
+            insn->ct = air_reference_type(dt);
         }
         if (!type_is_sua(dt))
             insn->ops[1] = air_insn_indirect_register_operand_init(srcreg, 0, INVALID_VREGID, 1);
@@ -2032,7 +2404,7 @@ static void linearize_sizeof_expression_after(syntax_traverser_t* trav, syntax_c
         // TODO: VLA garbage
         report_return;
     air_insn_t* insn = air_insn_init(AIR_LOAD, 2);
-    insn->ct = make_basic_type(C_TYPE_SIZE_T);
+    insn->ct = air_basic_type(C_TYPE_SIZE_T);
     insn->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
     insn->ops[1] = air_insn_integer_constant_operand_init(size);
     ADD_CODE(insn);
@@ -2048,7 +2420,7 @@ static void linearize_sizeof_type_expression_after(syntax_traverser_t* trav, syn
     if (size == -1)
         report_return;
     air_insn_t* insn = air_insn_init(AIR_LOAD, 2);
-    insn->ct = make_basic_type(C_TYPE_SIZE_T);
+    insn->ct = air_basic_type(C_TYPE_SIZE_T);
     insn->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
     insn->ops[1] = air_insn_integer_constant_operand_init(size);
     ADD_CODE(insn);
@@ -2114,7 +2486,7 @@ static void linearize_assignment_expression_after(syntax_traverser_t* trav, synt
         (lhs_deref_size = type_size(syn->bexpr_lhs->ctype->derived_from)) != 1)
     {
         air_insn_t* mul = air_insn_init(AIR_MULTIPLY, 3);
-        mul->ct = type_copy(syn->bexpr_rhs->ctype);
+        mul->ct = air_type(syn->bexpr_rhs->ctype);
         regid_t multiplied_reg = NEXT_VIRTUAL_REGISTER;
         mul->ops[0] = air_insn_register_operand_init(multiplied_reg);
         mul->ops[1] = air_insn_register_operand_init(rhs_reg);
@@ -2126,17 +2498,23 @@ static void linearize_assignment_expression_after(syntax_traverser_t* trav, synt
     {
         syn->expr_reg = convert(trav, syn->bexpr_rhs->ctype, syn->ctype, rhs_reg, &code);
         air_insn_t* insn = air_insn_init(type, 2);
-        insn->ct = type_copy(syn->ctype);
+        insn->ct = air_type(syn->ctype);
         insn->ops[0] = air_insn_indirect_register_operand_init(syn->bexpr_lhs->expr_reg, 0, INVALID_VREGID, 1);
         insn->ops[1] = air_insn_register_operand_init(syn->expr_reg);
         ADD_CODE(insn);
     }
+    // ISO: 6.5.16.1 (2)
+    else if (syn->type == SC_ASSIGNMENT_EXPRESSION && (syn->ctype->class == CTC_STRUCTURE || syn->ctype->class == CTC_UNION))
+    {
+        copy_aggregate(trav, NULL, syn->bexpr_lhs->expr_reg, 0, rhs_reg, type_size(syn->ctype), &code);
+        syn->expr_reg = syn->bexpr_lhs->expr_reg;
+    }
     else
         report_return;
     if (syn->type != SC_ASSIGNMENT_EXPRESSION)
     {
         air_insn_t* insn = air_insn_init(AIR_LOAD, 2);
-        insn->ct = type_copy(syn->ctype);
+        insn->ct = air_type(syn->ctype);
         insn->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
         insn->ops[1] = air_insn_indirect_register_operand_init(syn->bexpr_lhs->expr_reg, 0, INVALID_VREGID, 1);
         ADD_CODE(insn);
@@ -2200,21 +2578,23 @@ static void linearize_binary_expression_after(syntax_traverser_t* trav, syntax_c
     regid_t lreg = syn->bexpr_lhs->expr_reg;
     regid_t rreg = syn->bexpr_rhs->expr_reg;
     c_type_t* opt = NULL;
-    if ((syntax_is_relational_expression_type(syn->type) || syntax_is_equality_expression_type(syn->type)) &&
-        type_is_arithmetic(syn->bexpr_lhs->ctype) &&
-        type_is_arithmetic(syn->bexpr_rhs->ctype))
+    bool comparison = syntax_is_relational_expression_type(syn->type) || syntax_is_equality_expression_type(syn->type);
+    if (comparison && type_is_arithmetic(syn->bexpr_lhs->ctype) && type_is_arithmetic(syn->bexpr_rhs->ctype))
         opt = usual_arithmetic_conversions_result_type(syn->bexpr_lhs->ctype, syn->bexpr_rhs->ctype);
+    else if (comparison)
+        // pointers are compared as the whole, unsigned addresses they are
+        opt = make_basic_type(CTC_UNSIGNED_LONG_INT);
     else
         opt = type_copy(syn->ctype);
     lreg = convert(trav, syn->bexpr_lhs->ctype, opt, lreg, &code);
     rreg = convert(trav, syn->bexpr_rhs->ctype, opt, rreg, &code);
     air_insn_t* insn = air_insn_init(type, 3);
-    insn->ct = type_copy(syn->ctype);
+    insn->ct = air_type(syn->ctype);
     insn->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
     insn->ops[1] = air_insn_register_operand_init(lreg);
-    insn->ops[1]->ct = type_copy(opt);
+    insn->ops[1]->ct = air_type(opt);
     insn->ops[2] = air_insn_register_operand_init(rreg);
-    insn->ops[2]->ct = type_copy(opt);
+    insn->ops[2]->ct = air_type(opt);
     ADD_CODE(insn);
     type_delete(opt);
     FINALIZE_LINEARIZE;
@@ -2223,29 +2603,36 @@ static void linearize_binary_expression_after(syntax_traverser_t* trav, syntax_c
 static void linearize_ptr_offset_expression_after(syntax_traverser_t* trav, syntax_component_t* syn, air_insn_type_t type)
 {
     SETUP_LINEARIZE;
-    COPY_CODE(syn->bexpr_lhs);
     bool scale_on_left = syn->bexpr_rhs->ctype->class == CTC_POINTER;
-    regid_t reg = scale_on_left ? syn->bexpr_lhs->expr_reg : syn->bexpr_rhs->expr_reg;
-    long long size = type_size(scale_on_left ? syn->bexpr_rhs->ctype->derived_from : syn->bexpr_lhs->ctype->derived_from);
-    air_insn_t* mul = NULL;
+    syntax_component_t* ptr = scale_on_left ? syn->bexpr_rhs : syn->bexpr_lhs;
+    syntax_component_t* index = scale_on_left ? syn->bexpr_lhs : syn->bexpr_rhs;
+    long long size = type_size(ptr->ctype->derived_from);
+    // the index is widened to the pointer's width before it's scaled so it can't wrap around first
+    c_type_t* ptrsize = make_basic_type(C_TYPE_PTRSIZE_T);
+    regid_t reg = 0;
+    COPY_CODE(syn->bexpr_lhs);
+    if (scale_on_left)
+        reg = convert(trav, index->ctype, ptrsize, index->expr_reg, &code);
+    COPY_CODE(syn->bexpr_rhs);
+    if (!scale_on_left)
+        reg = convert(trav, index->ctype, ptrsize, index->expr_reg, &code);
     if (size != 1)
     {
-        mul = air_insn_init(AIR_MULTIPLY, 3);
-        mul->ct = type_copy(scale_on_left ? syn->bexpr_lhs->ctype : syn->bexpr_rhs->ctype);
-        mul->ops[0] = air_insn_register_operand_init(reg = NEXT_VIRTUAL_REGISTER);
-        mul->ops[1] = air_insn_register_operand_init(scale_on_left ? syn->bexpr_lhs->expr_reg : syn->bexpr_rhs->expr_reg);
+        air_insn_t* mul = air_insn_init(AIR_MULTIPLY, 3);
+        mul->ct = air_type(ptrsize);
+        regid_t scaled = NEXT_VIRTUAL_REGISTER;
+        mul->ops[0] = air_insn_register_operand_init(scaled);
+        mul->ops[1] = air_insn_register_operand_init(reg);
         mul->ops[2] = air_insn_integer_constant_operand_init(size);
-    }
-    if (mul && scale_on_left)
-        ADD_CODE(mul);
-    COPY_CODE(syn->bexpr_rhs);
-    if (mul && !scale_on_left)
         ADD_CODE(mul);
+        reg = scaled;
+    }
+    type_delete(ptrsize);
     air_insn_t* insn = air_insn_init(type, 3);
-    insn->ct = type_copy(syn->ctype);
+    insn->ct = air_type(syn->ctype);
     insn->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
-    insn->ops[1] = air_insn_register_operand_init(scale_on_left ? reg : syn->bexpr_lhs->expr_reg);
-    insn->ops[2] = air_insn_register_operand_init(scale_on_left ? syn->bexpr_rhs->expr_reg : reg);
+    insn->ops[1] = air_insn_register_operand_init(scale_on_left ? reg : ptr->expr_reg);
+    insn->ops[2] = air_insn_register_operand_init(scale_on_left ? ptr->expr_reg : reg);
     ADD_CODE(insn);
     FINALIZE_LINEARIZE;
 }
@@ -2266,7 +2653,7 @@ static void linearize_addition_expression_after(syntax_traverser_t* trav, syntax
     lreg = convert(trav, syn->bexpr_lhs->ctype, syn->ctype, lreg, &code);
     rreg = convert(trav, syn->bexpr_rhs->ctype, syn->ctype, rreg, &code);
     air_insn_t* insn = air_insn_init(AIR_ADD, 3);
-    insn->ct = type_copy(syn->ctype);
+    insn->ct = air_type(syn->ctype);
     insn->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
     insn->ops[1] = air_insn_register_operand_init(lreg);
     insn->ops[2] = air_insn_register_operand_init(rreg);
@@ -2280,7 +2667,7 @@ static void linearize_ptrdiff_expression_after(syntax_traverser_t* trav, syntax_
     COPY_CODE(syn->bexpr_lhs);
     COPY_CODE(syn->bexpr_rhs);
     air_insn_t* insn = air_insn_init(AIR_SUBTRACT, 3);
-    insn->ct = make_basic_type(C_TYPE_PTRSIZE_T);
+    insn->ct = air_basic_type(C_TYPE_PTRSIZE_T);
     regid_t sub_reg = NEXT_VIRTUAL_REGISTER;
     insn->ops[0] = air_insn_register_operand_init(sub_reg);
     insn->ops[1] = air_insn_register_operand_init(syn->bexpr_lhs->expr_reg);
@@ -2288,7 +2675,7 @@ static void linearize_ptrdiff_expression_after(syntax_traverser_t* trav, syntax_
     ADD_CODE(insn);
     long long size = type_size(syn->bexpr_lhs->ctype->derived_from);
     air_insn_t* div = air_insn_init(AIR_DIVIDE, 3);
-    div->ct = make_basic_type(C_TYPE_PTRSIZE_T);
+    div->ct = air_basic_type(C_TYPE_PTRSIZE_T);
     div->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
     div->ops[1] = air_insn_register_operand_init(sub_reg);
     div->ops[2] = air_insn_integer_constant_operand_init(size);
@@ -2318,7 +2705,7 @@ static void linearize_subtraction_expression_after(syntax_traverser_t* trav, syn
     lreg = convert(trav, syn->bexpr_lhs->ctype, syn->ctype, lreg, &code);
     rreg = convert(trav, syn->bexpr_rhs->ctype, syn->ctype, rreg, &code);
     air_insn_t* insn = air_insn_init(AIR_SUBTRACT, 3);
-    insn->ct = type_copy(syn->ctype);
+    insn->ct = air_type(syn->ctype);
     insn->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
     insn->ops[1] = air_insn_register_operand_init(lreg);
     insn->ops[2] = air_insn_register_operand_init(rreg);
@@ -2340,7 +2727,7 @@ static void linearize_logical_expression_after(syntax_traverser_t* trav, syntax_
     ADD_SEQUENCE_POINT;
 
     air_insn_t* jzl = air_insn_init(or ? AIR_JNZ : AIR_JZ, 2);
-    jzl->ct = type_copy(syn->bexpr_lhs->ctype);
+    jzl->ct = air_type(syn->bexpr_lhs->ctype);
     jzl->ops[0] = air_insn_label_operand_init(first_label_no, 'E');
     jzl->ops[1] = air_insn_register_operand_init(syn->bexpr_lhs->expr_reg);
     ADD_CODE(jzl);
@@ -2348,14 +2735,14 @@ static void linearize_logical_expression_after(syntax_traverser_t* trav, syntax_
     COPY_CODE(syn->bexpr_rhs);
 
     air_insn_t* jzr = air_insn_init(or ? AIR_JNZ : AIR_JZ, 2);
-    jzr->ct = type_copy(syn->bexpr_rhs->ctype);
+    jzr->ct = air_type(syn->bexpr_rhs->ctype);
     jzr->ops[0] = air_insn_label_operand_init(first_label_no, 'E');
     jzr->ops[1] = air_insn_register_operand_init(syn->bexpr_rhs->expr_reg);
     ADD_CODE(jzr);
 
     regid_t lastreg = NEXT_VIRTUAL_REGISTER;
     air_insn_t* last = air_insn_init(AIR_LOAD, 2);
-    last->ct = make_basic_type(CTC_INT);
+    last->ct = air_basic_type(CTC_INT);
     last->ops[0] = air_insn_register_operand_init(lastreg);
     last->ops[1] = air_insn_integer_constant_operand_init(or ? 0 : 1);
     ADD_CODE(last);
@@ -2370,7 +2757,7 @@ static void linearize_logical_expression_after(syntax_traverser_t* trav, syntax_
 
     regid_t firstreg = NEXT_VIRTUAL_REGISTER;
     air_insn_t* first = air_insn_init(AIR_LOAD, 2);
-    first->ct = make_basic_type(CTC_INT);
+    first->ct = air_basic_type(CTC_INT);
     first->ops[0] = air_insn_register_operand_init(firstreg);
     first->ops[1] = air_insn_integer_constant_operand_init(or ? 1 : 0);
     ADD_CODE(first);
@@ -2380,7 +2767,7 @@ static void linearize_logical_expression_after(syntax_traverser_t* trav, syntax_
     ADD_CODE(pass_label);
 
     air_insn_t* phi = air_insn_init(AIR_PHI, 3);
-    phi->ct = make_basic_type(CTC_INT);
+    phi->ct = air_basic_type(CTC_INT);
     phi->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
     phi->ops[1] = air_insn_register_operand_init(lastreg);
     phi->ops[2] = air_insn_register_operand_init(firstreg);
@@ -2404,7 +2791,7 @@ static void linearize_conditional_expression_after(syntax_traverser_t* trav, syn
     regid_t elsereg = syn->cexpr_else->expr_reg;
 
     air_insn_t* jz = air_insn_init(AIR_JZ, 2);
-    jz->ct = type_copy(syn->cexpr_condition->ctype);
+    jz->ct = air_type(syn->cexpr_condition->ctype);
     jz->ops[0] = air_insn_label_operand_init(else_label_no, 'E');
     jz->ops[1] = air_insn_register_operand_init(syn->cexpr_condition->expr_reg);
     ADD_CODE(jz);
@@ -2428,7 +2815,7 @@ static void linearize_conditional_expression_after(syntax_traverser_t* trav, syn
     ADD_CODE(end_label);
 
     air_insn_t* phi = air_insn_init(AIR_PHI, 3);
-    phi->ct = type_copy(syn->ctype);
+    phi->ct = air_type(syn->ctype);
     phi->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
     phi->ops[1] = air_insn_register_operand_init(ifreg);
     phi->ops[2] = air_insn_register_operand_init(elsereg);
@@ -2476,7 +2863,7 @@ static void linearize_if_statement_after(syntax_traverser_t* trav, syntax_compon
     ADD_SEQUENCE_POINT;
 
     air_insn_t* jz = air_insn_init(AIR_JZ, 2);
-    jz->ct = type_copy(syn->ifstmt_condition->ctype);
+    jz->ct = air_type(syn->ifstmt_condition->ctype);
     jz->ops[0] = air_insn_label_operand_init(has_else ? else_label_no : end_label_no, 'S');
     jz->ops[1] = air_insn_register_operand_init(syn->ifstmt_condition->expr_reg);
     ADD_CODE(jz);
@@ -2503,57 +2890,242 @@ static void linearize_if_statement_after(syntax_traverser_t* trav, syntax_compon
     FINALIZE_LINEARIZE;
 }
 
-static void linearize_switch_statement_after(syntax_traverser_t* trav, syntax_component_t* syn)
+/*
+
+a switch dispatches to its cases in one of three ways, picked separately for each span of its cases once
+they're sorted by value:
+    - a jump table indexed by the condition's distance from the span's smallest case, if the span has at
+      least SWITCH_TABLE_MIN_CASES cases and they fill at least 1 of every SWITCH_TABLE_MAX_SPREAD values
+      from the smallest to the largest. conditions outside of the table and holes in it go to the default.
+    - a test for each case if there are SWITCH_LINEAR_MAX_CASES or fewer.
+    - otherwise, a test for the middle case and then a binary search of the cases on either side of it.
+
+so a dense switch costs a bounds check and an indirect jump, and a sparse one a logarithmic number of tests.
+
+*/
+
+#define SWITCH_TABLE_MIN_CASES 4
+#define SWITCH_TABLE_MAX_SPREAD 3
+#define SWITCH_LINEAR_MAX_CASES 3
+
+typedef struct switch_case
 {
-    SETUP_LINEARIZE;
+    uint64_t value; // extended to 64 bits the way the condition is
+    uint64_t key; // the value with the sign bit of signed ones flipped, so they all sort unsigned
+    syntax_component_t* lstmt;
+} switch_case_t;
 
-    COPY_CODE(syn->swstmt_condition);
-    ADD_SEQUENCE_POINT;
+typedef struct switch_lowering
+{
+    syntax_traverser_t* trav;
+    c_type_t* ct; // the promoted type of the condition
+    regid_t reg; // the condition
+    regid_t wide; // the condition converted to unsigned long long, for jump tables
+    switch_case_t* cases;
+    unsigned long long default_label_no;
+    char default_disambiguator;
+} switch_lowering_t;
 
-    c_type_t* pt = integer_promotions(syn->swstmt_condition->ctype);
+static int switch_case_comparator(const void* a, const void* b)
+{
+    uint64_t k1 = ((switch_case_t*) a)->key;
+    uint64_t k2 = ((switch_case_t*) b)->key;
+    return k1 < k2 ? -1 : k1 > k2;
+}
 
-    regid_t reg = convert(trav, syn->swstmt_condition->ctype, pt, syn->swstmt_condition->expr_reg, &code);
+static uint64_t switch_case_value(syntax_component_t* lstmt, c_type_t* ct)
+{
+    uint64_t value = lstmt->lstmt_value;
+    long long size = type_size(ct);
+    if (size >= UNSIGNED_LONG_LONG_INT_WIDTH)
+        return value;
+    uint64_t mask = (1ULL << (size * 8)) - 1;
+    value &= mask;
+    if (type_is_signed_integer(ct) && (value & (1ULL << (size * 8 - 1))))
+        value |= ~mask;
+    return value;
+}
 
-    VECTOR_FOR(syntax_component_t*, cstmt, syn->swstmt_cases)
+static void add_switch_default_jump(switch_lowering_t* sl, air_insn_t** c)
+{
+    air_insn_t* code = *c;
+    air_insn_t* jmp = air_insn_init(AIR_JMP, 1);
+    jmp->ops[0] = air_insn_label_operand_init(sl->default_label_no, sl->default_disambiguator);
+    ADD_CODE(jmp);
+    *c = code;
+}
+
+// jumps to the label if the register compares true against the constant
+static void add_switch_test(switch_lowering_t* sl, air_insn_type_t type, c_type_t* ct, regid_t reg, uint64_t value,
+    air_insn_operand_t* label, air_insn_t** c)
+{
+    syntax_traverser_t* trav = sl->trav;
+    air_insn_t* code = *c;
+
+    regid_t cvreg = NEXT_VIRTUAL_REGISTER;
+    air_insn_t* ld = air_insn_init(AIR_LOAD, 2);
+    ld->ct = air_type(ct);
+    ld->ops[0] = air_insn_register_operand_init(cvreg);
+    ld->ops[1] = air_insn_integer_constant_operand_init(value);
+    ADD_CODE(ld);
+
+    regid_t cmpreg = NEXT_VIRTUAL_REGISTER;
+    air_insn_t* cmp = air_insn_init(type, 3);
+    cmp->ct = air_basic_type(CTC_INT);
+    cmp->ops[0] = air_insn_register_operand_init(cmpreg);
+    cmp->ops[1] = air_insn_register_operand_init(reg);
+    cmp->ops[1]->ct = air_type(ct);
+    cmp->ops[2] = air_insn_register_operand_init(cvreg);
+    cmp->ops[2]->ct = air_type(ct);
+    ADD_CODE(cmp);
+
+    air_insn_t* jnz = air_insn_init(AIR_JNZ, 2);
+    jnz->ct = air_basic_type(CTC_INT);
+    jnz->ops[0] = label;
+    jnz->ops[1] = air_insn_register_operand_init(cmpreg);
+    ADD_CODE(jnz);
+
+    *c = code;
+}
+
+static void add_switch_case_test(switch_lowering_t* sl, switch_case_t* sc, air_insn_t** c)
+{
+    add_switch_test(sl, AIR_EQUAL, sl->ct, sl->reg, sc->value,
+        air_insn_label_operand_init(sc->lstmt->lstmt_uid, 'L'), c);
+}
+
+static void add_switch_jump_table(switch_lowering_t* sl, size_t lo, size_t hi, air_insn_t** c)
+{
+    syntax_traverser_t* trav = sl->trav;
+    air_insn_t* code = *c;
+
+    uint64_t range = sl->cases[hi - 1].key - sl->cases[lo].key;
+
+    regid_t index = sl->wide;
+    if (sl->cases[lo].value)
     {
-        regid_t cvreg = NEXT_VIRTUAL_REGISTER;
+        regid_t minreg = NEXT_VIRTUAL_REGISTER;
         air_insn_t* ld = air_insn_init(AIR_LOAD, 2);
-        ld->ct = type_copy(pt);
-        ld->ops[0] = air_insn_register_operand_init(cvreg);
-        ld->ops[1] = air_insn_integer_constant_operand_init(cstmt->lstmt_value);
+        ld->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+        ld->ops[0] = air_insn_register_operand_init(minreg);
+        ld->ops[1] = air_insn_integer_constant_operand_init(sl->cases[lo].value);
         ADD_CODE(ld);
 
-        regid_t eqreg = NEXT_VIRTUAL_REGISTER;
-        air_insn_t* eq = air_insn_init(AIR_EQUAL, 3);
-        eq->ct = make_basic_type(CTC_INT);
-        eq->ops[0] = air_insn_register_operand_init(eqreg);
-        eq->ops[1] = air_insn_register_operand_init(reg);
-        eq->ops[2] = air_insn_register_operand_init(cvreg);
-        ADD_CODE(eq);
+        index = NEXT_VIRTUAL_REGISTER;
+        air_insn_t* sub = air_insn_init(AIR_SUBTRACT, 3);
+        sub->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+        sub->ops[0] = air_insn_register_operand_init(index);
+        sub->ops[1] = air_insn_register_operand_init(sl->wide);
+        sub->ops[2] = air_insn_register_operand_init(minreg);
+        ADD_CODE(sub);
+    }
 
-        air_insn_t* jnz = air_insn_init(AIR_JNZ, 2);
-        jnz->ct = make_basic_type(CTC_INT);
-        jnz->ops[0] = air_insn_label_operand_init(cstmt->lstmt_uid, 'L');
-        jnz->ops[1] = air_insn_register_operand_init(eqreg);
-        ADD_CODE(jnz);
+    // conditions below the smallest case wrap around to above the table too
+    c_type_t* ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+    add_switch_test(sl, AIR_GREATER, ct, index, range,
+        air_insn_label_operand_init(sl->default_label_no, sl->default_disambiguator), &code);
+    type_delete(ct);
+
+    air_insn_t* table = air_insn_init(AIR_JMP_TABLE, range + 2);
+    table->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+    table->ops[0] = air_insn_register_operand_init(index);
+    for (size_t i = lo; i < hi; ++i)
+    {
+        switch_case_t* sc = &sl->cases[i];
+        uint64_t next = i + 1 < hi ? sl->cases[i + 1].key : sc->key + 1;
+        table->ops[sc->key - sl->cases[lo].key + 1] = air_insn_label_operand_init(sc->lstmt->lstmt_uid, 'L');
+        for (uint64_t k = sc->key + 1; k < next; ++k)
+            table->ops[k - sl->cases[lo].key + 1] = air_insn_label_operand_init(sl->default_label_no, sl->default_disambiguator);
     }
+    ADD_CODE(table);
 
-    uint64_t after_label_no = syn->break_label_no ? syn->break_label_no : 0;
+    *c = code;
+}
+
+static void add_switch_dispatch(switch_lowering_t* sl, size_t lo, size_t hi, air_insn_t** c)
+{
+    syntax_traverser_t* trav = sl->trav;
+    air_insn_t* code = *c;
 
-    if (syn->swstmt_default)
+    size_t count = hi - lo;
+    if (count >= SWITCH_TABLE_MIN_CASES && sl->cases[hi - 1].key - sl->cases[lo].key < count * SWITCH_TABLE_MAX_SPREAD)
     {
-        air_insn_t* jmp = air_insn_init(AIR_JMP, 1);
-        jmp->ops[0] = air_insn_label_operand_init(syn->swstmt_default->lstmt_uid, 'L');
-        ADD_CODE(jmp);
+        add_switch_jump_table(sl, lo, hi, &code);
+        *c = code;
+        return;
     }
-    else
+
+    if (count <= SWITCH_LINEAR_MAX_CASES)
     {
+        for (size_t i = lo; i < hi; ++i)
+            add_switch_case_test(sl, &sl->cases[i], &code);
+        add_switch_default_jump(sl, &code);
+        *c = code;
+        return;
+    }
+
+    size_t mid = lo + count / 2;
+    unsigned long long upper_label_no = NEXT_LABEL;
+    add_switch_case_test(sl, &sl->cases[mid], &code);
+    add_switch_test(sl, AIR_GREATER, sl->ct, sl->reg, sl->cases[mid].value,
+        air_insn_label_operand_init(upper_label_no, 'S'), &code);
+
+    add_switch_dispatch(sl, lo, mid, &code);
+
+    air_insn_t* label = air_insn_init(AIR_LABEL, 1);
+    label->ops[0] = air_insn_label_operand_init(upper_label_no, 'S');
+    ADD_CODE(label);
+
+    add_switch_dispatch(sl, mid + 1, hi, &code);
+
+    *c = code;
+}
+
+static void linearize_switch_statement_after(syntax_traverser_t* trav, syntax_component_t* syn)
+{
+    SETUP_LINEARIZE;
+
+    COPY_CODE(syn->swstmt_condition);
+    ADD_SEQUENCE_POINT;
+
+    c_type_t* pt = integer_promotions(syn->swstmt_condition->ctype);
+
+    regid_t reg = convert(trav, syn->swstmt_condition->ctype, pt, syn->swstmt_condition->expr_reg, &code);
+
+    uint64_t after_label_no = syn->break_label_no ? syn->break_label_no : 0;
+    if (!syn->swstmt_default)
         after_label_no = syn->break_label_no ? syn->break_label_no : NEXT_LABEL;
-        air_insn_t* jmp = air_insn_init(AIR_JMP, 1);
-        jmp->ops[0] = air_insn_label_operand_init(after_label_no, 'S');
-        ADD_CODE(jmp);
+
+    switch_lowering_t sl = {
+        .trav = trav,
+        .ct = pt,
+        .reg = reg,
+        .wide = reg,
+        .cases = calloc(syn->swstmt_cases->size, sizeof(switch_case_t)),
+        .default_label_no = syn->swstmt_default ? syn->swstmt_default->lstmt_uid : after_label_no,
+        .default_disambiguator = syn->swstmt_default ? 'L' : 'S'
+    };
+
+    VECTOR_FOR(syntax_component_t*, cstmt, syn->swstmt_cases)
+    {
+        switch_case_t* sc = &sl.cases[i];
+        sc->value = switch_case_value(cstmt, pt);
+        sc->key = type_is_signed_integer(pt) ? sc->value ^ (1ULL << 63) : sc->value;
+        sc->lstmt = cstmt;
     }
+    qsort(sl.cases, syn->swstmt_cases->size, sizeof(switch_case_t), switch_case_comparator);
 
+    // only jump tables use this, but it has to be made before the tests branch off
+    if (syn->swstmt_cases->size >= SWITCH_TABLE_MIN_CASES && type_size(pt) < UNSIGNED_LONG_LONG_INT_WIDTH)
+    {
+        c_type_t* wt = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+        sl.wide = convert(trav, pt, wt, reg, &code);
+        type_delete(wt);
+    }
+
+    add_switch_dispatch(&sl, 0, syn->swstmt_cases->size, &code);
+
+    free(sl.cases);
     type_delete(pt);
 
     COPY_CODE(syn->swstmt_body);
@@ -2644,7 +3216,7 @@ static void linearize_for_statement_after(syntax_traverser_t* trav, syntax_compo
     if (syn->forstmt_condition)
     {
         air_insn_t* jnz = air_insn_init(AIR_JNZ, 2);
-        jnz->ct = type_copy(syn->forstmt_condition->ctype);
+        jnz->ct = air_type(syn->forstmt_condition->ctype);
         jnz->ops[0] = air_insn_label_operand_init(body_label_no, 'S');
         jnz->ops[1] = air_insn_register_operand_init(syn->forstmt_condition->expr_reg);
         ADD_CODE(jnz);
@@ -2691,7 +3263,7 @@ static void linearize_while_statement_after(syntax_traverser_t* trav, syntax_com
     ADD_SEQUENCE_POINT;
 
     air_insn_t* jnz = air_insn_init(AIR_JNZ, 2);
-    jnz->ct = type_copy(syn->whstmt_condition->ctype);
+    jnz->ct = air_type(syn->whstmt_condition->ctype);
     jnz->ops[0] = air_insn_label_operand_init(body_label_no, 'S');
     jnz->ops[1] = air_insn_register_operand_init(syn->whstmt_condition->expr_reg);
     ADD_CODE(jnz);
@@ -2729,7 +3301,7 @@ static void linearize_do_while_statement_after(syntax_traverser_t* trav, syntax_
     ADD_SEQUENCE_POINT;
 
     air_insn_t* jnz = air_insn_init(AIR_JNZ, 2);
-    jnz->ct = type_copy(syn->dostmt_condition->ctype);
+    jnz->ct = air_type(syn->dostmt_condition->ctype);
     jnz->ops[0] = air_insn_label_operand_init(body_label_no, 'S');
     jnz->ops[1] = air_insn_register_operand_init(syn->dostmt_condition->expr_reg);
     ADD_CODE(jnz);
@@ -2756,7 +3328,7 @@ static void linearize_va_intrinsic_call_expression_after(syntax_traverser_t* tra
     COPY_CODE(arg_ap);
 
     air_insn_t* insn = air_insn_init(type, 2);
-    insn->ct = type_copy(syn->ctype);
+    insn->ct = air_type(syn->ctype);
     insn->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
     insn->ops[1] = air_insn_register_operand_init(arg_ap->expr_reg);
     ADD_CODE(insn);
@@ -2769,7 +3341,7 @@ static void linearize_lsyscall_intrinsic_call_expression_after(syntax_traverser_
     SETUP_LINEARIZE;
 
     air_insn_t* insn = air_insn_init(AIR_LSYSCALL, 2 + syn->icallexpr_args->size);
-    insn->ct = type_copy(syn->ctype);
+    insn->ct = air_type(syn->ctype);
     insn->ops[0] = air_insn_register_operand_init(syn->expr_reg = NEXT_VIRTUAL_REGISTER);
     insn->ops[1] = air_insn_integer_constant_operand_init(id);
     VECTOR_FOR(syntax_component_t*, arg, syn->icallexpr_args)
@@ -2796,6 +3368,12 @@ static void linearize_intrinsic_call_expression_after(syntax_traverser_t* trav,
         linearize_lsyscall_intrinsic_call_expression_after(trav, syn, 3);
     else if (streq(syn->icallexpr_name, "__ecc_lsys_read"))
         linearize_lsyscall_intrinsic_call_expression_after(trav, syn, 0);
+    else if (streq(syn->icallexpr_name, "__ecc_lsys_write"))
+        linearize_lsyscall_intrinsic_call_expression_after(trav, syn, 1);
+    else if (streq(syn->icallexpr_name, "__ecc_lsys_ioctl"))
+        linearize_lsyscall_intrinsic_call_expression_after(trav, syn, 16);
+    else if (streq(syn->icallexpr_name, "__ecc_lsys_mmap"))
+        linearize_lsyscall_intrinsic_call_expression_after(trav, syn, 9);
     else
         report_return;
 }
@@ -2838,12 +3416,6 @@ static void linearize_continue_statement_after(syntax_traverser_t* trav, syntax_
     FINALIZE_LINEARIZE;
 }
 
-static void linearize_no_action_after(syntax_traverser_t* trav, syntax_component_t* syn)
-{
-    // does nothing. for syntax elements which need not be linearized
-    // (assuredly, that's why the warning below is set up)
-}
-
 static void linearize_default_after(syntax_traverser_t* trav, syntax_component_t* syn)
 {
     warnf("no linearization procedure built for syntax elements of type %s\n", SYNTAX_COMPONENT_NAMES[syn->type]);
@@ -2854,10 +3426,15 @@ air_t* airinize(syntax_component_t* tlu)
     if (!tlu) return NULL;
     syntax_traverser_t* trav = traverse_init(tlu, sizeof(airinizing_syntax_traverser_t));
     air_t* air = AIRINIZING_TRAVERSER->air = calloc(1, sizeof(air_t));
+    air->arena = arena_init();
+    air->insns = vector_init();
+    air->operands = vector_init();
+    current_air = air;
     air->next_available_temporary = NO_PHYSICAL_REGISTERS + 1;
     AIRINIZING_TRAVERSER->next_label = 1;
     air->data = vector_init();
     air->rodata = vector_init();
+    air->profile = vector_init();
     air->routines = vector_init();
     air->st = tlu->tlu_st;
 
@@ -2866,8 +3443,8 @@ air_t* airinize(syntax_component_t* tlu)
     trav->after[SC_INIT_DECLARATOR] = linearize_init_declarator_after;
     trav->after[SC_ARRAY_DECLARATOR] = linearize_array_declarator_after;
     trav->after[SC_DECLARATOR] = linearize_declarator_after;
-    trav->after[SC_STRUCT_DECLARATOR] = linearize_no_action_after;
-    trav->after[SC_ABSTRACT_DECLARATOR] = linearize_no_action_after;
+    trav->after[SC_STRUCT_DECLARATOR] = traverse_no_action;
+    trav->after[SC_ABSTRACT_DECLARATOR] = traverse_no_action;
 
     trav->before[SC_FUNCTION_DEFINITION] = linearize_function_definition_before;
     trav->after[SC_FUNCTION_DEFINITION] = linearize_function_definition_after;
@@ -2943,24 +3520,25 @@ air_t* airinize(syntax_component_t* tlu)
     trav->after[SC_BREAK_STATEMENT] = linearize_break_statement_after;
     trav->after[SC_SWITCH_STATEMENT] = linearize_switch_statement_after;
 
-    trav->after[SC_TRANSLATION_UNIT] = linearize_no_action_after;
-    trav->after[SC_BASIC_TYPE_SPECIFIER] = linearize_no_action_after;
-    trav->after[SC_STORAGE_CLASS_SPECIFIER] = linearize_no_action_after;
-    trav->after[SC_TYPEDEF_NAME] = linearize_no_action_after;
-    trav->after[SC_PARAMETER_DECLARATION] = linearize_no_action_after;
-    trav->after[SC_STRUCT_UNION_SPECIFIER] = linearize_no_action_after;
-    trav->after[SC_STRUCT_DECLARATION] = linearize_no_action_after;
-    trav->after[SC_IDENTIFIER] = linearize_no_action_after;
-    trav->after[SC_DESIGNATION] = linearize_no_action_after;
-    trav->after[SC_POINTER] = linearize_no_action_after;
-    trav->after[SC_TYPE_QUALIFIER] = linearize_no_action_after;
-    trav->after[SC_FUNCTION_SPECIFIER] = linearize_no_action_after;
-    trav->after[SC_ABSTRACT_DECLARATOR] = linearize_no_action_after;
-    trav->after[SC_ABSTRACT_ARRAY_DECLARATOR] = linearize_no_action_after;
-    trav->after[SC_ABSTRACT_FUNCTION_DECLARATOR] = linearize_no_action_after;
-    trav->after[SC_ENUMERATOR] = linearize_no_action_after;
-    trav->after[SC_ENUMERATION_CONSTANT] = linearize_no_action_after;
-    trav->after[SC_ENUM_SPECIFIER] = linearize_no_action_after;
+    // nothing to linearize for these; subtrees made of only them are skipped entirely
+    trav->after[SC_TRANSLATION_UNIT] = traverse_no_action;
+    trav->after[SC_BASIC_TYPE_SPECIFIER] = traverse_no_action;
+    trav->after[SC_STORAGE_CLASS_SPECIFIER] = traverse_no_action;
+    trav->after[SC_TYPEDEF_NAME] = traverse_no_action;
+    trav->after[SC_PARAMETER_DECLARATION] = traverse_no_action;
+    trav->after[SC_STRUCT_UNION_SPECIFIER] = traverse_no_action;
+    trav->after[SC_STRUCT_DECLARATION] = traverse_no_action;
+    trav->after[SC_IDENTIFIER] = traverse_no_action;
+    trav->after[SC_DESIGNATION] = traverse_no_action;
+    trav->after[SC_POINTER] = traverse_no_action;
+    trav->after[SC_TYPE_QUALIFIER] = traverse_no_action;
+    trav->after[SC_FUNCTION_SPECIFIER] = traverse_no_action;
+    trav->after[SC_ABSTRACT_DECLARATOR] = traverse_no_action;
+    trav->after[SC_ABSTRACT_ARRAY_DECLARATOR] = traverse_no_action;
+    trav->after[SC_ABSTRACT_FUNCTION_DECLARATOR] = traverse_no_action;
+    trav->after[SC_ENUMERATOR] = traverse_no_action;
+    trav->after[SC_ENUMERATION_CONSTANT] = traverse_no_action;
+    trav->after[SC_ENUM_SPECIFIER] = traverse_no_action;
 
     trav->default_after = linearize_default_after;
 
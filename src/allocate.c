@@ -1,395 +1,1054 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <float.h>
 
 #include "ecc.h"
 
-typedef struct allocinfo
+/*
+
+linear-scan register allocation.
+
+every register gets a live interval: the sorted, disjoint ranges of positions where it holds a value that is read
+later, as found by the liveness analysis in liveness.c. an instruction at index i reads its operands at position 2i
+and writes its result at 2i + 1, so a result can share a register with an operand that dies in the same instruction.
+the physical registers localization pins values to get fixed intervals that no temporary may overlap while in the
+same register.
+
+temporaries are assigned in the order their intervals start. a temporary takes a register it is copied to or from if
+that one is free over its whole interval, and otherwise the first free register of its class. if none is free, the
+cheaper of two things is spilled: the temporary itself, or the temporaries occupying the register that is cheapest to
+take over. an interval's cost is how often it is read and written, weighted by loop depth, over how long it is.
+
+a spilled temporary lives in a stack slot. each definition is stored to the slot from a new temporary and each use
+reloads it into one, except that temporaries loaded from a constant or an address are recomputed at their uses
+instead. the new temporaries only live across a single instruction and are never spilled themselves. allocation is
+redone with them until nothing else has to be spilled. spilled temporaries whose intervals don't overlap share slots.
+
+calls clobber the caller-saved registers, so a temporary live across one can only get a callee-saved register, which
+the routine has to save and restore. the caller-saved ones come first, and a callee-saved register nothing has taken
+yet comes after the ones something has, since the first temporary to take one pays for its save. a temporary that
+costs less to spill than that, like a constant that can be loaded again where it's used, is spilled instead.
+
+the registers handed out are saved where the routine first needs them rather than on entry when that's somewhere
+every path to them runs through at most once, and every exit either always or never passes through it. that way the
+paths that return early, like argument checks, don't save anything:
+
+    f:
+        ...
+        jz .LS1
+        pushq %rbx
+        ...
+        popq %rbx
+        jmp .LR1
+    .LS1:
+        ...
+    .LR1:
+        leave
+        ret
+
+*/
+
+typedef struct interval
 {
-    vector_t* live_starts; // vector_t<uint64_t>
-    vector_t* live_ends; // vector_t<uint64_t>
-    vector_t* aliases; // vector_t<regid_t>
-} allocinfo_t;
+    regid_t reg;
+    c_type_t* ct; // type of the register's first definition
+    svector_t starts; // svector_t<uint64_t>, in order
+    svector_t ends; // svector_t<uint64_t>
+    svector_t hints; // svector_t<regid_t>, registers this one is copied to or from
+    double accesses; // how often it's read and written, weighted by loop depth
+    double weight; // the cost of spilling it
+    bool spillable;
+    regid_t assigned; // physical register, INVALID_VREGID until assigned or once spilled
+} interval_t;
 
 typedef struct allocator
 {
-    map_t* map; // map_t<regid_t, allocinfo_t>
-    map_t* aliases; // map_t<regid_t, regid_t>
-    map_t* replacements; // map_t<regid_t, regid_t>
+    air_routine_t* routine;
+    air_t* air;
+    air_defuse_t* du;
+    imap_t* intervals; // imap_t<regid_t, interval_t*>
+    vector_t* temporaries; // vector_t<interval_t*>, intervals of virtual registers
+    air_liveness_t* liveness;
+    vector_t* occupants[NO_PHYSICAL_REGISTERS + 1]; // vector_t<interval_t*>, temporaries assigned to each physical register
+    bitset_t* unspillable; // the registers spilling has made, shared by every round
+    vector_t* frequencies; // vector_t<uint64_t>, estimated execution count of each instruction by position
+    uint16_t nonvolatiles; // the callee-saved registers given to something so far
 } allocator_t;
 
-static int allocinfo_print(allocinfo_t* info, int (*printer)(const char*, ...))
+typedef struct spill
 {
-    int rv = printer("allocinfo { aliases: [");
-    for (size_t i = 0; i < info->aliases->size; ++i)
+    interval_t* iv;
+    symbol_t* slot; // NULL if rematerialized
+    air_insn_t* remat; // the definition to repeat at each use instead of loading from a slot
+} spill_t;
+
+static uint64_t interval_start(interval_t* iv)
+{
+    return iv->starts.size ? iv->starts.data[0] : 0;
+}
+
+static uint64_t interval_end(interval_t* iv)
+{
+    return iv->ends.size ? iv->ends.data[iv->ends.size - 1] : 0;
+}
+
+static int interval_print(interval_t* iv, int (*printer)(const char*, ...))
+{
+    int rv = printer("interval { ranges: [");
+    for (size_t i = 0; i < iv->starts.size; ++i)
     {
         if (i) rv += printer(", ");
-        rv += regid_print((regid_t) vector_get(info->aliases, i), printer);
+        rv += printer("%llu:%llu", iv->starts.data[i], iv->ends.data[i]);
     }
-    rv += printer("], live ranges: [");
-    for (size_t i = 0; i < info->live_starts->size; ++i)
+    rv += printer("], hints: [");
+    for (size_t i = 0; i < iv->hints.size; ++i)
     {
         if (i) rv += printer(", ");
-        rv += printer("%llu:%llu", (uint64_t) vector_get(info->live_starts, i), (uint64_t) vector_get(info->live_ends, i));
+        rv += regid_print(iv->hints.data[i], printer);
     }
-    rv += printer("] }");
+    rv += printer("], weight: %.3f%s, register: ", iv->weight, iv->spillable ? "" : " (unspillable)");
+    rv += regid_print(iv->assigned, printer);
+    rv += printer(" }");
     return rv;
 }
 
-void allocinfo_delete(allocinfo_t* info)
+static void interval_delete(interval_t* iv)
 {
-    if (!info) return;
-    vector_delete(info->aliases);
-    vector_delete(info->live_starts);
-    vector_delete(info->live_ends);
-    free(info);
+    if (!iv) return;
+    svector_free(&iv->starts);
+    svector_free(&iv->ends);
+    svector_free(&iv->hints);
+    free(iv);
 }
 
-void allocator_delete(allocator_t* a)
+static void allocator_delete(allocator_t* a)
 {
     if (!a) return;
-    map_delete(a->map);
-    map_delete(a->replacements);
+    IMAP_FOR(regid_t, interval_t*, a->intervals)
+    {
+        (void) k;
+        interval_delete(v);
+    }
+    imap_delete(a->intervals);
+    vector_delete(a->temporaries);
+    for (size_t i = 0; i <= NO_PHYSICAL_REGISTERS; ++i)
+        vector_delete(a->occupants[i]);
+    air_defuse_delete(a->du);
+    air_liveness_delete(a->liveness);
+    vector_delete(a->frequencies);
     free(a);
 }
 
-static air_insn_t* find_liveness_end(regid_t reg, air_insn_t* def, air_t* air, uint64_t* end_mark)
+static interval_t* get_interval(allocator_t* a, regid_t reg)
 {
-    if (!def) return NULL;
-    air_insn_t* last = def;
-    uint64_t e = *end_mark + 1;
-    for (air_insn_t* insn = def->next; insn; insn = insn->next, ++e)
+    interval_t* iv = (interval_t*) imap_get(a->intervals, reg);
+    if (iv) return iv;
+    iv = calloc(1, sizeof *iv);
+    iv->reg = reg;
+    iv->spillable = !bitset_has(a->unspillable, reg);
+    imap_add(a->intervals, reg, (uint64_t) iv);
+    if (reg > NO_PHYSICAL_REGISTERS)
     {
-        if (air_insn_creates_temporary(insn) && insn->ops[0]->content.reg == reg)
-            break;
-        if (insn->type == AIR_FUNC_CALL &&
-            air->locale == LOC_X86_64 &&
-            reg != X86R_RAX && reg != X86R_RBX && reg != X86R_RBP && (reg < X86R_R12 || reg > X86R_R15) &&
-            reg <= NO_PHYSICAL_REGISTERS)
-        {
-            last = insn;
-            *end_mark = e;
-            continue;
-        }
-        for (size_t i = 0; i < insn->noops; ++i)
+        air_insn_t* def = air_defuse_definition(a->du, reg);
+        iv->ct = def ? def->ct : NULL;
+        vector_add(a->temporaries, iv);
+    }
+    return iv;
+}
+
+// intervals are built backwards, so while they are their ranges are kept in reverse and each new one starts no later
+// than the ones before it
+static void add_range(interval_t* iv, uint64_t start, uint64_t end)
+{
+    size_t last = iv->starts.size;
+    if (last-- && end + 1 >= iv->starts.data[last])
+    {
+        if (start < iv->starts.data[last])
+            iv->starts.data[last] = start;
+        if (end > iv->ends.data[last])
+            iv->ends.data[last] = end;
+        return;
+    }
+    svector_add(&iv->starts, start);
+    svector_add(&iv->ends, end);
+}
+
+static void reverse_ranges(interval_t* iv)
+{
+    for (size_t i = 0, j = iv->starts.size; i + 1 < j; ++i, --j)
+    {
+        uint64_t start = iv->starts.data[i];
+        iv->starts.data[i] = iv->starts.data[j - 1];
+        iv->starts.data[j - 1] = start;
+        uint64_t end = iv->ends.data[i];
+        iv->ends.data[i] = iv->ends.data[j - 1];
+        iv->ends.data[j - 1] = end;
+    }
+}
+
+static bool intervals_overlap(interval_t* iv1, interval_t* iv2)
+{
+    if (!iv1 || !iv2 || !iv1->starts.size || !iv2->starts.size)
+        return false;
+    if (interval_end(iv1) < interval_start(iv2) || interval_end(iv2) < interval_start(iv1))
+        return false;
+    if (iv1->starts.size > iv2->starts.size)
+    {
+        interval_t* tmp = iv1;
+        iv1 = iv2;
+        iv2 = tmp;
+    }
+    // look up each range of the shorter interval in the longer one
+    for (size_t i = 0; i < iv1->starts.size; ++i)
+    {
+        uint64_t start = iv1->starts.data[i];
+        uint64_t end = iv1->ends.data[i];
+        size_t lo = 0, hi = iv2->ends.size;
+        while (lo < hi)
         {
-            air_insn_operand_t* op = insn->ops[i];
-            if (!op) continue;
-            if ((op->type == AOP_INDIRECT_REGISTER && (op->content.inreg.id == reg || op->content.inreg.roffset == reg)) ||
-                (op->type == AOP_REGISTER && op->content.reg == reg))
-            {
-                last = insn;
-                *end_mark = e;
-            }
+            size_t mid = lo + (hi - lo) / 2;
+            if (iv2->ends.data[mid] < start)
+                lo = mid + 1;
+            else
+                hi = mid;
         }
+        if (lo < iv2->starts.size && iv2->starts.data[lo] <= end)
+            return true;
     }
-    if (get_program_options()->iflag)
+    return false;
+}
+
+// counts each instruction as running ten times for every loop it's in
+static void find_frequencies(allocator_t* a)
+{
+    air_cfg_t* cfg = air_routine_cfg(a->routine);
+    size_t* depths = calloc(cfg->blocks->size, sizeof *depths);
+    VECTOR_FOR(air_loop_t*, loop, cfg->loops)
     {
-        printf("liveness ends for ");
-        regid_print(reg, printf);
-        printf(" at: ");
-        air_insn_print(last, air, printf);
-        printf("\n");
+        VECTOR_FOR(air_block_t*, block, loop->blocks)
+            ++depths[block->id];
+    }
+    for (air_insn_t* insn = a->routine->insns; insn; insn = insn->next)
+    {
+        air_block_t* block = map_get(cfg->insn_blocks, insn);
+        size_t depth = block ? min(depths[block->id], 4) : 0;
+        uint64_t frequency = 1;
+        for (size_t i = 0; i < depth; ++i)
+            frequency *= 10;
+        vector_add(a->frequencies, (void*) frequency);
     }
-    return last;
+    free(depths);
 }
 
-static void find_all_conflicts(air_routine_t* routine, allocator_t* a, air_t* air)
+static void add_hint(allocator_t* a, regid_t r1, regid_t r2)
 {
-    uint64_t i = 0;
-    for (air_insn_t* insn = routine->insns; insn; insn = insn->next, ++i)
+    if (r1 == INVALID_VREGID || r2 == INVALID_VREGID || r1 == r2)
+        return;
+    svector_add_if_new(&get_interval(a, r1)->hints, r2);
+    svector_add_if_new(&get_interval(a, r2)->hints, r1);
+}
+
+static void find_hints(allocator_t* a, air_insn_t* insn)
+{
+    if (insn->noops < 2 || !insn->ops[0] || !insn->ops[1] ||
+        insn->ops[0]->type != AOP_REGISTER || insn->ops[1]->type != AOP_REGISTER)
+        return;
+    switch (insn->type)
     {
-        if (!air_insn_creates_temporary(insn))
-            continue;
+        // copies can go away entirely if both sides share a register
+        case AIR_LOAD:
+        case AIR_ASSIGN:
+        // and x86 computes binary operators in the register of their first operand
+        case AIR_ADD:
+        case AIR_SUBTRACT:
+        case AIR_MULTIPLY:
+        case AIR_AND:
+        case AIR_XOR:
+        case AIR_OR:
+        case AIR_SHIFT_LEFT:
+        case AIR_SHIFT_RIGHT:
+        case AIR_SIGNED_SHIFT_RIGHT:
+            add_hint(a, insn->ops[0]->content.reg, insn->ops[1]->content.reg);
+            break;
+        default:
+            break;
+    }
+}
+
+static double sum_frequencies(allocator_t* a, vector_t* insns)
+{
+    double sum = 0;
+    if (!insns) return sum;
+    VECTOR_FOR(air_insn_t*, insn, insns)
+        sum += (uint64_t) vector_get(a->frequencies, air_defuse_position(a->du, insn));
+    return sum;
+}
 
-        if (insn->noops < 1 || insn->ops[0]->type != AOP_REGISTER) report_return;
+// whether a temporary's only definition can be repeated wherever it's used
+static air_insn_t* find_rematerialization(allocator_t* a, interval_t* iv)
+{
+    vector_t* defs = air_defuse_definitions(a->du, iv->reg);
+    if (!defs || defs->size != 1)
+        return NULL;
+    air_insn_t* def = vector_get(defs, 0);
+    if (!(def->type == AIR_LOAD && def->ops[1]->type == AOP_INTEGER_CONSTANT) &&
+        !(def->type == AIR_LOAD_ADDR && def->ops[1]->type == AOP_SYMBOL))
+        return NULL;
+    // not if anything changes it in place
+    vector_t* uses = air_defuse_uses(a->du, iv->reg);
+    if (uses)
+    {
+        VECTOR_FOR(air_insn_t*, use, uses)
+        {
+            if (!air_insn_creates_temporary(use) && air_insn_assigns(use) && use->noops &&
+                use->ops[0] && use->ops[0]->type == AOP_REGISTER && use->ops[0]->content.reg == iv->reg)
+                return NULL;
+        }
+    }
+    return def;
+}
 
-        regid_t reg = insn->ops[0]->content.reg;
+static void add_use_range(allocator_t* a, regid_t reg, uint64_t from, uint64_t position)
+{
+    if (reg != INVALID_VREGID)
+        add_range(get_interval(a, reg), from, position << 1);
+}
 
-        if (reg == INVALID_VREGID) continue;
+// a register's interval covers each block it's live out of, and the part of each other block from its definition or
+// the start of the block to its last use there. going backwards through a block, what's live at an instruction comes
+// from the liveness analysis stepped back from the end of the block
+static void find_intervals(allocator_t* a)
+{
+    air_liveness_t* l = a->liveness;
+    air_cfg_t* cfg = air_routine_cfg(a->routine);
+    for (size_t j = cfg->blocks->size; j > 0; --j)
+    {
+        air_block_t* block = vector_get(cfg->blocks, j - 1);
+        uint64_t from = (uint64_t) air_defuse_position(a->du, block->first) << 1;
+        uint64_t to = ((uint64_t) air_defuse_position(a->du, block->last) << 1) + 1;
 
-        allocinfo_t* info = map_get(a->map, (void*) reg);
+        unsigned long long* live = air_liveness_out_set(l, block);
+        for (size_t w = 0; w < l->words; ++w)
+        {
+            for (size_t b = 0; b < 64 && live[w] >> b; ++b)
+            {
+                if ((live[w] >> b) & 1)
+                    add_range(get_interval(a, (regid_t) vector_get(l->registers, w * 64 + b)), from, to);
+            }
+        }
 
-        if (!info)
+        for (air_insn_t* insn = block->last; insn; insn = insn == block->first ? NULL : insn->prev)
         {
-            info = calloc(1, sizeof *info);
-            info->aliases = vector_init();
-            info->live_starts = vector_init();
-            info->live_ends = vector_init();
-            vector_add(info->aliases, (void*) reg);
-            map_add(a->map, (void*) reg, info);
+            uint64_t position = air_defuse_position(a->du, insn);
+            find_hints(a, insn);
+
+            regid_t def = air_liveness_definition(insn);
+            if (def != INVALID_VREGID)
+            {
+                // a definition starts the range it's live in, and a dead one still needs its register for a moment
+                interval_t* iv = get_interval(a, def);
+                if (air_liveness_set_has(l, live, def))
+                    iv->starts.data[iv->starts.size - 1] = (position << 1) + 1;
+                else
+                    add_range(iv, (position << 1) + 1, (position << 1) + 1);
+            }
+
+            for (size_t i = def != INVALID_VREGID ? 1 : 0; i < insn->noops; ++i)
+            {
+                air_insn_operand_t* op = insn->ops[i];
+                if (!op) continue;
+                if (op->type == AOP_REGISTER)
+                    add_use_range(a, op->content.reg, from, position);
+                else if (op->type == AOP_INDIRECT_REGISTER)
+                {
+                    add_use_range(a, op->content.inreg.id, from, position);
+                    add_use_range(a, op->content.inreg.roffset, from, position);
+                }
+            }
+            svector_t* implicit = air_liveness_implicit_uses(l, insn);
+            if (implicit)
+            {
+                for (unsigned i = 0; i < implicit->size; ++i)
+                    add_use_range(a, implicit->data[i], from, position);
+            }
+
+            air_liveness_step(l, insn, live);
         }
-        
-        uint64_t end_mark = i;
-        if (insn->type != AIR_BLIP)
-            find_liveness_end(reg, insn, air, &end_mark);
+        free(live);
+    }
 
-        uint64_t start_mark = i + 1;
+    IMAP_FOR(regid_t, interval_t*, a->intervals)
+    {
+        (void) k;
+        reverse_ranges(v);
+    }
 
-        // if (start_mark > end_mark && reg > NO_PHYSICAL_REGISTERS)
-        // {
-        //     map_remove(a->map, (void*) reg);
-        //     insn = air_insn_remove(insn);
-        //     continue;
-        // }
+    VECTOR_FOR(interval_t*, iv, a->temporaries)
+    {
+        uint64_t length = 0;
+        for (size_t j = 0; j < iv->starts.size; ++j)
+            length += iv->ends.data[j] - iv->starts.data[j] + 1;
+        double accesses = sum_frequencies(a, air_defuse_definitions(a->du, iv->reg)) +
+            sum_frequencies(a, air_defuse_uses(a->du, iv->reg));
+        // recomputing a constant is cheaper than a reload
+        if (find_rematerialization(a, iv))
+            accesses /= 2;
+        iv->accesses = accesses;
+        iv->weight = accesses / length;
+    }
+}
 
-        vector_add(info->live_starts, (void*) start_mark);
-        vector_add(info->live_ends, (void*) end_mark);
+// %rbp comes last, and only when the routine doesn't need it for its frame
+static const regid_t* candidate_registers_x86_64(air_routine_t* routine, c_type_t* ct, size_t* count)
+{
+    static const regid_t integer_registers[] = {
+        X86R_RAX, X86R_RDI, X86R_RSI, X86R_RDX, X86R_RCX, X86R_R8, X86R_R9, X86R_R10, X86R_R11,
+        X86R_RBX, X86R_R12, X86R_R13, X86R_R14, X86R_R15, X86R_RBP
+    };
+    static const regid_t sse_registers[] = {
+        X86R_XMM0, X86R_XMM1, X86R_XMM2, X86R_XMM3, X86R_XMM4, X86R_XMM5, X86R_XMM6, X86R_XMM7
+    };
+    if (type_is_integer(ct) || ct->class == CTC_POINTER)
+    {
+        *count = sizeof(integer_registers) / sizeof(integer_registers[0]) - !routine->omits_frame_pointer;
+        return integer_registers;
     }
+    if (type_is_real_floating(ct) || type_is_vector(ct))
+    {
+        *count = sizeof(sse_registers) / sizeof(sse_registers[0]);
+        return sse_registers;
+    }
+    *count = 0;
+    return NULL;
 }
 
-static bool live_range_conflicts(allocator_t* a, regid_t r1, regid_t r2)
+// the push on the way in and the pop on the way out
+#define NONVOLATILE_SAVE_COST 2.0
+
+static uint16_t nonvolatile_flag(regid_t reg)
 {
-    allocinfo_t* info1 = map_get(a->map, (void*) r1);
-    allocinfo_t* info2 = map_get(a->map, (void*) r2);
-    if (!info1 || !info2)
-        return false;
-    for (int i = 0; i < info1->live_starts->size; ++i)
+    switch (reg)
     {
-        uint64_t start1 = (uint64_t) vector_get(info1->live_starts, i);
-        uint64_t end1 = (uint64_t) vector_get(info1->live_ends, i);
-        for (int j = 0; j < info2->live_starts->size; ++j)
-        {
-            uint64_t start2 = (uint64_t) vector_get(info2->live_starts, j);
-            uint64_t end2 = (uint64_t) vector_get(info2->live_ends, j);
+        case X86R_RBX: return USED_NONVOLATILES_RBX;
+        case X86R_R12: return USED_NONVOLATILES_R12;
+        case X86R_R13: return USED_NONVOLATILES_R13;
+        case X86R_R14: return USED_NONVOLATILES_R14;
+        case X86R_R15: return USED_NONVOLATILES_R15;
+        case X86R_RBP: return USED_NONVOLATILES_RBP;
+        default: return 0;
+    }
+}
 
-            if (end1 + 1 == start1 && end2 + 1 == start2 && start1 == start2)
-                return true;
+static vector_t* get_occupants(allocator_t* a, regid_t reg)
+{
+    if (!a->occupants[reg])
+        a->occupants[reg] = vector_init();
+    return a->occupants[reg];
+}
 
-            if (end1 + 1 == start1 && start2 <= end1 && end1 <= end2)
-                return true;
-            
-            if (end2 + 1 == start2 && start1 <= end2 && end2 <= end1)
-                return true;
+// drops the temporaries in a register that end before the given position, they can't overlap anything after it
+static vector_t* expire_occupants(allocator_t* a, regid_t reg, uint64_t position)
+{
+    vector_t* v = get_occupants(a, reg);
+    size_t kept = 0;
+    for (size_t i = 0; i < v->size; ++i)
+    {
+        interval_t* occupant = vector_get(v, i);
+        if (interval_end(occupant) >= position)
+            v->data[kept++] = occupant;
+    }
+    v->size = kept;
+    return v;
+}
 
-            if (max(start1, start2) <= min(end1, end2))
-                return true;
-        }
+static bool register_free(allocator_t* a, regid_t reg, interval_t* iv)
+{
+    if (intervals_overlap((interval_t*) imap_get(a->intervals, reg), iv))
+        return false;
+    VECTOR_FOR(interval_t*, occupant, expire_occupants(a, reg, interval_start(iv)))
+    {
+        if (intervals_overlap(occupant, iv))
+            return false;
     }
+    return true;
+}
+
+static bool candidate_register(regid_t reg, const regid_t* candidates, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        if (candidates[i] == reg)
+            return true;
     return false;
 }
 
-static void coalesce(air_routine_t* routine, allocator_t* a, air_t* air)
+static void assign(allocator_t* a, interval_t* iv, regid_t reg)
 {
-    MAP_FOR(regid_t, allocinfo_t*, a->map)
+    iv->assigned = reg;
+    a->nonvolatiles |= nonvolatile_flag(reg);
+    vector_add(get_occupants(a, reg), iv);
+}
+
+// finds a register for a temporary, adding whatever had to be spilled to make room to the given vector
+static bool allocate_interval(allocator_t* a, interval_t* iv, vector_t* spilled)
+{
+    size_t count = 0;
+    const regid_t* candidates = candidate_registers_x86_64(a->routine, iv->ct, &count);
+
+    for (size_t i = 0; i < iv->hints.size; ++i)
     {
-        if (MAP_IS_BAD_KEY) continue;
-        regid_t ok = k;
-        allocinfo_t* ov = v;
-        MAP_FOR(regid_t, allocinfo_t*, a->map)
+        regid_t hint = iv->hints.data[i];
+        regid_t reg = hint;
+        if (hint > NO_PHYSICAL_REGISTERS)
         {
-            if (MAP_IS_BAD_KEY) continue;
+            interval_t* other = (interval_t*) imap_get(a->intervals, hint);
+            reg = other ? other->assigned : INVALID_VREGID;
+        }
+        if (candidate_register(reg, candidates, count) && register_free(a, reg, iv))
+        {
+            assign(a, iv, reg);
+            return true;
+        }
+    }
 
-            // ignore if it's the same register, we're not coalescing the register and itself
-            if (ok == k) continue;
+    regid_t unsaved = INVALID_VREGID;
+    for (size_t i = 0; i < count; ++i)
+    {
+        regid_t reg = candidates[i];
+        if (!register_free(a, reg, iv))
+            continue;
+        uint16_t flag = nonvolatile_flag(reg);
+        if (!flag || (a->nonvolatiles & flag))
+        {
+            assign(a, iv, reg);
+            return true;
+        }
+        if (unsaved == INVALID_VREGID)
+            unsaved = reg;
+    }
 
-            // cannot coalesce two physical registers
-            if (ok <= NO_PHYSICAL_REGISTERS && k <= NO_PHYSICAL_REGISTERS) continue;
+    if (unsaved != INVALID_VREGID)
+    {
+        if (iv->spillable && iv->accesses < NONVOLATILE_SAVE_COST)
+            vector_add(spilled, iv);
+        else
+            assign(a, iv, unsaved);
+        return true;
+    }
 
-            // if this register has the register we're merging as a conflict, skip it
-            if (live_range_conflicts(a, k, ok))
+    // nothing's free, so find the register whose temporaries are cheapest to spill instead
+    regid_t best = INVALID_VREGID;
+    double best_cost = iv->spillable ? iv->weight : DBL_MAX;
+    for (size_t i = 0; i < count; ++i)
+    {
+        regid_t reg = candidates[i];
+        if (intervals_overlap((interval_t*) imap_get(a->intervals, reg), iv))
+            continue;
+        double cost = 0;
+        VECTOR_FOR(interval_t*, occupant, get_occupants(a, reg))
+        {
+            if (!intervals_overlap(occupant, iv))
                 continue;
-            
-            // if any of this register's aliases has the register we're merging as a conflict, skip it
-            // if any of this register's aliases is a physical register and the register we're merging is one too, we cannot coalesce
-            bool found_conflict = false;
-            VECTOR_FOR(regid_t, alias, ov->aliases)
+            if (!occupant->spillable)
             {
-                if (alias <= NO_PHYSICAL_REGISTERS && k <= NO_PHYSICAL_REGISTERS)
-                {
-                    found_conflict = true;
-                    break;
-                }
-                if (live_range_conflicts(a, k, alias))
-                {
-                    found_conflict = true;
-                    break;
-                }
+                cost = DBL_MAX;
+                break;
             }
-            if (found_conflict)
-                continue;
-            
-            air_insn_t* odef = air_insn_find_temporary_definition(ok, routine);
-            air_insn_t* def = air_insn_find_temporary_definition(k, routine);
-            if (!odef || !def) report_return;
-            c_type_t* oct = odef->ct;
-            c_type_t* ct = def->ct;
-            if (air->locale == LOC_X86_64 && !x86_64_c_type_registers_compatible(oct, ct))
-                continue;
+            cost += occupant->weight;
+        }
+        if (cost < best_cost)
+        {
+            best = reg;
+            best_cost = cost;
+        }
+    }
 
-            // merge conflicts and add each other as aliases
-            vector_add_if_new(ov->aliases, (void*) k, (comparator_t) regid_comparator);
-            vector_concat(ov->live_starts, v->live_starts);
-            vector_concat(ov->live_ends, v->live_ends);
+    if (best == INVALID_VREGID)
+    {
+        if (!iv->spillable)
+            return false;
+        vector_add(spilled, iv);
+        return true;
+    }
 
-            map_remove(a->map, (void*) k);
-            map_add(a->aliases, (void*) k, (void*) ok);
+    vector_t* occupants = get_occupants(a, best);
+    size_t kept = 0;
+    for (size_t i = 0; i < occupants->size; ++i)
+    {
+        interval_t* occupant = vector_get(occupants, i);
+        if (intervals_overlap(occupant, iv))
+        {
+            occupant->assigned = INVALID_VREGID;
+            vector_add(spilled, occupant);
         }
+        else
+            occupants->data[kept++] = occupant;
     }
+    occupants->size = kept;
+    assign(a, iv, best);
+    return true;
 }
 
-static regid_t find_replacement_x86_64(regid_t reg, air_insn_t* insn, allocator_t* a, regid_t* nextintreg, regid_t* nextssereg)
+static int interval_start_comparator(interval_t** iv1, interval_t** iv2)
 {
-    // get allocation info and its replacement, if any
-    for (regid_t actual = INVALID_VREGID;
-        (actual = (regid_t) map_get(a->aliases, (void*) reg)) != INVALID_VREGID;
-        reg = actual);
-    allocinfo_t* info = map_get(a->map, (void*) reg);
-    regid_t repl = (regid_t) map_get(a->replacements, (void*) reg);
+    uint64_t s1 = interval_start(*iv1), s2 = interval_start(*iv2);
+    if (s1 != s2) return s1 < s2 ? -1 : 1;
+    return regid_comparator((*iv1)->reg, (*iv2)->reg);
+}
 
-    // if there's no replacement
-    if (repl == INVALID_VREGID)
+static bool scan(allocator_t* a, vector_t* spilled)
+{
+    vector_t* order = vector_init();
+    VECTOR_FOR(interval_t*, temp, a->temporaries)
     {
-        // search the aliases for a physical register
-        VECTOR_FOR(regid_t, alias, info->aliases)
+        // void temporaries don't hold anything
+        if (temp->ct && temp->ct->class != CTC_VOID)
+            vector_add(order, temp);
+    }
+    qsort(order->data, order->size, sizeof(void*), (int (*)(const void*, const void*)) interval_start_comparator);
+
+    bool ok = true;
+    VECTOR_FOR(interval_t*, iv, order)
+    {
+        size_t count = 0;
+        candidate_registers_x86_64(a->routine, iv->ct, &count);
+        if (!count)
         {
-            if (alias <= NO_PHYSICAL_REGISTERS)
-            {
-                repl = alias;
-                break;
-            }
-            repl = (regid_t) map_get(a->replacements, (void*) alias);
-            if (repl != INVALID_VREGID)
-                break;
+            printf("for the following assertion: unexpected type: ");
+            type_humanized_print(iv->ct, printf);
+            printf("\n");
+            ok = false;
+            break;
+        }
+        if (!allocate_interval(a, iv, spilled))
+        {
+            printf("for the following assertion: no register left for ");
+            regid_print(iv->reg, printf);
+            printf("\n");
+            ok = false;
+            break;
         }
+    }
+    vector_delete(order);
+    return ok;
+}
+
+static symbol_t* make_spill_slot(allocator_t* a, c_type_t* ct)
+{
+    pool_lock();
+    symbol_t* sy = symbol_table_add(a->air->st, "__anonymous_lv__", symbol_init(NULL));
+    pool_unlock();
+    sy->type = type_copy(ct);
+    sy->sd = SD_AUTOMATIC;
+
+    air_insn_t* decl = air_insn_init(AIR_DECLARE, 1);
+    decl->ops[0] = air_insn_symbol_operand_init(sy);
+    air_insn_insert_after(decl, a->routine->insns);
+    return sy;
+}
+
+// gives the spilled temporaries slots, sharing one between temporaries of the same size that are never live together
+static imap_t* find_spill_slots(allocator_t* a, vector_t* spilled)
+{
+    imap_t* spills = imap_init();
+
+    qsort(spilled->data, spilled->size, sizeof(void*), (int (*)(const void*, const void*)) interval_start_comparator);
 
-        // if there isn't a physical register in the aliases
-        if (repl == INVALID_VREGID)
+    vector_t* slots = vector_init(); // vector_t<symbol_t*>
+    vector_t* slot_ends = vector_init(); // vector_t<uint64_t>, where the last temporary in each slot ends
+    VECTOR_FOR(interval_t*, iv, spilled)
+    {
+        spill_t* s = calloc(1, sizeof *s);
+        s->iv = iv;
+        imap_add(spills, iv->reg, (uint64_t) s);
+        if ((s->remat = find_rematerialization(a, iv)))
+            continue;
+        for (size_t j = 0; j < slots->size && !s->slot; ++j)
         {
-            // go to the definition of the temporary
-            air_insn_t* def = air_insn_find_temporary_definition_from_insn(reg, insn);
-            if (!def)
+            symbol_t* slot = vector_get(slots, j);
+            if ((uint64_t) vector_get(slot_ends, j) < interval_start(iv) && type_size(slot->type) == type_size(iv->ct))
             {
-                printf("no definition found for the following register: ");
-                regid_print(reg, printf);
-                printf("\n");
-                report_return_value(INVALID_VREGID);
+                s->slot = slot;
+                slot_ends->data[j] = (void*) interval_end(iv);
             }
-            // and examine its type
+        }
+        if (!s->slot)
+        {
+            vector_add(slots, s->slot = make_spill_slot(a, iv->ct));
+            vector_add(slot_ends, (void*) interval_end(iv));
+        }
+    }
+    vector_delete(slots);
+    vector_delete(slot_ends);
+    return spills;
+}
 
-            // if it's an integer/pointer type, take next integer register available (skipping ones that were part of the allocation process)
-            if (type_is_integer(def->ct) || def->ct->class == CTC_POINTER)
+static regid_t make_spill_temporary(allocator_t* a)
+{
+    regid_t reg = air_next_register(a->air);
+    bitset_add(a->unspillable, reg);
+    return reg;
+}
+
+static regid_t reload(allocator_t* a, spill_t* s, air_insn_t* insn)
+{
+    regid_t reg = make_spill_temporary(a);
+    air_insn_t* ld = NULL;
+    if (s->remat)
+    {
+        ld = air_insn_copy(s->remat);
+        ld->ops[0]->content.reg = reg;
+    }
+    else
+    {
+        ld = air_insn_init(AIR_LOAD, 2);
+        ld->ct = type_copy(s->iv->ct);
+        ld->ops[0] = air_insn_register_operand_init(reg);
+        ld->ops[1] = air_insn_symbol_operand_init(s->slot);
+    }
+    air_insn_insert_before(ld, insn);
+    return reg;
+}
+
+static void store(allocator_t* a, spill_t* s, regid_t reg, air_insn_t* insn)
+{
+    air_insn_t* st = air_insn_init(AIR_ASSIGN, 2);
+    st->ct = type_copy(s->iv->ct);
+    st->ops[0] = air_insn_symbol_operand_init(s->slot);
+    st->ops[1] = air_insn_register_operand_init(reg);
+    air_insn_insert_after(st, insn);
+}
+
+// replaces a spilled register read by an instruction with one reloaded just before it, once per instruction
+static regid_t respill_use(allocator_t* a, imap_t* spills, imap_t* reloaded, regid_t reg, air_insn_t* insn)
+{
+    spill_t* s = (spill_t*) imap_get(spills, reg);
+    if (!s) return reg;
+    regid_t repl = imap_get(reloaded, reg);
+    if (repl == INVALID_VREGID)
+        imap_add(reloaded, reg, repl = reload(a, s, insn));
+    return repl;
+}
+
+static void spill_registers(allocator_t* a, vector_t* spilled)
+{
+    imap_t* spills = find_spill_slots(a, spilled);
+    imap_t* reloaded = imap_init();
+    vector_t* remats = vector_init();
+
+    for (air_insn_t* insn = a->routine->insns; insn;)
+    {
+        air_insn_t* next = insn->next;
+        bool defines = air_insn_creates_temporary(insn) && insn->noops && insn->ops[0] &&
+            insn->ops[0]->type == AOP_REGISTER;
+        bool modifies = !air_insn_creates_temporary(insn) && air_insn_assigns(insn) && insn->noops &&
+            insn->ops[0] && insn->ops[0]->type == AOP_REGISTER;
+
+        spill_t* def = defines ? (spill_t*) imap_get(spills, insn->ops[0]->content.reg) : NULL;
+        if (def && def->remat)
+        {
+            // recomputed at every use instead, so it goes once they've all been copied from it
+            vector_add(remats, insn);
+            insn = next;
+            continue;
+        }
+
+        for (size_t i = 0; i < insn->noops; ++i)
+        {
+            air_insn_operand_t* op = insn->ops[i];
+            if (!op) continue;
+            if (i == 0 && def)
             {
-                for (; (*nextintreg <= X86R_R15 && map_contains_key(a->map, (void*) (*nextintreg))) || *nextintreg == X86R_RBP; ++(*nextintreg));
-                if (*nextintreg > X86R_R15) report_return_value(INVALID_VREGID);
-                map_add(a->replacements, (void*) reg, (void*) (repl = (*nextintreg)++));
+                regid_t reg = make_spill_temporary(a);
+                op->content.reg = reg;
+                store(a, def, reg, insn);
+                continue;
             }
-            // if it's a floating type, take next SSE register available (skipping in the same manner as above)
-            else if (type_is_real_floating(def->ct))
+            if (op->type == AOP_REGISTER)
             {
-                for (; *nextssereg <= X86R_XMM7 && map_contains_key(a->map, (void*) (*nextssereg)); ++(*nextssereg));
-                if (*nextssereg > X86R_XMM7) report_return_value(INVALID_VREGID);
-                map_add(a->replacements, (void*) reg, (void*) (repl = (*nextssereg)++));
+                regid_t orig = op->content.reg;
+                op->content.reg = respill_use(a, spills, reloaded, orig, insn);
+                // it's written back if the instruction changes it
+                spill_t* s = modifies && i == 0 ? (spill_t*) imap_get(spills, orig) : NULL;
+                if (s && !s->remat)
+                    store(a, s, op->content.reg, insn);
             }
-            else if (def->ct->class == CTC_VOID)
-                return INVALID_VREGID;
-            // TODO: complex numbas and maybe other?
-            else
+            else if (op->type == AOP_INDIRECT_REGISTER)
             {
-                printf("for the following assertion: unexpected type: ");
-                type_humanized_print(def->ct, printf);
-                printf("\n");
-                report_return_value(INVALID_VREGID);
+                op->content.inreg.id = respill_use(a, spills, reloaded, op->content.inreg.id, insn);
+                op->content.inreg.roffset = respill_use(a, spills, reloaded, op->content.inreg.roffset, insn);
             }
         }
-        // if there is
-        else
-            // use that
-            map_add(a->replacements, (void*) reg, (void*) repl);
+
+        imap_clear(reloaded);
+        insn = next;
     }
 
-    return repl;
+    VECTOR_FOR(air_insn_t*, remat, remats)
+        air_insn_remove(remat);
+
+    vector_delete(remats);
+    imap_delete(reloaded);
+    IMAP_FOR(regid_t, spill_t*, spills)
+    {
+        (void) k;
+        free(v);
+    }
+    imap_delete(spills);
 }
 
-static void replace_registers_x86_64(air_routine_t* routine, allocator_t* a, air_t* air)
+static regid_t find_replacement(allocator_t* a, regid_t reg)
 {
-    regid_t nextintreg = X86R_RAX;
-    regid_t nextssereg = X86R_XMM0;
+    if (reg == INVALID_VREGID || reg <= NO_PHYSICAL_REGISTERS)
+        return reg;
+    interval_t* iv = (interval_t*) imap_get(a->intervals, reg);
+    if (!iv || !iv->ct)
+    {
+        printf("no definition found for the following register: ");
+        regid_print(reg, printf);
+        printf("\n");
+        report_return_value(INVALID_VREGID);
+    }
+    return iv->assigned;
+}
 
-    // go thru each instruction and replace of all its temps with physical registers
-    for (air_insn_t* insn = routine->insns; insn; insn = insn->next)
+static void replace_registers(allocator_t* a)
+{
+    // go thru each instruction and replace all of its temps with physical registers
+    for (air_insn_t* insn = a->routine->insns; insn; insn = insn->next)
     {
         for (size_t i = 0; i < insn->noops; ++i)
         {
             air_insn_operand_t* op = insn->ops[i];
             if (!op) continue;
-
-            // get the register associated with this operand, if any
-            regid_t reg = INVALID_VREGID;
             if (op->type == AOP_REGISTER)
-                reg = op->content.reg;
+                op->content.reg = find_replacement(a, op->content.reg);
             else if (op->type == AOP_INDIRECT_REGISTER)
-                reg = op->content.inreg.id;
-            
-            regid_t roffset = INVALID_VREGID;
-            if (op->type == AOP_INDIRECT_REGISTER)
-                roffset = op->content.inreg.roffset;
-            
-            // if the register's not physical, replace it
-            if (reg != INVALID_VREGID && reg > NO_PHYSICAL_REGISTERS)
-                reg = find_replacement_x86_64(reg, insn, a, &nextintreg, &nextssereg);
-            
-            // then replacement the temporary with the physical register
-            if (op->type == AOP_REGISTER)
-                op->content.reg = reg;
-            else if (op->type == AOP_INDIRECT_REGISTER)
-                op->content.inreg.id = reg;
-
-            // if the offset register is not physical, replace it
-            if (roffset != INVALID_VREGID && roffset > NO_PHYSICAL_REGISTERS)
-                op->content.inreg.roffset = find_replacement_x86_64(roffset, insn, a, &nextintreg, &nextssereg);
+            {
+                op->content.inreg.id = find_replacement(a, op->content.inreg.id);
+                op->content.inreg.roffset = find_replacement(a, op->content.inreg.roffset);
+            }
         }
     }
 }
 
-static void replace_registers(air_routine_t* routine, allocator_t* a, air_t* air)
+static void print_intervals(allocator_t* a)
 {
-    switch (air->locale)
+    printf("[map] (%zu)\n", a->intervals->size);
+    IMAP_FOR(regid_t, interval_t*, a->intervals)
     {
-        case LOC_X86_64: replace_registers_x86_64(routine, a, air); break;
-        default: report_return;
+        printf("    ");
+        regid_print(k, printf);
+        printf(": ");
+        interval_print(v, printf);
+        printf("\n");
     }
 }
 
-static void allocate_routine(air_routine_t* routine, air_t* air)
+// runs one round of allocation, returning whether it had to spill and needs another
+static bool allocate_round(air_routine_t* routine, air_t* air, bitset_t* unspillable)
 {
-    if (!routine) return;
+    air_routine_invalidate_cfg(routine);
 
     allocator_t* a = calloc(1, sizeof *a);
-    a->map = map_init((comparator_t) regid_comparator, (hash_function_t) regid_hash);
-    a->aliases = map_init((comparator_t) regid_comparator, (hash_function_t) regid_hash);
-    a->replacements = map_init((comparator_t) regid_comparator, (hash_function_t) regid_hash);
+    a->routine = routine;
+    a->air = air;
+    a->unspillable = unspillable;
+    a->intervals = imap_init();
+    a->temporaries = vector_init();
+    a->frequencies = vector_init();
 
-    map_set_deleters(a->map, NULL, (deleter_t) allocinfo_delete);
+    a->du = air_defuse_init(routine);
+    a->liveness = air_liveness_init(routine, air);
+    find_frequencies(a);
+    find_intervals(a);
 
-    map_set_printers(a->map,
-        (int (*)(void*, int (*)(const char*, ...))) regid_print,
-        (int (*)(void*, int (*)(const char*, ...))) allocinfo_print);
+    vector_t* spilled = vector_init();
+    bool ok = scan(a, spilled);
 
-    map_set_printers(a->aliases,
-        (int (*)(void*, int (*)(const char*, ...))) regid_print,
-        (int (*)(void*, int (*)(const char*, ...))) regid_print);
-    
-    map_set_printers(a->replacements,
-        (int (*)(void*, int (*)(const char*, ...))) regid_print,
-        (int (*)(void*, int (*)(const char*, ...))) regid_print);
+    if (get_program_options()->iflag)
+        print_intervals(a);
 
-    find_all_conflicts(routine, a, air);
+    bool again = ok && spilled->size;
+    if (again)
+        spill_registers(a, spilled);
+    else if (ok)
+    {
+        replace_registers(a);
+        routine->used_nonvolatiles = 0;
+        VECTOR_FOR(interval_t*, iv, a->temporaries)
+            routine->used_nonvolatiles |= nonvolatile_flag(iv->assigned);
+    }
 
-    if (get_program_options()->iflag)
-        map_print(a->map, printf);
+    vector_delete(spilled);
+    allocator_delete(a);
+    air_routine_invalidate_cfg(routine);
+    if (!ok) report_return_value(false);
+    return again;
+}
 
-    coalesce(routine, a, air);
+static bool names_frame_pointer(air_insn_operand_t* op)
+{
+    if (!op) return false;
+    if (op->type == AOP_REGISTER)
+        return op->content.reg == X86R_RBP;
+    if (op->type == AOP_INDIRECT_REGISTER)
+        return op->content.inreg.id == X86R_RBP || op->content.inreg.roffset == X86R_RBP;
+    return false;
+}
 
-    if (get_program_options()->iflag)
+// whether a routine can address its locals from %rsp and give %rbp to the allocator. routines that read their
+// caller's frame through %rbp or pass arguments on the stack, which take the bottom of the frame at %rsp, keep it
+static bool can_omit_frame_pointer(air_routine_t* routine)
+{
+    if (routine->uses_varargs || routine->outgoing)
+        return false;
+    for (air_insn_t* insn = routine->insns; insn; insn = insn->next)
     {
-        map_print(a->map, printf);
-        map_print(a->aliases, printf);
+        for (size_t i = 0; i < insn->noops; ++i)
+        {
+            if (names_frame_pointer(insn->ops[i]))
+                return false;
+        }
     }
+    return true;
+}
 
-    replace_registers(routine, a, air);
+static bool names_nonvolatile(air_routine_t* routine, air_insn_operand_t* op)
+{
+    if (!op) return false;
+    if (op->type == AOP_REGISTER)
+        return routine->used_nonvolatiles & nonvolatile_flag(op->content.reg);
+    if (op->type == AOP_INDIRECT_REGISTER)
+        return routine->used_nonvolatiles & (nonvolatile_flag(op->content.inreg.id) | nonvolatile_flag(op->content.inreg.roffset));
+    return false;
+}
 
-    allocator_delete(a);
+static bool is_exit(air_insn_t* insn)
+{
+    return insn->type == AIR_RETURN || (insn->type == AIR_FUNC_CALL && insn->metadata.fcall_tail);
+}
+
+// the blocks that can be gotten to from a block by taking at least one edge
+static bool* find_reachable(air_cfg_t* cfg, air_block_t* from)
+{
+    bool* reached = calloc(cfg->blocks->size, sizeof *reached);
+    vector_t* stack = vector_init();
+    vector_add(stack, from);
+    while (stack->size)
+    {
+        air_block_t* block = vector_pop(stack);
+        VECTOR_FOR(air_block_t*, succ, block->successors)
+        {
+            if (reached[succ->id]) continue;
+            reached[succ->id] = true;
+            vector_add(stack, succ);
+        }
+    }
+    vector_delete(stack);
+    return reached;
+}
+
+// the block to save the callee-saved registers in: the nearest one dominating every block that uses them, moved up
+// out of any loop. calls need the stack aligned, so they count as uses when the saves would move %rsp off alignment.
+static air_block_t* find_save_block(air_routine_t* routine, air_cfg_t* cfg)
+{
+    size_t saved = 0;
+    for (uint16_t flags = routine->used_nonvolatiles; flags; flags &= flags - 1)
+        ++saved;
+    bool misaligns = saved % 2;
+    air_block_t* save = NULL;
+    VECTOR_FOR(air_block_t*, block, cfg->blocks)
+    {
+        if (!block->reachable) continue;
+        bool uses = false;
+        for (air_insn_t* insn = block->first; insn && !uses; insn = insn == block->last ? NULL : insn->next)
+        {
+            uses = misaligns && insn->type == AIR_FUNC_CALL && !insn->metadata.fcall_tail;
+            for (size_t j = 0; j < insn->noops && !uses; ++j)
+                uses = names_nonvolatile(routine, insn->ops[j]);
+        }
+        if (!uses) continue;
+        if (!save) save = block;
+        while (!air_block_dominates(save, block))
+            save = save->idom;
+    }
+    for (bool moved = true; save && moved;)
+    {
+        moved = false;
+        VECTOR_FOR(air_loop_t*, loop, cfg->loops)
+        {
+            if (loop->contains[save->id] && save->idom)
+            {
+                save = loop->header->idom;
+                moved = true;
+                break;
+            }
+        }
+    }
+    return save;
+}
+
+// moves saving the callee-saved registers from the prologue to where they're first needed, if that's anywhere but
+// the entry. see the top of this file
+static void wrap_nonvolatiles(air_routine_t* routine)
+{
+    routine->wraps_nonvolatiles = false;
+    // without a frame pointer, the stack slots are addressed from %rsp, which the saves would move. so are the
+    // outgoing arguments, with or without one
+    if (!routine->used_nonvolatiles || routine->omits_frame_pointer || routine->outgoing)
+        return;
+    air_cfg_t* cfg = air_routine_cfg(routine);
+    air_block_t* save = find_save_block(routine, cfg);
+    air_block_t* entry = vector_get(cfg->blocks, 0);
+    if (!save || save == entry)
+        return;
+
+    // x86 only frames routines that call something for sure, and the saves need a frame to go below
+    bool calls = false;
+    for (air_insn_t* insn = routine->insns; insn; insn = insn->next)
+        calls |= insn->type == AIR_FUNC_CALL && !insn->metadata.fcall_tail;
+    bool* reached = find_reachable(cfg, save);
+    bool ok = calls && !reached[save->id];
+    VECTOR_FOR(air_block_t*, block, cfg->blocks)
+    {
+        if (!ok) break;
+        if (!block->reachable) continue;
+        bool exits = !block->successors->size;
+        for (air_insn_t* insn = block->first; insn; insn = insn == block->last ? NULL : insn->next)
+            exits |= is_exit(insn);
+        if (!exits) continue;
+        // falling off the end of the routine leaves nowhere to restore them
+        if (!is_exit(block->last) && (block == save || reached[block->id]))
+            ok = false;
+        else if (block != save && !air_block_dominates(save, block) && reached[block->id])
+            ok = false;
+    }
+    free(reached);
+    if (!ok)
+        return;
+
+    routine->wraps_nonvolatiles = true;
+    save->first->metadata.saves_nonvolatiles = true;
+    VECTOR_FOR(air_block_t*, after, cfg->blocks)
+    {
+        if (!after->reachable || !air_block_dominates(save, after)) continue;
+        for (air_insn_t* insn = after->first; insn; insn = insn == after->last ? NULL : insn->next)
+            insn->metadata.restores_nonvolatiles = is_exit(insn);
+    }
+}
+
+void allocate_routine(air_routine_t* routine, air_t* air)
+{
+    if (!routine) return;
+    if (air->locale != LOC_X86_64) report_return;
+    air_routine_t* previous = air_lower(air, routine);
+    routine->omits_frame_pointer = get_program_options()->ffflag && can_omit_frame_pointer(routine);
+    bitset_t* unspillable = bitset_init();
+    while (allocate_round(routine, air, unspillable));
+    bitset_delete(unspillable);
+    wrap_nonvolatiles(routine);
+    air_lower(air, previous);
 }
 
 void allocate(air_t* air)
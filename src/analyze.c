@@ -17,6 +17,14 @@ typedef struct analysis_syntax_traverser
     unsigned long long next_label_uid;
 } analysis_syntax_traverser_t;
 
+/*
+
+diagnostics are kept as a list with a pointer to its last entry on the first one, so adding one never walks the
+list. most messages are fixed strings; those keep pointing at their format and are never copied or formatted.
+only messages with arguments are formatted on creation, since what they point to (names, types) may not outlive
+the pass that reported them.
+
+*/
 analysis_error_t* error_init(syntax_component_t* syn, bool warning, char* fmt, ...)
 {
     analysis_error_t* err = calloc(1, sizeof *err);
@@ -25,12 +33,17 @@ analysis_error_t* error_init(syntax_component_t* syn, bool warning, char* fmt, .
         err->row = syn->row;
         err->col = syn->col;
     }
-    err->message = malloc(MAX_ERROR_LEN);
+    err->format = fmt;
     err->warning = warning;
+    err->last = err;
+    if (!strchr(fmt, '%'))
+        return err;
+    char message[MAX_ERROR_LEN];
     va_list args;
     va_start(args, fmt);
-    vsnprintf(err->message, MAX_ERROR_LEN, fmt, args);
+    vsnprintf(message, MAX_ERROR_LEN, fmt, args);
     va_end(args);
+    err->message = strdup(message);
     return err;
 }
 
@@ -43,18 +56,21 @@ void error_delete(analysis_error_t* err)
 
 void error_delete_all(analysis_error_t* errors)
 {
-    if (!errors) return;
-    error_delete_all(errors->next);
-    error_delete(errors);
+    while (errors)
+    {
+        analysis_error_t* next = errors->next;
+        error_delete(errors);
+        errors = next;
+    }
 }
 
 analysis_error_t* error_list_add(analysis_error_t* errors, analysis_error_t* err)
 {
     if (!errors) return err;
-    analysis_error_t* head = errors;
-    for (; errors->next; errors = errors->next);
-    errors->next = err;
-    return head;
+    if (!err) return errors;
+    errors->last->next = err;
+    errors->last = err->last;
+    return errors;
 }
 
 size_t error_list_size(analysis_error_t* errors, bool include_warnings)
@@ -69,7 +85,7 @@ size_t error_list_size(analysis_error_t* errors, bool include_warnings)
 void dump_errors(analysis_error_t* errors)
 {
     for (; errors; errors = errors->next)
-        (errors->warning ? warnf : errorf)("[%d:%d] %s\n", errors->row, errors->col, errors->message);
+        (errors->warning ? warnf : errorf)("[%d:%d] %s\n", errors->row, errors->col, errors->message ? errors->message : errors->format);
 }
 
 #define ANALYSIS_TRAVERSER ((analysis_syntax_traverser_t*) trav)
@@ -810,7 +826,7 @@ void analyze_va_arg_intrinsic_call_expression_after(syntax_traverser_t* trav, sy
         syn->ctype = make_basic_type(CTC_ERROR);
         return;
     }
-    symbol_t* sy = symbol_table_get_by_classes(SYMBOL_TABLE, "__ecc_va_list", CTC_STRUCTURE, NSC_STRUCT);
+    symbol_t* sy = symbol_table_get_by_classes(SYMBOL_TABLE, intern("__ecc_va_list"), CTC_STRUCTURE, NSC_STRUCT);
     if (!sy)
     {
         ADD_ERROR(syn, "cannot find va_list declaration for va_arg invocation");
@@ -854,7 +870,7 @@ void analyze_va_start_intrinsic_call_expression_after(syntax_traverser_t* trav,
         syn->ctype = make_basic_type(CTC_ERROR);
         return;
     }
-    symbol_t* sy = symbol_table_get_by_classes(SYMBOL_TABLE, "__ecc_va_list", CTC_STRUCTURE, NSC_STRUCT);
+    symbol_t* sy = symbol_table_get_by_classes(SYMBOL_TABLE, intern("__ecc_va_list"), CTC_STRUCTURE, NSC_STRUCT);
     if (!sy)
     {
         ADD_ERROR(syn, "cannot find va_list declaration for va_start invocation");
@@ -879,7 +895,7 @@ void analyze_va_end_intrinsic_call_expression_after(syntax_traverser_t* trav, sy
         syn->ctype = make_basic_type(CTC_ERROR);
         return;
     }
-    symbol_t* sy = symbol_table_get_by_classes(SYMBOL_TABLE, "__ecc_va_list", CTC_STRUCTURE, NSC_STRUCT);
+    symbol_t* sy = symbol_table_get_by_classes(SYMBOL_TABLE, intern("__ecc_va_list"), CTC_STRUCTURE, NSC_STRUCT);
     if (!sy)
     {
         ADD_ERROR(syn, "cannot find va_list declaration for va_end invocation");
@@ -971,6 +987,65 @@ static void analyze_lsys_read_intrinsic_call_expression_after(syntax_traverser_t
     syn->ctype = make_basic_type(CTC_LONG_INT);
 }
 
+static void analyze_lsys_write_intrinsic_call_expression_after(syntax_traverser_t* trav, syntax_component_t* syn)
+{
+    if (!check_intrinsic_arg(trav, syn, 0, make_basic_type(CTC_INT)))
+        return;
+
+    c_type_t* arg_buf_ct = make_basic_type(CTC_POINTER);
+    arg_buf_ct->derived_from = make_basic_type(CTC_CHAR);
+    arg_buf_ct->derived_from->qualifiers |= TQ_B_CONST;
+    if (!check_intrinsic_arg(trav, syn, 1, arg_buf_ct))
+        return;
+
+    if (!check_intrinsic_arg(trav, syn, 2, make_basic_type(C_TYPE_SIZE_T)))
+        return;
+
+    syn->ctype = make_basic_type(CTC_LONG_INT);
+}
+
+static void analyze_lsys_ioctl_intrinsic_call_expression_after(syntax_traverser_t* trav, syntax_component_t* syn)
+{
+    if (!check_intrinsic_arg(trav, syn, 0, make_basic_type(CTC_INT)))
+        return;
+
+    if (!check_intrinsic_arg(trav, syn, 1, make_basic_type(CTC_UNSIGNED_LONG_INT)))
+        return;
+
+    c_type_t* arg_buf_ct = make_basic_type(CTC_POINTER);
+    arg_buf_ct->derived_from = make_basic_type(CTC_CHAR);
+    if (!check_intrinsic_arg(trav, syn, 2, arg_buf_ct))
+        return;
+
+    syn->ctype = make_basic_type(CTC_INT);
+}
+
+static void analyze_lsys_mmap_intrinsic_call_expression_after(syntax_traverser_t* trav, syntax_component_t* syn)
+{
+    c_type_t* arg_addr_ct = make_basic_type(CTC_POINTER);
+    arg_addr_ct->derived_from = make_basic_type(CTC_CHAR);
+    if (!check_intrinsic_arg(trav, syn, 0, arg_addr_ct))
+        return;
+
+    if (!check_intrinsic_arg(trav, syn, 1, make_basic_type(C_TYPE_SIZE_T)))
+        return;
+
+    if (!check_intrinsic_arg(trav, syn, 2, make_basic_type(CTC_INT)))
+        return;
+
+    if (!check_intrinsic_arg(trav, syn, 3, make_basic_type(CTC_INT)))
+        return;
+
+    if (!check_intrinsic_arg(trav, syn, 4, make_basic_type(CTC_INT)))
+        return;
+
+    if (!check_intrinsic_arg(trav, syn, 5, make_basic_type(CTC_LONG_INT)))
+        return;
+
+    syn->ctype = make_basic_type(CTC_POINTER);
+    syn->ctype->derived_from = make_basic_type(CTC_CHAR);
+}
+
 void analyze_intrinsic_call_expression_after(syntax_traverser_t* trav, syntax_component_t* syn)
 {
     if (streq(syn->icallexpr_name, "__ecc_va_arg"))
@@ -985,6 +1060,12 @@ void analyze_intrinsic_call_expression_after(syntax_traverser_t* trav, syntax_co
         analyze_lsys_close_intrinsic_call_expression_after(trav, syn);
     else if (streq(syn->icallexpr_name, "__ecc_lsys_read"))
         analyze_lsys_read_intrinsic_call_expression_after(trav, syn);
+    else if (streq(syn->icallexpr_name, "__ecc_lsys_write"))
+        analyze_lsys_write_intrinsic_call_expression_after(trav, syn);
+    else if (streq(syn->icallexpr_name, "__ecc_lsys_ioctl"))
+        analyze_lsys_ioctl_intrinsic_call_expression_after(trav, syn);
+    else if (streq(syn->icallexpr_name, "__ecc_lsys_mmap"))
+        analyze_lsys_mmap_intrinsic_call_expression_after(trav, syn);
     else
     {
         ADD_ERROR(syn, "unsupported intrinsic function '%s' invoked", syn->icallexpr_name);
@@ -1064,7 +1145,7 @@ void analyze_compound_literal_expression_before(syntax_traverser_t* trav, syntax
     const size_t len = 4 + MAX_STRINGIFIED_INTEGER_LENGTH + 1; // __cl(number)(null)
     char* name = malloc(len);
     snprintf(name, len, "__cl%llu", ANALYSIS_TRAVERSER->next_compound_literal++);
-    syn->cl_id = strdup(name);
+    syn->cl_id = intern(name);
     symbol_t* sy = symbol_table_add(SYMBOL_TABLE, name, symbol_init(syn));
     sy->ns = make_basic_namespace(NSC_ORDINARY);
     free(name);
@@ -1085,7 +1166,7 @@ void analyze_string_literal_after(syntax_traverser_t* trav, syntax_component_t*
     const size_t len = 4 + MAX_STRINGIFIED_INTEGER_LENGTH + 1; // __sl(number)(null)
     char* name = malloc(len);
     snprintf(name, len, "__sl%llu", ANALYSIS_TRAVERSER->next_string_literal++);
-    syn->strl_id = strdup(name);
+    syn->strl_id = intern(name);
     symbol_t* sy = symbol_table_add(SYMBOL_TABLE, name, symbol_init(syn));
     sy->ns = make_basic_namespace(NSC_ORDINARY);
     sy->type = type_copy(syn->ctype);
@@ -2789,7 +2870,7 @@ void analyze_floating_constant_after(syntax_traverser_t* trav, syntax_component_
     const size_t len = 4 + MAX_STRINGIFIED_INTEGER_LENGTH + 1; // __fc(number)(null)
     char* name = malloc(len);
     snprintf(name, len, "__fc%llu", ANALYSIS_TRAVERSER->next_floating_constant++);
-    syn->floc_id = strdup(name);
+    syn->floc_id = intern(name);
     symbol_t* sy = symbol_table_add(SYMBOL_TABLE, name, symbol_init(syn));
     sy->ns = make_basic_namespace(NSC_ORDINARY);
     sy->type = type_copy(syn->ctype);
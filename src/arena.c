@@ -0,0 +1,110 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "ecc.h"
+
+/*
+
+arenas hand out zeroed memory by bumping a pointer through large chunks.
+nothing allocated from an arena is freed individually, the whole arena is released at once by arena_delete.
+
+*/
+
+#define ARENA_DEFAULT_CHUNK_SIZE (64 * 1024)
+#define ARENA_ALIGNMENT (sizeof(long double))
+#define ARENA_ALIGN(x) (((x) + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1))
+
+typedef struct arena_chunk
+{
+    struct arena_chunk* next;
+    size_t size;
+    size_t used;
+} arena_chunk_t;
+
+// chunk contents start at the first aligned address after the header
+#define ARENA_CHUNK_DATA(c) ((unsigned char*) (c) + ARENA_ALIGN(sizeof(arena_chunk_t)))
+
+static arena_chunk_t* arena_chunk_init(size_t size, arena_chunk_t* next)
+{
+    arena_chunk_t* chunk = malloc(ARENA_ALIGN(sizeof *chunk) + size);
+    chunk->next = next;
+    chunk->size = size;
+    chunk->used = 0;
+    return chunk;
+}
+
+arena_t* arena_init(void)
+{
+    arena_t* a = calloc(1, sizeof *a);
+    a->chunk_size = ARENA_DEFAULT_CHUNK_SIZE;
+    return a;
+}
+
+void* arena_alloc(arena_t* a, size_t size)
+{
+    size = ARENA_ALIGN(size);
+    arena_chunk_t* chunk = a->chunks;
+    if (!chunk || chunk->size - chunk->used < size)
+    {
+        // oversized requests get their own chunk behind the current one so the rest of it isn't wasted
+        if (size > a->chunk_size / 4 && chunk)
+        {
+            arena_chunk_t* big = arena_chunk_init(size, chunk->next);
+            chunk->next = big;
+            memset(ARENA_CHUNK_DATA(big), 0, size);
+            big->used = size;
+            return ARENA_CHUNK_DATA(big);
+        }
+        chunk = a->chunks = arena_chunk_init(size > a->chunk_size ? size : a->chunk_size, chunk);
+    }
+    void* p = ARENA_CHUNK_DATA(chunk) + chunk->used;
+    chunk->used += size;
+    memset(p, 0, size);
+    return p;
+}
+
+void* arena_memdup(arena_t* a, void* data, size_t size)
+{
+    void* p = arena_alloc(a, size);
+    memcpy(p, data, size);
+    return p;
+}
+
+char* arena_strdup(arena_t* a, char* str)
+{
+    if (!str) return NULL;
+    return arena_memdup(a, str, strlen(str) + 1);
+}
+
+// takes over everything allocated from other, which is freed. allocation goes on from a's own chunk
+void arena_absorb(arena_t* a, arena_t* other)
+{
+    if (!other) return;
+    arena_chunk_t* last = other->chunks;
+    if (!last)
+    {
+        free(other);
+        return;
+    }
+    for (; last->next; last = last->next);
+    if (a->chunks)
+    {
+        last->next = a->chunks->next;
+        a->chunks->next = other->chunks;
+    }
+    else
+        a->chunks = other->chunks;
+    free(other);
+}
+
+void arena_delete(arena_t* a)
+{
+    if (!a) return;
+    for (arena_chunk_t* chunk = a->chunks; chunk;)
+    {
+        arena_chunk_t* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(a);
+}
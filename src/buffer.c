@@ -21,7 +21,7 @@ static buffer_t* buffer_resize(buffer_t* b, unsigned capacity)
 
 buffer_t* buffer_append(buffer_t* b, char c)
 {
-    if (b->capacity >= b->size)
+    if (b->size >= b->capacity)
         buffer_resize(b, b->capacity + (b->capacity / 2));
     b->data[(b->size)++] = c;
     return b;
@@ -29,7 +29,7 @@ buffer_t* buffer_append(buffer_t* b, char c)
 
 buffer_t* buffer_append_wide(buffer_t* b, int c)
 {
-    if (b->capacity >= b->size)
+    if (b->size + sizeof(int) > b->capacity)
         buffer_resize(b, b->capacity + (b->capacity / 2));
     *((int*) (b->data + b->size)) = c;
     b->size += sizeof(int);
@@ -43,6 +43,15 @@ buffer_t* buffer_append_str(buffer_t* b, char* str)
     return b;
 }
 
+buffer_t* buffer_append_bytes(buffer_t* b, const char* bytes, unsigned count)
+{
+    if (b->capacity <= b->size + count)
+        buffer_resize(b, b->capacity + (b->capacity / 2) + count);
+    memcpy(b->data + b->size, bytes, count);
+    b->size += count;
+    return b;
+}
+
 buffer_t* buffer_pop(buffer_t* b)
 {
     if (!b->size)
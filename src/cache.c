@@ -0,0 +1,272 @@
+#define _DEFAULT_SOURCE 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "ecc.h"
+
+/*
+
+the cache -C points at: the assembly or object a translation unit compiled to, kept under a key taken from everything
+that goes into it after preprocessing. a file that preprocesses to the same tokens under the same options and the same
+compiler gets the same output, so on a hit everything after the preprocessor is skipped and the output is copied out
+of the cache instead.
+
+the key is a 128-bit FNV-1a hash over:
+    the compiler        the size, modification time, and inode of the running executable
+    the output          assembly or object
+    the options         the ones that change the output: -O, -F, -b, and -B (with the contents of the profile)
+    the file path       only with -b or -B, which name the counters after it
+    the tokens          the type and spelling of every token the preprocessor left, in order
+
+whitespace and line numbers aren't part of the key since nothing past the preprocessor puts them in the output. they
+do go into diagnostics, so a compilation that had any (even just warnings) isn't stored, and the warnings come out
+again the next time instead of going missing.
+
+entries are files named after their key. they're written to a temporary file first and renamed into place, so the
+compilers sharing a cache only ever see whole entries. a hit touches its entry, and once the entries add up to more
+than the limit the least recently used are removed until they fit again.
+
+*/
+
+#define CACHE_SIZE_LIMIT (256 << 20)
+#define CACHE_COPY_BUFFER_SIZE (1 << 16)
+
+#define FNV128_OFFSET (((unsigned __int128) 0x6c62272e07bb0142ULL << 64) | 0x62b821756295c58dULL)
+#define FNV128_PRIME (((unsigned __int128) 0x0000000001000000ULL << 64) | 0x000000000000013bULL)
+
+typedef unsigned __int128 cache_hash_t;
+
+static void hash_bytes(cache_hash_t* h, void* data, size_t length)
+{
+    unsigned char* bytes = data;
+    for (size_t i = 0; i < length; ++i)
+    {
+        *h ^= bytes[i];
+        *h *= FNV128_PRIME;
+    }
+}
+
+// strings are hashed with their terminator so that neighbouring ones can't run together
+static void hash_string(cache_hash_t* h, char* str)
+{
+    if (!str) str = "";
+    hash_bytes(h, str, strlen(str) + 1);
+}
+
+static void hash_u64(cache_hash_t* h, uint64_t value)
+{
+    hash_bytes(h, &value, sizeof value);
+}
+
+static bool hash_file(cache_hash_t* h, char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return false;
+    unsigned char buffer[CACHE_COPY_BUFFER_SIZE];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof buffer, file)) > 0)
+        hash_bytes(h, buffer, read);
+    bool success = !ferror(file);
+    fclose(file);
+    return success;
+}
+
+static void hash_token(cache_hash_t* h, preprocessing_token_t* token)
+{
+    uint8_t type = token->type;
+    hash_bytes(h, &type, sizeof type);
+    switch (token->type)
+    {
+        case PPT_HEADER_NAME:
+            hash_bytes(h, &token->header_name.quote_delimited, sizeof(bool));
+            hash_string(h, token->header_name.name);
+            break;
+        case PPT_IDENTIFIER:
+            hash_string(h, token->identifier);
+            break;
+        case PPT_PP_NUMBER:
+            hash_string(h, token->pp_number);
+            break;
+        case PPT_CHARACTER_CONSTANT:
+            hash_bytes(h, &token->character_constant.wide, sizeof(bool));
+            hash_string(h, token->character_constant.value);
+            break;
+        case PPT_STRING_LITERAL:
+            hash_bytes(h, &token->string_literal.wide, sizeof(bool));
+            hash_string(h, token->string_literal.value);
+            break;
+        case PPT_PUNCTUATOR:
+            hash_u64(h, token->punctuator);
+            break;
+        case PPT_OTHER:
+            hash_bytes(h, &token->other, sizeof token->other);
+            break;
+        default:
+            break;
+    }
+}
+
+// the key for what a compilation would make of these tokens, or NULL if there isn't one
+char* cache_key(compilation_t* c, preprocessing_token_t* tokens)
+{
+    cache_hash_t h = FNV128_OFFSET;
+
+    struct stat st;
+    if (stat("/proc/self/exe", &st))
+        return NULL;
+    hash_u64(&h, st.st_size);
+    hash_u64(&h, st.st_mtim.tv_sec);
+    hash_u64(&h, st.st_mtim.tv_nsec);
+    hash_u64(&h, st.st_ino);
+
+    program_options_t* options = c->options;
+    hash_u64(&h, c->cache_object);
+    hash_u64(&h, options->olevel);
+    hash_u64(&h, options->ffflag);
+    hash_u64(&h, options->bflag);
+    hash_u64(&h, options->bbflag != NULL);
+    if (options->bbflag && !hash_file(&h, options->bbflag))
+        return NULL;
+    if (options->bflag || options->bbflag)
+        hash_string(&h, c->filepath);
+
+    for (preprocessing_token_t* token = tokens; token; token = token->next)
+    {
+        if (token->type != PPT_WHITESPACE)
+            hash_token(&h, token);
+    }
+
+    char* key = malloc(33);
+    snprintf(key, 33, "%016llx%016llx", (unsigned long long) (h >> 64), (unsigned long long) h);
+    return key;
+}
+
+static char* entry_path(char* dir, char* name)
+{
+    size_t length = strlen(dir) + strlen(name) + 2;
+    char* path = malloc(length);
+    snprintf(path, length, "%s/%s", dir, name);
+    return path;
+}
+
+static bool copy_file(char* from, char* to)
+{
+    FILE* in = fopen(from, "rb");
+    if (!in)
+        return false;
+    FILE* out = fopen(to, "wb");
+    if (!out)
+    {
+        fclose(in);
+        return false;
+    }
+    char buffer[CACHE_COPY_BUFFER_SIZE];
+    size_t read;
+    bool success = true;
+    while (success && (read = fread(buffer, 1, sizeof buffer, in)) > 0)
+        success = fwrite(buffer, 1, read, out) == read;
+    success = success && !ferror(in);
+    fclose(in);
+    success = !fclose(out) && success;
+    return success;
+}
+
+// copies the entry for the key to target if there is one, marking it as just used
+bool cache_fetch(char* dir, char* key, char* target)
+{
+    char* path = entry_path(dir, key);
+    bool hit = copy_file(path, target);
+    if (hit)
+        (void) utimes(path, NULL);
+    free(path);
+    return hit;
+}
+
+typedef struct cache_entry
+{
+    char* name;
+    time_t used;
+    off_t size;
+} cache_entry_t;
+
+// least recently used first
+static int cache_entry_comparator(const void* a, const void* b)
+{
+    const cache_entry_t* x = *(cache_entry_t* const*) a;
+    const cache_entry_t* y = *(cache_entry_t* const*) b;
+    return (x->used > y->used) - (x->used < y->used);
+}
+
+// removes the least recently used entries until the rest fit under the limit
+static void cache_trim(char* dir)
+{
+    DIR* d = opendir(dir);
+    if (!d)
+        return;
+    vector_t* entries = vector_init();
+    uint64_t total = 0;
+    for (struct dirent* de; (de = readdir(d));)
+    {
+        // temporary files start with a dot, and belong to whoever's writing them
+        if (de->d_name[0] == '.')
+            continue;
+        char* path = entry_path(dir, de->d_name);
+        struct stat st;
+        if (!stat(path, &st) && S_ISREG(st.st_mode))
+        {
+            cache_entry_t* entry = malloc(sizeof *entry);
+            entry->name = strdup(de->d_name);
+            entry->used = st.st_mtime;
+            entry->size = st.st_size;
+            vector_add(entries, entry);
+            total += st.st_size;
+        }
+        free(path);
+    }
+    closedir(d);
+
+    if (total > CACHE_SIZE_LIMIT)
+    {
+        qsort(entries->data, entries->size, sizeof(void*), cache_entry_comparator);
+        for (size_t i = 0; i < entries->size && total > CACHE_SIZE_LIMIT; ++i)
+        {
+            cache_entry_t* entry = vector_get(entries, i);
+            char* path = entry_path(dir, entry->name);
+            if (!remove(path))
+                total -= entry->size;
+            free(path);
+        }
+    }
+
+    VECTOR_FOR(cache_entry_t*, entry, entries)
+    {
+        free(entry->name);
+        free(entry);
+    }
+    vector_delete(entries);
+}
+
+// keeps a copy of the file at path under the key. the cache is only ever an optimization, so failing to is quiet
+void cache_store(char* dir, char* key, char* path)
+{
+    if (mkdir(dir, 0755) && access(dir, W_OK))
+        return;
+    char name[64];
+    snprintf(name, sizeof name, ".%s.%ld", key, (long) getpid());
+    char* temp = entry_path(dir, name);
+    char* entry = entry_path(dir, key);
+    if (copy_file(path, temp) && !rename(temp, entry))
+        cache_trim(dir);
+    else
+        remove(temp);
+    free(temp);
+    free(entry);
+}
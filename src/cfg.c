@@ -0,0 +1,411 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "ecc.h"
+
+/*
+
+control-flow graphs over AIR routines.
+
+a routine's instructions are split into basic blocks at labels and after jumps and returns, and blocks
+are connected by the jumps between them and by falling through. the dominator tree is computed with the
+iterative algorithm from Cooper, Harvey, and Kennedy's "A Simple, Fast Dominance Algorithm", and then
+numbered so dominance between any two blocks is an O(1) check.
+
+natural loops are found from the back edges, the edges whose target dominates their source. a loop's body
+is everything that reaches one of its back edges without going through the header, and back edges to the
+same header make up a single loop.
+
+a routine's CFG is built on first use and kept until a pass that restructures the routine invalidates it.
+passes that only rewrite instructions in place, or move them within their block, can keep using it.
+
+*/
+
+// labels are identified by their number and disambiguator together
+static void* label_key(air_insn_operand_t* op)
+{
+    return (void*) ((op->content.label.id << 8) | (unsigned char) op->content.label.disambiguator);
+}
+
+static bool ends_block(air_insn_t* insn)
+{
+    switch (insn->type)
+    {
+        case AIR_JMP:
+        case AIR_JMP_TABLE:
+        case AIR_JZ:
+        case AIR_JNZ:
+        case AIR_RETURN:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static air_block_t* block_init(air_cfg_t* cfg, air_insn_t* first)
+{
+    air_block_t* block = calloc(1, sizeof *block);
+    block->id = cfg->blocks->size;
+    block->first = first;
+    block->predecessors = vector_init();
+    block->successors = vector_init();
+    block->dominated = vector_init();
+    vector_add(cfg->blocks, block);
+    return block;
+}
+
+static void block_delete(air_block_t* block)
+{
+    if (!block) return;
+    vector_delete(block->predecessors);
+    vector_delete(block->successors);
+    vector_delete(block->dominated);
+    free(block);
+}
+
+static void add_edge(air_block_t* from, air_block_t* to)
+{
+    if (!to)
+        return;
+    for (size_t i = 0; i < from->successors->size; ++i)
+        if (vector_get(from->successors, i) == to)
+            return;
+    vector_add(from->successors, to);
+    vector_add(to->predecessors, from);
+}
+
+static void find_blocks(air_cfg_t* cfg, air_routine_t* routine)
+{
+    map_t* labels = map_init(pointer_comparator, pointer_hash); // map_t<label key, air_block_t*>
+
+    air_block_t* current = NULL;
+    for (air_insn_t* insn = routine->insns; insn; insn = insn->next)
+    {
+        if (!current || insn->type == AIR_LABEL)
+        {
+            if (current)
+                current->last = insn->prev;
+            current = block_init(cfg, insn);
+        }
+        if (insn->type == AIR_LABEL)
+            map_add(labels, label_key(insn->ops[0]), current);
+        map_add(cfg->insn_blocks, insn, current);
+        if (ends_block(insn) || !insn->next)
+        {
+            current->last = insn;
+            current = NULL;
+        }
+    }
+
+    for (size_t i = 0; i < cfg->blocks->size; ++i)
+    {
+        air_block_t* block = vector_get(cfg->blocks, i);
+        air_block_t* next = i + 1 < cfg->blocks->size ? vector_get(cfg->blocks, i + 1) : NULL;
+        air_insn_t* last = block->last;
+        switch (last->type)
+        {
+            case AIR_JMP:
+                add_edge(block, map_get(labels, label_key(last->ops[0])));
+                break;
+            case AIR_JZ:
+            case AIR_JNZ:
+                add_edge(block, map_get(labels, label_key(last->ops[0])));
+                add_edge(block, next);
+                break;
+            case AIR_JMP_TABLE:
+                for (size_t j = 1; j < last->noops; ++j)
+                    add_edge(block, map_get(labels, label_key(last->ops[j])));
+                break;
+            case AIR_RETURN:
+                break;
+            default:
+                add_edge(block, next);
+                break;
+        }
+    }
+
+    map_delete(labels);
+}
+
+// depth-first from the entry, without recursion since routines can be very long
+static void order_blocks(air_cfg_t* cfg)
+{
+    if (!cfg->blocks->size)
+        return;
+    vector_t* postorder = vector_init();
+    vector_t* stack = vector_init();
+    vector_t* positions = vector_init();
+    air_block_t* entry = vector_get(cfg->blocks, 0);
+    entry->reachable = true;
+    vector_add(stack, entry);
+    vector_add(positions, (void*) 0);
+    while (stack->size)
+    {
+        air_block_t* block = vector_peek(stack);
+        size_t position = (size_t) vector_pop(positions);
+        if (position < block->successors->size)
+        {
+            vector_add(positions, (void*) (position + 1));
+            air_block_t* succ = vector_get(block->successors, position);
+            if (!succ->reachable)
+            {
+                succ->reachable = true;
+                vector_add(stack, succ);
+                vector_add(positions, (void*) 0);
+            }
+            continue;
+        }
+        vector_pop(stack);
+        vector_add(postorder, block);
+    }
+    for (size_t i = postorder->size; i > 0; --i)
+    {
+        air_block_t* block = vector_get(postorder, i - 1);
+        block->rpo = cfg->rpo->size;
+        vector_add(cfg->rpo, block);
+    }
+    vector_delete(postorder);
+    vector_delete(stack);
+    vector_delete(positions);
+}
+
+static air_block_t* intersect(air_block_t* b1, air_block_t* b2)
+{
+    while (b1 != b2)
+    {
+        while (b1->rpo > b2->rpo)
+            b1 = b1->idom;
+        while (b2->rpo > b1->rpo)
+            b2 = b2->idom;
+    }
+    return b1;
+}
+
+static void find_dominators(air_cfg_t* cfg)
+{
+    if (!cfg->rpo->size)
+        return;
+    air_block_t* entry = vector_get(cfg->rpo, 0);
+    entry->idom = entry;
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        for (size_t i = 1; i < cfg->rpo->size; ++i)
+        {
+            air_block_t* block = vector_get(cfg->rpo, i);
+            air_block_t* idom = NULL;
+            VECTOR_FOR(air_block_t*, pred, block->predecessors)
+            {
+                if (!pred->idom)
+                    continue;
+                idom = idom ? intersect(pred, idom) : pred;
+            }
+            if (block->idom != idom)
+            {
+                block->idom = idom;
+                changed = true;
+            }
+        }
+    }
+    entry->idom = NULL;
+
+    for (size_t i = 1; i < cfg->rpo->size; ++i)
+    {
+        air_block_t* block = vector_get(cfg->rpo, i);
+        vector_add(block->idom->dominated, block);
+    }
+
+    // number the dominator tree so a block dominates another iff its interval contains the other's
+    size_t counter = 0;
+    vector_t* stack = vector_init();
+    vector_t* positions = vector_init();
+    entry->dom_pre = counter++;
+    vector_add(stack, entry);
+    vector_add(positions, (void*) 0);
+    while (stack->size)
+    {
+        air_block_t* block = vector_peek(stack);
+        size_t position = (size_t) vector_pop(positions);
+        if (position < block->dominated->size)
+        {
+            vector_add(positions, (void*) (position + 1));
+            air_block_t* child = vector_get(block->dominated, position);
+            child->dom_pre = counter++;
+            vector_add(stack, child);
+            vector_add(positions, (void*) 0);
+            continue;
+        }
+        block->dom_post = counter++;
+        vector_pop(stack);
+    }
+    vector_delete(stack);
+    vector_delete(positions);
+}
+
+static void loop_delete(air_loop_t* loop)
+{
+    if (!loop) return;
+    vector_delete(loop->blocks);
+    free(loop->contains);
+    vector_delete(loop->latches);
+    free(loop);
+}
+
+static void find_loops(air_cfg_t* cfg)
+{
+    VECTOR_FOR(air_block_t*, header, cfg->blocks)
+    {
+        if (!header->reachable)
+            continue;
+        air_loop_t* loop = NULL;
+        VECTOR_FOR(air_block_t*, pred, header->predecessors)
+        {
+            if (!air_block_dominates(header, pred))
+                continue;
+            if (!loop)
+            {
+                loop = calloc(1, sizeof *loop);
+                loop->header = header;
+                loop->blocks = vector_init();
+                loop->contains = calloc(cfg->blocks->size, sizeof(bool));
+                loop->latches = vector_init();
+                loop->contains[header->id] = true;
+            }
+            vector_add(loop->latches, pred);
+        }
+        if (!loop)
+            continue;
+
+        vector_t* stack = vector_init();
+        VECTOR_FOR(air_block_t*, latch, loop->latches)
+        {
+            if (loop->contains[latch->id])
+                continue;
+            loop->contains[latch->id] = true;
+            vector_add(stack, latch);
+        }
+        while (stack->size)
+        {
+            air_block_t* block = vector_pop(stack);
+            VECTOR_FOR(air_block_t*, pred, block->predecessors)
+            {
+                if (!pred->reachable || loop->contains[pred->id])
+                    continue;
+                loop->contains[pred->id] = true;
+                vector_add(stack, pred);
+            }
+        }
+        vector_delete(stack);
+
+        VECTOR_FOR(air_block_t*, block, cfg->blocks)
+            if (loop->contains[block->id])
+                vector_add(loop->blocks, block);
+
+        VECTOR_FOR(air_block_t*, entering, header->predecessors)
+        {
+            if (loop->contains[entering->id] || !entering->reachable)
+                continue;
+            if (loop->preheader)
+            {
+                loop->preheader = NULL;
+                break;
+            }
+            loop->preheader = entering;
+        }
+
+        // a loop nested in another is smaller than it, so keeping them by size puts inner loops first
+        size_t i = cfg->loops->size;
+        vector_add(cfg->loops, loop);
+        for (; i > 0; --i)
+        {
+            air_loop_t* other = vector_get(cfg->loops, i - 1);
+            if (other->blocks->size <= loop->blocks->size)
+                break;
+            cfg->loops->data[i] = other;
+        }
+        cfg->loops->data[i] = loop;
+    }
+}
+
+air_cfg_t* air_cfg_init(air_routine_t* routine)
+{
+    air_cfg_t* cfg = calloc(1, sizeof *cfg);
+    cfg->blocks = vector_init();
+    cfg->rpo = vector_init();
+    cfg->insn_blocks = map_init(pointer_comparator, pointer_hash);
+    cfg->loops = vector_init();
+    find_blocks(cfg, routine);
+    order_blocks(cfg);
+    find_dominators(cfg);
+    find_loops(cfg);
+    return cfg;
+}
+
+void air_cfg_delete(air_cfg_t* cfg)
+{
+    if (!cfg) return;
+    vector_deep_delete(cfg->blocks, (void (*)(void*)) block_delete);
+    vector_delete(cfg->rpo);
+    map_delete(cfg->insn_blocks);
+    vector_deep_delete(cfg->loops, (void (*)(void*)) loop_delete);
+    free(cfg);
+}
+
+air_block_t* air_cfg_block(air_cfg_t* cfg, air_insn_t* insn)
+{
+    return map_get(cfg->insn_blocks, insn);
+}
+
+// unreachable blocks don't dominate anything and aren't dominated by anything
+bool air_block_dominates(air_block_t* dominator, air_block_t* block)
+{
+    if (!dominator->reachable || !block->reachable)
+        return false;
+    return dominator->dom_pre <= block->dom_pre && block->dom_post <= dominator->dom_post;
+}
+
+air_cfg_t* air_routine_cfg(air_routine_t* routine)
+{
+    if (!routine->cfg)
+        routine->cfg = air_cfg_init(routine);
+    return routine->cfg;
+}
+
+void air_routine_invalidate_cfg(air_routine_t* routine)
+{
+    air_cfg_delete(routine->cfg);
+    routine->cfg = NULL;
+}
+
+static int block_list_print(vector_t* blocks, int (*printer)(const char* fmt, ...))
+{
+    int rv = printer("[");
+    VECTOR_FOR(air_block_t*, block, blocks)
+        rv += printer("%sB%lu", i ? ", " : "", block->id);
+    return rv + printer("]");
+}
+
+void air_cfg_print(air_cfg_t* cfg, air_t* air, int (*printer)(const char* fmt, ...))
+{
+    VECTOR_FOR(air_block_t*, block, cfg->blocks)
+    {
+        printer("B%lu", block->id);
+        if (!block->reachable)
+            printer(" (unreachable)");
+        printer(": predecessors: ");
+        block_list_print(block->predecessors, printer);
+        printer(", successors: ");
+        block_list_print(block->successors, printer);
+        if (block->idom)
+            printer(", idom: B%lu", block->idom->id);
+        printer("\n");
+        for (air_insn_t* insn = block->first; insn; insn = insn->next)
+        {
+            printer("  ");
+            air_insn_print(insn, air, printer);
+            printer("\n");
+            if (insn == block->last)
+                break;
+        }
+    }
+}
@@ -142,7 +142,7 @@ const char* SYNTAX_COMPONENT_NAMES[SC_NO_ELEMENTS] = {
     "SC_PRIMARY_EXPRESSION_ENUMERATION_CONSTANT"
 };
 
-const char* C_TYPE_CLASS_NAMES[30] = {
+const char* C_TYPE_CLASS_NAMES[31] = {
     "_Bool",
     "char",
     "signed char",
@@ -172,7 +172,8 @@ const char* C_TYPE_CLASS_NAMES[30] = {
     "function",
     "pointer",
     "label",
-    "error"
+    "error",
+    "vector"
 };
 
 const char* C_NAMESPACE_CLASS_NAMES[7] = {
@@ -408,7 +409,8 @@ const char* TOKEN_NAMES[T_NO_ELEMENTS] = {
     "T_FLOATING_CONSTANT",
     "T_CHARACTER_CONSTANT",
     "T_STRING_LITERAL",
-    "T_PUNCTUATOR"
+    "T_PUNCTUATOR",
+    "T_END"
 };
 
 const char* PUNCTUATOR_STRING_REPRS[P_NO_ELEMENTS] = {
@@ -590,5 +592,6 @@ const char* INTRINSIC_FUNCTION_NAMES[] = {
     "__ecc_lsys_write",
     "__ecc_lsys_open",
     "__ecc_lsys_close",
-    "__ecc_lsys_mmap"
+    "__ecc_lsys_mmap",
+    "__ecc_lsys_ioctl"
 };
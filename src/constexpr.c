@@ -38,6 +38,10 @@ constexpr_t* constexpr_copy(constexpr_t* ce)
     {
         case CE_INTEGER:
         case CE_ARITHMETIC:
+            // failed evaluations may not have gotten as far as producing a value
+            if (!ce->content.data)
+                break;
+            n->content.data = malloc(type_size(n->ct));
             memcpy(n->content.data, ce->content.data, type_size(n->ct));
             break;
         case CE_ADDRESS:
@@ -130,6 +134,7 @@ void constexpr_print_value(constexpr_t* ce, int (*printer)(const char*, ...))
         case CTC_UNION:
         case CTC_FUNCTION:
         case CTC_LABEL:
+        case CTC_VECTOR:
             printer("(unprintable value)");
             break;
         case CTC_ERROR:
@@ -1877,8 +1882,12 @@ bool constexpr_evaluation_succeeded(constexpr_t* ce)
     return ce->ct->class != CTC_ERROR;
 }
 
-static constexpr_t* constexpr_evaluate_type(syntax_component_t* expr, constexpr_type_t type)
+static constexpr_t* evaluate_address(syntax_component_t* expr);
+
+static constexpr_t* evaluate_type(syntax_component_t* expr, constexpr_type_t type)
 {
+    if (type == CE_ADDRESS)
+        return evaluate_address(expr);
     constexpr_t* ce = calloc(1, sizeof *ce);
     ce->type = type;
     ce->ct = make_basic_type(CTC_ERROR);
@@ -1897,12 +1906,30 @@ static constexpr_t* constexpr_evaluate_type(syntax_component_t* expr, constexpr_
     return ce;
 }
 
+/*
+
+evaluation only reads the tree and the symbol table, so once an expression has been analyzed (and typed) its
+result can't change anymore. the first evaluation of each kind is kept on the node; asking whether an expression
+can be evaluated and then evaluating it, or evaluating the same array length in several phases, only does the
+work once. callers get their own copy. expressions that haven't been typed yet are evaluated but not cached.
+
+*/
+static constexpr_t* constexpr_evaluate_type(syntax_component_t* expr, constexpr_type_t type)
+{
+    if (!expr->ctype)
+        return evaluate_type(expr, type);
+    if (!expr->constexprs[type])
+        expr->constexprs[type] = evaluate_type(expr, type);
+    return constexpr_copy(expr->constexprs[type]);
+}
+
 static bool constexpr_can_evaluate_type(syntax_component_t* expr, constexpr_type_t type)
 {
-    constexpr_t* ce = constexpr_evaluate_type(expr, type);
-    bool success = constexpr_evaluation_succeeded(ce);
-    constexpr_delete(ce);
-    return success;
+    if (!expr->ctype)
+        return false;
+    if (!expr->constexprs[type])
+        expr->constexprs[type] = evaluate_type(expr, type);
+    return constexpr_evaluation_succeeded(expr->constexprs[type]);
 }
 
 /*
@@ -1926,6 +1953,11 @@ constexpr_t* constexpr_evaluate_arithmetic(syntax_component_t* expr)
 }
 
 constexpr_t* constexpr_evaluate_address(syntax_component_t* expr)
+{
+    return constexpr_evaluate_type(expr, CE_ADDRESS);
+}
+
+static constexpr_t* evaluate_address(syntax_component_t* expr)
 {
     constexpr_t* ce = calloc(1, sizeof *ce);
     ce->type = CE_ADDRESS;
@@ -1995,3 +2027,211 @@ constexpr_t* constexpr_evaluate(syntax_component_t* expr)
     constexpr_delete(ce);
     return constexpr_evaluate_arithmetic(expr);
 }
+
+/*
+
+folding for optimization passes over AIR, where an operation's operands have already been converted to its type.
+unlike in constant expressions, overflow isn't an error here: integers wrap like they do on the target, so all
+integer arithmetic is done on 64-bit unsigned values and truncated. operations that would trap or whose result
+isn't determined (division by zero, the most negative value divided by -1, shift counts past the width,
+floating values that don't fit the integer they're converted to) aren't folded, and NULL is returned instead.
+
+long doubles and addresses are never folded.
+
+*/
+
+constexpr_t* constexpr_make_arithmetic(c_type_t* ct, void* data)
+{
+    constexpr_t* ce = calloc(1, sizeof *ce);
+    ce->type = type_is_integer(ct) ? CE_INTEGER : CE_ARITHMETIC;
+    copy_typed_data(ce, type_copy(ct), data);
+    return ce;
+}
+
+static bool integer_is_signed(c_type_t* ct)
+{
+    return type_is_signed_integer(ct) || ct->class == CTC_CHAR;
+}
+
+// sign or zero extended to 64 bits
+static uint64_t integer_bits(constexpr_t* ce)
+{
+    long long size = type_size(ce->ct);
+    uint64_t value = 0;
+    memcpy(&value, ce->content.data, size);
+    if (integer_is_signed(ce->ct) && size < 8 && (value >> (size * 8 - 1)) & 1)
+        value |= ~0ULL << (size * 8);
+    return value;
+}
+
+static constexpr_t* integer_result(c_type_t* rt, uint64_t value)
+{
+    if (!type_is_integer(rt))
+        return NULL;
+    return constexpr_make_arithmetic(rt, &value);
+}
+
+static bool foldable(constexpr_t* ce)
+{
+    return ce && ce->type != CE_ADDRESS && (type_is_integer(ce->ct) || type_is_sse_floating(ce->ct));
+}
+
+static constexpr_t* fold_integer_unary(punctuator_type_t op, constexpr_t* operand, c_type_t* rt)
+{
+    uint64_t a = integer_bits(operand);
+    switch (op)
+    {
+        case P_PLUS: return integer_result(rt, a);
+        case P_MINUS: return integer_result(rt, -a);
+        case P_TILDE: return integer_result(rt, ~a);
+        case P_EXCLAMATION_POINT: return integer_result(rt, !a);
+        default: return NULL;
+    }
+}
+
+#define fold_floating_unary(t) \
+    { \
+        t a = data_as(operand->content.data, t); \
+        if (op == P_EXCLAMATION_POINT) \
+            return integer_result(rt, !a); \
+        if (rt->class != operand->ct->class) \
+            return NULL; \
+        t value = 0; \
+        switch (op) \
+        { \
+            case P_PLUS: value = a; break; \
+            case P_MINUS: value = -a; break; \
+            default: return NULL; \
+        } \
+        return constexpr_make_arithmetic(rt, to_data(value)); \
+    }
+
+constexpr_t* constexpr_fold_unary(punctuator_type_t op, constexpr_t* operand, c_type_t* rt)
+{
+    if (!foldable(operand) || !rt)
+        return NULL;
+    if (type_is_integer(operand->ct))
+        return fold_integer_unary(op, operand, rt);
+    if (operand->ct->class == CTC_FLOAT)
+        fold_floating_unary(float)
+    if (operand->ct->class == CTC_DOUBLE)
+        fold_floating_unary(double)
+    return NULL;
+}
+
+#undef fold_floating_unary
+
+static constexpr_t* fold_integer_binary(punctuator_type_t op, constexpr_t* lhs, constexpr_t* rhs, c_type_t* rt)
+{
+    bool sign = integer_is_signed(lhs->ct);
+    uint64_t a = integer_bits(lhs), b = integer_bits(rhs);
+    int64_t sa = (int64_t) a, sb = (int64_t) b;
+    uint64_t width = type_size(lhs->ct) * 8;
+    switch (op)
+    {
+        case P_PLUS: return integer_result(rt, a + b);
+        case P_MINUS: return integer_result(rt, a - b);
+        case P_ASTERISK: return integer_result(rt, a * b);
+        case P_SLASH:
+        case P_PERCENT:
+            if (!b)
+                return NULL;
+            if (!sign)
+                return integer_result(rt, op == P_SLASH ? a / b : a % b);
+            // the most negative value of the width
+            if (sa == (int64_t) (~0ULL << (width - 1)) && sb == -1)
+                return NULL;
+            return integer_result(rt, op == P_SLASH ? (uint64_t) (sa / sb) : (uint64_t) (sa % sb));
+        case P_AND: return integer_result(rt, a & b);
+        case P_PIPE: return integer_result(rt, a | b);
+        case P_CARET: return integer_result(rt, a ^ b);
+        case P_LEFT_SHIFT:
+            if (b >= width)
+                return NULL;
+            return integer_result(rt, a << b);
+        case P_RIGHT_SHIFT:
+            if (b >= width)
+                return NULL;
+            // signed values are already sign extended, so this is an arithmetic shift for them
+            return integer_result(rt, sign ? (uint64_t) (sa < 0 ? ~(~a >> b) : a >> b) : a >> b);
+        case P_LESS: return integer_result(rt, sign ? sa < sb : a < b);
+        case P_LESS_EQUAL: return integer_result(rt, sign ? sa <= sb : a <= b);
+        case P_GREATER: return integer_result(rt, sign ? sa > sb : a > b);
+        case P_GREATER_EQUAL: return integer_result(rt, sign ? sa >= sb : a >= b);
+        case P_EQUAL: return integer_result(rt, a == b);
+        case P_INEQUAL: return integer_result(rt, a != b);
+        default: return NULL;
+    }
+}
+
+#define fold_floating_binary(t) \
+    { \
+        t a = data_as(lhs->content.data, t), b = data_as(rhs->content.data, t); \
+        switch (op) \
+        { \
+            case P_LESS: return integer_result(rt, a < b); \
+            case P_LESS_EQUAL: return integer_result(rt, a <= b); \
+            case P_GREATER: return integer_result(rt, a > b); \
+            case P_GREATER_EQUAL: return integer_result(rt, a >= b); \
+            case P_EQUAL: return integer_result(rt, a == b); \
+            case P_INEQUAL: return integer_result(rt, a != b); \
+            default: break; \
+        } \
+        if (rt->class != lhs->ct->class) \
+            return NULL; \
+        t value = 0; \
+        switch (op) \
+        { \
+            case P_PLUS: value = a + b; break; \
+            case P_MINUS: value = a - b; break; \
+            case P_ASTERISK: value = a * b; break; \
+            case P_SLASH: value = a / b; break; \
+            default: return NULL; \
+        } \
+        return constexpr_make_arithmetic(rt, to_data(value)); \
+    }
+
+constexpr_t* constexpr_fold_binary(punctuator_type_t op, constexpr_t* lhs, constexpr_t* rhs, c_type_t* rt)
+{
+    if (!foldable(lhs) || !foldable(rhs) || !rt || lhs->ct->class != rhs->ct->class)
+        return NULL;
+    if (type_is_integer(lhs->ct))
+        return fold_integer_binary(op, lhs, rhs, rt);
+    if (lhs->ct->class == CTC_FLOAT)
+        fold_floating_binary(float)
+    if (lhs->ct->class == CTC_DOUBLE)
+        fold_floating_binary(double)
+    return NULL;
+}
+
+#undef fold_floating_binary
+
+// whether a floating value is within the range of an integer type, so converting it is defined
+static bool floating_fits(long double value, c_type_t* to)
+{
+    long double limit = (long double) (1ULL << (type_size(to) * 8 - 1));
+    if (integer_is_signed(to))
+        return value >= -limit && value < limit;
+    return value > -1.0L && value < limit * 2.0L;
+}
+
+constexpr_t* constexpr_fold_conversion(constexpr_t* ce, c_type_t* to)
+{
+    if (!foldable(ce) || !to || !(type_is_integer(to) || type_is_sse_floating(to)))
+        return NULL;
+    if (type_is_sse_floating(ce->ct) && type_is_integer(to))
+    {
+        long double value = ce->ct->class == CTC_FLOAT ? data_as(ce->content.data, float) : data_as(ce->content.data, double);
+        if (!floating_fits(value, to))
+            return NULL;
+    }
+    constexpr_t* converted = constexpr_copy(ce);
+    constexpr_convert(converted, to);
+    if (converted->ct->class != to->class)
+    {
+        constexpr_delete(converted);
+        return NULL;
+    }
+    converted->type = type_is_integer(to) ? CE_INTEGER : CE_ARITHMETIC;
+    return converted;
+}
@@ -0,0 +1,148 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "ecc.h"
+
+/*
+
+def-use index over an AIR routine.
+
+before localization, the linearizer already gives temporaries SSA form: each one is defined exactly once,
+and values that merge at a join are tied together by an AIR_PHI. what was missing was a way to get from a
+temporary to its definition and uses without walking the routine, so this records both for every register
+in one pass, along with each instruction's position so passes can order them.
+
+after localization, PHIs are gone and physical registers are redefined, so a register can have several
+definitions. they are kept in instruction order, like the uses.
+
+an index is a snapshot: a pass that adds, removes, or rewrites instructions must rebuild it afterwards.
+moving an instruction keeps its entries but makes its position stale.
+
+*/
+
+static void add_entry(imap_t* m, regid_t reg, air_insn_t* insn)
+{
+    vector_t* v = (vector_t*) imap_get(m, reg);
+    if (!v)
+    {
+        v = vector_init();
+        imap_add(m, reg, (uint64_t) v);
+    }
+    // an instruction that uses a register more than once is only recorded once
+    if (v->size && vector_peek(v) == insn)
+        return;
+    vector_add(v, insn);
+}
+
+static void add_use(air_defuse_t* du, regid_t reg, air_insn_t* insn)
+{
+    if (reg == INVALID_VREGID)
+        return;
+    add_entry(du->uses, reg, insn);
+}
+
+air_defuse_t* air_defuse_init(air_routine_t* routine)
+{
+    air_defuse_t* du = calloc(1, sizeof *du);
+    du->defs = imap_init();
+    du->uses = imap_init();
+    du->positions = imap_init();
+    du->calls = vector_init();
+
+    size_t position = 0;
+    for (air_insn_t* insn = routine->insns; insn; insn = insn->next, ++position)
+    {
+        imap_add(du->positions, insn->id, position);
+        if (insn->type == AIR_FUNC_CALL)
+            vector_add(du->calls, insn);
+        size_t i = 0;
+        if (air_insn_creates_temporary(insn) && insn->noops && insn->ops[0] && insn->ops[0]->type == AOP_REGISTER)
+        {
+            if (insn->ops[0]->content.reg != INVALID_VREGID)
+                add_entry(du->defs, insn->ops[0]->content.reg, insn);
+            i = 1;
+        }
+        for (; i < insn->noops; ++i)
+        {
+            air_insn_operand_t* op = insn->ops[i];
+            if (!op) continue;
+            switch (op->type)
+            {
+                case AOP_REGISTER:
+                    add_use(du, op->content.reg, insn);
+                    break;
+                case AOP_INDIRECT_REGISTER:
+                    add_use(du, op->content.inreg.id, insn);
+                    add_use(du, op->content.inreg.roffset, insn);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    return du;
+}
+
+void air_defuse_delete(air_defuse_t* du)
+{
+    if (!du) return;
+    {
+        IMAP_FOR(regid_t, vector_t*, du->defs)
+        {
+            (void) k;
+            vector_delete(v);
+        }
+    }
+    {
+        IMAP_FOR(regid_t, vector_t*, du->uses)
+        {
+            (void) k;
+            vector_delete(v);
+        }
+    }
+    imap_delete(du->defs);
+    imap_delete(du->uses);
+    imap_delete(du->positions);
+    vector_delete(du->calls);
+    free(du);
+}
+
+// NULL if the register is never defined
+vector_t* air_defuse_definitions(air_defuse_t* du, regid_t reg)
+{
+    return (vector_t*) imap_get(du->defs, reg);
+}
+
+air_insn_t* air_defuse_definition(air_defuse_t* du, regid_t reg)
+{
+    vector_t* defs = air_defuse_definitions(du, reg);
+    return defs ? vector_get(defs, 0) : NULL;
+}
+
+// NULL if the register is never used
+vector_t* air_defuse_uses(air_defuse_t* du, regid_t reg)
+{
+    return (vector_t*) imap_get(du->uses, reg);
+}
+
+size_t air_defuse_position(air_defuse_t* du, air_insn_t* insn)
+{
+    return imap_get(du->positions, insn->id);
+}
+
+// the number of instructions in an instruction-ordered vector from this index that come before the given position
+size_t air_defuse_count_before(air_defuse_t* du, vector_t* insns, size_t position)
+{
+    if (!insns) return 0;
+    size_t lo = 0, hi = insns->size;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (air_defuse_position(du, vector_get(insns, mid)) < position)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <time.h>
+#include <sys/types.h>
 
 #define debug in_debug()
 
@@ -17,16 +18,24 @@
 #define VECTOR_FOR(type, var, vec) type var = (type) vector_get((vec), 0); for (unsigned i = 0; i < (vec)->size; ++i, var = (type) vector_get((vec), i))
 #define deep_free_syntax_vector(vec, var) if (vec) { VECTOR_FOR(syntax_component_t*, var, (vec)) free_syntax(var, tlu); vector_delete((vec)); }
 #define SYMBOL_TABLE_FOR_ENTRIES_START(KEY_VAR, VALUE_VAR, CONTAINER) \
-    for (unsigned i = 0; i < (CONTAINER)->capacity; ++i) \
+    for (unsigned i = 0; i < (CONTAINER)->map->capacity; ++i) \
     { \
-        if (!(CONTAINER)->key[i]) continue; \
-        char* KEY_VAR = (CONTAINER)->key[i]; \
-        symbol_t* VALUE_VAR = (CONTAINER)->value[i]; \
+        if (!(CONTAINER)->map->key[i] || (CONTAINER)->map->key[i] == (void*) (-1)) continue; \
+        char* KEY_VAR = (CONTAINER)->map->key[i]; \
+        symbol_t* VALUE_VAR = (CONTAINER)->map->value[i]; \
 
 #define SYMBOL_TABLE_FOR_ENTRIES_END }
 
-#define MAP_FOR(ktype, vtype, map) ktype k = (ktype) (map)->key[0]; vtype v = (vtype) (map)->value[0]; for (unsigned i = 0; i < (map)->capacity; ++i, k = (ktype) (map)->key[i], v = (vtype) (map)->value[i])
+#define MAP_FOR(ktype, vtype, map) ktype k = (ktype) (map)->key[0]; vtype v = (vtype) (map)->value[0]; for (unsigned i = 0; i < (map)->capacity; ++i, k = (ktype) (i < (map)->capacity ? (map)->key[i] : NULL), v = (vtype) (i < (map)->capacity ? (map)->value[i] : NULL))
 #define MAP_IS_BAD_KEY (!k || (void*) k == (void*) (-1))
+#define IMAP_FOR(ktype, vtype, map) ktype k = 0; vtype v = 0; for (size_t i = 0; i < (map)->capacity; ++i) \
+    if ((map)->keys[i] != IMAP_EMPTY && ((k = (ktype) (map)->keys[i]), (v = (vtype) (map)->values[i]), true))
+
+// sets of small positive integers, as arrays of 64-bit words
+#define BITSET_WORDS(count) (((count) + 63) / 64)
+#define BITSET_HAS(set, index) ((set)[((index) - 1) / 64] & (1ULL << (((index) - 1) % 64)))
+#define BITSET_ADD(set, index) ((set)[((index) - 1) / 64] |= (1ULL << (((index) - 1) % 64)))
+#define BITSET_REMOVE(set, index) ((set)[((index) - 1) / 64] &= ~(1ULL << (((index) - 1) % 64)))
 
 #define MAX_ERROR_LENGTH 512
 #define MAX_STRINGIFIED_INTEGER_LENGTH 30
@@ -92,6 +101,7 @@
 typedef int (*comparator_t)(void*, void*);
 typedef void (*deleter_t)(void*);
 typedef unsigned long (*hash_function_t)(void*);
+typedef void (*pool_job_t)(size_t index, void* context);
 
 typedef unsigned long long regid_t;
 
@@ -257,6 +267,7 @@ typedef enum token_type
     T_CHARACTER_CONSTANT,
     T_STRING_LITERAL,
     T_PUNCTUATOR,
+    T_END,
     T_NO_ELEMENTS
 } token_type_t;
 
@@ -291,7 +302,8 @@ typedef enum c_type_class
     CTC_FUNCTION,
     CTC_POINTER,
     CTC_LABEL,
-    CTC_ERROR
+    CTC_ERROR,
+    CTC_VECTOR // only made by the optimizer: array.length lanes of derived_from, held in an SSE register
 } c_type_class_t;
 
 typedef enum intrinsic_function
@@ -305,6 +317,7 @@ typedef enum intrinsic_function
     IF_LSYS_OPEN,
     IF_LSYS_CLOSE,
     IF_LSYS_MMAP,
+    IF_LSYS_IOCTL,
 
     IF_NO_ELEMENTS
 } intrinsic_function_t;
@@ -321,6 +334,19 @@ typedef struct symbol_t symbol_t;
 typedef struct designation designation_t;
 typedef struct vector_t vector_t;
 typedef struct constexpr constexpr_t;
+typedef struct map_t map_t;
+typedef struct imap imap_t;
+typedef struct bitset bitset_t;
+typedef struct arena arena_t;
+
+// what -O asks for, see pass.c
+typedef enum optimization_level
+{
+    OPTIMIZE_NONE, // -O0
+    OPTIMIZE_LIGHT, // -O1
+    OPTIMIZE_FULL, // -O2, the default
+    OPTIMIZE_SIZE // -Os
+} optimization_level_t;
 
 typedef struct program_options
 {
@@ -335,9 +361,106 @@ typedef struct program_options
     bool rflag;
     bool ssflag;
     bool cflag;
+    bool hhflag;
+    bool eflag;
+    bool ffflag;
+    bool bflag;
     char* oflag;
+    char* uflag;
+    char* bbflag;
+    int jflag;
+    bool tflag;
+    char* ttflag;
+    char* ccflag;
+    char* sflag;
+    char* wflag;
+    bool mflag; // -M and -MM
+    bool mdflag; // -MD and -MMD
+    bool mmflag; // -MM and -MMD
+    char* mfflag;
+    optimization_level_t olevel;
+    bool wwflag;
 } program_options_t;
 
+// what the report from -t and -T breaks a compilation into, see stats.c
+typedef enum compile_phase
+{
+    PHASE_LEX,
+    PHASE_PREPROCESS,
+    PHASE_STRLITCONCAT,
+    PHASE_TOKENIZE,
+    PHASE_PARSE,
+    PHASE_TYPE,
+    PHASE_ANALYZE,
+    PHASE_AIRINIZE,
+    PHASE_MERGE,
+    PHASE_OPT1,
+    PHASE_INLINE, // the passes' phases are part of their optimizer's
+    PHASE_PROPAGATE,
+    PHASE_NUMBER,
+    PHASE_LOOPS,
+    PHASE_DEAD_CODE,
+    PHASE_CALLS,
+    PHASE_LIFETIMES,
+    PHASE_LAYOUT,
+    PHASE_LOCALIZE,
+    PHASE_ALLOCATE,
+    PHASE_GENERATE,
+    PHASE_OPT4,
+    PHASE_PEEPHOLE,
+    PHASE_EMIT,
+    PHASE_WRITE,
+    PHASE_ASSEMBLE,
+    PHASE_LINK,
+    PHASE_NO_ELEMENTS
+} compile_phase_t;
+
+typedef enum compile_counter
+{
+    COUNTER_TOKENS,
+    COUNTER_SYNTAX_NODES,
+    COUNTER_AIR_INSNS,
+    COUNTER_OPTIMIZED_AIR_INSNS,
+    COUNTER_X86_INSNS,
+    COUNTER_NO_ELEMENTS
+} compile_counter_t;
+
+// where a phase started, on the thread it's running on
+typedef struct stats_mark
+{
+    uint64_t wall;
+    uint64_t cpu;
+    uint64_t heap;
+} stats_mark_t;
+
+// everything owned by one compilation, so that several can be in progress at once in the same process
+typedef struct compilation
+{
+    program_options_t* options;
+    char* filepath;
+    map_t* profile; // from -B, see layout.c
+    size_t threads; // for the back end
+    time_t translation_time;
+    char error[MAX_ERROR_LENGTH];
+
+    // if set, the back end opens this file once the front end is done and streams each routine into it as it's finished
+    char* stream_path;
+    bool stream_object; // as an ELF object rather than assembly
+    FILE* stream;
+    bool unencodable; // the object couldn't be encoded, so it needs the assembler
+
+    // with -C, see cache.c
+    char* cache_target; // where the output goes, and where a hit is copied to
+    bool cache_object; // the output is an object, even if what's streamed is assembly for the assembler
+    char* cache_key; // once the file's been preprocessed
+    bool cache_hit; // so nothing was compiled
+    bool diagnosed; // there were warnings, which a hit wouldn't print
+
+    bool dependencies_written; // for -M, which stops there
+
+    vector_t* program; // vector_t<char*>, with -W every file that goes into the output, filepath being the first
+} compilation_t;
+
 typedef struct init_address
 {
     symbol_t* sy;
@@ -398,29 +521,50 @@ typedef struct preprocessing_token
     };
 } preprocessing_token_t;
 
+typedef struct preprocessing_macro
+{
+    preprocessing_token_t* repl_list;
+    vector_t* id_list; // NULL for object-like macros
+    bool variadic;
+} preprocessing_macro_t;
+
 typedef struct preprocessing_table
 {
-    char** key;
-    preprocessing_token_t** v_repl_list;
-    vector_t** v_id_list;
-    bool* v_variadic_list; 
-    unsigned size;
-    unsigned capacity;
+    map_t* macros; // map_t<char*, preprocessing_macro_t*>
 } preprocessing_table_t;
 
+typedef struct include_cache_entry
+{
+    // raw tokens from the first time the file was lexed, copied for every later inclusion
+    preprocessing_token_t* tokens;
+    // the macro guarding the whole file (#ifndef X / #define X ... #endif), if there is one
+    char* guard;
+} include_cache_entry_t;
+
 typedef struct preprocessing_settings
 {
     time_t* translation_time;
     char* filepath;
     char* error;
     preprocessing_table_t* table;
+    map_t* include_cache; // map_t<char*, include_cache_entry_t*>, shared by every file in a translation unit
+    vector_t* dependencies; // vector_t<char*>, every file #include'd, once each in the order they were first, if set
+    program_options_t* options;
 } preprocessing_settings_t;
 
+// tokens are stored in one contiguous array, anything that doesn't fit in the payload union is in the tokenizing arena
 typedef struct token
 {
     token_type_t type;
     unsigned row, col;
-    token_t* next;
+    union
+    {
+        // T_INTEGER_CONSTANT, T_FLOATING_CONSTANT
+        c_type_class_t class;
+
+        // T_CHARACTER_CONSTANT, T_STRING_LITERAL
+        bool wide;
+    };
     union
     {
         // T_KEYWORD
@@ -430,32 +574,17 @@ typedef struct token
         char* identifier;
 
         // T_INTEGER_CONSTANT
-        struct
-        {
-            unsigned long long value;
-            c_type_class_t class;
-        } integer_constant;
+        unsigned long long integer_constant;
 
         // T_FLOATING_CONSTANT
-        struct
-        {
-            long double value;
-            c_type_class_t class;
-        } floating_constant;
+        long double* floating_constant;
 
         // T_CHARACTER_CONSTANT
-        struct
-        {
-            int value;
-            bool wide;
-        } character_constant;
+        int character_constant;
 
         // T_STRING_LITERAL
-        struct
-        {
-            char* value_reg;
-            int* value_wide;
-        } string_literal;
+        char* string_literal;
+        int* string_literal_wide;
 
         // T_PUNCTUATOR
         punctuator_type_t punctuator;
@@ -466,6 +595,7 @@ typedef struct tokenizing_settings
 {
     char* filepath;
     char* error;
+    arena_t* arena; // tokens and their string literal contents are allocated here
 } tokenizing_settings_t;
 
 typedef struct allocator_options
@@ -489,6 +619,18 @@ typedef struct vector_t
     unsigned size;
 } vector_t;
 
+#define SVECTOR_INLINE 4
+
+// a vector of integers that keeps its first few in place, so short ones never allocate. zeroed is empty, and it
+// can't be moved once something is in it
+typedef struct svector
+{
+    uint64_t* data; // inline until it outgrows it
+    unsigned capacity;
+    unsigned size;
+    uint64_t inline_data[SVECTOR_INLINE];
+} svector_t;
+
 typedef struct c_type c_type_t;
 
 typedef struct c_type
@@ -496,6 +638,7 @@ typedef struct c_type
     c_type_class_t class;
     unsigned char qualifiers;
     unsigned char function_specifiers;
+    bool interned; // shared by everything that uses an equal type, so it never changes (see type_intern)
     c_type_t* derived_from;
     union
     {
@@ -624,6 +767,7 @@ typedef struct air_insn_operand {
 //  AIR_JZ:                          jz(.L1, _1);
 //  AIR_JNZ:                         jnz(.L1, _1);
 //  AIR_JMP:                         jmp(.L1);
+//  AIR_JMP_TABLE:                   jmp_table(_1, .L1, .L2, .L3);
 //  AIR_LABEL:                       .L1:
 //  AIR_DIRECT_SHIFT_LEFT:           _1 <<= _2;
 //  AIR_DIRECT_OR:                   _1 |= _2;
@@ -686,6 +830,7 @@ typedef enum air_insn_type {
     AIR_JZ,
     AIR_JNZ,
     AIR_JMP,
+    AIR_JMP_TABLE,
     AIR_LABEL,
     AIR_PUSH,
     AIR_VA_ARG,
@@ -700,6 +845,7 @@ typedef enum air_insn_type {
 typedef struct air_insn air_insn_t;
 
 typedef struct air_insn {
+    size_t id; // stays the same for the instruction's whole life and is unique within its routine, for side tables keyed by instruction
     air_insn_type_t type;
     c_type_t* ct;
     air_insn_t* prev;
@@ -709,6 +855,16 @@ typedef struct air_insn {
     struct {
         // function calls that return structs have C type "pointer to struct." this disambiguates struct returns from ptr to struct returns. 
         bool fcall_sret;
+        // calls to variadic or unprototyped functions tell the callee how many vector registers hold arguments
+        bool fcall_counts_vectors;
+        // function calls in tail position jump to the callee after the epilogue instead of calling it
+        bool fcall_tail;
+        // the first instruction of the block the callee-saved registers are saved in, when it isn't the entry
+        bool saves_nonvolatiles;
+        // returns and tail calls on the paths that saved them there
+        bool restores_nonvolatiles;
+        // comparisons only used by the conditional jump right after them, which branches on the flags they set
+        bool fuses_branch;
     } metadata;
 } air_insn_t;
 
@@ -719,16 +875,82 @@ typedef struct air_data {
     vector_t* addresses;
 } air_data_t;
 
+typedef struct air_block air_block_t;
+
+typedef struct air_block {
+    size_t id; // position in the routine
+    air_insn_t* first;
+    air_insn_t* last;
+    vector_t* predecessors; // vector_t<air_block_t*>
+    vector_t* successors; // vector_t<air_block_t*>
+    bool reachable;
+    size_t rpo; // position in reverse postorder, if reachable
+    air_block_t* idom; // immediate dominator, NULL for the entry and unreachable blocks
+    vector_t* dominated; // vector_t<air_block_t*>, children in the dominator tree
+    size_t dom_pre; // dominator tree numbering for constant-time dominance checks
+    size_t dom_post;
+} air_block_t;
+
+typedef struct air_loop {
+    air_block_t* header; // the block every entry into the loop goes through
+    vector_t* blocks; // vector_t<air_block_t*>, in instruction order, including the header
+    bool* contains; // indexed by block id
+    vector_t* latches; // vector_t<air_block_t*>, blocks with a back edge to the header
+    air_block_t* preheader; // the only block outside the loop that enters it, NULL if there are several
+} air_loop_t;
+
+typedef struct air_cfg {
+    vector_t* blocks; // vector_t<air_block_t*>, in instruction order starting with the entry
+    vector_t* rpo; // vector_t<air_block_t*>, reachable blocks in reverse postorder
+    map_t* insn_blocks; // map_t<air_insn_t*, air_block_t*>
+    vector_t* loops; // vector_t<air_loop_t*>, natural loops, inner loops before the loops containing them
+} air_cfg_t;
+
+typedef struct air_defuse {
+    imap_t* defs; // imap_t<regid_t, vector_t<air_insn_t*>*>, in instruction order
+    imap_t* uses; // imap_t<regid_t, vector_t<air_insn_t*>*>, in instruction order
+    imap_t* positions; // imap_t<insn id, size_t>
+    vector_t* calls; // vector_t<air_insn_t*>, in instruction order
+} air_defuse_t;
+
+// what the back end makes for a routine while lowering it, see air_lower
+typedef struct air_lowering {
+    arena_t* arena; // instructions and operands
+    vector_t* insns; // vector_t<air_insn_t*>, every instruction allocated from the arena
+    vector_t* operands; // vector_t<air_insn_operand_t*>, every operand allocated from the arena
+    regid_t next_available_temporary;
+    size_t next_insn_id;
+} air_lowering_t;
+
 typedef struct air_routine {
     symbol_t* sy;
     air_insn_t* insns;
     symbol_t* retptr;
     bool uses_varargs;
+    bool omits_frame_pointer; // locals are addressed from %rsp, and %rbp is allocated like any other register
+    uint16_t used_nonvolatiles; // the callee-saved registers the allocator handed out, as USED_NONVOLATILES_* flags
+    bool wraps_nonvolatiles; // they're saved somewhere other than the prologue, see allocate.c
+    long long outgoing; // bytes of stack arguments the routine's calls pass at %rsp, see localize.c
+    unsigned long long cold_label; // starts the blocks layout moved past the epilogue, 0 if there are none
+    air_cfg_t* cfg; // built on demand, see cfg.c
+    air_lowering_t* lowering; // NULL until the back end starts on it
 } air_routine_t;
 
+typedef struct air_liveness {
+    air_routine_t* routine;
+    air_cfg_t* cfg;
+    imap_t* indices; // imap_t<regid_t, size_t>, one more than each register's index in registers
+    vector_t* registers; // vector_t<regid_t>, every register the routine names
+    imap_t* implicit_uses; // imap_t<insn id, svector_t<regid_t>*>, registers read without being named
+    size_t words; // per set
+    unsigned long long* in; // live-in sets, words per block by block id
+    unsigned long long* out; // live-out sets
+} air_liveness_t;
+
 typedef struct air {
     vector_t* rodata; // <air_data_t*>
     vector_t* data; // <air_data_t*>
+    vector_t* profile; // <air_data_t*>, the branch counters of instrumented routines
     vector_t* routines; // <air_routine_t*>
     symbol_table_t* st;
     air_locale_t locale;
@@ -737,6 +959,16 @@ typedef struct air {
     unsigned long long next_available_lv;
     symbol_t* sse32_negater;
     symbol_t* sse64_negater;
+    symbol_t* memcpy_routine; // called for big aggregate copies
+    symbol_t* memset_routine; // and fills
+    unsigned long long next_available_folded_constant;
+    unsigned long long next_available_inlined_label;
+    unsigned long long next_available_vectorized_label;
+    unsigned long long next_available_layout_label;
+
+    arena_t* arena; // instructions and operands
+    vector_t* insns; // vector_t<air_insn_t*>, every instruction allocated from the arena
+    vector_t* operands; // vector_t<air_insn_operand_t*>, every operand allocated from the arena
 } air_t;
 
 typedef enum x86_operand_type
@@ -807,6 +1039,14 @@ typedef enum x86_insn_type
     X86I_JNE,
     X86I_JNB,
     X86I_JS,
+    X86I_JL,
+    X86I_JLE,
+    X86I_JG,
+    X86I_JGE,
+    X86I_JA,
+    X86I_JB,
+    X86I_JBE,
+    X86I_JP,
     X86I_CMP,
     X86I_SETE,
     X86I_SETNE,
@@ -816,6 +1056,8 @@ typedef enum x86_insn_type
     X86I_SETG,
     X86I_SETA,
     X86I_SETNB,
+    X86I_SETB,
+    X86I_SETBE,
     X86I_SETP,
     X86I_SETNP,
     X86I_AND,
@@ -884,6 +1126,27 @@ typedef enum x86_insn_type
 
     X86I_SYSCALL,
 
+    X86I_CQTO,
+
+    X86I_TAIL_JMP, // a jmp that's preceded by the routine's epilogue when written
+
+    // packed SSE2, for vectorized loops. memory operands are only ever moved to or from, since they needn't be aligned
+    X86I_MOVUPS,
+    X86I_MOVUPD,
+    X86I_MOVDQU,
+    X86I_ADDPS,
+    X86I_ADDPD,
+    X86I_PADDD,
+    X86I_PADDQ,
+    X86I_SUBPS,
+    X86I_SUBPD,
+    X86I_PSUBD,
+    X86I_PSUBQ,
+    X86I_MULPS,
+    X86I_MULPD,
+    X86I_DIVPS,
+    X86I_DIVPD,
+
     X86I_NO_ELEMENTS
 } x86_insn_type_t;
 
@@ -897,13 +1160,35 @@ typedef struct x86_insn
     x86_insn_t* next;
 } x86_insn_t;
 
+// where read-only data goes. everything but X86RS_RODATA is a section the linker can merge, see x86_pool_rodata
+typedef enum x86_rodata_section
+{
+    X86RS_RODATA,
+    X86RS_STR1, // .rodata.str1.1, strings
+    X86RS_STR4, // .rodata.str4.4, wide strings
+    X86RS_CST4, // .rodata.cst4 through .rodata.cst16, constants of that size
+    X86RS_CST8,
+    X86RS_CST16,
+    X86RS_NO_ELEMENTS
+} x86_rodata_section_t;
+
+// another label for (part of) some data, which pooled constants get
+typedef struct x86_asm_alias
+{
+    char* label;
+    size_t offset;
+} x86_asm_alias_t;
+
 typedef struct x86_asm_data
 {
     size_t alignment;
     char* label;
+    bool global;
     bool readonly;
+    x86_rodata_section_t section; // if it's read-only
     unsigned char* data;
     vector_t* addresses;
+    vector_t* aliases; // vector_t<x86_asm_alias_t*>, by offset, if any
     size_t length;
 } x86_asm_data_t;
 
@@ -912,6 +1197,7 @@ typedef struct x86_asm_data
 #define USED_NONVOLATILES_R13 (uint16_t) 0x0004
 #define USED_NONVOLATILES_R14 (uint16_t) 0x0008
 #define USED_NONVOLATILES_R15 (uint16_t) 0x0010
+#define USED_NONVOLATILES_RBP (uint16_t) 0x0020
 
 typedef struct x86_asm_routine
 {
@@ -920,20 +1206,31 @@ typedef struct x86_asm_routine
     char* label;
     long long stackalloc;
     bool uses_varargs;
-    uint16_t used_nonvolatiles;
+    bool omits_frame_pointer;
+    long long slot_bias; // what's been added to the offsets of %rsp-relative stack slots
+    uint16_t used_nonvolatiles; // saved by the prologue
+    uint16_t wrapped_nonvolatiles; // saved by pushes in the body instead
+    long long outgoing; // the outgoing argument area, reserved below everything else in the frame
+    char* cold_label; // where the instructions to put after the epilogue start, if anywhere
     x86_insn_t* insns;
+    vector_t* rodata; // vector_t<x86_asm_data_t>, constants generating it made, moved to the file's when it's added
+    size_t next_constant_local_label;
 } x86_asm_routine_t;
 
 typedef struct x86_asm_file
 {
     vector_t* rodata; // vector_t<x86_asm_data_t>
     vector_t* data; // vector_t<x86_asm_data_t>
+    vector_t* profile; // vector_t<x86_asm_data_t>, goes in the ecc_profile section
     vector_t* routines; // vector_t<x86_asm_routine_t>
     symbol_table_t* st;
     air_t* air;
 
-    size_t next_constant_local_label;
-    uint64_t next_routine_id;
+    // while streaming, each routine goes out as soon as it's added instead of being kept in routines
+    FILE* text_stream; // written here as assembly
+    struct elf_object* object_stream; // or encoded into this object
+    bool text_started;
+
     symbol_t* sse32_zero_checker;
     symbol_t* sse64_zero_checker;
     symbol_t* sse32_i64_limit;
@@ -944,15 +1241,57 @@ typedef struct opt1_options
 {
     bool inline_fcalls;
     bool remove_fcall_passing_lifetimes;
-    bool inline_integer_constant;
+    bool propagate_constants;
+    bool number_values;
+    bool optimize_loops;
+    bool vectorize_loops; // along with optimize_loops
+    bool eliminate_dead_code;
+    size_t inline_threshold; // most instructions a function can have and still be inlined, 0 to not inline
 } opt1_options_t;
 
 typedef struct opt4_options
 {
     bool remove_same_reg_moves;
     bool xor_zero_moves;
+    bool forward_stores;
+    bool remove_store_backs;
+    bool remove_move_backs;
+    bool fold_copies;
+    bool fold_immediates;
+    bool remove_redundant_compares;
+    bool test_zero_compares;
+    bool remove_jumps_to_next;
+    bool invert_branches_over_jumps;
+    bool remove_unreachable_code;
 } opt4_options_t;
 
+// the analyses of an AIR routine a pass can leave standing when it changes the routine, see pass.c
+#define ANALYSIS_CFG 0x1 // along with the dominators and loops, which are part of it
+#define ANALYSIS_LIVENESS 0x2
+#define ANALYSIS_ALL (ANALYSIS_CFG | ANALYSIS_LIVENESS)
+
+// a pass's option when it isn't turned on by a flag of its own
+#define PASS_ALWAYS SIZE_MAX
+
+struct pass_manager;
+
+typedef struct pass
+{
+    compile_phase_t phase; // what the report charges it to
+    size_t option; // offset of the flag in the options that turns it on, or PASS_ALWAYS
+    unsigned keeps; // the analyses it leaves standing when it changes something
+    bool (*run)(struct pass_manager* pm); // whether it changed anything
+} pass_t;
+
+typedef struct pass_manager
+{
+    void* options; // an opt1_options_t or an opt4_options_t
+    void* context; // whatever else the optimizer's passes share
+    air_t* air;
+    air_routine_t* routine; // NULL for x86 passes
+    air_liveness_t* liveness; // the routine's, once a pass has asked for it
+} pass_manager_t;
+
 typedef enum c_namespace_class
 {
     NSC_LABEL,
@@ -1135,6 +1474,15 @@ typedef enum syntax_component_type_t
     SC_NO_ELEMENTS
 } syntax_component_type_t;
 
+#define SC_SUMMARY_WORDS ((SC_NO_ELEMENTS + 63) / 64)
+
+typedef enum constexpr_type
+{
+    CE_INTEGER,
+    CE_ARITHMETIC,
+    CE_ADDRESS
+} constexpr_type_t;
+
 // SC_TYPE_SPECIFIER = SC_BASIC_TYPE_SPECIFIER | SC_STRUCT_UNION_SPECIFIER | SC_ENUM_SPECIFIER | SC_TYPEDEF_NAME
 // SC_DIRECT_DECLARATOR = SC_IDENTIFIER | SC_DECLARATOR | SC_ARRAY_DECLARATOR | SC_FUNCTION_DECLARATOR
 // SC_DIRECT_ABSTRACT_DECLARATOR = SC_ABSTRACT_DECLARATOR | SC_ABSTRACT_ARRAY_DECLARATOR | SC_ABSTRACT_FUNCTION_DECLARATOR
@@ -1156,10 +1504,16 @@ typedef struct syntax_component_t
     unsigned row, col;
     struct syntax_component_t* parent;
 
+    // bit n is set if this node or anything below it is of type n (see traverse_summarize)
+    uint64_t contains[SC_SUMMARY_WORDS];
+
     // additional information
     c_type_t* ctype;
     air_insn_t* code;
 
+    // constant expression results by constexpr_type_t, kept once the expression has been analyzed
+    constexpr_t* constexprs[CE_ADDRESS + 1];
+
     // type-specific additional info for linear IR transformation
 
     // expression types
@@ -1581,13 +1935,6 @@ tag of struct, union, or enum: declared by a SC_TYPE_SPECIFIER
 
 */
 
-typedef enum constexpr_type
-{
-    CE_INTEGER,
-    CE_ARITHMETIC,
-    CE_ADDRESS
-} constexpr_type_t;
-
 typedef struct constexpr
 {
     constexpr_type_t type;
@@ -1623,19 +1970,19 @@ typedef struct symbol_t
 
 typedef struct symbol_table_t
 {
-    char** key;
-    symbol_t** value;
-    unsigned size;
-    unsigned capacity;
+    map_t* map; // map_t<char*, symbol_t*>, each value being the list of every symbol with that name
     vector_t* unique_types; // <c_type_t*>
+    map_t* interned_types; // map_t<c_type_t*, c_type_t*>, every interned type, each of which is also in unique_types
 } symbol_table_t;
 
 typedef struct analysis_error
 {
     unsigned row, col;
-    char* message;
+    const char* format; // string literal given to error_init, printed as-is when it has nothing to fill in
+    char* message; // the formatted message, null if the format had no conversions
     bool warning;
     analysis_error_t* next;
+    analysis_error_t* last; // only kept up to date on the first error of a list
 } analysis_error_t;
 
 typedef void (*traversal_function)(syntax_traverser_t* trav, syntax_component_t* syn);
@@ -1649,13 +1996,18 @@ typedef struct syntax_traverser
 
     traversal_function before[SC_NO_ELEMENTS];
     traversal_function after[SC_NO_ELEMENTS];
+
+    // types with something to do, filled in by traverse()
+    uint64_t handled[SC_SUMMARY_WORDS];
 } syntax_traverser_t;
 
 typedef struct map_t
 {
     void** key;
     void** value;
+    unsigned long* hashes;
     size_t size;
+    size_t tombstones;
     size_t capacity;
     int (*comparator)(void*, void*);
     unsigned long (*hash)(void*);
@@ -1665,12 +2017,32 @@ typedef struct map_t
     void (*value_deleter)(void* value);
 } map_t;
 
+#define IMAP_EMPTY UINT64_MAX
+
+typedef struct imap
+{
+    uint64_t* keys; // IMAP_EMPTY in free slots
+    uint64_t* values;
+    size_t capacity; // a power of two
+    size_t size;
+    unsigned shift; // 64 - log2(capacity), to take a slot from the top bits of the hash
+} imap_t;
+
+typedef struct bitset
+{
+    uint64_t* words;
+    size_t count;
+} bitset_t;
+
+typedef struct arena
+{
+    struct arena_chunk* chunks;
+    size_t chunk_size;
+} arena_t;
+
 typedef struct graph
 {
-    map_t* lists; // map_t<void*, set_t<void*>*>*
-    int (*comparator)(void*, void*);
-    unsigned long (*hash)(void*);
-    void (*vertex_deleter)(void*);
+    imap_t* lists; // imap_t<uint64_t, bitset_t*>, each vertex's neighbors
 } graph_t;
 
 /* log.c */
@@ -1686,6 +2058,7 @@ buffer_t* buffer_init(void);
 buffer_t* buffer_append(buffer_t* b, char c);
 buffer_t* buffer_append_wide(buffer_t* b, int c);
 buffer_t* buffer_append_str(buffer_t* b, char* str);
+buffer_t* buffer_append_bytes(buffer_t* b, const char* bytes, unsigned count);
 buffer_t* buffer_pop(buffer_t* b);
 void buffer_delete(buffer_t* b);
 char* buffer_export(buffer_t* b);
@@ -1706,6 +2079,17 @@ void* vector_pop(vector_t* v);
 void* vector_peek(vector_t* v);
 void vector_concat(vector_t* v, vector_t* u);
 void vector_merge(vector_t* v, vector_t* u, int (*c)(void*, void*));
+void svector_add(svector_t* v, uint64_t el);
+void svector_add_if_new(svector_t* v, uint64_t el);
+void svector_free(svector_t* v);
+
+/* arena.c */
+arena_t* arena_init(void);
+void* arena_alloc(arena_t* a, size_t size);
+void* arena_memdup(arena_t* a, void* data, size_t size);
+char* arena_strdup(arena_t* a, char* str);
+void arena_absorb(arena_t* a, arena_t* other);
+void arena_delete(arena_t* a);
 
 /* map.c */
 map_t* map_init(int (*comparator)(void*, void*), unsigned long (*hash)(void*));
@@ -1730,6 +2114,35 @@ void set_delete(map_t* m);
 void set_print(map_t* m, int (*printer)(const char*, ...));
 void* set_get(map_t* m, void *key);
 
+/* imap.c */
+imap_t* imap_init(void);
+void imap_delete(imap_t* m);
+uint64_t imap_add(imap_t* m, uint64_t key, uint64_t value);
+uint64_t imap_get(imap_t* m, uint64_t key);
+bool imap_contains(imap_t* m, uint64_t key);
+uint64_t imap_remove(imap_t* m, uint64_t key);
+void imap_clear(imap_t* m);
+
+bitset_t* bitset_init(void);
+void bitset_delete(bitset_t* b);
+void bitset_add(bitset_t* b, uint64_t index);
+void bitset_remove(bitset_t* b, uint64_t index);
+bool bitset_has(bitset_t* b, uint64_t index);
+
+/* pool.c */
+void pool_run(size_t count, size_t threads, pool_job_t job, pool_job_t finish, void* context);
+void pool_lock(void);
+void pool_unlock(void);
+
+/* stats.c */
+bool stats_enabled(void);
+void stats_start(char* name);
+stats_mark_t stats_begin(void);
+void stats_end(compile_phase_t phase, stats_mark_t* mark);
+void stats_count(compile_counter_t counter, uint64_t n);
+pid_t stats_wait(pid_t pid, int* status, compile_phase_t phase, stats_mark_t* mark);
+bool stats_finish(void);
+
 /* const.c */
 extern const char* KEYWORDS[37];
 extern const char* SYNTAX_COMPONENT_NAMES[SC_NO_ELEMENTS];
@@ -1754,7 +2167,7 @@ extern const char* ABSTRACT_DECLARATOR_NAMES[4];
 extern const char* ABSTRACT_DECLARATOR_NAMES[4];
 extern const char* BOOL_NAMES[2];
 extern const char* LEXER_TOKEN_NAMES[8];
-extern const char* C_TYPE_CLASS_NAMES[30];
+extern const char* C_TYPE_CLASS_NAMES[31];
 extern const char* C_NAMESPACE_CLASS_NAMES[7];
 extern const char* PP_TOKEN_NAMES[PPT_NO_ELEMENTS];
 extern const char* TOKEN_NAMES[T_NO_ELEMENTS];
@@ -1784,9 +2197,32 @@ bool pp_token_equals(preprocessing_token_t* t1, preprocessing_token_t* t2);
 char* pp_token_stringify_range(preprocessing_token_t* start, preprocessing_token_t* end);
 
 /* preprocess.c */
+preprocessing_table_t* preprocessing_table_init(void);
+preprocessing_token_t* preprocessing_table_add(preprocessing_table_t* t, char* k, preprocessing_token_t* token, preprocessing_token_t* end, vector_t* id_list, bool variadic);
+void preprocessing_table_delete(preprocessing_table_t* t);
+map_t* include_cache_init(void);
+char* include_cache_key(char* path);
+include_cache_entry_t* include_cache_record(map_t* cache, char* path, preprocessing_token_t* tokens);
+void include_cache_entry_delete(include_cache_entry_t* entry);
 bool preprocess(preprocessing_token_t** tokens, preprocessing_settings_t* settings);
 void strlitconcat(preprocessing_token_t* tokens);
 
+/* pch.c */
+bool pch_write(char* path, preprocessing_table_t* table, map_t* include_cache, preprocessing_token_t* tokens);
+bool pch_read(char* path, preprocessing_table_t** table, map_t** include_cache, preprocessing_token_t** tokens);
+
+/* cache.c */
+char* cache_key(compilation_t* c, preprocessing_token_t* tokens);
+bool cache_fetch(char* dir, char* key, char* target);
+void cache_store(char* dir, char* key, char* path);
+
+/* server.c */
+map_t* server_include_cache(void);
+void server_learn_includes(map_t* include_cache);
+bool server_pch(char* path, preprocessing_table_t** table, map_t** include_cache, preprocessing_token_t** tokens);
+int serve(char* path);
+int server_request(char* path, int argc, char** argv);
+
 /* parse.c */
 syntax_component_t* parse_if_directive_expression(token_t* tokens, char* error);
 syntax_component_t* parse(token_t* toks);
@@ -1795,6 +2231,9 @@ syntax_component_t* parse(token_t* toks);
 syntax_traverser_t* traverse_init(syntax_component_t* tlu, size_t size);
 void traverse_delete(syntax_traverser_t* trav);
 void traverse(syntax_traverser_t* trav);
+void traverse_no_action(syntax_traverser_t* trav, syntax_component_t* syn);
+size_t traverse_count(syntax_component_t* syn);
+void traverse_summarize(syntax_component_t* syn);
 
 /* analyze.c */
 analysis_error_t* analyze(syntax_component_t* tlu);
@@ -1809,6 +2248,7 @@ void dump_errors(analysis_error_t* errors);
 symbol_t* symbol_init(syntax_component_t* declarer);
 syntax_component_t* symbol_get_scope(symbol_t* sy);
 bool scope_is_block(syntax_component_t* scope);
+bool scope_is_file(syntax_component_t* scope);
 storage_duration_t symbol_get_storage_duration(symbol_t* sy);
 linkage_t symbol_get_linkage(symbol_t* sy);
 void symbol_print(symbol_t* sy, int (*printer)(const char*, ...));
@@ -1822,6 +2262,7 @@ symbol_t* symbol_table_get_syn_id(symbol_table_t* t, syntax_component_t* id);
 symbol_t* symbol_table_lookup(symbol_table_t* t, syntax_component_t* id, c_namespace_t* ns);
 symbol_t* symbol_table_count(symbol_table_t* t, syntax_component_t* id, c_namespace_t* ns, vector_t** symbols, bool* first);
 symbol_t* symbol_table_remove(symbol_table_t* t, syntax_component_t* id);
+void symbol_table_merge(symbol_table_t* t, symbol_table_t* from);
 void symbol_table_print(symbol_table_t* t, int (*printer)(const char*, ...));
 void symbol_table_delete(symbol_table_t* t, bool free_contents);
 symbol_t* symbol_table_get_by_classes(symbol_table_t* t, char* k, c_type_class_t ctc, c_namespace_class_t nsc);
@@ -1871,6 +2312,7 @@ int64_t syntax_get_full_initialization_offset(syntax_component_t* initializer);
 /* type.c */
 c_type_t* make_basic_type(c_type_class_t class);
 c_type_t* make_reference_type(c_type_t* ct);
+c_type_t* make_vector_type(c_type_t* element, long long lanes);
 c_type_t* integer_promotions(c_type_t* ct);
 c_type_t* default_argument_promotions(c_type_t* ct);
 void usual_arithmetic_conversions(c_type_t* t1, c_type_t* t2, c_type_t** conv_t1, c_type_t** conv_t2);
@@ -1881,6 +2323,7 @@ long long type_alignment(c_type_t* ct);
 long long type_size(c_type_t* ct);
 void type_delete(c_type_t* ct);
 void symbol_type_delete(c_type_t* ct);
+void symbol_types_delete(vector_t* types);
 c_type_t* type_compose(c_type_t* t1, c_type_t* t2);
 bool type_is_compatible(c_type_t* t1, c_type_t* t2);
 bool type_is_compatible_ignore_qualifiers(c_type_t* t1, c_type_t* t2);
@@ -1898,6 +2341,7 @@ int get_integer_conversion_rank(c_type_t* ct);
 bool type_is_object_type(c_type_t* ct);
 bool type_is_sse_floating_type(c_type_class_t class);
 bool type_is_sse_floating(c_type_t* ct);
+bool type_is_vector(c_type_t* ct);
 bool type_is_real_floating_type(c_type_class_t class);
 bool type_is_real_floating(c_type_t* ct);
 bool type_is_real_type(c_type_class_t class);
@@ -1923,10 +2367,18 @@ c_type_t* create_type_with_errors(analysis_error_t* errors, syntax_component_t*
 c_type_t* create_type(syntax_component_t* specifying, syntax_component_t* declr);
 void type_humanized_print(c_type_t* ct, int (*printer)(const char*, ...));
 c_type_t* type_copy(c_type_t* ct);
+c_type_t* type_intern(symbol_table_t* st, c_type_t* ct);
+c_type_t* type_intern_basic(symbol_table_t* st, c_type_class_t class);
 c_type_t* strip_qualifiers(c_type_t* ct);
 c_namespace_t* make_basic_namespace(c_namespace_class_t class);
 #define type_is_qualified(ct) (ct ? ((ct)->qualifiers != 0) : false)
 
+/* intern.c */
+char* intern(char* str);
+unsigned long intern_hash(char* interned);
+int intern_keyword(char* interned);
+int intern_comparator(char* a, char* b);
+
 /* util.c */
 #define ends_with_ignore_case(str, substr) starts_ends_with_ignore_case(str, substr, true)
 #define starts_with_ignore_case(str, substr) starts_ends_with_ignore_case(str, substr, false)
@@ -1949,12 +2401,10 @@ char* get_file_name(char* path, bool m);
 int contains(void** array, unsigned length, void* el, int (*c)(void*, void*));
 int regid_comparator(regid_t r1, regid_t r2);
 unsigned long regid_hash(regid_t x);
+int pointer_comparator(void* a, void* b);
+unsigned long pointer_hash(void* p);
 int regid_print(regid_t reg, int (*printer)(const char*, ...));
 
-int quickbuffer_printf(const char* fmt, ...);
-void quickbuffer_setup(size_t size);
-void quickbuffer_release(void);
-char* quickbuffer(void);
 
 int hexadecimal_digit_value(int c);
 unsigned get_universal_character_hex_value(char* unichar, size_t length);
@@ -1965,16 +2415,25 @@ char* replace_extension(char* filepath, char* ext);
 
 /* tokenize.c */
 
-void token_delete(token_t* token);
-void token_delete_all(token_t* token);
 void token_print(token_t* token, int (*printer)(const char* fmt, ...));
 token_t* tokenize_sequence(preprocessing_token_t* pp_tokens, preprocessing_token_t* end, tokenizing_settings_t* settings);
 token_t* tokenize(preprocessing_token_t* pp_tokens, tokenizing_settings_t* settings);
+int keyword_lookup(char* str);
 
 /* air.c */
 
 air_t* airinize(syntax_component_t* tlu);
+c_type_t* air_type(c_type_t* ct);
+c_type_t* air_basic_type(c_type_class_t class);
+c_type_t* air_reference_type(c_type_t* ct);
+air_routine_t* air_lower(air_t* air, air_routine_t* routine);
+regid_t air_next_register(air_t* air);
+void air_routine_release(air_routine_t* routine);
 void air_delete(air_t* air);
+void air_data_delete(air_data_t* ad);
+void air_routine_delete(air_routine_t* routine);
+void air_merge(air_t* into, air_t* from);
+void air_routine_print(air_routine_t* routine, air_t* air, int (*printer)(const char* fmt, ...));
 void air_print(air_t* air, int (*printer)(const char* fmt, ...));
 void air_insn_print(air_insn_t* insn, air_t* air, int (*printer)(const char* fmt, ...));
 void air_insn_delete_all(air_insn_t* insns);
@@ -1993,6 +2452,7 @@ air_insn_operand_t* air_insn_integer_constant_operand_init(unsigned long long ic
 air_insn_operand_t* air_insn_floating_constant_operand_init(long double fc);
 air_insn_operand_t* air_insn_label_operand_init(unsigned long long label, char disambiguator);
 air_insn_t* air_insn_init(air_insn_type_t type, size_t noops);
+air_insn_t* air_insn_copy(air_insn_t* insn);
 bool air_insn_creates_temporary(air_insn_t* insn);
 air_insn_t* air_insn_find_temporary_definition_above(regid_t tmp, air_insn_t* start);
 air_insn_t* air_insn_find_temporary_definition_below(regid_t tmp, air_insn_t* start);
@@ -2002,31 +2462,108 @@ bool air_insn_assigns(air_insn_t* insn);
 bool air_insn_uses(air_insn_t* insn, regid_t reg);
 bool air_insn_produces_side_effect(air_insn_t* insn);
 
+/* cfg.c */
+air_cfg_t* air_cfg_init(air_routine_t* routine);
+void air_cfg_delete(air_cfg_t* cfg);
+air_block_t* air_cfg_block(air_cfg_t* cfg, air_insn_t* insn);
+bool air_block_dominates(air_block_t* dominator, air_block_t* block);
+air_cfg_t* air_routine_cfg(air_routine_t* routine);
+void air_routine_invalidate_cfg(air_routine_t* routine);
+void air_cfg_print(air_cfg_t* cfg, air_t* air, int (*printer)(const char* fmt, ...));
+
+/* defuse.c */
+air_defuse_t* air_defuse_init(air_routine_t* routine);
+void air_defuse_delete(air_defuse_t* du);
+vector_t* air_defuse_definitions(air_defuse_t* du, regid_t reg);
+air_insn_t* air_defuse_definition(air_defuse_t* du, regid_t reg);
+vector_t* air_defuse_uses(air_defuse_t* du, regid_t reg);
+size_t air_defuse_position(air_defuse_t* du, air_insn_t* insn);
+size_t air_defuse_count_before(air_defuse_t* du, vector_t* insns, size_t position);
+
+/* liveness.c */
+void air_cfg_solve_backward(air_cfg_t* cfg, size_t words, unsigned long long* in, unsigned long long* out,
+    void (*transfer)(void* data, air_insn_t* insn, unsigned long long* set), void* data);
+air_liveness_t* air_liveness_init(air_routine_t* routine, air_t* air);
+void air_liveness_delete(air_liveness_t* l);
+regid_t air_liveness_definition(air_insn_t* insn);
+size_t air_liveness_index(air_liveness_t* l, regid_t reg);
+svector_t* air_liveness_implicit_uses(air_liveness_t* l, air_insn_t* insn);
+bool air_liveness_set_has(air_liveness_t* l, unsigned long long* set, regid_t reg);
+bool air_liveness_live_in(air_liveness_t* l, air_block_t* block, regid_t reg);
+bool air_liveness_live_out(air_liveness_t* l, air_block_t* block, regid_t reg);
+unsigned long long* air_liveness_out_set(air_liveness_t* l, air_block_t* block);
+void air_liveness_step(air_liveness_t* l, air_insn_t* insn, unsigned long long* live);
+
 /* localize.c */
+void localize_routine(air_t* air, air_routine_t* routine, air_locale_t locale);
+void localize_constants(air_t* air);
 void localize(air_t* air, air_locale_t locale);
 
+/* pass.c */
+
+bool pass_run(pass_manager_t* pm, pass_t* passes, size_t count);
+air_liveness_t* pass_liveness(pass_manager_t* pm);
+void pass_finish(pass_manager_t* pm);
+
 /* opt1.c */
 
-opt1_options_t* opt1_profile_basic(void);
+opt1_options_t* opt1_profile(optimization_level_t level);
 void opt1(air_t* air, opt1_options_t* options);
 
 /* opt4.c */
-opt4_options_t* opt4_profile_basic(void);
+opt4_options_t* opt4_profile(optimization_level_t level);
+void opt4_routine(x86_asm_routine_t* routine, x86_asm_file_t* file, opt4_options_t* options);
 void opt4(x86_asm_file_t* file, opt4_options_t* options);
 
 /* allocate.c */
 
+void allocate_routine(air_routine_t* routine, air_t* air);
 void allocate(air_t* air);
 
+/* program.c */
+
+air_t* program_merge(vector_t* airs);
+void program_prune(air_t* air);
+
+/* layout.c */
+
+void instrument_branches(air_t* air, char* filepath);
+map_t* branch_profile_read(char* path);
+void branch_profile_delete(map_t* profile);
+void layout(air_t* air, char* filepath, map_t* profile);
+
 /* x86asm.c */
 
+bool x86_symbol_requires_disambiguation(symbol_t* sy);
+x86_asm_file_t* x86_asm_file_init(air_t* air, symbol_table_t* st);
+x86_asm_routine_t* x86_generate_routine(air_routine_t* aroutine, uint64_t id, x86_asm_file_t* file);
+bool x86_asm_file_add_routine(x86_asm_file_t* file, x86_asm_routine_t* routine);
+void x86_generate_sections(x86_asm_file_t* file);
 x86_asm_file_t* x86_generate(air_t* air, symbol_table_t* st);
+void x86_write_routine(x86_asm_routine_t* routine, FILE* out);
 void x86_asm_file_write(x86_asm_file_t* file, FILE* out);
+void x86_asm_routine_delete(x86_asm_routine_t* routine);
 void x86_asm_file_delete(x86_asm_file_t* file);
 bool x86_64_c_type_registers_compatible(c_type_t* t1, c_type_t* t2);
 void x86_operand_delete(x86_operand_t* op);
+void x86_insn_delete(x86_insn_t* insn);
+bool x86_operand_equals(x86_operand_t* op1, x86_operand_t* op2);
 bool x86_64_is_integer_register(regid_t reg);
 bool x86_64_is_sse_register(regid_t reg);
+long long x86_routine_frame_size(x86_asm_routine_t* routine);
+long long x86_routine_outgoing_size(x86_asm_routine_t* routine);
+bool x86_routine_uses_frame_pointer(x86_asm_routine_t* routine);
+long long x86_routine_stack_adjustment(x86_asm_routine_t* routine);
+void x86_prepare_routine_frame(x86_asm_routine_t* routine);
+x86_insn_t* x86_routine_cold_start(x86_asm_routine_t* routine);
+bool x86_is_return_jump(x86_insn_t* insn);
+
+/* elf.c */
+
+void x86_asm_file_stream_elf(x86_asm_file_t* file);
+bool x86_asm_file_encode_routine(x86_asm_file_t* file, x86_asm_routine_t* routine);
+bool x86_asm_file_write_elf(x86_asm_file_t* file, FILE* out);
+void x86_asm_file_discard_elf(x86_asm_file_t* file);
 
 /* constexpr.c */
 
@@ -2047,19 +2584,26 @@ uint64_t constexpr_as_u64(constexpr_t* ce);
 int32_t constexpr_as_i32(constexpr_t* ce);
 bool constexpr_equals_zero(constexpr_t* ce);
 bool constexpr_can_evaluate(syntax_component_t* expr);
+constexpr_t* constexpr_copy(constexpr_t* ce);
+constexpr_t* constexpr_make_arithmetic(c_type_t* ct, void* data);
+constexpr_t* constexpr_fold_unary(punctuator_type_t op, constexpr_t* operand, c_type_t* rt);
+constexpr_t* constexpr_fold_binary(punctuator_type_t op, constexpr_t* lhs, constexpr_t* rhs, c_type_t* rt);
+constexpr_t* constexpr_fold_conversion(constexpr_t* ce, c_type_t* to);
 
 /* ecc.c */
 program_options_t* get_program_options(void);
+bool get_options(int argc, char** argv);
+int drive(int argc, char** argv);
 
 /* graph.c */
 
 void graph_delete(graph_t* graph);
-graph_t* graph_init(int (*comparator)(void*, void*), unsigned long (*hash)(void*), void (*vertex_deleter)(void*));
-bool graph_add_vertex(graph_t* graph, void* item);
-bool graph_add_edge(graph_t* graph, void* from, void* to);
-bool graph_remove_vertex(graph_t* graph, void* item);
-bool graph_remove_edge(graph_t* graph, void* from, void* to);
-bool graph_has_edge(graph_t* graph, void* from, void* to);
+graph_t* graph_init(void);
+bool graph_add_vertex(graph_t* graph, uint64_t vertex);
+bool graph_add_edge(graph_t* graph, uint64_t from, uint64_t to);
+bool graph_remove_vertex(graph_t* graph, uint64_t vertex);
+bool graph_remove_edge(graph_t* graph, uint64_t from, uint64_t to);
+bool graph_has_edge(graph_t* graph, uint64_t from, uint64_t to);
 
 /* from somewhere */
 bool in_debug(void);
@@ -0,0 +1,1662 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <elf.h>
+
+#include "ecc.h"
+
+/*
+
+direct ELF64 relocatable object emission for x86 assembly files.
+
+the text writer (x86_asm_file_write) is the reference: everything here produces the same bytes and
+relocations the assembler would for that text, including branch relaxation and which references it
+resolves itself. anything the encoder doesn't know how to encode makes x86_asm_file_write_elf fail
+so the caller can fall back to writing the text and running the assembler instead.
+
+routines can be encoded into the object one at a time as they're generated (x86_asm_file_stream_elf)
+and freed right after, so every label a fragment or symbol holds onto is interned to outlive them.
+
+object layout:
+
+    ELF header
+    .text, .rela.text, .data, .rela.data, .rodata, .rela.rodata, ecc_profile, .relaecc_profile,
+    .rodata.str1.1, .rodata.str4.4, .rodata.cst4, .rodata.cst8, .rodata.cst16
+    .symtab, .strtab, .shstrtab, .note.GNU-stack (empty)
+    section headers
+
+the mergeable sections go without relocation sections, since the linker won't merge a section
+that has one, even an empty one. nothing in them needs relocating, as only constants go in them.
+
+*/
+
+#define ELF_MAX_INSN_LENGTH 16
+#define ELF_JMP (-2)
+#define ELF_NOT_A_BRANCH (-1)
+
+typedef enum elf_section_id
+{
+    ELF_TEXT,
+    ELF_DATA,
+    ELF_RODATA,
+    ELF_PROFILE,
+    ELF_RODATA_STR1, // the mergeable sections, from here on
+
+    ELF_RODATA_STR4,
+    ELF_RODATA_CST4,
+    ELF_RODATA_CST8,
+    ELF_RODATA_CST16,
+    ELF_NO_SECTIONS
+} elf_section_id_t;
+
+// where each of x86_rodata_section_t goes
+static const elf_section_id_t RODATA_SECTIONS[X86RS_NO_ELEMENTS] = {
+    ELF_RODATA,
+    ELF_RODATA_STR1,
+    ELF_RODATA_STR4,
+    ELF_RODATA_CST4,
+    ELF_RODATA_CST8,
+    ELF_RODATA_CST16
+};
+
+#define ELF_FIRST_MERGEABLE ELF_RODATA_STR1
+
+enum
+{
+    ELF_SHNDX_NULL,
+    // each section, followed by its relocations if it isn't mergeable
+    ELF_SHNDX_SYMTAB = 1 + ELF_NO_SECTIONS + ELF_FIRST_MERGEABLE,
+    ELF_SHNDX_STRTAB,
+    ELF_SHNDX_SHSTRTAB,
+    ELF_SHNDX_NOTE,
+    ELF_NO_SHNDX
+};
+
+#define ELF_SECTION_SHNDX(id) (1 + (id) + min((id), ELF_FIRST_MERGEABLE))
+#define ELF_RELA_SHNDX(id) (2 + 2 * (id))
+
+typedef struct elf_bytes
+{
+    unsigned char* data;
+    size_t size;
+    size_t capacity;
+} elf_bytes_t;
+
+typedef struct elf_relocation
+{
+    uint64_t offset;
+    char* label;
+    int64_t addend;
+    uint32_t type;
+} elf_relocation_t;
+
+typedef struct elf_section
+{
+    elf_bytes_t bytes;
+    size_t alignment;
+    vector_t* relocations; // vector_t<elf_relocation_t>
+} elf_section_t;
+
+typedef struct elf_fragment elf_fragment_t;
+
+typedef struct elf_symbol
+{
+    char* name;
+    bool defined;
+    elf_section_id_t section;
+    uint64_t value;
+    elf_fragment_t* fragment; // for .text labels, whose addresses move while branches are relaxed
+    bool global;
+    size_t index;
+} elf_symbol_t;
+
+// one instruction or label in .text
+typedef struct elf_fragment
+{
+    unsigned char bytes[ELF_MAX_INSN_LENGTH];
+    size_t length;
+    char* label; // label defined here, if any
+
+    // a 32-bit pc-relative field referencing a label, if any
+    char* target;
+    size_t target_location;
+    int64_t addend;
+    uint32_t reloc_type;
+
+    // relaxable branches are encoded once their targets are placed
+    int condition; // ELF_NOT_A_BRANCH, ELF_JMP, or the condition code of a jcc
+    bool long_branch;
+
+    uint64_t address;
+} elf_fragment_t;
+
+typedef struct elf_object
+{
+    elf_section_t sections[ELF_NO_SECTIONS];
+    map_t* symbols; // map_t<char*, elf_symbol_t*>
+    vector_t* symbol_order; // vector_t<elf_symbol_t*>
+    vector_t* fragments; // vector_t<elf_fragment_t*>
+} elf_object_t;
+
+// an instruction in terms of its encoding: [prefix] [REX] opcode [ModRM [SIB] [disp]] [immediate]
+typedef struct elf_operation
+{
+    uint8_t prefix; // operand-size or mandatory prefix, 0 if none
+    bool rex_w;
+    bool rex; // force a REX prefix (needed for %spl, %bpl, %sil, and %dil)
+    uint8_t opcode[3];
+    size_t opcode_length;
+    x86_operand_t* reg; // register in ModRM.reg
+    int extension; // opcode extension in ModRM.reg if reg is NULL
+    x86_operand_t* rm; // operand in ModRM.rm, no ModRM byte if NULL
+    x86_operand_t* plus; // register added into the last opcode byte
+    int64_t immediate;
+    size_t immediate_size;
+} elf_operation_t;
+
+static void bytes_append(elf_bytes_t* b, const void* data, size_t length)
+{
+    if (b->size + length > b->capacity)
+    {
+        size_t capacity = b->capacity ? b->capacity : 64;
+        while (capacity < b->size + length)
+            capacity *= 2;
+        b->data = realloc(b->data, capacity);
+        b->capacity = capacity;
+    }
+    if (data)
+        memcpy(b->data + b->size, data, length);
+    else
+        memset(b->data + b->size, 0, length);
+    b->size += length;
+}
+
+static void bytes_align(elf_bytes_t* b, size_t alignment)
+{
+    if (alignment > 1 && b->size % alignment)
+        bytes_append(b, NULL, alignment - b->size % alignment);
+}
+
+static size_t bytes_append_string(elf_bytes_t* b, char* str)
+{
+    size_t offset = b->size;
+    bytes_append(b, str, strlen(str) + 1);
+    return offset;
+}
+
+static void add_relocation(elf_section_t* section, uint64_t offset, char* label, int64_t addend, uint32_t type)
+{
+    elf_relocation_t* r = calloc(1, sizeof *r);
+    r->offset = offset;
+    r->label = label;
+    r->addend = addend;
+    r->type = type;
+    vector_add(section->relocations, r);
+}
+
+static elf_symbol_t* get_symbol(elf_object_t* obj, char* name)
+{
+    elf_symbol_t* sy = map_get(obj->symbols, name);
+    if (sy)
+        return sy;
+    sy = calloc(1, sizeof *sy);
+    sy->name = name;
+    map_add(obj->symbols, name, sy);
+    vector_add(obj->symbol_order, sy);
+    return sy;
+}
+
+static bool define_symbol(elf_object_t* obj, char* name, elf_section_id_t section, uint64_t value, bool global)
+{
+    elf_symbol_t* sy = get_symbol(obj, name);
+    if (sy->defined)
+        return false;
+    sy->defined = true;
+    sy->section = section;
+    sy->value = value;
+    sy->global = global;
+    return true;
+}
+
+// symbols the assembler keeps out of the symbol table
+static bool is_local_label(char* name)
+{
+    return !strncmp(name, ".L", 2);
+}
+
+static int hardware_register(regid_t reg)
+{
+    static const int codes[] = {
+        [X86R_RAX] = 0,
+        [X86R_RDI] = 7,
+        [X86R_RSI] = 6,
+        [X86R_RDX] = 2,
+        [X86R_RCX] = 1,
+        [X86R_R8] = 8,
+        [X86R_R9] = 9,
+        [X86R_R10] = 10,
+        [X86R_R11] = 11,
+        [X86R_RBX] = 3,
+        [X86R_RSP] = 4,
+        [X86R_RBP] = 5,
+        [X86R_R12] = 12,
+        [X86R_R13] = 13,
+        [X86R_R14] = 14,
+        [X86R_R15] = 15,
+        [X86R_XMM0] = 0,
+        [X86R_XMM1] = 1,
+        [X86R_XMM2] = 2,
+        [X86R_XMM3] = 3,
+        [X86R_XMM4] = 4,
+        [X86R_XMM5] = 5,
+        [X86R_XMM6] = 6,
+        [X86R_XMM7] = 7
+    };
+    return codes[reg];
+}
+
+static bool is_gpr(x86_operand_t* op)
+{
+    return op && op->type == X86OP_REGISTER && x86_64_is_integer_register(op->reg);
+}
+
+static bool is_xmm(x86_operand_t* op)
+{
+    return op && op->type == X86OP_REGISTER && x86_64_is_sse_register(op->reg);
+}
+
+static bool is_memory(x86_operand_t* op)
+{
+    return op && (op->type == X86OP_DEREF_REGISTER || op->type == X86OP_ARRAY || op->type == X86OP_LABEL_REF);
+}
+
+static bool is_accumulator(x86_operand_t* op)
+{
+    return is_gpr(op) && op->reg == X86R_RAX;
+}
+
+static x86_insn_size_t operand_size(x86_operand_t* op, x86_insn_size_t size)
+{
+    return op->size ? op->size : size;
+}
+
+// %spl, %bpl, %sil, and %dil can only be named with a REX prefix
+static bool needs_byte_rex(x86_operand_t* op, x86_insn_size_t size)
+{
+    if (!is_gpr(op) || operand_size(op, size) != X86SZ_BYTE)
+        return false;
+    int code = hardware_register(op->reg);
+    return code >= 4 && code <= 7;
+}
+
+static bool fits_int8(int64_t value)
+{
+    return value >= INT8_MIN && value <= INT8_MAX;
+}
+
+static bool fits_int32(int64_t value)
+{
+    return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+// immediates are written out unsigned, so the assembler reads them as the operand size's two's complement
+static bool immediate_value(x86_operand_t* op, x86_insn_size_t size, int64_t* value)
+{
+    if (!op || op->type != X86OP_IMMEDIATE)
+        return false;
+    unsigned long long imm = op->immediate;
+    switch (size)
+    {
+        case X86SZ_BYTE:
+            if (imm > UINT8_MAX && ((int64_t) imm < INT8_MIN || (int64_t) imm >= 0)) return false;
+            *value = (int8_t) imm;
+            return true;
+        case X86SZ_WORD:
+            if (imm > UINT16_MAX && ((int64_t) imm < INT16_MIN || (int64_t) imm >= 0)) return false;
+            *value = (int16_t) imm;
+            return true;
+        case X86SZ_DWORD:
+            if (imm > UINT32_MAX && ((int64_t) imm < INT32_MIN || (int64_t) imm >= 0)) return false;
+            *value = (int32_t) imm;
+            return true;
+        case X86SZ_QWORD:
+            *value = (int64_t) imm;
+            return true;
+        default:
+            return false;
+    }
+}
+
+static size_t immediate_size(x86_insn_size_t size)
+{
+    switch (size)
+    {
+        case X86SZ_BYTE: return 1;
+        case X86SZ_WORD: return 2;
+        default: return 4;
+    }
+}
+
+static uint8_t size_prefix(x86_insn_size_t size)
+{
+    return size == X86SZ_WORD ? 0x66 : 0;
+}
+
+static void emit_byte(elf_fragment_t* f, uint8_t byte)
+{
+    f->bytes[f->length++] = byte;
+}
+
+static void emit_value(elf_fragment_t* f, uint64_t value, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+        emit_byte(f, (value >> (i * 8)) & 0xFF);
+}
+
+static bool encode(elf_fragment_t* f, elf_operation_t* op)
+{
+    uint8_t rex = 0x40;
+    if (op->rex_w) rex |= 0x08;
+
+    int reg = op->extension;
+    if (op->reg)
+    {
+        if (op->reg->type != X86OP_REGISTER || op->reg->reg < X86R_RAX || op->reg->reg > X86R_XMM7)
+            return false;
+        reg = hardware_register(op->reg->reg);
+        if (reg & 8) rex |= 0x04;
+    }
+
+    int plus = 0;
+    if (op->plus)
+    {
+        if (!is_gpr(op->plus))
+            return false;
+        plus = hardware_register(op->plus->reg);
+        if (plus & 8) rex |= 0x01;
+    }
+
+    uint8_t modrm = 0, sib = 0;
+    bool has_sib = false;
+    int64_t disp = 0;
+    size_t disp_size = 0;
+    char* target = NULL;
+    if (op->rm)
+    {
+        x86_operand_t* rm = op->rm;
+        regid_t base = INVALID_VREGID, index = INVALID_VREGID;
+        long long scale = 1;
+        switch (rm->type)
+        {
+            case X86OP_REGISTER:
+            case X86OP_PTR_REGISTER:
+            {
+                if (rm->reg < X86R_RAX || rm->reg > X86R_XMM7)
+                    return false;
+                int code = hardware_register(rm->reg);
+                if (code & 8) rex |= 0x01;
+                modrm = 0xC0 | ((reg & 7) << 3) | (code & 7);
+                break;
+            }
+            case X86OP_LABEL_REF:
+                modrm = ((reg & 7) << 3) | 5;
+                disp_size = 4;
+                target = intern(rm->label_ref.label);
+                break;
+            case X86OP_DEREF_REGISTER:
+                base = rm->deref_reg.reg_addr;
+                disp = rm->deref_reg.offset;
+                break;
+            case X86OP_ARRAY:
+                // the assembler rejects arrays missing either register the way they're written out
+                if (rm->array.reg_base == INVALID_VREGID || rm->array.reg_offset == INVALID_VREGID)
+                    return false;
+                base = rm->array.reg_base;
+                index = rm->array.reg_offset;
+                scale = rm->array.scale;
+                disp = rm->array.offset;
+                break;
+            default:
+                return false;
+        }
+        if (base != INVALID_VREGID)
+        {
+            if (!x86_64_is_integer_register(base) || !fits_int32(disp))
+                return false;
+            int b = hardware_register(base);
+            if (b & 8) rex |= 0x01;
+            int mod = 2;
+            if (disp == 0 && (b & 7) != 5) mod = 0;
+            else if (fits_int8(disp)) mod = 1;
+            disp_size = mod == 0 ? 0 : (mod == 1 ? 1 : 4);
+            if (index != INVALID_VREGID)
+            {
+                if (!x86_64_is_integer_register(index) || index == X86R_RSP)
+                    return false;
+                int x = hardware_register(index);
+                if (x & 8) rex |= 0x02;
+                int ss = 0;
+                switch (scale)
+                {
+                    case 1: ss = 0; break;
+                    case 2: ss = 1; break;
+                    case 4: ss = 2; break;
+                    case 8: ss = 3; break;
+                    default: return false;
+                }
+                has_sib = true;
+                sib = (ss << 6) | ((x & 7) << 3) | (b & 7);
+                modrm = (mod << 6) | ((reg & 7) << 3) | 4;
+            }
+            else if ((b & 7) == 4)
+            {
+                has_sib = true;
+                sib = 0x24;
+                modrm = (mod << 6) | ((reg & 7) << 3) | 4;
+            }
+            else
+                modrm = (mod << 6) | ((reg & 7) << 3) | (b & 7);
+        }
+    }
+
+    if (op->prefix)
+        emit_byte(f, op->prefix);
+    if (rex != 0x40 || op->rex)
+        emit_byte(f, rex);
+    for (size_t i = 0; i < op->opcode_length; ++i)
+        emit_byte(f, op->opcode[i] + (i == op->opcode_length - 1 ? (plus & 7) : 0));
+    if (op->rm)
+    {
+        emit_byte(f, modrm);
+        if (has_sib)
+            emit_byte(f, sib);
+        if (target)
+        {
+            f->target = target;
+            f->target_location = f->length;
+            f->reloc_type = R_X86_64_PC32;
+        }
+        emit_value(f, disp, disp_size);
+    }
+    emit_value(f, op->immediate, op->immediate_size);
+    // the field is relative to the end of the instruction, which the immediate comes before
+    if (target)
+        f->addend = op->rm->label_ref.offset - (int64_t) (f->length - f->target_location);
+    return true;
+}
+
+static bool encode_opcode(elf_fragment_t* f, uint8_t opcode)
+{
+    emit_byte(f, opcode);
+    return true;
+}
+
+// add, or, and, sub, xor, and cmp share their encodings apart from a base opcode and extension
+static bool encode_arithmetic(elf_fragment_t* f, x86_insn_t* insn, uint8_t base, int extension)
+{
+    x86_operand_t* src = insn->op1;
+    x86_operand_t* dest = insn->op2;
+    x86_insn_size_t size = insn->size;
+    if (!src || !dest || size == X86SZ_NONE)
+        return false;
+    bool byte = size == X86SZ_BYTE;
+    elf_operation_t op = {
+        .prefix = size_prefix(size),
+        .rex_w = size == X86SZ_QWORD,
+        .rex = needs_byte_rex(src, size) || needs_byte_rex(dest, size),
+        .opcode_length = 1
+    };
+    if (src->type == X86OP_IMMEDIATE)
+    {
+        if (!is_gpr(dest) && !is_memory(dest))
+            return false;
+        if (!immediate_value(src, size, &op.immediate))
+            return false;
+        if (size == X86SZ_QWORD && !fits_int32(op.immediate))
+            return false;
+        op.immediate_size = immediate_size(size);
+        if (!byte && fits_int8(op.immediate))
+        {
+            op.opcode[0] = 0x83;
+            op.immediate_size = 1;
+        }
+        else if (is_accumulator(dest))
+        {
+            op.opcode[0] = base + (byte ? 4 : 5);
+            return encode(f, &op);
+        }
+        else
+            op.opcode[0] = byte ? 0x80 : 0x81;
+        op.extension = extension;
+        op.rm = dest;
+        return encode(f, &op);
+    }
+    if (is_gpr(src) && (is_gpr(dest) || is_memory(dest)))
+    {
+        op.opcode[0] = base + (byte ? 0 : 1);
+        op.reg = src;
+        op.rm = dest;
+        return encode(f, &op);
+    }
+    if (is_memory(src) && is_gpr(dest))
+    {
+        op.opcode[0] = base + (byte ? 2 : 3);
+        op.reg = dest;
+        op.rm = src;
+        return encode(f, &op);
+    }
+    return false;
+}
+
+static bool encode_mov(elf_fragment_t* f, x86_insn_t* insn)
+{
+    x86_operand_t* src = insn->op1;
+    x86_operand_t* dest = insn->op2;
+    x86_insn_size_t size = insn->size;
+    if (!src || !dest || size == X86SZ_NONE)
+        return false;
+    bool byte = size == X86SZ_BYTE;
+    elf_operation_t op = {
+        .prefix = size_prefix(size),
+        .rex_w = size == X86SZ_QWORD,
+        .rex = needs_byte_rex(src, size) || needs_byte_rex(dest, size),
+        .opcode_length = 1
+    };
+    if (src->type == X86OP_IMMEDIATE)
+    {
+        if (!immediate_value(src, size, &op.immediate))
+            return false;
+        op.immediate_size = immediate_size(size);
+        if (is_gpr(dest))
+        {
+            if (size == X86SZ_QWORD && !fits_int32(op.immediate))
+            {
+                // movabs
+                op.opcode[0] = 0xB8;
+                op.plus = dest;
+                op.immediate_size = 8;
+                return encode(f, &op);
+            }
+            if (size != X86SZ_QWORD)
+            {
+                op.opcode[0] = byte ? 0xB0 : 0xB8;
+                op.plus = dest;
+                return encode(f, &op);
+            }
+        }
+        else if (!is_memory(dest) || (size == X86SZ_QWORD && !fits_int32(op.immediate)))
+            return false;
+        op.opcode[0] = byte ? 0xC6 : 0xC7;
+        op.rm = dest;
+        return encode(f, &op);
+    }
+    if (is_gpr(src) && (is_gpr(dest) || is_memory(dest)))
+    {
+        op.opcode[0] = byte ? 0x88 : 0x89;
+        op.reg = src;
+        op.rm = dest;
+        return encode(f, &op);
+    }
+    if (is_memory(src) && is_gpr(dest))
+    {
+        op.opcode[0] = byte ? 0x8A : 0x8B;
+        op.reg = dest;
+        op.rm = src;
+        return encode(f, &op);
+    }
+    return false;
+}
+
+// movsx and movzx are written without a suffix, so the assembler sizes them by their registers (a memory source is a byte)
+static bool encode_extension(elf_fragment_t* f, x86_insn_t* insn, bool sign)
+{
+    x86_operand_t* src = insn->op1;
+    x86_operand_t* dest = insn->op2;
+    if (!src || !is_gpr(dest) || (!is_gpr(src) && !is_memory(src)))
+        return false;
+    x86_insn_size_t dest_size = operand_size(dest, insn->size);
+    x86_insn_size_t src_size = is_gpr(src) ? operand_size(src, insn->size) : X86SZ_BYTE;
+    if (dest_size <= src_size && !(sign && src_size == X86SZ_DWORD && dest_size == X86SZ_QWORD))
+        return false;
+    elf_operation_t op = {
+        .prefix = size_prefix(dest_size),
+        .rex_w = dest_size == X86SZ_QWORD,
+        .rex = needs_byte_rex(src, src_size),
+        .reg = dest,
+        .rm = src
+    };
+    switch (src_size)
+    {
+        case X86SZ_BYTE:
+            op.opcode[0] = 0x0F, op.opcode[1] = sign ? 0xBE : 0xB6, op.opcode_length = 2;
+            break;
+        case X86SZ_WORD:
+            op.opcode[0] = 0x0F, op.opcode[1] = sign ? 0xBF : 0xB7, op.opcode_length = 2;
+            break;
+        case X86SZ_DWORD:
+            if (!sign)
+                return false;
+            op.opcode[0] = 0x63, op.opcode_length = 1;
+            break;
+        default:
+            return false;
+    }
+    return encode(f, &op);
+}
+
+static bool encode_imul(elf_fragment_t* f, x86_insn_t* insn)
+{
+    x86_operand_t* src = insn->op1;
+    x86_operand_t* dest = insn->op2;
+    x86_insn_size_t size = insn->size;
+    if (!src || !is_gpr(dest) || insn->op3 || size == X86SZ_BYTE || size == X86SZ_NONE)
+        return false;
+    elf_operation_t op = {
+        .prefix = size_prefix(size),
+        .rex_w = size == X86SZ_QWORD,
+        .reg = dest
+    };
+    if (src->type == X86OP_IMMEDIATE)
+    {
+        if (!immediate_value(src, size, &op.immediate) || !fits_int32(op.immediate))
+            return false;
+        bool short_form = fits_int8(op.immediate);
+        op.opcode[0] = short_form ? 0x6B : 0x69;
+        op.opcode_length = 1;
+        op.immediate_size = short_form ? 1 : immediate_size(size);
+        op.rm = dest;
+        return encode(f, &op);
+    }
+    if (!is_gpr(src) && !is_memory(src))
+        return false;
+    op.opcode[0] = 0x0F, op.opcode[1] = 0xAF, op.opcode_length = 2;
+    op.rm = src;
+    return encode(f, &op);
+}
+
+// not, neg, mul, div, and idiv
+static bool encode_unary(elf_fragment_t* f, x86_insn_t* insn, int extension)
+{
+    x86_operand_t* rm = insn->op1;
+    x86_insn_size_t size = insn->size;
+    if ((!is_gpr(rm) && !is_memory(rm)) || size == X86SZ_NONE)
+        return false;
+    elf_operation_t op = {
+        .prefix = size_prefix(size),
+        .rex_w = size == X86SZ_QWORD,
+        .rex = needs_byte_rex(rm, size),
+        .opcode = { size == X86SZ_BYTE ? 0xF6 : 0xF7 },
+        .opcode_length = 1,
+        .extension = extension,
+        .rm = rm
+    };
+    return encode(f, &op);
+}
+
+static bool encode_shift(elf_fragment_t* f, x86_insn_t* insn, int extension)
+{
+    x86_operand_t* count = insn->op1;
+    x86_operand_t* rm = insn->op2;
+    x86_insn_size_t size = insn->size;
+    if (!count || (!is_gpr(rm) && !is_memory(rm)) || size == X86SZ_NONE)
+        return false;
+    bool byte = size == X86SZ_BYTE;
+    elf_operation_t op = {
+        .prefix = size_prefix(size),
+        .rex_w = size == X86SZ_QWORD,
+        .rex = needs_byte_rex(rm, size),
+        .opcode_length = 1,
+        .extension = extension,
+        .rm = rm
+    };
+    if (count->type == X86OP_IMMEDIATE)
+    {
+        unsigned long long n = count->immediate;
+        if (n > UINT8_MAX)
+            return false;
+        if (n == 1)
+            op.opcode[0] = byte ? 0xD0 : 0xD1;
+        else
+        {
+            op.opcode[0] = byte ? 0xC0 : 0xC1;
+            op.immediate = n;
+            op.immediate_size = 1;
+        }
+        return encode(f, &op);
+    }
+    if (is_gpr(count) && count->reg == X86R_RCX)
+    {
+        op.opcode[0] = byte ? 0xD2 : 0xD3;
+        return encode(f, &op);
+    }
+    return false;
+}
+
+static bool encode_test(elf_fragment_t* f, x86_insn_t* insn)
+{
+    x86_operand_t* src = insn->op1;
+    x86_operand_t* dest = insn->op2;
+    x86_insn_size_t size = insn->size;
+    if (!src || !dest || size == X86SZ_NONE)
+        return false;
+    bool byte = size == X86SZ_BYTE;
+    elf_operation_t op = {
+        .prefix = size_prefix(size),
+        .rex_w = size == X86SZ_QWORD,
+        .rex = needs_byte_rex(src, size) || needs_byte_rex(dest, size),
+        .opcode_length = 1
+    };
+    if (src->type == X86OP_IMMEDIATE)
+    {
+        if (!immediate_value(src, size, &op.immediate))
+            return false;
+        if (size == X86SZ_QWORD && !fits_int32(op.immediate))
+            return false;
+        op.immediate_size = immediate_size(size);
+        if (is_accumulator(dest))
+        {
+            op.opcode[0] = byte ? 0xA8 : 0xA9;
+            return encode(f, &op);
+        }
+        if (!is_gpr(dest) && !is_memory(dest))
+            return false;
+        op.opcode[0] = byte ? 0xF6 : 0xF7;
+        op.rm = dest;
+        return encode(f, &op);
+    }
+    op.opcode[0] = byte ? 0x84 : 0x85;
+    if (is_gpr(src) && (is_gpr(dest) || is_memory(dest)))
+        op.reg = src, op.rm = dest;
+    else if (is_memory(src) && is_gpr(dest))
+        op.reg = dest, op.rm = src;
+    else
+        return false;
+    return encode(f, &op);
+}
+
+static bool encode_lea(elf_fragment_t* f, x86_insn_t* insn)
+{
+    if (!is_memory(insn->op1) || !is_gpr(insn->op2) || insn->size == X86SZ_BYTE || insn->size == X86SZ_NONE)
+        return false;
+    elf_operation_t op = {
+        .prefix = size_prefix(insn->size),
+        .rex_w = insn->size == X86SZ_QWORD,
+        .opcode = { 0x8D },
+        .opcode_length = 1,
+        .reg = insn->op2,
+        .rm = insn->op1
+    };
+    return encode(f, &op);
+}
+
+static bool encode_push_pop(elf_fragment_t* f, x86_insn_t* insn, bool push)
+{
+    x86_operand_t* operand = insn->op1;
+    if (is_gpr(operand) && operand_size(operand, insn->size) == X86SZ_QWORD)
+    {
+        elf_operation_t op = {
+            .opcode = { push ? 0x50 : 0x58 },
+            .opcode_length = 1,
+            .plus = operand
+        };
+        return encode(f, &op);
+    }
+    int64_t value;
+    if (push && immediate_value(operand, X86SZ_QWORD, &value) && fits_int32(value))
+    {
+        elf_operation_t op = {
+            .opcode = { fits_int8(value) ? 0x6A : 0x68 },
+            .opcode_length = 1,
+            .immediate = value,
+            .immediate_size = fits_int8(value) ? 1 : 4
+        };
+        return encode(f, &op);
+    }
+    return false;
+}
+
+// call and jmp through a register
+static bool encode_indirect(elf_fragment_t* f, x86_operand_t* target, int extension)
+{
+    if (target->type != X86OP_PTR_REGISTER || !x86_64_is_integer_register(target->reg))
+        return false;
+    elf_operation_t op = {
+        .opcode = { 0xFF },
+        .opcode_length = 1,
+        .extension = extension,
+        .rm = target
+    };
+    return encode(f, &op);
+}
+
+static bool encode_setcc(elf_fragment_t* f, x86_insn_t* insn, uint8_t condition)
+{
+    x86_operand_t* rm = insn->op1;
+    if (!is_gpr(rm) && !is_memory(rm))
+        return false;
+    elf_operation_t op = {
+        .rex = needs_byte_rex(rm, X86SZ_BYTE),
+        .opcode = { 0x0F, 0x90 + condition },
+        .opcode_length = 2,
+        .rm = rm
+    };
+    return encode(f, &op);
+}
+
+// SSE instructions: prefix 0F opcode, destination register in ModRM.reg
+static bool encode_sse(elf_fragment_t* f, x86_insn_t* insn, uint8_t prefix, uint8_t opcode)
+{
+    if (!is_xmm(insn->op2) || (!is_xmm(insn->op1) && !is_memory(insn->op1)))
+        return false;
+    elf_operation_t op = {
+        .prefix = prefix,
+        .opcode = { 0x0F, opcode },
+        .opcode_length = 2,
+        .reg = insn->op2,
+        .rm = insn->op1
+    };
+    return encode(f, &op);
+}
+
+// moves to memory have an opcode of their own, with the source register in ModRM.reg
+static bool encode_sse_transfer(elf_fragment_t* f, x86_insn_t* insn, uint8_t prefix, uint8_t load, uint8_t store)
+{
+    if (is_xmm(insn->op1) && is_memory(insn->op2))
+    {
+        elf_operation_t op = {
+            .prefix = prefix,
+            .opcode = { 0x0F, store },
+            .opcode_length = 2,
+            .reg = insn->op1,
+            .rm = insn->op2
+        };
+        return encode(f, &op);
+    }
+    return encode_sse(f, insn, prefix, load);
+}
+
+static bool encode_sse_move(elf_fragment_t* f, x86_insn_t* insn, uint8_t prefix)
+{
+    return encode_sse_transfer(f, insn, prefix, 0x10, 0x11);
+}
+
+// cvtsi2ss and cvtsi2sd, sized by their integer source
+static bool encode_sse_from_integer(elf_fragment_t* f, x86_insn_t* insn, uint8_t prefix)
+{
+    if (!is_xmm(insn->op2) || (!is_gpr(insn->op1) && !is_memory(insn->op1)))
+        return false;
+    if (insn->size != X86SZ_DWORD && insn->size != X86SZ_QWORD)
+        return false;
+    elf_operation_t op = {
+        .prefix = prefix,
+        .rex_w = insn->size == X86SZ_QWORD,
+        .opcode = { 0x0F, 0x2A },
+        .opcode_length = 2,
+        .reg = insn->op2,
+        .rm = insn->op1
+    };
+    return encode(f, &op);
+}
+
+// cvttss2si and cvttsd2si, sized by their integer destination
+static bool encode_sse_to_integer(elf_fragment_t* f, x86_insn_t* insn, uint8_t prefix)
+{
+    if (!is_gpr(insn->op2) || (!is_xmm(insn->op1) && !is_memory(insn->op1)))
+        return false;
+    if (insn->size != X86SZ_DWORD && insn->size != X86SZ_QWORD)
+        return false;
+    elf_operation_t op = {
+        .prefix = prefix,
+        .rex_w = insn->size == X86SZ_QWORD,
+        .opcode = { 0x0F, 0x2C },
+        .opcode_length = 2,
+        .reg = insn->op2,
+        .rm = insn->op1
+    };
+    return encode(f, &op);
+}
+
+static bool encode_ptest(elf_fragment_t* f, x86_insn_t* insn)
+{
+    if (!is_xmm(insn->op2) || (!is_xmm(insn->op1) && !is_memory(insn->op1)))
+        return false;
+    elf_operation_t op = {
+        .prefix = 0x66,
+        .opcode = { 0x0F, 0x38, 0x17 },
+        .opcode_length = 3,
+        .reg = insn->op2,
+        .rm = insn->op1
+    };
+    return encode(f, &op);
+}
+
+// direct calls and jumps: the assembler only resolves calls to its own local labels, everything else gets a PLT32 relocation
+static bool encode_call(elf_fragment_t* f, x86_insn_t* insn)
+{
+    x86_operand_t* target = insn->op1;
+    if (!target)
+        return false;
+    if (target->type != X86OP_LABEL)
+        return encode_indirect(f, target, 2);
+    emit_byte(f, 0xE8);
+    f->target = intern(target->label);
+    f->target_location = f->length;
+    f->addend = -4;
+    f->reloc_type = R_X86_64_PLT32;
+    emit_value(f, 0, 4);
+    return true;
+}
+
+static bool encode_branch(elf_fragment_t* f, x86_insn_t* insn, int condition)
+{
+    x86_operand_t* target = insn->op1;
+    if (!target)
+        return false;
+    if (target->type != X86OP_LABEL)
+        return condition == ELF_JMP && encode_indirect(f, target, 4);
+    f->condition = condition;
+    f->target = intern(target->label);
+    f->reloc_type = R_X86_64_PLT32;
+    return true;
+}
+
+static bool encode_insn(elf_fragment_t* f, x86_insn_t* insn)
+{
+    switch (insn->type)
+    {
+        case X86I_LEAVE: return encode_opcode(f, 0xC9);
+        case X86I_RET: return encode_opcode(f, 0xC3);
+        case X86I_STC: return encode_opcode(f, 0xF9);
+        case X86I_NOP: return encode_opcode(f, 0x90);
+        case X86I_SYSCALL: return encode_opcode(f, 0x0F) && encode_opcode(f, 0x05);
+        case X86I_REP_STOSB: return encode_opcode(f, 0xF3) && encode_opcode(f, 0xAA);
+        case X86I_CQTO: return (insn->size != X86SZ_QWORD || encode_opcode(f, 0x48)) && encode_opcode(f, 0x99);
+        case X86I_SKIP: return true;
+
+        case X86I_CALL: return encode_call(f, insn);
+        case X86I_JMP:
+        case X86I_TAIL_JMP: return encode_branch(f, insn, ELF_JMP);
+        case X86I_JE: return encode_branch(f, insn, 0x4);
+        case X86I_JNE: return encode_branch(f, insn, 0x5);
+        case X86I_JNB: return encode_branch(f, insn, 0x3);
+        case X86I_JS: return encode_branch(f, insn, 0x8);
+        case X86I_JL: return encode_branch(f, insn, 0xC);
+        case X86I_JLE: return encode_branch(f, insn, 0xE);
+        case X86I_JG: return encode_branch(f, insn, 0xF);
+        case X86I_JGE: return encode_branch(f, insn, 0xD);
+        case X86I_JA: return encode_branch(f, insn, 0x7);
+        case X86I_JB: return encode_branch(f, insn, 0x2);
+        case X86I_JBE: return encode_branch(f, insn, 0x6);
+        case X86I_JP: return encode_branch(f, insn, 0xA);
+
+        case X86I_SETE: return encode_setcc(f, insn, 0x4);
+        case X86I_SETNE: return encode_setcc(f, insn, 0x5);
+        case X86I_SETLE: return encode_setcc(f, insn, 0xE);
+        case X86I_SETL: return encode_setcc(f, insn, 0xC);
+        case X86I_SETGE: return encode_setcc(f, insn, 0xD);
+        case X86I_SETG: return encode_setcc(f, insn, 0xF);
+        case X86I_SETA: return encode_setcc(f, insn, 0x7);
+        case X86I_SETNB: return encode_setcc(f, insn, 0x3);
+        case X86I_SETB: return encode_setcc(f, insn, 0x2);
+        case X86I_SETBE: return encode_setcc(f, insn, 0x6);
+        case X86I_SETP: return encode_setcc(f, insn, 0xA);
+        case X86I_SETNP: return encode_setcc(f, insn, 0xB);
+
+        case X86I_PUSH: return encode_push_pop(f, insn, true);
+        case X86I_POP: return encode_push_pop(f, insn, false);
+
+        case X86I_ADD: return encode_arithmetic(f, insn, 0x00, 0);
+        case X86I_OR: return encode_arithmetic(f, insn, 0x08, 1);
+        case X86I_AND: return encode_arithmetic(f, insn, 0x20, 4);
+        case X86I_SUB: return encode_arithmetic(f, insn, 0x28, 5);
+        case X86I_XOR: return encode_arithmetic(f, insn, 0x30, 6);
+        case X86I_CMP: return encode_arithmetic(f, insn, 0x38, 7);
+
+        case X86I_NOT: return encode_unary(f, insn, 2);
+        case X86I_NEG: return encode_unary(f, insn, 3);
+        case X86I_MUL: return encode_unary(f, insn, 4);
+        case X86I_DIV: return encode_unary(f, insn, 6);
+        case X86I_IDIV: return encode_unary(f, insn, 7);
+        case X86I_IMUL: return encode_imul(f, insn);
+
+        case X86I_ROR: return encode_shift(f, insn, 1);
+        case X86I_SHL: return encode_shift(f, insn, 4);
+        case X86I_SHR: return encode_shift(f, insn, 5);
+        case X86I_SAR: return encode_shift(f, insn, 7);
+
+        case X86I_MOV: return encode_mov(f, insn);
+        case X86I_MOVSX: return encode_extension(f, insn, true);
+        case X86I_MOVZX: return encode_extension(f, insn, false);
+        case X86I_LEA: return encode_lea(f, insn);
+        case X86I_TEST: return encode_test(f, insn);
+
+        case X86I_MOVSS: return encode_sse_move(f, insn, 0xF3);
+        case X86I_MOVSD: return encode_sse_move(f, insn, 0xF2);
+        case X86I_ADDSS: return encode_sse(f, insn, 0xF3, 0x58);
+        case X86I_ADDSD: return encode_sse(f, insn, 0xF2, 0x58);
+        case X86I_MULSS: return encode_sse(f, insn, 0xF3, 0x59);
+        case X86I_MULSD: return encode_sse(f, insn, 0xF2, 0x59);
+        case X86I_SUBSS: return encode_sse(f, insn, 0xF3, 0x5C);
+        case X86I_SUBSD: return encode_sse(f, insn, 0xF2, 0x5C);
+        case X86I_DIVSS: return encode_sse(f, insn, 0xF3, 0x5E);
+        case X86I_DIVSD: return encode_sse(f, insn, 0xF2, 0x5E);
+        case X86I_XORPS: return encode_sse(f, insn, 0, 0x57);
+        case X86I_XORPD: return encode_sse(f, insn, 0x66, 0x57);
+        case X86I_CVTSS2SD: return encode_sse(f, insn, 0xF3, 0x5A);
+        case X86I_CVTSD2SS: return encode_sse(f, insn, 0xF2, 0x5A);
+        case X86I_COMISS: return encode_sse(f, insn, 0, 0x2F);
+        case X86I_COMISD: return encode_sse(f, insn, 0x66, 0x2F);
+        case X86I_UCOMISS: return encode_sse(f, insn, 0, 0x2E);
+        case X86I_UCOMISD: return encode_sse(f, insn, 0x66, 0x2E);
+        case X86I_CVTSI2SS: return encode_sse_from_integer(f, insn, 0xF3);
+        case X86I_CVTSI2SD: return encode_sse_from_integer(f, insn, 0xF2);
+        case X86I_CVTTSS2SI: return encode_sse_to_integer(f, insn, 0xF3);
+        case X86I_CVTTSD2SI: return encode_sse_to_integer(f, insn, 0xF2);
+        case X86I_PTEST: return encode_ptest(f, insn);
+        case X86I_MOVUPS: return encode_sse_move(f, insn, 0);
+        case X86I_MOVUPD: return encode_sse_move(f, insn, 0x66);
+        case X86I_MOVDQU: return encode_sse_transfer(f, insn, 0xF3, 0x6F, 0x7F);
+        case X86I_ADDPS: return encode_sse(f, insn, 0, 0x58);
+        case X86I_ADDPD: return encode_sse(f, insn, 0x66, 0x58);
+        case X86I_PADDD: return encode_sse(f, insn, 0x66, 0xFE);
+        case X86I_PADDQ: return encode_sse(f, insn, 0x66, 0xD4);
+        case X86I_SUBPS: return encode_sse(f, insn, 0, 0x5C);
+        case X86I_SUBPD: return encode_sse(f, insn, 0x66, 0x5C);
+        case X86I_PSUBD: return encode_sse(f, insn, 0x66, 0xFA);
+        case X86I_PSUBQ: return encode_sse(f, insn, 0x66, 0xFB);
+        case X86I_MULPS: return encode_sse(f, insn, 0, 0x59);
+        case X86I_MULPD: return encode_sse(f, insn, 0x66, 0x59);
+        case X86I_DIVPS: return encode_sse(f, insn, 0, 0x5E);
+        case X86I_DIVPD: return encode_sse(f, insn, 0x66, 0x5E);
+
+        default: return false;
+    }
+}
+
+static elf_fragment_t* add_fragment(elf_object_t* obj)
+{
+    elf_fragment_t* f = calloc(1, sizeof *f);
+    f->condition = ELF_NOT_A_BRANCH;
+    vector_add(obj->fragments, f);
+    return f;
+}
+
+static bool add_label(elf_object_t* obj, char* label, bool global)
+{
+    label = intern(label);
+    elf_fragment_t* f = add_fragment(obj);
+    f->label = label;
+    if (!define_symbol(obj, label, ELF_TEXT, 0, global))
+        return false;
+    get_symbol(obj, label)->fragment = f;
+    return true;
+}
+
+static bool add_insn(elf_object_t* obj, x86_insn_t* insn)
+{
+    if (insn->type == X86I_LABEL)
+        return insn->op1 && insn->op1->type == X86OP_LABEL && add_label(obj, insn->op1->label, false);
+    return encode_insn(add_fragment(obj), insn);
+}
+
+// builds a temporary instruction out of the given operands, like the prologue and epilogue the text writer prints inline
+static bool add_simple_insn(elf_object_t* obj, x86_insn_type_t type, x86_insn_size_t size, x86_operand_t* op1, x86_operand_t* op2)
+{
+    x86_insn_t insn = { .type = type, .size = size, .op1 = op1, .op2 = op2 };
+    return add_insn(obj, &insn);
+}
+
+static x86_operand_t register_operand(regid_t reg)
+{
+    x86_operand_t op = { .type = X86OP_REGISTER };
+    op.reg = reg;
+    return op;
+}
+
+static x86_operand_t deref_operand(regid_t reg, long long offset)
+{
+    x86_operand_t op = { .type = X86OP_DEREF_REGISTER };
+    op.deref_reg.reg_addr = reg;
+    op.deref_reg.offset = offset;
+    return op;
+}
+
+static const regid_t NONVOLATILE_REGISTERS[] = { X86R_RBX, X86R_R12, X86R_R13, X86R_R14, X86R_R15, X86R_RBP };
+
+static const uint16_t NONVOLATILE_FLAGS[] = {
+    USED_NONVOLATILES_RBX,
+    USED_NONVOLATILES_R12,
+    USED_NONVOLATILES_R13,
+    USED_NONVOLATILES_R14,
+    USED_NONVOLATILES_R15,
+    USED_NONVOLATILES_RBP
+};
+
+#define NO_NONVOLATILES (sizeof(NONVOLATILE_FLAGS) / sizeof(NONVOLATILE_FLAGS[0]))
+
+// mirrors x86_write_varargs_setup
+static bool add_varargs_setup(elf_object_t* obj)
+{
+    static const regid_t gprs[] = { X86R_R9, X86R_R8, X86R_RCX, X86R_RDX, X86R_RSI, X86R_RDI };
+    static const long long gpr_offsets[] = { -8, -16, -24, -32, -40, -48 };
+    for (size_t i = 0; i < sizeof(gprs) / sizeof(gprs[0]); ++i)
+    {
+        x86_operand_t src = register_operand(gprs[i]);
+        x86_operand_t dest = deref_operand(X86R_RBP, gpr_offsets[i]);
+        if (!add_simple_insn(obj, X86I_MOV, X86SZ_QWORD, &src, &dest))
+            return false;
+    }
+    for (int i = 7; i >= 0; --i)
+    {
+        // movaps %xmm<i>, <offset>(%rbp)
+        x86_operand_t src = register_operand(X86R_XMM0 + i);
+        x86_operand_t dest = deref_operand(X86R_RBP, -176 + i * 16);
+        elf_operation_t op = {
+            .opcode = { 0x0F, 0x29 },
+            .opcode_length = 2,
+            .reg = &src,
+            .rm = &dest
+        };
+        if (!encode(add_fragment(obj), &op))
+            return false;
+    }
+    return true;
+}
+
+static bool add_stack_adjustment(elf_object_t* obj, x86_insn_type_t type, long long amount)
+{
+    x86_operand_t rsp = register_operand(X86R_RSP);
+    x86_operand_t imm = { .type = X86OP_IMMEDIATE };
+    imm.immediate = amount;
+    return !amount || add_simple_insn(obj, type, X86SZ_QWORD, &imm, &rsp);
+}
+
+static bool add_nonvolatile_pushes(elf_object_t* obj, x86_asm_routine_t* routine)
+{
+    for (size_t i = 0; i < NO_NONVOLATILES; ++i)
+    {
+        x86_operand_t reg = register_operand(NONVOLATILE_REGISTERS[i]);
+        if ((routine->used_nonvolatiles & NONVOLATILE_FLAGS[i]) && !add_simple_insn(obj, X86I_PUSH, X86SZ_QWORD, &reg, NULL))
+            return false;
+    }
+    return true;
+}
+
+static bool add_nonvolatile_pops(elf_object_t* obj, x86_asm_routine_t* routine)
+{
+    for (int i = NO_NONVOLATILES - 1; i >= 0; --i)
+    {
+        x86_operand_t reg = register_operand(NONVOLATILE_REGISTERS[i]);
+        if ((routine->used_nonvolatiles & NONVOLATILE_FLAGS[i]) && !add_simple_insn(obj, X86I_POP, X86SZ_QWORD, &reg, NULL))
+            return false;
+    }
+    return true;
+}
+
+static bool add_epilogue(elf_object_t* obj, x86_asm_routine_t* routine, bool framed, long long adjustment)
+{
+    if (framed)
+        return add_stack_adjustment(obj, X86I_ADD, x86_routine_outgoing_size(routine)) &&
+            add_nonvolatile_pops(obj, routine) && add_simple_insn(obj, X86I_LEAVE, X86SZ_NONE, NULL, NULL);
+    return add_stack_adjustment(obj, X86I_ADD, adjustment) && add_nonvolatile_pops(obj, routine);
+}
+
+// mirrors x86_write_routine
+static bool add_routine(elf_object_t* obj, x86_asm_routine_t* routine)
+{
+    x86_prepare_routine_frame(routine);
+    if (!add_label(obj, routine->label, routine->global))
+        return false;
+    bool framed = x86_routine_uses_frame_pointer(routine);
+    long long adjustment = framed ? x86_routine_frame_size(routine) : x86_routine_stack_adjustment(routine);
+    if (framed)
+    {
+        x86_operand_t rbp = register_operand(X86R_RBP);
+        x86_operand_t rsp = register_operand(X86R_RSP);
+        if (!add_simple_insn(obj, X86I_PUSH, X86SZ_QWORD, &rbp, NULL) ||
+            !add_simple_insn(obj, X86I_MOV, X86SZ_QWORD, &rsp, &rbp) ||
+            !add_stack_adjustment(obj, X86I_SUB, adjustment) ||
+            !add_nonvolatile_pushes(obj, routine) ||
+            !add_stack_adjustment(obj, X86I_SUB, x86_routine_outgoing_size(routine)))
+            return false;
+    }
+    else if (!add_nonvolatile_pushes(obj, routine) || !add_stack_adjustment(obj, X86I_SUB, adjustment))
+        return false;
+    if (routine->uses_varargs && !add_varargs_setup(obj))
+        return false;
+    x86_insn_t* cold = x86_routine_cold_start(routine);
+    size_t lr_jumps = 0;
+    x86_insn_t* last = NULL;
+    for (x86_insn_t* insn = routine->insns; insn != cold; insn = insn->next)
+    {
+        if (x86_is_return_jump(insn))
+        {
+            if (insn->next == cold)
+                continue;
+            ++lr_jumps;
+        }
+        if (insn->type == X86I_TAIL_JMP && !add_epilogue(obj, routine, framed, adjustment))
+            return false;
+        if (!add_insn(obj, insn))
+            return false;
+        last = insn;
+    }
+    for (x86_insn_t* insn = cold; insn; insn = insn->next)
+        lr_jumps += x86_is_return_jump(insn);
+    if (lr_jumps || !last || last->type != X86I_TAIL_JMP)
+    {
+        if (lr_jumps > 0)
+        {
+            char buffer[4 + MAX_STRINGIFIED_INTEGER_LENGTH];
+            snprintf(buffer, sizeof(buffer), ".LR%lu", routine->id);
+            if (!add_label(obj, buffer, false))
+                return false;
+        }
+        if (!add_epilogue(obj, routine, framed, adjustment) || !add_simple_insn(obj, X86I_RET, X86SZ_NONE, NULL, NULL))
+            return false;
+    }
+    for (x86_insn_t* insn = cold; insn; insn = insn->next)
+    {
+        if (insn->type == X86I_TAIL_JMP && !add_epilogue(obj, routine, framed, adjustment))
+            return false;
+        if (!add_insn(obj, insn))
+            return false;
+    }
+    return true;
+}
+
+// mirrors x86_write_data
+static bool add_data(elf_object_t* obj, elf_section_id_t id, x86_asm_data_t* data)
+{
+    elf_section_t* section = &obj->sections[id];
+    bytes_align(&section->bytes, data->alignment);
+    if (data->alignment > section->alignment)
+        section->alignment = data->alignment;
+    uint64_t start = section->bytes.size;
+    if (!define_symbol(obj, data->label, id, start, data->global))
+        return false;
+    if (data->aliases)
+    {
+        VECTOR_FOR(x86_asm_alias_t*, alias, data->aliases)
+        {
+            if (!define_symbol(obj, alias->label, id, start + alias->offset, false))
+                return false;
+        }
+    }
+    bytes_append(&section->bytes, data->data, data->length);
+    if (data->addresses)
+    {
+        VECTOR_FOR(x86_asm_init_address_t*, ia, data->addresses)
+        {
+            if (!ia->label)
+                continue;
+            unsigned char* slot = section->bytes.data + start + ia->data_location;
+            int64_t offset;
+            memcpy(&offset, slot, sizeof offset);
+            memset(slot, 0, sizeof offset);
+            add_relocation(section, start + ia->data_location, ia->label, offset, R_X86_64_64);
+        }
+    }
+    return true;
+}
+
+// whether a branch or call to this label is resolved by the assembler without a relocation
+static bool resolves_locally(elf_object_t* obj, char* label)
+{
+    elf_symbol_t* sy = map_get(obj->symbols, label);
+    return sy && sy->defined && sy->section == ELF_TEXT && !sy->global;
+}
+
+static size_t fragment_length(elf_fragment_t* f)
+{
+    if (f->condition == ELF_NOT_A_BRANCH)
+        return f->length;
+    if (!f->long_branch)
+        return 2;
+    return f->condition == ELF_JMP ? 5 : 6;
+}
+
+static void place_fragments(elf_object_t* obj)
+{
+    uint64_t address = 0;
+    VECTOR_FOR(elf_fragment_t*, f, obj->fragments)
+    {
+        f->address = address;
+        if (f->label)
+            get_symbol(obj, f->label)->value = address;
+        address += fragment_length(f);
+    }
+}
+
+// branches start out short and are lengthened until every one of them reaches its target, like the assembler does
+static void relax_branches(elf_object_t* obj)
+{
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        place_fragments(obj);
+        VECTOR_FOR(elf_fragment_t*, f, obj->fragments)
+        {
+            if (f->condition == ELF_NOT_A_BRANCH || f->long_branch)
+                continue;
+            if (resolves_locally(obj, f->target))
+            {
+                int64_t disp = (int64_t) get_symbol(obj, f->target)->value - (int64_t) (f->address + 2);
+                if (fits_int8(disp))
+                    continue;
+            }
+            f->long_branch = true;
+            changed = true;
+        }
+    }
+}
+
+static void emit_branch(elf_fragment_t* f)
+{
+    if (!f->long_branch)
+    {
+        emit_byte(f, f->condition == ELF_JMP ? 0xEB : 0x70 + f->condition);
+        emit_byte(f, 0);
+        return;
+    }
+    if (f->condition == ELF_JMP)
+        emit_byte(f, 0xE9);
+    else
+    {
+        emit_byte(f, 0x0F);
+        emit_byte(f, 0x80 + f->condition);
+    }
+    f->target_location = f->length;
+    f->addend = -4;
+    emit_value(f, 0, 4);
+}
+
+static void emit_text(elf_object_t* obj)
+{
+    elf_section_t* text = &obj->sections[ELF_TEXT];
+    VECTOR_FOR(elf_fragment_t*, f, obj->fragments)
+    {
+        if (f->condition != ELF_NOT_A_BRANCH)
+        {
+            emit_branch(f);
+            if (!f->long_branch)
+            {
+                f->bytes[1] = (int8_t) (get_symbol(obj, f->target)->value - (f->address + 2));
+                bytes_append(&text->bytes, f->bytes, f->length);
+                continue;
+            }
+        }
+        if (f->target)
+        {
+            uint64_t location = f->address + f->target_location;
+            if (resolves_locally(obj, f->target))
+            {
+                int32_t value = get_symbol(obj, f->target)->value + f->addend - location;
+                memcpy(f->bytes + f->target_location, &value, sizeof value);
+            }
+            else
+                add_relocation(text, location, f->target, f->addend, f->reloc_type);
+        }
+        bytes_append(&text->bytes, f->bytes, f->length);
+    }
+}
+
+static void write_section_header(FILE* out, uint32_t name, uint32_t type, uint64_t flags, uint64_t offset, uint64_t size,
+    uint32_t link, uint32_t info, uint64_t alignment, uint64_t entsize)
+{
+    Elf64_Shdr sh = {
+        .sh_name = name,
+        .sh_type = type,
+        .sh_flags = flags,
+        .sh_offset = offset,
+        .sh_size = size,
+        .sh_link = link,
+        .sh_info = info,
+        .sh_addralign = alignment,
+        .sh_entsize = entsize
+    };
+    fwrite(&sh, sizeof sh, 1, out);
+}
+
+static bool write_object(elf_object_t* obj, FILE* out)
+{
+    static const char* SECTION_NAMES[ELF_NO_SECTIONS] = {
+        ".text", ".data", ".rodata", "ecc_profile",
+        ".rodata.str1.1", ".rodata.str4.4", ".rodata.cst4", ".rodata.cst8", ".rodata.cst16"
+    };
+    static const uint64_t SECTION_FLAGS[ELF_NO_SECTIONS] = {
+        SHF_ALLOC | SHF_EXECINSTR,
+        SHF_ALLOC | SHF_WRITE,
+        SHF_ALLOC,
+        SHF_ALLOC | SHF_WRITE,
+        SHF_ALLOC | SHF_MERGE | SHF_STRINGS,
+        SHF_ALLOC | SHF_MERGE | SHF_STRINGS,
+        SHF_ALLOC | SHF_MERGE,
+        SHF_ALLOC | SHF_MERGE,
+        SHF_ALLOC | SHF_MERGE
+    };
+    static const uint64_t SECTION_ENTRY_SIZES[ELF_NO_SECTIONS] = { 0, 0, 0, 0, 1, 4, 4, 8, 16 };
+
+    // every referenced label needs a symbol, even if it's undefined
+    for (size_t id = 0; id < ELF_NO_SECTIONS; ++id)
+    {
+        VECTOR_FOR(elf_relocation_t*, r, obj->sections[id].relocations)
+        {
+            elf_symbol_t* sy = get_symbol(obj, r->label);
+            // the assembler won't leave a local label undefined
+            if (!sy->defined && is_local_label(sy->name))
+                return false;
+        }
+    }
+
+    // symbol table: null, section symbols, local symbols, then global symbols
+    elf_bytes_t strtab = { 0 };
+    bytes_append(&strtab, "", 1);
+    elf_bytes_t symtab = { 0 };
+    Elf64_Sym null_sym = { 0 };
+    bytes_append(&symtab, &null_sym, sizeof null_sym);
+    size_t symbols = 1;
+    for (size_t id = 0; id < ELF_NO_SECTIONS; ++id, ++symbols)
+    {
+        Elf64_Sym sym = {
+            .st_info = ELF64_ST_INFO(STB_LOCAL, STT_SECTION),
+            .st_shndx = ELF_SECTION_SHNDX(id)
+        };
+        bytes_append(&symtab, &sym, sizeof sym);
+    }
+    size_t first_global = 0;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        bool global = pass == 1;
+        if (global)
+            first_global = symbols;
+        VECTOR_FOR(elf_symbol_t*, sy, obj->symbol_order)
+        {
+            if ((sy->global || !sy->defined) != global || is_local_label(sy->name))
+                continue;
+            Elf64_Sym sym = {
+                .st_name = bytes_append_string(&strtab, sy->name),
+                .st_info = ELF64_ST_INFO(global ? STB_GLOBAL : STB_LOCAL, STT_NOTYPE),
+                .st_shndx = sy->defined ? ELF_SECTION_SHNDX(sy->section) : SHN_UNDEF,
+                .st_value = sy->defined ? sy->value : 0
+            };
+            sy->index = symbols++;
+            bytes_append(&symtab, &sym, sizeof sym);
+        }
+    }
+
+    // relocations against local symbols go through their section's symbol, unless it's a mergeable section and the
+    // addend would have the linker look for what they point to in the wrong entry
+    elf_bytes_t relas[ELF_NO_SECTIONS] = { { 0 } };
+    for (size_t id = 0; id < ELF_NO_SECTIONS; ++id)
+    {
+        VECTOR_FOR(elf_relocation_t*, r, obj->sections[id].relocations)
+        {
+            elf_symbol_t* sy = get_symbol(obj, r->label);
+            size_t index = sy->index;
+            int64_t addend = r->addend;
+            if (sy->defined && !sy->global && !(SECTION_ENTRY_SIZES[sy->section] && addend))
+            {
+                index = 1 + sy->section;
+                addend += sy->value;
+            }
+            Elf64_Rela rela = {
+                .r_offset = r->offset,
+                .r_info = ELF64_R_INFO(index, r->type),
+                .r_addend = addend
+            };
+            bytes_append(&relas[id], &rela, sizeof rela);
+        }
+    }
+
+    elf_bytes_t shstrtab = { 0 };
+    bytes_append(&shstrtab, "", 1);
+    uint32_t section_names[ELF_NO_SECTIONS];
+    uint32_t rela_names[ELF_NO_SECTIONS];
+    for (size_t id = 0; id < ELF_NO_SECTIONS; ++id)
+    {
+        char name[32];
+        snprintf(name, sizeof name, ".rela%s", SECTION_NAMES[id]);
+        rela_names[id] = bytes_append_string(&shstrtab, name);
+        // ".text" is the tail of ".rela.text", so it can share the string
+        section_names[id] = rela_names[id] + 5;
+    }
+    uint32_t symtab_name = bytes_append_string(&shstrtab, ".symtab");
+    uint32_t strtab_name = bytes_append_string(&shstrtab, ".strtab");
+    uint32_t shstrtab_name = bytes_append_string(&shstrtab, ".shstrtab");
+    uint32_t note_name = bytes_append_string(&shstrtab, ".note.GNU-stack");
+
+    // lay out the contents after the header, 8-byte aligned where it matters
+    uint64_t offset = sizeof(Elf64_Ehdr);
+    uint64_t section_offsets[ELF_NO_SECTIONS], rela_offsets[ELF_NO_SECTIONS];
+    for (size_t id = 0; id < ELF_NO_SECTIONS; ++id)
+    {
+        size_t alignment = obj->sections[id].alignment ? obj->sections[id].alignment : 1;
+        offset = (offset + alignment - 1) / alignment * alignment;
+        section_offsets[id] = offset;
+        offset += obj->sections[id].bytes.size;
+        offset = (offset + 7) & ~7ULL;
+        rela_offsets[id] = offset;
+        offset += relas[id].size;
+    }
+    uint64_t symtab_offset = offset;
+    offset += symtab.size;
+    uint64_t strtab_offset = offset;
+    offset += strtab.size;
+    uint64_t shstrtab_offset = offset;
+    offset += shstrtab.size;
+    uint64_t shoff = (offset + 7) & ~7ULL;
+
+    Elf64_Ehdr eh = {
+        .e_ident = { ELFMAG0, ELFMAG1, ELFMAG2, ELFMAG3, ELFCLASS64, ELFDATA2LSB, EV_CURRENT, ELFOSABI_SYSV },
+        .e_type = ET_REL,
+        .e_machine = EM_X86_64,
+        .e_version = EV_CURRENT,
+        .e_shoff = shoff,
+        .e_ehsize = sizeof(Elf64_Ehdr),
+        .e_shentsize = sizeof(Elf64_Shdr),
+        .e_shnum = ELF_NO_SHNDX,
+        .e_shstrndx = ELF_SHNDX_SHSTRTAB
+    };
+    fwrite(&eh, sizeof eh, 1, out);
+
+    #define PAD_TO(location) while ((uint64_t) ftell(out) < (location)) fputc(0, out);
+    for (size_t id = 0; id < ELF_NO_SECTIONS; ++id)
+    {
+        PAD_TO(section_offsets[id]);
+        fwrite(obj->sections[id].bytes.data, 1, obj->sections[id].bytes.size, out);
+        PAD_TO(rela_offsets[id]);
+        fwrite(relas[id].data, 1, relas[id].size, out);
+    }
+    fwrite(symtab.data, 1, symtab.size, out);
+    fwrite(strtab.data, 1, strtab.size, out);
+    fwrite(shstrtab.data, 1, shstrtab.size, out);
+    PAD_TO(shoff);
+    #undef PAD_TO
+
+    write_section_header(out, 0, SHT_NULL, 0, 0, 0, 0, 0, 0, 0);
+    for (size_t id = 0; id < ELF_NO_SECTIONS; ++id)
+    {
+        elf_section_t* section = &obj->sections[id];
+        write_section_header(out, section_names[id], SHT_PROGBITS, SECTION_FLAGS[id], section_offsets[id], section->bytes.size,
+            0, 0, section->alignment ? section->alignment : 1, SECTION_ENTRY_SIZES[id]);
+        if (id >= ELF_FIRST_MERGEABLE)
+            continue;
+        write_section_header(out, rela_names[id], SHT_RELA, SHF_INFO_LINK, rela_offsets[id], relas[id].size,
+            ELF_SHNDX_SYMTAB, ELF_SECTION_SHNDX(id), 8, sizeof(Elf64_Rela));
+    }
+    write_section_header(out, symtab_name, SHT_SYMTAB, 0, symtab_offset, symtab.size, ELF_SHNDX_STRTAB, first_global, 8, sizeof(Elf64_Sym));
+    write_section_header(out, strtab_name, SHT_STRTAB, 0, strtab_offset, strtab.size, 0, 0, 1, 0);
+    write_section_header(out, shstrtab_name, SHT_STRTAB, 0, shstrtab_offset, shstrtab.size, 0, 0, 1, 0);
+    write_section_header(out, note_name, SHT_PROGBITS, 0, shoff, 0, 0, 0, 1, 0);
+
+    for (size_t id = 0; id < ELF_NO_SECTIONS; ++id)
+        free(relas[id].data);
+    free(symtab.data);
+    free(strtab.data);
+    free(shstrtab.data);
+    return !ferror(out);
+}
+
+// starts an object that routines are encoded into as they're added to the file
+void x86_asm_file_stream_elf(x86_asm_file_t* file)
+{
+    if (file->object_stream) return;
+    elf_object_t* obj = calloc(1, sizeof *obj);
+    for (size_t id = 0; id < ELF_NO_SECTIONS; ++id)
+        obj->sections[id].relocations = vector_init();
+    obj->symbols = map_init((comparator_t) strcmp, (hash_function_t) hash);
+    obj->symbol_order = vector_init();
+    obj->fragments = vector_init();
+    file->object_stream = obj;
+}
+
+bool x86_asm_file_encode_routine(x86_asm_file_t* file, x86_asm_routine_t* routine)
+{
+    return file->object_stream && add_routine(file->object_stream, routine);
+}
+
+void x86_asm_file_discard_elf(x86_asm_file_t* file)
+{
+    elf_object_t* obj = file->object_stream;
+    if (!obj) return;
+    for (size_t id = 0; id < ELF_NO_SECTIONS; ++id)
+    {
+        free(obj->sections[id].bytes.data);
+        vector_deep_delete(obj->sections[id].relocations, free);
+    }
+    map_delete(obj->symbols);
+    vector_deep_delete(obj->symbol_order, free);
+    vector_deep_delete(obj->fragments, free);
+    free(obj);
+    file->object_stream = NULL;
+}
+
+// finishes the object with whatever routines the file kept and its data, writes it out, and discards it
+bool x86_asm_file_write_elf(x86_asm_file_t* file, FILE* out)
+{
+    x86_asm_file_stream_elf(file);
+    elf_object_t* obj = file->object_stream;
+
+    bool success = true;
+    VECTOR_FOR(x86_asm_routine_t*, routine, file->routines)
+        success = success && add_routine(obj, routine);
+    VECTOR_FOR(x86_asm_data_t*, data, file->data)
+        success = success && add_data(obj, ELF_DATA, data);
+    VECTOR_FOR(x86_asm_data_t*, rodata, file->rodata)
+        success = success && add_data(obj, RODATA_SECTIONS[rodata->section], rodata);
+    VECTOR_FOR(x86_asm_data_t*, profile, file->profile)
+        success = success && add_data(obj, ELF_PROFILE, profile);
+
+    if (success)
+    {
+        relax_branches(obj);
+        emit_text(obj);
+        success = write_object(obj, out);
+    }
+
+    x86_asm_file_discard_elf(file);
+    return success;
+}
@@ -3,84 +3,80 @@
 
 #include "ecc.h"
 
+// an undirected graph over ids, each vertex keeping its neighbors as a bitset
+
 void graph_delete(graph_t* graph)
 {
     if (!graph) return;
-    set_delete(graph->lists);
+    IMAP_FOR(uint64_t, bitset_t*, graph->lists)
+    {
+        (void) k;
+        bitset_delete(v);
+    }
+    imap_delete(graph->lists);
     free(graph);
 }
 
-graph_t* graph_init(int (*comparator)(void*, void*), unsigned long (*hash)(void*), void (*vertex_deleter)(void*))
+graph_t* graph_init(void)
 {
     graph_t* graph = calloc(1, sizeof *graph);
-    graph->lists = map_init(comparator, hash);
-    map_set_deleters(graph->lists, vertex_deleter, (void (*)(void*)) set_delete);
-    graph->comparator = comparator;
-    graph->hash = hash;
-    graph->vertex_deleter = vertex_deleter;
+    graph->lists = imap_init();
     return graph;
 }
 
-bool graph_add_vertex(graph_t* graph, void* item)
+bool graph_add_vertex(graph_t* graph, uint64_t vertex)
 {
-    if (map_contains_key(graph->lists, item))
+    if (imap_contains(graph->lists, vertex))
         return false;
-    map_t* set = set_init(graph->comparator, graph->hash);
-    set_set_deleter(set, graph->vertex_deleter);
-    map_add(graph->lists, item, set);
+    imap_add(graph->lists, vertex, (uint64_t) bitset_init());
     return true;
 }
 
-bool graph_add_edge(graph_t* graph, void* from, void* to)
+bool graph_add_edge(graph_t* graph, uint64_t from, uint64_t to)
 {
-    map_t* from_set = map_get(graph->lists, from);
-    if (!from_set)
-        return false;
-    map_t* to_set = map_get(graph->lists, to);
-    if (!to_set)
+    bitset_t* from_set = (bitset_t*) imap_get(graph->lists, from);
+    bitset_t* to_set = (bitset_t*) imap_get(graph->lists, to);
+    if (!from_set || !to_set)
         return false;
-    set_add(from_set, to);
-    set_add(to_set, from);
+    bitset_add(from_set, to);
+    bitset_add(to_set, from);
     return true;
 }
 
-bool graph_remove_vertex(graph_t* graph, void* item)
+bool graph_remove_vertex(graph_t* graph, uint64_t vertex)
 {
-    if (!map_contains_key(graph->lists, item))
+    bitset_t* vset = (bitset_t*) imap_remove(graph->lists, vertex);
+    if (!vset)
         return false;
-    map_t* vset = map_get(graph->lists, item);
-    MAP_FOR(void*, void*, vset)
+    for (size_t w = 0; w < vset->count; ++w)
     {
-        (void) v;
-        map_t* set = map_get(graph->lists, k);
-        set_remove(set, item);
+        for (uint64_t bits = vset->words[w]; bits; bits &= bits - 1)
+        {
+            uint64_t neighbor = w * 64 + __builtin_ctzll(bits);
+            bitset_t* set = (bitset_t*) imap_get(graph->lists, neighbor);
+            if (set)
+                bitset_remove(set, vertex);
+        }
     }
-    map_remove(graph->lists, item);
+    bitset_delete(vset);
     return true;
 }
 
-bool graph_remove_edge(graph_t* graph, void* from, void* to)
+bool graph_remove_edge(graph_t* graph, uint64_t from, uint64_t to)
 {
-    map_t* from_set = map_get(graph->lists, from);
-    if (!from_set)
+    bitset_t* from_set = (bitset_t*) imap_get(graph->lists, from);
+    bitset_t* to_set = (bitset_t*) imap_get(graph->lists, to);
+    if (!from_set || !to_set)
         return false;
-    map_t* to_set = map_get(graph->lists, to);
-    if (!to_set)
-        return false;
-    set_remove(from_set, to);
-    set_remove(to_set, from);
+    bitset_remove(from_set, to);
+    bitset_remove(to_set, from);
     return true;
 }
 
-bool graph_has_edge(graph_t* graph, void* from, void* to)
+bool graph_has_edge(graph_t* graph, uint64_t from, uint64_t to)
 {
-    map_t* from_set = map_get(graph->lists, from);
-    if (!from_set)
-        return false;
-    map_t* to_set = map_get(graph->lists, to);
-    if (!to_set)
-        return false;
-    return set_contains(from_set, to) && set_contains(to_set, from);
+    bitset_t* from_set = (bitset_t*) imap_get(graph->lists, from);
+    return from_set && bitset_has(from_set, to);
 }
 
 size_t graph_size(graph_t* graph)
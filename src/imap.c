@@ -0,0 +1,179 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "ecc.h"
+
+/*
+
+containers keyed by the integers the backend names things by: register ids, instruction ids, and block ids.
+
+an imap_t maps them to integers or pointers without the comparator and hash calls map_t makes on every probe. its
+capacity is a power of two and it probes linearly from a multiplicative hash of the key, so a lookup is a multiply, a
+shift, and usually a single compare. removing a key shifts the entries after it back into place instead of leaving a
+tombstone behind. IMAP_EMPTY can't be used as a key.
+
+a bitset_t is a set of them as a growable array of 64-bit words, for when the ids are dense enough that a bit for
+every id up to the largest is cheaper than hashing.
+
+*/
+
+#define IMAP_INITIAL_CAPACITY 16
+
+static inline size_t imap_slot(imap_t* m, uint64_t key)
+{
+    return (size_t) ((key * 0x9E3779B97F4A7C15ULL) >> m->shift);
+}
+
+static void imap_allocate(imap_t* m, size_t capacity)
+{
+    m->capacity = capacity;
+    m->shift = 64;
+    for (size_t c = capacity; c > 1; c >>= 1)
+        --m->shift;
+    m->keys = malloc(capacity * sizeof(uint64_t));
+    m->values = malloc(capacity * sizeof(uint64_t));
+    memset(m->keys, 0xFF, capacity * sizeof(uint64_t));
+}
+
+imap_t* imap_init(void)
+{
+    imap_t* m = calloc(1, sizeof *m);
+    imap_allocate(m, IMAP_INITIAL_CAPACITY);
+    return m;
+}
+
+void imap_delete(imap_t* m)
+{
+    if (!m) return;
+    free(m->keys);
+    free(m->values);
+    free(m);
+}
+
+static size_t imap_find(imap_t* m, uint64_t key)
+{
+    size_t mask = m->capacity - 1;
+    size_t i = imap_slot(m, key);
+    while (m->keys[i] != key && m->keys[i] != IMAP_EMPTY)
+        i = (i + 1) & mask;
+    return i;
+}
+
+// grows at 3/4 full, which keeps linear probe sequences short with a decent hash
+static void imap_grow(imap_t* m)
+{
+    uint64_t* keys = m->keys;
+    uint64_t* values = m->values;
+    size_t capacity = m->capacity;
+    imap_allocate(m, capacity * 2);
+    for (size_t i = 0; i < capacity; ++i)
+    {
+        if (keys[i] == IMAP_EMPTY) continue;
+        size_t j = imap_find(m, keys[i]);
+        m->keys[j] = keys[i];
+        m->values[j] = values[i];
+    }
+    free(keys);
+    free(values);
+}
+
+// returns the value the key had before, 0 if it had none
+uint64_t imap_add(imap_t* m, uint64_t key, uint64_t value)
+{
+    size_t i = imap_find(m, key);
+    if (m->keys[i] == key)
+    {
+        uint64_t old = m->values[i];
+        m->values[i] = value;
+        return old;
+    }
+    if ((m->size + 1) * 4 > m->capacity * 3)
+    {
+        imap_grow(m);
+        i = imap_find(m, key);
+    }
+    m->keys[i] = key;
+    m->values[i] = value;
+    ++m->size;
+    return 0;
+}
+
+void imap_clear(imap_t* m)
+{
+    if (!m->size) return;
+    memset(m->keys, 0xFF, m->capacity * sizeof(uint64_t));
+    m->size = 0;
+}
+
+// 0 if the key isn't in the map
+uint64_t imap_get(imap_t* m, uint64_t key)
+{
+    size_t i = imap_find(m, key);
+    return m->keys[i] == key ? m->values[i] : 0;
+}
+
+bool imap_contains(imap_t* m, uint64_t key)
+{
+    return m->keys[imap_find(m, key)] == key;
+}
+
+// returns the value the key had, 0 if it had none
+uint64_t imap_remove(imap_t* m, uint64_t key)
+{
+    size_t i = imap_find(m, key);
+    if (m->keys[i] != key)
+        return 0;
+    uint64_t old = m->values[i];
+    size_t mask = m->capacity - 1;
+    // pull back every later entry in the run whose home slot doesn't fall between the hole and where it sits
+    for (size_t j = (i + 1) & mask; m->keys[j] != IMAP_EMPTY; j = (j + 1) & mask)
+    {
+        size_t home = imap_slot(m, m->keys[j]);
+        if (((j - home) & mask) < ((j - i) & mask))
+            continue;
+        m->keys[i] = m->keys[j];
+        m->values[i] = m->values[j];
+        i = j;
+    }
+    m->keys[i] = IMAP_EMPTY;
+    --m->size;
+    return old;
+}
+
+bitset_t* bitset_init(void)
+{
+    return calloc(1, sizeof(bitset_t));
+}
+
+void bitset_delete(bitset_t* b)
+{
+    if (!b) return;
+    free(b->words);
+    free(b);
+}
+
+void bitset_add(bitset_t* b, uint64_t index)
+{
+    size_t word = index / 64;
+    if (word >= b->count)
+    {
+        size_t count = b->count ? b->count : 1;
+        while (count <= word)
+            count *= 2;
+        b->words = realloc(b->words, count * sizeof(uint64_t));
+        memset(b->words + b->count, 0, (count - b->count) * sizeof(uint64_t));
+        b->count = count;
+    }
+    b->words[word] |= 1ULL << (index % 64);
+}
+
+void bitset_remove(bitset_t* b, uint64_t index)
+{
+    if (index / 64 < b->count)
+        b->words[index / 64] &= ~(1ULL << (index % 64));
+}
+
+bool bitset_has(bitset_t* b, uint64_t index)
+{
+    return index / 64 < b->count && (b->words[index / 64] >> (index % 64)) & 1;
+}
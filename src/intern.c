@@ -0,0 +1,57 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "ecc.h"
+
+/*
+
+interned strings are unique for their contents, so two interned strings are equal iff their pointers are equal.
+each one is stored right after its hash so tables keyed by them never need to rehash the contents, and after the
+keyword it spells (if any) so the tokenizer never needs to look it up again.
+they live for the rest of the program and must never be freed.
+
+*/
+
+typedef struct interned_string
+{
+    unsigned long hash;
+    int keyword; // c_keyword_t, or -1
+    char str[];
+} interned_string_t;
+
+static map_t* pool = NULL; // map_t<char*, char*>
+
+#define INTERNED(s) ((interned_string_t*) ((s) - offsetof(interned_string_t, str)))
+
+char* intern(char* str)
+{
+    if (!str) return NULL;
+    if (!pool)
+        pool = map_init((comparator_t) strcmp, (hash_function_t) hash);
+    char* found = map_get(pool, str);
+    if (found)
+        return found;
+    size_t length = strlen(str);
+    interned_string_t* is = malloc(sizeof *is + length + 1);
+    is->hash = hash(str);
+    memcpy(is->str, str, length + 1);
+    is->keyword = keyword_lookup(is->str);
+    map_add(pool, is->str, is->str);
+    return is->str;
+}
+
+unsigned long intern_hash(char* interned)
+{
+    return INTERNED(interned)->hash;
+}
+
+int intern_keyword(char* interned)
+{
+    return INTERNED(interned)->keyword;
+}
+
+int intern_comparator(char* a, char* b)
+{
+    return a != b;
+}
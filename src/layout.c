@@ -0,0 +1,360 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ecc.h"
+
+/*
+
+block layout and branch profiling.
+
+airinize lays blocks out in source order, so the code for an unlikely path sits in the middle of the likely one,
+which has to jump over it. layout looks for regions that can only be entered by falling through a conditional
+jump that otherwise skips right past them:
+
+    jz(.L1, _1);
+    ... region ...
+.L1:
+
+when such a region is cold, the jump is inverted to go to the region instead, and the region is moved past the
+end of the routine, where the x86 writers put it after the epilogue. a region that used to fall through into .L1
+gets a jump back there.
+
+without a profile, a region is cold if it ends in a return and has no loop in it, the "early returns are unlikely"
+heuristic from Ball and Larus. loops need nothing, since they're already lowered with their condition at the
+bottom and the back edge as the taken side of the branch.
+
+with -b, every conditional jump gets a pair of counters, one bumped right before it and one right after it, which
+only runs when the jump falls through. each routine's counters go in a record in the ecc_profile section, and
+crt0 writes the whole section out to ecc.profile once main returns. -B reads such a file back in, and a region is
+then cold if the jump falling into it did so less than one time in COLD_FRACTION. records with the same key are
+summed, so the profiles of several runs can simply be concatenated.
+
+counters are matched up with jumps by their order in the routine, so a profile only applies to the same source
+compiled the same way up to this point. a routine whose record has the wrong number of counters is laid out as if
+there was no profile for it.
+
+a record, in 64-bit words:
+
+    size of the record in bytes
+    number of counters
+    key ("filepath:routine"), null-terminated and zero-padded to a whole word
+    counters
+
+*/
+
+#define COLD_FRACTION 10
+
+#define PROFILE_RECORD_HEADER_WORDS 2
+
+typedef struct branch_counts
+{
+    size_t length;
+    unsigned long long* counters;
+} branch_counts_t;
+
+static void branch_counts_delete(branch_counts_t* counts)
+{
+    if (!counts) return;
+    free(counts->counters);
+    free(counts);
+}
+
+static char* routine_key(char* filepath, air_routine_t* routine)
+{
+    char* name = symbol_get_name(routine->sy);
+    size_t length = strlen(filepath) + strlen(name) + 2;
+    char* key = malloc(length);
+    snprintf(key, length, "%s:%s", filepath, name);
+    return key;
+}
+
+static bool is_conditional_jump(air_insn_t* insn)
+{
+    return insn->type == AIR_JZ || insn->type == AIR_JNZ;
+}
+
+static bool falls_through(air_insn_t* insn)
+{
+    switch (insn->type)
+    {
+        case AIR_JMP:
+        case AIR_JMP_TABLE:
+        case AIR_RETURN:
+            return false;
+        default:
+            return true;
+    }
+}
+
+static air_insn_t* make_counter_bump(symbol_t* record, long long offset)
+{
+    air_insn_t* bump = air_insn_init(AIR_DIRECT_ADD, 2);
+    bump->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+    bump->ops[0] = air_insn_indirect_symbol_operand_init(record, offset);
+    bump->ops[1] = air_insn_integer_constant_operand_init(1);
+    return bump;
+}
+
+static symbol_t* make_profile_record(air_t* air, char* key, size_t counters)
+{
+    char name[13 + MAX_STRINGIFIED_INTEGER_LENGTH + 1];
+    snprintf(name, sizeof name, "__ecc_profile%u", air->profile->size);
+    symbol_t* sy = symbol_table_add(air->st, name, symbol_init(NULL));
+    sy->name = strdup(name);
+    size_t key_words = strlen(key) / UNSIGNED_LONG_LONG_INT_WIDTH + 1;
+    size_t words = PROFILE_RECORD_HEADER_WORDS + key_words + counters;
+    sy->type = make_basic_type(CTC_ARRAY);
+    sy->type->derived_from = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+    sy->type->array.length = words;
+    sy->sd = SD_STATIC;
+
+    air_data_t* data = calloc(1, sizeof *data);
+    data->sy = sy;
+    data->data = calloc(words, UNSIGNED_LONG_LONG_INT_WIDTH);
+    unsigned long long* header = (unsigned long long*) data->data;
+    header[0] = words * UNSIGNED_LONG_LONG_INT_WIDTH;
+    header[1] = counters;
+    memcpy(header + PROFILE_RECORD_HEADER_WORDS, key, strlen(key));
+    vector_add(air->profile, data);
+    return sy;
+}
+
+void instrument_branches(air_t* air, char* filepath)
+{
+    VECTOR_FOR(air_routine_t*, routine, air->routines)
+    {
+        size_t jumps = 0;
+        for (air_insn_t* insn = routine->insns; insn; insn = insn->next)
+        {
+            if (is_conditional_jump(insn))
+                ++jumps;
+        }
+        if (!jumps)
+            continue;
+
+        char* key = routine_key(filepath, routine);
+        symbol_t* record = make_profile_record(air, key, 2 * jumps);
+        long long offset = (PROFILE_RECORD_HEADER_WORDS + strlen(key) / UNSIGNED_LONG_LONG_INT_WIDTH + 1) * UNSIGNED_LONG_LONG_INT_WIDTH;
+        free(key);
+
+        for (air_insn_t* insn = routine->insns; insn; insn = insn->next)
+        {
+            if (!is_conditional_jump(insn))
+                continue;
+            air_insn_insert_before(make_counter_bump(record, offset), insn);
+            // nothing can jump in between, so this only counts falling through
+            insn = air_insn_insert_after(make_counter_bump(record, offset + UNSIGNED_LONG_LONG_INT_WIDTH), insn);
+            offset += 2 * UNSIGNED_LONG_LONG_INT_WIDTH;
+        }
+        air_routine_invalidate_cfg(routine);
+    }
+}
+
+map_t* branch_profile_read(char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return NULL;
+    size_t count = 0, capacity = 1024;
+    unsigned long long* words = malloc(capacity * sizeof *words);
+    for (size_t r; (r = fread(words + count, sizeof *words, capacity - count, file)) > 0;)
+    {
+        count += r;
+        if (count == capacity)
+            words = realloc(words, (capacity *= 2) * sizeof *words);
+    }
+    fclose(file);
+
+    map_t* profile = map_init((comparator_t) strcmp, (hash_function_t) hash);
+    map_set_deleters(profile, free, (void (*)(void*)) branch_counts_delete);
+    for (size_t at = 0; at < count;)
+    {
+        unsigned long long size = words[at] / UNSIGNED_LONG_LONG_INT_WIDTH;
+        // the linker may pad between the sections of different objects
+        if (!size)
+        {
+            ++at;
+            continue;
+        }
+        if (size <= PROFILE_RECORD_HEADER_WORDS || size > count - at ||
+            words[at + 1] >= size - PROFILE_RECORD_HEADER_WORDS)
+        {
+            branch_profile_delete(profile);
+            free(words);
+            return NULL;
+        }
+        unsigned long long length = words[at + 1];
+        char* key = (char*) (words + at + PROFILE_RECORD_HEADER_WORDS);
+        bool terminated = memchr(key, '\0', (size - PROFILE_RECORD_HEADER_WORDS - length) * UNSIGNED_LONG_LONG_INT_WIDTH);
+        unsigned long long* counters = words + at + size - length;
+        branch_counts_t* counts = terminated ? map_get(profile, key) : NULL;
+        if (counts)
+        {
+            for (size_t i = 0; i < length && counts->length == length; ++i)
+                counts->counters[i] += counters[i];
+        }
+        else if (terminated)
+        {
+            counts = calloc(1, sizeof *counts);
+            counts->length = length;
+            counts->counters = malloc(length * sizeof *counts->counters);
+            memcpy(counts->counters, counters, length * sizeof *counts->counters);
+            map_add(profile, strdup(key), counts);
+        }
+        at += size;
+    }
+    free(words);
+    return profile;
+}
+
+void branch_profile_delete(map_t* profile)
+{
+    map_delete(profile);
+}
+
+// labels are identified by their number and disambiguator together
+static void* label_key(air_insn_operand_t* op)
+{
+    return (void*) ((op->content.label.id << 8) | (unsigned char) op->content.label.disambiguator);
+}
+
+// whether the blocks from first to last (by id) can only be entered through first, by falling into it from the block before
+static bool is_single_entry(air_cfg_t* cfg, size_t first, size_t last)
+{
+    for (size_t id = first; id <= last; ++id)
+    {
+        air_block_t* block = vector_get(cfg->blocks, id);
+        VECTOR_FOR(air_block_t*, pred, block->predecessors)
+        {
+            if (pred->id >= first && pred->id <= last)
+                continue;
+            if (id != first || pred->id != first - 1)
+                return false;
+        }
+    }
+    return true;
+}
+
+static bool is_statically_cold(air_cfg_t* cfg, size_t first, size_t last)
+{
+    air_block_t* end = vector_get(cfg->blocks, last);
+    if (end->last->type != AIR_RETURN)
+        return false;
+    VECTOR_FOR(air_loop_t*, loop, cfg->loops)
+    {
+        if (loop->header->id >= first && loop->header->id <= last)
+            return false;
+    }
+    return true;
+}
+
+static bool is_cold(air_cfg_t* cfg, size_t first, size_t last, branch_counts_t* counts, size_t jump)
+{
+    if (!counts || !counts->counters[2 * jump])
+        return is_statically_cold(cfg, first, last);
+    return counts->counters[2 * jump + 1] * COLD_FRACTION < counts->counters[2 * jump];
+}
+
+static air_insn_t* make_label(air_t* air, unsigned long long* label)
+{
+    *label = ++air->next_available_layout_label;
+    air_insn_t* insn = air_insn_init(AIR_LABEL, 1);
+    insn->ops[0] = air_insn_label_operand_init(*label, 'B');
+    return insn;
+}
+
+static void layout_routine(air_routine_t* routine, air_t* air, branch_counts_t* counts)
+{
+    air_insn_t* tail = routine->insns;
+    size_t jumps = 0;
+    map_t* ordinals = map_init(pointer_comparator, pointer_hash); // map_t<air_insn_t*, size_t>, one more than the jump's number
+    for (air_insn_t* insn = routine->insns; insn; tail = insn, insn = insn->next)
+    {
+        if (is_conditional_jump(insn))
+            map_add(ordinals, insn, (void*) ++jumps);
+    }
+    if (counts && counts->length != 2 * jumps)
+        counts = NULL;
+
+    air_cfg_t* cfg = air_routine_cfg(routine);
+    map_t* labels = map_init(pointer_comparator, pointer_hash); // map_t<label key, air_block_t*>
+    VECTOR_FOR(air_block_t*, block, cfg->blocks)
+    {
+        if (block->first->type == AIR_LABEL)
+            map_add(labels, label_key(block->first->ops[0]), block);
+    }
+
+    bool moved = false;
+    for (size_t id = 0; id + 1 < cfg->blocks->size; ++id)
+    {
+        air_block_t* branching = vector_get(cfg->blocks, id);
+        air_insn_t* jump = branching->last;
+        if (!is_conditional_jump(jump) || jump->ops[0]->type != AOP_LABEL)
+            continue;
+        air_block_t* target = map_get(labels, label_key(jump->ops[0]));
+        if (!target || target->id <= id + 1)
+            continue;
+        size_t first = id + 1, last = target->id - 1;
+        if (!is_single_entry(cfg, first, last) || !is_cold(cfg, first, last, counts, (size_t) map_get(ordinals, jump) - 1))
+            continue;
+
+        // falling off the end of the routine returns, which has to be said outright before anything goes after it
+        if (!moved)
+        {
+            if (falls_through(tail))
+                tail = air_insn_insert_after(air_insn_init(AIR_RETURN, 0), tail);
+            tail = air_insn_insert_after(make_label(air, &routine->cold_label), tail);
+            moved = true;
+        }
+
+        air_block_t* start = vector_get(cfg->blocks, first);
+        air_block_t* end = vector_get(cfg->blocks, last);
+        air_insn_t* region_first = start->first;
+        air_insn_t* region_last = end->last;
+        if (region_first->type != AIR_LABEL)
+        {
+            unsigned long long label;
+            region_first = air_insn_insert_before(make_label(air, &label), region_first);
+        }
+        if (falls_through(region_last))
+        {
+            air_insn_t* back = air_insn_init(AIR_JMP, 1);
+            back->ops[0] = air_insn_operand_copy(jump->ops[0]);
+            region_last = air_insn_insert_after(back, region_last);
+        }
+
+        jump->type = jump->type == AIR_JZ ? AIR_JNZ : AIR_JZ;
+        air_insn_operand_delete(jump->ops[0]);
+        jump->ops[0] = air_insn_operand_copy(region_first->ops[0]);
+
+        region_first->prev->next = region_last->next;
+        region_last->next->prev = region_first->prev;
+        region_first->prev = tail;
+        tail->next = region_first;
+        region_last->next = NULL;
+        tail = region_last;
+
+        id = last;
+    }
+
+    map_delete(labels);
+    map_delete(ordinals);
+    if (moved)
+        air_routine_invalidate_cfg(routine);
+}
+
+void layout(air_t* air, char* filepath, map_t* profile)
+{
+    VECTOR_FOR(air_routine_t*, routine, air->routines)
+    {
+        branch_counts_t* counts = NULL;
+        if (profile)
+        {
+            char* key = routine_key(filepath, routine);
+            counts = map_get(profile, key);
+            free(key);
+        }
+        layout_routine(routine, air, counts);
+    }
+}
@@ -1,6 +1,11 @@
+#define _DEFAULT_SOURCE 1
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "ecc.h"
 
@@ -122,15 +127,6 @@ static bool jump_impl(lex_state_t* state, long long cursor, unsigned row, unsign
     return true;
 }
 
-static preprocessing_token_t* add_token(preprocessing_token_t* head, preprocessing_token_t* token)
-{
-    preprocessing_token_t* orig = head;
-    if (!head) return token;
-    for (; head->next; head = head->next);
-    head->next = token;
-    return orig;
-}
-
 static bool in_source_charset(int c)
 {
     return c < 128;
@@ -163,6 +159,121 @@ static bool is_whitespace(int c)
     return c == ' ' || c == '\t' || c == '\v' || c == '\n' || c == '\f';
 }
 
+/*
+
+going through read_impl costs a splice check, a trigraph check, and a peek/unread
+pair for every character, which adds up over long runs of whitespace, comment text,
+and identifiers. none of those runs can contain a splice or trigraph unless there's
+a backslash or a question mark in them, so the runs below are found sixteen bytes at
+a time and stop right before either one, leaving it to the slow path.
+
+*/
+
+typedef enum lex_run
+{
+    LR_WHITESPACE,
+    LR_IDENTIFIER,
+    LR_LINE_COMMENT,
+    LR_BLOCK_COMMENT
+} lex_run_t;
+
+static bool in_run(lex_run_t run, int c)
+{
+    switch (run)
+    {
+        case LR_WHITESPACE:
+            return is_whitespace(c);
+        case LR_IDENTIFIER:
+            return is_nondigit(c) || is_digit(c);
+        case LR_LINE_COMMENT:
+            return c != '\n' && c != '\\' && c != '?';
+        case LR_BLOCK_COMMENT:
+            return c != '*' && c != '\\' && c != '?';
+    }
+    return false;
+}
+
+#ifdef __SSE2__
+
+#include <emmintrin.h>
+
+// lanes holding a byte in [lo, hi]
+static __m128i bytes_in_range(__m128i v, char lo, char hi)
+{
+    __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8((char) (0x80 - lo)));
+    return _mm_cmplt_epi8(shifted, _mm_set1_epi8((char) (0x80 + hi - lo + 1)));
+}
+
+static __m128i bytes_equal(__m128i v, char c)
+{
+    return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));
+}
+
+// one bit per byte of the block that continues the run
+static unsigned run_mask(lex_run_t run, __m128i v)
+{
+    __m128i m = _mm_setzero_si128();
+    switch (run)
+    {
+        case LR_WHITESPACE:
+            // '\t', '\n', '\v', and '\f' are contiguous
+            m = _mm_or_si128(bytes_equal(v, ' '), bytes_in_range(v, '\t', '\f'));
+            break;
+        case LR_IDENTIFIER:
+            m = _mm_or_si128(bytes_in_range(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z'),
+                _mm_or_si128(bytes_in_range(v, '0', '9'), bytes_equal(v, '_')));
+            break;
+        case LR_LINE_COMMENT:
+            m = _mm_or_si128(bytes_equal(v, '\n'), _mm_or_si128(bytes_equal(v, '\\'), bytes_equal(v, '?')));
+            return ~_mm_movemask_epi8(m) & 0xFFFF;
+        case LR_BLOCK_COMMENT:
+            m = _mm_or_si128(bytes_equal(v, '*'), _mm_or_si128(bytes_equal(v, '\\'), bytes_equal(v, '?')));
+            return ~_mm_movemask_epi8(m) & 0xFFFF;
+    }
+    return _mm_movemask_epi8(m);
+}
+
+#endif
+
+// how many characters from the cursor on belong to the run
+static size_t scan_run(lex_state_t* state, lex_run_t run)
+{
+    size_t i = state->cursor;
+    #ifdef __SSE2__
+    for (; i + 16 <= state->length; i += 16)
+    {
+        unsigned mask = run_mask(run, _mm_loadu_si128((__m128i*) (state->data + i)));
+        if (mask != 0xFFFF)
+            return i + __builtin_ctz(~mask) - state->cursor;
+    }
+    #endif
+    for (; i < state->length && in_run(run, state->data[i]); ++i);
+    return i - state->cursor;
+}
+
+// does what count calls to read_impl would over a run with no splices or trigraphs
+static void skip_run(lex_state_t* state, size_t count)
+{
+    if (!count)
+        return;
+    long long from = state->cursor;
+    state->cursor += count;
+    state->counter += count;
+    // each read starts a new line if the byte before it was a newline
+    long long lookback = from ? from - 1 : 0;
+    unsigned char* last = NULL;
+    for (unsigned char* nl = memchr(state->data + lookback, '\n', state->cursor - 1 - lookback); nl;
+        nl = memchr(nl + 1, '\n', state->data + state->cursor - 1 - (nl + 1)))
+    {
+        ++state->row;
+        last = nl;
+    }
+    if (last)
+        state->col = state->data + state->cursor - 1 - last;
+    else
+        state->col += count;
+}
+
 void pp_token_delete_content(preprocessing_token_t* token)
 {
     if (!token) return;
@@ -173,7 +284,7 @@ void pp_token_delete_content(preprocessing_token_t* token)
             token->string_literal.value = NULL;
             break;
         case PPT_IDENTIFIER:
-            free(token->identifier);
+            // identifiers are interned
             token->identifier = NULL;
             break;
         case PPT_PP_NUMBER:
@@ -201,9 +312,12 @@ void pp_token_delete(preprocessing_token_t* token)
 
 void pp_token_delete_all(preprocessing_token_t* tokens)
 {
-    if (!tokens) return;
-    pp_token_delete_all(tokens->next);
-    pp_token_delete(tokens);
+    while (tokens)
+    {
+        preprocessing_token_t* next = tokens->next;
+        pp_token_delete(tokens);
+        tokens = next;
+    }
 }
 
 void pp_token_print(preprocessing_token_t* token, int (*printer)(const char* fmt, ...))
@@ -376,7 +490,7 @@ preprocessing_token_t* pp_token_copy(preprocessing_token_t* token)
         }
         case PPT_IDENTIFIER:
         {
-            n->identifier = strdup(token->identifier);
+            n->identifier = token->identifier;
             break;
         }
         case PPT_PP_NUMBER:
@@ -613,6 +727,12 @@ preprocessing_token_t* lex_identifier(lex_state_t* state)
     buffer_t* buf = buffer_init();
     for (;;)
     {
+        size_t run = scan_run(state, LR_IDENTIFIER);
+        if (run && (buf->size >= 1 || !is_digit(state->data[state->cursor])))
+        {
+            buffer_append_bytes(buf, (char*) state->data + state->cursor, run);
+            skip_run(state, run);
+        }
         if (is_nondigit(peek))
         {
             buffer_append(buf, read);
@@ -647,10 +767,13 @@ preprocessing_token_t* lex_identifier(lex_state_t* state)
         SET_ERROR("identifier cannot be empty");
         return NULL;
     }
-    token->identifier = buffer_export(buf);
+    char* id = buffer_export(buf);
     buffer_delete(buf);
-    if (!strcmp(token->identifier, "include"))
+    // no need to intern anything if the token is only being measured
+    token->identifier = state->counting ? NULL : intern(id);
+    if (!strcmp(id, "include"))
         ++state->include_condition;
+    free(id);
     cleanup_lex_pass;
     return token;
 }
@@ -1192,8 +1315,19 @@ preprocessing_token_t* lex_whitespace(lex_state_t* state)
     init_lex(PPT_WHITESPACE);
     buffer_t* buf = buffer_init();
     bool newlines = false;
-    while (is_whitespace(peek))
+    for (;;)
     {
+        size_t run = scan_run(state, LR_WHITESPACE);
+        if (run)
+        {
+            unsigned char* start = state->data + state->cursor;
+            if (memchr(start, '\n', run))
+                newlines = true;
+            buffer_append_bytes(buf, (char*) start, run);
+            skip_run(state, run);
+        }
+        if (!is_whitespace(peek))
+            break;
         if (p == '\n')
             newlines = true;
         buffer_append(buf, read);
@@ -1223,6 +1357,7 @@ preprocessing_token_t* lex_comment(lex_state_t* state)
         read;
         for (;;)
         {
+            skip_run(state, scan_run(state, LR_LINE_COMMENT));
             read;
             if (c == EOF)
             {
@@ -1247,6 +1382,7 @@ preprocessing_token_t* lex_comment(lex_state_t* state)
         read;
         for (;;)
         {
+            skip_run(state, scan_run(state, LR_BLOCK_COMMENT));
             read;
             if (c == EOF)
             {
@@ -1379,7 +1515,11 @@ preprocessing_token_t* lex_raw(unsigned char* data, size_t length, bool dump_err
         }
         else
         {
-            tokens = add_token(tokens, token);
+            // state->prev is always the tail of the list, so append there instead of walking it
+            if (state->prev)
+                state->prev->next = token;
+            else
+                tokens = token;
             token->prev = state->prev;
             state->prev = token;
         }
@@ -1389,18 +1529,68 @@ preprocessing_token_t* lex_raw(unsigned char* data, size_t length, bool dump_err
     return tokens;
 }
 
+#undef read
+#undef unread
+
+// reads the rest of a non-mappable stream (pipes, ttys, etc.) in as few read() calls as possible
+static unsigned char* read_all(int fd, size_t* length)
+{
+    size_t capacity = 64 * 1024;
+    size_t count = 0;
+    unsigned char* data = malloc(capacity);
+    for (;;)
+    {
+        if (count == capacity)
+            data = realloc(data, capacity *= 2);
+        ssize_t r = read(fd, data + count, capacity - count);
+        if (r < 0)
+        {
+            free(data);
+            *length = 0;
+            return NULL;
+        }
+        if (r == 0)
+            break;
+        count += r;
+    }
+    *length = count;
+    return data;
+}
+
 preprocessing_token_t* lex(FILE* file, bool dump_error)
 {
-    size_t buffer_size = 1024;
+    int fd = fileno(file);
+    struct stat st;
+
+    // regular files are mapped in directly and handed to the lexer without a copy
+    if (fd != -1 && !fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED)
+        {
+            madvise(map, st.st_size, MADV_SEQUENTIAL);
+            preprocessing_token_t* tokens = lex_raw(map, st.st_size, dump_error, false);
+            munmap(map, st.st_size);
+            return tokens;
+        }
+    }
+
     size_t count = 0;
-    unsigned char* data = malloc(buffer_size);
-    for (int c; (c = fgetc(file)) != EOF;)
+    unsigned char* data = NULL;
+    if (fd != -1)
+        data = read_all(fd, &count);
+    else
     {
-        if (count % 1024 == 0)
-            data = realloc(data, buffer_size += 1024);
-        data[count++] = c;
+        size_t capacity = 64 * 1024;
+        data = malloc(capacity);
+        for (size_t r; (r = fread(data + count, 1, capacity - count, file)) > 0;)
+        {
+            count += r;
+            if (count == capacity)
+                data = realloc(data, capacity *= 2);
+        }
     }
     preprocessing_token_t* tokens = lex_raw(data, count, dump_error, false);
     free(data);
     return tokens;
-}
\ No newline at end of file
+}
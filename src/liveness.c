@@ -0,0 +1,288 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ecc.h"
+
+/*
+
+register liveness over an AIR routine.
+
+a register is live at a point if some path from there reads it before writing it. this is the usual backward dataflow
+problem: a block's live-out set is the union of its successors' live-in sets, and its live-in set is what's left after
+stepping the live-out set backwards over each of its instructions, which removes what an instruction defines and then
+adds what it reads. the sets are iterated to a fixed point.
+
+the sets are bitsets over a dense numbering of just the registers the routine names, so they stay small however large
+register ids get. only the sets at block boundaries are kept, and a pass that needs liveness at an instruction steps
+backwards from the end of its block with air_liveness_step.
+
+before localization, a PHI reads all of its operands. that overestimates what's live out of each predecessor, but never
+underestimates it. after localization to x86, instructions also read registers they don't name: integer division reads
+%edx:%eax, syscalls read their argument registers, jump tables read %r11, returns read the return registers, and calls
+read the argument registers loaded for them since the last call in the block.
+
+like the def-use index, liveness is a snapshot: a pass that changes which instructions read or write a register, or
+restructures the CFG, must recompute it. moving a definition within its block is fine as long as it stays ahead of
+its uses.
+
+*/
+
+// solves a backward problem. each block's in set is its out set stepped backwards over its instructions
+void air_cfg_solve_backward(air_cfg_t* cfg, size_t words, unsigned long long* in, unsigned long long* out,
+    void (*transfer)(void* data, air_insn_t* insn, unsigned long long* set), void* data)
+{
+    size_t size = words * sizeof(unsigned long long);
+    unsigned long long* set = malloc(size ? size : 1);
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        // blocks in reverse instruction order mostly see their successors first
+        for (size_t j = cfg->blocks->size; j > 0; --j)
+        {
+            air_block_t* block = vector_get(cfg->blocks, j - 1);
+            unsigned long long* bout = out + block->id * words;
+            unsigned long long* bin = in + block->id * words;
+            VECTOR_FOR(air_block_t*, succ, block->successors)
+            {
+                for (size_t w = 0; w < words; ++w)
+                    bout[w] |= in[succ->id * words + w];
+            }
+            memcpy(set, bout, size);
+            for (air_insn_t* insn = block->last; insn; insn = insn == block->first ? NULL : insn->prev)
+                transfer(data, insn, set);
+            if (memcmp(set, bin, size))
+            {
+                memcpy(bin, set, size);
+                changed = true;
+            }
+        }
+    }
+    free(set);
+}
+
+static void add_register(air_liveness_t* l, regid_t reg)
+{
+    if (reg == INVALID_VREGID || imap_contains(l->indices, reg))
+        return;
+    vector_add(l->registers, (void*) reg);
+    imap_add(l->indices, reg, l->registers->size);
+}
+
+static void add_implicit_use(air_liveness_t* l, air_insn_t* insn, regid_t reg)
+{
+    svector_t* v = (svector_t*) imap_get(l->implicit_uses, insn->id);
+    if (!v)
+    {
+        v = calloc(1, sizeof *v);
+        imap_add(l->implicit_uses, insn->id, (uint64_t) v);
+    }
+    svector_add_if_new(v, reg);
+    add_register(l, reg);
+}
+
+// the register an instruction defines, INVALID_VREGID if none. instructions that assign to a register without
+// creating it read it too, so they don't count
+regid_t air_liveness_definition(air_insn_t* insn)
+{
+    if (!air_insn_creates_temporary(insn) || !insn->noops || !insn->ops[0] || insn->ops[0]->type != AOP_REGISTER)
+        return INVALID_VREGID;
+    return insn->ops[0]->content.reg;
+}
+
+// caller-saved registers that can carry arguments into a call
+static bool is_x86_64_argument_register(regid_t reg)
+{
+    if (reg == INVALID_VREGID || reg > NO_PHYSICAL_REGISTERS)
+        return false;
+    return reg != X86R_RAX && reg != X86R_RBX && reg != X86R_RSP && reg != X86R_RBP && (reg < X86R_R12 || reg > X86R_R15);
+}
+
+static void find_implicit_uses_x86_64(air_liveness_t* l)
+{
+    static const regid_t syscall_registers[] = { X86R_RAX, X86R_RDI, X86R_RSI, X86R_RDX, X86R_R10, X86R_R8, X86R_R9 };
+
+    c_type_t* rettype = l->routine->sy->type->derived_from;
+    svector_t loaded = {0}; // svector_t<regid_t>, argument registers loaded since the last call
+    for (air_insn_t* insn = l->routine->insns; insn; insn = insn->next)
+    {
+        // arguments are loaded in the same block as their call
+        if (air_cfg_block(l->cfg, insn)->first == insn)
+            loaded.size = 0;
+
+        switch (insn->type)
+        {
+            case AIR_DIVIDE:
+            case AIR_MODULO:
+            case AIR_DIRECT_DIVIDE:
+            case AIR_DIRECT_MODULO:
+                // the dividend is in %edx:%eax
+                if (!type_is_integer(insn->ct))
+                    break;
+                add_implicit_use(l, insn, X86R_RAX);
+                add_implicit_use(l, insn, X86R_RDX);
+                break;
+            case AIR_LSYSCALL:
+                for (size_t i = 0; i < sizeof(syscall_registers) / sizeof(syscall_registers[0]); ++i)
+                    add_implicit_use(l, insn, syscall_registers[i]);
+                break;
+            case AIR_JMP_TABLE:
+                add_implicit_use(l, insn, X86R_R11);
+                break;
+            case AIR_FUNC_CALL:
+                for (unsigned i = 0; i < loaded.size; ++i)
+                    add_implicit_use(l, insn, loaded.data[i]);
+                loaded.size = 0;
+                break;
+            case AIR_RETURN:
+                if (type_is_integer(rettype) || rettype->class == CTC_POINTER)
+                    add_implicit_use(l, insn, X86R_RAX);
+                else if (type_is_sse_floating(rettype))
+                    add_implicit_use(l, insn, X86R_XMM0);
+                else if (rettype->class == CTC_STRUCTURE || rettype->class == CTC_UNION)
+                {
+                    add_implicit_use(l, insn, X86R_RAX);
+                    add_implicit_use(l, insn, X86R_RDX);
+                    add_implicit_use(l, insn, X86R_XMM0);
+                    add_implicit_use(l, insn, X86R_XMM1);
+                }
+                break;
+            default:
+                break;
+        }
+
+        // blips only mark a register as clobbered, so they don't load anything
+        regid_t def = air_liveness_definition(insn);
+        if (insn->type != AIR_BLIP && insn->type != AIR_FUNC_CALL && is_x86_64_argument_register(def))
+            svector_add_if_new(&loaded, def);
+    }
+    svector_free(&loaded);
+}
+
+static void find_registers(air_liveness_t* l)
+{
+    for (air_insn_t* insn = l->routine->insns; insn; insn = insn->next)
+    {
+        for (size_t i = 0; i < insn->noops; ++i)
+        {
+            air_insn_operand_t* op = insn->ops[i];
+            if (!op) continue;
+            if (op->type == AOP_REGISTER)
+                add_register(l, op->content.reg);
+            else if (op->type == AOP_INDIRECT_REGISTER)
+            {
+                add_register(l, op->content.inreg.id);
+                add_register(l, op->content.inreg.roffset);
+            }
+        }
+    }
+}
+
+air_liveness_t* air_liveness_init(air_routine_t* routine, air_t* air)
+{
+    air_liveness_t* l = calloc(1, sizeof *l);
+    l->routine = routine;
+    l->cfg = air_routine_cfg(routine);
+    l->indices = imap_init();
+    l->registers = vector_init();
+    l->implicit_uses = imap_init();
+
+    find_registers(l);
+    if (air->locale == LOC_X86_64)
+        find_implicit_uses_x86_64(l);
+
+    l->words = BITSET_WORDS(l->registers->size);
+    size_t count = l->cfg->blocks->size;
+    l->in = calloc(count * l->words + 1, sizeof(unsigned long long));
+    l->out = calloc(count * l->words + 1, sizeof(unsigned long long));
+    air_cfg_solve_backward(l->cfg, l->words, l->in, l->out,
+        (void (*)(void*, air_insn_t*, unsigned long long*)) air_liveness_step, l);
+    return l;
+}
+
+void air_liveness_delete(air_liveness_t* l)
+{
+    if (!l) return;
+    imap_delete(l->indices);
+    vector_delete(l->registers);
+    IMAP_FOR(size_t, svector_t*, l->implicit_uses)
+    {
+        (void) k;
+        svector_free(v);
+        free(v);
+    }
+    imap_delete(l->implicit_uses);
+    free(l->in);
+    free(l->out);
+    free(l);
+}
+
+// the register's position in the liveness sets, 0 if the routine never names it
+size_t air_liveness_index(air_liveness_t* l, regid_t reg)
+{
+    return imap_get(l->indices, reg);
+}
+
+// NULL if the instruction only reads the registers it names
+svector_t* air_liveness_implicit_uses(air_liveness_t* l, air_insn_t* insn)
+{
+    return (svector_t*) imap_get(l->implicit_uses, insn->id);
+}
+
+bool air_liveness_set_has(air_liveness_t* l, unsigned long long* set, regid_t reg)
+{
+    size_t index = air_liveness_index(l, reg);
+    return index && BITSET_HAS(set, index);
+}
+
+bool air_liveness_live_in(air_liveness_t* l, air_block_t* block, regid_t reg)
+{
+    return air_liveness_set_has(l, l->in + block->id * l->words, reg);
+}
+
+bool air_liveness_live_out(air_liveness_t* l, air_block_t* block, regid_t reg)
+{
+    return air_liveness_set_has(l, l->out + block->id * l->words, reg);
+}
+
+// a copy of a block's live-out set, to step backwards over its instructions. free it when done
+unsigned long long* air_liveness_out_set(air_liveness_t* l, air_block_t* block)
+{
+    unsigned long long* set = malloc(l->words * sizeof(unsigned long long) + 1);
+    memcpy(set, l->out + block->id * l->words, l->words * sizeof(unsigned long long));
+    return set;
+}
+
+static void add_use(air_liveness_t* l, unsigned long long* live, regid_t reg)
+{
+    size_t index = air_liveness_index(l, reg);
+    if (index)
+        BITSET_ADD(live, index);
+}
+
+// steps a live set backwards over an instruction: what it defines stops being live, and what it reads starts
+void air_liveness_step(air_liveness_t* l, air_insn_t* insn, unsigned long long* live)
+{
+    regid_t def = air_liveness_definition(insn);
+    size_t index = air_liveness_index(l, def);
+    if (index)
+        BITSET_REMOVE(live, index);
+    for (size_t i = def != INVALID_VREGID ? 1 : 0; i < insn->noops; ++i)
+    {
+        air_insn_operand_t* op = insn->ops[i];
+        if (!op) continue;
+        if (op->type == AOP_REGISTER)
+            add_use(l, live, op->content.reg);
+        else if (op->type == AOP_INDIRECT_REGISTER)
+        {
+            add_use(l, live, op->content.inreg.id);
+            add_use(l, live, op->content.inreg.roffset);
+        }
+    }
+    svector_t* implicit = air_liveness_implicit_uses(l, insn);
+    if (implicit)
+    {
+        for (unsigned i = 0; i < implicit->size; ++i)
+            add_use(l, live, implicit->data[i]);
+    }
+}
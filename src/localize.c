@@ -3,7 +3,7 @@
 
 #include "ecc.h"
 
-#define NEXT_VIRTUAL_REGISTER (air->next_available_temporary++)
+#define NEXT_VIRTUAL_REGISTER (air_next_register(air))
 #define NEXT_LV (air->next_available_lv++)
 #define SYMBOL_TABLE (air->st)
 
@@ -103,6 +103,85 @@ static arg_class_t* find_classes(c_type_t* ct, size_t* count)
     return find_aggregate_union_classes(ct, count);
 }
 
+// merges the classes of a type at some offset into the classes of the aggregate/union holding it. members and
+// array elements are classified where they actually are, so one that straddles two eightbytes counts toward both
+static void classify_members(arg_class_t* classes, size_t count, c_type_t* ct, long long offset)
+{
+    if (ct->class == CTC_ARRAY)
+    {
+        long long es = type_size(ct->derived_from);
+        for (long long eoffset = 0; es > 0 && eoffset + es <= type_size(ct); eoffset += es)
+            classify_members(classes, count, ct->derived_from, offset + eoffset);
+        return;
+    }
+
+    if (ct->class == CTC_STRUCTURE || ct->class == CTC_UNION)
+    {
+        // offset (in bytes) of where we are within the struct, members of a union all start at the beginning
+        long long moffset = 0;
+        VECTOR_FOR(c_type_t*, mt, ct->struct_union.member_types)
+        {
+            // get their sizes and alignments
+            long long ms = type_size(mt);
+            long long ma = type_alignment(mt);
+
+            // jump to the member's alignment, if necessary
+            if (ct->class == CTC_STRUCTURE)
+                moffset += (ma - (moffset % ma)) % ma;
+
+            classify_members(classes, count, mt, offset + moffset);
+
+            // jump the offset to after the type
+            if (ct->class == CTC_STRUCTURE && ms > 0)
+                moffset += ms;
+        }
+        return;
+    }
+
+    // collect the classes of this member's type
+    size_t subclasses_count = 0;
+    arg_class_t* subclasses = find_classes(ct, &subclasses_count);
+
+    // go thru all 'em
+    for (size_t j = 0; j < subclasses_count; ++j)
+    {
+        // find the class within the whole struct/union type which
+        // our current subclass (the "new" class) would apply to
+        size_t class_idx = (offset >> 3) + j;
+        if (class_idx >= count)
+            break;
+        arg_class_t class = classes[class_idx];
+        arg_class_t subclass = subclasses[j];
+        // then we begin to compare the subclass with the current class
+        // we have for this eightbyte
+
+        // ignore if they're the same
+        if (class == subclass)
+            continue;
+        
+        // ignore if the new class type is NO_CLASS
+        if (subclass == ARG_NO_CLASS)
+            continue;
+        
+        // if we currently have NO_CLASS, take whatever the subclass is
+        // if the new class is MEMORY or INTEGER, take that class
+        if (class == ARG_NO_CLASS || subclass == ARG_MEMORY || subclass == ARG_INTEGER)
+            classes[class_idx] = subclass;
+        // if the anything is an X87 class, put it in memory
+        else if (class == ARG_X87 ||
+            class == ARG_X87UP ||
+            class == ARG_COMPLEX_X87 ||
+            subclass == ARG_X87 ||
+            subclass == ARG_X87UP || 
+            subclass == ARG_COMPLEX_X87)
+            classes[class_idx] = ARG_MEMORY;
+        else
+        // otherwise, make it SSE
+            classes[class_idx] = ARG_SSE;
+    }
+    free(subclasses);
+}
+
 static arg_class_t* find_aggregate_union_classes(c_type_t* ct, size_t* count)
 {
     // get rid of any bad cookies
@@ -135,63 +214,8 @@ static arg_class_t* find_aggregate_union_classes(c_type_t* ct, size_t* count)
     for (size_t i = 0; i < *count; ++i)
         classes[i] = ARG_NO_CLASS;
 
-    // offset (in bytes) of where we are within the struct/union
-    long long offset = 0;
-
-    // go thru all member types
-    VECTOR_FOR(c_type_t*, mt, ct->struct_union.member_types)
-    {
-        // get their sizes and alignments
-        long long ms = type_size(mt); 
-        long long ma = type_alignment(mt);
-
-        // jump to the member's alignment, if necessary
-        offset += (ma - (size % ma)) % ma;
-
-        // collect the classes of this member's type
-        size_t subclasses_count = 0;
-        arg_class_t* subclasses = find_classes(mt, &subclasses_count);
-
-        // go thru all 'em
-        for (size_t j = 0; j < subclasses_count; ++j)
-        {
-            // find the class within the whole struct/union type which
-            // our current subclass (the "new" class) would apply to
-            long long class_idx = (offset >> 3) + j;
-            arg_class_t class = classes[class_idx];
-            arg_class_t subclass = subclasses[j];
-            // then we begin to compare the subclass with the current class
-            // we have for this eightbyte
-
-            // ignore if they're the same
-            if (class == subclass)
-                continue;
-            
-            // ignore if the new class type is NO_CLASS
-            if (subclass == ARG_NO_CLASS)
-                continue;
-            
-            // if we currently have NO_CLASS, take whatever the subclass is
-            // if the new class is MEMORY or INTEGER, take that class
-            if (class == ARG_NO_CLASS || subclass == ARG_MEMORY || subclass == ARG_INTEGER)
-                classes[class_idx] = subclass;
-            // if the anything is an X87 class, put it in memory
-            else if (class == ARG_X87 ||
-                class == ARG_X87UP ||
-                class == ARG_COMPLEX_X87 ||
-                subclass == ARG_X87 ||
-                subclass == ARG_X87UP || 
-                subclass == ARG_COMPLEX_X87)
-                classes[class_idx] = ARG_MEMORY;
-            else
-            // otherwise, make it SSE
-                classes[class_idx] = ARG_SSE;
-        }
-        free(subclasses);
-
-        // jump the offset to after the type
-        offset += ms;
-    }
+    // merge in the classes of everything inside, wherever it is
+    classify_members(classes, *count, ct, 0);
 
     // "post-merger" from the ABI:
     // if any of the classes are MEMORY, everything becomes MEMORY
@@ -247,7 +271,7 @@ static regid_t try_extract_integer_constant(air_insn_t* insn, air_t* air, size_t
     regid_t reg = NEXT_VIRTUAL_REGISTER;
 
     air_insn_t* def = air_insn_init(AIR_LOAD, 2);
-    def->ct = type_copy(ct);
+    def->ct = air_type(ct);
     def->ops[0] = air_insn_register_operand_init(reg);
     def->ops[1] = air_insn_integer_constant_operand_init(value);
     air_insn_insert_before(def, insn);
@@ -259,201 +283,174 @@ static regid_t try_extract_integer_constant(air_insn_t* insn, air_t* air, size_t
 
 /*
 
-struct point* _1 = &p;
-
-push(*p);
-
-*/
-
-// loc is the location to insert the instructions ABOVE
-// tempdef is where the temporary was defined that holds the argument
-// ct is the type of the argument
-// eightbyte_idx is this eightbyte's index in the current sequence of eightbyte classifications
-// return is the first instruction inserted
-air_insn_t* store_eightbyte_on_stack(air_insn_t* loc, air_insn_t* tempdef, c_type_t* ct, size_t eightbyte_idx, air_t* air)
-{
-    // get the argument register, this is where we are going to be copying data from
-    regid_t argreg = tempdef->ops[0]->type == AOP_REGISTER ? tempdef->ops[0]->content.reg : tempdef->ops[0]->content.inreg.id;
+arguments are marshalled straight into where the callee looks for them. a scalar going in a register is loaded into
+it from the temporary holding it:
 
-    // if the type of the argument is struct/union
-    if (ct->class == CTC_STRUCTURE || ct->class == CTC_UNION)
-    {
-        // get its type
-        long long size = type_size(ct);
+    int _7 = _3 << 1;
+    int %esi = _7;
+    call(f);
 
-        // progress begins at the start of the eightbyte we're storing
-        size_t progress = eightbyte_idx << 3;
+and once the whole routine is localized, that temporary is computed into the register itself wherever nothing in
+between needs the register (see localize_x86_64_marshal_directly), which leaves no copy behind:
 
-        // if the amount of bytes remaining in the entire argument is greater than 8,
-        // then just push those eight bytes onto the stack
-        long long total_remaining = size - progress;
-        if (total_remaining >= UNSIGNED_LONG_LONG_INT_WIDTH)
-        {
-            air_insn_t* push = air_insn_init(AIR_PUSH, 1);
-            push->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
-            push->ops[0] = air_insn_indirect_register_operand_init(argreg, progress, INVALID_VREGID, 1);
-            air_insn_insert_before(push, loc);
-            return push;
-        }
+    int %esi = _3 << 1;
+    call(f);
 
-        // if the amount of bytes remaining in the entire argument is less than 8,
-        // then we gotta do this garbage
-        // (i.e., load a temporary with the remaining bytes)
+an aggregate going in registers is loaded an eightbyte at a time, straight out of the variable when its address was
+only just taken for the call:
 
-        air_insn_t* first = NULL;
+    unsigned long long %rdi = *(p + 0);
+    unsigned int %esi = *(p + 8);
 
-        // create a temporary with zero as its value
+arguments on the stack are stored into the routine's outgoing argument area, which sits at %rsp for every call it
+makes and is as big as the most any of them needs, instead of being pushed and popped around each call:
 
-        regid_t tmpreg = NEXT_VIRTUAL_REGISTER;
+    long int *(%rsp + 0) = _7;
+    unsigned long long _9 = *(_8 + 16);
+    unsigned long long *(%rsp + 8) = _9;
 
-        air_insn_t* init = air_insn_init(AIR_LOAD, 2);
-        init->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
-        init->ops[0] = air_insn_register_operand_init(tmpreg);
-        init->ops[1] = air_insn_integer_constant_operand_init(0);
-        air_insn_insert_before(init, loc);
+an argument only goes in registers if all of its eightbytes fit in the ones left, otherwise it goes on the stack
+whole and the registers go to the arguments after it.
 
-        first = init;
+*/
 
-        // continue to take the largest amount of bytes possible
-        // shift and or the temporary with the values loaded
-        for (long long copied = 0; copied < total_remaining;)
+// whether the instructions strictly between two in the same block leave a register alone. calls and system calls
+// clobber registers they don't name, so the search gives up on them like it does on the end of the block
+static bool register_untouched_between(air_insn_t* from, air_insn_t* to, regid_t reg)
+{
+    for (air_insn_t* insn = from->next; insn != to; insn = insn->next)
+    {
+        if (!insn) return false;
+        switch (insn->type)
         {
-            // remaining of the stuff we've already copied
-            long long remaining = total_remaining - copied;
+            case AIR_LABEL:
+            case AIR_JMP:
+            case AIR_JMP_TABLE:
+            case AIR_JZ:
+            case AIR_JNZ:
+            case AIR_RETURN:
+            case AIR_FUNC_CALL:
+            case AIR_LSYSCALL:
+                return false;
+            default:
+                break;
+        }
+        if (air_insn_uses(insn, reg))
+            return false;
+    }
+    return true;
+}
 
-            // create the type that can fit the largest number of bytes we still need to copy
-            c_type_t* cyt = make_basic_type(largest_type_class_for_eightbyte(remaining));
-            long long cytsize = type_size(cyt);
+// whether an argument passed through its address can be read straight out of the variable, which it can if the
+// address was taken right before the call
+static bool reads_variable(air_insn_t* tempdef, air_insn_t* call, regid_t argreg)
+{
+    if (tempdef->type != AIR_LOAD_ADDR)
+        return false;
+    air_insn_operand_t* op = tempdef->ops[1];
+    if (op->type != AOP_SYMBOL && op->type != AOP_INDIRECT_SYMBOL)
+        return false;
+    return register_untouched_between(tempdef, call, argreg);
+}
 
-            // if this isn't the first time adding to the temporary,
-            // we need to shift the bits over by the bit size of the type
-            // we just made
-            if (copied)
-            {
-                air_insn_t* shl = air_insn_init(AIR_DIRECT_SHIFT_LEFT, 2);
-                shl->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
-                shl->ops[0] = air_insn_register_operand_init(tmpreg);
-                shl->ops[1] = air_insn_integer_constant_operand_init(type_size(cyt) << 3);
-                air_insn_insert_before(shl, loc);
-            }
+// where part of an argument passed through its address is read from
+static air_insn_operand_t* argument_source(air_insn_t* tempdef, air_insn_t* call, regid_t argreg, long long offset)
+{
+    if (reads_variable(tempdef, call, argreg))
+    {
+        air_insn_operand_t* op = tempdef->ops[1];
+        if (op->type == AOP_SYMBOL)
+            return air_insn_indirect_symbol_operand_init(op->content.sy, offset);
+        return air_insn_indirect_symbol_operand_init(op->content.insy.sy, op->content.insy.offset + offset);
+    }
+    return air_insn_indirect_register_operand_init(argreg, offset, INVALID_VREGID, 1);
+}
 
-            // then or the bytes we're copying with the temporary
-            air_insn_t* or = air_insn_init(AIR_DIRECT_OR, 2);
-            or->ct = cyt;
-            or->ops[0] = air_insn_register_operand_init(tmpreg);
-            or->ops[1] = air_insn_indirect_register_operand_init(argreg, progress + (remaining - cytsize), INVALID_VREGID, 1);
-            air_insn_insert_before(or, loc);
+// loads an eightbyte of an argument in memory into a register. the last one may run past the end of the argument,
+// in which case the rest is read in the widest pieces that fit, from the top down, shifting each one up to make room
+// for the next
+static void load_eightbyte(air_insn_t* call, air_insn_t* tempdef, regid_t argreg, c_type_t* ct, size_t eightbyte_idx, regid_t dest, air_t* air)
+{
+    bool sse = x86_64_is_sse_register(dest);
+    long long progress = eightbyte_idx << 3;
+    long long total_remaining = min(type_size(ct) - progress, UNSIGNED_LONG_LONG_INT_WIDTH);
+    for (long long copied = 0; copied < total_remaining;)
+    {
+        long long remaining = total_remaining - copied;
+        c_type_class_t class = sse ? largest_sse_type_class_for_eightbyte(remaining) : largest_type_class_for_eightbyte(remaining);
+        c_type_t* pt = air_basic_type(class);
+        long long ptsize = type_size(pt);
 
-            // move copied forwad
-            copied += type_size(cyt);
+        if (copied)
+        {
+            air_insn_t* shl = air_insn_init(AIR_DIRECT_SHIFT_LEFT, 2);
+            shl->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+            shl->ops[0] = air_insn_register_operand_init(dest);
+            shl->ops[1] = air_insn_integer_constant_operand_init(ptsize << 3);
+            air_insn_insert_before(shl, call);
         }
 
-        // then push the temporary
-        air_insn_t* push = air_insn_init(AIR_PUSH, 1);
-        push->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
-        push->ops[0] = air_insn_register_operand_init(tmpreg);
-        air_insn_insert_before(push, loc);
+        // x86's narrower registers are the low bytes of the full one, so a load leaves the pieces above it alone
+        air_insn_t* ld = air_insn_init(AIR_LOAD, 2);
+        ld->ct = pt;
+        ld->ops[0] = air_insn_register_operand_init(dest);
+        ld->ops[1] = argument_source(tempdef, call, argreg, progress + remaining - ptsize);
+        air_insn_insert_before(ld, call);
 
-        return first;
+        copied += ptsize;
     }
-
-    // look how easy it is when we don't have to do dumb garbage!
-    // just a quick push onto the stack!
-    air_insn_t* push = air_insn_init(AIR_PUSH, 1);
-    push->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
-    push->ops[0] = air_insn_register_operand_init(argreg);
-    air_insn_insert_before(push, loc);
-    return push;
 }
 
-// loc is the location to insert the instructions ABOVE
-// tempdef is where the temporary was defined that holds the argument
-// ct is the type of the argument
-// eightbyte_idx is this eightbyte's index in the current sequence of eightbyte classifications
-// dest is the register that the eightbyte will get loaded into
-// return is the first instruction inserted
-air_insn_t* store_eightbyte_in_register(air_insn_t* loc, air_insn_t* tempdef, c_type_t* ct, size_t eightbyte_idx, regid_t dest, air_t* air)
+// copies an argument in memory into the outgoing argument area, in the widest pieces that fit, before pos
+static void store_in_outgoing_area(air_insn_t* pos, air_insn_t* call, air_insn_t* tempdef, regid_t argreg, c_type_t* ct, long long offset, air_t* air)
 {
-    // this is where we copying data from
-    regid_t argreg = tempdef->ops[0]->type == AOP_REGISTER ? tempdef->ops[0]->content.reg : tempdef->ops[0]->content.inreg.id;
-
-    // if it's a struct/union
-    if (ct->class == CTC_STRUCTURE || ct->class == CTC_UNION)
+    long long size = type_size(ct);
+    for (long long copied = 0; copied < size;)
     {
-        // get the type
-        long long size = type_size(ct);
-
-        // get the progress of loading the entire struct/union, across eightbytes
-        size_t progress = eightbyte_idx << 3;
+        c_type_t* pt = air_basic_type(largest_type_class_for_eightbyte(size - copied));
+        regid_t tmp = NEXT_VIRTUAL_REGISTER;
 
-        // then get the total remaining from that progress
-        long long total_remaining = size - progress;
+        air_insn_t* ld = air_insn_init(AIR_LOAD, 2);
+        ld->ct = pt;
+        ld->ops[0] = air_insn_register_operand_init(tmp);
+        ld->ops[1] = argument_source(tempdef, call, argreg, copied);
+        air_insn_insert_before(ld, pos);
+
+        air_insn_t* st = air_insn_init(AIR_ASSIGN, 2);
+        st->ct = pt;
+        st->ops[0] = air_insn_indirect_register_operand_init(X86R_RSP, offset + copied, INVALID_VREGID, 1);
+        st->ops[1] = air_insn_register_operand_init(tmp);
+        air_insn_insert_before(st, pos);
+
+        copied += type_size(pt);
+    }
+}
 
-        // if there's over an eightbyte left, let's just copy 8 bytes from the source argument
-        if (total_remaining >= UNSIGNED_LONG_LONG_INT_WIDTH)
+// whether every eightbyte of an argument fits in the registers left for it
+static bool fits_in_registers(arg_class_t* classes, size_t ccount, regid_t nextintreg, regid_t nextssereg)
+{
+    for (size_t i = 0; i < ccount; ++i)
+    {
+        if (classes[i] == ARG_INTEGER)
         {
-            air_insn_t* deref = air_insn_init(AIR_LOAD, 2);
-            deref->ct = make_basic_type(x86_64_is_sse_register(dest) ? CTC_DOUBLE : CTC_UNSIGNED_LONG_LONG_INT);
-            deref->ops[0] = air_insn_register_operand_init(dest);
-            deref->ops[1] = air_insn_indirect_register_operand_init(argreg, progress, INVALID_VREGID, 1);
-            air_insn_insert_before(deref, loc);
-            return deref;
+            if (nextintreg++ > X86R_R9)
+                return false;
         }
-
-        // otherwise, we gotta do the same garbage we did above,
-        // copy the largest amount of bytes we can repeatedly until
-        // we've copied the entire rest of the struct/union
-
-        air_insn_t* first = NULL;
-        for (long long copied = 0; copied < total_remaining;)
+        else if (classes[i] == ARG_SSE)
         {
-            long long remaining = total_remaining - copied;
-
-            // find the type that can fit the largest number of bytes
-            // for the amount remaining
-            c_type_t* cyt = make_basic_type(x86_64_is_sse_register(dest) ?
-                largest_sse_type_class_for_eightbyte(remaining) : largest_type_class_for_eightbyte(remaining));
-            long long cytsize = type_size(cyt);
-
-            // shift if we need to make space for the new data we copying
-            if (copied)
-            {
-                air_insn_t* shl = air_insn_init(AIR_DIRECT_SHIFT_LEFT, 2);
-                shl->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
-                shl->ops[0] = air_insn_register_operand_init(dest);
-                shl->ops[1] = air_insn_integer_constant_operand_init(type_size(cyt) << 3);
-                air_insn_insert_before(shl, loc);
-            }
-
-            // skraight load those bytes into the register
-            // we can do it with a load this time instead of an OR
-            // because of how x86's <64-bit registers are just alias for the lower bytes of the 64-bit version
-            air_insn_t* assign = air_insn_init(AIR_LOAD, 2);
-            assign->ct = cyt;
-            assign->ops[0] = air_insn_register_operand_init(dest);
-            assign->ops[1] = air_insn_indirect_register_operand_init(argreg, progress + (remaining - cytsize), INVALID_VREGID, 1);
-            air_insn_insert_before(assign, loc);
-
-            if (!first) first = assign;
-
-            // move it forwad
-            copied += type_size(cyt);
+            if (nextssereg++ > X86R_XMM7)
+                return false;
         }
-
-        return first;
+        else if (classes[i] != ARG_SSEUP)
+            return false;
     }
-
-    // if there's no garbage, we just do a skraight load
-    air_insn_t* assign = air_insn_init(AIR_LOAD, 2);
-    assign->ct = type_copy(ct);
-    assign->ops[0] = air_insn_register_operand_init(dest);
-    assign->ops[1] = air_insn_register_operand_init(argreg);
-    air_insn_insert_before(assign, loc);
-    return assign;
+    return true;
 }
 
-// guyyyyy this sucks (it really doesn't)
-void localize_x86_64_func_call_args(air_insn_t* insn, air_routine_t* routine, air_t* air)
+// loads the registers and fills in the outgoing argument area for a call. the loads of scalars into registers are
+// added to marshalled, along with the addresses taken only for aggregates read straight from their variables, for
+// localize_x86_64_marshal_directly to clean up after
+void localize_x86_64_func_call_args(air_insn_t* insn, air_routine_t* routine, air_t* air, vector_t* marshalled)
 {
     // ignore if there's no arguments
     if (insn->noops <= 2) return;
@@ -468,7 +465,17 @@ void localize_x86_64_func_call_args(air_insn_t* insn, air_routine_t* routine, ai
     // initialize the next SSE register in the sequence
     regid_t nextssereg = X86R_XMM0;
 
-    air_insn_t* inserting = insn;
+    // how far into the outgoing argument area the arguments on the stack reach so far
+    long long outgoing = 0;
+
+    size_t first_marshalled = marshalled->size;
+
+    // the stores into the outgoing argument area go before the first load into a register, so that none of the
+    // argument registers are taken yet while they're made
+    air_insn_t* stores = insn;
+
+    // the loads of scalars into SSE registers, kept aside until it's known how many of the eight the call takes
+    vector_t* sse_loads = vector_init();
 
     // loop thru every argument to the function call
     for (size_t i = 2; i < insn->noops; ++i)
@@ -476,53 +483,103 @@ void localize_x86_64_func_call_args(air_insn_t* insn, air_routine_t* routine, ai
         air_insn_operand_t* op = insn->ops[i];
         // report any funky operands (not a register)
         if (op->type != AOP_REGISTER && op->type != AOP_INDIRECT_REGISTER) report_return;
+        regid_t argreg = op->type == AOP_REGISTER ? op->content.reg : op->content.inreg.id;
 
         // find the definition for the temporary used here as an argument
-        air_insn_t* tempdef = air_insn_find_temporary_definition_above(op->type == AOP_REGISTER ? op->content.reg : op->content.inreg.id, insn);
+        air_insn_t* tempdef = air_insn_find_temporary_definition_above(argreg, insn);
         if (!tempdef) report_return;
 
         // so that we can get its type
         c_type_t* at = tempdef->ct;
         if (op->type == AOP_INDIRECT_REGISTER)
             at = at->derived_from;
-        
+        bool in_memory = op->type == AOP_INDIRECT_REGISTER || at->class == CTC_STRUCTURE || at->class == CTC_UNION;
+
         // get the ABI classes for this argument
         size_t ccount = 0;
         arg_class_t* classes = find_classes(at, &ccount);
         if (!classes) report_return;
 
-        // for each eightbyte/class, store it in a location
-        for (size_t i = 0; i < ccount; ++i)
+        if (!fits_in_registers(classes, ccount, nextintreg, nextssereg))
         {
-            arg_class_t class = classes[i];
-            // if it's X87, MEMORY, or there aren't any more integer or SSE registers, store it on the stack
-            if (class == ARG_MEMORY ||
-                class == ARG_X87 ||
-                class == ARG_X87UP ||
-                class == ARG_COMPLEX_X87 ||
-                (class == ARG_INTEGER && nextintreg > X86R_R9) ||
-                (class == ARG_SSE && nextssereg > X86R_XMM7))
-                inserting = store_eightbyte_on_stack(inserting, tempdef, at, i, air);
-            // if it has the INTEGER class, store it in an integer register
-            else if (class == ARG_INTEGER)
-                inserting = store_eightbyte_in_register(inserting, tempdef, at, i, nextintreg++, air);
-            // if it has the SSE class, store it in an SSE register
-            else if (class == ARG_SSE)
-                inserting = store_eightbyte_in_register(inserting, tempdef, at, i, nextssereg++, air);
-            // if it has the SSEUP class, store it in the previously used SSE register
-            else if (class == ARG_SSEUP)
-                inserting = store_eightbyte_in_register(inserting, tempdef, at, i, nextssereg - 1, air);
+            // arguments on the stack take at least an eightbyte each, aligned to at least that
+            long long alignment = max(type_alignment(at), UNSIGNED_LONG_LONG_INT_WIDTH);
+            outgoing += (alignment - (outgoing % alignment)) % alignment;
+            if (in_memory)
+                store_in_outgoing_area(stores, insn, tempdef, argreg, at, outgoing, air);
+            else
+            {
+                air_insn_t* st = air_insn_init(AIR_ASSIGN, 2);
+                st->ct = air_type(at);
+                st->ops[0] = air_insn_indirect_register_operand_init(X86R_RSP, outgoing, INVALID_VREGID, 1);
+                st->ops[1] = air_insn_register_operand_init(argreg);
+                air_insn_insert_before(st, stores);
+            }
+            long long size = type_size(at);
+            outgoing += size + (UNSIGNED_LONG_LONG_INT_WIDTH - (size % UNSIGNED_LONG_LONG_INT_WIDTH)) % UNSIGNED_LONG_LONG_INT_WIDTH;
+        }
+        else if (in_memory)
+        {
+            air_insn_t* before = insn->prev;
+            for (size_t j = 0; j < ccount; ++j)
+            {
+                regid_t dest = INVALID_VREGID;
+                if (classes[j] == ARG_INTEGER)
+                    dest = nextintreg++;
+                else if (classes[j] == ARG_SSE)
+                    dest = nextssereg++;
+                // SSEUP continues in the last SSE register
+                else if (classes[j] == ARG_SSEUP)
+                    dest = nextssereg - 1;
+                load_eightbyte(insn, tempdef, argreg, at, j, dest, air);
+            }
+            if (stores == insn)
+                stores = before->next;
+        }
+        else
+        {
+            air_insn_t* ld = air_insn_init(AIR_LOAD, 2);
+            ld->ct = air_type(at);
+            ld->ops[0] = air_insn_register_operand_init(classes[0] == ARG_SSE ? nextssereg++ : nextintreg++);
+            ld->ops[1] = air_insn_register_operand_init(argreg);
+            air_insn_insert_before(ld, insn);
+            if (stores == insn)
+                stores = ld;
+            vector_add(classes[0] == ARG_SSE ? sse_loads : marshalled, ld);
+        }
+
+        // the address might have been taken only to pass this
+        if (in_memory && reads_variable(tempdef, insn, argreg))
+        {
+            bool recorded = false;
+            for (size_t j = first_marshalled; j < marshalled->size && !recorded; ++j)
+                recorded = vector_get(marshalled, j) == tempdef;
+            if (!recorded)
+                vector_add(marshalled, tempdef);
         }
 
         free(classes);
     }
 
+    // the allocator only has the eight SSE registers the arguments go in, so computing into them is left to calls
+    // that leave it a couple of them to compute with
+    if (nextssereg - X86R_XMM0 <= 6)
+        vector_concat(marshalled, sse_loads);
+    vector_delete(sse_loads);
+
+    outgoing += (16 - (outgoing % 16)) % 16;
+    if (outgoing > routine->outgoing)
+        routine->outgoing = outgoing;
+
     // if we got a struct returned thru rdi
     if (rdi_ret)
     {
         // create and declare a local variable of the struct type
+        pool_lock();
         symbol_t* sy = symbol_table_add(SYMBOL_TABLE, "__anonymous_lv__", symbol_init(NULL));
+        pool_unlock();
         sy->type = type_copy(insn->ct->derived_from);
+        sy->sd = SD_AUTOMATIC;
 
         air_insn_t* decl = air_insn_init(AIR_DECLARE, 1);
         decl->ops[0] = air_insn_symbol_operand_init(sy);
@@ -530,21 +587,21 @@ void localize_x86_64_func_call_args(air_insn_t* insn, air_routine_t* routine, ai
 
         // and then give the address of that local variable to %rdi
         air_insn_t* loadaddr = air_insn_init(AIR_LOAD_ADDR, 2);
-        loadaddr->ct = type_copy(insn->ct);
+        loadaddr->ct = air_type(insn->ct);
         loadaddr->ops[0] = air_insn_register_operand_init(X86R_RDI);
         loadaddr->ops[1] = air_insn_symbol_operand_init(sy);
         air_insn_insert_before(loadaddr, insn);
     }
 
-    // TODO: check to see if the function has no prototype or varargs
-    // if (nextssereg - X86R_XMM0 > 0)
-    // {
-    //     air_insn_t* assign = air_insn_init(AIR_ASSIGN, 2);
-    //     assign->ct = make_basic_type(CTC_UNSIGNED_CHAR);
-    //     assign->ops[0] = air_insn_register_operand_init(X86R_RAX);
-    //     assign->ops[1] = air_insn_integer_constant_operand_init(nextssereg - X86R_XMM0);
-    //     air_insn_insert_before(assign, insn);
-    // }
+    // %al holds an upper bound on the vector registers used for variadic calls
+    if (insn->metadata.fcall_counts_vectors && nextssereg - X86R_XMM0 > 0)
+    {
+        air_insn_t* assign = air_insn_init(AIR_ASSIGN, 2);
+        assign->ct = air_basic_type(CTC_UNSIGNED_CHAR);
+        assign->ops[0] = air_insn_register_operand_init(X86R_RAX);
+        assign->ops[1] = air_insn_integer_constant_operand_init(nextssereg - X86R_XMM0);
+        air_insn_insert_before(assign, insn);
+    }
 
     // delete all the old temporary usages in the original call instruction
     for (size_t i = 2; i < insn->noops; ++i)
@@ -554,6 +611,48 @@ void localize_x86_64_func_call_args(air_insn_t* insn, air_routine_t* routine, ai
     }
 }
 
+// computes the scalars localize_x86_64_func_call_args loaded into registers straight into them where it can, and
+// drops the addresses nothing reads anymore. see above
+static void localize_x86_64_marshal_directly(air_routine_t* routine, vector_t* marshalled)
+{
+    if (!marshalled->size)
+        return;
+    air_defuse_t* du = air_defuse_init(routine);
+    VECTOR_FOR(air_insn_t*, minsn, marshalled)
+    {
+        if (minsn->type == AIR_LOAD_ADDR)
+        {
+            if (!air_defuse_uses(du, minsn->ops[0]->content.reg))
+                air_insn_remove(minsn);
+            continue;
+        }
+        regid_t reg = minsn->ops[0]->content.reg;
+        regid_t tmp = minsn->ops[1]->content.reg;
+        if (tmp <= NO_PHYSICAL_REGISTERS)
+            continue;
+        vector_t* defs = air_defuse_definitions(du, tmp);
+        vector_t* uses = air_defuse_uses(du, tmp);
+        if (!defs || defs->size != 1 || !uses || uses->size != 1)
+            continue;
+        air_insn_t* def = vector_get(defs, 0);
+        if (type_size(def->ct) != type_size(minsn->ct) || type_is_sse_floating(def->ct) != type_is_sse_floating(minsn->ct))
+            continue;
+        // nor can the definition itself read the register, which x86 may write before it's done reading operands
+        bool reads = false;
+        for (size_t i = 1; i < def->noops && !reads; ++i)
+        {
+            air_insn_operand_t* op = def->ops[i];
+            reads = op && ((op->type == AOP_REGISTER && op->content.reg == reg) ||
+                (op->type == AOP_INDIRECT_REGISTER && (op->content.inreg.id == reg || op->content.inreg.roffset == reg)));
+        }
+        if (reads || !register_untouched_between(def, minsn, reg))
+            continue;
+        def->ops[0]->content.reg = reg;
+        air_insn_remove(minsn);
+    }
+    air_defuse_delete(du);
+}
+
 /*
 
 type _1 = _2(_3, _4, _5, ...)
@@ -571,7 +670,7 @@ INTEGER:
 
     (if returning a struct)
     call(_2);
-    unsigned long long int %rax, %rdi, %rsi, %rdx, %rcx, %r8, %r9, %r10, %r11, %rsp;
+    unsigned long long int %rax, %rdi, %rsi, %rdx, %rcx, %r8, %r9, %r10, %r11;
     double %xmm0, %xmm1, %xmm2, %xmm3, %xmm4, %xmm5, %xmm6, %xmm7;
     deref type __lv0;
     type _1 = &__lv0;
@@ -590,8 +689,7 @@ static air_insn_t* blip_volatiles_after(air_insn_t* insn)
         X86R_R8,
         X86R_R9,
         X86R_R10,
-        X86R_R11,
-        X86R_RSP
+        X86R_R11
     };
 
     static const regid_t volatile_sse_registers[] = {
@@ -611,7 +709,7 @@ static air_insn_t* blip_volatiles_after(air_insn_t* insn)
     {
         regid_t reg = volatile_integer_registers[i];
         air_insn_t* decl = air_insn_init(AIR_BLIP, 1);
-        decl->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+        decl->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
         decl->ops[0] = air_insn_register_operand_init(reg);
         pos = air_insn_insert_after(decl, pos);
     }
@@ -620,7 +718,7 @@ static air_insn_t* blip_volatiles_after(air_insn_t* insn)
     {
         regid_t reg = volatile_sse_registers[i];
         air_insn_t* decl = air_insn_init(AIR_BLIP, 1);
-        decl->ct = make_basic_type(CTC_DOUBLE);
+        decl->ct = air_basic_type(CTC_DOUBLE);
         decl->ops[0] = air_insn_register_operand_init(reg);
         pos = air_insn_insert_after(decl, pos);
     }
@@ -649,13 +747,17 @@ void localize_x86_64_func_call_return(air_insn_t* insn, air_routine_t* routine,
     if (insn->metadata.fcall_sret)
         ct = ct->derived_from;
 
+    air_insn_t* pos = blip_volatiles_after(insn);
+
+    // nothing comes back from a void function, but it still clobbers everything volatile
+    if (ct->class == CTC_VOID)
+        return;
+
     // get the ABI classes of the return type
     size_t ccount = 0;
     arg_class_t* classes = find_classes(ct, &ccount);
     if (!classes) report_return;
 
-    air_insn_t* pos = blip_volatiles_after(insn);
-
     // if there is a single class and it's INTEGER,
     // then the return value is in %rax, so pull it into the result register
 
@@ -667,7 +769,7 @@ void localize_x86_64_func_call_return(air_insn_t* insn, air_routine_t* routine,
     {
         // load the actual value
         air_insn_t* load = air_insn_init(AIR_LOAD, 2);
-        load->ct = type_copy(insn->ct);
+        load->ct = air_type(insn->ct);
         load->ops[0] = air_insn_register_operand_init(resreg);
         load->ops[1] = air_insn_register_operand_init(X86R_RAX);
         pos = air_insn_insert_after(load, pos);
@@ -681,7 +783,7 @@ void localize_x86_64_func_call_return(air_insn_t* insn, air_routine_t* routine,
     {
         // load the actual value
         air_insn_t* load = air_insn_init(AIR_LOAD, 2);
-        load->ct = type_copy(insn->ct);
+        load->ct = air_type(insn->ct);
         load->ops[0] = air_insn_register_operand_init(resreg);
         load->ops[1] = air_insn_register_operand_init(X86R_XMM0);
         pos = air_insn_insert_after(load, pos);
@@ -701,8 +803,11 @@ void localize_x86_64_func_call_return(air_insn_t* insn, air_routine_t* routine,
         report_return;
 
     // create and declare a local variable to load the struct data into
+    pool_lock();
     symbol_t* lv = symbol_table_add(SYMBOL_TABLE, "__anonymous_lv__", symbol_init(NULL));
+    pool_unlock();
     lv->type = type_copy(ct);
+    lv->sd = SD_AUTOMATIC;
 
     air_insn_t* decl = air_insn_init(AIR_DECLARE, 1);
     decl->ops[0] = air_insn_symbol_operand_init(lv);
@@ -711,7 +816,7 @@ void localize_x86_64_func_call_return(air_insn_t* insn, air_routine_t* routine,
 
     // load the address of the local variable we just created
     air_insn_t* loadaddr = air_insn_init(AIR_LOAD_ADDR, 2);
-    loadaddr->ct = make_reference_type(ct);
+    loadaddr->ct = air_reference_type(ct);
     loadaddr->ops[0] = air_insn_register_operand_init(resreg);
     loadaddr->ops[1] = air_insn_symbol_operand_init(lv);
     pos = air_insn_insert_after(loadaddr, pos);
@@ -736,7 +841,7 @@ void localize_x86_64_func_call_return(air_insn_t* insn, air_routine_t* routine,
 
                 // keep on loading!
                 air_insn_t* assign = air_insn_init(AIR_ASSIGN, 2);
-                assign->ct = make_basic_type(class == ARG_INTEGER ? largest_type_class_for_eightbyte(remaining) :
+                assign->ct = air_basic_type(class == ARG_INTEGER ? largest_type_class_for_eightbyte(remaining) :
                     largest_sse_type_class_for_eightbyte(remaining));
                 long long csize = type_size(assign->ct);
                 assign->ops[0] = air_insn_indirect_register_operand_init(resreg, (i * 8) + copied, INVALID_VREGID, 1);
@@ -749,7 +854,7 @@ void localize_x86_64_func_call_return(air_insn_t* insn, air_routine_t* routine,
                     continue;
 
                 air_insn_t* shr = air_insn_init(AIR_DIRECT_SHIFT_RIGHT, 2);
-                shr->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+                shr->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
                 shr->ops[0] = air_insn_register_operand_init(reg);
                 shr->ops[1] = air_insn_integer_constant_operand_init(csize << 3);
                 pos = air_insn_insert_after(shr, pos);
@@ -766,11 +871,145 @@ void localize_x86_64_func_call_return(air_insn_t* insn, air_routine_t* routine,
     }
 }
 
+/*
+
+int _1 = f(_2, _3);
+<sequence point>
+return _1;
+
+becomes a tail call when nothing is left to do after f but return what it returned:
+
+int %edi = _2;
+int %esi = _3;
+tail call(f);
+blip %rax, ...;
+return;
+
+the frame is torn down before the jump, so f's arguments all have to go in registers, and nothing in the routine
+can have the address of one of its locals. f leaves its result where the routine's caller looks for it, so the
+two return types have to agree on that.
+
+*/
+
+// the instruction a call's result would flow into, skipping sequence points
+static air_insn_t* next_effective_insn(air_insn_t* insn)
+{
+    for (insn = insn->next; insn && insn->type == AIR_SEQUENCE_POINT; insn = insn->next);
+    return insn;
+}
+
+static bool returns_compatible(air_insn_t* insn, air_routine_t* routine)
+{
+    c_type_t* rettype = routine->sy->type->derived_from;
+    if (rettype->class == CTC_VOID)
+        return true;
+    c_type_t* ct = insn->ct;
+    if (insn->metadata.fcall_sret || type_size(ct) != type_size(rettype))
+        return false;
+    if (type_is_integer(ct) || ct->class == CTC_POINTER)
+        return type_is_integer(rettype) || rettype->class == CTC_POINTER;
+    return type_is_sse_floating(ct) && ct->class == rettype->class;
+}
+
+static bool args_fit_in_registers(air_insn_t* insn)
+{
+    size_t intregs = 0, sseregs = 0;
+    for (size_t i = 2; i < insn->noops; ++i)
+    {
+        air_insn_operand_t* op = insn->ops[i];
+        if (op->type != AOP_REGISTER && op->type != AOP_INDIRECT_REGISTER) return false;
+        air_insn_t* tempdef = air_insn_find_temporary_definition_above(op->type == AOP_REGISTER ? op->content.reg : op->content.inreg.id, insn);
+        if (!tempdef) return false;
+        c_type_t* at = op->type == AOP_INDIRECT_REGISTER ? tempdef->ct->derived_from : tempdef->ct;
+        size_t ccount = 0;
+        arg_class_t* classes = find_classes(at, &ccount);
+        if (!classes) return false;
+        bool fits = true;
+        for (size_t j = 0; j < ccount && fits; ++j)
+        {
+            if (classes[j] == ARG_INTEGER)
+                fits = ++intregs <= X86R_R9 - X86R_RDI + 1;
+            else if (classes[j] == ARG_SSE)
+                fits = ++sseregs <= X86R_XMM7 - X86R_XMM0 + 1;
+            else
+                fits = classes[j] == ARG_SSEUP;
+        }
+        free(classes);
+        if (!fits) return false;
+    }
+    return true;
+}
+
+// whether the address of a local could be handed to the callee, which would be left pointing into a dead frame
+static bool takes_local_addresses(air_routine_t* routine)
+{
+    for (air_insn_t* insn = routine->insns; insn; insn = insn->next)
+    {
+        if (insn->type != AIR_LOAD_ADDR || insn->ops[1]->type != AOP_SYMBOL)
+            continue;
+        if (symbol_get_storage_duration(insn->ops[1]->content.sy) != SD_STATIC)
+            return true;
+    }
+    return false;
+}
+
+static bool is_tail_call(air_insn_t* insn, air_routine_t* routine)
+{
+    if (routine->uses_varargs || insn->ops[0]->type != AOP_REGISTER)
+        return false;
+    air_insn_t* next = next_effective_insn(insn);
+    if (next && next->type != AIR_RETURN)
+        return false;
+    // falling off the end is only a return for a void routine
+    if (!next && routine->sy->type->derived_from->class != CTC_VOID)
+        return false;
+    if (next && next->noops && (next->ops[0]->type != AOP_REGISTER || next->ops[0]->content.reg != insn->ops[0]->content.reg))
+        return false;
+    return returns_compatible(insn, routine) && args_fit_in_registers(insn) && !takes_local_addresses(routine);
+}
+
+// the epilogue restores the nonvolatiles, so an indirect target has to be somewhere it doesn't touch
+static void localize_x86_64_tail_call_target(air_insn_t* insn)
+{
+    if (insn->ops[1]->type != AOP_REGISTER)
+        return;
+    air_insn_t* ld = air_insn_init(AIR_LOAD, 2);
+    ld->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+    ld->ops[0] = air_insn_register_operand_init(X86R_R11);
+    ld->ops[1] = insn->ops[1];
+    air_insn_insert_before(ld, insn);
+    insn->ops[1] = air_insn_register_operand_init(X86R_R11);
+}
+
+static void localize_x86_64_tail_call(air_insn_t* insn, air_routine_t* routine, air_t* air, vector_t* marshalled)
+{
+    insn->metadata.fcall_tail = true;
+
+    // the result goes straight back to the routine's caller
+    air_insn_t* ret = next_effective_insn(insn);
+    if (ret && ret->noops)
+    {
+        air_insn_operand_delete(ret->ops[0]);
+        ret->noops = 0;
+    }
+    air_insn_operand_delete(insn->ops[0]);
+    insn->ops[0] = air_insn_register_operand_init(INVALID_VREGID);
+    blip_volatiles_after(insn);
+
+    localize_x86_64_func_call_args(insn, routine, air, marshalled);
+    localize_x86_64_tail_call_target(insn);
+}
+
 // inserts necessary System V ABI loads and stores around the call site
-void localize_x86_64_func_call(air_insn_t* insn, air_routine_t* routine, air_t* air)
+void localize_x86_64_func_call(air_insn_t* insn, air_routine_t* routine, air_t* air, vector_t* marshalled)
 {
+    if (is_tail_call(insn, routine))
+    {
+        localize_x86_64_tail_call(insn, routine, air, marshalled);
+        return;
+    }
     localize_x86_64_func_call_return(insn, routine, air);
-    localize_x86_64_func_call_args(insn, routine, air);
+    localize_x86_64_func_call_args(insn, routine, air, marshalled);
 }
 
 /*
@@ -826,7 +1065,27 @@ int %edx = 0;
 %eax = %edx:%eax / _2;
 int _3 = %eax;
 
+for signed division, %edx is only blipped instead of zeroed, since it gets %eax's sign extended into it right before
+the idiv.
+
 */
+
+static air_insn_t* localize_x86_64_extend_dividend(air_insn_t* insn)
+{
+    if (type_is_signed_integer(insn->ct))
+    {
+        air_insn_t* blip = air_insn_init(AIR_BLIP, 1);
+        blip->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+        blip->ops[0] = air_insn_register_operand_init(X86R_RDX);
+        return blip;
+    }
+    air_insn_t* zero_rdx = air_insn_init(AIR_LOAD, 2);
+    zero_rdx->ct = air_type(insn->ct);
+    zero_rdx->ops[0] = air_insn_register_operand_init(X86R_RDX);
+    zero_rdx->ops[1] = air_insn_integer_constant_operand_init(0);
+    return zero_rdx;
+}
+
 void localize_x86_64_divide_modulo(air_insn_t* insn, air_routine_t* routine, air_t* air)
 {
     try_extract_integer_constant(insn, air, 2, insn->ct);
@@ -839,20 +1098,16 @@ void localize_x86_64_divide_modulo(air_insn_t* insn, air_routine_t* routine, air
     if (insn->ops[0]->type != AOP_REGISTER) report_return;
     if (insn->ops[1]->type != AOP_REGISTER) report_return;
     air_insn_t* assign_top = air_insn_init(AIR_LOAD, 2);
-    assign_top->ct = type_copy(insn->ct);
+    assign_top->ct = air_type(insn->ct);
     assign_top->ops[0] = air_insn_register_operand_init(X86R_RAX);
     assign_top->ops[1] = air_insn_register_operand_init(insn->ops[1]->content.reg);
     air_insn_insert_before(assign_top, insn);
-    air_insn_t* zero_rdx = air_insn_init(AIR_LOAD, 2);
-    zero_rdx->ct = type_copy(insn->ct);
-    zero_rdx->ops[0] = air_insn_register_operand_init(X86R_RDX);
-    zero_rdx->ops[1] = air_insn_integer_constant_operand_init(0);
-    air_insn_insert_before(zero_rdx, insn);
+    air_insn_insert_before(localize_x86_64_extend_dividend(insn), insn);
     regid_t resultreg = insn->ops[0]->content.reg;
     insn->ops[0]->content.reg = hresultreg;
     insn->ops[1]->content.reg = INVALID_VREGID;
     air_insn_t* load_result = air_insn_init(AIR_LOAD, 2);
-    load_result->ct = type_copy(insn->ct);
+    load_result->ct = air_type(insn->ct);
     load_result->ops[0] = air_insn_register_operand_init(resultreg);
     load_result->ops[1] = air_insn_register_operand_init(hresultreg);
     air_insn_insert_after(load_result, insn);
@@ -861,13 +1116,48 @@ void localize_x86_64_divide_modulo(air_insn_t* insn, air_routine_t* routine, air
 
 /*
 
+sse *_1 += _2;
+
+becomes:
+
+sse _3 = *_1;
+sse _3 += _2;
+sse *_1 = _3;
+
+SSE arithmetic and two-operand imul can only write to a register, so a first operand in memory is worked on in one.
+
+*/
+void localize_x86_64_direct_to_register(air_insn_t* insn, air_routine_t* routine, air_t* air)
+{
+    if (insn->ops[0]->type == AOP_REGISTER)
+        return;
+
+    regid_t reg = NEXT_VIRTUAL_REGISTER;
+
+    air_insn_t* ld = air_insn_init(AIR_LOAD, 2);
+    ld->ct = air_type(insn->ct);
+    ld->ops[0] = air_insn_register_operand_init(reg);
+    ld->ops[1] = air_insn_operand_copy(insn->ops[0]);
+    air_insn_insert_before(ld, insn);
+
+    air_insn_t* assign = air_insn_init(AIR_ASSIGN, 2);
+    assign->ct = air_type(insn->ct);
+    assign->ops[0] = insn->ops[0];
+    assign->ops[1] = air_insn_register_operand_init(reg);
+    air_insn_insert_after(assign, insn);
+
+    insn->ops[0] = air_insn_register_operand_init(reg);
+}
+
+/*
+
 _1 %= _2;
 
 becomes:
 
 %eax = _1;
 %edx = 0;
-%edx:%eax /= _2;
+%edx = %edx:%eax / _2;
 _1 = %edx;
 
 _1 /= _2;
@@ -876,39 +1166,38 @@ becomes:
 
 %eax = _1;
 %edx = 0;
-%edx:%eax /= _2;
+%eax = %edx:%eax / _2;
 _1 = %eax;
 
+_1 can be a register or memory.
+
 */
 void localize_x86_64_direct_divide_modulo(air_insn_t* insn, air_routine_t* routine, air_t* air)
 {
     try_extract_integer_constant(insn, air, 1, insn->ct);
-    try_extract_integer_constant(insn, air, 0, insn->ct);
 
     // further localization only applies to integer division
     if (insn->type == AIR_DIRECT_DIVIDE && !type_is_integer(insn->ct))
+    {
+        localize_x86_64_direct_to_register(insn, routine, air);
         return;
+    }
     regid_t hresultreg = insn->type == AIR_DIRECT_DIVIDE ? X86R_RAX : X86R_RDX;
-    if (insn->ops[0]->type != AOP_REGISTER) report_return;
     if (insn->ops[1]->type != AOP_REGISTER) report_return;
     air_insn_t* assign_top = air_insn_init(AIR_LOAD, 2);
-    assign_top->ct = type_copy(insn->ct);
+    assign_top->ct = air_type(insn->ct);
     assign_top->ops[0] = air_insn_register_operand_init(X86R_RAX);
-    assign_top->ops[1] = air_insn_register_operand_init(insn->ops[0]->content.reg);
+    assign_top->ops[1] = air_insn_operand_copy(insn->ops[0]);
     air_insn_insert_before(assign_top, insn);
-    air_insn_t* zero_rdx = air_insn_init(AIR_LOAD, 2);
-    zero_rdx->ct = type_copy(insn->ct);
-    zero_rdx->ops[0] = air_insn_register_operand_init(X86R_RDX);
-    zero_rdx->ops[1] = air_insn_integer_constant_operand_init(0);
-    air_insn_insert_before(zero_rdx, insn);
-    regid_t resultreg = insn->ops[1]->content.reg;
-    insn->ops[0]->content.reg = INVALID_VREGID;
-    air_insn_t* load_result = air_insn_init(AIR_LOAD, 2);
-    load_result->ct = type_copy(insn->ct);
-    load_result->ops[0] = air_insn_register_operand_init(resultreg);
-    load_result->ops[1] = air_insn_register_operand_init(hresultreg);
-    air_insn_insert_after(load_result, insn);
-    insn->type = AIR_DIRECT_DIVIDE;
+    air_insn_insert_before(localize_x86_64_extend_dividend(insn), insn);
+    air_insn_t* div = air_insn_init(AIR_DIVIDE, 3);
+    div->ct = air_type(insn->ct);
+    div->ops[0] = air_insn_register_operand_init(hresultreg);
+    div->ops[1] = air_insn_register_operand_init(INVALID_VREGID);
+    div->ops[2] = insn->ops[1];
+    air_insn_insert_before(div, insn);
+    insn->ops[1] = air_insn_register_operand_init(hresultreg);
+    insn->type = AIR_ASSIGN;
 }
 
 /*
@@ -939,7 +1228,7 @@ void localize_x86_64_multiply(air_insn_t* insn, air_routine_t* routine, air_t* a
     insn->ops[1] = air_insn_register_operand_init(X86R_RAX);
 
     air_insn_t* blip = air_insn_init(AIR_BLIP, 1);
-    blip->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+    blip->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
     blip->ops[0] = air_insn_register_operand_init(X86R_RDX);
     air_insn_insert_after(blip, insn);
 }
@@ -959,7 +1248,10 @@ blip %rdx;
 void localize_x86_64_direct_multiply(air_insn_t* insn, air_routine_t* routine, air_t* air)
 {
     if (!type_is_unsigned_integer(insn->ct) && insn->ct->class != CTC_POINTER)
+    {
+        localize_x86_64_direct_to_register(insn, routine, air);
         return;
+    }
 
     air_insn_t* ld = air_insn_init(AIR_LOAD, 2);
     ld->ct = insn->ops[0]->ct ? type_copy(insn->ops[0]->ct) : type_copy(insn->ct);
@@ -967,17 +1259,17 @@ void localize_x86_64_direct_multiply(air_insn_t* insn, air_routine_t* routine, a
     ld->ops[1] = air_insn_operand_copy(insn->ops[0]);
     air_insn_insert_before(ld, insn);
 
-    air_insn_operand_delete(insn->ops[0]);
-    insn->ops[0] = air_insn_register_operand_init(X86R_RAX);
-
+    // the product goes back where it was loaded from
     air_insn_t* assign = air_insn_init(AIR_ASSIGN, 2);
-    assign->ct = type_copy(insn->ct);
-    assign->ops[0] = air_insn_operand_copy(insn->ops[0]);
+    assign->ct = air_type(insn->ct);
+    assign->ops[0] = insn->ops[0];
     assign->ops[1] = air_insn_register_operand_init(X86R_RAX);
     air_insn_insert_after(assign, insn);
 
+    insn->ops[0] = air_insn_register_operand_init(X86R_RAX);
+
     air_insn_t* blip = air_insn_init(AIR_BLIP, 1);
-    blip->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+    blip->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
     blip->ops[0] = air_insn_register_operand_init(X86R_RDX);
     air_insn_insert_after(blip, insn);
 }
@@ -1079,6 +1371,13 @@ void localize_x86_64_return(air_insn_t* insn, air_routine_t* routine, air_t* air
 
     if ((rettype->class == CTC_STRUCTURE || rettype->class == CTC_UNION) && type_size(rettype) > 16)
     {
+        // the value is copied to where the caller's pointer points, and the pointer goes back in %rax
+        air_insn_t* ldptr = air_insn_init(AIR_LOAD, 2);
+        ldptr->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+        ldptr->ops[0] = air_insn_register_operand_init(X86R_RAX);
+        ldptr->ops[1] = air_insn_symbol_operand_init(routine->retptr);
+        pos = air_insn_insert_after(ldptr, pos);
+
         for (long long copied = 0; copied < rtsize;)
         {
             long long remaining = rtsize - copied;
@@ -1093,8 +1392,8 @@ void localize_x86_64_return(air_insn_t* insn, air_routine_t* routine, air_t* air
             pos = air_insn_insert_after(ld, pos);
 
             air_insn_t* copy = air_insn_init(AIR_ASSIGN, 2);
-            copy->ct = type_copy(copytype);
-            copy->ops[0] = air_insn_indirect_symbol_operand_init(routine->retptr, copied);
+            copy->ct = air_type(copytype);
+            copy->ops[0] = air_insn_indirect_register_operand_init(X86R_RAX, copied, INVALID_VREGID, 1);
             copy->ops[1] = air_insn_register_operand_init(tempreg);
             pos = air_insn_insert_after(copy, pos);
 
@@ -1106,7 +1405,7 @@ void localize_x86_64_return(air_insn_t* insn, air_routine_t* routine, air_t* air
     if (type_is_integer(rettype) || rettype->class == CTC_ARRAY || rettype->class == CTC_POINTER)
     {
         air_insn_t* ld = air_insn_init(AIR_LOAD, 2);
-        ld->ct = type_copy(rettype);
+        ld->ct = air_type(rettype);
         ld->ops[0] = air_insn_register_operand_init(X86R_RAX);
         ld->ops[1] = air_insn_register_operand_init(retreg);
         pos = air_insn_insert_after(ld, pos);
@@ -1116,7 +1415,7 @@ void localize_x86_64_return(air_insn_t* insn, air_routine_t* routine, air_t* air
     if (type_is_sse_floating(rettype))
     {
         air_insn_t* ld = air_insn_init(AIR_LOAD, 2);
-        ld->ct = type_copy(rettype);
+        ld->ct = air_type(rettype);
         ld->ops[0] = air_insn_register_operand_init(X86R_XMM0);
         ld->ops[1] = air_insn_register_operand_init(retreg);
         pos = air_insn_insert_after(ld, pos);
@@ -1150,7 +1449,7 @@ void localize_x86_64_return(air_insn_t* insn, air_routine_t* routine, air_t* air
                 if (copied)
                 {
                     air_insn_t* shl = air_insn_init(AIR_DIRECT_SHIFT_LEFT, 2);
-                    shl->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+                    shl->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
                     shl->ops[0] = air_insn_register_operand_init(integer_return_sequence[next_intretreg]);
                     shl->ops[1] = air_insn_integer_constant_operand_init(cpytsize << 3);
                     pos = air_insn_insert_after(shl, pos);
@@ -1204,15 +1503,18 @@ void localize_x86_64_routine_before(air_routine_t* routine, air_t* air)
          */
 
         // create and declare a local variable to store the ptr for the return value
+        pool_lock();
         symbol_t* sy = symbol_table_add(air->st, "__anonymous_lv__", symbol_init(NULL));
+        pool_unlock();
         sy->type = make_reference_type(rettype);
+        sy->sd = SD_AUTOMATIC;
 
         air_insn_t* decl = air_insn_init(AIR_DECLARE, 1);
         decl->ops[0] = air_insn_symbol_operand_init(sy);
 
         // assign %rdi to the local variable
         air_insn_t* assign = air_insn_init(AIR_ASSIGN, 2);
-        assign->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+        assign->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
         assign->ops[0] = air_insn_symbol_operand_init(sy);
         assign->ops[1] = air_insn_register_operand_init(nextintreg++);
 
@@ -1243,7 +1545,9 @@ void localize_x86_64_routine_before(air_routine_t* routine, air_t* air)
         if (!pid) continue;
 
         // get the symbol and type associated with the current parameter
+        pool_lock();
         symbol_t* psy = symbol_table_get_syn_id(air->st, pid);
+        pool_unlock();
         c_type_t* pt = vector_get(ftype->function.param_types, i);
 
         long long ptsize = type_size(pt);
@@ -1253,34 +1557,42 @@ void localize_x86_64_routine_before(air_routine_t* routine, air_t* air)
         size_t ccount = 0;
         arg_class_t* classes = find_classes(pt, &ccount);
 
+        // like on the calling side, a parameter that doesn't fit in the registers left is on the stack whole
+        bool on_stack = !fits_in_registers(classes, ccount, nextintreg, nextssereg);
+        if (on_stack)
+        {
+            long long alignment = max(type_alignment(pt), UNSIGNED_LONG_LONG_INT_WIDTH);
+            nexteightbyteoffset += (alignment - ((nexteightbyteoffset - 16) % alignment)) % alignment;
+        }
+
         for (size_t i = 0; i < ccount; ++i)
         {
             arg_class_t class = classes[i];
 
             regid_t reg = INVALID_VREGID;
-            if (class == ARG_INTEGER && nextintreg <= X86R_R9)
+            if (on_stack)
             {
-                reg = nextintreg++;
-                air_insn_t* insn = air_insn_init(AIR_DECLARE_REGISTER, 1);
-                insn->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
-                insn->ops[0] = air_insn_register_operand_init(reg);
-                inserting = air_insn_insert_after(insn, inserting);
+                air_insn_t* insn = air_insn_init(AIR_LOAD, 2);
+                insn->ct = air_basic_type(class == ARG_SSE ? CTC_DOUBLE : CTC_UNSIGNED_LONG_LONG_INT);
+                insn->ops[0] = air_insn_register_operand_init(reg = NEXT_VIRTUAL_REGISTER);
+                insn->ops[1] = air_insn_indirect_register_operand_init(X86R_RBP, nexteightbyteoffset, INVALID_VREGID, 1);
+                nexteightbyteoffset += 8;
+                inserting = air_insn_insert_after(insn, inserting);
             }
-            else if (class == ARG_SSE && nextssereg <= X86R_XMM7)
+            else if (class == ARG_INTEGER)
             {
-                reg = nextssereg++;
+                reg = nextintreg++;
                 air_insn_t* insn = air_insn_init(AIR_DECLARE_REGISTER, 1);
-                insn->ct = make_basic_type(CTC_DOUBLE);
+                insn->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
                 insn->ops[0] = air_insn_register_operand_init(reg);
                 inserting = air_insn_insert_after(insn, inserting);
             }
-            else if (class == ARG_MEMORY || class == ARG_INTEGER || class == ARG_SSE)
+            else if (class == ARG_SSE)
             {
-                air_insn_t* insn = air_insn_init(AIR_LOAD, 2);
-                insn->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
-                insn->ops[0] = air_insn_register_operand_init(reg = NEXT_VIRTUAL_REGISTER);
-                insn->ops[1] = air_insn_indirect_register_operand_init(X86R_RBP, nexteightbyteoffset, INVALID_VREGID, 1);
-                nexteightbyteoffset += 8;
+                reg = nextssereg++;
+                air_insn_t* insn = air_insn_init(AIR_DECLARE_REGISTER, 1);
+                insn->ct = air_basic_type(CTC_DOUBLE);
+                insn->ops[0] = air_insn_register_operand_init(reg);
                 inserting = air_insn_insert_after(insn, inserting);
             }
 
@@ -1306,7 +1618,7 @@ void localize_x86_64_routine_before(air_routine_t* routine, air_t* air)
                     continue;
                 
                 air_insn_t* shr = air_insn_init(AIR_DIRECT_SHIFT_RIGHT, 2);
-                shr->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+                shr->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
                 shr->ops[0] = air_insn_register_operand_init(reg);
                 shr->ops[1] = air_insn_integer_constant_operand_init(ttsize << 3);
 
@@ -1346,7 +1658,9 @@ air_insn_t* localize_x86_64_va_start(air_insn_t* insn, air_routine_t* routine, a
     {
         syntax_component_t* id = syntax_get_declarator_identifier(pdecl->pdecl_declr);
         if (!id) report_return_value(NULL);
+        pool_lock();
         symbol_t* psy = symbol_table_get_syn_id(SYMBOL_TABLE, id);
+        pool_unlock();
         if (!psy) report_return_value(NULL);
         c_type_t* pt = psy->type;
         size_t ccount = 0;
@@ -1388,43 +1702,43 @@ air_insn_t* localize_x86_64_va_start(air_insn_t* insn, air_routine_t* routine, a
     regid_t valist_reg = insn->ops[1]->content.reg;
 
     air_insn_t* ld_rbp = air_insn_init(AIR_LOAD, 2);
-    ld_rbp->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+    ld_rbp->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
     ld_rbp->ops[0] = air_insn_register_operand_init(reg);
     ld_rbp->ops[1] = air_insn_register_operand_init(X86R_RBP);
     air_insn_insert_before(ld_rbp, insn);
 
     air_insn_t* sub = air_insn_init(AIR_DIRECT_SUBTRACT, 2);
-    sub->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+    sub->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
     sub->ops[0] = air_insn_register_operand_init(reg);
     sub->ops[1] = air_insn_integer_constant_operand_init(abs(sseoffset));
     air_insn_insert_before(sub, insn);
 
     air_insn_t* ld_ssepos = air_insn_init(AIR_ASSIGN, 2);
-    ld_ssepos->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+    ld_ssepos->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
     ld_ssepos->ops[0] = air_insn_indirect_register_operand_init(valist_reg, 8, INVALID_VREGID, 1);
     ld_ssepos->ops[1] = air_insn_register_operand_init(reg);
     air_insn_insert_before(ld_ssepos, insn);
 
     air_insn_t* add1 = air_insn_init(AIR_DIRECT_ADD, 2);
-    add1->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+    add1->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
     add1->ops[0] = air_insn_register_operand_init(reg);
     add1->ops[1] = air_insn_integer_constant_operand_init(intoffset - sseoffset);
     air_insn_insert_before(add1, insn);
 
     air_insn_t* ld_intpos = air_insn_init(AIR_ASSIGN, 2);
-    ld_intpos->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+    ld_intpos->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
     ld_intpos->ops[0] = air_insn_indirect_register_operand_init(valist_reg, 0, INVALID_VREGID, 1);
     ld_intpos->ops[1] = air_insn_register_operand_init(reg);
     air_insn_insert_before(ld_intpos, insn);
 
     air_insn_t* add2 = air_insn_init(AIR_DIRECT_ADD, 2);
-    add2->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+    add2->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
     add2->ops[0] = air_insn_register_operand_init(reg);
     add2->ops[1] = air_insn_integer_constant_operand_init(stackoffset - intoffset);
     air_insn_insert_before(add2, insn);
 
     air_insn_t* ld_stackpos = air_insn_init(AIR_ASSIGN, 2);
-    ld_stackpos->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+    ld_stackpos->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
     ld_stackpos->ops[0] = air_insn_indirect_register_operand_init(valist_reg, 16, INVALID_VREGID, 1);
     ld_stackpos->ops[1] = air_insn_register_operand_init(reg);
     air_insn_insert_before(ld_stackpos, insn);
@@ -1472,19 +1786,19 @@ air_insn_t* localize_x86_64_va_arg(air_insn_t* insn, air_routine_t* routine, air
     regid_t posreg = NEXT_VIRTUAL_REGISTER;
 
     air_insn_t* ld_pos = air_insn_init(AIR_LOAD, 2);
-    ld_pos->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+    ld_pos->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
     ld_pos->ops[0] = air_insn_register_operand_init(posreg);
     ld_pos->ops[1] = air_insn_indirect_register_operand_init(valist_reg, offset, INVALID_VREGID, 1);
     air_insn_insert_before(ld_pos, insn);
 
     air_insn_t* ld = air_insn_init(AIR_LOAD, 2);
-    ld->ct = type_copy(insn->ct);
+    ld->ct = air_type(insn->ct);
     ld->ops[0] = air_insn_register_operand_init(reg);
     ld->ops[1] = air_insn_indirect_register_operand_init(posreg, 0, INVALID_VREGID, 1);
     air_insn_insert_before(ld, insn);
 
     air_insn_t* add = air_insn_init(AIR_DIRECT_ADD, 2);
-    add->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+    add->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
     add->ops[0] = air_insn_indirect_register_operand_init(valist_reg, offset, INVALID_VREGID, 1);
     add->ops[1] = air_insn_integer_constant_operand_init(increment);
     air_insn_insert_before(add, insn);
@@ -1511,12 +1825,51 @@ int _3 = _1 == _2;
 _3 &= 1;
 
 */
-void localize_x86_64_setcc_comparison(air_insn_t* insn, air_routine_t* routine, air_t* air)
+static air_insn_t* skip_sequence_points(air_insn_t* insn)
 {
+    while (insn && insn->type == AIR_SEQUENCE_POINT)
+        insn = insn->next;
+    return insn;
+}
+
+/*
+
+a comparison whose result is only tested by the jump right after it:
+
+int _2 = _0 < _1;
+jnz(.L1, _2);
+
+never needs its result in a register. x86 generation emits just the compare and a jump on its flags
+(see x86_generate_fused_branch), so the zero extension below is left out.
+
+*/
+static bool fuses_branch(air_insn_t* insn, air_defuse_t* du)
+{
+    if (insn->type == AIR_NOT || insn->ops[0]->type != AOP_REGISTER)
+        return false;
+    c_type_t* opt = insn->ops[1]->ct;
+    if (!opt || (!type_is_integer(opt) && !type_is_sse_floating(opt)))
+        return false;
+    regid_t reg = insn->ops[0]->content.reg;
+    air_insn_t* jump = skip_sequence_points(insn->next);
+    if (!jump || (jump->type != AIR_JZ && jump->type != AIR_JNZ))
+        return false;
+    if (jump->ops[1]->type != AOP_REGISTER || jump->ops[1]->content.reg != reg)
+        return false;
+    vector_t* defs = air_defuse_definitions(du, reg);
+    vector_t* uses = air_defuse_uses(du, reg);
+    return defs && defs->size == 1 && uses && uses->size == 1;
+}
+
+void localize_x86_64_setcc_comparison(air_insn_t* insn, air_routine_t* routine, air_t* air, air_defuse_t* du)
+{
+    if ((insn->metadata.fuses_branch = fuses_branch(insn, du)))
+        return;
+
     regid_t reg = insn->ops[0]->content.reg;
 
     air_insn_t* and = air_insn_init(AIR_DIRECT_AND, 2);
-    and->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+    and->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
     and->ops[0] = air_insn_register_operand_init(reg);
     and->ops[1] = air_insn_integer_constant_operand_init(1);
     air_insn_insert_after(and, insn);
@@ -1533,7 +1886,7 @@ void localize_x86_64_shift(air_insn_t* insn, air_routine_t* routine, air_t* air,
         report_return;
 
     air_insn_t* ld = air_insn_init(AIR_LOAD, 2);
-    ld->ct = type_copy(insn->ct);
+    ld->ct = air_type(insn->ct);
     ld->ops[0] = air_insn_register_operand_init(X86R_RCX);
     ld->ops[1] = air_insn_register_operand_init(insn->ops[index]->content.reg);
     air_insn_insert_before(ld, insn);
@@ -1554,8 +1907,9 @@ sse _2 = _1 ^ _3;
 air_insn_t* localize_x86_64_sse_negate(air_insn_t* insn, air_routine_t* routine, air_t* air)
 {
     bool is_float = insn->ct->class == CTC_FLOAT;
+    // the constant itself is defined by localize_constants
+    pool_lock();
     symbol_t* negater = is_float ? air->sse32_negater : air->sse64_negater;
-    bool to_define = !negater;
     if (!negater && is_float)
     {
         negater = air->sse32_negater = symbol_table_add(SYMBOL_TABLE, "__sse32_negater", symbol_init(NULL));
@@ -1570,35 +1924,18 @@ air_insn_t* localize_x86_64_sse_negate(air_insn_t* insn, air_routine_t* routine,
         negater->type = make_basic_type(CTC_DOUBLE);
         negater->sd = SD_STATIC;
     }
-
-    if (to_define)
-    {
-        air_data_t* data = calloc(1, sizeof *data);
-        data->readonly = true;
-        data->sy = negater;
-        if (is_float)
-        {
-            data->data = malloc(FLOAT_WIDTH);
-            *((unsigned*) (data->data)) = 0x80000000;
-        }
-        else
-        {
-            data->data = malloc(DOUBLE_WIDTH);
-            *((unsigned long long*) (data->data)) = 0x8000000000000000;
-        }
-        vector_add(air->rodata, data);
-    }
+    pool_unlock();
 
     regid_t negater_reg = NEXT_VIRTUAL_REGISTER;
 
     air_insn_t* ld = air_insn_init(AIR_LOAD, 2);
-    ld->ct = type_copy(insn->ct);
+    ld->ct = air_type(insn->ct);
     ld->ops[0] = air_insn_register_operand_init(negater_reg);
     ld->ops[1] = air_insn_symbol_operand_init(negater);
     air_insn_insert_before(ld, insn);
 
     air_insn_t* xor = air_insn_init(AIR_XOR, 3);
-    xor->ct = type_copy(insn->ct);
+    xor->ct = air_type(insn->ct);
     xor->ops[0] = air_insn_operand_copy(insn->ops[0]);
     xor->ops[1] = air_insn_operand_copy(insn->ops[1]);
     xor->ops[2] = air_insn_register_operand_init(negater_reg);
@@ -1616,26 +1953,150 @@ air_insn_t* localize_x86_64_negate(air_insn_t* insn, air_routine_t* routine, air
     return insn;
 }
 
-void localize_x86_64_memset(air_insn_t* insn, air_routine_t* routine, air_t* air)
+/*
+
+memsets of a few eightbytes are cheaper as stores than as rep stosb, which takes a while to get going:
+
+    memset(0, p, 32);
+    long int _1 = 1;
+    p = _1;
+    long int _2 = 2;
+    p + 8 = _2;
+
+becomes:
+
+    p + 16 = 0;
+    p + 24 = 0;
+    long int _1 = 1;
+    p = _1;
+    long int _2 = 2;
+    p + 8 = _2;
+
+the bytes stored to before anything else can see the object skip the memset, which is the common case of
+zero-filling what an initializer list leaves out. the scan stops at anything that names the object otherwise, and
+at calls and control flow.
+
+*/
+
+#define X86_64_INLINE_MEMSET_LIMIT 64
+
+// marks the bytes of the object initialized by straight-line stores right after it's memset
+static unsigned long long find_covered_bytes(air_insn_t* insn, symbol_t* sy, long long size)
+{
+    unsigned long long covered = 0;
+    for (air_insn_t* next = insn->next; next; next = next->next)
+    {
+        switch (next->type)
+        {
+            case AIR_LABEL:
+            case AIR_JZ:
+            case AIR_JNZ:
+            case AIR_JMP:
+            case AIR_JMP_TABLE:
+            case AIR_RETURN:
+            case AIR_FUNC_CALL:
+            case AIR_LSYSCALL:
+            case AIR_VA_START:
+            case AIR_VA_ARG:
+            case AIR_VA_END:
+            case AIR_MEMSET:
+                return covered;
+            default:
+                break;
+        }
+        size_t i = 0;
+        if (next->type == AIR_ASSIGN && !next->ct->qualifiers)
+        {
+            air_insn_operand_t* dest = next->ops[0];
+            long long offset = -1;
+            if (dest->type == AOP_SYMBOL && dest->content.sy == sy)
+                offset = 0;
+            else if (dest->type == AOP_INDIRECT_SYMBOL && dest->content.insy.sy == sy)
+                offset = dest->content.insy.offset;
+            if (offset != -1)
+            {
+                for (long long j = offset; j < offset + type_size(next->ct) && j < size; ++j)
+                    covered |= 1ULL << j;
+                i = 1;
+            }
+        }
+        for (; i < next->noops; ++i)
+        {
+            air_insn_operand_t* op = next->ops[i];
+            if (!op) continue;
+            if ((op->type == AOP_SYMBOL && op->content.sy == sy) ||
+                (op->type == AOP_INDIRECT_SYMBOL && op->content.insy.sy == sy))
+                return covered;
+        }
+    }
+    return covered;
+}
+
+// stores a byte over a small object, except where it's about to be stored to anyway. returns the last instruction
+// inserted, or the one before the memset if nothing needed storing
+static air_insn_t* localize_x86_64_inline_memset(air_insn_t* insn, symbol_t* sy, unsigned char byte, long long size)
+{
+    unsigned long long covered = find_covered_bytes(insn, sy, size);
+    unsigned long long pattern = byte * 0x0101010101010101ULL;
+    // only these fill an eightbyte with something that fits a sign-extended immediate
+    long long widest = byte == 0x00 || byte == 0xFF ? UNSIGNED_LONG_LONG_INT_WIDTH : UNSIGNED_INT_WIDTH;
+    for (long long at = 0; at < size;)
+    {
+        if (covered & (1ULL << at))
+        {
+            ++at;
+            continue;
+        }
+        long long width = widest;
+        for (; width > 1; width /= 2)
+        {
+            if (at % width == 0 && at + width <= size && !(covered & (((1ULL << width) - 1) << at)))
+                break;
+        }
+        c_type_class_t class = CTC_UNSIGNED_CHAR;
+        if (width == UNSIGNED_LONG_LONG_INT_WIDTH)
+            class = CTC_UNSIGNED_LONG_LONG_INT;
+        else if (width == UNSIGNED_INT_WIDTH)
+            class = CTC_UNSIGNED_INT;
+        else if (width == UNSIGNED_SHORT_INT_WIDTH)
+            class = CTC_UNSIGNED_SHORT_INT;
+        air_insn_t* store = air_insn_init(AIR_ASSIGN, 2);
+        store->ct = air_basic_type(class);
+        store->ops[0] = air_insn_indirect_symbol_operand_init(sy, at);
+        store->ops[1] = air_insn_integer_constant_operand_init(width == UNSIGNED_LONG_LONG_INT_WIDTH ? pattern :
+            pattern & ((1ULL << (width * 8)) - 1));
+        air_insn_insert_before(store, insn);
+        at += width;
+    }
+    air_insn_t* last = insn->prev;
+    air_insn_remove(insn);
+    return last;
+}
+
+air_insn_t* localize_x86_64_memset(air_insn_t* insn, air_routine_t* routine, air_t* air)
 {
     air_insn_operand_t* op1 = insn->ops[0];
     air_insn_operand_t* op2 = insn->ops[1];
     air_insn_operand_t* op3 = insn->ops[2];
 
+    if (op1->type == AOP_INTEGER_CONSTANT && op2->type == AOP_SYMBOL && op3->type == AOP_INTEGER_CONSTANT &&
+        op3->content.ic <= X86_64_INLINE_MEMSET_LIMIT)
+        return localize_x86_64_inline_memset(insn, op2->content.sy, op1->content.ic, op3->content.ic);
+
     air_insn_t* ldv = air_insn_init(AIR_LOAD, 2);
-    ldv->ct = make_basic_type(CTC_UNSIGNED_CHAR);
+    ldv->ct = air_basic_type(CTC_UNSIGNED_CHAR);
     ldv->ops[0] = air_insn_register_operand_init(X86R_RAX);
     ldv->ops[1] = air_insn_operand_copy(op1);
     air_insn_insert_before(ldv, insn);
 
     air_insn_t* ldptr = air_insn_init(AIR_LOAD_ADDR, 2);
-    ldptr->ct = type_copy(insn->ct);
+    ldptr->ct = air_type(insn->ct);
     ldptr->ops[0] = air_insn_register_operand_init(X86R_RDI);
     ldptr->ops[1] = air_insn_operand_copy(op2);
     air_insn_insert_before(ldptr, insn);
 
     air_insn_t* ldc = air_insn_init(AIR_LOAD, 2);
-    ldc->ct = make_basic_type(C_TYPE_SIZE_T);
+    ldc->ct = air_basic_type(C_TYPE_SIZE_T);
     ldc->ops[0] = air_insn_register_operand_init(X86R_RCX);
     ldc->ops[1] = air_insn_operand_copy(op3);
     air_insn_insert_before(ldc, insn);
@@ -1645,9 +2106,40 @@ void localize_x86_64_memset(air_insn_t* insn, air_routine_t* routine, air_t* air
     air_insn_operand_delete(op3);
 
     insn->ops[0] = air_insn_register_operand_init(X86R_RAX);
-    insn->ops[0]->ct = make_basic_type(CTC_UNSIGNED_CHAR);
+    insn->ops[0]->ct = air_basic_type(CTC_UNSIGNED_CHAR);
     insn->ops[1] = air_insn_register_operand_init(X86R_RDI);
     insn->ops[2] = air_insn_register_operand_init(X86R_RCX);
+    return insn;
+}
+
+/*
+
+jmp_table(_1, .L1, .L2, .L3);
+
+becomes:
+
+unsigned long long %rax = _1;
+blip %r11;
+jmp_table(%rax, .L1, .L2, .L3);
+
+the jump reads its target out of the table into the index's register, and needs another for the table's address.
+
+*/
+void localize_x86_64_jmp_table(air_insn_t* insn, air_routine_t* routine, air_t* air)
+{
+    air_insn_t* ld = air_insn_init(AIR_LOAD, 2);
+    ld->ct = air_type(insn->ct);
+    ld->ops[0] = air_insn_register_operand_init(X86R_RAX);
+    ld->ops[1] = air_insn_operand_copy(insn->ops[0]);
+    air_insn_insert_before(ld, insn);
+
+    air_insn_t* blip = air_insn_init(AIR_BLIP, 1);
+    blip->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+    blip->ops[0] = air_insn_register_operand_init(X86R_R11);
+    air_insn_insert_before(blip, insn);
+
+    air_insn_operand_delete(insn->ops[0]);
+    insn->ops[0] = air_insn_register_operand_init(X86R_RAX);
 }
 
 void localize_x86_64_assign_imm64_to_m64(air_insn_t* insn, air_routine_t* routine, air_t* air)
@@ -1660,7 +2152,7 @@ void localize_x86_64_assign_imm64_to_m64(air_insn_t* insn, air_routine_t* routin
     regid_t reg = NEXT_VIRTUAL_REGISTER;
 
     air_insn_t* ld = air_insn_init(AIR_LOAD, 2);
-    ld->ct = type_copy(insn->ct);
+    ld->ct = air_type(insn->ct);
     ld->ops[0] = air_insn_register_operand_init(reg);
     ld->ops[1] = air_insn_operand_copy(op2);
     air_insn_insert_before(ld, insn);
@@ -1712,7 +2204,7 @@ void localize_x86_64_lsyscall(air_insn_t* insn, air_routine_t* routine, air_t* a
         if (!def) report_return;
 
         air_insn_t* ld = air_insn_init(AIR_LOAD, 2);
-        ld->ct = type_copy(def->ct);
+        ld->ct = air_type(def->ct);
         ld->ops[0] = air_insn_register_operand_init(sequence[nextreg++]);
         ld->ops[1] = air_insn_operand_copy(op);
         air_insn_insert_before(ld, insn);
@@ -1725,7 +2217,7 @@ void localize_x86_64_lsyscall(air_insn_t* insn, air_routine_t* routine, air_t* a
     if (!id_op || id_op->type != AOP_INTEGER_CONSTANT) report_return;
 
     air_insn_t* id_load = air_insn_init(AIR_LOAD, 2);
-    id_load->ct = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+    id_load->ct = air_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
     id_load->ops[0] = air_insn_register_operand_init(X86R_RAX);
     id_load->ops[1] = air_insn_integer_constant_operand_init(id_op->content.ic);
     air_insn_insert_before(id_load, insn);
@@ -1741,7 +2233,7 @@ void localize_x86_64_lsyscall(air_insn_t* insn, air_routine_t* routine, air_t* a
     regid_t rreg = rop->content.reg;
 
     air_insn_t* ld = air_insn_init(AIR_LOAD, 2);
-    ld->ct = type_copy(insn->ct);
+    ld->ct = air_type(insn->ct);
     ld->ops[0] = air_insn_register_operand_init(rreg);
     ld->ops[1] = air_insn_register_operand_init(X86R_RAX);
     pos = air_insn_insert_after(ld, pos);
@@ -1749,160 +2241,1058 @@ void localize_x86_64_lsyscall(air_insn_t* insn, air_routine_t* routine, air_t* a
     rop->content.reg = INVALID_VREGID;
 }
 
-void localize_x86_64(air_t* air)
+/*
+
+address arithmetic is folded into the memory operands that use it, and arithmetic that fits an address is computed
+with lea:
+
+int _6 = _4 * 4;
+int* _7 = _5 + _6;
+int _8 = *(_7 + 12);
+int _9 = _4 * 3;
+
+becomes:
+
+int _8 = *(_5 + _4 * 4 + 12);
+int _9 = &*(_4 + _4 * 2);
+
+only registers with a single definition that nothing writes in place are looked through, so their values are
+the same wherever they're read. a 32-bit multiply can only be folded into a 64-bit address if it's signed and its
+other operand came out of a 32-bit instruction, since overflowing it is undefined and the register is zero-extended
+anyway. additions that still need their first operand afterwards become lea too, which saves the copy otherwise made
+for them. definitions left unused are removed afterwards.
+
+*/
+
+typedef struct x86_64_address
+{
+    regid_t base;
+    regid_t index;
+    long long scale;
+    long long offset;
+} x86_64_address_t;
+
+static bool fits_int32(long long value)
+{
+    return value >= -0x80000000LL && value <= 0x7FFFFFFFLL;
+}
+
+static bool is_address_type(c_type_t* ct)
 {
-    VECTOR_FOR(air_routine_t*, routine, air->routines)
+    return ct && (type_is_integer(ct) || ct->class == CTC_POINTER) && (type_size(ct) == 4 || type_size(ct) == 8);
+}
+
+// the only definition of a virtual register, if it has exactly one and is never written in place
+static air_insn_t* stable_definition(air_defuse_t* du, regid_t reg)
+{
+    if (reg <= NO_PHYSICAL_REGISTERS)
+        return NULL;
+    vector_t* defs = air_defuse_definitions(du, reg);
+    if (!defs || defs->size != 1)
+        return NULL;
+    vector_t* uses = air_defuse_uses(du, reg);
+    if (uses)
     {
-        localize_x86_64_routine_before(routine, air);
-        for (air_insn_t* insn = routine->insns; insn; insn = insn->next)
+        VECTOR_FOR(air_insn_t*, use, uses)
         {
-            switch (insn->type)
-            {
-                case AIR_FUNC_CALL:
-                    localize_x86_64_func_call(insn, routine, air);
-                    break;
-                case AIR_RETURN:
-                    localize_x86_64_return(insn, routine, air);
-                    break;
-                case AIR_DIVIDE:
-                case AIR_MODULO:
-                    localize_x86_64_divide_modulo(insn, routine, air);
-                    break;
-                case AIR_DIRECT_DIVIDE:
-                case AIR_DIRECT_MODULO:
-                    localize_x86_64_direct_divide_modulo(insn, routine, air);
-                    break;
-                case AIR_ADD:
-                case AIR_SUBTRACT:
-                    localize_x86_64_add_subtract(insn, routine, air);
-                    break;
-                case AIR_MULTIPLY:
-                    localize_x86_64_multiply(insn, routine, air);
-                    break;
-                case AIR_DIRECT_MULTIPLY:
-                    localize_x86_64_direct_multiply(insn, routine, air);
-                    break;
-                case AIR_VA_START:
-                    insn = localize_x86_64_va_start(insn, routine, air);
-                    break;
-                case AIR_VA_ARG:
-                    insn = localize_x86_64_va_arg(insn, routine, air);
-                    break;
-                case AIR_VA_END:
-                    insn = localize_x86_64_va_end(insn, routine, air);
-                    break;
-                case AIR_SHIFT_LEFT:
-                case AIR_SHIFT_RIGHT:
-                case AIR_SIGNED_SHIFT_RIGHT:
-                    localize_x86_64_shift(insn, routine, air, 2);
-                    break;
-                case AIR_DIRECT_SHIFT_LEFT:
-                case AIR_DIRECT_SHIFT_RIGHT:
-                case AIR_DIRECT_SIGNED_SHIFT_RIGHT:
-                    localize_x86_64_shift(insn, routine, air, 1);
-                    break;
-                case AIR_LESS_EQUAL:
-                case AIR_LESS:
-                case AIR_GREATER_EQUAL:
-                case AIR_GREATER:
-                case AIR_EQUAL:
-                case AIR_INEQUAL:
-                case AIR_NOT:
-                    localize_x86_64_setcc_comparison(insn, routine, air);
-                    break;
-                case AIR_NEGATE:
-                    insn = localize_x86_64_negate(insn, routine, air);
-                    break;
-                case AIR_MEMSET:
-                    localize_x86_64_memset(insn, routine, air);
-                    break;
-                case AIR_ASSIGN:
-                    localize_x86_64_assign(insn, routine, air);
-                    break;
-                case AIR_LSYSCALL:
-                    localize_x86_64_lsyscall(insn, routine, air);
-                    break;
-                default:
-                    break;
-            }
+            if (!air_insn_creates_temporary(use) && use->noops && use->ops[0] &&
+                use->ops[0]->type == AOP_REGISTER && use->ops[0]->content.reg == reg)
+                return NULL;
         }
     }
+    air_insn_t* def = vector_get(defs, 0);
+    return is_address_type(def->ct) ? def : NULL;
 }
 
-void remove_phi_instructions(air_t* air)
+// an integer constant, either directly or loaded into a register, read at the width of the instruction using it
+static bool find_constant(air_defuse_t* du, air_insn_t* insn, air_insn_operand_t* op, long long* value)
 {
-    map_t* map = map_init((comparator_t) regid_comparator, (hash_function_t) regid_hash);
+    unsigned long long ic;
+    if (op->type == AOP_INTEGER_CONSTANT)
+        ic = op->content.ic;
+    else if (op->type == AOP_REGISTER)
+    {
+        air_insn_t* def = stable_definition(du, op->content.reg);
+        if (!def || def->type != AIR_LOAD || def->ops[1]->type != AOP_INTEGER_CONSTANT)
+            return false;
+        ic = def->ops[1]->content.ic;
+    }
+    else
+        return false;
+    *value = type_size(insn->ct) == 4 ? (long long) (int) ic : (long long) ic;
+    return true;
+}
 
-    VECTOR_FOR(air_routine_t*, routine, air->routines)
+// whether a 32-bit register is known to be zero-extended, because a 32-bit instruction computed it
+static bool is_zero_extended(air_insn_t* def)
+{
+    switch (def->type)
     {
-        air_insn_t* last = routine->insns;
-        for (; last && last->next; last = last->next);
+        case AIR_ADD:
+        case AIR_SUBTRACT:
+        case AIR_MULTIPLY:
+        case AIR_AND:
+        case AIR_OR:
+        case AIR_XOR:
+        case AIR_SHIFT_LEFT:
+        case AIR_SHIFT_RIGHT:
+        case AIR_SIGNED_SHIFT_RIGHT:
+            return true;
+        case AIR_LOAD:
+            return def->ops[1]->type != AOP_REGISTER;
+        default:
+            return false;
+    }
+}
 
-        for (air_insn_t* insn = last; insn;)
+// the register operand and constant of an instruction applying a constant to a register, in either order
+static bool find_register_and_constant(air_defuse_t* du, air_insn_t* insn, regid_t* reg, long long* value)
+{
+    for (size_t i = 1; i <= 2; ++i)
+    {
+        air_insn_operand_t* rop = insn->ops[i];
+        air_insn_operand_t* cop = insn->ops[3 - i];
+        if (rop->type == AOP_REGISTER && find_constant(du, insn, cop, value))
         {
-            if (insn->type == AIR_PHI)
-            {
-                air_insn_operand_t* op1 = insn->ops[0];
-                if (!op1 || op1->type != AOP_REGISTER) report_return;
-                regid_t reg = op1->content.reg;
+            *reg = rop->content.reg;
+            return true;
+        }
+        // only addition and multiplication commute
+        if (insn->type == AIR_SHIFT_LEFT)
+            break;
+    }
+    return false;
+}
 
-                for (int i = 1; i < insn->noops; ++i)
-                {
-                    air_insn_operand_t* op = insn->ops[i];
-                    if (!op || op->type != AOP_REGISTER) report_return;
-                    regid_t opreg = op->content.reg;
+static bool fold_address_base(air_defuse_t* du, x86_64_address_t* addr, long long width)
+{
+    air_insn_t* def = stable_definition(du, addr->base);
+    // a narrower computation can't stand in for a wider one
+    if (!def || type_size(def->ct) < width)
+        return false;
+    regid_t reg;
+    long long k;
+    if (def->type == AIR_ADD)
+    {
+        if (find_register_and_constant(du, def, &reg, &k))
+        {
+            if (!stable_definition(du, reg) || !fits_int32(k) || !fits_int32(addr->offset + k))
+                return false;
+            addr->base = reg;
+            addr->offset += k;
+            return true;
+        }
+        if (addr->index != INVALID_VREGID || def->ops[1]->type != AOP_REGISTER || def->ops[2]->type != AOP_REGISTER)
+            return false;
+        if (!stable_definition(du, def->ops[1]->content.reg) || !stable_definition(du, def->ops[2]->content.reg))
+            return false;
+        addr->base = def->ops[1]->content.reg;
+        addr->index = def->ops[2]->content.reg;
+        addr->scale = 1;
+        return true;
+    }
+    if (def->type == AIR_LOAD_ADDR && def->ops[1]->type == AOP_INDIRECT_REGISTER)
+    {
+        air_insn_operand_t* op = def->ops[1];
+        long long offset = addr->offset + op->content.inreg.offset;
+        if (!stable_definition(du, op->content.inreg.id) || !fits_int32(offset))
+            return false;
+        if (op->content.inreg.roffset != INVALID_VREGID)
+        {
+            if (addr->index != INVALID_VREGID || !stable_definition(du, op->content.inreg.roffset))
+                return false;
+            addr->index = op->content.inreg.roffset;
+            addr->scale = op->content.inreg.factor;
+        }
+        addr->base = op->content.inreg.id;
+        addr->offset = offset;
+        return true;
+    }
+    return false;
+}
 
-                    map_add(map, (void*) opreg, (void*) reg);
-                }
+static bool fold_address_index(air_defuse_t* du, x86_64_address_t* addr, long long width)
+{
+    air_insn_t* def = stable_definition(du, addr->index);
+    if (!def || (def->type != AIR_ADD && def->type != AIR_MULTIPLY && def->type != AIR_SHIFT_LEFT))
+        return false;
+    regid_t reg;
+    long long k;
+    if (!find_register_and_constant(du, def, &reg, &k))
+        return false;
+    air_insn_t* regdef = stable_definition(du, reg);
+    if (!regdef)
+        return false;
+    long long size = type_size(def->ct);
+    if (def->type == AIR_ADD)
+    {
+        long long offset = addr->offset + k * addr->scale;
+        if (size < width || !fits_int32(k) || !fits_int32(offset))
+            return false;
+        addr->index = reg;
+        addr->offset = offset;
+        return true;
+    }
+    long long factor;
+    if (def->type == AIR_MULTIPLY)
+        factor = k;
+    else if (def->type == AIR_SHIFT_LEFT && k >= 0 && k <= 3)
+        factor = 1LL << k;
+    else
+        return false;
+    long long scale = addr->scale * factor;
+    if (scale != 1 && scale != 2 && scale != 4 && scale != 8)
+        return false;
+    if (size < width && (!type_is_signed_integer(def->ct) || type_size(regdef->ct) != 4 || !is_zero_extended(regdef)))
+        return false;
+    addr->index = reg;
+    addr->scale = scale;
+    return true;
+}
+
+// folds as much arithmetic into an address as it can, returning whether it folded any
+static bool fold_address(air_defuse_t* du, x86_64_address_t* addr, long long width)
+{
+    bool folded = false;
+    // a cap in case a definition somehow feeds itself
+    for (size_t i = 0; i < 16 && (fold_address_base(du, addr, width) || fold_address_index(du, addr, width)); ++i)
+        folded = true;
+    return folded;
+}
+
+static void fold_memory_operands(air_insn_t* insn, air_defuse_t* du)
+{
+    switch (insn->type)
+    {
+        case AIR_LOAD:
+        case AIR_ASSIGN:
+        case AIR_DIRECT_ADD:
+        case AIR_DIRECT_SUBTRACT:
+        case AIR_DIRECT_MULTIPLY:
+        case AIR_DIRECT_AND:
+        case AIR_DIRECT_OR:
+        case AIR_DIRECT_XOR:
+        case AIR_DIRECT_SHIFT_LEFT:
+        case AIR_DIRECT_SHIFT_RIGHT:
+        case AIR_DIRECT_SIGNED_SHIFT_RIGHT:
+            break;
+        default:
+            return;
+    }
+    // aggregates are copied by their base register alone
+    if (!insn->ct || !type_is_scalar_type(insn->ct->class))
+        return;
+    for (size_t i = 0; i < insn->noops; ++i)
+    {
+        air_insn_operand_t* op = insn->ops[i];
+        if (!op || op->type != AOP_INDIRECT_REGISTER || op->content.inreg.factor != 1)
+            continue;
+        x86_64_address_t addr = { op->content.inreg.id, op->content.inreg.roffset, 1, op->content.inreg.offset };
+        if (!fold_address(du, &addr, 8))
+            continue;
+        op->content.inreg.id = addr.base;
+        op->content.inreg.roffset = addr.index;
+        op->content.inreg.factor = addr.index != INVALID_VREGID ? addr.scale : 1;
+        op->content.inreg.offset = addr.offset;
+    }
+}
+
+// mirrors localize_x86_64_preserve_first_operand, which copies a first operand that's still needed
+static bool first_operand_survives(air_insn_t* insn, air_cfg_t* cfg, air_defuse_t* du)
+{
+    air_insn_operand_t* op = insn->ops[1];
+    if (op->type != AOP_REGISTER || op->content.reg <= NO_PHYSICAL_REGISTERS)
+        return false;
+    vector_t* uses = air_defuse_uses(du, op->content.reg);
+    air_insn_t* def = air_defuse_definition(du, op->content.reg);
+    return !(uses && uses->size == 1 && def && air_cfg_block(cfg, def) == air_cfg_block(cfg, insn));
+}
+
+static void select_lea(air_insn_t* insn, air_cfg_t* cfg, air_defuse_t* du)
+{
+    if (insn->type != AIR_ADD && insn->type != AIR_MULTIPLY)
+        return;
+    if (!is_address_type(insn->ct) || insn->ops[0]->type != AOP_REGISTER)
+        return;
+    long long width = type_size(insn->ct);
+    x86_64_address_t addr = { INVALID_VREGID, INVALID_VREGID, 1, 0 };
+    regid_t reg;
+    long long k;
+    bool select = false;
+    if (insn->type == AIR_ADD)
+    {
+        if (find_register_and_constant(du, insn, &reg, &k))
+        {
+            if (!fits_int32(k))
+                return;
+            addr.base = reg;
+            addr.offset = k;
+        }
+        else if (insn->ops[1]->type == AOP_REGISTER && insn->ops[2]->type == AOP_REGISTER)
+        {
+            addr.base = insn->ops[1]->content.reg;
+            addr.index = insn->ops[2]->content.reg;
+        }
+        else
+            return;
+        select = first_operand_survives(insn, cfg, du);
+    }
+    else
+    {
+        if (!find_register_and_constant(du, insn, &reg, &k) || (k != 2 && k != 3 && k != 5 && k != 9))
+            return;
+        addr.base = reg;
+        addr.index = reg;
+        addr.scale = k - 1;
+        select = true;
+    }
+    if (!fold_address(du, &addr, width) && !select)
+        return;
+
+    air_insn_operand_delete(insn->ops[1]);
+    air_insn_operand_delete(insn->ops[2]);
+    insn->type = AIR_LOAD_ADDR;
+    insn->ops[1] = air_insn_indirect_register_operand_init(addr.base, addr.offset, addr.index,
+        addr.index != INVALID_VREGID ? addr.scale : 1);
+    insn->ops[2] = NULL;
+    insn->noops = 2;
+}
+
+// whether an instruction only computes its result, so it can go once nothing reads it
+static bool is_removable_definition(air_insn_t* insn)
+{
+    if (!is_address_type(insn->ct) || !insn->noops || insn->ops[0]->type != AOP_REGISTER ||
+        insn->ops[0]->content.reg <= NO_PHYSICAL_REGISTERS)
+        return false;
+    switch (insn->type)
+    {
+        case AIR_ADD:
+        case AIR_SUBTRACT:
+        case AIR_MULTIPLY:
+        case AIR_SHIFT_LEFT:
+        case AIR_LOAD_ADDR:
+            return true;
+        case AIR_LOAD:
+            return insn->ops[1]->type == AOP_INTEGER_CONSTANT || insn->ops[1]->type == AOP_REGISTER;
+        default:
+            return false;
+    }
+}
 
-                insn = air_insn_remove(insn);
+static void localize_x86_64_select_addresses(air_routine_t* routine, air_t* air)
+{
+    air_cfg_t* cfg = air_routine_cfg(routine);
+    air_defuse_t* du = air_defuse_init(routine);
+    for (air_insn_t* insn = routine->insns; insn; insn = insn->next)
+    {
+        fold_memory_operands(insn, du);
+        select_lea(insn, cfg, du);
+    }
+    air_defuse_delete(du);
+    air_routine_invalidate_cfg(routine);
+
+    // folding every use of a register away leaves its definition dead, and removing that can leave its operands dead
+    for (bool removed = true; removed;)
+    {
+        removed = false;
+        du = air_defuse_init(routine);
+        for (air_insn_t* insn = routine->insns ? routine->insns->next : NULL; insn; insn = insn->next)
+        {
+            if (!is_removable_definition(insn))
                 continue;
-            }
+            vector_t* uses = air_defuse_uses(du, insn->ops[0]->content.reg);
+            if (uses && uses->size)
+                continue;
+            insn = air_insn_remove(insn);
+            removed = true;
+        }
+        air_defuse_delete(du);
+    }
+}
+
+/*
+
+multiplication, division, and modulo by integer constants are reduced to cheaper instructions:
+
+int _2 = _1 * 8;        ->  int _2 = _1 << 3;
+int _2 = _1 * 10;       ->  int _3 = _1 * 5; int _2 = _3 << 1;
+int _2 = _1 * 7;        ->  int _3 = _1 << 3; int _2 = _3 - _1;
+unsigned _2 = _1 / 8;   ->  unsigned _2 = _1 >>> 3;
+unsigned _2 = _1 % 8;   ->  unsigned _2 = _1 & 7;
+
+the multiply by 5 becomes a lea once addresses are selected. signed division by a power of two first adds 2^k - 1
+to negative dividends, so the shift rounds toward zero like idiv does. any other divisor is divided by multiplying
+with a fixed-point reciprocal and keeping the high half of the product:
+
+unsigned _2 = _1 / 10;
+
+becomes:
+
+unsigned long _3 = zext(_1);
+long _4 = 3435973837;
+long _5 = _3 * _4;
+unsigned long _6 = _5 >>> 35;
+unsigned _2 = _6;
+
+a 32-bit dividend fits the whole product in 64 bits. a 64-bit one takes the high half out of %rdx after a mul, and
+signed division corrects it for the operands' signs. remainders are the dividend less the quotient times the divisor.
+
+*/
+
+static unsigned ceil_log2(unsigned long long value)
+{
+    unsigned l = 0;
+    while (l < 64 && (1ULL << l) < value)
+        ++l;
+    return l;
+}
+
+// -1 if the value isn't a power of two
+static int exact_log2(unsigned long long value)
+{
+    if (!value || (value & (value - 1)))
+        return -1;
+    return ceil_log2(value);
+}
+
+// floor(2^k / d) as a 128-bit quotient, and the remainder, by long division
+static void divide_power_of_two(unsigned k, unsigned long long d, unsigned long long* high, unsigned long long* low,
+    unsigned long long* rem)
+{
+    *high = *low = *rem = 0;
+    for (unsigned i = k + 1; i-- > 0;)
+    {
+        bool carry = *rem >> 63;
+        *rem = (*rem << 1) | (i == k);
+        *high = (*high << 1) | (*low >> 63);
+        *low <<= 1;
+        if (carry || *rem >= d)
+        {
+            *rem -= d;
+            *low |= 1;
+        }
+    }
+}
+
+// finds the smallest k for which (n * m) >> k == n / d for every n below 2^bits, with m = ceil(2^k / d). m can take
+// bits + 1 bits, so it comes back in two words
+static unsigned find_unsigned_magic(unsigned long long d, unsigned bits, unsigned long long* high, unsigned long long* low)
+{
+    for (unsigned k = bits;; ++k)
+    {
+        unsigned long long rem;
+        divide_power_of_two(k, d, high, low, &rem);
+        if (rem && ++*low == 0)
+            ++*high;
+        // the error m * d - 2^k stays below 2^(k - bits) at the latest once 2^(k - bits) >= d
+        if ((rem ? d - rem : 0) <= (1ULL << (k - bits)))
+            return k;
+    }
+}
+
+// the magic number and shift for signed 64-bit division by d > 1, after Hacker's Delight 10-1
+static unsigned find_signed_magic(unsigned long long d, unsigned long long* magic)
+{
+    const unsigned long long two63 = 1ULL << 63;
+    unsigned long long anc = two63 - 1 - two63 % d;
+    unsigned long long q1 = two63 / anc, r1 = two63 - q1 * anc;
+    unsigned long long q2 = two63 / d, r2 = two63 - q2 * d;
+    unsigned p = 63;
+    unsigned long long delta;
+    do
+    {
+        ++p;
+        q1 <<= 1;
+        r1 <<= 1;
+        if (r1 >= anc)
+        {
+            ++q1;
+            r1 -= anc;
+        }
+        q2 <<= 1;
+        r2 <<= 1;
+        if (r2 >= d)
+        {
+            ++q2;
+            r2 -= d;
+        }
+        delta = d - r2;
+    }
+    while (q1 < delta || (q1 == delta && r1 == 0));
+    *magic = q2 + 1;
+    return p - 64;
+}
+
+static c_type_t* make_integer_type(long long size, bool sig)
+{
+    if (size == 8)
+        return air_basic_type(sig ? CTC_LONG_INT : CTC_UNSIGNED_LONG_INT);
+    return air_basic_type(sig ? CTC_INT : CTC_UNSIGNED_INT);
+}
+
+// computes an operation into a new register, before pos. the instruction owns the type
+static regid_t insert_operation(air_t* air, air_insn_t* pos, air_insn_type_t type, c_type_t* ct, air_insn_operand_t* lhs,
+    air_insn_operand_t* rhs)
+{
+    air_insn_t* insn = air_insn_init(type, rhs ? 3 : 2);
+    insn->ct = ct;
+    insn->ops[0] = air_insn_register_operand_init(NEXT_VIRTUAL_REGISTER);
+    insn->ops[1] = lhs;
+    if (rhs)
+        insn->ops[2] = rhs;
+    air_insn_insert_before(insn, pos);
+    return insn->ops[0]->content.reg;
+}
+
+static regid_t insert_extension(air_t* air, air_insn_t* pos, air_insn_type_t type, regid_t reg, c_type_t* from)
+{
+    regid_t result = insert_operation(air, pos, type, make_integer_type(8, type == AIR_SEXT), air_insn_register_operand_init(reg), NULL);
+    pos->prev->ops[1]->ct = air_type(from);
+    return result;
+}
+
+// an instruction of the given size can take a 32-bit immediate, which gets sign-extended. anything wider is loaded
+static air_insn_operand_t* insert_constant(air_t* air, air_insn_t* pos, long long size, unsigned long long value)
+{
+    if (size == 4)
+        value = (unsigned long long) (long long) (int) value;
+    if (fits_int32((long long) value))
+        return air_insn_integer_constant_operand_init(value);
+    regid_t reg = insert_operation(air, pos, AIR_LOAD, make_integer_type(8, true), air_insn_integer_constant_operand_init(value), NULL);
+    return air_insn_register_operand_init(reg);
+}
+
+#define REG(reg) air_insn_register_operand_init(reg)
+#define IMM(value) air_insn_integer_constant_operand_init(value)
+
+// the high half of the unsigned 128-bit product, which a 64-bit mul leaves in %rdx
+static regid_t insert_multiply_high(air_t* air, air_insn_t* pos, regid_t reg, regid_t mreg)
+{
+    air_insn_t* mul = air_insn_init(AIR_MULTIPLY, 3);
+    mul->ct = make_integer_type(8, false);
+    mul->ops[0] = REG(X86R_RAX);
+    mul->ops[1] = REG(reg);
+    mul->ops[2] = REG(mreg);
+    air_insn_insert_before(mul, pos);
+    return insert_operation(air, pos, AIR_LOAD, make_integer_type(8, false), REG(X86R_RDX), NULL);
+}
+
+// replaces what an instruction computes, keeping its result and type
+static void replace_operation(air_insn_t* insn, air_insn_type_t type, air_insn_operand_t* lhs, air_insn_operand_t* rhs)
+{
+    for (size_t i = 1; i < insn->noops; ++i)
+    {
+        air_insn_operand_delete(insn->ops[i]);
+        insn->ops[i] = NULL;
+    }
+    insn->type = type;
+    insn->ops[1] = lhs;
+    insn->ops[2] = rhs;
+    insn->noops = rhs ? 3 : 2;
+}
+
+static bool reduce_multiply(air_t* air, air_insn_t* insn, regid_t reg, unsigned long long c)
+{
+    long long size = type_size(insn->ct);
+    int bits = size * 8;
+    if (size == 4)
+        c &= 0xFFFFFFFFULL;
+    int k = exact_log2(c);
+    if (k > 0)
+    {
+        replace_operation(insn, AIR_SHIFT_LEFT, REG(reg), IMM(k));
+        return true;
+    }
+    static const unsigned long long leas[] = { 3, 5, 9 };
+    for (size_t i = 0; i < sizeof(leas) / sizeof(leas[0]); ++i)
+    {
+        if (c % leas[i] || (k = exact_log2(c / leas[i])) <= 0)
+            continue;
+        regid_t t = insert_operation(air, insn, AIR_MULTIPLY, air_type(insn->ct), REG(reg), IMM(leas[i]));
+        replace_operation(insn, AIR_SHIFT_LEFT, REG(t), IMM(k));
+        return true;
+    }
+    // the two below 3 and 9 are lea already
+    if ((k = exact_log2(c + 1)) >= 3 && k < bits)
+    {
+        regid_t t = insert_operation(air, insn, AIR_SHIFT_LEFT, air_type(insn->ct), REG(reg), IMM(k));
+        replace_operation(insn, AIR_SUBTRACT, REG(t), REG(reg));
+        return true;
+    }
+    if ((k = exact_log2(c - 1)) >= 4)
+    {
+        regid_t t = insert_operation(air, insn, AIR_SHIFT_LEFT, air_type(insn->ct), REG(reg), IMM(k));
+        replace_operation(insn, AIR_ADD, REG(t), REG(reg));
+        return true;
+    }
+    return false;
+}
+
+// the quotient of an unsigned division by a constant that isn't a power of two, in a 64-bit register
+static regid_t insert_unsigned_quotient(air_t* air, air_insn_t* pos, regid_t reg, unsigned long long d, long long size)
+{
+    unsigned long long high, m;
+    if (size == 4)
+    {
+        unsigned k = find_unsigned_magic(d, 32, &high, &m);
+        regid_t z = insert_extension(air, pos, AIR_ZEXT, reg, pos->ct);
+        if (m < (1ULL << 32))
+        {
+            regid_t p = insert_operation(air, pos, AIR_MULTIPLY, make_integer_type(8, true), REG(z), insert_constant(air, pos, 8, m));
+            return insert_operation(air, pos, AIR_SHIFT_RIGHT, make_integer_type(8, false), REG(p), IMM(k));
+        }
+        // a 33-bit m would overflow the product, so its top bit gets added in separately
+        regid_t p = insert_operation(air, pos, AIR_MULTIPLY, make_integer_type(8, true), REG(z), insert_constant(air, pos, 8, m - (1ULL << 32)));
+        regid_t t = insert_operation(air, pos, AIR_SHIFT_RIGHT, make_integer_type(8, false), REG(p), IMM(32));
+        regid_t u = insert_operation(air, pos, AIR_ADD, make_integer_type(8, false), REG(z), REG(t));
+        return k > 32 ? insert_operation(air, pos, AIR_SHIFT_RIGHT, make_integer_type(8, false), REG(u), IMM(k - 32)) : u;
+    }
+    unsigned k = find_unsigned_magic(d, 64, &high, &m);
+    regid_t mreg = insert_operation(air, pos, AIR_LOAD, make_integer_type(8, false), IMM(m), NULL);
+    regid_t h = insert_multiply_high(air, pos, reg, mreg);
+    if (!high)
+        return k > 64 ? insert_operation(air, pos, AIR_SHIFT_RIGHT, make_integer_type(8, false), REG(h), IMM(k - 64)) : h;
+    // and for a 65-bit m, (n + h) / 2 without overflowing
+    regid_t t = insert_operation(air, pos, AIR_SUBTRACT, make_integer_type(8, false), REG(reg), REG(h));
+    t = insert_operation(air, pos, AIR_SHIFT_RIGHT, make_integer_type(8, false), REG(t), IMM(1));
+    t = insert_operation(air, pos, AIR_ADD, make_integer_type(8, false), REG(t), REG(h));
+    return k > 65 ? insert_operation(air, pos, AIR_SHIFT_RIGHT, make_integer_type(8, false), REG(t), IMM(k - 65)) : t;
+}
+
+// the quotient of a signed division by a positive constant that isn't a power of two
+static regid_t insert_signed_quotient(air_t* air, air_insn_t* pos, regid_t reg, unsigned long long d, long long size)
+{
+    if (size == 4)
+    {
+        // with m = ceil(2^(31 + l) / d) for 2^l >= d, (n * m) >> (31 + l) is n / d rounded down, which is one
+        // short of rounding toward zero for negative n
+        unsigned k = 31 + ceil_log2(d);
+        unsigned long long high, m, rem;
+        divide_power_of_two(k, d, &high, &m, &rem);
+        m += rem != 0;
+        regid_t z = insert_extension(air, pos, AIR_SEXT, reg, pos->ct);
+        regid_t p = insert_operation(air, pos, AIR_MULTIPLY, make_integer_type(8, true), REG(z), insert_constant(air, pos, 8, m));
+        regid_t t = insert_operation(air, pos, AIR_SIGNED_SHIFT_RIGHT, make_integer_type(8, true), REG(p), IMM(k));
+        t = insert_operation(air, pos, AIR_LOAD, make_integer_type(4, true), REG(t), NULL);
+        regid_t sign = insert_operation(air, pos, AIR_SIGNED_SHIFT_RIGHT, make_integer_type(4, true), REG(reg), IMM(31));
+        return insert_operation(air, pos, AIR_SUBTRACT, make_integer_type(4, true), REG(t), REG(sign));
+    }
+    unsigned long long m;
+    unsigned s = find_signed_magic(d, &m);
+    regid_t mreg = insert_operation(air, pos, AIR_LOAD, make_integer_type(8, true), IMM(m), NULL);
+    regid_t h = insert_multiply_high(air, pos, reg, mreg);
+    // the signed high half is the unsigned one less m for negative n, and less n for negative m. a negative m
+    // also needs n added back, which cancels the latter
+    regid_t sign = insert_operation(air, pos, AIR_SIGNED_SHIFT_RIGHT, make_integer_type(8, true), REG(reg), IMM(63));
+    regid_t a = insert_operation(air, pos, AIR_AND, make_integer_type(8, true), REG(sign), REG(mreg));
+    regid_t t = insert_operation(air, pos, AIR_SUBTRACT, make_integer_type(8, true), REG(h), REG(a));
+    if (s)
+        t = insert_operation(air, pos, AIR_SIGNED_SHIFT_RIGHT, make_integer_type(8, true), REG(t), IMM(s));
+    regid_t u = insert_operation(air, pos, AIR_SHIFT_RIGHT, make_integer_type(8, true), REG(reg), IMM(63));
+    return insert_operation(air, pos, AIR_ADD, make_integer_type(8, true), REG(t), REG(u));
+}
+
+static bool reduce_divide(air_t* air, air_insn_t* insn, regid_t reg, unsigned long long c)
+{
+    bool modulo = insn->type == AIR_MODULO;
+    long long size = type_size(insn->ct);
+    int bits = size * 8;
+    bool sig = type_is_signed_integer(insn->ct);
+    bool negative = false;
+    unsigned long long d = size == 4 ? c & 0xFFFFFFFFULL : c;
+    if (sig)
+    {
+        long long value = size == 4 ? (long long) (int) c : (long long) c;
+        negative = value < 0;
+        d = negative ? -(unsigned long long) value : (unsigned long long) value;
+    }
+    // the most negative divisor and unsigned ones with the top bit set are rare, and idiv is fine for them
+    if (!d || d >= (1ULL << (bits - 1)))
+        return false;
+
+    if (d == 1)
+    {
+        if (modulo)
+            replace_operation(insn, AIR_LOAD, IMM(0), NULL);
+        else
+            replace_operation(insn, negative ? AIR_NEGATE : AIR_LOAD, REG(reg), NULL);
+        return true;
+    }
+
+    int k = exact_log2(d);
+    if (k > 0 && !sig)
+    {
+        if (modulo)
+            replace_operation(insn, AIR_AND, REG(reg), insert_constant(air, insn, size, d - 1));
+        else
+            replace_operation(insn, AIR_SHIFT_RIGHT, REG(reg), IMM(k));
+        return true;
+    }
+    if (k > 0)
+    {
+        // 2^k - 1 for negative dividends, 0 otherwise
+        regid_t bias = reg;
+        if (k > 1)
+            bias = insert_operation(air, insn, AIR_SIGNED_SHIFT_RIGHT, air_type(insn->ct), REG(reg), IMM(bits - 1));
+        bias = insert_operation(air, insn, AIR_SHIFT_RIGHT, air_type(insn->ct), REG(bias), IMM(bits - k));
+        regid_t t = insert_operation(air, insn, AIR_ADD, air_type(insn->ct), REG(reg), REG(bias));
+        if (modulo)
+        {
+            regid_t rounded = insert_operation(air, insn, AIR_AND, air_type(insn->ct), REG(t), insert_constant(air, insn, size, -d));
+            replace_operation(insn, AIR_SUBTRACT, REG(reg), REG(rounded));
+        }
+        else if (negative)
+        {
+            regid_t q = insert_operation(air, insn, AIR_SIGNED_SHIFT_RIGHT, air_type(insn->ct), REG(t), IMM(k));
+            replace_operation(insn, AIR_NEGATE, REG(q), NULL);
+        }
+        else
+            replace_operation(insn, AIR_SIGNED_SHIFT_RIGHT, REG(t), IMM(k));
+        return true;
+    }
+
+    regid_t q = sig ? insert_signed_quotient(air, insn, reg, d, size) : insert_unsigned_quotient(air, insn, reg, d, size);
+    if (modulo)
+    {
+        // a remainder takes the dividend's sign whatever the divisor's
+        q = insert_operation(air, insn, AIR_LOAD, air_type(insn->ct), REG(q), NULL);
+        regid_t p = insert_operation(air, insn, AIR_MULTIPLY, make_integer_type(size, true), REG(q), insert_constant(air, insn, size, d));
+        reduce_multiply(air, insn->prev, q, d);
+        replace_operation(insn, AIR_SUBTRACT, REG(reg), REG(p));
+    }
+    else
+        replace_operation(insn, negative ? AIR_NEGATE : AIR_LOAD, REG(q), NULL);
+    return true;
+}
+
+#undef REG
+#undef IMM
+
+static void localize_x86_64_reduce_strength(air_routine_t* routine, air_t* air)
+{
+    air_defuse_t* du = air_defuse_init(routine);
+    for (air_insn_t* insn = routine->insns; insn; insn = insn->next)
+    {
+        if (insn->type != AIR_MULTIPLY && insn->type != AIR_DIVIDE && insn->type != AIR_MODULO)
+            continue;
+        if (!insn->ct || !type_is_integer(insn->ct) || (type_size(insn->ct) != 4 && type_size(insn->ct) != 8))
+            continue;
+        if (insn->ops[0]->type != AOP_REGISTER)
+            continue;
+        regid_t reg = INVALID_VREGID;
+        long long c;
+        if (insn->type == AIR_MULTIPLY)
+        {
+            if (!find_register_and_constant(du, insn, &reg, &c))
+                continue;
+        }
+        else if (insn->ops[1]->type != AOP_REGISTER || !find_constant(du, insn, insn->ops[2], &c))
+            continue;
+        else
+            reg = insn->ops[1]->content.reg;
+        // the sequences read the operand more than once, and some of them go through %rax and %rdx
+        if (reg <= NO_PHYSICAL_REGISTERS)
+            continue;
+        if (insn->type == AIR_MULTIPLY)
+            reduce_multiply(air, insn, reg, c);
+        else
+            reduce_divide(air, insn, reg, c);
+    }
+    air_defuse_delete(du);
+}
+
+/*
 
-            for (int i = 0; i < insn->noops; ++i)
+int _3 = _1 + _2;
+int _4 = _1 * _3;
+
+becomes:
+
+int _5 = _1;
+int _3 = _5 + _2;
+int _4 = _1 * _3;
+
+x86 arithmetic overwrites its first operand, so the code for these ends up computing into the register of
+their first operand and moving it into the result from there. that's only fine if nothing reads the first
+operand afterwards, which holds for the temporaries made for a single expression, but not for ones that
+optimization has made shared between several, or that live across a loop. those get a copy to compute into,
+which the allocator can fold into the result's register when nothing else needs it.
+
+*/
+static void localize_x86_64_preserve_first_operand(air_insn_t* insn, air_cfg_t* cfg, air_defuse_t* du, air_t* air)
+{
+    switch (insn->type)
+    {
+        case AIR_ADD:
+        case AIR_SUBTRACT:
+        case AIR_AND:
+        case AIR_OR:
+        case AIR_XOR:
+        case AIR_SHIFT_LEFT:
+        case AIR_SHIFT_RIGHT:
+        case AIR_SIGNED_SHIFT_RIGHT:
+        case AIR_NEGATE:
+        case AIR_COMPLEMENT:
+            break;
+        case AIR_MULTIPLY:
+            // unsigned multiplication goes through %rax already
+            if (type_is_unsigned_integer(insn->ct) || insn->ct->class == CTC_POINTER)
+                return;
+            break;
+        case AIR_DIVIDE:
+            // and so does integer division
+            if (!type_is_sse_floating(insn->ct) && !type_is_vector(insn->ct))
+                return;
+            break;
+        default:
+            return;
+    }
+    air_insn_operand_t* op = insn->ops[1];
+    if (op->type != AOP_REGISTER || op->content.reg <= NO_PHYSICAL_REGISTERS)
+        return;
+    regid_t reg = op->content.reg;
+    vector_t* uses = air_defuse_uses(du, reg);
+    air_insn_t* def = air_defuse_definition(du, reg);
+    air_block_t* block = air_cfg_block(cfg, insn);
+    if (uses && uses->size == 1 && def && block && air_cfg_block(cfg, def) == block)
+        return;
+
+    regid_t copyreg = NEXT_VIRTUAL_REGISTER;
+    air_insn_t* copy = air_insn_init(AIR_LOAD, 2);
+    copy->ct = op->ct ? type_copy(op->ct) : type_copy(insn->ct);
+    copy->ops[0] = air_insn_register_operand_init(copyreg);
+    copy->ops[1] = air_insn_operand_copy(op);
+    air_insn_insert_before(copy, insn);
+    op->content.reg = copyreg;
+}
+
+static void localize_x86_64(air_routine_t* routine, air_t* air)
+{
+    localize_x86_64_routine_before(routine, air);
+    air_routine_invalidate_cfg(routine);
+    localize_x86_64_reduce_strength(routine, air);
+    localize_x86_64_select_addresses(routine, air);
+    air_cfg_t* cfg = air_routine_cfg(routine);
+    air_defuse_t* du = air_defuse_init(routine);
+    vector_t* marshalled = vector_init();
+    routine->outgoing = 0;
+    for (air_insn_t* insn = routine->insns; insn; insn = insn->next)
+    {
+        localize_x86_64_preserve_first_operand(insn, cfg, du, air);
+        switch (insn->type)
+        {
+            case AIR_FUNC_CALL:
+                localize_x86_64_func_call(insn, routine, air, marshalled);
+                break;
+            case AIR_RETURN:
+                localize_x86_64_return(insn, routine, air);
+                break;
+            case AIR_DIVIDE:
+            case AIR_MODULO:
+                localize_x86_64_divide_modulo(insn, routine, air);
+                break;
+            case AIR_DIRECT_DIVIDE:
+            case AIR_DIRECT_MODULO:
+                localize_x86_64_direct_divide_modulo(insn, routine, air);
+                break;
+            case AIR_ADD:
+            case AIR_SUBTRACT:
+                localize_x86_64_add_subtract(insn, routine, air);
+                break;
+            case AIR_DIRECT_ADD:
+            case AIR_DIRECT_SUBTRACT:
+                if (insn->ct->class == CTC_FLOAT || insn->ct->class == CTC_DOUBLE)
+                    localize_x86_64_direct_to_register(insn, routine, air);
+                break;
+            case AIR_MULTIPLY:
+                localize_x86_64_multiply(insn, routine, air);
+                break;
+            case AIR_DIRECT_MULTIPLY:
+                localize_x86_64_direct_multiply(insn, routine, air);
+                break;
+            case AIR_VA_START:
+                insn = localize_x86_64_va_start(insn, routine, air);
+                break;
+            case AIR_VA_ARG:
+                insn = localize_x86_64_va_arg(insn, routine, air);
+                break;
+            case AIR_VA_END:
+                insn = localize_x86_64_va_end(insn, routine, air);
+                break;
+            case AIR_SHIFT_LEFT:
+            case AIR_SHIFT_RIGHT:
+            case AIR_SIGNED_SHIFT_RIGHT:
+                localize_x86_64_shift(insn, routine, air, 2);
+                break;
+            case AIR_DIRECT_SHIFT_LEFT:
+            case AIR_DIRECT_SHIFT_RIGHT:
+            case AIR_DIRECT_SIGNED_SHIFT_RIGHT:
+                localize_x86_64_shift(insn, routine, air, 1);
+                break;
+            case AIR_LESS_EQUAL:
+            case AIR_LESS:
+            case AIR_GREATER_EQUAL:
+            case AIR_GREATER:
+            case AIR_EQUAL:
+            case AIR_INEQUAL:
+            case AIR_NOT:
+                localize_x86_64_setcc_comparison(insn, routine, air, du);
+                break;
+            case AIR_NEGATE:
+                insn = localize_x86_64_negate(insn, routine, air);
+                break;
+            case AIR_MEMSET:
+                insn = localize_x86_64_memset(insn, routine, air);
+                break;
+            case AIR_ASSIGN:
+                localize_x86_64_assign(insn, routine, air);
+                break;
+            case AIR_LSYSCALL:
+                localize_x86_64_lsyscall(insn, routine, air);
+                break;
+            case AIR_JMP_TABLE:
+                localize_x86_64_jmp_table(insn, routine, air);
+                break;
+            default:
+                break;
+        }
+    }
+    air_defuse_delete(du);
+    localize_x86_64_marshal_directly(routine, marshalled);
+    vector_delete(marshalled);
+    air_routine_invalidate_cfg(routine);
+}
+
+// follows a register through the phis it's merged into, since a phi's result can itself feed another phi
+static regid_t find_phi_destination(map_t* map, regid_t reg)
+{
+    for (size_t guard = map->size; guard; --guard)
+    {
+        regid_t alt = (regid_t) map_get(map, (void*) reg);
+        if (alt == INVALID_VREGID || alt == reg)
+            break;
+        reg = alt;
+    }
+    return reg;
+}
+
+// registers are numbered across the whole AIR, so a routine's phis only ever merge its own registers
+static void remove_phi_instructions(air_routine_t* routine)
+{
+    map_t* map = map_init((comparator_t) regid_comparator, (hash_function_t) regid_hash);
+
+    // every phi is collected before renaming, otherwise a use seen before the phi that merges it
+    // further would be left pointing at a register nothing defines anymore
+    for (air_insn_t* insn = routine->insns; insn; insn = insn->next)
+    {
+        if (insn->type != AIR_PHI)
+            continue;
+        air_insn_operand_t* op1 = insn->ops[0];
+        if (!op1 || op1->type != AOP_REGISTER) report_return;
+        regid_t reg = op1->content.reg;
+
+        for (int i = 1; i < insn->noops; ++i)
+        {
+            air_insn_operand_t* op = insn->ops[i];
+            if (!op || op->type != AOP_REGISTER) report_return;
+            regid_t opreg = op->content.reg;
+
+            if (find_phi_destination(map, reg) != opreg)
+                map_add(map, (void*) opreg, (void*) reg);
+        }
+    }
+
+    for (air_insn_t* insn = routine->insns; insn;)
+    {
+        if (insn->type == AIR_PHI)
+        {
+            air_insn_t* next = insn->next;
+            air_insn_remove(insn);
+            insn = next;
+            continue;
+        }
+
+        for (int i = 0; i < insn->noops; ++i)
+        {
+            air_insn_operand_t* op = insn->ops[i];
+            if (!op) continue;
+
+            if (op->type == AOP_REGISTER)
+                op->content.reg = find_phi_destination(map, op->content.reg);
+            else if (op->type == AOP_INDIRECT_REGISTER)
             {
-                air_insn_operand_t* op = insn->ops[i];
-                if (!op) continue;
-
-                regid_t reg = INVALID_VREGID;
-                if (op->type == AOP_REGISTER)
-                    reg = op->content.reg;
-                else if (op->type == AOP_INDIRECT_REGISTER)
-                    reg = op->content.inreg.id;
-                else
-                    continue;
-                
-                regid_t alt = (regid_t) map_get(map, (void*) reg);
-                if (alt == INVALID_VREGID)
-                    continue;
-                
-                if (op->type == AOP_REGISTER)
-                    op->content.reg = alt;
-                else if (op->type == AOP_INDIRECT_REGISTER)
-                    op->content.inreg.id = alt;
+                op->content.inreg.id = find_phi_destination(map, op->content.inreg.id);
+                op->content.inreg.roffset = find_phi_destination(map, op->content.inreg.roffset);
             }
-
-            insn = insn->prev;
         }
+
+        insn = insn->next;
     }
 
     map_delete(map);
 }
 
-// "localize" an AIR instance to a particular architecture
-void localize(air_t* air, air_locale_t locale)
+// "localize" one routine of an AIR instance to a particular architecture
+void localize_routine(air_t* air, air_routine_t* routine, air_locale_t locale)
 {
-    remove_phi_instructions(air);
+    air_routine_t* previous = air_lower(air, routine);
 
-    air->locale = locale;
+    // localization rewrites the routine wholesale
+    air_routine_invalidate_cfg(routine);
+
+    remove_phi_instructions(routine);
+
+    // routines being localized on other threads read it
+    if (air->locale != locale)
+        air->locale = locale;
     switch (locale)
     {
         case LOC_X86_64:
-            localize_x86_64(air);
+            localize_x86_64(routine, air);
             break;
         default:
+            air_lower(air, previous);
             report_return;
     }
+
+    air_lower(air, previous);
+}
+
+static void define_sse_negater(air_t* air, symbol_t* negater, bool is_float)
+{
+    air_data_t* data = calloc(1, sizeof *data);
+    data->readonly = true;
+    data->sy = negater;
+    if (is_float)
+    {
+        data->data = malloc(FLOAT_WIDTH);
+        *((unsigned*) (data->data)) = 0x80000000;
+    }
+    else
+    {
+        data->data = malloc(DOUBLE_WIDTH);
+        *((unsigned long long*) (data->data)) = 0x8000000000000000;
+    }
+    vector_add(air->rodata, data);
+}
+
+// defines the constants localized routines refer to, once every routine is localized. they go in the same place
+// whichever routine happened to need them first
+void localize_constants(air_t* air)
+{
+    if (air->sse32_negater)
+        define_sse_negater(air, air->sse32_negater, true);
+    if (air->sse64_negater)
+        define_sse_negater(air, air->sse64_negater, false);
+}
+
+// "localize" an AIR instance to a particular architecture
+void localize(air_t* air, air_locale_t locale)
+{
+    air->locale = locale;
+    VECTOR_FOR(air_routine_t*, routine, air->routines)
+        localize_routine(air, routine, locale);
+    localize_constants(air);
 }
 
 /*
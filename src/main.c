@@ -26,6 +26,7 @@ STD C TRANSLATION PHASES -> FUNCTIONS IN THIS PROJECT:
 #include "ecc.h"
 
 #define OPTION_DESCRIPTION_LENGTH 12
+#define ASSEMBLY_BUFFER_SIZE (1 << 20)
 
 char* PROGRAM_NAME = NULL;
 program_options_t opts;
@@ -47,9 +48,26 @@ int usage(void)
     printf("Usage: ecc [options] file...\n");
     printf("Options:\n");
     printf("  %-*sDisplay this help message\n", OPTION_DESCRIPTION_LENGTH, "-h");
-    printf("  %-*sSet output filepath\n", OPTION_DESCRIPTION_LENGTH, "-o");
+    printf("  %-*sSet output filepath, with - writing assembly to stdout\n", OPTION_DESCRIPTION_LENGTH, "-o");
     printf("  %-*sCompile, but do not assemble or link\n", OPTION_DESCRIPTION_LENGTH, "-S");
     printf("  %-*sCompile and assemble, but do not link\n", OPTION_DESCRIPTION_LENGTH, "-c");
+    printf("  %-*sWrite object files directly instead of running the assembler\n", OPTION_DESCRIPTION_LENGTH, "-e");
+    printf("  %-*sPrecompile a header\n", OPTION_DESCRIPTION_LENGTH, "-H");
+    printf("  %-*sUse a precompiled header as the prefix of each file\n", OPTION_DESCRIPTION_LENGTH, "-u <pch>");
+    printf("  %-*sCompile up to n files or functions at once\n", OPTION_DESCRIPTION_LENGTH, "-j <n>");
+    printf("  %-*sCache output in a directory, reusing it for files that preprocess the same\n", OPTION_DESCRIPTION_LENGTH, "-C <dir>");
+    printf("  %-*sServe compilations on a Unix socket, keeping headers warm between them\n", OPTION_DESCRIPTION_LENGTH, "-s <sock>");
+    printf("  %-*sHave the server on a socket compile, if it's running\n", OPTION_DESCRIPTION_LENGTH, "-w <sock>");
+    printf("  %-*sWrite a make rule for the headers a file includes instead of compiling\n", OPTION_DESCRIPTION_LENGTH, "-M");
+    printf("  %-*sThe same, leaving out system headers\n", OPTION_DESCRIPTION_LENGTH, "-MM");
+    printf("  %-*sWrite the rule to a .d file next to the output while compiling\n", OPTION_DESCRIPTION_LENGTH, "-MD");
+    printf("  %-*sThe same, leaving out system headers\n", OPTION_DESCRIPTION_LENGTH, "-MMD");
+    printf("  %-*sWrite the rule to a file\n", OPTION_DESCRIPTION_LENGTH, "-MF <file>");
+    printf("  %-*sOptimize: not at all, lightly, fully (the default), or for size\n", OPTION_DESCRIPTION_LENGTH, "-O<0|1|2|s>");
+    printf("  %-*sCompile the files into one program before linking, optimizing across them\n", OPTION_DESCRIPTION_LENGTH, "-W");
+    printf("  %-*sOmit the frame pointer and allocate %%rbp\n", OPTION_DESCRIPTION_LENGTH, "-F");
+    printf("  %-*sCount branches, writing ecc.profile when the program exits\n", OPTION_DESCRIPTION_LENGTH, "-b");
+    printf("  %-*sLay out blocks using the branch counts in a profile\n", OPTION_DESCRIPTION_LENGTH, "-B <prof>");
     printf("  %-*sDisplay internal states (tokens, IRs, etc.)\n", OPTION_DESCRIPTION_LENGTH, "-i");
     printf("  %-*sPreprocess\n", OPTION_DESCRIPTION_LENGTH, "-P");
     printf("  %-*sParse\n", OPTION_DESCRIPTION_LENGTH, "-p");
@@ -57,22 +75,230 @@ int usage(void)
     printf("  %-*sAIR\n", OPTION_DESCRIPTION_LENGTH, "-A");
     printf("  %-*sLocalized AIR\n", OPTION_DESCRIPTION_LENGTH, "-L");
     printf("  %-*sRegister-allocated AIR\n", OPTION_DESCRIPTION_LENGTH, "-r");
+    printf("  %-*sReport the time and memory each phase takes\n", OPTION_DESCRIPTION_LENGTH, "-t");
+    printf("  %-*sAppend the report to a file as JSON, a line per file compiled\n", OPTION_DESCRIPTION_LENGTH, "-T <file>");
     printf("  %-*sBleeding edge work, if any (warning: very unstable)\n", OPTION_DESCRIPTION_LENGTH, "-x");
     return EXIT_FAILURE;
 }
 
-x86_asm_file_t* compile_object(char* filename)
+// one translation unit going through the back end, a routine at a time
+typedef struct backend
 {
+    compilation_t* c;
+    air_t* air;
+    x86_asm_file_t* asmfile;
+    x86_asm_routine_t** generated; // by routine, from when it's lowered until it's emitted
+} backend_t;
+
+// lowers a routine, maybe on another thread
+static void backend_lower(size_t index, void* context)
+{
+    backend_t* b = context;
+    compilation_t* c = b->c;
+    air_t* air = b->air;
+    air_routine_t* routine = vector_get(air->routines, index);
+
+    stats_mark_t mark = stats_begin();
+    localize_routine(air, routine, LOC_X86_64);
+    stats_end(PHASE_LOCALIZE, &mark);
+
+    if (c->options->iflag)
+    {
+        printf("<<AIR (x86-localized)>>\n");
+        air_routine_print(routine, air, printf);
+    }
+
+    if (c->options->llflag)
+        return;
+
+    mark = stats_begin();
+    allocate_routine(routine, air);
+    stats_end(PHASE_ALLOCATE, &mark);
+
+    if (c->options->iflag)
+    {
+        printf("<<AIR (register-allocated)>>\n");
+        air_routine_print(routine, air, printf);
+    }
+
+    if (c->options->rflag)
+        return;
+
+    mark = stats_begin();
+    x86_asm_routine_t* aroutine = x86_generate_routine(routine, index + 1, b->asmfile);
+    air_routine_release(routine);
+    stats_end(PHASE_GENERATE, &mark);
+
+    mark = stats_begin();
+    opt4_routine(aroutine, b->asmfile, opt4_profile(c->options->olevel));
+    stats_end(PHASE_OPT4, &mark);
+
+    if (stats_enabled())
+    {
+        uint64_t count = 0;
+        for (x86_insn_t* insn = aroutine->insns; insn; insn = insn->next)
+            count += insn->type != X86I_LABEL;
+        stats_count(COUNTER_X86_INSNS, count);
+    }
+
+    if (c->options->iflag)
+    {
+        printf("<<x86 assembly code>>\n");
+        x86_write_routine(aroutine, stdout);
+    }
+
+    b->generated[index] = aroutine;
+}
+
+// hands a lowered routine to the output, in order
+static void backend_emit(size_t index, void* context)
+{
+    backend_t* b = context;
+    x86_asm_routine_t* aroutine = b->generated[index];
+    b->generated[index] = NULL;
+    if (!aroutine)
+        return;
+    // routines already encoded are gone, so once one can't be there's no point to the rest
+    if (b->c->unencodable)
+    {
+        x86_asm_routine_delete(aroutine);
+        return;
+    }
+    // encoding interns labels, and so does lowering
+    bool encoding = b->asmfile->object_stream;
+    stats_mark_t mark = stats_begin();
+    if (encoding)
+        pool_lock();
+    if (!x86_asm_file_add_routine(b->asmfile, aroutine))
+        b->c->unencodable = true;
+    if (encoding)
+        pool_unlock();
+    stats_end(PHASE_EMIT, &mark);
+}
+
+// for the report, which counts instructions but not labels
+static uint64_t count_air_insns(air_t* air)
+{
+    uint64_t count = 0;
+    VECTOR_FOR(air_routine_t*, routine, air->routines)
+    {
+        for (air_insn_t* insn = routine->insns; insn; insn = insn->next)
+            count += insn->type != AIR_LABEL;
+    }
+    return count;
+}
+
+// whether a header was found in one of the directories <...> is searched for in
+static bool is_system_header(char* path)
+{
+    char* resolved = include_cache_key(path);
+    bool system = false;
+    for (int i = 0; i < sizeof(ANGLED_INCLUDE_SEARCH_DIRECTORIES) / sizeof(ANGLED_INCLUDE_SEARCH_DIRECTORIES[0]) && !system; ++i)
+    {
+        if (!ANGLED_INCLUDE_SEARCH_DIRECTORIES[i])
+            continue;
+        char* dir = include_cache_key((char*) ANGLED_INCLUDE_SEARCH_DIRECTORIES[i]);
+        size_t length = strlen(dir);
+        system = !strncmp(resolved, dir, length) && resolved[length] == '/';
+        free(dir);
+    }
+    free(resolved);
+    return system;
+}
+
+// writes a path the way make reads it, relative to where ecc runs if it's under it
+static void write_make_path(FILE* file, char* path, char* cwd)
+{
+    size_t length = strlen(cwd);
+    if (!strncmp(path, cwd, length) && path[length] == '/')
+        path += length + 1;
+    for (; *path; ++path)
+    {
+        if (*path == ' ' || *path == '#')
+            fputc('\\', file);
+        else if (*path == '$')
+            fputc('$', file);
+        fputc(*path, file);
+    }
+}
+
+// the make rule -M and -MD write: the output (or the object it would be) depends on the file and what it included
+static bool write_dependencies(compilation_t* c, vector_t* dependencies)
+{
+    program_options_t* o = c->options;
+    bool output = !o->mflag && (o->cflag || o->ssflag) && c->cache_target;
+    char* target = output ? strdup(c->cache_target) : replace_extension(c->filepath, ".o");
+    char* path = NULL;
+    if (o->mfflag)
+        path = strdup(o->mfflag);
+    else if (o->mflag)
+        path = o->oflag ? strdup(o->oflag) : NULL;
+    else
+        path = replace_extension(target, ".d");
+
+    FILE* file = path ? fopen(path, "w") : stdout;
+    if (!file)
+    {
+        errorf("could not write dependencies to '%s'\n", path);
+        free(target);
+        free(path);
+        return false;
+    }
+
+    char cwd[LINUX_MAX_PATH_LENGTH];
+    if (!getcwd(cwd, sizeof cwd))
+        cwd[0] = '\0';
+    write_make_path(file, target, cwd);
+    fputs(":", file);
+    char* prerequisites[] = { c->filepath, o->uflag };
+    for (int i = 0; i < sizeof(prerequisites) / sizeof(prerequisites[0]); ++i)
+    {
+        if (!prerequisites[i])
+            continue;
+        fputs(" ", file);
+        write_make_path(file, prerequisites[i], cwd);
+    }
+    VECTOR_FOR(char*, dependency, dependencies)
+    {
+        if (o->mmflag && is_system_header(dependency))
+            continue;
+        fputs(" \\\n  ", file);
+        write_make_path(file, dependency, cwd);
+    }
+    fputs("\n", file);
+
+    bool success = path ? !fclose(file) : !fflush(file);
+    if (!success)
+        errorf("could not write dependencies to '%s'\n", path ? path : "standard output");
+    free(target);
+    free(path);
+    return success;
+}
+
+// whether the output can come from the cache, which it can't when anything but the output was asked for
+static bool cacheable(compilation_t* c)
+{
+    program_options_t* o = c->options;
+    return o->ccflag && c->cache_target && !o->iflag && !o->pflag && !o->aflag && !o->aaflag && !o->llflag && !o->rflag;
+}
+
+// reads, preprocesses, and analyzes a file into AIR, handing back the syntax tree the AIR was made from. returns
+// NULL if the file doesn't get that far, or the options stop it before
+static air_t* compile_air(compilation_t* c, syntax_component_t** unit)
+{
+    char* filename = c->filepath;
     FILE* file = fopen(filename, "r");
     if (!file)
     {
         errorf("file '%s' not found\n", filename);
         return NULL;
     }
+    stats_mark_t mark = stats_begin();
     preprocessing_token_t* tokens = lex(file, true);
+    stats_end(PHASE_LEX, &mark);
     if (!tokens) return NULL;
 
-    if (opts.iflag)
+    if (c->options->iflag)
     {
         printf("<<lexer output>>\n");
         for (preprocessing_token_t* token = tokens; token; token = token->next)
@@ -82,85 +308,160 @@ x86_asm_file_t* compile_object(char* filename)
         }
     }
 
-    time_t t = time(NULL);
+    c->translation_time = time(NULL);
 
     preprocessing_settings_t settings;
-    settings.translation_time = &t;
+    settings.translation_time = &c->translation_time;
     settings.filepath = filename;
-    char pp_error[MAX_ERROR_LENGTH];
-    settings.error = pp_error;
+    settings.error = c->error;
     settings.error[0] = '\0';
+    settings.options = c->options;
     settings.table = NULL;
+    settings.dependencies = c->options->mflag || c->options->mdflag ? vector_init() : NULL;
+    // a server keeps the headers it's seen lexed for every compilation it runs, see server.c
+    map_t* warm_includes = server_include_cache();
+    settings.include_cache = warm_includes;
+
+    // the precompiled header stands in for everything it was built from, so only the rest of the file is preprocessed
+    preprocessing_token_t* pch_tokens = NULL;
+    if (c->options->uflag &&
+        !server_pch(c->options->uflag, &settings.table, &settings.include_cache, &pch_tokens) &&
+        !pch_read(c->options->uflag, &settings.table, &settings.include_cache, &pch_tokens))
+    {
+        errorf("could not read precompiled header '%s'\n", c->options->uflag);
+        if (settings.dependencies)
+            vector_deep_delete(settings.dependencies, free);
+        pp_token_delete_all(tokens);
+        return NULL;
+    }
 
-    if (!preprocess(&tokens, &settings))
+    mark = stats_begin();
+    bool preprocessed = preprocess(&tokens, &settings);
+    preprocessing_table_delete(settings.table);
+    if (settings.include_cache == warm_includes)
+        server_learn_includes(warm_includes);
+    else
+        map_delete(settings.include_cache);
+    stats_end(PHASE_PREPROCESS, &mark);
+    if (settings.dependencies)
+    {
+        c->dependencies_written = preprocessed && write_dependencies(c, settings.dependencies);
+        vector_deep_delete(settings.dependencies, free);
+        preprocessed = preprocessed && c->dependencies_written;
+    }
+    if (!preprocessed)
     {
         printf("%s", settings.error);
+        pp_token_delete_all(pch_tokens);
         return NULL;
     }
 
-    if (opts.ppflag)
+    if (pch_tokens)
+    {
+        preprocessing_token_t* last = pch_tokens;
+        for (; last->next; last = last->next);
+        last->next = tokens;
+        if (tokens)
+            tokens->prev = last;
+        tokens = pch_tokens;
+    }
+
+    if (c->options->ppflag || c->options->mflag)
     {
         pp_token_delete_all(tokens);
         return NULL;
     }
 
+    // everything from here on only depends on the tokens, so what it made of them last time can stand in for it
+    if (cacheable(c))
+    {
+        c->cache_key = cache_key(c, tokens);
+        if (c->cache_key && cache_fetch(c->options->ccflag, c->cache_key, c->cache_target))
+        {
+            c->cache_hit = true;
+            fclose(file);
+            pp_token_delete_all(tokens);
+            return NULL;
+        }
+    }
+
+    mark = stats_begin();
     strlitconcat(tokens);
+    stats_end(PHASE_STRLITCONCAT, &mark);
 
     tokenizing_settings_t tk_settings;
     tk_settings.filepath = filename;
-    char tok_error[MAX_ERROR_LENGTH];
-    tk_settings.error = tok_error;
+    tk_settings.error = c->error;
     tk_settings.error[0] = '\0';
+    tk_settings.arena = arena_init();
 
+    mark = stats_begin();
     token_t* ts = tokenize(tokens, &tk_settings);
     if (tk_settings.error[0])
     {
         printf("%s", tk_settings.error);
+        arena_delete(tk_settings.arena);
         return NULL;
     }
 
     pp_token_delete_all(tokens);
+    stats_end(PHASE_TOKENIZE, &mark);
 
-    if (opts.iflag)
+    if (stats_enabled())
+    {
+        uint64_t count = 0;
+        for (token_t* t = ts; t->type != T_END; ++t)
+            ++count;
+        stats_count(COUNTER_TOKENS, count);
+    }
+
+    if (c->options->iflag)
     {
         printf("<<tokenizer output>>\n");
-        for (token_t* t = ts; t; t = t->next)
+        for (token_t* t = ts; t->type != T_END; ++t)
         {
             token_print(t, printf);
             printf("\n");
         }
     }
 
+    mark = stats_begin();
     syntax_component_t* tlu = parse(ts);
+    arena_delete(tk_settings.arena);
+    stats_end(PHASE_PARSE, &mark);
     if (!tlu) return NULL;
 
-    if (opts.iflag)
+    if (stats_enabled())
+        stats_count(COUNTER_SYNTAX_NODES, traverse_count(tlu));
+
+    if (c->options->iflag)
     {
         printf("<<syntax tree>>\n");
         print_syntax(tlu, printf);
     }
 
-    if (opts.pflag)
+    if (c->options->pflag)
     {
         free_syntax(tlu, tlu);
-        token_delete_all(ts);
         return NULL;
     }
 
+    mark = stats_begin();
     analysis_error_t* type_errors = type(tlu);
+    stats_end(PHASE_TYPE, &mark);
     if (type_errors)
     {
+        c->diagnosed = true;
         dump_errors(type_errors);
         if (error_list_size(type_errors, false) > 0)
         {
             fclose(file);
             free_syntax(tlu, tlu);
-            token_delete_all(ts);
-            return NULL;
+                return NULL;
         }
     }
 
-    if (opts.iflag)
+    if (c->options->iflag)
     {
         printf("<<typed syntax tree>>\n");
         print_syntax(tlu, printf);
@@ -169,23 +470,25 @@ x86_asm_file_t* compile_object(char* filename)
         symbol_table_print(tlu->tlu_st, printf);
     }
 
+    mark = stats_begin();
     analysis_error_t* errors = analyze(tlu);
+    stats_end(PHASE_ANALYZE, &mark);
     if (errors)
     {
+        c->diagnosed = true;
         dump_errors(errors);
         if (error_list_size(errors, false) > 0)
         {
             fclose(file);
             free_syntax(tlu, tlu);
-            token_delete_all(ts);
-            error_delete_all(errors);
+                error_delete_all(errors);
             return NULL;
         }
     }
 
     error_delete_all(errors);
 
-    if (opts.iflag)
+    if (c->options->iflag)
     {
         printf("<<semantically-analyzed syntax tree>>\n");
         print_syntax(tlu, printf);
@@ -194,121 +497,428 @@ x86_asm_file_t* compile_object(char* filename)
         symbol_table_print(tlu->tlu_st, printf);
     }
 
-    if (opts.aflag)
+    if (c->options->aflag)
     {
         fclose(file);
         free_syntax(tlu, tlu);
-        token_delete_all(ts);
         return NULL;
     }
 
+    mark = stats_begin();
     air_t* air = airinize(tlu);
+    stats_end(PHASE_AIRINIZE, &mark);
 
-    if (opts.iflag)
+    if (stats_enabled())
+        stats_count(COUNTER_AIR_INSNS, count_air_insns(air));
+
+    if (c->options->iflag)
     {
         printf("<<AIR>>\n");
         air_print(air, printf);
     }
 
-    opt1(air, opt1_profile_basic());
+    fclose(file);
+    *unit = tlu;
+    return air;
+}
 
-    if (opts.iflag)
-    {
-        printf("<<AIR (optimized)>>\n");
-        air_print(air, printf);
-    }
+// optimizes the AIR and takes it through the back end, into the output if there is one. the AIR is freed either way
+static x86_asm_file_t* compile_backend(compilation_t* c, air_t* air, symbol_table_t* st)
+{
+    char* filename = c->filepath;
+    stats_mark_t mark = stats_begin();
+    opt1(air, opt1_profile(c->options->olevel));
+    stats_end(PHASE_OPT1, &mark);
 
-    if (opts.aaflag)
+    if (stats_enabled())
+        stats_count(COUNTER_OPTIMIZED_AIR_INSNS, count_air_insns(air));
+
+    // inlining can leave routines in a whole program that nothing calls anymore
+    if (c->program)
     {
-        fclose(file);
-        air_delete(air);
-        free_syntax(tlu, tlu);
-        token_delete_all(ts);
-        return NULL;
+        mark = stats_begin();
+        program_prune(air);
+        stats_end(PHASE_MERGE, &mark);
     }
 
-    localize(air, LOC_X86_64);
+    // the layout has to see the same routines the counters were numbered in, so counting comes first
+    mark = stats_begin();
+    if (c->options->bflag)
+        instrument_branches(air, filename);
+    if (c->options->olevel != OPTIMIZE_NONE || c->profile)
+        layout(air, filename, c->profile);
+    stats_end(PHASE_LAYOUT, &mark);
 
-    if (opts.iflag)
+    if (c->options->iflag)
     {
-        printf("<<AIR (x86-localized)>>\n");
+        printf("<<AIR (optimized)>>\n");
         air_print(air, printf);
+        printf("<<CFG>>\n");
+        VECTOR_FOR(air_routine_t*, routine, air->routines)
+        {
+            printf("%s:\n", symbol_get_name(routine->sy));
+            air_cfg_print(air_routine_cfg(routine), air, printf);
+        }
     }
 
-    if (opts.llflag)
+    if (c->options->aaflag)
     {
-        fclose(file);
         air_delete(air);
-        free_syntax(tlu, tlu);
-        token_delete_all(ts);
         return NULL;
     }
 
-    allocate(air);
+    /*
 
-    if (opts.iflag)
+    the rest of the back end runs one routine at a time: each is localized, allocated, generated, and peephole
+    optimized, then written or encoded into the output and freed before the next one starts. the AIR itself stays
+    around for the whole translation unit since opt1 inlines across routines, but none of the x86 code does. routines
+    can go through on several threads at once, and still come out in order.
+
+    */
+
+    x86_asm_file_t* asmfile = x86_asm_file_init(air, st);
+    bool backend = !c->options->llflag && !c->options->rflag;
+    if (backend && c->stream_path)
     {
-        printf("<<AIR (register-allocated)>>\n");
-        air_print(air, printf);
+        c->stream = fopen(c->stream_path, c->stream_object ? "wb" : "w");
+        if (!c->stream)
+        {
+            errorf("could not open '%s' for writing\n", c->stream_path);
+            x86_asm_file_delete(asmfile);
+            air_delete(air);
+            return NULL;
+        }
+        if (c->stream_object)
+            x86_asm_file_stream_elf(asmfile);
+        else
+        {
+            // one big buffer means the whole file goes out in a few writes
+            setvbuf(c->stream, NULL, _IOFBF, ASSEMBLY_BUFFER_SIZE);
+            asmfile->text_stream = c->stream;
+        }
     }
 
-    if (opts.rflag)
+    air->locale = LOC_X86_64;
+    backend_t b = {
+        .c = c,
+        .air = air,
+        .asmfile = asmfile,
+        .generated = calloc(air->routines->size, sizeof(x86_asm_routine_t*))
+    };
+    // the dumps would come out interleaved
+    size_t threads = c->options->iflag ? 1 : c->threads;
+    pool_run(air->routines->size, threads, backend_lower, backend_emit, &b);
+    free(b.generated);
+    localize_constants(air);
+
+    if (!backend)
     {
-        fclose(file);
+        x86_asm_file_delete(asmfile);
         air_delete(air);
-        free_syntax(tlu, tlu);
-        token_delete_all(ts);
         return NULL;
     }
 
-    x86_asm_file_t* asmfile = x86_generate(air, tlu->tlu_st);
+    mark = stats_begin();
+    x86_generate_sections(asmfile);
+    stats_end(PHASE_GENERATE, &mark);
 
-    opt4(asmfile, opt4_profile_basic());
-
-    if (opts.iflag)
+    if (c->options->iflag)
     {
-        printf("<<x86 assembly code>>\n");
+        printf("<<x86 data>>\n");
         x86_asm_file_write(asmfile, stdout);
     }
 
-    fclose(file);
     air_delete(air);
-    free_syntax(tlu, tlu);
-    token_delete_all(ts);
 
     return asmfile;
 }
 
-char* compile(char* filename, char* target)
+static x86_asm_file_t* compile_program(compilation_t* c);
+
+x86_asm_file_t* compile_object(compilation_t* c)
 {
-    x86_asm_file_t* asmfile = compile_object(filename);
-    if (!asmfile)
+    if (c->program)
+        return compile_program(c);
+    syntax_component_t* tlu = NULL;
+    air_t* air = compile_air(c, &tlu);
+    if (!air)
         return NULL;
-    
-    char* asm_filepath = target ? strdup(target) : temp_filepath_gen(".s");
+    x86_asm_file_t* asmfile = compile_backend(c, air, tlu->tlu_st);
+    free_syntax(tlu, tlu);
+    return asmfile;
+}
+
+bool precompile_header(compilation_t* c, char* target)
+{
+    char* filename = c->filepath;
+    FILE* file = fopen(filename, "r");
+    if (!file)
+    {
+        errorf("file '%s' not found\n", filename);
+        return false;
+    }
+    preprocessing_token_t* tokens = lex(file, true);
+    fclose(file);
+    if (!tokens) return false;
+
+    c->translation_time = time(NULL);
+
+    preprocessing_settings_t settings;
+    settings.translation_time = &c->translation_time;
+    settings.filepath = filename;
+    settings.error = c->error;
+    settings.error[0] = '\0';
+    settings.options = c->options;
+    settings.table = preprocessing_table_init();
+    settings.include_cache = include_cache_init();
+    settings.dependencies = NULL;
+
+    // record the header itself so that its own include guard ends up in the precompiled header too
+    (void) include_cache_record(settings.include_cache, filename, tokens);
+
+    bool success = preprocess(&tokens, &settings);
+    if (!success)
+        printf("%s", settings.error);
+    else if (!(success = pch_write(target, settings.table, settings.include_cache, tokens)))
+        errorf("could not write precompiled header '%s'\n", target);
+
+    if (success && c->options->iflag)
+        printf("precompiled header written to %s\n", target);
+
+    preprocessing_table_delete(settings.table);
+    map_delete(settings.include_cache);
+    pp_token_delete_all(tokens);
+    return success;
+}
+
+static map_t* profile = NULL;
+
+// how many threads each compilation's back end gets, see run_jobs
+static size_t backend_threads = 1;
+
+// the files -W compiles into one, see gather_program
+static vector_t* program = NULL;
+
+static compilation_t* compilation_init(char* filepath)
+{
+    compilation_t* c = calloc(1, sizeof *c);
+    c->options = &opts;
+    c->filepath = filepath;
+    c->profile = profile;
+    c->threads = backend_threads;
+    c->program = program;
+    return c;
+}
+
+static void compilation_delete(compilation_t* c)
+{
+    free(c->cache_key);
+    free(c);
+}
+
+// every file of the program through the front end on its own, then all of them through the back end together
+static x86_asm_file_t* compile_program(compilation_t* c)
+{
+    vector_t* units = vector_init(); // vector_t<syntax_component_t*>
+    vector_t* airs = vector_init(); // vector_t<air_t*>
+    VECTOR_FOR(char*, path, c->program)
+    {
+        compilation_t* unit = compilation_init(path);
+        unit->program = NULL;
+        syntax_component_t* tlu = NULL;
+        air_t* air = compile_air(unit, &tlu);
+        c->diagnosed |= unit->diagnosed;
+        compilation_delete(unit);
+        if (!air)
+            break;
+        vector_add(units, tlu);
+        vector_add(airs, air);
+    }
+
+    x86_asm_file_t* asmfile = NULL;
+    if (airs->size == c->program->size)
+    {
+        stats_mark_t mark = stats_begin();
+        air_t* air = program_merge(airs);
+        stats_end(PHASE_MERGE, &mark);
+        if (c->options->iflag)
+        {
+            printf("<<AIR (whole program)>>\n");
+            air_print(air, printf);
+        }
+        asmfile = compile_backend(c, air, air->st);
+    }
+    else
+    {
+        VECTOR_FOR(air_t*, air, airs)
+            air_delete(air);
+    }
+
+    // the first file's symbol table has everyone's symbols now, so it goes while the rest are still around
+    VECTOR_FOR(syntax_component_t*, tlu, units)
+        free_syntax(tlu, tlu);
+    vector_delete(units);
+    vector_delete(airs);
+    return asmfile;
+}
 
-    FILE* out = fopen(asm_filepath, "w");
-    x86_asm_file_write(asmfile, out);
-    fclose(out);
+// finishes the output the back end streamed into and closes it, or removes it if there isn't one to finish
+static bool compilation_finish(compilation_t* c, x86_asm_file_t* asmfile)
+{
+    if (c->cache_hit)
+        return true;
+    if (!c->stream)
+    {
+        x86_asm_file_delete(asmfile);
+        return false;
+    }
+    stats_mark_t mark = stats_begin();
+    bool success = asmfile && !c->unencodable;
+    if (success && c->stream_object)
+        success = x86_asm_file_write_elf(asmfile, c->stream);
+    else if (success)
+        x86_asm_file_write(asmfile, c->stream);
     x86_asm_file_delete(asmfile);
+    success = !fclose(c->stream) && success;
+    stats_end(PHASE_WRITE, &mark);
+    c->stream = NULL;
+    if (!success)
+        remove(c->stream_path);
+    return success;
+}
+
+// writes the dependencies -M asks for in place of compiling
+static bool list_dependencies(char* filename)
+{
+    compilation_t* c = compilation_init(filename);
+    (void) compile_object(c);
+    bool success = c->dependencies_written;
+    compilation_delete(c);
+    return success;
+}
+
+// keeps the output of a compilation that went through for the next one that preprocesses the same way
+static void compilation_cache(compilation_t* c)
+{
+    if (c->cache_key && !c->cache_hit && !c->diagnosed)
+        cache_store(c->options->ccflag, c->cache_key, c->cache_target);
+}
+
+// compiles into assembly at target, or a temporary file if there isn't one. an object cached for the compilation
+// means there's no assembly to go through, in which case this succeeds with *asm_filepath set to NULL.
+static bool compile_assembly(compilation_t* c, char* target, char** asm_filepath)
+{
+    *asm_filepath = target ? strdup(target) : temp_filepath_gen(".s");
+    if (!*asm_filepath)
+    {
+        errorf("could not create a temporary file for the assembly\n");
+        return false;
+    }
+
+    c->stream_path = *asm_filepath;
+    if (!c->cache_target)
+        c->cache_target = *asm_filepath;
+    bool success = compilation_finish(c, compile_object(c));
+    if (!success || (c->cache_hit && c->cache_object))
+    {
+        // a temporary file is made up front, so it's there to remove even if compilation stopped before the back end
+        if (!target)
+            remove(*asm_filepath);
+        free(*asm_filepath);
+        *asm_filepath = NULL;
+        return success;
+    }
 
     if (opts.iflag)
-        printf("assembly written to %s\n", asm_filepath);
+        printf("assembly written to %s%s\n", *asm_filepath, c->cache_hit ? " from the cache" : "");
+
+    return true;
+}
 
+char* compile(char* filename, char* target)
+{
+    compilation_t* c = compilation_init(filename);
+    char* asm_filepath = NULL;
+    if (compile_assembly(c, target, &asm_filepath))
+        compilation_cache(c);
+    compilation_delete(c);
     return asm_filepath;
 }
 
+// returns whether the object was written, with *compiled set if it failed only because it couldn't be encoded
+static bool write_elf_object(char* filename, char* obj_filepath, bool* compiled)
+{
+    compilation_t* c = compilation_init(filename);
+    c->stream_path = obj_filepath;
+    c->stream_object = true;
+    c->cache_target = obj_filepath;
+    c->cache_object = true;
+    x86_asm_file_t* asmfile = compile_object(c);
+    *compiled = asmfile != NULL;
+    bool success = compilation_finish(c, asmfile);
+    if (success)
+        compilation_cache(c);
+    compilation_delete(c);
+    if (!success && *compiled && opts.iflag)
+        printf("could not write the object directly, falling back to the assembler\n");
+    return success;
+}
+
 char* assemble(char* filename, char* target)
 {
-    char* asm_filepath = compile(filename, NULL);
-    if (!asm_filepath)
-        return NULL;
     char* obj_filepath = target ? strdup(target) : temp_filepath_gen(".o");
+    if (!obj_filepath)
+    {
+        errorf("could not create a temporary file for the object\n");
+        return NULL;
+    }
 
+    if (opts.eflag)
+    {
+        bool compiled = false;
+        if (write_elf_object(filename, obj_filepath, &compiled))
+        {
+            if (opts.iflag)
+                printf("object written to %s\n", obj_filepath);
+            return obj_filepath;
+        }
+        if (!compiled)
+        {
+            if (!target)
+                remove(obj_filepath);
+            free(obj_filepath);
+            return NULL;
+        }
+    }
+
+    // the routines were freed as they were encoded, so falling back to the assembler means compiling again
+    compilation_t* c = compilation_init(filename);
+    c->cache_target = obj_filepath;
+    c->cache_object = true;
+    char* asm_filepath = NULL;
+    if (!compile_assembly(c, NULL, &asm_filepath))
+    {
+        compilation_delete(c);
+        if (!target)
+            remove(obj_filepath);
+        free(obj_filepath);
+        return NULL;
+    }
+
+    if (c->cache_hit)
+    {
+        compilation_delete(c);
+        if (opts.iflag)
+            printf("object written to %s from the cache\n", obj_filepath);
+        return obj_filepath;
+    }
+
+    stats_mark_t mark = stats_begin();
     pid_t as_pid = fork();
 
     if (as_pid == -1)
     {
+        compilation_delete(c);
         remove(asm_filepath);
         free(asm_filepath);
         free(obj_filepath);
@@ -330,11 +940,12 @@ char* assemble(char* filename, char* target)
     }
 
     int as_status = EXIT_FAILURE;
-    waitpid(as_pid, &as_status, 0);
+    stats_wait(as_pid, &as_status, PHASE_ASSEMBLE, &mark);
     as_status = WEXITSTATUS(as_status);
 
     if (as_status)
     {
+        compilation_delete(c);
         remove(asm_filepath);
         free(obj_filepath);
         free(asm_filepath);
@@ -344,6 +955,8 @@ char* assemble(char* filename, char* target)
 
     remove(asm_filepath);
     free(asm_filepath);
+    compilation_cache(c);
+    compilation_delete(c);
 
     if (opts.iflag)
         printf("object written to %s\n", obj_filepath);
@@ -355,6 +968,7 @@ char* linker(char** object_files, size_t object_count, char* target)
 {
     char* exec_filepath = target ? strdup(target) : strdup("a.out");
 
+    stats_mark_t mark = stats_begin();
     pid_t ld_pid = fork();
     if (ld_pid == -1)
     {
@@ -387,7 +1001,7 @@ char* linker(char** object_files, size_t object_count, char* target)
     }
 
     int ld_status = EXIT_FAILURE;
-    waitpid(ld_pid, &ld_status, 0);
+    stats_wait(ld_pid, &ld_status, PHASE_LINK, &mark);
     if (WEXITSTATUS(ld_status))
     {
         free(exec_filepath);
@@ -402,10 +1016,119 @@ char* linker(char** object_files, size_t object_count, char* target)
     return exec_filepath;
 }
 
+typedef char* (*job_t)(char* filename, char* target);
+
+// runs job on every input with up to opts.jflag of them in flight at once, each in its own process.
+// every target must be known up front since the children can't hand anything back but their exit status.
+// whatever part of opts.jflag isn't taken up by processes goes to each one's back end as threads.
+static bool run_jobs(job_t job, char** inputs, char** targets, size_t count)
+{
+    size_t processes = min(count, opts.jflag > 1 ? (size_t) opts.jflag : 1);
+    if (processes)
+        backend_threads = max(opts.jflag / processes, 1);
+
+    if (opts.jflag <= 1)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            stats_start(inputs[i]);
+            char* result = job(inputs[i], targets[i]);
+            if (!stats_finish() || !result)
+            {
+                free(result);
+                return false;
+            }
+            free(result);
+        }
+        return true;
+    }
+
+    bool success = true;
+    size_t running = 0;
+    for (size_t i = 0; i < count || running;)
+    {
+        if (success && i < count && running < opts.jflag)
+        {
+            // anything still buffered would otherwise be written again by the child
+            fflush(stdout);
+            fflush(stderr);
+            pid_t pid = fork();
+            if (pid == -1)
+            {
+                errorf("failed to spawn compiler process\n");
+                success = false;
+                continue;
+            }
+            if (pid == 0)
+            {
+                stats_start(inputs[i]);
+                char* result = job(inputs[i], targets[i]);
+                bool reported = stats_finish();
+                free(result);
+                exit(result && reported ? EXIT_SUCCESS : EXIT_FAILURE);
+            }
+            ++i, ++running;
+            continue;
+        }
+        if (!running)
+            break;
+        int status = EXIT_FAILURE;
+        if (wait(&status) == -1)
+            break;
+        --running;
+        if (!WIFEXITED(status) || WEXITSTATUS(status))
+            success = false;
+    }
+    return success;
+}
+
+// -M, -MM, -MD, -MMD, and -MF, which getopt sees as -M with the rest attached as its argument
+static bool get_dependency_option(char* rest, int argc, char** argv)
+{
+    if (!rest)
+        opts.mflag = true;
+    else if (!strcmp(rest, "M"))
+        opts.mflag = opts.mmflag = true;
+    else if (!strcmp(rest, "D"))
+        opts.mdflag = true;
+    else if (!strcmp(rest, "MD"))
+        opts.mdflag = opts.mmflag = true;
+    else if (rest[0] == 'F' && rest[1])
+        opts.mfflag = rest + 1;
+    else if (rest[0] == 'F' && optind < argc)
+        opts.mfflag = argv[optind++];
+    else
+    {
+        errorf("unknown option specified: -M%s\n", rest);
+        return false;
+    }
+    return true;
+}
+
+// -O0, -O1, -O2, and -Os, with -O3 taken as -O2 since there's nothing more to turn on, and -O alone as -O1
+static bool get_optimization_option(char* level)
+{
+    if (!level || !strcmp(level, "1"))
+        opts.olevel = OPTIMIZE_LIGHT;
+    else if (!strcmp(level, "0"))
+        opts.olevel = OPTIMIZE_NONE;
+    else if (!strcmp(level, "2") || !strcmp(level, "3"))
+        opts.olevel = OPTIMIZE_FULL;
+    else if (!strcmp(level, "s"))
+        opts.olevel = OPTIMIZE_SIZE;
+    else
+    {
+        errorf("unknown optimization level specified: -O%s\n", level);
+        return false;
+    }
+    return true;
+}
+
 bool get_options(int argc, char** argv)
 {
     memset(&opts, 0, sizeof(program_options_t));
-    for (int c; (c = getopt(argc, argv, "hiPpaxLArcSo:")) != -1;)
+    opts.olevel = OPTIMIZE_FULL;
+    for (int c; (c = getopt(argc, argv, "hiPpaxLArcSHeFbtWo:u:B:j:T:C:s:w:M::O::")) != -1;)
     {
         switch (c)
         {
@@ -442,9 +1165,61 @@ bool get_options(int argc, char** argv)
             case 'S':
                 opts.ssflag = true;
                 break;
+            case 'H':
+                opts.hhflag = true;
+                break;
+            case 'e':
+                opts.eflag = true;
+                break;
+            case 'F':
+                opts.ffflag = true;
+                break;
+            case 'b':
+                opts.bflag = true;
+                break;
+            case 't':
+                opts.tflag = true;
+                break;
+            case 'W':
+                opts.wwflag = true;
+                break;
+            case 'T':
+                opts.ttflag = optarg;
+                break;
             case 'o':
                 opts.oflag = optarg;
                 break;
+            case 'u':
+                opts.uflag = optarg;
+                break;
+            case 'B':
+                opts.bbflag = optarg;
+                break;
+            case 'C':
+                opts.ccflag = optarg;
+                break;
+            case 's':
+                opts.sflag = optarg;
+                break;
+            case 'w':
+                opts.wflag = optarg;
+                break;
+            case 'M':
+                if (!get_dependency_option(optarg, argc, argv))
+                    return false;
+                break;
+            case 'O':
+                if (!get_optimization_option(optarg))
+                    return false;
+                break;
+            case 'j':
+                opts.jflag = atoi(optarg);
+                if (opts.jflag <= 0)
+                {
+                    errorf("invalid number of jobs specified: %s\n", optarg);
+                    return false;
+                }
+                break;
             case '?':
             default:
             {
@@ -456,80 +1231,162 @@ bool get_options(int argc, char** argv)
     return true;
 }
 
+// how many outputs the files after the options make: one for each, or with -W, one for all of them
+static size_t gather_program(int argc, char** argv)
+{
+    if (!opts.wwflag || optind >= argc)
+        return argc - optind;
+    program = vector_init();
+    for (int i = optind; i < argc; ++i)
+        vector_add(program, argv[i]);
+    return 1;
+}
+
+// compiles into a temporary file and copies it to stdout, for -S -o -
+static char* compile_to_stdout(char* filename, char* target)
+{
+    char* asm_filepath = compile(filename, NULL);
+    if (!asm_filepath)
+        return NULL;
+    FILE* file = fopen(asm_filepath, "r");
+    bool copied = file != NULL;
+    char buffer[BUFSIZ];
+    for (size_t read; copied && (read = fread(buffer, 1, sizeof buffer, file)) > 0;)
+        copied = fwrite(buffer, 1, read, stdout) == read;
+    if (file)
+        fclose(file);
+    copied = copied && !fflush(stdout);
+    remove(asm_filepath);
+    if (!copied)
+    {
+        errorf("could not write the assembly to stdout\n");
+        free(asm_filepath);
+        return NULL;
+    }
+    return asm_filepath;
+}
+
 int handle_ss_flag(int argc, char** argv)
 {
-    if (opts.oflag && argc - optind > 1)
+    size_t count = gather_program(argc, argv);
+    if (opts.oflag && count > 1)
     {
         errorf("the -o flag can only be used with the -S flag with one file is given as input\n");
         return EXIT_FAILURE;
     }
+    char** targets = calloc(count, sizeof(char*));
+    for (size_t i = 0; i < count; ++i)
+        targets[i] = opts.oflag ? strdup(opts.oflag) : replace_extension(argv[optind + i], ".s");
+    bool success = run_jobs(opts.oflag && streq(opts.oflag, "-") ? compile_to_stdout : compile, argv + optind, targets, count);
+    delete_array((void**) targets, count);
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int handle_m_flag(int argc, char** argv)
+{
+    if ((opts.oflag || opts.mfflag) && argc - optind > 1)
+    {
+        errorf("the -o and -MF flags can only be used with the -M flag when one file is given as input\n");
+        return EXIT_FAILURE;
+    }
     for (int i = optind; i < argc; ++i)
     {
-        char* created = opts.oflag ? strdup(opts.oflag) : replace_extension(argv[i], ".s");
-        char* asm_filepath = compile(argv[i], created);
-        free(created);
-        if (!asm_filepath)
+        if (!list_dependencies(argv[i]))
             return EXIT_FAILURE;
-        free(asm_filepath);
     }
     return EXIT_SUCCESS;
 }
 
-int handle_c_flag(int argc, char** argv)
+int handle_hh_flag(int argc, char** argv)
 {
     if (opts.oflag && argc - optind > 1)
     {
-        errorf("the -o flag can only be used with the -c flag with one file is given as input\n");
+        errorf("the -o flag can only be used with the -H flag with one file is given as input\n");
         return EXIT_FAILURE;
     }
     for (int i = optind; i < argc; ++i)
     {
-        char* created = opts.oflag ? strdup(opts.oflag) : replace_extension(argv[i], ".o");
-        char* obj_filepath = assemble(argv[i], created);
+        char* created = opts.oflag ? strdup(opts.oflag) : replace_extension(argv[i], ".pch");
+        compilation_t* c = compilation_init(argv[i]);
+        bool success = precompile_header(c, created);
+        free(c);
         free(created);
-        if (!obj_filepath)
+        if (!success)
             return EXIT_FAILURE;
-        free(obj_filepath);
     }
     return EXIT_SUCCESS;
 }
 
-int main(int argc, char** argv)
+int handle_c_flag(int argc, char** argv)
 {
-    PROGRAM_NAME = argv[0];
-    srand(time(NULL));
-    if (argc <= 1)
+    size_t count = gather_program(argc, argv);
+    if (opts.oflag && count > 1)
     {
-        errorf("no input files\n");
+        errorf("the -o flag can only be used with the -c flag with one file is given as input\n");
         return EXIT_FAILURE;
     }
+    char** targets = calloc(count, sizeof(char*));
+    for (size_t i = 0; i < count; ++i)
+        targets[i] = opts.oflag ? strdup(opts.oflag) : replace_extension(argv[optind + i], ".o");
+    bool success = run_jobs(assemble, argv + optind, targets, count);
+    delete_array((void**) targets, count);
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
 
-    if (!get_options(argc, argv))
-        return EXIT_FAILURE;
-    
+// does what the options say with the files that follow them, here or in a server's child for a client
+int drive(int argc, char** argv)
+{
     if (opts.hflag)
         return usage();
     
+    if (opts.bbflag && !(profile = branch_profile_read(opts.bbflag)))
+    {
+        errorf("could not read profile '%s'\n", opts.bbflag);
+        return EXIT_FAILURE;
+    }
+
+    if (opts.mflag)
+        return handle_m_flag(argc, argv);
+
+    if (opts.mfflag && opts.mdflag && argc - optind > 1)
+    {
+        errorf("the -MF flag can only be used with the -MD flag when one file is given as input\n");
+        return EXIT_FAILURE;
+    }
+
+    if (opts.hhflag)
+        return handle_hh_flag(argc, argv);
+
     if (opts.ssflag)
         return handle_ss_flag(argc, argv);
     
     if (opts.cflag)
         return handle_c_flag(argc, argv);
     
-    size_t object_count = argc - optind;
+    size_t object_count = gather_program(argc, argv);
     char** objects = calloc(object_count, sizeof(char*));
-    for (int i = optind; i < argc; ++i)
+    for (size_t i = 0; i < object_count; ++i)
     {
-        char* obj_filepath = assemble(argv[i], NULL);
-        if (obj_filepath == NULL)
+        if (!(objects[i] = temp_filepath_gen(".o")))
         {
+            errorf("could not create a temporary file for an object\n");
+            for (size_t j = 0; j < i; ++j)
+                remove(objects[j]);
             delete_array((void**) objects, object_count);
             return EXIT_FAILURE;
         }
-        objects[i - optind] = obj_filepath;
+    }
+    if (!run_jobs(assemble, argv + optind, objects, object_count))
+    {
+        for (size_t i = 0; i < object_count; ++i)
+            remove(objects[i]);
+        delete_array((void**) objects, object_count);
+        return EXIT_FAILURE;
     }
 
+    stats_start(opts.oflag ? opts.oflag : "a.out");
     char* exec_filepath = linker(objects, object_count, opts.oflag);
+    bool reported = stats_finish();
 
     delete_array((void**) objects, object_count);
 
@@ -540,5 +1397,30 @@ int main(int argc, char** argv)
     }
 
     free(exec_filepath);
-    return EXIT_SUCCESS;
-}
\ No newline at end of file
+    return reported ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char** argv)
+{
+    PROGRAM_NAME = argv[0];
+    if (argc <= 1)
+    {
+        errorf("no input files\n");
+        return EXIT_FAILURE;
+    }
+
+    if (!get_options(argc, argv))
+        return EXIT_FAILURE;
+
+    if (opts.sflag)
+        return serve(opts.sflag);
+
+    if (opts.wflag)
+    {
+        int status = server_request(opts.wflag, argc, argv);
+        if (status != -1)
+            return status;
+    }
+
+    return drive(argc, argv);
+}
@@ -11,10 +11,12 @@
 map_t* map_init(int (*comparator)(void*, void*), unsigned long (*hash)(void*))
 {
     map_t* m = calloc(1, sizeof *m);
-    m->capacity = 50;
+    m->capacity = 64;
     m->key = calloc(m->capacity, sizeof(void*));
     m->value = calloc(m->capacity, sizeof(void*));
+    m->hashes = calloc(m->capacity, sizeof(unsigned long));
     m->size = 0;
+    m->tombstones = 0;
     m->comparator = comparator;
     m->hash = hash;
     return m;
@@ -39,61 +41,70 @@ void set_set_deleter(map_t* m, void (*deleter)(void*))
     map_set_deleters(m, deleter, NULL);
 }
 
-void map_resize(map_t* m)
+// capacities are always powers of two, so probing can mask instead of taking a modulus
+#define MAP_SLOT(m, h) ((h) & ((m)->capacity - 1))
+
+// rebuilds the map at the given capacity, dropping any tombstones along the way.
+// the hashes of every key are cached so nothing needs to be rehashed here
+static void map_rebuild(map_t* m, size_t new_capacity)
 {
-    size_t new_capacity = m->capacity * 2;
     void** nkey = calloc(new_capacity, sizeof(void*));
     void** nvalue = calloc(new_capacity, sizeof(void*));
-    MAP_FOR(void*, void*, m)
+    unsigned long* nhashes = calloc(new_capacity, sizeof(unsigned long));
+    for (size_t j = 0; j < m->capacity; ++j)
     {
-        if (MAP_IS_BAD_KEY) continue;
-
-        unsigned long h = m->hash(k) % new_capacity;
-
-        for (size_t i = h;;)
-        {
-            void* fk = nkey[i];
-            if (!fk || fk == TOMBSTONE)
-            {
-                nkey[i] = k;
-                nvalue[i] = v;
-                break;
-            }
-
-            i = (i + 1) % new_capacity;
-            if (i == h)
-                report_return;
-        }
+        void* k = m->key[j];
+        if (!k || k == TOMBSTONE) continue;
+        unsigned long h = m->hashes[j];
+        size_t i = h & (new_capacity - 1);
+        while (nkey[i])
+            i = (i + 1) & (new_capacity - 1);
+        nkey[i] = k;
+        nvalue[i] = m->value[j];
+        nhashes[i] = h;
     }
     free(m->key);
     free(m->value);
+    free(m->hashes);
     m->key = nkey;
     m->value = nvalue;
+    m->hashes = nhashes;
     m->capacity = new_capacity;
+    m->tombstones = 0;
 }
 
-// gets the index of the key, if it exists in the map
-static int map_get_key_index(map_t* m, void* key)
+void map_resize(map_t* m)
 {
-    unsigned long h = m->hash(key) % m->capacity;
+    map_rebuild(m, m->capacity * 2);
+}
 
-    for (int i = h;;)
+// gets the index of the key, if it exists in the map
+static int map_get_key_index_hashed(map_t* m, void* key, unsigned long h)
+{
+    size_t start = MAP_SLOT(m, h);
+    for (size_t i = start;;)
     {
         void* k = m->key[i];
         if (!k)
             return -1;
-        if (k != TOMBSTONE && !m->comparator(k, key))
+        if (k != TOMBSTONE && m->hashes[i] == h && !m->comparator(k, key))
             return i;
 
-        i = (i + 1) % m->capacity;
-        if (i == h)
+        i = MAP_SLOT(m, i + 1);
+        if (i == start)
             return -1;
     }
 }
 
+static int map_get_key_index(map_t* m, void* key)
+{
+    return map_get_key_index_hashed(m, key, m->hash(key));
+}
+
 void* map_add(map_t* m, void* key, void* value)
 {
-    int found = map_get_key_index(m, key);
+    unsigned long h = m->hash(key);
+    int found = map_get_key_index_hashed(m, key, h);
     if (found != -1)
     {
         void* v = m->value[found];
@@ -101,25 +112,29 @@ void* map_add(map_t* m, void* key, void* value)
         return v;
     }
 
-    if (m->size > m->capacity / 2)
-        map_resize(m);
-    
-    unsigned long h = m->hash(key) % m->capacity;
+    // tombstones lengthen probe sequences just like live keys do, so they count towards the load factor
+    if ((m->size + m->tombstones + 1) * 2 > m->capacity)
+    {
+        // if most of the load is tombstones, just clean them up instead of growing
+        if (m->size * 4 < m->capacity)
+            map_rebuild(m, m->capacity);
+        else
+            map_resize(m);
+    }
 
-    for (size_t i = h;;)
+    for (size_t i = MAP_SLOT(m, h);; i = MAP_SLOT(m, i + 1))
     {
         void* k = m->key[i];
         if (!k || k == TOMBSTONE)
         {
+            if (k == TOMBSTONE)
+                --(m->tombstones);
             m->key[i] = key;
             m->value[i] = value;
+            m->hashes[i] = h;
             ++(m->size);
             break;
         }
-
-        i = (i + 1) % m->capacity;
-        if (i == h)
-            report_return_value(NULL);
     }
 
     return NULL;
@@ -137,6 +152,7 @@ void* map_remove(map_t* m, void* key)
     m->key[i] = TOMBSTONE;
     m->value[i] = NULL;
     --(m->size);
+    ++(m->tombstones);
     return v;
 }
 
@@ -182,6 +198,7 @@ void map_delete(map_t* m)
     }
     free(m->key);
     free(m->value);
+    free(m->hashes);
     free(m);
 }
 
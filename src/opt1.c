@@ -1,17 +1,54 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <stddef.h>
 
 #include "ecc.h"
 
-static opt1_options_t opt_profile_basic = {
+static opt1_options_t opt_profile_light = {
     .inline_fcalls = true,
     .remove_fcall_passing_lifetimes = true,
-    .inline_integer_constant = true
+    .propagate_constants = true,
+    .eliminate_dead_code = true
 };
 
-opt1_options_t* opt1_profile_basic(void)
+static opt1_options_t opt_profile_full = {
+    .inline_fcalls = true,
+    .remove_fcall_passing_lifetimes = true,
+    .propagate_constants = true,
+    .number_values = true,
+    .optimize_loops = true,
+    .vectorize_loops = true,
+    .eliminate_dead_code = true,
+    .inline_threshold = 20
+};
+
+// vectorized loops keep a scalar copy for what's left over, and only a function about the size of the call to it
+// is sure not to grow when it's inlined
+static opt1_options_t opt_profile_size = {
+    .inline_fcalls = true,
+    .remove_fcall_passing_lifetimes = true,
+    .propagate_constants = true,
+    .number_values = true,
+    .optimize_loops = true,
+    .eliminate_dead_code = true,
+    .inline_threshold = 6
+};
+
+// the options for an optimization level, or NULL if opt1 shouldn't run at all
+opt1_options_t* opt1_profile(optimization_level_t level)
 {
-    return &opt_profile_basic;
+    switch (level)
+    {
+        case OPTIMIZE_LIGHT:
+            return &opt_profile_light;
+        case OPTIMIZE_FULL:
+            return &opt_profile_full;
+        case OPTIMIZE_SIZE:
+            return &opt_profile_size;
+        default:
+            return NULL;
+    }
 }
 
 /*
@@ -22,20 +59,25 @@ the following scenario:
 will be replaced with:
     ... _1 = func(...);
 
+this is only done when the call is the address's only use, since its definition is removed.
+
 */
-static void try_inline_fcalls(air_insn_t* insn, air_routine_t* routine, air_t* air)
+static bool try_inline_fcalls(air_insn_t* insn, air_routine_t* routine, air_defuse_t* du, air_t* air)
 {
-    if (insn->type != AIR_FUNC_CALL) return;
+    if (insn->type != AIR_FUNC_CALL) return false;
     air_insn_operand_t* op = insn->ops[1];
-    if (op->type != AOP_REGISTER) return;
-    air_insn_t* callexpr_insn = air_insn_find_temporary_definition_above(op->content.reg, insn);
-    if (!callexpr_insn) return;
-    if (callexpr_insn->type != AIR_LOAD_ADDR) return;
+    if (op->type != AOP_REGISTER) return false;
+    vector_t* uses = air_defuse_uses(du, op->content.reg);
+    if (!uses || uses->size != 1) return false;
+    air_insn_t* callexpr_insn = air_defuse_definition(du, op->content.reg);
+    if (!callexpr_insn) return false;
+    if (callexpr_insn->type != AIR_LOAD_ADDR) return false;
     air_insn_operand_t* funcop = callexpr_insn->ops[1];
-    if (funcop->type != AOP_SYMBOL) return;
+    if (funcop->type != AOP_SYMBOL) return false;
     op->type = AOP_SYMBOL;
     op->content.sy = funcop->content.sy;
     air_insn_remove(callexpr_insn);
+    return true;
 }
 
 /*
@@ -47,140 +89,3407 @@ int _3 = 5; <-- insn
 func(_4)
 func(_3) <-- first_used
 
+the definition only moves within its own block, since moving it
+past a label could leave it undefined on the other paths into it.
+one that reads memory stays put, since the call it would pass
+could change what it reads. if nothing in its block uses it but
+it's live out of the block, it moves to the end of the block
+
 */
-static bool try_remove_fcall_passing_lifetimes(air_insn_t* insn, air_routine_t* routine, air_t* air)
+static bool try_remove_fcall_passing_lifetimes(air_insn_t* insn, air_routine_t* routine, air_defuse_t* du, air_liveness_t* liveness, air_t* air)
 {
     if (!insn) return false;
+    regid_t reg = insn->ops[0]->content.reg;
+    vector_t* uses = air_defuse_uses(du, reg);
+    if (!uses) return false;
+    if (insn->type != AIR_LOAD_ADDR)
+    {
+        for (size_t i = 1; i < insn->noops; ++i)
+        {
+            air_insn_operand_type_t type = insn->ops[i]->type;
+            if (type == AOP_SYMBOL || type == AOP_INDIRECT_SYMBOL || type == AOP_INDIRECT_REGISTER)
+                return false;
+        }
+    }
+    air_block_t* block = air_cfg_block(liveness->cfg, insn);
     bool side = air_insn_produces_side_effect(insn);
     bool fcall_found = false;
     air_insn_t* first_used = NULL;
-    regid_t reg = insn->ops[0]->content.reg;
-    for (air_insn_t* trace = insn->next; trace; trace = trace->next)
+    air_insn_t* trace = insn->next;
+    for (; trace && trace != block->last->next; trace = trace->next)
     {
         if (side && trace->type == AIR_SEQUENCE_POINT)
             break;
-        bool uses = air_insn_uses(trace, reg);
-        bool fcall = trace->type == AIR_FUNC_CALL;
-        if (uses && !fcall_found) // like: _1 where _1 is defining and we're before any function calls
+        bool used = vector_contains(uses, trace, pointer_comparator) != -1;
+        if (used && !fcall_found) // like: _1 where _1 is defining and we're before any function calls
             return false;
-        if (fcall) // like: func(_2) where _1 is defining
+        if (trace->type == AIR_FUNC_CALL) // like: func(_2) where _1 is defining
             fcall_found = true;
-        if (uses && !first_used) // like: _3 = _1 where _1 is defining
+        if (used) // like: _3 = _1 where _1 is defining
+        {
             first_used = trace;
+            break;
+        }
     }
     if (!first_used)
-        return false;
+    {
+        // stopping short of the end of the block means it had to stay before a sequence point
+        if (!fcall_found || trace != block->last->next || !air_liveness_live_out(liveness, block, reg))
+            return false;
+        if (block->first == insn)
+            block->first = insn->next;
+        switch (block->last->type)
+        {
+            case AIR_JMP:
+            case AIR_JMP_TABLE:
+            case AIR_JZ:
+            case AIR_JNZ:
+            case AIR_RETURN:
+                air_insn_move_before(insn, block->last);
+                break;
+            default:
+                air_insn_move_after(insn, block->last);
+                block->last = insn;
+                break;
+        }
+        return true;
+    }
+    if (block->first == insn)
+        block->first = insn->next;
     air_insn_move_before(insn, first_used);
     return true;
 }
 
 /*
 
-int _1 = 5;
-int _2 = _1;
+sparse conditional constant propagation (Wegman and Zadeck).
 
-becomes:
+temporaries start out undefined and are lowered to a constant, or past that to overdefined, as the instructions
+defining them are evaluated. only blocks found to be executable are evaluated, and a conditional jump (or jump
+table) on a constant only makes the edge it takes executable, so values coming out of dead arms (and PHIs merging them)
+don't spoil the ones coming out of live arms. the arithmetic itself is done by constexpr.c.
 
-int _2 = 5;
+afterwards, constant definitions become loads of their constant, jumps on constants become unconditional or
+go away, blocks that were never executable are removed (other than declarations, which gotos can jump past),
+and then so are constant loads that nothing uses anymore.
 
 */
 
-// static bool try_inline_integer_constant(air_insn_t* insn, air_routine_t* routine, air_t* air)
-// {
-//     if (!insn) return false;
-//     if (insn->type != AIR_LOAD) return false;
-//     if (insn->ops[1]->type != AOP_INTEGER_CONSTANT) return false;
-//     regid_t reg = insn->ops[0]->content.reg;
-//     unsigned long long value = insn->ops[1]->content.ic;
-//     for (air_insn_t* trace = insn->next; trace; trace = trace->next)
-//     {
-//         for (size_t i = 0; i < trace->noops; ++i)
-//         {
-//             air_insn_operand_t* op = trace->ops[i];
-//             if (!op) continue;
-//             if (op->type == AOP_REGISTER && op->content.reg == reg)
-//             {
-//                 op->type = AOP_INTEGER_CONSTANT;
-//                 op->content.ic = value;
-//             }
-//         }
-//     }
-//     air_insn_remove(insn);
-//     return true;
-// }
-
-// static bool try_simplify_integer_add(air_insn_t* insn, air_routine_t* routine, air_t* air)
-// {
-//     if (!insn) return false;
-//     if (insn->type != AIR_ADD) return false;
-//     if (insn->ops[1]->type != AOP_INTEGER_CONSTANT ||
-//         insn->ops[2]->type != AOP_INTEGER_CONSTANT)
-//         return false;
-//     unsigned long long result = insn->ops[1]->content.ic + insn->ops[2]->content.ic;
-//     if (!representable(result, insn->ct->class))
-//         return false;
-//     air_insn_operand_delete(insn->ops[1]);
-//     air_insn_operand_delete(insn->ops[2]);
-//     insn->ops[1] = air_insn_integer_constant_operand_init(result);
-//     insn->noops = 2;
-//     insn->type = AIR_LOAD;
-//     return true;
-// }
-
-// static bool constexpr_simplification(air_routine_t* routine, air_t* air)
-// {
-//     bool success = false;
-//     for (air_insn_t* insn = routine->insns; insn;)
-//     {
-//         air_insn_t* next = insn->next;
-//         switch (insn->type)
-//         {
-//             case AIR_LOAD:
-//                 success |= try_inline_integer_constant(insn, routine, air);
-//                 break;
-//             case AIR_ADD:
-//                 success |= try_simplify_integer_add(insn, routine, air);
-//                 break;
-//             default:
-//                 break;
-//         }
-//         insn = next;
-//     }
-//     return success;
-// }
+typedef enum lattice_state
+{
+    LATTICE_UNDEFINED,
+    LATTICE_CONSTANT,
+    LATTICE_OVERDEFINED
+} lattice_state_t;
 
-void opt1(air_t* air, opt1_options_t* options)
+typedef struct lattice
 {
-    if (!options) return;
-    VECTOR_FOR(air_routine_t*, routine, air->routines)
+    lattice_state_t state;
+    constexpr_t* value; // only for LATTICE_CONSTANT
+} lattice_t;
+
+typedef struct propagator
+{
+    air_routine_t* routine;
+    air_t* air;
+    air_cfg_t* cfg;
+    air_defuse_t* du;
+    map_t* readonly; // map_t<symbol_t*, air_data_t*>
+    map_t* values; // map_t<regid_t, lattice_t*>
+    bool* executable; // indexed by block id
+    vector_t* blocks; // vector_t<air_block_t*>, blocks that just became executable
+    vector_t* insns; // vector_t<air_insn_t*>, instructions whose operands changed
+} propagator_t;
+
+static void lattice_delete(lattice_t* l)
+{
+    if (!l) return;
+    constexpr_delete(l->value);
+    free(l);
+}
+
+static lattice_t undefined(void)
+{
+    return (lattice_t) { LATTICE_UNDEFINED, NULL };
+}
+
+static lattice_t overdefined(void)
+{
+    return (lattice_t) { LATTICE_OVERDEFINED, NULL };
+}
+
+// takes ownership of the value, anything NULL is overdefined
+static lattice_t constant(constexpr_t* value)
+{
+    if (!value)
+        return overdefined();
+    return (lattice_t) { LATTICE_CONSTANT, value };
+}
+
+static bool constants_equal(constexpr_t* a, constexpr_t* b)
+{
+    return a->ct->class == b->ct->class && !memcmp(a->content.data, b->content.data, type_size(a->ct));
+}
+
+static lattice_t register_value(propagator_t* p, air_insn_operand_t* op)
+{
+    if (!op || op->type != AOP_REGISTER)
+        return overdefined();
+    lattice_t* l = map_get(p->values, (void*) op->content.reg);
+    if (!l)
+        return undefined();
+    return (lattice_t) { l->state, l->value };
+}
+
+/*
+a register can hold a value wider than the type an instruction reads it as, since narrowing casts between integer
+types don't emit anything, so operands are read as the type the instruction uses them at. unlike register_value,
+the result owns its constant.
+*/
+static lattice_t operand_value(propagator_t* p, air_insn_operand_t* op, c_type_t* ct)
+{
+    lattice_t v = register_value(p, op);
+    if (v.state != LATTICE_CONSTANT)
+        return v;
+    return constant(ct ? constexpr_fold_conversion(v.value, ct) : constexpr_copy(v.value));
+}
+
+static bool ops_constant(lattice_t* values, size_t count, lattice_t* result)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (values[i].state == LATTICE_OVERDEFINED)
+        {
+            *result = overdefined();
+            return false;
+        }
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (values[i].state == LATTICE_UNDEFINED)
+        {
+            *result = undefined();
+            return false;
+        }
+    }
+    return true;
+}
+
+static punctuator_type_t binary_operator(air_insn_t* insn)
+{
+    switch (insn->type)
+    {
+        case AIR_ADD: return P_PLUS;
+        case AIR_SUBTRACT: return P_MINUS;
+        case AIR_MULTIPLY: return P_ASTERISK;
+        case AIR_DIVIDE: return P_SLASH;
+        case AIR_MODULO: return P_PERCENT;
+        case AIR_AND: return P_AND;
+        case AIR_OR: return P_PIPE;
+        case AIR_XOR: return P_CARET;
+        case AIR_SHIFT_LEFT: return P_LEFT_SHIFT;
+        case AIR_SHIFT_RIGHT:
+        case AIR_SIGNED_SHIFT_RIGHT:
+            return P_RIGHT_SHIFT;
+        case AIR_LESS: return P_LESS;
+        case AIR_LESS_EQUAL: return P_LESS_EQUAL;
+        case AIR_GREATER: return P_GREATER;
+        case AIR_GREATER_EQUAL: return P_GREATER_EQUAL;
+        case AIR_EQUAL: return P_EQUAL;
+        case AIR_INEQUAL: return P_INEQUAL;
+        default: return P_NO_ELEMENTS;
+    }
+}
+
+static punctuator_type_t unary_operator(air_insn_t* insn)
+{
+    switch (insn->type)
+    {
+        case AIR_NEGATE: return P_MINUS;
+        case AIR_POSATE: return P_PLUS;
+        case AIR_COMPLEMENT: return P_TILDE;
+        case AIR_NOT: return P_EXCLAMATION_POINT;
+        default: return P_NO_ELEMENTS;
+    }
+}
+
+static bool is_conversion(air_insn_t* insn)
+{
+    switch (insn->type)
+    {
+        case AIR_SEXT:
+        case AIR_ZEXT:
+        case AIR_S2D:
+        case AIR_D2S:
+        case AIR_S2SI:
+        case AIR_S2UI:
+        case AIR_D2SI:
+        case AIR_D2UI:
+        case AIR_SI2S:
+        case AIR_UI2S:
+        case AIR_SI2D:
+        case AIR_UI2D:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static lattice_t evaluate_load(propagator_t* p, air_insn_t* insn)
+{
+    air_insn_operand_t* src = insn->ops[1];
+    switch (src->type)
+    {
+        case AOP_INTEGER_CONSTANT:
+            if (!type_is_integer(insn->ct))
+                return overdefined();
+            return constant(constexpr_make_arithmetic(insn->ct, &src->content.ic));
+        case AOP_REGISTER:
+            return operand_value(p, src, insn->ct);
+        case AOP_SYMBOL:
+        {
+            // floating constants live in read-only data
+            air_data_t* data = map_get(p->readonly, src->content.sy);
+            if (!data || !data->sy->type || data->sy->type->class != insn->ct->class || !type_is_sse_floating(insn->ct))
+                return overdefined();
+            return constant(constexpr_make_arithmetic(insn->ct, data->data));
+        }
+        default:
+            return overdefined();
+    }
+}
+
+static lattice_t evaluate(propagator_t* p, air_insn_t* insn)
+{
+    if (insn->type == AIR_LOAD)
+        return evaluate_load(p, insn);
+
+    if (insn->type == AIR_PHI)
     {
-        // if (get_program_options()->xflag)
-            // while (constexpr_simplification(routine, air));
-        air_insn_t* last = NULL;
-        for (air_insn_t* insn = routine->insns; insn;)
+        lattice_t result = undefined();
+        for (size_t i = 1; i < insn->noops; ++i)
         {
-            if (!insn->next) last = insn;
-            air_insn_t* next = insn->next;
-            switch (insn->type)
+            lattice_t v = operand_value(p, insn->ops[i], insn->ct);
+            if (v.state == LATTICE_UNDEFINED)
+                continue;
+            if (v.state == LATTICE_OVERDEFINED || (result.state == LATTICE_CONSTANT && !constants_equal(result.value, v.value)))
             {
-                case AIR_FUNC_CALL:
-                    try_inline_fcalls(insn, routine, air);
-                    break;
-                default:
+                constexpr_delete(v.value);
+                constexpr_delete(result.value);
+                return overdefined();
+            }
+            constexpr_delete(result.value);
+            result = v;
+        }
+        return result;
+    }
+
+    lattice_t result;
+    punctuator_type_t op = binary_operator(insn);
+    if (op != P_NO_ELEMENTS && insn->noops == 3)
+    {
+        // comparisons give their operands' type separately from their result's
+        lattice_t values[2] = {
+            operand_value(p, insn->ops[1], insn->ops[1]->ct ? insn->ops[1]->ct : insn->ct),
+            operand_value(p, insn->ops[2], insn->ops[2]->ct ? insn->ops[2]->ct : insn->ct)
+        };
+        if (ops_constant(values, 2, &result))
+        {
+            // shifts are only folded the way the linearizer picked them
+            if (insn->type == AIR_SHIFT_RIGHT && type_is_signed_integer(values[0].value->ct))
+                result = overdefined();
+            else
+                result = constant(constexpr_fold_binary(op, values[0].value, values[1].value, insn->ct));
+        }
+        constexpr_delete(values[0].value);
+        constexpr_delete(values[1].value);
+        return result;
+    }
+
+    op = unary_operator(insn);
+    if ((op != P_NO_ELEMENTS || is_conversion(insn)) && insn->noops == 2)
+    {
+        // conversions read their operand as the type being converted from
+        lattice_t values[1] = { operand_value(p, insn->ops[1], op != P_NO_ELEMENTS ? insn->ct : insn->ops[1]->ct) };
+        if (ops_constant(values, 1, &result))
+            result = constant(op != P_NO_ELEMENTS ?
+                constexpr_fold_unary(op, values[0].value, insn->ct) :
+                constexpr_fold_conversion(values[0].value, insn->ct));
+        constexpr_delete(values[0].value);
+        return result;
+    }
+
+    return overdefined();
+}
+
+static void mark_executable(propagator_t* p, air_block_t* block)
+{
+    if (!block || p->executable[block->id])
+        return;
+    p->executable[block->id] = true;
+    vector_add(p->blocks, block);
+}
+
+// takes ownership of the value's constant
+static void lower(propagator_t* p, regid_t reg, lattice_t value)
+{
+    lattice_t* current = map_get(p->values, (void*) reg);
+    lattice_state_t state = current ? current->state : LATTICE_UNDEFINED;
+    if (value.state == LATTICE_CONSTANT && state == LATTICE_CONSTANT && !constants_equal(current->value, value.value))
+    {
+        constexpr_delete(value.value);
+        value = overdefined();
+    }
+    if (value.state <= state)
+    {
+        constexpr_delete(value.value);
+        return;
+    }
+    if (!current)
+    {
+        current = calloc(1, sizeof *current);
+        map_add(p->values, (void*) reg, current);
+    }
+    constexpr_delete(current->value);
+    *current = value;
+    vector_t* uses = air_defuse_uses(p->du, reg);
+    if (uses)
+        vector_concat(p->insns, uses);
+}
+
+// the label a jump table goes to for a known index, or NULL if the index is past the end of the table
+static air_insn_operand_t* table_target(air_insn_t* insn, constexpr_t* index)
+{
+    uint64_t i = constexpr_as_u64(index);
+    return i < insn->noops - 1 ? insn->ops[i + 1] : NULL;
+}
+
+static bool labels_equal(air_insn_operand_t* op1, air_insn_operand_t* op2)
+{
+    return op1->content.label.id == op2->content.label.id &&
+        op1->content.label.disambiguator == op2->content.label.disambiguator;
+}
+
+static void visit(propagator_t* p, air_insn_t* insn)
+{
+    air_block_t* block = air_cfg_block(p->cfg, insn);
+    if (air_insn_creates_temporary(insn) && insn->ops[0]->type == AOP_REGISTER)
+        lower(p, insn->ops[0]->content.reg, evaluate(p, insn));
+    if (insn != block->last)
+        return;
+    if (insn->type == AIR_JZ || insn->type == AIR_JNZ)
+    {
+        lattice_t condition = operand_value(p, insn->ops[1], insn->ct);
+        if (condition.state == LATTICE_UNDEFINED)
+            return;
+        if (condition.state == LATTICE_CONSTANT)
+        {
+            bool taken = constexpr_equals_zero(condition.value) == (insn->type == AIR_JZ);
+            constexpr_delete(condition.value);
+            air_block_t* fallthrough = air_cfg_block(p->cfg, insn->next);
+            VECTOR_FOR(air_block_t*, succ, block->successors)
+            {
+                // a jump to the very next block has it as its only successor
+                if (block->successors->size == 1 || (succ == fallthrough) != taken)
+                    mark_executable(p, succ);
+            }
+            return;
+        }
+    }
+    if (insn->type == AIR_JMP_TABLE)
+    {
+        lattice_t index = operand_value(p, insn->ops[0], insn->ct);
+        if (index.state == LATTICE_UNDEFINED)
+            return;
+        if (index.state == LATTICE_CONSTANT)
+        {
+            air_insn_operand_t* target = table_target(insn, index.value);
+            constexpr_delete(index.value);
+            if (target)
+            {
+                VECTOR_FOR(air_block_t*, succ, block->successors)
+                {
+                    if (succ->first->type == AIR_LABEL && labels_equal(succ->first->ops[0], target))
+                        mark_executable(p, succ);
+                }
+                return;
+            }
+        }
+    }
+    VECTOR_FOR(air_block_t*, succ, block->successors)
+        mark_executable(p, succ);
+}
+
+static void propagate(propagator_t* p)
+{
+    mark_executable(p, vector_get(p->cfg->blocks, 0));
+    while (p->blocks->size || p->insns->size)
+    {
+        if (p->blocks->size)
+        {
+            air_block_t* block = vector_pop(p->blocks);
+            for (air_insn_t* insn = block->first; insn; insn = insn->next)
+            {
+                visit(p, insn);
+                if (insn == block->last)
                     break;
             }
-            insn = next;
+            continue;
+        }
+        air_insn_t* insn = vector_pop(p->insns);
+        air_block_t* block = air_cfg_block(p->cfg, insn);
+        if (block && p->executable[block->id])
+            visit(p, insn);
+    }
+}
+
+// folded floating constants go in read-only data like the ones from the source, sharing any with the same value
+static symbol_t* floating_constant_symbol(propagator_t* p, constexpr_t* value)
+{
+    long long size = type_size(value->ct);
+    VECTOR_FOR(air_data_t*, rd, p->air->rodata)
+    {
+        if (rd->sy->type && rd->sy->type->class == value->ct->class && !memcmp(rd->data, value->content.data, size))
+            return rd->sy;
+    }
+    char name[7 + MAX_STRINGIFIED_INTEGER_LENGTH + 1];
+    snprintf(name, sizeof name, "__fold_fc%llu", p->air->next_available_folded_constant++);
+    symbol_t* sy = symbol_table_add(p->air->st, name, symbol_init(NULL));
+    sy->name = strdup(name);
+    sy->type = type_copy(value->ct);
+    sy->sd = SD_STATIC;
+    air_data_t* data = calloc(1, sizeof *data);
+    data->readonly = true;
+    data->sy = sy;
+    data->data = malloc(size);
+    memcpy(data->data, value->content.data, size);
+    vector_add(p->air->rodata, data);
+    map_add(p->readonly, sy, data);
+    return sy;
+}
+
+static bool is_constant_load(air_insn_t* insn)
+{
+    return insn->type == AIR_LOAD &&
+        (insn->ops[1]->type == AOP_INTEGER_CONSTANT || insn->ops[1]->type == AOP_SYMBOL);
+}
+
+static void replace_with_constant(propagator_t* p, air_insn_t* insn, constexpr_t* value)
+{
+    air_insn_operand_t* src = NULL;
+    if (type_is_integer(value->ct))
+    {
+        unsigned long long bits = 0;
+        memcpy(&bits, value->content.data, type_size(value->ct));
+        src = air_insn_integer_constant_operand_init(bits);
+    }
+    else
+        src = air_insn_symbol_operand_init(floating_constant_symbol(p, value));
+    for (size_t i = 1; i < insn->noops; ++i)
+        air_insn_operand_delete(insn->ops[i]);
+    insn->type = AIR_LOAD;
+    insn->ops[1] = src;
+    insn->noops = 2;
+}
+
+// nothing in a dead block runs, but its label can still be jumped to from other dead code being removed with it
+static bool remove_block(air_routine_t* routine, air_block_t* block)
+{
+    bool changed = false;
+    for (air_insn_t* insn = block->first; insn;)
+    {
+        air_insn_t* next = insn == block->last ? NULL : insn->next;
+        if (insn->type != AIR_DECLARE && insn != routine->insns)
+        {
+            air_insn_remove(insn);
+            changed = true;
+        }
+        insn = next;
+    }
+    return changed;
+}
+
+// a PHI can name a value from an edge that never runs, whose definition went with its block
+static void prune_phis(air_routine_t* routine)
+{
+    air_defuse_t* du = air_defuse_init(routine);
+    for (air_insn_t* insn = routine->insns; insn; insn = insn->next)
+    {
+        if (insn->type != AIR_PHI)
+            continue;
+        size_t kept = 1;
+        for (size_t i = 1; i < insn->noops; ++i)
+        {
+            air_insn_operand_t* op = insn->ops[i];
+            if (op->type == AOP_REGISTER && !air_defuse_definition(du, op->content.reg))
+                air_insn_operand_delete(op);
+            else
+                insn->ops[kept++] = op;
+        }
+        insn->noops = kept;
+        if (kept == 2)
+            insn->type = AIR_LOAD;
+    }
+    air_defuse_delete(du);
+}
+
+static bool rewrite(propagator_t* p)
+{
+    bool changed = false;
+    VECTOR_FOR(air_block_t*, block, p->cfg->blocks)
+    {
+        if (!p->executable[block->id])
+            changed |= remove_block(p->routine, block);
+    }
+    if (changed)
+        prune_phis(p->routine);
+
+    for (air_insn_t* insn = p->routine->insns; insn;)
+    {
+        air_insn_t* next = insn->next;
+        if (air_insn_creates_temporary(insn) && insn->ops[0]->type == AOP_REGISTER)
+        {
+            lattice_t* l = map_get(p->values, (void*) insn->ops[0]->content.reg);
+            if (l && l->state == LATTICE_CONSTANT && !is_constant_load(insn))
+            {
+                replace_with_constant(p, insn, l->value);
+                changed = true;
+            }
         }
-        while (last)
+        else if (insn->type == AIR_JZ || insn->type == AIR_JNZ)
         {
-            if (air_insn_creates_temporary(last))
+            lattice_t condition = operand_value(p, insn->ops[1], insn->ct);
+            if (condition.state == LATTICE_CONSTANT)
             {
-                air_insn_t* prev = last->prev;
-                try_remove_fcall_passing_lifetimes(last, routine, air);
-                last = prev;
+                bool taken = constexpr_equals_zero(condition.value) == (insn->type == AIR_JZ);
+                constexpr_delete(condition.value);
+                if (taken)
+                {
+                    air_insn_operand_delete(insn->ops[1]);
+                    insn->type = AIR_JMP;
+                    insn->noops = 1;
+                }
+                else
+                    air_insn_remove(insn);
+                changed = true;
             }
+        }
+        else if (insn->type == AIR_JMP_TABLE)
+        {
+            lattice_t index = operand_value(p, insn->ops[0], insn->ct);
+            if (index.state == LATTICE_CONSTANT)
+            {
+                air_insn_operand_t* target = table_target(insn, index.value);
+                constexpr_delete(index.value);
+                if (target)
+                {
+                    for (size_t i = 0; i < insn->noops; ++i)
+                    {
+                        if (insn->ops[i] != target)
+                            air_insn_operand_delete(insn->ops[i]);
+                    }
+                    insn->type = AIR_JMP;
+                    insn->ops[0] = target;
+                    insn->noops = 1;
+                    changed = true;
+                }
+            }
+        }
+        insn = next;
+    }
+
+    // constants that were only used to compute other constants
+    air_defuse_t* du = air_defuse_init(p->routine);
+    for (air_insn_t* insn = p->routine->insns; insn;)
+    {
+        air_insn_t* next = insn->next;
+        if (is_constant_load(insn) && insn->ops[0]->type == AOP_REGISTER && !air_defuse_uses(du, insn->ops[0]->content.reg))
+        {
+            lattice_t* l = map_get(p->values, (void*) insn->ops[0]->content.reg);
+            if (l && l->state == LATTICE_CONSTANT)
+            {
+                air_insn_remove(insn);
+                changed = true;
+            }
+        }
+        insn = next;
+    }
+    air_defuse_delete(du);
+
+    return changed;
+}
+
+static bool propagate_constants(air_routine_t* routine, map_t* readonly, air_t* air)
+{
+    propagator_t p = {
+        .routine = routine,
+        .air = air,
+        .cfg = air_routine_cfg(routine),
+        .du = air_defuse_init(routine),
+        .readonly = readonly,
+        .values = map_init((comparator_t) regid_comparator, (hash_function_t) regid_hash),
+        .blocks = vector_init(),
+        .insns = vector_init()
+    };
+    p.executable = calloc(p.cfg->blocks->size, sizeof(bool));
+    map_set_deleters(p.values, NULL, (deleter_t) lattice_delete);
+
+    propagate(&p);
+    bool changed = rewrite(&p);
+
+    air_defuse_delete(p.du);
+    map_delete(p.values);
+    free(p.executable);
+    vector_delete(p.blocks);
+    vector_delete(p.insns);
+    return changed;
+}
+
+/*
+
+dead code and dead store elimination.
+
+first, blocks that can't be reached from the entry are removed, like code after a return or goto that no label
+leads back into.
+
+then stores to local variables that are overwritten or go out of scope before being read are removed. this is
+only done for automatic, non-volatile variables whose address doesn't escape, meaning every access to them is
+either by name or through an address made by adding to &x, so a liveness analysis over the CFG (solved the same way as for registers, see liveness.c) sees all of their
+reads. a store to the whole variable ends its liveness and a store to part of it (a member, an element) doesn't,
+but either is removed if the variable isn't live after it.
+
+last, temporaries that are never used are removed, as long as computing them produces no side effect. this marks
+everything that has to stay and what it uses, so chains of temporaries that only feed each other go together.
+
+*/
+
+typedef struct address
+{
+    symbol_t* sy;
+    long long offset;
+    bool known; // whether the offset is known
+} address_t;
+
+typedef struct eliminator
+{
+    air_routine_t* routine;
+    air_cfg_t* cfg;
+    map_t* addresses; // map_t<regid_t, address_t*>, temporaries holding an address into a local variable
+    map_t* escaped; // map_t<symbol_t*, symbol_t*>
+    map_t* indices; // map_t<symbol_t*, size_t>, one more than the variable's index in tracked
+    vector_t* tracked; // vector_t<symbol_t*>
+    size_t words; // per liveness set
+} eliminator_t;
+
+static bool is_volatile(c_type_t* ct)
+{
+    return ct && (ct->qualifiers & TQ_B_VOLATILE);
+}
+
+static bool is_local(symbol_t* sy)
+{
+    return symbol_get_storage_duration(sy) == SD_AUTOMATIC && !is_volatile(sy->type);
+}
+
+static address_t* register_address(eliminator_t* e, air_insn_operand_t* op)
+{
+    if (!op || op->type != AOP_REGISTER)
+        return NULL;
+    return map_get(e->addresses, (void*) op->content.reg);
+}
+
+static void escape(eliminator_t* e, symbol_t* sy)
+{
+    if (!map_get(e->escaped, sy))
+        map_add(e->escaped, sy, sy);
+}
+
+static void find_addresses(eliminator_t* e)
+{
+    for (air_insn_t* insn = e->routine->insns; insn; insn = insn->next)
+    {
+        if (!air_insn_creates_temporary(insn) || insn->ops[0]->type != AOP_REGISTER)
+            continue;
+        address_t a = { NULL, 0, true };
+        if (insn->type == AIR_LOAD_ADDR)
+        {
+            air_insn_operand_t* op = insn->ops[1];
+            if (op->type == AOP_SYMBOL)
+                a.sy = op->content.sy;
+            else if (op->type == AOP_INDIRECT_SYMBOL)
+            {
+                a.sy = op->content.insy.sy;
+                a.offset = op->content.insy.offset;
+            }
+            if (!a.sy || !is_local(a.sy))
+                continue;
+        }
+        else if (insn->type == AIR_ADD || insn->type == AIR_SUBTRACT)
+        {
+            address_t* base = register_address(e, insn->ops[1]);
+            air_insn_operand_t* other = insn->ops[2];
+            if (!base && insn->type == AIR_ADD)
+            {
+                base = register_address(e, insn->ops[2]);
+                other = insn->ops[1];
+            }
+            if (!base || register_address(e, other))
+                continue;
+            a = *base;
+            if (other->type == AOP_INTEGER_CONSTANT)
+                a.offset += insn->type == AIR_ADD ? (long long) other->content.ic : -(long long) other->content.ic;
             else
-                last = last->prev;
+                a.known = false;
         }
+        else
+            continue;
+        address_t* entry = malloc(sizeof *entry);
+        *entry = a;
+        map_add(e->addresses, (void*) insn->ops[0]->content.reg, entry);
+    }
+}
+
+// a variable's address escapes if it's used for anything other than accessing the variable or making another address into it
+static void find_escapes(eliminator_t* e)
+{
+    for (air_insn_t* insn = e->routine->insns; insn; insn = insn->next)
+    {
+        bool derives = (insn->type == AIR_ADD || insn->type == AIR_SUBTRACT) && register_address(e, insn->ops[0]);
+        size_t i = air_insn_creates_temporary(insn) && insn->noops && insn->ops[0] && insn->ops[0]->type == AOP_REGISTER ? 1 : 0;
+        for (; i < insn->noops; ++i)
+        {
+            air_insn_operand_t* op = insn->ops[i];
+            if (!op) continue;
+            address_t* a = NULL;
+            switch (op->type)
+            {
+                case AOP_REGISTER:
+                    if ((a = register_address(e, op)) && !derives)
+                        escape(e, a->sy);
+                    break;
+                case AOP_INDIRECT_REGISTER:
+                    if ((a = map_get(e->addresses, (void*) op->content.inreg.roffset)))
+                        escape(e, a->sy);
+                    break;
+                case AOP_SYMBOL:
+                    // arrays and functions named on their own are their address
+                    if (insn->type != AIR_DECLARE && insn->type != AIR_MEMSET && !(insn->type == AIR_ASSIGN && i == 0) &&
+                        (op->content.sy->type->class == CTC_ARRAY || op->content.sy->type->class == CTC_FUNCTION))
+                        escape(e, op->content.sy);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+static void find_tracked(eliminator_t* e)
+{
+    for (air_insn_t* insn = e->routine->insns; insn; insn = insn->next)
+    {
+        if (insn->type != AIR_DECLARE || insn->ops[0]->type != AOP_SYMBOL)
+            continue;
+        symbol_t* sy = insn->ops[0]->content.sy;
+        if (!is_local(sy) || map_get(e->escaped, sy) || map_get(e->indices, sy))
+            continue;
+        vector_add(e->tracked, sy);
+        map_add(e->indices, sy, (void*) (size_t) e->tracked->size);
+    }
+    e->words = BITSET_WORDS(e->tracked->size);
+}
+
+// 0 if the variable isn't tracked
+static size_t tracked_index(eliminator_t* e, symbol_t* sy)
+{
+    return (size_t) map_get(e->indices, sy);
+}
+
+static void eliminator_init(eliminator_t* e, air_routine_t* routine)
+{
+    e->routine = routine;
+    e->cfg = air_routine_cfg(routine);
+    e->addresses = map_init((comparator_t) regid_comparator, (hash_function_t) regid_hash);
+    e->escaped = map_init(pointer_comparator, pointer_hash);
+    e->indices = map_init(pointer_comparator, pointer_hash);
+    e->tracked = vector_init();
+    map_set_deleters(e->addresses, NULL, free);
+    find_addresses(e);
+    find_escapes(e);
+    find_tracked(e);
+}
+
+static void eliminator_delete(eliminator_t* e)
+{
+    map_delete(e->addresses);
+    map_delete(e->escaped);
+    map_delete(e->indices);
+    vector_delete(e->tracked);
+}
+
+// the tracked variable an instruction stores to, if any, and whether the store covers all of it
+static size_t find_store(eliminator_t* e, air_insn_t* insn, bool* whole)
+{
+    *whole = false;
+    if (insn->type == AIR_MEMSET)
+    {
+        air_insn_operand_t* op = insn->ops[1];
+        if (op->type != AOP_SYMBOL)
+            return 0;
+        size_t index = tracked_index(e, op->content.sy);
+        *whole = insn->ops[2]->type == AOP_INTEGER_CONSTANT &&
+            insn->ops[2]->content.ic == (unsigned long long) type_size(op->content.sy->type);
+        return index;
+    }
+    if (insn->type != AIR_ASSIGN)
+        return 0;
+    air_insn_operand_t* op = insn->ops[0];
+    if (is_volatile(insn->ct))
+        return 0;
+    switch (op->type)
+    {
+        case AOP_SYMBOL:
+            *whole = true;
+            return tracked_index(e, op->content.sy);
+        case AOP_INDIRECT_SYMBOL:
+        {
+            symbol_t* sy = op->content.insy.sy;
+            *whole = op->content.insy.offset == 0 && type_size(insn->ct) == type_size(sy->type);
+            return tracked_index(e, sy);
+        }
+        case AOP_INDIRECT_REGISTER:
+        {
+            address_t* a = map_get(e->addresses, (void*) op->content.inreg.id);
+            if (!a)
+                return 0;
+            *whole = a->known && a->offset + op->content.inreg.offset == 0 && op->content.inreg.roffset == INVALID_VREGID &&
+                type_size(insn->ct) == type_size(a->sy->type);
+            return tracked_index(e, a->sy);
+        }
+        default:
+            return 0;
+    }
+}
+
+// adds the tracked variables an instruction reads to a set, skipping the operand it stores through.
+// taking a variable's address isn't a read, since whatever is done with the address is seen separately
+static void add_reads(eliminator_t* e, air_insn_t* insn, unsigned long long* set)
+{
+    if (insn->type == AIR_DECLARE || insn->type == AIR_LOAD_ADDR)
+        return;
+    bool whole = false;
+    size_t i = find_store(e, insn, &whole) ? (insn->type == AIR_MEMSET ? 2 : 1) : 0;
+    for (; i < insn->noops; ++i)
+    {
+        air_insn_operand_t* op = insn->ops[i];
+        if (!op) continue;
+        size_t index = 0;
+        switch (op->type)
+        {
+            case AOP_SYMBOL:
+                index = tracked_index(e, op->content.sy);
+                break;
+            case AOP_INDIRECT_SYMBOL:
+                index = tracked_index(e, op->content.insy.sy);
+                break;
+            case AOP_INDIRECT_REGISTER:
+            {
+                address_t* a = map_get(e->addresses, (void*) op->content.inreg.id);
+                if (a)
+                    index = tracked_index(e, a->sy);
+                break;
+            }
+            default:
+                break;
+        }
+        if (index)
+            BITSET_ADD(set, index);
+    }
+}
+
+// one step of liveness backwards over an instruction
+static void transfer(eliminator_t* e, air_insn_t* insn, unsigned long long* live)
+{
+    bool whole = false;
+    size_t index = find_store(e, insn, &whole);
+    if (index && whole)
+        BITSET_REMOVE(live, index);
+    add_reads(e, insn, live);
+}
+
+static bool remove_dead_stores(eliminator_t* e)
+{
+    size_t count = e->cfg->blocks->size;
+    unsigned long long* in = calloc(count * e->words, sizeof(unsigned long long));
+    unsigned long long* out = calloc(count * e->words, sizeof(unsigned long long));
+    unsigned long long* live = malloc(e->words * sizeof(unsigned long long));
+    size_t size = e->words * sizeof(unsigned long long);
+    air_cfg_solve_backward(e->cfg, e->words, in, out, (void (*)(void*, air_insn_t*, unsigned long long*)) transfer, e);
+
+    bool changed = false;
+    VECTOR_FOR(air_block_t*, block, e->cfg->rpo)
+    {
+        memcpy(live, out + block->id * e->words, size);
+        for (air_insn_t* insn = block->last; insn;)
+        {
+            air_insn_t* prev = insn == block->first ? NULL : insn->prev;
+            bool whole = false;
+            size_t index = find_store(e, insn, &whole);
+            if (index && !BITSET_HAS(live, index) && insn != e->routine->insns)
+            {
+                air_insn_remove(insn);
+                changed = true;
+            }
+            else
+                transfer(e, insn, live);
+            insn = prev;
+        }
+    }
+
+    free(in);
+    free(out);
+    free(live);
+    return changed;
+}
+
+static bool is_removable(air_insn_t* insn)
+{
+    if (!air_insn_creates_temporary(insn) || air_insn_produces_side_effect(insn))
+        return false;
+    if (insn->ops[0]->type != AOP_REGISTER)
+        return false;
+    switch (insn->type)
+    {
+        case AIR_LSYSCALL:
+        case AIR_DECLARE_REGISTER:
+        case AIR_BLIP:
+            return false;
+        default:
+            break;
+    }
+    return !is_volatile(insn->ct);
+}
+
+static void mark_definitions(air_defuse_t* du, regid_t reg, bool* live, vector_t* worklist)
+{
+    if (reg == INVALID_VREGID)
+        return;
+    vector_t* defs = air_defuse_definitions(du, reg);
+    if (!defs)
+        return;
+    VECTOR_FOR(air_insn_t*, def, defs)
+    {
+        size_t position = air_defuse_position(du, def);
+        if (live[position])
+            continue;
+        live[position] = true;
+        vector_add(worklist, def);
+    }
+}
+
+static bool remove_unused_temporaries(air_routine_t* routine)
+{
+    air_defuse_t* du = air_defuse_init(routine);
+    bool* live = calloc(du->positions->size, sizeof(bool));
+    vector_t* worklist = vector_init();
+    for (air_insn_t* insn = routine->insns; insn; insn = insn->next)
+    {
+        if (is_removable(insn))
+            continue;
+        live[air_defuse_position(du, insn)] = true;
+        vector_add(worklist, insn);
+    }
+    while (worklist->size)
+    {
+        air_insn_t* insn = vector_pop(worklist);
+        size_t i = air_insn_creates_temporary(insn) && insn->noops && insn->ops[0] && insn->ops[0]->type == AOP_REGISTER ? 1 : 0;
+        for (; i < insn->noops; ++i)
+        {
+            air_insn_operand_t* op = insn->ops[i];
+            if (!op) continue;
+            if (op->type == AOP_REGISTER)
+                mark_definitions(du, op->content.reg, live, worklist);
+            else if (op->type == AOP_INDIRECT_REGISTER)
+            {
+                mark_definitions(du, op->content.inreg.id, live, worklist);
+                mark_definitions(du, op->content.inreg.roffset, live, worklist);
+            }
+        }
+    }
+
+    bool changed = false;
+    for (air_insn_t* insn = routine->insns; insn;)
+    {
+        air_insn_t* next = insn->next;
+        if (!live[air_defuse_position(du, insn)] && insn != routine->insns)
+        {
+            air_insn_remove(insn);
+            changed = true;
+        }
+        insn = next;
+    }
+
+    vector_delete(worklist);
+    free(live);
+    air_defuse_delete(du);
+    return changed;
+}
+
+static bool eliminate_dead_code(air_routine_t* routine)
+{
+    bool changed = false;
+    air_cfg_t* cfg = air_routine_cfg(routine);
+    VECTOR_FOR(air_block_t*, block, cfg->blocks)
+    {
+        if (!block->reachable)
+            changed |= remove_block(routine, block);
+    }
+    if (changed)
+        air_routine_invalidate_cfg(routine);
+
+    // nothing after this looks at the CFG, so it's left for the pass manager to throw away
+    eliminator_t e;
+    eliminator_init(&e, routine);
+    if (e.tracked->size && remove_dead_stores(&e))
+        changed = true;
+    eliminator_delete(&e);
+
+    if (remove_unused_temporaries(routine))
+        changed = true;
+    return changed;
+}
+
+/*
+
+global value numbering.
+
+the linearizer recomputes an expression every time it's written, so using `p->field[i]` twice loads p and i
+twice and builds the same address twice. temporaries are in SSA form, so two instructions applying the same pure
+operation to the same operands compute the same value, and the later one can use the earlier one's instead if
+the earlier one dominates it. the dominator tree is walked with a scoped table of the expressions available in
+each block, so a value computed in one arm of an if isn't reused in the other.
+
+loads are values too, but only until something may have written what they read, so they're only reused within
+a block. a local variable whose address never escapes (see find_escapes) can only be read or written by name or
+through addresses made from its own, so a store to one only invalidates loads of it. anything else that may
+write memory, function calls included, invalidates every load except those of such variables.
+
+the earlier instruction also has to come first in the routine, since the allocator orders live ranges by
+position and the linearizer puts a loop's condition after its body even though the condition dominates it.
+it can't be too far back either, since every value kept for reuse is another register held until then.
+temporaries feeding PHIs are left alone, since PHI removal merges them with the PHI's result.
+
+*/
+
+typedef struct value_operand
+{
+    air_insn_operand_type_t type;
+    int class; // -1 if the operand is untyped
+    unsigned long long value; // the register, constant, or symbol
+    regid_t roffset;
+    long long offset;
+    long long factor;
+} value_operand_t;
+
+// compared and hashed bytewise, so always zeroed before being filled in
+typedef struct expression
+{
+    air_insn_type_t type;
+    int class;
+    value_operand_t ops[2];
+} expression_t;
+
+typedef struct leader
+{
+    air_insn_t* insn;
+    symbol_t* sy; // the variable a load reads, if it's one
+} leader_t;
+
+typedef struct numberer
+{
+    air_routine_t* routine;
+    air_defuse_t* du;
+    eliminator_t aliases;
+    map_t* available; // map_t<expression_t*, leader_t*>, pure expressions computed in dominating blocks
+    map_t* loads; // map_t<expression_t*, leader_t*>, loads still valid in the current block
+    vector_t* redundant; // vector_t<air_insn_t*>
+} numberer_t;
+
+static int expression_comparator(expression_t* a, expression_t* b)
+{
+    return memcmp(a, b, sizeof *a) != 0;
+}
+
+static unsigned long expression_hash(expression_t* e)
+{
+    unsigned long h = 14695981039346656037UL;
+    unsigned char* bytes = (unsigned char*) e;
+    for (size_t i = 0; i < sizeof *e; ++i)
+        h = (h ^ bytes[i]) * 1099511628211UL;
+    return h;
+}
+
+static map_t* expression_map_init(void)
+{
+    map_t* m = map_init((comparator_t) expression_comparator, (hash_function_t) expression_hash);
+    map_set_deleters(m, free, free);
+    return m;
+}
+
+static bool is_pure(air_insn_t* insn)
+{
+    return binary_operator(insn) != P_NO_ELEMENTS || unary_operator(insn) != P_NO_ELEMENTS ||
+        is_conversion(insn) || insn->type == AIR_LOAD_ADDR;
+}
+
+static bool is_commutative(air_insn_type_t type)
+{
+    switch (type)
+    {
+        case AIR_ADD:
+        case AIR_MULTIPLY:
+        case AIR_AND:
+        case AIR_OR:
+        case AIR_XOR:
+        case AIR_EQUAL:
+        case AIR_INEQUAL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool number_operand(value_operand_t* vo, air_insn_operand_t* op)
+{
+    vo->type = op->type;
+    vo->class = op->ct ? (int) op->ct->class : -1;
+    switch (op->type)
+    {
+        case AOP_REGISTER:
+            vo->value = op->content.reg;
+            return true;
+        case AOP_INTEGER_CONSTANT:
+            vo->value = op->content.ic;
+            return true;
+        case AOP_SYMBOL:
+            vo->value = (unsigned long long) (size_t) op->content.sy;
+            return true;
+        case AOP_INDIRECT_REGISTER:
+            vo->value = op->content.inreg.id;
+            vo->roffset = op->content.inreg.roffset;
+            vo->offset = op->content.inreg.offset;
+            vo->factor = op->content.inreg.factor;
+            return true;
+        case AOP_INDIRECT_SYMBOL:
+            vo->value = (unsigned long long) (size_t) op->content.insy.sy;
+            vo->offset = op->content.insy.offset;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// the expression an instruction computes, or NULL if it isn't one that can be numbered
+static expression_t* expression_init(air_insn_t* insn)
+{
+    if (insn->noops < 2 || insn->noops > 3 || !insn->ct)
+        return NULL;
+    expression_t* e = calloc(1, sizeof *e);
+    e->type = insn->type;
+    e->class = insn->ct->class;
+    for (size_t i = 1; i < insn->noops; ++i)
+    {
+        if (!number_operand(&e->ops[i - 1], insn->ops[i]))
+        {
+            free(e);
+            return NULL;
+        }
+    }
+    if (insn->noops == 3 && is_commutative(insn->type) && memcmp(&e->ops[0], &e->ops[1], sizeof e->ops[0]) > 0)
+    {
+        value_operand_t tmp = e->ops[0];
+        e->ops[0] = e->ops[1];
+        e->ops[1] = tmp;
+    }
+    return e;
+}
+
+// whether an instruction is a load that can be reused, and the variable it reads if that's known
+static bool is_load(eliminator_t* e, air_insn_t* insn, symbol_t** sy)
+{
+    if (insn->type != AIR_LOAD || !type_is_scalar(insn->ct) || is_volatile(insn->ct))
+        return false;
+    air_insn_operand_t* op = insn->ops[1];
+    switch (op->type)
+    {
+        case AOP_SYMBOL:
+            *sy = op->content.sy;
+            return type_is_scalar((*sy)->type) && !is_volatile((*sy)->type);
+        case AOP_INDIRECT_SYMBOL:
+            *sy = op->content.insy.sy;
+            return !is_volatile((*sy)->type);
+        case AOP_INDIRECT_REGISTER:
+        {
+            address_t* a = map_get(e->addresses, (void*) op->content.inreg.id);
+            *sy = a ? a->sy : NULL;
+            return !is_volatile(op->ct);
+        }
+        default:
+            return false;
+    }
+}
+
+// local variables whose address never escapes can only be written by name or through an address into them
+static bool is_private(eliminator_t* e, symbol_t* sy)
+{
+    return sy && is_local(sy) && !map_get(e->escaped, sy);
+}
+
+static bool used_by_phi(air_defuse_t* du, regid_t reg)
+{
+    vector_t* uses = air_defuse_uses(du, reg);
+    if (!uses) return false;
+    VECTOR_FOR(air_insn_t*, use, uses)
+    {
+        if (use->type == AIR_PHI)
+            return true;
+    }
+    return false;
+}
+
+// the variable a store writes, if it's known
+static symbol_t* store_target(eliminator_t* e, air_insn_t* insn)
+{
+    air_insn_operand_t* op = insn->ops[insn->type == AIR_MEMSET ? 1 : 0];
+    switch (op->type)
+    {
+        case AOP_SYMBOL:
+            return op->content.sy;
+        case AOP_INDIRECT_SYMBOL:
+            return op->content.insy.sy;
+        case AOP_INDIRECT_REGISTER:
+        {
+            address_t* a = map_get(e->addresses, (void*) op->content.inreg.id);
+            return a ? a->sy : NULL;
+        }
+        default:
+            return NULL;
+    }
+}
+
+static bool writes_memory(air_insn_t* insn)
+{
+    switch (insn->type)
+    {
+        case AIR_DECLARE:
+        case AIR_NOP:
+        case AIR_LABEL:
+        case AIR_JMP:
+        case AIR_JMP_TABLE:
+        case AIR_JZ:
+        case AIR_JNZ:
+        case AIR_RETURN:
+        case AIR_SEQUENCE_POINT:
+        case AIR_PHI:
+            return false;
+        default:
+            return !air_insn_creates_temporary(insn) || air_insn_produces_side_effect(insn) || insn->type == AIR_LSYSCALL;
+    }
+}
+
+static bool is_store(air_insn_t* insn)
+{
+    return insn->type == AIR_ASSIGN || insn->type == AIR_MEMSET ||
+        (insn->type >= AIR_DIRECT_ADD && insn->type <= AIR_DIRECT_OR);
+}
+
+static void invalidate_loads(numberer_t* n, air_insn_t* insn)
+{
+    if (!writes_memory(insn))
+        return;
+    symbol_t* target = is_store(insn) ? store_target(&n->aliases, insn) : NULL;
+    if (!is_private(&n->aliases, target))
+        target = NULL;
+    MAP_FOR(expression_t*, leader_t*, n->loads)
+    {
+        if (MAP_IS_BAD_KEY) continue;
+        bool survives = target ? v->sy != target : is_private(&n->aliases, v->sy);
+        if (!survives)
+            map_remove(n->loads, k);
+    }
+}
+
+static void replace_uses(numberer_t* n, regid_t from, regid_t to)
+{
+    vector_t* uses = air_defuse_uses(n->du, from);
+    if (!uses) return;
+    VECTOR_FOR(air_insn_t*, use, uses)
+    {
+        for (size_t j = 0; j < use->noops; ++j)
+        {
+            air_insn_operand_t* op = use->ops[j];
+            if (!op) continue;
+            if (op->type == AOP_REGISTER && op->content.reg == from)
+                op->content.reg = to;
+            else if (op->type == AOP_INDIRECT_REGISTER)
+            {
+                if (op->content.inreg.id == from)
+                    op->content.inreg.id = to;
+                if (op->content.inreg.roffset == from)
+                    op->content.inreg.roffset = to;
+            }
+        }
+    }
+}
+
+static bool precedes(numberer_t* n, air_insn_t* a, air_insn_t* b)
+{
+    return air_defuse_position(n->du, a) < air_defuse_position(n->du, b);
+}
+
+// the allocator can't spill, so a value is only reused close enough to where it was computed to keep register pressure down
+#define REUSE_DISTANCE 32
+
+static bool reusable(numberer_t* n, air_insn_t* leader, air_insn_t* insn)
+{
+    return precedes(n, leader, insn) && air_defuse_position(n->du, insn) - air_defuse_position(n->du, leader) <= REUSE_DISTANCE;
+}
+
+// uses the table's earlier computation of the instruction's value if there is one, otherwise makes it the leader
+static void number(numberer_t* n, air_insn_t* insn, map_t* table, expression_t* e, symbol_t* sy, vector_t* scope)
+{
+    leader_t* leader = map_get(table, e);
+    if (leader)
+    {
+        if (reusable(n, leader->insn, insn))
+        {
+            replace_uses(n, insn->ops[0]->content.reg, leader->insn->ops[0]->content.reg);
+            vector_add(n->redundant, insn);
+        }
+        free(e);
+        return;
+    }
+    leader = malloc(sizeof *leader);
+    leader->insn = insn;
+    leader->sy = sy;
+    map_add(table, e, leader);
+    if (scope)
+        vector_add(scope, e);
+}
+
+static void number_block(numberer_t* n, air_block_t* block)
+{
+    vector_t* scope = vector_init();
+    n->loads = expression_map_init();
+    for (air_insn_t* insn = block->first; insn; insn = insn == block->last ? NULL : insn->next)
+    {
+        if (air_insn_creates_temporary(insn) && insn->noops && insn->ops[0]->type == AOP_REGISTER &&
+            insn->ops[0]->content.reg != INVALID_VREGID && !used_by_phi(n->du, insn->ops[0]->content.reg))
+        {
+            regid_t reg = insn->ops[0]->content.reg;
+            symbol_t* sy = NULL;
+            if (insn->type == AIR_LOAD && insn->ops[1]->type == AOP_REGISTER)
+            {
+                // copies just get replaced by what they copy
+                air_insn_t* def = air_defuse_definition(n->du, insn->ops[1]->content.reg);
+                if (def && def->ct && insn->ct && def->ct->class == insn->ct->class && reusable(n, def, insn) &&
+                    !used_by_phi(n->du, insn->ops[1]->content.reg))
+                {
+                    replace_uses(n, reg, insn->ops[1]->content.reg);
+                    vector_add(n->redundant, insn);
+                }
+            }
+            else if (is_pure(insn) && !is_volatile(insn->ct))
+            {
+                expression_t* e = expression_init(insn);
+                if (e) number(n, insn, n->available, e, NULL, scope);
+            }
+            else if (is_load(&n->aliases, insn, &sy))
+            {
+                expression_t* e = expression_init(insn);
+                if (e) number(n, insn, n->loads, e, sy, NULL);
+            }
+        }
+        invalidate_loads(n, insn);
+    }
+    map_delete(n->loads);
+
+    VECTOR_FOR(air_block_t*, child, block->dominated)
+        number_block(n, child);
+
+    VECTOR_FOR(expression_t*, e, scope)
+        map_remove(n->available, e);
+    vector_delete(scope);
+}
+
+static bool number_values(air_routine_t* routine)
+{
+    numberer_t n = {
+        .routine = routine,
+        .du = air_defuse_init(routine),
+        .available = expression_map_init(),
+        .redundant = vector_init()
+    };
+    eliminator_init(&n.aliases, routine);
+    number_block(&n, vector_get(n.aliases.cfg->blocks, 0));
+
+    bool changed = n.redundant->size > 0;
+    VECTOR_FOR(air_insn_t*, insn, n.redundant)
+        air_insn_remove(insn);
+
+    eliminator_delete(&n.aliases);
+    map_delete(n.available);
+    vector_delete(n.redundant);
+    air_defuse_delete(n.du);
+    return changed;
+}
+
+/*
+
+loop-invariant code motion and induction variable strength reduction.
+
+loops are the natural loops found by cfg.c, taken inner loops first, and only ones with a preheader whose end
+runs right before the loop is entered. an instruction in the loop whose value is the same on every iteration is
+moved there so it's computed once. a pure operation is invariant when its operands are, and a load is when
+nothing in the loop may write what it reads: for a local variable whose address never escapes, that means the
+loop doesn't store to it, and for anything else, that the loop stores to nothing but such variables and makes no
+calls. something that can fault, like a load through a pointer or a division, is only hoisted out of a block that
+runs whenever the loop is entered, so a loop that may run zero times can't start faulting.
+
+every hoisted value is held in a register for as long as the loop runs, and the allocator can't spill, so values
+are only hoisted while few enough temporaries are live at once in the loop. constants and addresses of variables
+cost as much to hold as to remake and are left where they are, as are floating values, which have fewer
+registers to go around.
+
+then strength reduction: a local int or long that the loop only writes by adding a constant to it once per
+iteration is an induction variable, and an index made by scaling it that only feeds an address with an invariant
+base gets a pointer of its own. for example:
+    for (int i = 0; i < n; ++i) s += a[i];
+loads i and multiplies it by 4 on every iteration to make the address into a. instead, a pointer set to a + i * 4
+before the loop is bumped by 4 right after i is, and the address is a load of it.
+
+*/
+
+// the allocator can't spill, so hoisting stops once this many temporaries would be live at once in a loop
+#define PRESSURE_LIMIT 6
+
+typedef struct loop_optimizer
+{
+    air_routine_t* routine;
+    air_t* air;
+    air_defuse_t* du;
+    eliminator_t aliases;
+    air_loop_t* loop;
+    air_insn_t* entry; // where code for the preheader goes
+    map_t* written; // map_t<symbol_t*, vector_t<air_insn_t*>*>, private variables stored to in the loop
+    bool clobbers; // whether the loop may write memory other than private variables
+    bool calls; // whether the loop has something that might not return, like a call
+} loop_optimizer_t;
+
+typedef struct reduction
+{
+    air_insn_t* index; // the scaled induction variable
+    air_insn_t* load; // the induction variable load it scales
+    air_insn_t* widen; // the load's sign extension to the index's width, if a subscript made one
+    long long scale;
+    regid_t base;
+    vector_t* uses; // vector_t<air_insn_t*>
+} reduction_t;
+
+// the preheader's jump into the loop, or the loop's first label if the preheader falls into it
+static air_insn_t* find_entry(air_loop_t* loop)
+{
+    air_block_t* pre = loop->preheader;
+    air_block_t* first = vector_get(loop->blocks, 0);
+    if (!pre || pre->id >= first->id)
+        return NULL;
+    switch (pre->last->type)
+    {
+        case AIR_JMP:
+            return pre->last;
+        case AIR_RETURN:
+        case AIR_JMP_TABLE:
+            return NULL;
+        case AIR_JZ:
+        case AIR_JNZ:
+            // a conditional jump that goes to the header either way leaves nowhere to put code only on the way in
+            if (pre->successors->size != 2)
+                return NULL;
+            // fall through
+        default:
+            return pre->id + 1 == loop->header->id ? loop->header->first : NULL;
+    }
+}
+
+static bool in_loop(loop_optimizer_t* o, air_insn_t* insn)
+{
+    air_block_t* block = air_cfg_block(o->aliases.cfg, insn);
+    return block && o->loop->contains[block->id];
+}
+
+static void find_loop_writes(loop_optimizer_t* o)
+{
+    VECTOR_FOR(air_block_t*, block, o->loop->blocks)
+    {
+        for (air_insn_t* insn = block->first; insn; insn = insn == block->last ? NULL : insn->next)
+        {
+            if (!writes_memory(insn))
+                continue;
+            symbol_t* target = is_store(insn) ? store_target(&o->aliases, insn) : NULL;
+            if (!is_store(insn))
+                o->calls = true;
+            if (!is_private(&o->aliases, target))
+            {
+                o->clobbers = true;
+                continue;
+            }
+            vector_t* stores = map_get(o->written, target);
+            if (!stores)
+                map_add(o->written, target, stores = vector_init());
+            vector_add(stores, insn);
+        }
+    }
+}
+
+// whether a block runs whenever the loop is entered, before the loop can be left
+static bool always_runs(loop_optimizer_t* o, air_block_t* block)
+{
+    if (o->calls)
+        return false;
+    VECTOR_FOR(air_block_t*, b, o->loop->blocks)
+    {
+        bool exits = !b->successors->size;
+        VECTOR_FOR(air_block_t*, succ, b->successors)
+        {
+            if (!o->loop->contains[succ->id])
+                exits = true;
+        }
+        if (exits && !air_block_dominates(block, b))
+            return false;
+    }
+    VECTOR_FOR(air_block_t*, latch, o->loop->latches)
+    {
+        if (!air_block_dominates(block, latch))
+            return false;
+    }
+    return true;
+}
+
+static bool is_immediate_load(air_insn_t* insn)
+{
+    return insn->type == AIR_LOAD && insn->ops[1]->type == AOP_INTEGER_CONSTANT;
+}
+
+// whether a register has the same value everywhere in the loop and is available at its entry
+static bool invariant_register(loop_optimizer_t* o, regid_t reg, map_t* hoisted)
+{
+    if (reg == INVALID_VREGID)
+        return true;
+    air_insn_t* def = air_defuse_definition(o->du, reg);
+    if (!def)
+        return false;
+    // constants get loaded again wherever they're needed
+    if ((hoisted && map_get(hoisted, def)) || is_immediate_load(def))
+        return true;
+    return !in_loop(o, def) && air_defuse_position(o->du, def) < air_defuse_position(o->du, o->entry);
+}
+
+static bool is_invariant(loop_optimizer_t* o, air_insn_t* insn, map_t* hoisted)
+{
+    if (!air_insn_creates_temporary(insn) || !insn->noops || insn->ops[0]->type != AOP_REGISTER ||
+        insn->ops[0]->content.reg == INVALID_VREGID || used_by_phi(o->du, insn->ops[0]->content.reg))
+        return false;
+    if (!insn->ct || is_volatile(insn->ct) || type_is_floating(insn->ct))
+        return false;
+    air_block_t* block = air_cfg_block(o->aliases.cfg, insn);
+    if (insn->type == AIR_LOAD)
+    {
+        air_insn_operand_t* op = insn->ops[1];
+        symbol_t* sy = NULL;
+        if (!is_load(&o->aliases, insn, &sy))
+            return false;
+        if (is_private(&o->aliases, sy))
+        {
+            if (map_get(o->written, sy))
+                return false;
+        }
+        else if (o->clobbers || (op->type == AOP_INDIRECT_REGISTER && !always_runs(o, block)))
+            return false;
+        return op->type != AOP_INDIRECT_REGISTER || (invariant_register(o, op->content.inreg.id, hoisted) &&
+            invariant_register(o, op->content.inreg.roffset, hoisted));
+    }
+    if (insn->type == AIR_LOAD_ADDR || !is_pure(insn))
+        return false;
+    if ((insn->type == AIR_DIVIDE || insn->type == AIR_MODULO) && !always_runs(o, block))
+        return false;
+    for (size_t i = 1; i < insn->noops; ++i)
+    {
+        air_insn_operand_t* op = insn->ops[i];
+        if (op->type == AOP_REGISTER ? !invariant_register(o, op->content.reg, hoisted) : op->type != AOP_INTEGER_CONSTANT)
+            return false;
+    }
+    return true;
+}
+
+// whether a hoisted value is used by something left in the loop
+static bool is_live_in(loop_optimizer_t* o, air_insn_t* insn, map_t* hoisted)
+{
+    vector_t* uses = air_defuse_uses(o->du, insn->ops[0]->content.reg);
+    if (!uses) return false;
+    VECTOR_FOR(air_insn_t*, use, uses)
+    {
+        if (!map_get(hoisted, use))
+            return true;
+    }
+    return false;
+}
+
+static size_t count_live_in(loop_optimizer_t* o, vector_t* order, map_t* hoisted)
+{
+    size_t count = 0;
+    VECTOR_FOR(air_insn_t*, insn, order)
+    {
+        if (is_live_in(o, insn, hoisted))
+            ++count;
+    }
+    return count;
+}
+
+// the most temporaries live at once in the loop, where the ones live into it are live all the way through
+static size_t loop_pressure(loop_optimizer_t* o)
+{
+    air_block_t* first = vector_get(o->loop->blocks, 0);
+    air_block_t* last = vector_peek(o->loop->blocks);
+    size_t start = air_defuse_position(o->du, first->first), end = air_defuse_position(o->du, last->last);
+    long long* changes = calloc(end - start + 2, sizeof *changes);
+    size_t through = 0;
+    IMAP_FOR(regid_t, vector_t*, o->du->defs)
+    {
+        vector_t* uses = air_defuse_uses(o->du, k);
+        if (!uses) continue;
+        size_t from = air_defuse_position(o->du, vector_get(v, 0));
+        size_t to = air_defuse_position(o->du, vector_peek(uses));
+        if (to < start || from > end)
+            continue;
+        if (from < start)
+        {
+            ++through;
+            continue;
+        }
+        ++changes[from - start];
+        --changes[(to < end ? to : end) - start + 1];
+    }
+    long long live = 0, most = 0;
+    for (size_t i = 0; i <= end - start; ++i)
+    {
+        live += changes[i];
+        if (live > most)
+            most = live;
+    }
+    free(changes);
+    return through + most;
+}
+
+static bool hoist_invariants(loop_optimizer_t* o)
+{
+    size_t pressure = loop_pressure(o);
+    if (pressure >= PRESSURE_LIMIT)
+        return false;
+
+    map_t* hoisted = map_init(pointer_comparator, pointer_hash); // map_t<air_insn_t*, air_insn_t*>
+    vector_t* order = vector_init(); // vector_t<air_insn_t*>, each after what it uses
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        VECTOR_FOR(air_block_t*, block, o->loop->blocks)
+        {
+            for (air_insn_t* insn = block->first; insn; insn = insn == block->last ? NULL : insn->next)
+            {
+                if (map_get(hoisted, insn) || !is_invariant(o, insn, hoisted))
+                    continue;
+                map_add(hoisted, insn, insn);
+                vector_add(order, insn);
+                if (pressure + count_live_in(o, order, hoisted) > PRESSURE_LIMIT)
+                {
+                    map_remove(hoisted, insn);
+                    vector_pop(order);
+                    continue;
+                }
+                changed = true;
+            }
+        }
+    }
+
+    VECTOR_FOR(air_insn_t*, moving, order)
+    {
+        for (size_t j = 1; j < moving->noops; ++j)
+        {
+            air_insn_operand_t* op = moving->ops[j];
+            air_insn_t* def = op->type == AOP_REGISTER ? air_defuse_definition(o->du, op->content.reg) : NULL;
+            if (!def || !is_immediate_load(def) || !in_loop(o, def))
+                continue;
+            air_insn_t* constant = air_insn_init(AIR_LOAD, 2);
+            constant->ct = air_type(def->ct);
+            constant->ops[0] = air_insn_register_operand_init(op->content.reg = o->air->next_available_temporary++);
+            constant->ops[1] = air_insn_operand_copy(def->ops[1]);
+            air_insn_insert_before(constant, o->entry);
+        }
+        air_insn_move_before(moving, o->entry);
+    }
+
+    bool changed = order->size > 0;
+    map_delete(hoisted);
+    vector_delete(order);
+    return changed;
+}
+
+static bool integer_constant(loop_optimizer_t* o, air_insn_operand_t* op, long long* value)
+{
+    if (op->type == AOP_REGISTER)
+    {
+        air_insn_t* def = air_defuse_definition(o->du, op->content.reg);
+        if (!def || def->type != AIR_LOAD)
+            return false;
+        op = def->ops[1];
+    }
+    if (op->type != AOP_INTEGER_CONSTANT)
+        return false;
+    *value = (long long) op->content.ic;
+    return true;
+}
+
+static bool is_index_type(c_type_t* ct)
+{
+    if (!ct) return false;
+    switch (ct->class)
+    {
+        case CTC_INT:
+        case CTC_LONG_INT:
+        case CTC_LONG_LONG_INT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// the store adding to an induction variable once every iteration, and how much it adds
+static air_insn_t* find_induction(loop_optimizer_t* o, symbol_t* sy, long long* step)
+{
+    vector_t* stores = map_get(o->written, sy);
+    if (!stores || stores->size != 1 || !is_index_type(sy->type))
+        return NULL;
+    air_insn_t* update = vector_get(stores, 0);
+    if ((update->type != AIR_DIRECT_ADD && update->type != AIR_DIRECT_SUBTRACT) || !update->ct ||
+        update->ct->class != sy->type->class)
+        return NULL;
+    air_insn_operand_t* target = update->ops[0];
+    if (target->type == AOP_INDIRECT_REGISTER)
+    {
+        address_t* a = map_get(o->aliases.addresses, (void*) target->content.inreg.id);
+        if (!a || !a->known || a->offset + target->content.inreg.offset != 0 || target->content.inreg.roffset != INVALID_VREGID)
+            return NULL;
+    }
+    else if (target->type != AOP_SYMBOL)
+        return NULL;
+    if (!integer_constant(o, update->ops[1], step))
+        return NULL;
+    if (type_size(sy->type) == 4)
+        *step = (int) *step;
+    if (update->type == AIR_DIRECT_SUBTRACT)
+        *step = -*step;
+
+    // it has to run on every iteration of this loop, and only once
+    air_block_t* block = air_cfg_block(o->aliases.cfg, update);
+    VECTOR_FOR(air_block_t*, latch, o->loop->latches)
+    {
+        if (!air_block_dominates(block, latch))
+            return NULL;
+    }
+    VECTOR_FOR(air_loop_t*, other, o->aliases.cfg->loops)
+    {
+        if (other != o->loop && other->contains[block->id] && other->blocks->size < o->loop->blocks->size)
+            return NULL;
+    }
+    return update;
+}
+
+// the base of an address made from an index, or INVALID_VREGID if an instruction uses it some other way
+static regid_t indexed_base(air_insn_t* use, regid_t index)
+{
+    if (use->type == AIR_ADD && use->ct && use->ct->class == CTC_POINTER &&
+        use->ops[1]->type == AOP_REGISTER && use->ops[2]->type == AOP_REGISTER)
+    {
+        bool left = use->ops[1]->content.reg == index, right = use->ops[2]->content.reg == index;
+        if (left == right)
+            return INVALID_VREGID;
+        return use->ops[left ? 2 : 1]->content.reg;
+    }
+    regid_t base = INVALID_VREGID;
+    for (size_t i = 0; i < use->noops; ++i)
+    {
+        air_insn_operand_t* op = use->ops[i];
+        if (!op) continue;
+        if (op->type == AOP_REGISTER && op->content.reg == index)
+            return INVALID_VREGID;
+        if (op->type != AOP_INDIRECT_REGISTER)
+            continue;
+        if (op->content.inreg.id == index)
+            return INVALID_VREGID;
+        if (op->content.inreg.roffset != index)
+            continue;
+        if (op->content.inreg.factor != 1 || (base != INVALID_VREGID && base != op->content.inreg.id))
+            return INVALID_VREGID;
+        base = op->content.inreg.id;
+    }
+    return base;
+}
+
+static bool find_reduction(loop_optimizer_t* o, air_insn_t* insn, reduction_t* r)
+{
+    if (insn->type != AIR_MULTIPLY || !is_index_type(insn->ct) || insn->ops[0]->type != AOP_REGISTER ||
+        used_by_phi(o->du, insn->ops[0]->content.reg))
+        return false;
+    for (size_t i = 1; i <= 2; ++i)
+    {
+        if (insn->ops[i]->type != AOP_REGISTER || !integer_constant(o, insn->ops[3 - i], &r->scale))
+            continue;
+        r->load = air_defuse_definition(o->du, insn->ops[i]->content.reg);
+        if (r->load)
+            break;
+    }
+    // a signed index is only sign extended, since it can't wrap around without overflowing
+    if (r->load && r->load->type == AIR_SEXT && r->load->ops[1]->type == AOP_REGISTER)
+    {
+        r->widen = r->load;
+        r->load = air_defuse_definition(o->du, r->widen->ops[1]->content.reg);
+    }
+    air_insn_t* load = r->load;
+    if (!load || load->type != AIR_LOAD || load->ops[1]->type != AOP_SYMBOL || !load->ct ||
+        (r->widen ? r->widen->ct : load->ct)->class != insn->ct->class)
+        return false;
+    symbol_t* sy = load->ops[1]->content.sy;
+    long long step;
+    air_insn_t* update = find_induction(o, sy, &step);
+    if (!update || sy->type->class != load->ct->class || (r->widen && !type_is_signed_integer(sy->type)))
+        return false;
+
+    air_block_t* block = air_cfg_block(o->aliases.cfg, insn);
+    if (air_cfg_block(o->aliases.cfg, load) != block || (r->widen && air_cfg_block(o->aliases.cfg, r->widen) != block))
+        return false;
+    vector_t* uses = air_defuse_uses(o->du, insn->ops[0]->content.reg);
+    if (!uses)
+        return false;
+    size_t loaded = air_defuse_position(o->du, load);
+    size_t updated = air_defuse_position(o->du, update);
+    r->index = insn;
+    r->base = INVALID_VREGID;
+    VECTOR_FOR(air_insn_t*, use, uses)
+    {
+        // the index has to be from the same iteration the pointer is on
+        size_t used = air_defuse_position(o->du, use);
+        if (air_cfg_block(o->aliases.cfg, use) != block || (loaded < updated && updated < used))
+            return false;
+        regid_t base = indexed_base(use, insn->ops[0]->content.reg);
+        if (base == INVALID_VREGID || (r->base != INVALID_VREGID && base != r->base))
+            return false;
+        r->base = base;
+    }
+    air_insn_t* def = air_defuse_definition(o->du, r->base);
+    if (!invariant_register(o, r->base, NULL) || !def->ct || def->ct->class != CTC_POINTER)
+        return false;
+    // the pointer's bump has to fit in an instruction's immediate
+    long long bump = step * r->scale;
+    if (bump / r->scale != step || bump < -0x80000000LL || bump > 0x7FFFFFFFLL)
+        return false;
+    r->uses = uses;
+    return true;
+}
+
+static air_insn_t* make_load(regid_t reg, symbol_t* sy)
+{
+    air_insn_t* load = air_insn_init(AIR_LOAD, 2);
+    load->ct = air_type(sy->type);
+    load->ops[0] = air_insn_register_operand_init(reg);
+    load->ops[1] = air_insn_symbol_operand_init(sy);
+    return load;
+}
+
+// gives an index its own pointer, set before the loop and bumped along with the induction variable
+static void reduce(loop_optimizer_t* o, reduction_t* r)
+{
+    air_t* air = o->air;
+    symbol_t* iv = r->load->ops[1]->content.sy;
+    long long step;
+    air_insn_t* update = find_induction(o, iv, &step);
+    c_type_t* ptype = air_defuse_definition(o->du, r->base)->ct;
+
+    symbol_t* sy = symbol_table_add(air->st, "__anonymous_lv__", symbol_init(NULL));
+    sy->type = type_copy(ptype);
+    sy->sd = SD_AUTOMATIC;
+
+    air_insn_t* decl = air_insn_init(AIR_DECLARE, 1);
+    decl->ops[0] = air_insn_symbol_operand_init(sy);
+    air_insn_insert_before(decl, o->entry);
+
+    regid_t value = air->next_available_temporary++;
+    air_insn_insert_before(make_load(value, iv), o->entry);
+    if (r->widen)
+    {
+        air_insn_t* widen = air_insn_init(AIR_SEXT, 2);
+        widen->ct = air_type(r->widen->ct);
+        widen->ops[0] = air_insn_register_operand_init(air->next_available_temporary++);
+        widen->ops[1] = air_insn_register_operand_init(value);
+        widen->ops[1]->ct = air_type(r->load->ct);
+        air_insn_insert_before(widen, o->entry);
+        value = widen->ops[0]->content.reg;
+    }
+
+    air_insn_t* mul = air_insn_init(AIR_MULTIPLY, 3);
+    mul->ct = air_type(r->index->ct);
+    mul->ops[0] = air_insn_register_operand_init(air->next_available_temporary++);
+    mul->ops[1] = air_insn_register_operand_init(value);
+    mul->ops[2] = air_insn_integer_constant_operand_init(r->scale);
+    air_insn_insert_before(mul, o->entry);
+
+    air_insn_t* add = air_insn_init(AIR_ADD, 3);
+    add->ct = air_type(ptype);
+    add->ops[0] = air_insn_register_operand_init(air->next_available_temporary++);
+    add->ops[1] = air_insn_register_operand_init(r->base);
+    add->ops[2] = air_insn_register_operand_init(mul->ops[0]->content.reg);
+    air_insn_insert_before(add, o->entry);
+
+    air_insn_t* assign = air_insn_init(AIR_ASSIGN, 2);
+    assign->ct = air_type(ptype);
+    assign->ops[0] = air_insn_symbol_operand_init(sy);
+    assign->ops[1] = air_insn_register_operand_init(add->ops[0]->content.reg);
+    air_insn_insert_before(assign, o->entry);
+
+    air_insn_t* addr = air_insn_init(AIR_LOAD_ADDR, 2);
+    addr->ct = air_reference_type(ptype);
+    addr->ops[0] = air_insn_register_operand_init(air->next_available_temporary++);
+    addr->ops[1] = air_insn_symbol_operand_init(sy);
+    air_insn_t* bump = air_insn_init(AIR_DIRECT_ADD, 2);
+    bump->ct = air_type(ptype);
+    bump->ops[0] = air_insn_indirect_register_operand_init(addr->ops[0]->content.reg, 0, INVALID_VREGID, 1);
+    bump->ops[1] = air_insn_integer_constant_operand_init(step * r->scale);
+    air_insn_insert_after(bump, update);
+    air_insn_insert_after(addr, update);
+
+    regid_t index = r->index->ops[0]->content.reg;
+    VECTOR_FOR(air_insn_t*, use, r->uses)
+    {
+        if (use->type == AIR_ADD)
+        {
+            air_insn_operand_delete(use->ops[1]);
+            air_insn_operand_delete(use->ops[2]);
+            use->type = AIR_LOAD;
+            use->noops = 2;
+            use->ops[1] = air_insn_symbol_operand_init(sy);
+            continue;
+        }
+        regid_t pointer = air->next_available_temporary++;
+        air_insn_insert_before(make_load(pointer, sy), use);
+        for (size_t i = 0; i < use->noops; ++i)
+        {
+            air_insn_operand_t* op = use->ops[i];
+            if (!op || op->type != AOP_INDIRECT_REGISTER || op->content.inreg.roffset != index)
+                continue;
+            op->content.inreg.id = pointer;
+            op->content.inreg.roffset = INVALID_VREGID;
+        }
+    }
+}
+
+static bool reduce_strength(loop_optimizer_t* o)
+{
+    vector_t* reductions = vector_init(); // vector_t<reduction_t*>
+    VECTOR_FOR(air_block_t*, block, o->loop->blocks)
+    {
+        for (air_insn_t* insn = block->first; insn; insn = insn == block->last ? NULL : insn->next)
+        {
+            reduction_t r = { 0 };
+            if (!find_reduction(o, insn, &r))
+                continue;
+            reduction_t* entry = malloc(sizeof *entry);
+            *entry = r;
+            vector_add(reductions, entry);
+        }
+    }
+    // everything is found before anything changes, since changes leave the def-use index stale
+    VECTOR_FOR(reduction_t*, r, reductions)
+        reduce(o, r);
+    bool changed = reductions->size > 0;
+    vector_deep_delete(reductions, free);
+    return changed;
+}
+
+/*
+
+loop vectorization, which comes between hoisting and strength reduction so that array accesses are still made by
+scaling the induction variable. a loop whose body is a single block that runs into its condition, counting a local
+int or long up by one while it's less than an invariant bound, where every value is either the same on every
+iteration or an element of an array indexed by the induction variable, like:
+    for (int i = 0; i < n; ++i) a[i] = b[i] + c[i] * k;
+gets a copy put in front of it that works on a whole SSE register of elements at once:
+    for (; i < n && n - i > 3; i += 4) a[i..i+3] = b[i..i+3] + c[i..i+3] * {k, k, k, k};
+and the original loop is left to finish the last few elements. a value that stays the same is spread across a
+vector before the copy, by storing it to each lane of a variable and loading that back.
+
+elements are ints, longs, floats, or doubles, all of the same type. integers can only be added and subtracted,
+since SSE2 can't multiply 32- or 64-bit lanes, and floats and doubles can also be multiplied and divided. an
+integer variable that the loop only adds elements to (s += a[i]) is summed in the lanes of a variable of its own,
+and the lanes are added to it after the copy. floating sums aren't, since adding them in another order rounds
+differently.
+
+writing one element of an array could change one that's read later in the same vector, so the copy only runs when
+the arrays it stores to start at least a vector's width away from every other array it accesses.
+
+*/
+
+// what a register holds across the lanes of a vector
+typedef enum lane_kind
+{
+    LN_NONE,
+    LN_INDEX, // the induction variable, or it widened to index an array
+    LN_OFFSET, // the induction variable scaled by the element size
+    LN_ADDRESS, // an array's base plus the offset
+    LN_INVARIANT, // the same in every lane
+    LN_ELEMENT, // an element of an array, or something made from them
+    LN_INDUCTION_ADDRESS, // the induction variable's address
+    LN_SUM, // the sum's value
+    LN_SUM_ADDRESS, // the sum's address
+    LN_NEXT_SUM // the sum with an element added
+} lane_kind_t;
+
+// what a body instruction becomes in the vectorized copy
+typedef enum lane_role
+{
+    LR_SKIP,
+    LR_COPY, // copied as it is
+    LR_WIDEN, // copied with its type widened to a vector
+    LR_STEP, // the induction variable's update, which adds a vector's worth instead
+    LR_ACCUMULATE // the store to the sum, which adds to the lanes of its own variable instead
+} lane_role_t;
+
+typedef struct vectorizer
+{
+    loop_optimizer_t* o;
+    air_block_t* body;
+    symbol_t* iv;
+    air_insn_t* update; // the induction variable's update
+    regid_t bound;
+    c_type_t* element; // every element's type, once there's been one
+    long long lanes;
+    long long scale; // what offsets scale the induction variable by
+    symbol_t* sum; // the integer being summed, if any
+    air_insn_operand_t* addend; // the element added to it
+    size_t accumulations;
+    map_t* kinds; // map_t<regid_t, lane_kind_t>
+    map_t* roles; // map_t<air_insn_t*, lane_role_t>
+    map_t* bases; // map_t<regid_t, regid_t>, the base of each address
+    vector_t* accessed; // vector_t<regid_t>, the bases of arrays accessed
+    vector_t* stored; // vector_t<regid_t>, the bases of arrays stored to
+    map_t* outside; // map_t<regid_t, regid_t>, invariants recomputed before the loop
+    map_t* spread; // map_t<air_insn_operand_t*, regid_t>, vectors of the invariants elements are combined with
+    map_t* renamed; // map_t<regid_t, regid_t>, the copy's registers
+} vectorizer_t;
+
+static long long lane_count(c_type_t* ct)
+{
+    if (!ct || is_volatile(ct)) return 0;
+    switch (ct->class)
+    {
+        case CTC_INT:
+        case CTC_UNSIGNED_INT:
+        case CTC_FLOAT:
+            return 4;
+        case CTC_LONG_INT:
+        case CTC_UNSIGNED_LONG_INT:
+        case CTC_LONG_LONG_INT:
+        case CTC_UNSIGNED_LONG_LONG_INT:
+        case CTC_DOUBLE:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+static bool is_readonly(air_t* air, symbol_t* sy)
+{
+    VECTOR_FOR(air_data_t*, data, air->rodata)
+    {
+        if (data->sy == sy)
+            return true;
+    }
+    return false;
+}
+
+// a load of something the loop never changes
+static bool is_invariant_load(vectorizer_t* v, air_insn_t* insn)
+{
+    if (insn->type != AIR_LOAD || !type_is_scalar(insn->ct) || is_volatile(insn->ct))
+        return false;
+    air_insn_operand_t* op = insn->ops[1];
+    if (op->type == AOP_INTEGER_CONSTANT)
+        return true;
+    if (op->type != AOP_SYMBOL || op->content.sy == v->iv)
+        return false;
+    symbol_t* sy = op->content.sy;
+    return (is_private(&v->o->aliases, sy) && !map_get(v->o->written, sy)) || is_readonly(v->o->air, sy);
+}
+
+static lane_kind_t lane_kind(vectorizer_t* v, air_insn_operand_t* op)
+{
+    if (op->type == AOP_INTEGER_CONSTANT)
+        return LN_INVARIANT;
+    if (op->type != AOP_REGISTER || op->content.reg == INVALID_VREGID)
+        return LN_NONE;
+    lane_kind_t kind = (lane_kind_t) (size_t) map_get(v->kinds, (void*) op->content.reg);
+    if (kind)
+        return kind;
+    return invariant_register(v->o, op->content.reg, NULL) ? LN_INVARIANT : LN_NONE;
+}
+
+static bool classify(vectorizer_t* v, air_insn_t* insn, lane_kind_t kind, lane_role_t role)
+{
+    if (kind)
+        map_add(v->kinds, (void*) insn->ops[0]->content.reg, (void*) (size_t) kind);
+    if (role)
+        map_add(v->roles, insn, (void*) (size_t) role);
+    return true;
+}
+
+// the first element seen picks the type of all of them
+static bool is_element(vectorizer_t* v, c_type_t* ct)
+{
+    if (v->element)
+        return ct && ct->class == v->element->class && !is_volatile(ct);
+    if (!(v->lanes = lane_count(ct)))
+        return false;
+    v->element = ct;
+    return true;
+}
+
+static void add_base(vector_t* bases, regid_t base)
+{
+    VECTOR_FOR(regid_t, b, bases)
+    {
+        if (b == base)
+            return;
+    }
+    vector_add(bases, (void*) base);
+}
+
+// an element of an array indexed by the induction variable, or INVALID_VREGID if the operand isn't one
+static regid_t access_base(vectorizer_t* v, air_insn_operand_t* op)
+{
+    if (op->type != AOP_INDIRECT_REGISTER || op->content.inreg.offset != 0 || op->content.inreg.factor != 1)
+        return INVALID_VREGID;
+    air_insn_operand_t id = { .type = AOP_REGISTER, .content.reg = op->content.inreg.id };
+    air_insn_operand_t roffset = { .type = AOP_REGISTER, .content.reg = op->content.inreg.roffset };
+    regid_t base = INVALID_VREGID;
+    if (op->content.inreg.roffset == INVALID_VREGID && lane_kind(v, &id) == LN_ADDRESS)
+        base = (regid_t) map_get(v->bases, (void*) id.content.reg);
+    else if (lane_kind(v, &id) == LN_INVARIANT && lane_kind(v, &roffset) == LN_OFFSET)
+        base = id.content.reg;
+    if (base != INVALID_VREGID)
+        add_base(v->accessed, base);
+    return base;
+}
+
+// whether an operand is where the sum is stored
+static bool is_sum(vectorizer_t* v, air_insn_operand_t* op)
+{
+    if (op->type == AOP_SYMBOL)
+        return v->sum && op->content.sy == v->sum;
+    air_insn_operand_t id = { .type = AOP_REGISTER, .content.reg = op->content.inreg.id };
+    return op->type == AOP_INDIRECT_REGISTER && op->content.inreg.offset == 0 &&
+        op->content.inreg.roffset == INVALID_VREGID && lane_kind(v, &id) == LN_SUM_ADDRESS;
+}
+
+// a private integer the loop stores to once, which can be summed in lanes
+static bool find_sum(vectorizer_t* v, symbol_t* sy)
+{
+    vector_t* stores = map_get(v->o->written, sy);
+    if (sy == v->iv || !stores || stores->size != 1 || !type_is_integer(sy->type) || (v->sum && v->sum != sy))
+        return false;
+    v->sum = sy;
+    return true;
+}
+
+static bool classify_operation(vectorizer_t* v, air_insn_t* insn)
+{
+    lane_kind_t lhs = lane_kind(v, insn->ops[1]), rhs = lane_kind(v, insn->ops[2]);
+    c_type_t* ct = insn->ct;
+    if (lhs == LN_INVARIANT && rhs == LN_INVARIANT && insn->type != AIR_DIVIDE && type_is_scalar(ct))
+        return classify(v, insn, LN_INVARIANT, LR_SKIP);
+    switch (insn->type)
+    {
+        case AIR_ADD:
+        {
+            if (ct->class == CTC_POINTER && ((lhs == LN_INVARIANT && rhs == LN_OFFSET) || (lhs == LN_OFFSET && rhs == LN_INVARIANT)))
+            {
+                air_insn_operand_t* base = insn->ops[lhs == LN_INVARIANT ? 1 : 2];
+                if (base->type != AOP_REGISTER)
+                    return false;
+                map_add(v->bases, (void*) insn->ops[0]->content.reg, (void*) base->content.reg);
+                return classify(v, insn, LN_ADDRESS, LR_COPY);
+            }
+            if ((lhs == LN_SUM && rhs == LN_ELEMENT) || (lhs == LN_ELEMENT && rhs == LN_SUM))
+            {
+                if (v->addend || !is_element(v, ct) || ct->class != v->sum->type->class)
+                    return false;
+                v->addend = insn->ops[lhs == LN_ELEMENT ? 1 : 2];
+                return classify(v, insn, LN_NEXT_SUM, LR_SKIP);
+            }
+            break;
+        }
+        case AIR_MULTIPLY:
+        {
+            long long scale;
+            if (type_is_integer(ct) && type_size(ct) >= type_size(v->iv->type) &&
+                (lhs == LN_INDEX || rhs == LN_INDEX) && integer_constant(v->o, insn->ops[lhs == LN_INDEX ? 2 : 1], &scale))
+            {
+                if (v->scale && v->scale != scale)
+                    return false;
+                v->scale = scale;
+                return classify(v, insn, LN_OFFSET, LR_COPY);
+            }
+            // fall through
+        }
+        case AIR_DIVIDE:
+            if (!type_is_sse_floating(ct))
+                return false;
+            break;
+        case AIR_SUBTRACT:
+            break;
+        default:
+            return false;
+    }
+    if ((lhs != LN_ELEMENT && lhs != LN_INVARIANT) || (rhs != LN_ELEMENT && rhs != LN_INVARIANT) || !is_element(v, ct))
+        return false;
+    return classify(v, insn, LN_ELEMENT, LR_WIDEN);
+}
+
+// a value dead code elimination hasn't gotten to yet, like the one ++i leaves behind
+static bool is_unused(vectorizer_t* v, air_insn_t* insn)
+{
+    if (!air_insn_creates_temporary(insn) || !insn->noops || insn->ops[0]->type != AOP_REGISTER ||
+        air_defuse_uses(v->o->du, insn->ops[0]->content.reg))
+        return false;
+    return (insn->type == AIR_LOAD && !is_volatile(insn->ct)) || is_pure(insn);
+}
+
+static bool classify_body(vectorizer_t* v, air_insn_t* insn)
+{
+    loop_optimizer_t* o = v->o;
+    if (insn->type == AIR_SEQUENCE_POINT || (insn->type == AIR_LABEL && insn == v->body->first) || is_unused(v, insn))
+        return true;
+    if (insn == v->update)
+        return classify(v, insn, LN_NONE, LR_STEP);
+    if (air_insn_creates_temporary(insn) && (insn->ops[0]->type != AOP_REGISTER || insn->ops[0]->content.reg == INVALID_VREGID))
+        return false;
+    switch (insn->type)
+    {
+        case AIR_LOAD:
+        {
+            air_insn_operand_t* src = insn->ops[1];
+            if (is_invariant_load(v, insn))
+                return classify(v, insn, LN_INVARIANT, LR_SKIP);
+            if (src->type == AOP_SYMBOL && src->content.sy == v->iv && insn->ct->class == v->iv->type->class)
+                return classify(v, insn, LN_INDEX, LR_COPY);
+            if (src->type == AOP_SYMBOL && is_private(&o->aliases, src->content.sy) && find_sum(v, src->content.sy) &&
+                insn->ct->class == src->content.sy->type->class)
+                return classify(v, insn, LN_SUM, LR_SKIP);
+            if (src->type == AOP_REGISTER && lane_kind(v, src) == LN_ELEMENT && is_element(v, insn->ct))
+                return classify(v, insn, LN_ELEMENT, LR_WIDEN);
+            if (access_base(v, src) != INVALID_VREGID && is_element(v, insn->ct))
+                return classify(v, insn, LN_ELEMENT, LR_WIDEN);
+            return false;
+        }
+        case AIR_LOAD_ADDR:
+        {
+            air_insn_operand_t* src = insn->ops[1];
+            if (src->type != AOP_SYMBOL)
+                return false;
+            if (src->content.sy == v->iv)
+                return classify(v, insn, LN_INDUCTION_ADDRESS, LR_COPY);
+            if (is_private(&o->aliases, src->content.sy) && find_sum(v, src->content.sy))
+                return classify(v, insn, LN_SUM_ADDRESS, LR_SKIP);
+            return false;
+        }
+        case AIR_SEXT:
+        case AIR_ZEXT:
+            // subscripts widen an int index to a pointer's width before scaling it
+            if (lane_kind(v, insn->ops[1]) != LN_INDEX || !type_is_integer(insn->ct))
+                return false;
+            return classify(v, insn, LN_INDEX, LR_COPY);
+        case AIR_ADD:
+        case AIR_SUBTRACT:
+        case AIR_MULTIPLY:
+        case AIR_DIVIDE:
+            return classify_operation(v, insn);
+        case AIR_ASSIGN:
+        {
+            lane_kind_t value = lane_kind(v, insn->ops[1]);
+            if (is_sum(v, insn->ops[0]) && value == LN_NEXT_SUM)
+                return ++v->accumulations, classify(v, insn, LN_NONE, LR_ACCUMULATE);
+            regid_t base = access_base(v, insn->ops[0]);
+            if (base == INVALID_VREGID || (value != LN_ELEMENT && value != LN_INVARIANT) || !is_element(v, insn->ct))
+                return false;
+            add_base(v->stored, base);
+            return classify(v, insn, LN_NONE, LR_WIDEN);
+        }
+        case AIR_DIRECT_ADD:
+            if (!is_sum(v, insn->ops[0]) || lane_kind(v, insn->ops[1]) != LN_ELEMENT || v->addend ||
+                !is_element(v, insn->ct) || insn->ct->class != v->sum->type->class)
+                return false;
+            v->addend = insn->ops[1];
+            return ++v->accumulations, classify(v, insn, LN_NONE, LR_ACCUMULATE);
+        default:
+            return false;
+    }
+}
+
+// registers made in a block can't be used outside it, since the copy has its own
+static bool stays_in(vectorizer_t* v, air_block_t* block)
+{
+    for (air_insn_t* insn = block->first; insn; insn = insn == block->last ? NULL : insn->next)
+    {
+        if (!air_insn_creates_temporary(insn) || !insn->noops || insn->ops[0]->type != AOP_REGISTER)
+            continue;
+        regid_t reg = insn->ops[0]->content.reg;
+        vector_t* defs = air_defuse_definitions(v->o->du, reg);
+        if (used_by_phi(v->o->du, reg) || !defs || defs->size != 1)
+            return false;
+        vector_t* uses = air_defuse_uses(v->o->du, reg);
+        if (!uses) continue;
+        VECTOR_FOR(air_insn_t*, use, uses)
+        {
+            if (air_cfg_block(v->o->aliases.cfg, use) != block)
+                return false;
+        }
+    }
+    return true;
+}
+
+// the condition has to be the induction variable being less than an invariant bound, and nothing else
+static bool find_condition(vectorizer_t* v)
+{
+    loop_optimizer_t* o = v->o;
+    air_block_t* header = o->loop->header;
+    air_insn_t* jnz = header->last;
+    if (jnz->type != AIR_JNZ || v->body->first->type != AIR_LABEL || !labels_equal(jnz->ops[0], v->body->first->ops[0]) ||
+        jnz->ops[1]->type != AOP_REGISTER)
+        return false;
+    air_insn_t* cmp = air_defuse_definition(o->du, jnz->ops[1]->content.reg);
+    if (!cmp || cmp->type != AIR_LESS || air_cfg_block(o->aliases.cfg, cmp) != header ||
+        cmp->ops[1]->type != AOP_REGISTER || cmp->ops[2]->type != AOP_REGISTER)
+        return false;
+    air_insn_t* load = air_defuse_definition(o->du, cmp->ops[1]->content.reg);
+    if (!load || load->type != AIR_LOAD || load->ops[1]->type != AOP_SYMBOL || air_cfg_block(o->aliases.cfg, load) != header)
+        return false;
+    v->iv = load->ops[1]->content.sy;
+    if (!load->ct || load->ct->class != v->iv->type->class)
+        return false;
+    long long step;
+    v->update = find_induction(o, v->iv, &step);
+    if (!v->update || step != 1 || v->update->type != AIR_DIRECT_ADD || air_cfg_block(o->aliases.cfg, v->update) != v->body)
+        return false;
+    v->bound = cmp->ops[2]->content.reg;
+    air_insn_t* bound = air_defuse_definition(o->du, v->bound);
+    bool inside = bound && air_cfg_block(o->aliases.cfg, bound) == header;
+    if (inside ? !is_invariant_load(v, bound) : !invariant_register(o, v->bound, NULL))
+        return false;
+    for (air_insn_t* insn = header->first; insn; insn = insn == header->last ? NULL : insn->next)
+    {
+        if (insn != header->first && insn->type != AIR_SEQUENCE_POINT && insn != load && insn != cmp && insn != jnz &&
+            !(inside && insn == bound))
+            return false;
+    }
+    return stays_in(v, header);
+}
+
+// the update has to come after everything else, or loads of the induction variable would see it
+static bool is_last(vectorizer_t* v, air_insn_t* insn)
+{
+    for (insn = insn->next; insn && air_cfg_block(v->o->aliases.cfg, insn) == v->body; insn = insn->next)
+    {
+        if (insn->type != AIR_SEQUENCE_POINT && !is_unused(v, insn))
+            return false;
+    }
+    return true;
+}
+
+static bool can_vectorize(vectorizer_t* v)
+{
+    air_loop_t* loop = v->o->loop;
+    if (loop->blocks->size != 2 || vector_get(loop->blocks, 1) != loop->header)
+        return false;
+    v->body = vector_get(loop->blocks, 0);
+    if (v->body->successors->size != 1 || vector_get(v->body->successors, 0) != loop->header)
+        return false;
+    if (!find_condition(v) || !is_last(v, v->update))
+        return false;
+    for (air_insn_t* insn = v->body->first; insn; insn = insn == v->body->last ? NULL : insn->next)
+    {
+        if (!classify_body(v, insn))
+            return false;
+    }
+    if (!v->element || v->scale != type_size(v->element) || !stays_in(v, v->body))
+        return false;
+    // a sum has to be loaded, added to, and stored back exactly once, unless it's added to in place
+    if (v->sum && (v->accumulations != 1 || !v->addend || v->sum->type->class != v->element->class))
+        return false;
+    // every array stored to gets checked against every other one before the copy, so only a few are worth it
+    return v->accessed->size <= 4;
+}
+
+static air_insn_operand_t* typed_register(regid_t reg, c_type_t* ct)
+{
+    air_insn_operand_t* op = air_insn_register_operand_init(reg);
+    op->ct = air_type(ct);
+    return op;
+}
+
+// puts an operation in front of the loop and gives back its result
+static regid_t emit(vectorizer_t* v, air_insn_type_t type, c_type_t* ct, air_insn_operand_t* lhs, air_insn_operand_t* rhs)
+{
+    air_insn_t* insn = air_insn_init(type, rhs ? 3 : 2);
+    insn->ct = ct;
+    insn->ops[0] = air_insn_register_operand_init(v->o->air->next_available_temporary++);
+    insn->ops[1] = lhs;
+    if (rhs)
+        insn->ops[2] = rhs;
+    air_insn_insert_before(insn, v->o->entry);
+    return insn->ops[0]->content.reg;
+}
+
+static void emit_label(vectorizer_t* v, unsigned long long label)
+{
+    air_insn_t* insn = air_insn_init(AIR_LABEL, 1);
+    insn->ops[0] = air_insn_label_operand_init(label, 'V');
+    air_insn_insert_before(insn, v->o->entry);
+}
+
+static void emit_jump(vectorizer_t* v, air_insn_type_t type, unsigned long long label, regid_t condition)
+{
+    air_insn_t* insn = air_insn_init(type, type == AIR_JMP ? 1 : 2);
+    insn->ops[0] = air_insn_label_operand_init(label, 'V');
+    if (type != AIR_JMP)
+    {
+        insn->ct = air_basic_type(CTC_INT);
+        insn->ops[1] = air_insn_register_operand_init(condition);
+    }
+    air_insn_insert_before(insn, v->o->entry);
+}
+
+static void emit_store(vectorizer_t* v, c_type_t* ct, air_insn_operand_t* dest, air_insn_operand_t* value)
+{
+    air_insn_t* insn = air_insn_init(AIR_ASSIGN, 2);
+    insn->ct = air_type(ct);
+    insn->ops[0] = dest;
+    insn->ops[1] = value;
+    air_insn_insert_before(insn, v->o->entry);
+}
+
+static symbol_t* emit_variable(vectorizer_t* v, c_type_t* ct)
+{
+    symbol_t* sy = symbol_table_add(v->o->air->st, "__anonymous_lv__", symbol_init(NULL));
+    sy->type = ct;
+    sy->sd = SD_AUTOMATIC;
+    air_insn_t* decl = air_insn_init(AIR_DECLARE, 1);
+    decl->ops[0] = air_insn_symbol_operand_init(sy);
+    air_insn_insert_before(decl, v->o->entry);
+    return sy;
+}
+
+// recomputes an invariant in front of the loop, if it isn't there already
+static regid_t materialize(vectorizer_t* v, regid_t reg)
+{
+    air_insn_t* def = air_defuse_definition(v->o->du, reg);
+    if (!def || !in_loop(v->o, def))
+        return reg;
+    regid_t outside = (regid_t) map_get(v->outside, (void*) reg);
+    if (outside)
+        return outside;
+    air_insn_t* copy = air_insn_copy(def);
+    for (size_t i = 1; i < copy->noops; ++i)
+    {
+        if (copy->ops[i]->type == AOP_REGISTER)
+            copy->ops[i]->content.reg = materialize(v, copy->ops[i]->content.reg);
+    }
+    copy->ops[0]->content.reg = outside = v->o->air->next_available_temporary++;
+    air_insn_insert_before(copy, v->o->entry);
+    map_add(v->outside, (void*) reg, (void*) outside);
+    return outside;
+}
+
+// stores a value to every lane of a variable, which is then loaded as a whole
+static regid_t spread(vectorizer_t* v, symbol_t* sy, air_insn_operand_t* value)
+{
+    long long size = type_size(v->element);
+    for (long long i = 0; i < v->lanes; ++i)
+        emit_store(v, v->element, air_insn_indirect_symbol_operand_init(sy, i * size), air_insn_operand_copy(value));
+    return emit(v, AIR_LOAD, air_type(sy->type), air_insn_symbol_operand_init(sy), NULL);
+}
+
+// the copy's version of a register: its own, or an invariant from before the loop
+static regid_t rename_register(vectorizer_t* v, regid_t reg)
+{
+    if (reg == INVALID_VREGID)
+        return reg;
+    regid_t renamed = (regid_t) map_get(v->renamed, (void*) reg);
+    if (renamed)
+        return renamed;
+    renamed = (regid_t) map_get(v->outside, (void*) reg);
+    return renamed ? renamed : reg;
+}
+
+static air_insn_t* copy_body_insn(vectorizer_t* v, air_insn_t* insn)
+{
+    air_insn_t* copy = air_insn_copy(insn);
+    for (size_t i = 0; i < copy->noops; ++i)
+    {
+        air_insn_operand_t* op = copy->ops[i];
+        if (i == 0 && air_insn_creates_temporary(copy))
+        {
+            regid_t reg = v->o->air->next_available_temporary++;
+            map_add(v->renamed, (void*) op->content.reg, (void*) reg);
+            op->content.reg = reg;
+        }
+        else if (op->type == AOP_REGISTER)
+            op->content.reg = rename_register(v, op->content.reg);
+        else if (op->type == AOP_INDIRECT_REGISTER)
+        {
+            op->content.inreg.id = rename_register(v, op->content.inreg.id);
+            op->content.inreg.roffset = rename_register(v, op->content.inreg.roffset);
+        }
+    }
+    air_insn_insert_before(copy, v->o->entry);
+    return copy;
+}
+
+// everything the copy needs that doesn't change goes in front of it: invariants, and vectors of them
+static void prepare(vectorizer_t* v, c_type_t* vt)
+{
+    symbol_t* sy = NULL;
+    for (air_insn_t* insn = v->body->first; insn; insn = insn == v->body->last ? NULL : insn->next)
+    {
+        lane_role_t role = (lane_role_t) (size_t) map_get(v->roles, insn);
+        if (!role)
+            continue;
+        for (size_t i = air_insn_creates_temporary(insn) ? 1 : 0; i < insn->noops; ++i)
+        {
+            air_insn_operand_t* op = insn->ops[i];
+            if (op->type == AOP_INDIRECT_REGISTER)
+            {
+                air_insn_operand_t base = { .type = AOP_REGISTER, .content.reg = op->content.inreg.id };
+                if (lane_kind(v, &base) == LN_INVARIANT)
+                    materialize(v, base.content.reg);
+                continue;
+            }
+            if (lane_kind(v, op) != LN_INVARIANT)
+                continue;
+            if (op->type == AOP_REGISTER)
+                materialize(v, op->content.reg);
+            if (role != LR_WIDEN || (insn->type == AIR_LOAD && i == 1))
+                continue;
+            if (!sy)
+                sy = emit_variable(v, type_copy(vt));
+            air_insn_operand_t* value = air_insn_operand_copy(op);
+            if (value->type == AOP_REGISTER)
+                value->content.reg = rename_register(v, value->content.reg);
+            map_add(v->spread, op, (void*) spread(v, sy, value));
+        }
+    }
+}
+
+// an array stored to that starts less than a vector's width from another one sends the loop to the scalar version
+static void check_overlaps(vectorizer_t* v, unsigned long long scalar)
+{
+    c_type_t* ull = make_basic_type(CTC_UNSIGNED_LONG_LONG_INT);
+    long long width = v->lanes * type_size(v->element);
+    for (size_t i = 0; i < v->stored->size; ++i)
+    {
+        regid_t stored = (regid_t) vector_get(v->stored, i);
+        for (size_t j = 0; j < v->accessed->size; ++j)
+        {
+            regid_t other = (regid_t) vector_get(v->accessed, j);
+            // arrays that are both stored to only get checked once
+            bool checked = false;
+            for (size_t k = 0; k < i; ++k)
+                checked |= (regid_t) vector_get(v->stored, k) == other;
+            if (stored == other || checked)
+                continue;
+            regid_t a = materialize(v, stored), b = materialize(v, other);
+            regid_t distance = emit(v, AIR_SUBTRACT, air_type(ull), typed_register(a, ull), typed_register(b, ull));
+            regid_t shifted = emit(v, AIR_ADD, air_type(ull), typed_register(distance, ull), air_insn_integer_constant_operand_init(width - 1));
+            regid_t limit = emit(v, AIR_LOAD, air_type(ull), air_insn_integer_constant_operand_init(width * 2 - 1), NULL);
+            regid_t near = emit(v, AIR_LESS, air_basic_type(CTC_INT), typed_register(shifted, ull), typed_register(limit, ull));
+            emit_jump(v, AIR_JNZ, scalar, near);
+        }
+    }
+    type_delete(ull);
+}
+
+// the copy keeps going while there's at least a vector's worth of iterations left
+static void emit_condition(vectorizer_t* v, unsigned long long body, unsigned long long done)
+{
+    c_type_t* it = v->iv->type;
+    c_type_t* ut = make_basic_type(type_size(it) == 4 ? CTC_UNSIGNED_INT : CTC_UNSIGNED_LONG_INT);
+    regid_t bound = rename_register(v, v->bound);
+    regid_t index = emit(v, AIR_LOAD, air_type(it), air_insn_symbol_operand_init(v->iv), NULL);
+    regid_t less = emit(v, AIR_LESS, air_basic_type(CTC_INT), typed_register(index, it), typed_register(bound, it));
+    emit_jump(v, AIR_JZ, done, less);
+    // with the index below the bound, their difference fits unsigned
+    regid_t left = emit(v, AIR_SUBTRACT, air_type(ut), typed_register(bound, ut), typed_register(index, ut));
+    regid_t last = emit(v, AIR_LOAD, air_type(ut), air_insn_integer_constant_operand_init(v->lanes - 1), NULL);
+    regid_t enough = emit(v, AIR_GREATER, air_basic_type(CTC_INT), typed_register(left, ut), typed_register(last, ut));
+    emit_jump(v, AIR_JNZ, body, enough);
+    type_delete(ut);
+}
+
+static void emit_body(vectorizer_t* v, c_type_t* vt, symbol_t* accumulator)
+{
+    for (air_insn_t* insn = v->body->first; insn; insn = insn == v->body->last ? NULL : insn->next)
+    {
+        lane_role_t role = (lane_role_t) (size_t) map_get(v->roles, insn);
+        switch (role)
+        {
+            case LR_COPY:
+                copy_body_insn(v, insn);
+                break;
+            case LR_STEP:
+            {
+                air_insn_t* copy = copy_body_insn(v, insn);
+                air_insn_operand_delete(copy->ops[1]);
+                copy->ops[1] = air_insn_integer_constant_operand_init(v->lanes);
+                break;
+            }
+            case LR_WIDEN:
+            {
+                air_insn_t* copy = copy_body_insn(v, insn);
+                type_delete(copy->ct);
+                copy->ct = air_type(vt);
+                for (size_t i = 0; i < copy->noops; ++i)
+                {
+                    regid_t spread = (regid_t) map_get(v->spread, insn->ops[i]);
+                    if (spread)
+                    {
+                        air_insn_operand_delete(copy->ops[i]);
+                        copy->ops[i] = air_insn_register_operand_init(spread);
+                    }
+                    if (copy->ops[i]->type == AOP_REGISTER && copy->ops[i]->ct)
+                    {
+                        type_delete(copy->ops[i]->ct);
+                        copy->ops[i]->ct = air_type(vt);
+                    }
+                }
+                break;
+            }
+            case LR_ACCUMULATE:
+            {
+                regid_t sum = emit(v, AIR_LOAD, air_type(vt), air_insn_symbol_operand_init(accumulator), NULL);
+                regid_t next = emit(v, AIR_ADD, air_type(vt), air_insn_register_operand_init(sum),
+                    air_insn_register_operand_init(rename_register(v, v->addend->content.reg)));
+                emit_store(v, vt, air_insn_symbol_operand_init(accumulator), air_insn_register_operand_init(next));
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+// adds up the accumulator's lanes into the sum
+static void emit_sum(vectorizer_t* v, symbol_t* accumulator)
+{
+    c_type_t* et = v->element;
+    long long size = type_size(et);
+    regid_t total = emit(v, AIR_LOAD, air_type(et), air_insn_symbol_operand_init(v->sum), NULL);
+    for (long long i = 0; i < v->lanes; ++i)
+    {
+        regid_t lane = emit(v, AIR_LOAD, air_type(et), air_insn_indirect_symbol_operand_init(accumulator, i * size), NULL);
+        total = emit(v, AIR_ADD, air_type(et), air_insn_register_operand_init(total), air_insn_register_operand_init(lane));
+    }
+    emit_store(v, et, air_insn_symbol_operand_init(v->sum), air_insn_register_operand_init(total));
+}
+
+static void vectorize(vectorizer_t* v)
+{
+    air_t* air = v->o->air;
+    c_type_t* vt = make_vector_type(v->element, v->lanes);
+    unsigned long long body = ++air->next_available_vectorized_label;
+    unsigned long long condition = ++air->next_available_vectorized_label;
+    unsigned long long done = ++air->next_available_vectorized_label;
+    unsigned long long scalar = ++air->next_available_vectorized_label;
+
+    materialize(v, v->bound);
+    check_overlaps(v, scalar);
+    prepare(v, vt);
+    symbol_t* accumulator = NULL;
+    if (v->sum)
+    {
+        accumulator = emit_variable(v, type_copy(vt));
+        air_insn_operand_t* zero = air_insn_integer_constant_operand_init(0);
+        spread(v, accumulator, zero);
+    }
+    emit_jump(v, AIR_JMP, condition, INVALID_VREGID);
+    emit_label(v, body);
+    emit_body(v, vt, accumulator);
+    emit_label(v, condition);
+    emit_condition(v, body, done);
+    emit_label(v, done);
+    if (v->sum)
+        emit_sum(v, accumulator);
+    emit_label(v, scalar);
+    type_delete(vt);
+}
+
+static bool vectorize_loop(loop_optimizer_t* o)
+{
+    vectorizer_t v = {
+        .o = o,
+        .kinds = map_init((comparator_t) regid_comparator, (hash_function_t) regid_hash),
+        .roles = map_init(pointer_comparator, pointer_hash),
+        .bases = map_init((comparator_t) regid_comparator, (hash_function_t) regid_hash),
+        .accessed = vector_init(),
+        .stored = vector_init(),
+        .outside = map_init((comparator_t) regid_comparator, (hash_function_t) regid_hash),
+        .spread = map_init(pointer_comparator, pointer_hash),
+        .renamed = map_init((comparator_t) regid_comparator, (hash_function_t) regid_hash)
+    };
+    bool vectorizing = !o->calls && can_vectorize(&v);
+    if (vectorizing)
+        vectorize(&v);
+    map_delete(v.kinds);
+    map_delete(v.roles);
+    map_delete(v.bases);
+    vector_delete(v.accessed);
+    vector_delete(v.stored);
+    map_delete(v.outside);
+    map_delete(v.spread);
+    map_delete(v.renamed);
+    return vectorizing;
+}
+
+// loops are worked on in phases, each one done to every loop before the next starts
+typedef enum loop_phase
+{
+    LP_HOIST,
+    LP_VECTORIZE,
+    LP_REDUCE,
+    LP_END
+} loop_phase_t;
+
+static bool optimize_loop(air_routine_t* routine, air_loop_t* loop, loop_phase_t phase, air_t* air)
+{
+    loop_optimizer_t o = {
+        .routine = routine,
+        .air = air,
+        .du = air_defuse_init(routine),
+        .loop = loop,
+        .entry = find_entry(loop),
+        .written = map_init(pointer_comparator, pointer_hash)
+    };
+    map_set_deleters(o.written, NULL, (deleter_t) vector_delete);
+    eliminator_init(&o.aliases, routine);
+    find_loop_writes(&o);
+
+    bool changed = false;
+    if (o.entry)
+    {
+        switch (phase)
+        {
+            case LP_HOIST: changed = hoist_invariants(&o); break;
+            case LP_VECTORIZE: changed = vectorize_loop(&o); break;
+            case LP_REDUCE: changed = reduce_strength(&o); break;
+            default: break;
+        }
+    }
+
+    eliminator_delete(&o.aliases);
+    map_delete(o.written);
+    air_defuse_delete(o.du);
+    return changed;
+}
+
+static bool optimize_loops(air_routine_t* routine, bool vectorizing, air_t* air)
+{
+    bool changed = false;
+    // every loop gets hoisted out of before any gets reduced, so bases have a chance to become invariant.
+    // vectorizing comes in between, since it looks for accesses that scale the induction variable.
+    for (loop_phase_t phase = LP_HOIST; phase < LP_END; ++phase)
+    {
+        if (phase == LP_VECTORIZE && !vectorizing)
+            continue;
+        // loops are told apart by their header's first instruction, which stays put as code moves around them
+        map_t* done = map_init(pointer_comparator, pointer_hash); // map_t<air_insn_t*, air_insn_t*>
+        for (;;)
+        {
+            air_loop_t* loop = NULL;
+            VECTOR_FOR(air_loop_t*, candidate, air_routine_cfg(routine)->loops)
+            {
+                if (!map_get(done, candidate->header->first))
+                {
+                    loop = candidate;
+                    break;
+                }
+            }
+            if (!loop)
+                break;
+            map_add(done, loop->header->first, loop->header->first);
+            if (optimize_loop(routine, loop, phase, air))
+            {
+                air_routine_invalidate_cfg(routine);
+                changed = true;
+            }
+        }
+        map_delete(done);
+    }
+    return changed;
+}
+
+/*
+
+function inlining.
+
+a direct call to a routine defined in this translation unit is replaced with a copy of the routine's body when
+the body is small enough: at most inline_threshold instructions, not counting sequence points and declarations,
+or twice that for a function declared inline. every temporary, label, and automatic variable of the copy is
+renamed so that the copy has its own. a parameter that the body only ever loads is read straight from the
+argument, and the rest are variables of the copy that the arguments are assigned to, so:
+    static int sq(int x) { return x * x; }
+    ... int _5 = sq(_4);
+becomes:
+    ... int _5 = _4 * _4;
+when the body returns only at its end, the value it returns becomes the call's. otherwise, each return stores
+its value to a variable of its own and jumps past the copy, where the call's value is loaded from it.
+
+routines are inlined into in the order they're defined, so a helper defined before its callers has already had
+its own calls inlined and been optimized by the time it's copied. calls that come from a copy aren't inlined
+again, which keeps mutually recursive functions from expanding forever.
+
+functions that take or return structures or unions, or that use varargs, are left alone, as are calls to the
+routine doing the calling. the allocator can't spill, so a body is only copied in when the temporaries it needs
+at once, plus the ones live across the call, stay under the same limit that loop optimization works with.
+
+*/
+
+typedef struct inliner
+{
+    air_routine_t* routine;
+    air_t* air;
+    map_t* routines; // map_t<symbol_t*, air_routine_t*>
+    map_t* copied; // map_t<air_insn_t*, air_insn_t*>, calls that came from inlined bodies
+    size_t threshold;
+} inliner_t;
+
+// the routine a call is made to, if it's made directly to one defined here
+static air_routine_t* find_callee(inliner_t* in, air_defuse_t* du, air_insn_t* call)
+{
+    air_insn_operand_t* op = call->ops[1];
+    if (op->type == AOP_REGISTER)
+    {
+        air_insn_t* def = air_defuse_definition(du, op->content.reg);
+        if (!def || def->type != AIR_LOAD_ADDR)
+            return NULL;
+        op = def->ops[1];
+    }
+    if (op->type != AOP_SYMBOL)
+        return NULL;
+    return map_get(in->routines, op->content.sy);
+}
+
+static size_t inline_cost(air_routine_t* routine)
+{
+    size_t cost = 0;
+    for (air_insn_t* insn = routine->insns; insn; insn = insn->next)
+    {
+        switch (insn->type)
+        {
+            case AIR_SEQUENCE_POINT:
+            case AIR_DECLARE:
+            case AIR_NOP:
+                break;
+            default:
+                ++cost;
+                break;
+        }
+    }
+    return cost;
+}
+
+// the most temporaries live at once in a routine
+static size_t routine_pressure(air_routine_t* routine)
+{
+    air_defuse_t* du = air_defuse_init(routine);
+    size_t end = du->positions->size;
+    long long* changes = calloc(end + 1, sizeof *changes);
+    IMAP_FOR(regid_t, vector_t*, du->defs)
+    {
+        vector_t* uses = air_defuse_uses(du, k);
+        if (!uses) continue;
+        ++changes[air_defuse_position(du, vector_get(v, 0))];
+        --changes[air_defuse_position(du, vector_peek(uses)) + 1];
+    }
+    long long live = 0, most = 0;
+    for (size_t i = 0; i < end; ++i)
+    {
+        live += changes[i];
+        if (live > most)
+            most = live;
+    }
+    free(changes);
+    air_defuse_delete(du);
+    return most;
+}
+
+// how many temporaries are defined before a call and used after it
+static size_t live_across(air_defuse_t* du, air_insn_t* call)
+{
+    size_t position = air_defuse_position(du, call);
+    size_t count = 0;
+    IMAP_FOR(regid_t, vector_t*, du->defs)
+    {
+        vector_t* uses = air_defuse_uses(du, k);
+        if (!uses) continue;
+        if (air_defuse_position(du, vector_get(v, 0)) < position && air_defuse_position(du, vector_peek(uses)) > position)
+            ++count;
+    }
+    return count;
+}
+
+// the parameters of a routine, or NULL if they don't line up with its type or can't be assigned like variables
+static vector_t* find_parameters(inliner_t* in, air_routine_t* callee)
+{
+    c_type_t* ftype = callee->sy->type;
+    if (ftype->function.variadic)
+        return NULL;
+    syntax_component_t* fdeclr = syntax_get_function_declarator(callee->sy->declarer);
+    if (!fdeclr || !fdeclr->fdeclr_parameter_declarations)
+        return NULL;
+    vector_t* params = vector_init(); // vector_t<symbol_t*>
+    VECTOR_FOR(syntax_component_t*, pdecl, fdeclr->fdeclr_parameter_declarations)
+    {
+        syntax_component_t* pid = syntax_get_declarator_identifier(pdecl->pdecl_declr);
+        if (!pid) continue;
+        symbol_t* psy = symbol_table_get_syn_id(in->air->st, pid);
+        if (!psy || params->size >= ftype->function.param_types->size ||
+            !type_is_scalar(vector_get(ftype->function.param_types, params->size)))
+        {
+            vector_delete(params);
+            return NULL;
+        }
+        vector_add(params, psy);
+    }
+    if (params->size != ftype->function.param_types->size)
+    {
+        vector_delete(params);
+        return NULL;
+    }
+    return params;
+}
+
+// whether a parameter is only ever loaded whole
+static bool is_only_loaded(air_routine_t* callee, symbol_t* psy, c_type_t* pt)
+{
+    for (air_insn_t* insn = callee->insns; insn; insn = insn->next)
+    {
+        for (size_t i = 0; i < insn->noops; ++i)
+        {
+            air_insn_operand_t* op = insn->ops[i];
+            if (!op) continue;
+            if (op->type == AOP_INDIRECT_SYMBOL && op->content.insy.sy == psy)
+                return false;
+            if (op->type != AOP_SYMBOL || op->content.sy != psy)
+                continue;
+            if (insn->type != AIR_LOAD || i != 1 || insn->ct->class != pt->class)
+                return false;
+        }
+    }
+    return true;
+}
+
+static bool can_inline(inliner_t* in, air_defuse_t* du, air_insn_t* call, air_routine_t* callee)
+{
+    if (!callee || callee == in->routine || !callee->insns || callee->uses_varargs || callee->retptr)
+        return false;
+    if (!call->prev || call->metadata.fcall_sret || map_get(in->copied, call))
+        return false;
+    c_type_t* ftype = callee->sy->type;
+    bool returning = ftype->derived_from->class != CTC_VOID;
+    if (returning && !type_is_scalar(ftype->derived_from))
+        return false;
+    // the call's value has to come from somewhere
+    bool returns = false;
+    for (air_insn_t* insn = callee->insns; insn; insn = insn->next)
+    {
+        switch (insn->type)
+        {
+            case AIR_RETURN:
+                if (returning && !insn->noops)
+                    return false;
+                returns = true;
+                break;
+            case AIR_VA_ARG:
+            case AIR_VA_START:
+            case AIR_VA_END:
+            case AIR_DECLARE_REGISTER:
+            case AIR_BLIP:
+                return false;
+            default:
+                break;
+        }
+    }
+    if (returning && !returns)
+        return false;
+    size_t threshold = in->threshold * (type_is_function_inline(ftype) ? 2 : 1);
+    if (inline_cost(callee) > threshold)
+        return false;
+    return live_across(du, call) + routine_pressure(callee) <= PRESSURE_LIMIT;
+}
+
+// the copy's own symbol for an automatic variable of the routine being inlined
+static symbol_t* copy_variable(inliner_t* in, map_t* symbols, symbol_t* sy, air_insn_t* before)
+{
+    symbol_t* copy = map_get(symbols, sy);
+    if (copy)
+        return copy;
+    copy = symbol_table_add(in->air->st, "__anonymous_lv__", symbol_init(NULL));
+    copy->type = type_copy(sy->type);
+    copy->sd = SD_AUTOMATIC;
+    map_add(symbols, sy, copy);
+
+    air_insn_t* decl = air_insn_init(AIR_DECLARE, 1);
+    decl->ops[0] = air_insn_symbol_operand_init(copy);
+    air_insn_insert_before(decl, before);
+    return copy;
+}
+
+static regid_t copy_register(inliner_t* in, map_t* registers, regid_t reg)
+{
+    if (reg == INVALID_VREGID || reg <= NO_PHYSICAL_REGISTERS)
+        return reg;
+    regid_t copy = (regid_t) map_get(registers, (void*) reg);
+    if (copy == INVALID_VREGID)
+        map_add(registers, (void*) reg, (void*) (copy = in->air->next_available_temporary++));
+    return copy;
+}
+
+static void rename_operand(inliner_t* in, air_insn_operand_t* op, map_t* registers, map_t* symbols, map_t* labels, air_insn_t* before)
+{
+    if (!op) return;
+    switch (op->type)
+    {
+        case AOP_REGISTER:
+            op->content.reg = copy_register(in, registers, op->content.reg);
+            break;
+        case AOP_INDIRECT_REGISTER:
+            op->content.inreg.id = copy_register(in, registers, op->content.inreg.id);
+            op->content.inreg.roffset = copy_register(in, registers, op->content.inreg.roffset);
+            break;
+        case AOP_SYMBOL:
+            if (map_get(symbols, op->content.sy) || symbol_get_storage_duration(op->content.sy) == SD_AUTOMATIC)
+                op->content.sy = copy_variable(in, symbols, op->content.sy, before);
+            break;
+        case AOP_INDIRECT_SYMBOL:
+            if (map_get(symbols, op->content.insy.sy) || symbol_get_storage_duration(op->content.insy.sy) == SD_AUTOMATIC)
+                op->content.insy.sy = copy_variable(in, symbols, op->content.insy.sy, before);
+            break;
+        case AOP_LABEL:
+        {
+            regid_t key = (op->content.label.id << 8) | (unsigned char) op->content.label.disambiguator;
+            unsigned long long id = (unsigned long long) map_get(labels, (void*) key);
+            if (!id)
+                map_add(labels, (void*) key, (void*) (id = ++in->air->next_available_inlined_label));
+            op->content.label.id = id;
+            op->content.label.disambiguator = 'I';
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static void inline_call(inliner_t* in, air_defuse_t* du, air_insn_t* call, air_routine_t* callee, vector_t* params)
+{
+    air_t* air = in->air;
+    c_type_t* ftype = callee->sy->type;
+    map_t* registers = map_init((comparator_t) regid_comparator, (hash_function_t) regid_hash); // map_t<regid_t, regid_t>
+    map_t* symbols = map_init(pointer_comparator, pointer_hash); // map_t<symbol_t*, symbol_t*>
+    map_t* labels = map_init((comparator_t) regid_comparator, (hash_function_t) regid_hash); // map_t<regid_t, unsigned long long>
+
+    // the body's declarations go before everything else in the copy
+    air_insn_t* start = air_insn_init(AIR_NOP, 0);
+    air_insn_insert_before(start, call);
+
+    // a parameter the body only ever loads is taken straight from the argument, rather than through a variable
+    map_t* arguments = map_init(pointer_comparator, pointer_hash); // map_t<symbol_t*, air_insn_operand_t*>
+    VECTOR_FOR(symbol_t*, psy, params)
+    {
+        c_type_t* pt = vector_get(ftype->function.param_types, i);
+        if (call->ops[i + 2]->type == AOP_REGISTER && is_only_loaded(callee, psy, pt))
+        {
+            map_add(arguments, psy, call->ops[i + 2]);
+            continue;
+        }
+        air_insn_t* assign = air_insn_init(AIR_ASSIGN, 2);
+        assign->ct = air_type(vector_get(ftype->function.param_types, i));
+        assign->ops[0] = air_insn_symbol_operand_init(copy_variable(in, symbols, psy, start));
+        assign->ops[1] = air_insn_operand_copy(call->ops[i + 2]);
+        air_insn_insert_before(assign, call);
+    }
+
+    // a body with only the one return at its end hands its value straight to the call
+    air_insn_t* last = callee->insns;
+    size_t returns = 0;
+    for (air_insn_t* insn = callee->insns; insn; insn = insn->next)
+    {
+        if (insn->type == AIR_RETURN)
+            ++returns;
+        last = insn;
+    }
+    bool falls = returns == 0 || (returns == 1 && last->type == AIR_RETURN);
+    regid_t result = call->ops[0]->content.reg;
+    for (air_insn_t* insn = callee->insns; insn; insn = insn->next)
+    {
+        air_insn_operand_t* argument = insn->type == AIR_LOAD && insn->ops[1]->type == AOP_SYMBOL ?
+            map_get(arguments, insn->ops[1]->content.sy) : NULL;
+        if (argument)
+            map_add(registers, (void*) insn->ops[0]->content.reg, (void*) argument->content.reg);
+    }
+    if (falls && last->type == AIR_RETURN && last->noops && last->ops[0]->type == AOP_REGISTER &&
+        !map_get(registers, (void*) last->ops[0]->content.reg))
+        map_add(registers, (void*) last->ops[0]->content.reg, (void*) result);
+
+    symbol_t* value = NULL;
+    if (!falls && ftype->derived_from->class != CTC_VOID)
+    {
+        value = symbol_table_add(air->st, "__anonymous_lv__", symbol_init(NULL));
+        value->type = type_copy(ftype->derived_from);
+        value->sd = SD_AUTOMATIC;
+        air_insn_t* decl = air_insn_init(AIR_DECLARE, 1);
+        decl->ops[0] = air_insn_symbol_operand_init(value);
+        air_insn_insert_before(decl, start);
+    }
+    unsigned long long end = falls ? 0 : ++air->next_available_inlined_label;
+
+    for (air_insn_t* insn = callee->insns; insn; insn = insn->next)
+    {
+        if (insn->type == AIR_RETURN)
+        {
+            if (insn->noops && ftype->derived_from->class != CTC_VOID)
+            {
+                air_insn_operand_t* op = air_insn_operand_copy(insn->ops[0]);
+                rename_operand(in, op, registers, symbols, labels, start);
+                if (value)
+                {
+                    air_insn_t* assign = air_insn_init(AIR_ASSIGN, 2);
+                    assign->ct = air_type(ftype->derived_from);
+                    assign->ops[0] = air_insn_symbol_operand_init(value);
+                    assign->ops[1] = op;
+                    air_insn_insert_before(assign, call);
+                }
+                else if (op->type != AOP_REGISTER || op->content.reg != result)
+                {
+                    air_insn_t* load = air_insn_init(AIR_LOAD, 2);
+                    load->ct = air_type(call->ct);
+                    load->ops[0] = air_insn_register_operand_init(result);
+                    load->ops[1] = op;
+                    air_insn_insert_before(load, call);
+                }
+                else
+                    air_insn_operand_delete(op);
+            }
+            if (!falls)
+            {
+                air_insn_t* jmp = air_insn_init(AIR_JMP, 1);
+                jmp->ops[0] = air_insn_label_operand_init(end, 'I');
+                air_insn_insert_before(jmp, call);
+            }
+            continue;
+        }
+        if (insn->type == AIR_LOAD && insn->ops[1]->type == AOP_SYMBOL && map_get(arguments, insn->ops[1]->content.sy))
+            continue;
+        air_insn_t* copy = air_insn_copy(insn);
+        for (size_t i = 0; i < copy->noops; ++i)
+            rename_operand(in, copy->ops[i], registers, symbols, labels, start);
+        air_insn_insert_before(copy, call);
+        if (copy->type == AIR_FUNC_CALL)
+            map_add(in->copied, copy, copy);
+    }
+
+    if (!falls)
+    {
+        air_insn_t* label = air_insn_init(AIR_LABEL, 1);
+        label->ops[0] = air_insn_label_operand_init(end, 'I');
+        air_insn_insert_before(label, call);
+        if (value)
+        {
+            air_insn_t* load = air_insn_init(AIR_LOAD, 2);
+            load->ct = air_type(call->ct);
+            load->ops[0] = air_insn_register_operand_init(result);
+            load->ops[1] = air_insn_symbol_operand_init(value);
+            air_insn_insert_before(load, call);
+        }
+    }
+
+    // the address of the function goes too if the call was all it was for
+    if (call->ops[1]->type == AOP_REGISTER)
+    {
+        vector_t* uses = air_defuse_uses(du, call->ops[1]->content.reg);
+        if (uses && uses->size == 1)
+            air_insn_remove(air_defuse_definition(du, call->ops[1]->content.reg));
+    }
+    air_insn_remove(call);
+    air_insn_remove(start);
+
+    map_delete(arguments);
+    map_delete(registers);
+    map_delete(symbols);
+    map_delete(labels);
+}
+
+static bool inline_calls(air_routine_t* routine, map_t* routines, size_t threshold, air_t* air)
+{
+    inliner_t in;
+    in.routine = routine;
+    in.air = air;
+    in.routines = routines;
+    in.copied = map_init(pointer_comparator, pointer_hash);
+    in.threshold = threshold;
+
+    bool changed = false;
+    for (bool inlined = true; inlined;)
+    {
+        inlined = false;
+        air_defuse_t* du = air_defuse_init(routine);
+        for (air_insn_t* insn = routine->insns; insn; insn = insn->next)
+        {
+            if (insn->type != AIR_FUNC_CALL)
+                continue;
+            air_routine_t* callee = find_callee(&in, du, insn);
+            if (!can_inline(&in, du, insn, callee))
+                continue;
+            vector_t* params = find_parameters(&in, callee);
+            if (!params || params->size != insn->noops - 2)
+            {
+                vector_delete(params);
+                continue;
+            }
+            inline_call(&in, du, insn, callee, params);
+            vector_delete(params);
+            inlined = changed = true;
+            break;
+        }
+        air_defuse_delete(du);
+    }
+    map_delete(in.copied);
+    return changed;
+}
+
+typedef struct opt1_context
+{
+    map_t* readonly; // map_t<symbol_t*, air_data_t*>
+    map_t* routines; // map_t<symbol_t*, air_routine_t*>
+} opt1_context_t;
+
+static bool inline_calls_pass(pass_manager_t* pm)
+{
+    opt1_options_t* options = pm->options;
+    opt1_context_t* context = pm->context;
+    return options->inline_threshold && inline_calls(pm->routine, context->routines, options->inline_threshold, pm->air);
+}
+
+static bool propagate_constants_pass(pass_manager_t* pm)
+{
+    opt1_context_t* context = pm->context;
+    return propagate_constants(pm->routine, context->readonly, pm->air);
+}
+
+static bool number_values_pass(pass_manager_t* pm)
+{
+    return number_values(pm->routine);
+}
+
+static bool optimize_loops_pass(pass_manager_t* pm)
+{
+    opt1_options_t* options = pm->options;
+    return optimize_loops(pm->routine, options->vectorize_loops, pm->air);
+}
+
+static bool eliminate_dead_code_pass(pass_manager_t* pm)
+{
+    return eliminate_dead_code(pm->routine);
+}
+
+// inlining only drops entries for the registers it touches, so the index stays good for the others
+static bool inline_fcalls_pass(pass_manager_t* pm)
+{
+    bool changed = false;
+    air_defuse_t* du = air_defuse_init(pm->routine);
+    for (air_insn_t* insn = pm->routine->insns; insn;)
+    {
+        air_insn_t* next = insn->next;
+        changed |= try_inline_fcalls(insn, pm->routine, du, pm->air);
+        insn = next;
+    }
+    air_defuse_delete(du);
+    return changed;
+}
+
+static bool remove_fcall_passing_lifetimes_pass(pass_manager_t* pm)
+{
+    air_insn_t* last = pm->routine->insns;
+    while (last->next)
+        last = last->next;
+    bool changed = false;
+    air_defuse_t* du = air_defuse_init(pm->routine);
+    air_liveness_t* liveness = pass_liveness(pm);
+    while (last)
+    {
+        air_insn_t* prev = last->prev;
+        if (air_insn_creates_temporary(last))
+            changed |= try_remove_fcall_passing_lifetimes(last, pm->routine, du, liveness, pm->air);
+        last = prev;
+    }
+    air_defuse_delete(du);
+    return changed;
+}
+
+static pass_t passes[] = {
+    { PHASE_INLINE, PASS_ALWAYS, 0, inline_calls_pass },
+    { PHASE_PROPAGATE, offsetof(opt1_options_t, propagate_constants), 0, propagate_constants_pass },
+    { PHASE_NUMBER, offsetof(opt1_options_t, number_values), 0, number_values_pass },
+    { PHASE_LOOPS, offsetof(opt1_options_t, optimize_loops), 0, optimize_loops_pass },
+    { PHASE_DEAD_CODE, offsetof(opt1_options_t, eliminate_dead_code), 0, eliminate_dead_code_pass },
+    { PHASE_CALLS, offsetof(opt1_options_t, inline_fcalls), 0, inline_fcalls_pass },
+    // moving definitions within their block doesn't change who uses what, or what's live between blocks
+    { PHASE_LIFETIMES, offsetof(opt1_options_t, remove_fcall_passing_lifetimes), ANALYSIS_ALL, remove_fcall_passing_lifetimes_pass }
+};
+
+void opt1(air_t* air, opt1_options_t* options)
+{
+    if (!options) return;
+    opt1_context_t context = {
+        .readonly = map_init(pointer_comparator, pointer_hash),
+        .routines = map_init(pointer_comparator, pointer_hash)
+    };
+    VECTOR_FOR(air_data_t*, data, air->rodata)
+        map_add(context.readonly, data->sy, data);
+    VECTOR_FOR(air_routine_t*, defined, air->routines)
+        map_add(context.routines, defined->sy, defined);
+    pass_manager_t pm = { .options = options, .context = &context, .air = air };
+    VECTOR_FOR(air_routine_t*, routine, air->routines)
+    {
+        if (!routine->insns)
+            continue;
+        pm.routine = routine;
+        pass_run(&pm, passes, sizeof(passes) / sizeof(passes[0]));
+        pass_finish(&pm);
     }
+    map_delete(context.routines);
+    map_delete(context.readonly);
 }
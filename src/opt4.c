@@ -1,30 +1,410 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #include "ecc.h"
 
+/*
+
+peephole optimization over the generated x86 code.
+
+each pattern looks at a window of up to four consecutive instructions (skipped instructions aren't counted) and
+rewrites it in place when it matches, replacing what it drops with X86I_SKIP. every pattern is tried at every
+instruction, and the routine is swept again until a sweep changes nothing. the skipped instructions are unlinked
+at the end.
+
+some patterns need to know that a register's value isn't read after an instruction. the registers live into each
+label are found with a backward pass over the routine first, and a query walks forward from the instruction until
+something reads the register, something overwrites all of it, or control leaves the straight-line code. the label
+sets are recomputed every sweep. the patterns only ever remove reads or move them to where the register was
+already live, so within a sweep they stay an overestimate, which is safe.
+
+a 32-bit write to a register clears its upper half while an 8- or 16-bit one doesn't, so patterns that would drop
+or turn a 32-bit move into a move to the same register are limited to the other sizes. memory is only forwarded
+through the frame's own stack slots, which are the only memory the generated code is known not to share.
+
+*/
+
 static opt4_options_t opt_profile_basic = {
     .remove_same_reg_moves = true,
-    .xor_zero_moves = true
+    .xor_zero_moves = true,
+    .forward_stores = true,
+    .remove_store_backs = true,
+    .remove_move_backs = true,
+    .fold_copies = true,
+    .fold_immediates = true,
+    .remove_redundant_compares = true,
+    .test_zero_compares = true,
+    .remove_jumps_to_next = true,
+    .invert_branches_over_jumps = true,
+    .remove_unreachable_code = true
 };
 
-opt4_options_t* opt4_profile_basic(void)
+// the options for an optimization level, or NULL if opt4 shouldn't run at all. every level that optimizes gets every
+// pattern, since they're cheap and never make the code bigger
+opt4_options_t* opt4_profile(optimization_level_t level)
+{
+    return level == OPTIMIZE_NONE ? NULL : &opt_profile_basic;
+}
+
+#define MAX_PEEPHOLE_WINDOW 4
+
+#define REGISTER_BIT(reg) ((uint32_t) 1 << (reg))
+
+// marks a label's set as found, since a label can have nothing live into it
+#define LABEL_FOUND REGISTER_BIT(0)
+
+#define ALL_REGISTERS (uint32_t) 0xFFFFFFFE
+
+// %rsp and %rbp hold the frame, so they're never free to rewrite
+#define FRAME_REGISTERS (REGISTER_BIT(X86R_RSP) | REGISTER_BIT(X86R_RBP))
+
+#define SSE_REGISTERS (uint32_t) (0xFF << X86R_XMM0)
+
+#define ARGUMENT_REGISTERS (REGISTER_BIT(X86R_RAX) | REGISTER_BIT(X86R_RDI) | REGISTER_BIT(X86R_RSI) | \
+    REGISTER_BIT(X86R_RDX) | REGISTER_BIT(X86R_RCX) | REGISTER_BIT(X86R_R8) | REGISTER_BIT(X86R_R9) | SSE_REGISTERS)
+
+#define CALLER_SAVED_REGISTERS (ARGUMENT_REGISTERS | REGISTER_BIT(X86R_R10) | REGISTER_BIT(X86R_R11))
+
+#define SYSCALL_REGISTERS (REGISTER_BIT(X86R_RAX) | REGISTER_BIT(X86R_RDI) | REGISTER_BIT(X86R_RSI) | \
+    REGISTER_BIT(X86R_RDX) | REGISTER_BIT(X86R_R10) | REGISTER_BIT(X86R_R8) | REGISTER_BIT(X86R_R9))
+
+// the return registers and the ones the epilogue restores
+#define RETURN_REGISTERS (REGISTER_BIT(X86R_RAX) | REGISTER_BIT(X86R_RDX) | REGISTER_BIT(X86R_XMM0) | \
+    REGISTER_BIT(X86R_XMM1) | REGISTER_BIT(X86R_RBX) | REGISTER_BIT(X86R_R12) | REGISTER_BIT(X86R_R13) | \
+    REGISTER_BIT(X86R_R14) | REGISTER_BIT(X86R_R15) | FRAME_REGISTERS)
+
+typedef struct peephole
+{
+    x86_asm_routine_t* routine;
+    x86_asm_file_t* file;
+    map_t* labels; // map_t<char*, uint32_t>, the registers live into each label
+} peephole_t;
+
+typedef struct peephole_pattern
+{
+    size_t window; // how many instructions the pattern looks at
+    size_t option; // offset of the pattern's flag in opt4_options_t
+    bool (*apply)(x86_insn_t** window, peephole_t* p);
+} peephole_pattern_t;
+
+static uint32_t register_bit(regid_t reg)
+{
+    return reg >= X86R_RAX && reg <= X86R_XMM7 ? REGISTER_BIT(reg) : 0;
+}
+
+static uint32_t operand_registers(x86_operand_t* op)
+{
+    if (!op) return 0;
+    switch (op->type)
+    {
+        case X86OP_REGISTER:
+        case X86OP_PTR_REGISTER:
+            return register_bit(op->reg);
+        case X86OP_DEREF_REGISTER:
+            return register_bit(op->deref_reg.reg_addr);
+        case X86OP_ARRAY:
+            return register_bit(op->array.reg_base) | register_bit(op->array.reg_offset);
+        default:
+            return 0;
+    }
+}
+
+// a register read or written at the instruction's own size
+static bool is_plain_register(x86_insn_t* insn, x86_operand_t* op)
 {
-    return &opt_profile_basic;
+    return op && op->type == X86OP_REGISTER && (!op->size || op->size == insn->size);
+}
+
+static bool is_plain_integer_register(x86_insn_t* insn, x86_operand_t* op)
+{
+    return is_plain_register(insn, op) && x86_64_is_integer_register(op->reg) && !(register_bit(op->reg) & FRAME_REGISTERS);
+}
+
+// without a frame pointer, %rbp can hold any pointer
+static bool is_stack_slot(peephole_t* p, x86_operand_t* op)
+{
+    regid_t frame = p->routine->omits_frame_pointer ? X86R_RSP : X86R_RBP;
+    return op && op->type == X86OP_DEREF_REGISTER && op->deref_reg.reg_addr == frame;
+}
+
+static bool is_label_jump(x86_insn_t* insn)
+{
+    switch (insn->type)
+    {
+        case X86I_JMP:
+        case X86I_JE:
+        case X86I_JNE:
+        case X86I_JNB:
+        case X86I_JS:
+        case X86I_JL:
+        case X86I_JLE:
+        case X86I_JG:
+        case X86I_JGE:
+        case X86I_JA:
+        case X86I_JB:
+        case X86I_JBE:
+        case X86I_JP:
+            return insn->op1 && insn->op1->type == X86OP_LABEL;
+        default:
+            return false;
+    }
+}
+
+// the return label is written after the routine's last instruction, so it can only be jumped to by jmp
+static bool is_return_label(x86_operand_t* op)
+{
+    return op && op->type == X86OP_LABEL && starts_with_ignore_case(op->label, ".LR");
+}
+
+static bool fits_int32(unsigned long long immediate)
+{
+    return (long long) immediate >= INT32_MIN && (long long) immediate <= INT32_MAX;
+}
+
+// finds the registers an instruction reads and the ones it overwrites entirely
+static void find_registers(x86_insn_t* insn, uint32_t* reads, uint32_t* kills)
+{
+    *reads = operand_registers(insn->op1) | operand_registers(insn->op2) | operand_registers(insn->op3);
+    *kills = 0;
+    switch (insn->type)
+    {
+        case X86I_MOV:
+        case X86I_MOVZX:
+        case X86I_MOVSX:
+        case X86I_LEA:
+        case X86I_CVTTSS2SI:
+        case X86I_CVTTSD2SI:
+        {
+            if (!insn->op2 || insn->op2->type != X86OP_REGISTER)
+                break;
+            // an 8- or 16-bit write keeps the rest of the register
+            x86_insn_size_t size = insn->op2->size ? insn->op2->size : insn->size;
+            if (size != X86SZ_DWORD && size != X86SZ_QWORD)
+                break;
+            *reads = operand_registers(insn->op1);
+            *kills = register_bit(insn->op2->reg);
+            break;
+        }
+        case X86I_MOVSS:
+        case X86I_MOVSD:
+            // only a load replaces the whole register
+            if (!insn->op1 || insn->op1->type == X86OP_REGISTER || !insn->op2 || insn->op2->type != X86OP_REGISTER)
+                break;
+            *reads = operand_registers(insn->op1);
+            *kills = register_bit(insn->op2->reg);
+            break;
+        case X86I_MOVUPS:
+        case X86I_MOVUPD:
+        case X86I_MOVDQU:
+            // packed moves replace the whole register either way
+            if (!insn->op2 || insn->op2->type != X86OP_REGISTER)
+                break;
+            *reads = operand_registers(insn->op1);
+            *kills = register_bit(insn->op2->reg);
+            break;
+        case X86I_XOR:
+        case X86I_XORPS:
+        case X86I_XORPD:
+            if (!insn->op1 || !insn->op2 || insn->op1->type != X86OP_REGISTER || insn->op2->type != X86OP_REGISTER)
+                break;
+            if (insn->op1->reg != insn->op2->reg || insn->size == X86SZ_BYTE || insn->size == X86SZ_WORD)
+                break;
+            *reads = 0;
+            *kills = register_bit(insn->op2->reg);
+            break;
+        case X86I_POP:
+            if (insn->op1 && insn->op1->type == X86OP_REGISTER)
+                *reads = 0, *kills = register_bit(insn->op1->reg);
+            break;
+        case X86I_CALL:
+            *reads |= ARGUMENT_REGISTERS;
+            *kills = CALLER_SAVED_REGISTERS;
+            break;
+        case X86I_SYSCALL:
+            *reads |= SYSCALL_REGISTERS;
+            *kills = REGISTER_BIT(X86R_RCX) | REGISTER_BIT(X86R_R11);
+            break;
+        case X86I_MUL:
+        case X86I_DIV:
+        case X86I_IDIV:
+            *reads |= REGISTER_BIT(X86R_RAX) | REGISTER_BIT(X86R_RDX);
+            break;
+        case X86I_IMUL:
+            if (!insn->op2)
+                *reads |= REGISTER_BIT(X86R_RAX) | REGISTER_BIT(X86R_RDX);
+            break;
+        case X86I_REP_STOSB:
+            *reads |= REGISTER_BIT(X86R_RAX) | REGISTER_BIT(X86R_RCX) | REGISTER_BIT(X86R_RDI);
+            break;
+        case X86I_CQTO:
+            *reads |= REGISTER_BIT(X86R_RAX);
+            *kills = REGISTER_BIT(X86R_RDX);
+            break;
+        case X86I_UNKNOWN:
+        case X86I_NO_ELEMENTS:
+        case X86I_LEAVE:
+        case X86I_RET:
+        case X86I_TAIL_JMP:
+            *reads = ALL_REGISTERS;
+            break;
+        default:
+            break;
+    }
+}
+
+static uint32_t label_live(peephole_t* p, x86_operand_t* label)
+{
+    if (is_return_label(label))
+        return RETURN_REGISTERS;
+    uint32_t live = (uint32_t) (uintptr_t) map_get(p->labels, label->label);
+    // a label outside the routine could have anything live into it
+    return live & LABEL_FOUND ? live & ~LABEL_FOUND : ALL_REGISTERS;
+}
+
+// the registers live into where a jump can go, other than the instruction after it
+static uint32_t jump_live(peephole_t* p, x86_insn_t* insn)
+{
+    return is_label_jump(insn) ? label_live(p, insn->op1) : ALL_REGISTERS;
+}
+
+// steps the registers live after an instruction back to before it
+static uint32_t step_live(peephole_t* p, x86_insn_t* insn, uint32_t live)
+{
+    switch (insn->type)
+    {
+        case X86I_SKIP:
+        case X86I_LABEL:
+            return live;
+        case X86I_JMP:
+            return jump_live(p, insn);
+        case X86I_JE:
+        case X86I_JNE:
+        case X86I_JNB:
+        case X86I_JS:
+        case X86I_JL:
+        case X86I_JLE:
+        case X86I_JG:
+        case X86I_JGE:
+        case X86I_JA:
+        case X86I_JB:
+        case X86I_JBE:
+        case X86I_JP:
+            return live | jump_live(p, insn);
+        default:
+        {
+            uint32_t reads, kills;
+            find_registers(insn, &reads, &kills);
+            return (live & ~kills) | reads;
+        }
+    }
+}
+
+static void find_label_liveness(peephole_t* p)
+{
+    p->labels = map_init((comparator_t) strcmp, (hash_function_t) hash);
+    vector_t* insns = vector_init(); // vector_t<x86_insn_t*>, to walk the routine backwards
+    for (x86_insn_t* insn = p->routine->insns; insn; insn = insn->next)
+    {
+        if (insn->type == X86I_SKIP)
+            continue;
+        if (insn->type == X86I_LABEL)
+            map_add(p->labels, insn->op1->label, (void*) (uintptr_t) LABEL_FOUND);
+        vector_add(insns, insn);
+    }
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        // falling off the end runs the epilogue
+        uint32_t live = RETURN_REGISTERS;
+        for (size_t i = insns->size; i > 0; --i)
+        {
+            x86_insn_t* insn = vector_get(insns, i - 1);
+            if (insn->type != X86I_LABEL)
+            {
+                live = step_live(p, insn, live);
+                continue;
+            }
+            uint32_t old = (uint32_t) (uintptr_t) map_get(p->labels, insn->op1->label);
+            if ((old | live | LABEL_FOUND) == old)
+                continue;
+            map_add(p->labels, insn->op1->label, (void*) (uintptr_t) (old | live | LABEL_FOUND));
+            changed = true;
+        }
+    }
+    vector_delete(insns);
+}
+
+// whether nothing reads a register's value after an instruction
+static bool register_dead_after(peephole_t* p, x86_insn_t* insn, regid_t reg)
+{
+    uint32_t bit = register_bit(reg);
+    if (!bit || (bit & FRAME_REGISTERS))
+        return false;
+    for (x86_insn_t* next = insn->next; next; next = next->next)
+    {
+        switch (next->type)
+        {
+            case X86I_SKIP:
+                continue;
+            case X86I_LABEL:
+                return !(label_live(p, next->op1) & bit);
+            case X86I_JMP:
+                return !(jump_live(p, next) & bit);
+            case X86I_JE:
+            case X86I_JNE:
+            case X86I_JNB:
+            case X86I_JS:
+            case X86I_JL:
+            case X86I_JLE:
+            case X86I_JG:
+            case X86I_JGE:
+            case X86I_JA:
+            case X86I_JB:
+            case X86I_JBE:
+            case X86I_JP:
+                if (jump_live(p, next) & bit)
+                    return false;
+                continue;
+            default:
+            {
+                uint32_t reads, kills;
+                find_registers(next, &reads, &kills);
+                if (reads & bit)
+                    return false;
+                if (kills & bit)
+                    return true;
+                continue;
+            }
+        }
+    }
+    return !(RETURN_REGISTERS & bit);
+}
+
+static void skip_insn(x86_insn_t* insn)
+{
+    insn->type = X86I_SKIP;
 }
 
 /*
 
 removes instructions like:
-    movl %eax, %eax
+    movq %rax, %rax
     movss %xmm0, %xmm0
 
+but not movl %eax, %eax, which zero-extends.
+
 */
-static bool try_remove_same_reg_moves(x86_insn_t* insn, x86_asm_routine_t* routine, x86_asm_file_t* file)
+static bool try_remove_same_reg_moves(x86_insn_t** w, peephole_t* p)
 {
+    x86_insn_t* insn = w[0];
+    if (insn->type != X86I_MOV && insn->type != X86I_MOVSS && insn->type != X86I_MOVSD) return false;
     if (!insn->op1 || !insn->op2) return false;
     if (insn->op1->type != X86OP_REGISTER || insn->op2->type != X86OP_REGISTER) return false;
     if (insn->op1->reg != insn->op2->reg) return false;
+    if (insn->type == X86I_MOV && insn->size == X86SZ_DWORD) return false;
     x86_operand_delete(insn->op1);
     x86_operand_delete(insn->op2);
     insn->op1 = insn->op2 = NULL;
@@ -40,8 +420,10 @@ into:
     xorl %eax, %eax
 
 */
-static bool try_xor_zero_moves(x86_insn_t* insn, x86_asm_routine_t* routine, x86_asm_file_t* file)
+static bool try_xor_zero_moves(x86_insn_t** w, peephole_t* p)
 {
+    x86_insn_t* insn = w[0];
+    if (insn->type != X86I_MOV) return false;
     if (!insn->op1 || !insn->op2) return false;
     if (insn->op2->type != X86OP_REGISTER) return false;
     if (insn->op1->type != X86OP_IMMEDIATE) return false;
@@ -53,24 +435,403 @@ static bool try_xor_zero_moves(x86_insn_t* insn, x86_asm_routine_t* routine, x86
     return true;
 }
 
-void opt4(x86_asm_file_t* file, opt4_options_t* options)
+/*
+
+forwards a store to the load right after it:
+    movl %eax, -4(%rbp)
+    movl -4(%rbp), %edi
+becomes:
+    movl %eax, -4(%rbp)
+    movl %eax, %edi
+
+and the load is removed if it's back into the same register, unless it's 32-bit.
+
+*/
+static bool try_forward_stores(x86_insn_t** w, peephole_t* p)
 {
-    VECTOR_FOR(x86_asm_routine_t*, routine, file->routines)
+    x86_insn_t* store = w[0];
+    x86_insn_t* load = w[1];
+    if (store->type != X86I_MOV || load->type != X86I_MOV || store->size != load->size) return false;
+    if (!is_plain_integer_register(store, store->op1) || !is_stack_slot(p, store->op2)) return false;
+    if (!is_plain_integer_register(load, load->op2) || !x86_operand_equals(store->op2, load->op1)) return false;
+    if (load->op2->reg == store->op1->reg)
+    {
+        if (load->size == X86SZ_DWORD) return false;
+        skip_insn(load);
+        return true;
+    }
+    load->op1->type = X86OP_REGISTER;
+    load->op1->size = X86SZ_NONE;
+    load->op1->reg = store->op1->reg;
+    return true;
+}
+
+/*
+
+removes the store in:
+    movl -4(%rbp), %eax
+    movl %eax, -4(%rbp)
+
+*/
+static bool try_remove_store_backs(x86_insn_t** w, peephole_t* p)
+{
+    x86_insn_t* load = w[0];
+    x86_insn_t* store = w[1];
+    if (load->type != X86I_MOV || store->type != X86I_MOV || load->size != store->size) return false;
+    if (!is_stack_slot(p, load->op1) || !is_plain_integer_register(load, load->op2)) return false;
+    if (!is_plain_register(store, store->op1) || store->op1->reg != load->op2->reg) return false;
+    if (!x86_operand_equals(load->op1, store->op2)) return false;
+    skip_insn(store);
+    return true;
+}
+
+/*
+
+removes the second move in:
+    movq %rax, %rdi
+    movq %rdi, %rax
+
+unless they're 32-bit, since the second one clears the upper half of %rax.
+
+*/
+static bool try_remove_move_backs(x86_insn_t** w, peephole_t* p)
+{
+    x86_insn_t* first = w[0];
+    x86_insn_t* second = w[1];
+    if (first->type != second->type || first->size != second->size) return false;
+    if (first->type != X86I_MOV && first->type != X86I_MOVSS && first->type != X86I_MOVSD) return false;
+    if (first->type == X86I_MOV && first->size == X86SZ_DWORD) return false;
+    if (!is_plain_register(first, first->op1) || !is_plain_register(first, first->op2)) return false;
+    if (!is_plain_register(second, second->op1) || !is_plain_register(second, second->op2)) return false;
+    if (first->op1->reg != second->op2->reg || first->op2->reg != second->op1->reg) return false;
+    skip_insn(second);
+    return true;
+}
+
+/*
+
+moves through a register that isn't read afterwards:
+    movl -8(%rbp), %esi
+    movl %esi, (%rax)
+become:
+    movl -8(%rbp), (%rax)
+
+as long as that isn't a memory to memory move.
+
+*/
+static bool try_fold_copies(x86_insn_t** w, peephole_t* p)
+{
+    x86_insn_t* first = w[0];
+    x86_insn_t* second = w[1];
+    if (first->type != X86I_MOV || second->type != X86I_MOV || first->size != second->size) return false;
+    if (!first->op1 || !second->op2) return false;
+    if (!is_plain_integer_register(first, first->op2)) return false;
+    regid_t reg = first->op2->reg;
+    if (!is_plain_register(second, second->op1) || second->op1->reg != reg) return false;
+    x86_operand_t* src = first->op1;
+    x86_operand_t* dest = second->op2;
+    if (operand_registers(dest) & register_bit(reg)) return false;
+    if (src->type == X86OP_REGISTER && !is_plain_register(first, src)) return false;
+    if (src->type != X86OP_REGISTER && src->type != X86OP_IMMEDIATE && dest->type != X86OP_REGISTER) return false;
+    if (src->type == X86OP_IMMEDIATE && dest->type != X86OP_REGISTER && first->size == X86SZ_QWORD && !fits_int32(src->immediate))
+        return false;
+    if (src->type == X86OP_REGISTER && dest->type == X86OP_REGISTER && src->reg == dest->reg && first->size == X86SZ_DWORD)
+        return false;
+    if (!register_dead_after(p, second, reg)) return false;
+    x86_operand_delete(first->op2);
+    first->op2 = dest;
+    second->op2 = NULL;
+    skip_insn(second);
+    return true;
+}
+
+/*
+
+puts a constant straight into the instruction that reads it:
+    movl $1, %esi
+    addl %esi, (%rax)
+becomes:
+    addl $1, (%rax)
+
+if nothing reads the register afterwards. a zeroing xor counts as a move of 0.
+
+*/
+static bool try_fold_immediates(x86_insn_t** w, peephole_t* p)
+{
+    x86_insn_t* def = w[0];
+    x86_insn_t* use = w[1];
+    unsigned long long value = 0;
+    if (def->type == X86I_MOV && def->op1 && def->op1->type == X86OP_IMMEDIATE)
+        value = def->op1->immediate;
+    else if (def->type != X86I_XOR || !is_plain_register(def, def->op1) || !def->op2 || def->op1->reg != def->op2->reg)
+        return false;
+    if (!is_plain_integer_register(def, def->op2)) return false;
+    regid_t reg = def->op2->reg;
+    if (!is_plain_register(use, use->op1) || use->op1->reg != reg || use->op3) return false;
+    if (!use->op2 || (operand_registers(use->op2) & register_bit(reg))) return false;
+    switch (use->type)
+    {
+        case X86I_ADD:
+        case X86I_SUB:
+        case X86I_AND:
+        case X86I_OR:
+        case X86I_XOR:
+        case X86I_CMP:
+        case X86I_TEST:
+            if (use->size != def->size || (use->size == X86SZ_QWORD && !fits_int32(value)))
+                return false;
+            break;
+        case X86I_IMUL:
+            if (use->size != def->size || use->size == X86SZ_BYTE || !fits_int32(value) || use->op2->type != X86OP_REGISTER)
+                return false;
+            break;
+        case X86I_SHL:
+        case X86I_SHR:
+        case X86I_SAR:
+        case X86I_ROR:
+            // the count is read from %cl whatever the shift's size
+            if (value > UINT8_MAX || use->op1->size != X86SZ_NONE)
+                return false;
+            break;
+        default:
+            return false;
+    }
+    if (!register_dead_after(p, use, reg)) return false;
+    use->op1->type = X86OP_IMMEDIATE;
+    use->op1->size = X86SZ_NONE;
+    use->op1->immediate = value;
+    skip_insn(def);
+    return true;
+}
+
+/*
+
+removes the compare in:
+    andl %edx, %eax
+    cmpl $0, %eax
+
+since the and, or, or xor already set the flags the same way. an and with a small enough positive constant can't
+set the high bits, so it can be wider than the compare.
+
+*/
+static bool try_remove_redundant_compares(x86_insn_t** w, peephole_t* p)
+{
+    x86_insn_t* op = w[0];
+    x86_insn_t* cmp = w[1];
+    if (op->type != X86I_AND && op->type != X86I_OR && op->type != X86I_XOR) return false;
+    if (cmp->type != X86I_CMP || !cmp->op1 || cmp->op1->type != X86OP_IMMEDIATE || cmp->op1->immediate != 0) return false;
+    if (!is_plain_integer_register(op, op->op2) || !is_plain_integer_register(cmp, cmp->op2)) return false;
+    if (op->op2->reg != cmp->op2->reg) return false;
+    if (op->size != cmp->size)
     {
-        for (x86_insn_t* insn = routine->insns; insn; insn = insn->next)
+        if (op->type != X86I_AND || !op->op1 || op->op1->type != X86OP_IMMEDIATE) return false;
+        // narrower ands leave the rest of the register alone, but a 32-bit one clears it
+        if (op->size < cmp->size && !(op->size == X86SZ_DWORD && cmp->size == X86SZ_QWORD)) return false;
+        x86_insn_size_t size = op->size < cmp->size ? op->size : cmp->size;
+        int bits = size == X86SZ_BYTE ? 8 : size == X86SZ_WORD ? 16 : 32;
+        if (op->op1->immediate >= (1ULL << (bits - 1))) return false;
+    }
+    skip_insn(cmp);
+    return true;
+}
+
+/*
+
+converts instructions like:
+    cmpl $0, %eax
+into:
+    testl %eax, %eax
+
+*/
+static bool try_test_zero_compares(x86_insn_t** w, peephole_t* p)
+{
+    x86_insn_t* insn = w[0];
+    if (insn->type != X86I_CMP || !insn->op1 || insn->op1->type != X86OP_IMMEDIATE || insn->op1->immediate != 0) return false;
+    if (!is_plain_integer_register(insn, insn->op2)) return false;
+    insn->type = X86I_TEST;
+    insn->op1->type = X86OP_REGISTER;
+    insn->op1->reg = insn->op2->reg;
+    return true;
+}
+
+/*
+
+removes the jump in:
+    jmp .L1
+.L1:
+
+*/
+static bool try_remove_jumps_to_next(x86_insn_t** w, peephole_t* p)
+{
+    x86_insn_t* jmp = w[0];
+    x86_insn_t* label = w[1];
+    if (!is_label_jump(jmp) || label->type != X86I_LABEL) return false;
+    if (!x86_operand_equals(jmp->op1, label->op1)) return false;
+    skip_insn(jmp);
+    return true;
+}
+
+// the branch taken exactly when the given one isn't, or X86I_UNKNOWN if there's none (jp has no single inverse)
+static x86_insn_type_t inverse_branch(x86_insn_type_t type)
+{
+    switch (type)
+    {
+        case X86I_JE: return X86I_JNE;
+        case X86I_JNE: return X86I_JE;
+        case X86I_JL: return X86I_JGE;
+        case X86I_JGE: return X86I_JL;
+        case X86I_JLE: return X86I_JG;
+        case X86I_JG: return X86I_JLE;
+        case X86I_JA: return X86I_JBE;
+        case X86I_JBE: return X86I_JA;
+        case X86I_JB: return X86I_JNB;
+        case X86I_JNB: return X86I_JB;
+        default: return X86I_UNKNOWN;
+    }
+}
+
+/*
+
+converts branches over a jump like:
+    je .L1
+    jmp .L2
+.L1:
+into:
+    jne .L2
+.L1:
+
+*/
+static bool try_invert_branches_over_jumps(x86_insn_t** w, peephole_t* p)
+{
+    x86_insn_t* branch = w[0];
+    x86_insn_t* jmp = w[1];
+    x86_insn_t* label = w[2];
+    x86_insn_type_t inverse = inverse_branch(branch->type);
+    if (inverse == X86I_UNKNOWN) return false;
+    if (!is_label_jump(branch) || jmp->type != X86I_JMP || !is_label_jump(jmp) || label->type != X86I_LABEL) return false;
+    if (is_return_label(jmp->op1) || !x86_operand_equals(branch->op1, label->op1)) return false;
+    branch->type = inverse;
+    x86_operand_delete(branch->op1);
+    branch->op1 = jmp->op1;
+    jmp->op1 = NULL;
+    skip_insn(jmp);
+    return true;
+}
+
+/*
+
+removes instructions between a jump and the next label, since nothing can reach them:
+    jmp .L1
+    movl $1, %eax
+.L2:
+
+this includes what a tail call leaves behind for the return it replaced.
+
+*/
+static bool try_remove_unreachable_code(x86_insn_t** w, peephole_t* p)
+{
+    x86_insn_t* jmp = w[0];
+    x86_insn_t* dead = w[1];
+    if ((jmp->type != X86I_JMP && jmp->type != X86I_TAIL_JMP) || dead->type == X86I_LABEL) return false;
+    skip_insn(dead);
+    return true;
+}
+
+static peephole_pattern_t patterns[] = {
+    { 2, offsetof(opt4_options_t, remove_unreachable_code), try_remove_unreachable_code },
+    { 2, offsetof(opt4_options_t, remove_jumps_to_next), try_remove_jumps_to_next },
+    { 3, offsetof(opt4_options_t, invert_branches_over_jumps), try_invert_branches_over_jumps },
+    { 2, offsetof(opt4_options_t, forward_stores), try_forward_stores },
+    { 2, offsetof(opt4_options_t, remove_store_backs), try_remove_store_backs },
+    { 2, offsetof(opt4_options_t, remove_move_backs), try_remove_move_backs },
+    { 2, offsetof(opt4_options_t, fold_immediates), try_fold_immediates },
+    { 2, offsetof(opt4_options_t, fold_copies), try_fold_copies },
+    { 2, offsetof(opt4_options_t, remove_redundant_compares), try_remove_redundant_compares },
+    { 1, offsetof(opt4_options_t, test_zero_compares), try_test_zero_compares },
+    { 1, offsetof(opt4_options_t, remove_same_reg_moves), try_remove_same_reg_moves },
+    { 1, offsetof(opt4_options_t, xor_zero_moves), try_xor_zero_moves }
+};
+
+// fills the window with the instruction and the ones after it, returning how many there were
+static size_t fill_window(x86_insn_t* insn, x86_insn_t** w)
+{
+    size_t count = 0;
+    for (; insn && count < MAX_PEEPHOLE_WINDOW; insn = insn->next)
+    {
+        if (insn->type != X86I_SKIP)
+            w[count++] = insn;
+    }
+    return count;
+}
+
+// tries every pattern at an instruction until none match
+static bool apply_patterns(x86_insn_t* insn, peephole_t* p, opt4_options_t* options)
+{
+    bool changed = false;
+    for (size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]) && insn->type != X86I_SKIP;)
+    {
+        peephole_pattern_t* pattern = &patterns[i++];
+        if (!*(bool*) ((char*) options + pattern->option))
+            continue;
+        x86_insn_t* w[MAX_PEEPHOLE_WINDOW];
+        if (fill_window(insn, w) < pattern->window || !pattern->apply(w, p))
+            continue;
+        // the rewrite can make earlier patterns match
+        changed = true;
+        i = 0;
+    }
+    return changed;
+}
+
+static void remove_skipped_insns(x86_asm_routine_t* routine)
+{
+    for (x86_insn_t** link = &routine->insns; *link;)
+    {
+        x86_insn_t* insn = *link;
+        if (insn->type != X86I_SKIP)
         {
-            switch (insn->type)
-            {
-                case X86I_MOV:
-                    if (try_xor_zero_moves(insn, routine, file))
-                        break;
-                case X86I_MOVSD:
-                case X86I_MOVSS:
-                    try_remove_same_reg_moves(insn, routine, file);
-                    break;
-                default:
-                    break;
-            }
+            link = &insn->next;
+            continue;
+        }
+        *link = insn->next;
+        x86_insn_delete(insn);
+    }
+}
+
+static bool peephole_pass(pass_manager_t* pm)
+{
+    peephole_t* p = pm->context;
+    bool swept = false;
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        find_label_liveness(p);
+        for (x86_insn_t* insn = p->routine->insns; insn; insn = insn->next)
+        {
+            if (insn->type != X86I_SKIP && apply_patterns(insn, p, pm->options))
+                changed = swept = true;
         }
+        map_delete(p->labels);
     }
+    remove_skipped_insns(p->routine);
+    return swept;
+}
+
+static pass_t passes[] = {
+    { PHASE_PEEPHOLE, PASS_ALWAYS, ANALYSIS_ALL, peephole_pass }
+};
+
+void opt4_routine(x86_asm_routine_t* routine, x86_asm_file_t* file, opt4_options_t* options)
+{
+    if (!options) return;
+    peephole_t p = { .routine = routine, .file = file };
+    pass_manager_t pm = { .options = options, .context = &p };
+    pass_run(&pm, passes, sizeof(passes) / sizeof(passes[0]));
+    pass_finish(&pm);
+}
+
+void opt4(x86_asm_file_t* file, opt4_options_t* options)
+{
+    VECTOR_FOR(x86_asm_routine_t*, routine, file->routines)
+        opt4_routine(routine, file, options);
 }
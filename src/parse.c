@@ -74,7 +74,7 @@ RULES TO FOLLOW:
 #define init_syn(t) \
     syntax_component_t* syn = calloc(1, sizeof *syn); \
     syn->type = (t); \
-    if (token) syn->row = token->row, syn->col = token->col; \
+    syn->row = token->row, syn->col = token->col; \
     syn->parent = parent;
 
 #define try_parse(type, name, ...) \
@@ -98,19 +98,19 @@ RULES TO FOLLOW:
         err->type = SC_ERROR; \
         err->err_message = strdup(buffer); \
         err->err_depth = depth; \
-        err->row = (token) ? (token)->row : 0; \
-        err->col = (token) ? (token)->col : 0; \
+        err->row = (token)->row; \
+        err->col = (token)->col; \
         vector_add(tlu->tlu_errors, err); \
     }
 
 // does NOT deallocate syntax elements
 #define advance_token \
-    if (!token) \
+    if (token->type == T_END) \
     { \
         fail_parse(token, "unexpected end of file"); \
         return NULL; \
     } \
-    token = token->next;
+    ++token;
 
 #define next_depth (depth + 1)
 
@@ -157,22 +157,16 @@ syntax_component_t* parse_initializer_list(token_t** tokens, parse_request_code_
 
 bool is_keyword(token_t* token, c_keyword_t keyword)
 {
-    if (!token)
-        return false;
     return token->type == T_KEYWORD && token->keyword == keyword;
 }
 
 bool is_punctuator(token_t* token, punctuator_type_t punctuator)
 {
-    if (!token)
-        return false;
     return token->type == T_PUNCTUATOR && token->punctuator == punctuator;
 }
 
 bool has_identifier(token_t* token, char* id)
 {
-    if (!token)
-        return false;
     return token->type == T_IDENTIFIER && !strcmp(token->identifier, id);
 }
 
@@ -187,7 +181,7 @@ syntax_component_t* parse_stub(token_t** tokens, parse_request_code_t req, parse
 syntax_component_t* parse_identifier(token_t** tokens, parse_request_code_t req, parse_status_code_t* stat, syntax_component_t* tlu, int depth, syntax_component_t* parent, syntax_component_type_t type)
 {
     init_parse;
-    if (!token)
+    if (token->type == T_END)
     {
         // ISO: 6.4.2.1 (1)
         fail_parse(token, "expected identifier, got EOF");
@@ -202,7 +196,7 @@ syntax_component_t* parse_identifier(token_t** tokens, parse_request_code_t req,
         return NULL;
     }
 
-    syn->id = strdup(token->identifier);
+    syn->id = token->identifier;
 
     advance_token;
     update_status(FOUND);
@@ -460,7 +454,7 @@ syntax_component_t* parse_enum_specifier(token_t** tokens, parse_request_code_t
 syntax_component_t* parse_storage_class_specifier(token_t** tokens, parse_request_code_t req, parse_status_code_t* stat, syntax_component_t* tlu, int depth, syntax_component_t* parent)
 {
     init_parse;
-    if (!token)
+    if (token->type == T_END)
     {
         // ISO: 6.7.1 (1)
         fail_parse(token, "expected storage class specifier, got EOF");
@@ -499,7 +493,7 @@ syntax_component_t* parse_storage_class_specifier(token_t** tokens, parse_reques
 syntax_component_t* parse_type_specifier(token_t** tokens, parse_request_code_t req, parse_status_code_t* stat, syntax_component_t* tlu, int depth, syntax_component_t* parent)
 {
     init_parse;
-    if (!token)
+    if (token->type == T_END)
     {
         // ISO: 6.7.2 (1)
         fail_parse(token, "expected type specifier, got EOF");
@@ -588,7 +582,7 @@ syntax_component_t* parse_type_specifier(token_t** tokens, parse_request_code_t
 syntax_component_t* parse_type_qualifier(token_t** tokens, parse_request_code_t req, parse_status_code_t* stat, syntax_component_t* tlu, int depth, syntax_component_t* parent)
 {
     init_parse;
-    if (!token)
+    if (token->type == T_END)
     {
         // ISO: 6.7.3 (1)
         fail_parse(token, "expected type qualifier, got EOF");
@@ -623,7 +617,7 @@ syntax_component_t* parse_type_qualifier(token_t** tokens, parse_request_code_t
 syntax_component_t* parse_function_specifier(token_t** tokens, parse_request_code_t req, parse_status_code_t* stat, syntax_component_t* tlu, int depth, syntax_component_t* parent)
 {
     init_parse;
-    if (!token)
+    if (token->type == T_END)
     {
         // ISO: 6.7.4 (1)
         fail_parse(token, "expected function specifier, got EOF");
@@ -725,7 +719,7 @@ vector_t* parse_type_qualifier_list(token_t** tokens, parse_request_code_t req,
 syntax_component_t* parse_pointer(token_t** tokens, parse_request_code_t req, parse_status_code_t* stat, syntax_component_t* tlu, int depth, syntax_component_t* parent)
 {
     init_parse;
-    if (!token)
+    if (token->type == T_END)
     {
         // ISO: 6.7.5 (1)
         fail_parse(token, "expected pointer, got EOF");
@@ -1368,7 +1362,7 @@ syntax_component_t* parse_declaration(token_t** tokens, parse_request_code_t req
 syntax_component_t* parse_floating_constant(token_t** tokens, parse_request_code_t req, parse_status_code_t* stat, syntax_component_t* tlu, int depth, syntax_component_t* parent)
 {
     init_parse;
-    if (!token)
+    if (token->type == T_END)
     {
         fail_parse(token, "expected floating constant, got EOF");
         return NULL;
@@ -1379,8 +1373,8 @@ syntax_component_t* parse_floating_constant(token_t** tokens, parse_request_code
         return NULL;
     }
     init_syn(SC_FLOATING_CONSTANT);
-    syn->floc = token->floating_constant.value;
-    syn->ctype = make_basic_type(token->floating_constant.class);
+    syn->floc = *token->floating_constant;
+    syn->ctype = make_basic_type(token->class);
     advance_token;
     update_status(FOUND);
     return syn;
@@ -1389,7 +1383,7 @@ syntax_component_t* parse_floating_constant(token_t** tokens, parse_request_code
 syntax_component_t* parse_character_constant(token_t** tokens, parse_request_code_t req, parse_status_code_t* stat, syntax_component_t* tlu, int depth, syntax_component_t* parent)
 {
     init_parse;
-    if (!token)
+    if (token->type == T_END)
     {
         fail_parse(token, "expected character constant, got EOF");
         return NULL;
@@ -1400,8 +1394,8 @@ syntax_component_t* parse_character_constant(token_t** tokens, parse_request_cod
         return NULL;
     }
     init_syn(SC_CHARACTER_CONSTANT);
-    syn->charc_value = token->character_constant.value;
-    syn->charc_wide = token->character_constant.wide;
+    syn->charc_value = token->character_constant;
+    syn->charc_wide = token->wide;
     syn->ctype = make_basic_type(CTC_INT);
     advance_token;
     update_status(FOUND);
@@ -1411,7 +1405,7 @@ syntax_component_t* parse_character_constant(token_t** tokens, parse_request_cod
 syntax_component_t* parse_integer_constant(token_t** tokens, parse_request_code_t req, parse_status_code_t* stat, syntax_component_t* tlu, int depth, syntax_component_t* parent)
 {
     init_parse;
-    if (!token)
+    if (token->type == T_END)
     {
         fail_parse(token, "expected integer constant, got EOF");
         return NULL;
@@ -1422,8 +1416,8 @@ syntax_component_t* parse_integer_constant(token_t** tokens, parse_request_code_
         return NULL;
     }
     init_syn(SC_INTEGER_CONSTANT);
-    syn->intc = token->integer_constant.value;
-    syn->ctype = make_basic_type(token->integer_constant.class);
+    syn->intc = token->integer_constant;
+    syn->ctype = make_basic_type(token->class);
     advance_token;
     update_status(FOUND);
     return syn;
@@ -1432,7 +1426,7 @@ syntax_component_t* parse_integer_constant(token_t** tokens, parse_request_code_
 syntax_component_t* parse_string_literal(token_t** tokens, parse_request_code_t req, parse_status_code_t* stat, syntax_component_t* tlu, int depth, syntax_component_t* parent)
 {
     init_parse;
-    if (!token)
+    if (token->type == T_END)
     {
         fail_parse(token, "expected string literal, got EOF");
         return NULL;
@@ -1443,10 +1437,10 @@ syntax_component_t* parse_string_literal(token_t** tokens, parse_request_code_t
         return NULL;
     }
     init_syn(SC_STRING_LITERAL);
-    if (token->string_literal.value_reg)
-        syn->strl_reg = strdup(token->string_literal.value_reg);
-    if (token->string_literal.value_wide)
-        syn->strl_wide = strdup_wide(token->string_literal.value_wide);
+    if (!token->wide)
+        syn->strl_reg = strdup(token->string_literal);
+    else
+        syn->strl_wide = strdup_wide(token->string_literal_wide);
     syn->strl_length = calloc(1, sizeof *syn->strl_length);
     syn->strl_length->type = SC_INTEGER_CONSTANT;
     syn->strl_length->intc = syn->strl_reg ? strlen(syn->strl_reg) + 1 : wcslen(syn->strl_wide) + 1;
@@ -2207,7 +2201,7 @@ syntax_component_t* parse_conditional_expression(token_t** tokens, parse_request
 
 syntax_component_t* parse_if_directive_expression(token_t* tokens, char* error)
 {
-    if (!tokens)
+    if (!tokens || tokens->type == T_END)
         return NULL;
     
     // dummy translation unit
@@ -2243,7 +2237,7 @@ syntax_component_t* parse_actual_assignment_expression(token_t** tokens, parse_r
         free_syntax(syn, tlu);
         return NULL;
     }
-    if (!token || token->type != T_PUNCTUATOR)
+    if (token->type != T_PUNCTUATOR)
     {
         fail_parse(token, "expected an assignment operator for assignment expression");
         free_syntax(syn, tlu);
@@ -2922,7 +2916,7 @@ syntax_component_t* parse_translation_unit(token_t** tokens, parse_request_code_
     syn->tlu_external_declarations = vector_init();
     syn->tlu_errors = vector_init();
     syn->tlu_st = symbol_table_init();
-    while (token)
+    while (token->type != T_END)
     {
         parse_status_code_t funcdef_stat = UNKNOWN_STATUS;
         syntax_component_t* funcdef = parse_function_definition(&token, OPTIONAL, &funcdef_stat, tlu, next_depth, syn);
@@ -2947,7 +2941,7 @@ syntax_component_t* parse_translation_unit(token_t** tokens, parse_request_code_
 }
 
 // parse a sequence of tokens into a tree.
-// takes a linked list of tokens
+// takes a T_END-terminated array of tokens
 syntax_component_t* parse(token_t* tokens)
 {
     parse_status_code_t tlu_stat = UNKNOWN_STATUS;
@@ -2964,7 +2958,8 @@ syntax_component_t* parse(token_t* tokens)
             parse_errorf(err->row, err->col, err->err_message);
         }
         free_syntax(tlu, tlu);
-        tlu = NULL;
+        return NULL;
     }
+    traverse_summarize(tlu);
     return tlu;
 }
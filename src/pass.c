@@ -0,0 +1,80 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "ecc.h"
+
+/*
+
+the pass manager, which opt1 and opt4 hand each routine to along with the list of their passes in the order they run.
+a pass runs if the flag its option points to is set in the optimizer's options (the same way opt4's patterns are
+turned on), and -t charges its time to a phase of its own, nested under its optimizer's.
+
+passes over AIR share the analyses of the routine they're given instead of each building their own:
+
+    ANALYSIS_CFG        the routine's CFG (see cfg.c), with its dominator tree and loops
+    ANALYSIS_LIVENESS   the liveness of its registers (see liveness.c), which pass_liveness builds on first use
+
+a pass says which of them it leaves standing when it changes the routine, and after a pass that changed something the
+rest are thrown away, to be built again by the next pass that asks for them. a pass that changed nothing leaves
+everything as it was. liveness is solved over the CFG, so it goes whenever the CFG does. a pass that restructures the
+routine partway through still has to invalidate the CFG itself before it looks at it again.
+
+-O picks how much of this runs, by picking the options the optimizers get:
+
+    -O0     nothing: neither optimizer runs, and blocks are only laid out again for a profile given to -B
+    -O1     the cheap passes: constants, dead code, and call cleanups in opt1, and all of opt4
+    -O2     everything (the default)
+    -Os     everything but vectorization, with only the smallest functions inlined
+
+*/
+
+// the routine's liveness, built now if no pass since the routine last changed has asked for it
+air_liveness_t* pass_liveness(pass_manager_t* pm)
+{
+    if (!pm->liveness)
+        pm->liveness = air_liveness_init(pm->routine, pm->air);
+    return pm->liveness;
+}
+
+static void invalidate(pass_manager_t* pm, unsigned keeps)
+{
+    if (!pm->routine)
+        return;
+    if (!(keeps & ANALYSIS_CFG))
+    {
+        air_routine_invalidate_cfg(pm->routine);
+        keeps &= ~ANALYSIS_LIVENESS;
+    }
+    if (!(keeps & ANALYSIS_LIVENESS))
+    {
+        air_liveness_delete(pm->liveness);
+        pm->liveness = NULL;
+    }
+}
+
+// runs the passes the options turn on in order, returning whether any of them changed the routine
+bool pass_run(pass_manager_t* pm, pass_t* passes, size_t count)
+{
+    bool changed = false;
+    for (size_t i = 0; i < count; ++i)
+    {
+        pass_t* pass = &passes[i];
+        if (pass->option != PASS_ALWAYS && !*(bool*) ((char*) pm->options + pass->option))
+            continue;
+        stats_mark_t mark = stats_begin();
+        if (pass->run(pm))
+        {
+            invalidate(pm, pass->keeps);
+            changed = true;
+        }
+        stats_end(pass->phase, &mark);
+    }
+    return changed;
+}
+
+// throws away what the manager kept for the routine. the CFG stays with the routine
+void pass_finish(pass_manager_t* pm)
+{
+    air_liveness_delete(pm->liveness);
+    pm->liveness = NULL;
+}
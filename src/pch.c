@@ -0,0 +1,304 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "ecc.h"
+
+/*
+
+precompiled header format (all integers are native-endian, it's only meant to be read by the ecc that wrote it):
+
+    magic           "ECCPCH", version
+    macros          count, then (name, flags, parameters, replacement list) for each
+    guards          count, then (resolved path, guard macro) for each guarded file that was included
+    tokens          post-preprocessing token stream of the header
+
+*/
+
+#define PCH_MAGIC "ECCPCH"
+#define PCH_VERSION 1
+
+#define PCH_MACRO_FUNCTION_LIKE 0x1
+#define PCH_MACRO_VARIADIC 0x2
+
+#define PCH_TOKEN_CAN_START_DIRECTIVE 0x1
+#define PCH_TOKEN_ARGUMENT_CONTENT 0x2
+#define PCH_TOKEN_WIDE 0x4
+#define PCH_TOKEN_QUOTE_DELIMITED 0x8
+
+static void write_u32(FILE* file, uint32_t value)
+{
+    fwrite(&value, sizeof value, 1, file);
+}
+
+static void write_u8(FILE* file, uint8_t value)
+{
+    fputc(value, file);
+}
+
+static void write_string(FILE* file, char* str)
+{
+    uint32_t length = str ? strlen(str) : 0;
+    write_u32(file, length);
+    fwrite(str, 1, length, file);
+}
+
+static void write_token(FILE* file, preprocessing_token_t* token)
+{
+    uint8_t flags = 0;
+    if (token->can_start_directive) flags |= PCH_TOKEN_CAN_START_DIRECTIVE;
+    if (token->argument_content) flags |= PCH_TOKEN_ARGUMENT_CONTENT;
+    if (token->type == PPT_CHARACTER_CONSTANT && token->character_constant.wide) flags |= PCH_TOKEN_WIDE;
+    if (token->type == PPT_STRING_LITERAL && token->string_literal.wide) flags |= PCH_TOKEN_WIDE;
+    if (token->type == PPT_HEADER_NAME && token->header_name.quote_delimited) flags |= PCH_TOKEN_QUOTE_DELIMITED;
+    write_u8(file, token->type);
+    write_u8(file, flags);
+    write_u32(file, token->row);
+    write_u32(file, token->col);
+    switch (token->type)
+    {
+        case PPT_HEADER_NAME: write_string(file, token->header_name.name); break;
+        case PPT_IDENTIFIER: write_string(file, token->identifier); break;
+        case PPT_PP_NUMBER: write_string(file, token->pp_number); break;
+        case PPT_CHARACTER_CONSTANT: write_string(file, token->character_constant.value); break;
+        case PPT_STRING_LITERAL: write_string(file, token->string_literal.value); break;
+        case PPT_PUNCTUATOR: write_u32(file, token->punctuator); break;
+        case PPT_WHITESPACE: write_string(file, token->whitespace); break;
+        case PPT_OTHER: write_u8(file, token->other); break;
+        default: break;
+    }
+}
+
+static void write_token_list(FILE* file, preprocessing_token_t* tokens)
+{
+    uint32_t count = 0;
+    for (preprocessing_token_t* token = tokens; token; token = token->next)
+        ++count;
+    write_u32(file, count);
+    for (preprocessing_token_t* token = tokens; token; token = token->next)
+        write_token(file, token);
+}
+
+bool pch_write(char* path, preprocessing_table_t* table, map_t* include_cache, preprocessing_token_t* tokens)
+{
+    FILE* file = fopen(path, "wb");
+    if (!file)
+        return false;
+
+    fwrite(PCH_MAGIC, 1, strlen(PCH_MAGIC), file);
+    write_u32(file, PCH_VERSION);
+
+    map_t* m = table->macros;
+    write_u32(file, m->size);
+    for (size_t i = 0; i < m->capacity; ++i)
+    {
+        if (!m->key[i] || m->key[i] == (void*) -1)
+            continue;
+        preprocessing_macro_t* macro = m->value[i];
+        write_string(file, m->key[i]);
+        uint8_t flags = 0;
+        if (macro->id_list) flags |= PCH_MACRO_FUNCTION_LIKE;
+        if (macro->variadic) flags |= PCH_MACRO_VARIADIC;
+        write_u8(file, flags);
+        if (macro->id_list)
+        {
+            write_u32(file, macro->id_list->size);
+            for (unsigned j = 0; j < macro->id_list->size; ++j)
+                write_string(file, vector_get(macro->id_list, j));
+        }
+        write_token_list(file, macro->repl_list);
+    }
+
+    uint32_t guards = 0;
+    for (size_t i = 0; i < include_cache->capacity; ++i)
+    {
+        include_cache_entry_t* entry = include_cache->value[i];
+        if (include_cache->key[i] && include_cache->key[i] != (void*) -1 && entry->guard)
+            ++guards;
+    }
+    write_u32(file, guards);
+    for (size_t i = 0; i < include_cache->capacity; ++i)
+    {
+        include_cache_entry_t* entry = include_cache->value[i];
+        if (include_cache->key[i] && include_cache->key[i] != (void*) -1 && entry->guard)
+        {
+            write_string(file, include_cache->key[i]);
+            write_string(file, entry->guard);
+        }
+    }
+
+    write_token_list(file, tokens);
+
+    bool ok = !ferror(file);
+    ok = !fclose(file) && ok;
+    return ok;
+}
+
+typedef struct pch_reader
+{
+    FILE* file;
+    bool failed;
+} pch_reader_t;
+
+static uint32_t read_u32(pch_reader_t* r)
+{
+    uint32_t value = 0;
+    if (fread(&value, sizeof value, 1, r->file) != 1)
+        r->failed = true;
+    return value;
+}
+
+static uint8_t read_u8(pch_reader_t* r)
+{
+    int c = fgetc(r->file);
+    if (c == EOF)
+    {
+        r->failed = true;
+        return 0;
+    }
+    return c;
+}
+
+static char* read_string(pch_reader_t* r)
+{
+    uint32_t length = read_u32(r);
+    if (r->failed)
+        return NULL;
+    char* str = malloc(length + 1);
+    if (fread(str, 1, length, r->file) != length)
+        r->failed = true;
+    str[length] = '\0';
+    return str;
+}
+
+static preprocessing_token_t* read_token(pch_reader_t* r)
+{
+    preprocessing_token_t* token = calloc(1, sizeof *token);
+    token->type = read_u8(r);
+    uint8_t flags = read_u8(r);
+    token->row = read_u32(r);
+    token->col = read_u32(r);
+    token->can_start_directive = flags & PCH_TOKEN_CAN_START_DIRECTIVE;
+    token->argument_content = flags & PCH_TOKEN_ARGUMENT_CONTENT;
+    switch (token->type)
+    {
+        case PPT_HEADER_NAME:
+            token->header_name.name = read_string(r);
+            token->header_name.quote_delimited = flags & PCH_TOKEN_QUOTE_DELIMITED;
+            break;
+        case PPT_IDENTIFIER:
+        {
+            char* id = read_string(r);
+            token->identifier = intern(id);
+            free(id);
+            break;
+        }
+        case PPT_PP_NUMBER: token->pp_number = read_string(r); break;
+        case PPT_CHARACTER_CONSTANT:
+            token->character_constant.value = read_string(r);
+            token->character_constant.wide = flags & PCH_TOKEN_WIDE;
+            break;
+        case PPT_STRING_LITERAL:
+            token->string_literal.value = read_string(r);
+            token->string_literal.wide = flags & PCH_TOKEN_WIDE;
+            break;
+        case PPT_PUNCTUATOR: token->punctuator = read_u32(r); break;
+        case PPT_WHITESPACE: token->whitespace = read_string(r); break;
+        case PPT_OTHER: token->other = read_u8(r); break;
+        case PPT_COMMENT:
+        case PPT_PLACEHOLDER:
+            break;
+        default:
+            r->failed = true;
+            break;
+    }
+    return token;
+}
+
+static preprocessing_token_t* read_token_list(pch_reader_t* r)
+{
+    uint32_t count = read_u32(r);
+    preprocessing_token_t* head = NULL;
+    preprocessing_token_t* prev = NULL;
+    for (uint32_t i = 0; i < count && !r->failed; ++i)
+    {
+        preprocessing_token_t* token = read_token(r);
+        token->prev = prev;
+        if (prev)
+            prev->next = token;
+        else
+            head = token;
+        prev = token;
+    }
+    return head;
+}
+
+bool pch_read(char* path, preprocessing_table_t** table, map_t** include_cache, preprocessing_token_t** tokens)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return false;
+
+    pch_reader_t r = { file, false };
+
+    char magic[sizeof(PCH_MAGIC) - 1];
+    if (fread(magic, 1, sizeof magic, file) != sizeof magic ||
+        memcmp(magic, PCH_MAGIC, sizeof magic) ||
+        read_u32(&r) != PCH_VERSION)
+    {
+        fclose(file);
+        return false;
+    }
+
+    preprocessing_table_t* t = preprocessing_table_init();
+    uint32_t macros = read_u32(&r);
+    for (uint32_t i = 0; i < macros && !r.failed; ++i)
+    {
+        char* name = read_string(&r);
+        uint8_t flags = read_u8(&r);
+        vector_t* ids = NULL;
+        if (flags & PCH_MACRO_FUNCTION_LIKE)
+        {
+            ids = vector_init();
+            uint32_t count = read_u32(&r);
+            for (uint32_t j = 0; j < count && !r.failed; ++j)
+                vector_add(ids, read_string(&r));
+        }
+        preprocessing_token_t* repl = read_token_list(&r);
+        if (!r.failed)
+            preprocessing_table_add(t, name, repl, NULL, ids, flags & PCH_MACRO_VARIADIC);
+        free(name);
+        vector_deep_delete(ids, free);
+        pp_token_delete_all(repl);
+    }
+
+    map_t* cache = include_cache_init();
+    uint32_t guards = read_u32(&r);
+    for (uint32_t i = 0; i < guards && !r.failed; ++i)
+    {
+        char* key = read_string(&r);
+        include_cache_entry_t* entry = calloc(1, sizeof *entry);
+        char* guard = read_string(&r);
+        entry->guard = intern(guard);
+        free(guard);
+        map_add(cache, key, entry);
+    }
+
+    preprocessing_token_t* ts = read_token_list(&r);
+
+    fclose(file);
+
+    if (r.failed)
+    {
+        preprocessing_table_delete(t);
+        map_delete(cache);
+        pp_token_delete_all(ts);
+        return false;
+    }
+
+    *table = t;
+    *include_cache = cache;
+    *tokens = ts;
+    return true;
+}
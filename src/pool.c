@@ -0,0 +1,141 @@
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "ecc.h"
+
+/*
+
+a pool of threads working through numbered jobs.
+
+jobs are handed out in order to whichever thread is free, and each job's finisher runs on the thread that started the
+pool, in job order, as soon as that job and every one before it are done. jobs can't depend on each other, but a
+finisher can rely on everything before it having been finished. threads only run so far ahead of the finishers, so
+whatever the jobs leave behind for them doesn't pile up.
+
+pool_lock guards whatever the jobs share. it does nothing unless a pool with more than one thread is running, so code
+that might run in a job can take it unconditionally.
+
+*/
+
+// how many jobs past the next to be finished each thread can be working on
+#define POOL_LOOKAHEAD 4
+
+typedef struct pool
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t changed; // a job was taken or done, or the finishers moved on
+    size_t count;
+    size_t next; // the next job to hand out
+    size_t finished; // jobs finished so far
+    size_t window; // how far past finished jobs can be handed out
+    bool* done;
+    pool_job_t job;
+    void* context;
+} pool_t;
+
+static pthread_mutex_t shared = PTHREAD_MUTEX_INITIALIZER;
+static bool threaded = false;
+
+void pool_lock(void)
+{
+    if (threaded)
+        pthread_mutex_lock(&shared);
+}
+
+void pool_unlock(void)
+{
+    if (threaded)
+        pthread_mutex_unlock(&shared);
+}
+
+static void* pool_work(void* arg)
+{
+    pool_t* p = arg;
+    pthread_mutex_lock(&p->mutex);
+    for (;;)
+    {
+        while (p->next < p->count && p->next >= p->finished + p->window)
+            pthread_cond_wait(&p->changed, &p->mutex);
+        if (p->next >= p->count)
+            break;
+        size_t index = p->next++;
+        pthread_mutex_unlock(&p->mutex);
+        p->job(index, p->context);
+        pthread_mutex_lock(&p->mutex);
+        p->done[index] = true;
+        pthread_cond_broadcast(&p->changed);
+    }
+    pthread_mutex_unlock(&p->mutex);
+    return NULL;
+}
+
+static void run_serially(size_t count, pool_job_t job, pool_job_t finish, void* context)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        job(i, context);
+        finish(i, context);
+    }
+}
+
+// runs job on count jobs over the given number of threads, and finish on each of them in order on this one
+void pool_run(size_t count, size_t threads, pool_job_t job, pool_job_t finish, void* context)
+{
+    if (threads > count)
+        threads = count;
+    if (threads <= 1)
+    {
+        run_serially(count, job, finish, context);
+        return;
+    }
+
+    pool_t p = {
+        .count = count,
+        .window = threads * POOL_LOOKAHEAD,
+        .done = calloc(count, sizeof(bool)),
+        .job = job,
+        .context = context
+    };
+    pthread_mutex_init(&p.mutex, NULL);
+    pthread_cond_init(&p.changed, NULL);
+    threaded = true;
+
+    pthread_t* workers = calloc(threads, sizeof(pthread_t));
+    size_t started = 0;
+    for (; started < threads; ++started)
+    {
+        if (pthread_create(&workers[started], NULL, pool_work, &p))
+            break;
+    }
+    // with no threads at all, this one does the work itself. it can't go through pool_work, which would stop at the
+    // window waiting on finishers that only run once it returns
+    if (!started)
+    {
+        threaded = false;
+        run_serially(count, job, finish, context);
+    }
+    else
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            pthread_mutex_lock(&p.mutex);
+            while (!p.done[i])
+                pthread_cond_wait(&p.changed, &p.mutex);
+            pthread_mutex_unlock(&p.mutex);
+            finish(i, context);
+            pthread_mutex_lock(&p.mutex);
+            p.finished = i + 1;
+            pthread_cond_broadcast(&p.changed);
+            pthread_mutex_unlock(&p.mutex);
+        }
+    }
+
+    for (size_t i = 0; i < started; ++i)
+        pthread_join(workers[i], NULL);
+    free(workers);
+
+    threaded = false;
+    pthread_cond_destroy(&p.changed);
+    pthread_mutex_destroy(&p.mutex);
+    free(p.done);
+}
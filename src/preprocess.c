@@ -1,5 +1,8 @@
+#define _DEFAULT_SOURCE 1
+
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <time.h>
 #include <errno.h>
 
@@ -42,33 +45,20 @@ typedef enum pp_status_code
 
 #define found (*tokens = comp->end = token, comp)
 
-preprocessing_table_t* preprocessing_table_init(void)
+static void preprocessing_macro_delete(preprocessing_macro_t* macro)
 {
-    preprocessing_table_t* t = calloc(1, sizeof *t);
-    t->key = calloc(50, sizeof(char*));
-    memset(t->key, 0, 50 * sizeof(char*));
-    t->v_repl_list = calloc(50, sizeof(preprocessing_token_t*));
-    memset(t->v_repl_list, 0, 50 * sizeof(preprocessing_token_t*));
-    t->v_id_list = calloc(50, sizeof(vector_t*));
-    memset(t->v_id_list, 0, 50 * sizeof(vector_t*));
-    t->v_variadic_list = calloc(50, sizeof(bool));
-    memset(t->v_variadic_list, 0, 50 * sizeof(bool));
-    t->size = 0;
-    t->capacity = 50;
-    return t;
+    if (!macro) return;
+    pp_token_delete_all(macro->repl_list);
+    vector_deep_delete(macro->id_list, free);
+    free(macro);
 }
 
-preprocessing_table_t* preprocessing_table_resize(preprocessing_table_t* t)
+preprocessing_table_t* preprocessing_table_init(void)
 {
-    unsigned old_capacity = t->capacity;
-    t->key = realloc(t->key, (t->capacity = (unsigned) (t->capacity * 1.5)) * sizeof(char*));
-    memset(t->key + old_capacity, 0, (t->capacity - old_capacity) * sizeof(char*));
-    t->v_repl_list = realloc(t->v_repl_list, t->capacity * sizeof(preprocessing_token_t*));
-    memset(t->v_repl_list + old_capacity, 0, (t->capacity - old_capacity) * sizeof(preprocessing_token_t*));
-    t->v_id_list = realloc(t->v_id_list, t->capacity * sizeof(vector_t*));
-    memset(t->v_id_list + old_capacity, 0, (t->capacity - old_capacity) * sizeof(vector_t*));
-    t->v_variadic_list = realloc(t->v_variadic_list, t->capacity * sizeof(bool));
-    memset(t->v_variadic_list + old_capacity, 0, (t->capacity - old_capacity) * sizeof(bool));
+    preprocessing_table_t* t = calloc(1, sizeof *t);
+    // macro names are interned
+    t->macros = map_init((comparator_t) intern_comparator, (hash_function_t) intern_hash);
+    map_set_deleters(t->macros, NULL, (void (*)(void*)) preprocessing_macro_delete);
     return t;
 }
 
@@ -76,113 +66,58 @@ preprocessing_table_t* preprocessing_table_resize(preprocessing_table_t* t)
 preprocessing_token_t* preprocessing_table_add(preprocessing_table_t* t, char* k, preprocessing_token_t* token, preprocessing_token_t* end, vector_t* id_list, bool variadic)
 {
     if (!t) return NULL;
-    if (t->size >= t->capacity)
-        (void) preprocessing_table_resize(t);
-    unsigned long index = hash(k) % t->capacity;
-    preprocessing_token_t* v = NULL;
-    for (unsigned long i = index;;)
-    {
-        if (t->key[i] == NULL)
-        {
-            t->key[i] = strdup(k);
-            if (token)
-                v = t->v_repl_list[i] = pp_token_copy_range(token, end);
-            t->v_id_list[i] = vector_deep_copy(id_list, (void* (*)(void*)) strdup);
-            t->v_variadic_list[i] = variadic;
-            ++(t->size);
-            break;
-        }
-        i = (i + 1) % t->capacity;
-        if (i == index) // for safety but this should never happen
-            return NULL;
-    }
-    return v;
-}
-
-bool preprocessing_table_get_internal(preprocessing_table_t* t, char* k, int* i, preprocessing_token_t** token, vector_t** id_list, bool* variadic)
-{
-    if (!t) return false;
-    unsigned long index = hash(k) % t->capacity;
-    unsigned long oidx = index;
-    do
-    {
-        if (t->key[index] != NULL && !strcmp(t->key[index], k))
-        {
-            if (i) *i = index;
-            if (token) *token = t->v_repl_list[index];
-            if (id_list) *id_list = t->v_id_list[index];
-            if (variadic) *variadic = t->v_variadic_list[index];
-            return true;
-        }
-        index = (index + 1 == t->capacity ? 0 : index + 1);
-    }
-    while (index != oidx);
-    if (i) *i = -1;
-    return false;
+    preprocessing_macro_t* macro = calloc(1, sizeof *macro);
+    if (token)
+        macro->repl_list = pp_token_copy_range(token, end);
+    macro->id_list = vector_deep_copy(id_list, (void* (*)(void*)) strdup);
+    macro->variadic = variadic;
+    preprocessing_macro_delete(map_add(t->macros, intern(k), macro));
+    return macro->repl_list;
 }
 
+// k must be interned
 bool preprocessing_table_get(preprocessing_table_t* t, char* k, preprocessing_token_t** token, vector_t** id_list, bool* variadic)
 {
-    return preprocessing_table_get_internal(t, k, NULL, token, id_list, variadic);
+    if (!t) return false;
+    preprocessing_macro_t* macro = map_get(t->macros, k);
+    if (!macro) return false;
+    if (token) *token = macro->repl_list;
+    if (id_list) *id_list = macro->id_list;
+    if (variadic) *variadic = macro->variadic;
+    return true;
 }
 
+// k must be interned
 void preprocessing_table_remove(preprocessing_table_t* t, char* k)
 {
     if (!t) return;
-    unsigned long index = hash(k) % t->capacity;
-    for (unsigned long i = index;;)
-    {
-        if (t->key[i] != NULL && !strcmp(t->key[i], k))
-        {
-            free(t->key[i]);
-            pp_token_delete_all(t->v_repl_list[i]);
-            vector_deep_delete(t->v_id_list[i], free);
-            t->key[i] = NULL;
-            t->v_repl_list[i] = NULL;
-            t->v_id_list[i] = NULL;
-            t->v_variadic_list[i] = false;
-            return;
-        }
-        i = (i + 1) % t->capacity;
-        if (i == index)
-            break;
-    }
+    map_remove(t->macros, k);
 }
 
 void preprocessing_table_delete(preprocessing_table_t* t)
 {
     if (!t) return;
-    for (unsigned i = 0; i < t->capacity; ++i)
-    {
-        free(t->key[i]);
-        pp_token_delete_all(t->v_repl_list[i]);
-        vector_deep_delete(t->v_id_list[i], free);
-    }
-    free(t->key);
-    free(t->v_repl_list);
-    free(t->v_id_list);
-    free(t->v_variadic_list);
+    map_delete(t->macros);
     free(t);
 }
 
 void preprocessing_table_print(preprocessing_table_t* t, int (*printer)(const char* fmt, ...))
 {
     printer("preprocessing table:\n");
-    for (unsigned i = 0; i < t->capacity; ++i)
+    MAP_FOR(char*, preprocessing_macro_t*, t->macros)
     {
-        if (!t->key[i])
-            continue;
-        printer(" \"%s\" -> \n", t->key[i]);
-        if (t->v_id_list[i])
+        if (MAP_IS_BAD_KEY) continue;
+        printer(" \"%s\" -> \n", k);
+        if (v->id_list)
         {
             printer("  parameter list:\n");
-            for (unsigned j = 0; j < t->v_id_list[i]->size; ++j)
-                printer("   %s\n", vector_get(t->v_id_list[i], j));
-            if (t->v_variadic_list[i])
+            for (unsigned j = 0; j < v->id_list->size; ++j)
+                printer("   %s\n", vector_get(v->id_list, j));
+            if (v->variadic)
                 printer("   ...\n");
         }
         printer("  token sequence:\n");
-        for (preprocessing_token_t* token = t->v_repl_list[i]; token; token = token->next)
+        for (preprocessing_token_t* token = v->repl_list; token; token = token->next)
         {
             printer("   ");
             pp_token_print(token, printer);
@@ -335,6 +270,14 @@ static preprocessing_token_t* remove_token(preprocessing_token_t* token)
     return next;
 }
 
+// leaves an empty PPT_OTHER in the token's place, which the output skips
+static void erase_token(preprocessing_token_t* token)
+{
+    pp_token_delete_content(token);
+    token->type = PPT_OTHER;
+    token->other = '\0';
+}
+
 static preprocessing_token_t* remove_token_sequence(preprocessing_token_t* start, preprocessing_token_t* end)
 {
     if (!start && !end) return NULL;
@@ -342,8 +285,7 @@ static preprocessing_token_t* remove_token_sequence(preprocessing_token_t* start
     {
         for (end = end->prev; end; end = end->prev)
         {
-            pp_token_delete_content(end);
-            end->type = PPT_OTHER;
+            erase_token(end);
         }
         return end;
     }
@@ -351,16 +293,14 @@ static preprocessing_token_t* remove_token_sequence(preprocessing_token_t* start
     {
         for (; start; start = start->next)
         {
-            pp_token_delete_content(start);
-            start->type = PPT_OTHER;
+            erase_token(start);
         }
         return NULL;
     }
 
     for (; start && start != end; start = start->next)
     {
-        pp_token_delete_content(start);
-        start->type = PPT_OTHER;
+        erase_token(start);
     }
     return end;
 }
@@ -392,6 +332,52 @@ static preprocessing_token_t* relex(preprocessing_token_t* start, preprocessing_
     return first;
 }
 
+static bool is_identifier_text(char* str)
+{
+    for (; *str; ++str)
+    {
+        if (!isalnum((unsigned char) *str) && *str != '_')
+            return false;
+    }
+    return true;
+}
+
+// builds the token that lhs and rhs spell out together for the pastes that come up
+// all the time (names onto names or numbers, and two punctuators into one), so they
+// don't need a trip through the lexer. NULL means it's one for lex_raw to figure out.
+static preprocessing_token_t* paste_tokens(preprocessing_token_t* lhs, preprocessing_token_t* rhs, char* concat)
+{
+    preprocessing_token_t* token = calloc(1, sizeof *token);
+    token->row = lhs->row;
+    token->col = lhs->col;
+    if (lhs->type == PPT_IDENTIFIER && (rhs->type == PPT_IDENTIFIER ||
+        (rhs->type == PPT_PP_NUMBER && is_identifier_text(rhs->pp_number))))
+    {
+        token->type = PPT_IDENTIFIER;
+        token->identifier = intern(concat);
+        return token;
+    }
+    if (lhs->type == PPT_PP_NUMBER && (rhs->type == PPT_IDENTIFIER || rhs->type == PPT_PP_NUMBER))
+    {
+        token->type = PPT_PP_NUMBER;
+        token->pp_number = strdup(concat);
+        return token;
+    }
+    if (lhs->type == PPT_PUNCTUATOR && rhs->type == PPT_PUNCTUATOR)
+    {
+        for (punctuator_type_t p = 0; p < P_NO_ELEMENTS; ++p)
+        {
+            if (!streq((char*) PUNCTUATOR_STRING_REPRS[p], concat))
+                continue;
+            token->type = PPT_PUNCTUATOR;
+            token->punctuator = p;
+            return token;
+        }
+    }
+    free(token);
+    return NULL;
+}
+
 // merges into lhs, returns new lhs
 static preprocessing_token_t* merge_tokens(preprocessing_token_t* lhs, preprocessing_token_t* rhs)
 {
@@ -418,14 +404,19 @@ static preprocessing_token_t* merge_tokens(preprocessing_token_t* lhs, preproces
     bsize -= pp_token_normal_snprint(buffer, bsize, lhs, snprintf);
     bsize -= pp_token_normal_snprint(buffer + (4096 - bsize), bsize, rhs, snprintf);
     size_t length = 4096 - bsize;
-    char* concat = strdup(buffer);
+    preprocessing_token_t* first = paste_tokens(lhs, rhs, buffer);
+    if (!first)
+    {
+        preprocessing_token_t* tokens = lex_raw((unsigned char*) buffer, length, false, false);
+        if (!tokens)
+        {
+            free(buffer);
+            return NULL;
+        }
+        first = pp_token_copy(tokens);
+        pp_token_delete_all(tokens);
+    }
     free(buffer);
-    preprocessing_token_t* tokens = lex_raw((unsigned char*) concat, length, false, false);
-    free(concat);
-    if (!tokens)
-        return NULL;
-    preprocessing_token_t* first = pp_token_copy(tokens);
-    pp_token_delete_all(tokens);
     insert_token_after(first, lhs);
     remove_token(lhs);
     remove_token(rhs);
@@ -468,7 +459,13 @@ static bool gather_and_replace(preprocessing_state_t* state, preprocessing_token
     *tokens = token;
     preprocessing_token_t* end = token;
 
-    if (get_program_options()->iflag)
+    // an argument of only whitespace is as empty as one with nothing in it at all
+    bool empty = true;
+    for (preprocessing_token_t* arg = start; arg && arg != end; arg = arg->next)
+        if (is_pp_token(arg) && arg->type != PPT_OTHER)
+            empty = false;
+
+    if (state->settings->options->iflag)
     {
         printf("found sequence for parameter '%s':\n", param_name);
         for (preprocessing_token_t* t = start; t && t != end; t = t->next)
@@ -553,7 +550,7 @@ static bool gather_and_replace(preprocessing_state_t* state, preprocessing_token
         preprocessing_token_t* next = seq;
         advance_token_impl(&next);
         preprocessing_token_t* inserting = seq;
-        if (start == end && ((is_pp_type(next, PPT_PUNCTUATOR) && next->punctuator == P_DOUBLE_HASH) ||
+        if (empty && ((is_pp_type(next, PPT_PUNCTUATOR) && next->punctuator == P_DOUBLE_HASH) ||
             (is_pp_type(prev, PPT_PUNCTUATOR) && prev->punctuator == P_DOUBLE_HASH)))
         {
             preprocessing_token_t* token = calloc(1, sizeof *token);
@@ -565,6 +562,9 @@ static bool gather_and_replace(preprocessing_state_t* state, preprocessing_token
         }
         else for (preprocessing_token_t* arg = start; arg && arg != end; arg = arg->next)
         {
+            // what's left of macros expanded inside the argument, copying them would double it at every level of nesting
+            if (arg->type == PPT_OTHER && !arg->other)
+                continue;
             preprocessing_token_t* cp = pp_token_copy(arg);
             cp->argument_content = true;
             cp->row = seq->row;
@@ -683,6 +683,23 @@ static preprocessing_token_t* expand_special(preprocessing_token_t* token, prepr
     return token;
 }
 
+// takes the next token of a replacement off of seq to be spliced into the output: a copy
+// if seq is a macro definition, or the token itself if it's a private sequence built for
+// one invocation, so nothing gets copied twice on its way out
+static preprocessing_token_t* next_replacement(preprocessing_token_t** seq, bool owned)
+{
+    preprocessing_token_t* token = *seq;
+    *seq = token->next;
+    if (!owned)
+        return pp_token_copy(token);
+    if (*seq)
+        (*seq)->prev = NULL;
+    token->prev = token->next = NULL;
+    token->can_start_directive = false;
+    token->argument_content = false;
+    return token;
+}
+
 // returns the token at the position at the end of the expansion, NULL if expansion failed
 static preprocessing_token_t* expand(preprocessing_token_t* token, preprocessing_state_t* state, preprocessing_token_t** start)
 {
@@ -700,15 +717,19 @@ static preprocessing_token_t* expand(preprocessing_token_t* token, preprocessing
         return token;
     
     preprocessing_token_t* end = token->next;
-    
-    preprocessing_token_t* dummy = calloc(1, sizeof *dummy);
-    dummy->type = PPT_WHITESPACE;
-    dummy->whitespace = strdup(" ");
-    preprocessing_token_t* seq = dummy->next = pp_token_copy_range(repl, NULL);
-    seq->prev = dummy;
+
+    // object-like macros are read straight out of the table
+    preprocessing_token_t* seq = repl;
+    bool owned = params != NULL;
 
     if (params)
     {
+        preprocessing_token_t* dummy = calloc(1, sizeof *dummy);
+        dummy->type = PPT_WHITESPACE;
+        dummy->whitespace = strdup(" ");
+        seq = dummy->next = pp_token_copy_range(repl, NULL);
+        seq->prev = dummy;
+
         preprocessing_token_t* arg_token = token->next;
         int index = 0;
         for (; arg_token && (arg_token->type != PPT_PUNCTUATOR || arg_token->punctuator != P_RIGHT_PARENTHESIS); ++index)
@@ -722,7 +743,7 @@ static preprocessing_token_t* expand(preprocessing_token_t* token, preprocessing
             }
             seq = dummy->next;
 
-            if (get_program_options()->iflag)
+            if (state->settings->options->iflag)
             {
                 printf("sequence for %s:\n", (char*) vector_get(params, index));
                 for (preprocessing_token_t* t = seq; t; t = t->next)
@@ -774,17 +795,17 @@ static preprocessing_token_t* expand(preprocessing_token_t* token, preprocessing
             return fail(token, "expected terminating ')' at end of function-like macro invocation");
         }
         end = arg_token->next;
-    }
 
-    pp_token_delete(dummy);
-    seq->prev = NULL;
+        pp_token_delete(dummy);
+        seq->prev = NULL;
+    }
 
     if (start) *start = NULL;
 
     preprocessing_token_t* inserting = token;
-    for (; seq; seq = seq->next)
+    while (seq)
     {
-        preprocessing_token_t* cp = pp_token_copy(seq);
+        preprocessing_token_t* cp = next_replacement(&seq, owned);
         cp->row = token->row;
         cp->col = token->col;
         if (inserting == token)
@@ -794,13 +815,13 @@ static preprocessing_token_t* expand(preprocessing_token_t* token, preprocessing
         preprocessing_token_t* inner_start = NULL;
         if (!(inserting = expand(inserting, state, &inner_start)))
         {
-            pp_token_delete_all(seq);
+            if (owned)
+                pp_token_delete_all(seq);
             return NULL;
         }
         if (start && !*start)
             *start = inner_start;
     }
-    pp_token_delete_all(seq);
     remove_token_sequence(token, end);
     return inserting;
 }
@@ -1048,11 +1069,9 @@ void pp_component_delete(preprocessing_component_t* comp)
             vector_deep_delete(comp->ifg_parts, (void (*)(void*)) pp_component_delete);
             break;
         case PPC_IFDEF_GROUP:
-            free(comp->ifdg_id);
             vector_deep_delete(comp->ifdg_parts, (void (*)(void*)) pp_component_delete);
             break;
         case PPC_IFNDEF_GROUP:
-            free(comp->ifndg_id);
             vector_deep_delete(comp->ifndg_parts, (void (*)(void*)) pp_component_delete);
             break;
         case PPC_ELIF_GROUP:
@@ -1066,12 +1085,10 @@ void pp_component_delete(preprocessing_component_t* comp)
             pp_component_delete(comp->incl_sequence);
             break;
         case PPC_DEFINE_LINE:
-            free(comp->defl_id);
             vector_deep_delete(comp->defl_params, free);
             pp_component_delete(comp->defl_replacement);
             break;
         case PPC_UNDEF_LINE:
-            free(comp->undefl_id);
             break;
         case PPC_LINE_LINE:
             pp_component_delete(comp->linel_sequence);
@@ -1341,7 +1358,7 @@ preprocessing_component_t* pp_parse_ifdef_group(preprocessing_token_t** tokens,
         return fail(token, "expected identifier to check for being a macro");
     }
 
-    comp->ifdg_id = strdup(token->identifier);
+    comp->ifdg_id = token->identifier;
 
     advance_token_list;
     if (!is_whitespace_containing_newline(token))
@@ -1381,7 +1398,7 @@ preprocessing_component_t* pp_parse_ifndef_group(preprocessing_token_t** tokens,
         return fail(token, "expected identifier to check for being a macro");
     }
 
-    comp->ifndg_id = strdup(token->identifier);
+    comp->ifndg_id = token->identifier;
 
     advance_token_list;
     if (!is_whitespace_containing_newline(token))
@@ -1575,7 +1592,7 @@ preprocessing_component_t* pp_parse_define_line(preprocessing_token_t** tokens,
         pp_component_delete(comp);
         return fail(token, "expected name for macro definition");
     }
-    comp->defl_id = strdup(token->identifier);
+    comp->defl_id = token->identifier;
     advance_token_list;
     if (is_punctuator(token, P_LEFT_PARENTHESIS))
     {
@@ -1641,7 +1658,7 @@ preprocessing_component_t* pp_parse_undef_line(preprocessing_token_t** tokens, p
         return fail(token, "identifier expected for #undef directive");
     }
 
-    comp->undefl_id = strdup(token->identifier);
+    comp->undefl_id = token->identifier;
 
     advance_token_list;
 
@@ -1870,12 +1887,17 @@ static int check_if_condition(preprocessing_component_t* condition, preprocessin
     tokenizing_settings_t settings;
     settings.error = state->settings->error;
     settings.filepath = state->settings->filepath;
+    settings.arena = arena_init();
 
     token_t* tokens = tokenize_sequence(condition->start, condition->end, &settings);
     if (settings.error[0])
+    {
+        arena_delete(settings.arena);
         return 2;
+    }
     
     syntax_component_t* expr = parse_if_directive_expression(tokens, settings.error);
+    arena_delete(settings.arena);
 
     analysis_error_t* errors = analyze(expr);
     if (errors)
@@ -1885,7 +1907,6 @@ static int check_if_condition(preprocessing_component_t* condition, preprocessin
         {
             (void) fail(condition->start, "could not evaluate constant expression");
             error_delete_all(errors);
-            token_delete_all(tokens);
             free_syntax(expr, NULL);
             return 2;
         }
@@ -1903,7 +1924,6 @@ static int check_if_condition(preprocessing_component_t* condition, preprocessin
     uint64_t value = constexpr_as_u64(ce);
 
     constexpr_delete(ce);
-    token_delete_all(tokens);
     free_syntax(expr, NULL);
 
     return value != 0;
@@ -2014,17 +2034,148 @@ FILE* open_include_path(char* inc, bool quote_delimited, preprocessing_state_t*
     return NULL;
 }
 
+void include_cache_entry_delete(include_cache_entry_t* entry)
+{
+    if (!entry) return;
+    pp_token_delete_all(entry->tokens);
+    free(entry);
+}
+
+// copies a freshly lexed token list, keeping track of which tokens can start directives
+static preprocessing_token_t* copy_raw_tokens(preprocessing_token_t* tokens)
+{
+    preprocessing_token_t* copy = pp_token_copy_range(tokens, NULL);
+    for (preprocessing_token_t* a = tokens, *b = copy; a && b; a = a->next, b = b->next)
+        b->can_start_directive = a->can_start_directive;
+    return copy;
+}
+
+// looks for the next directive name after the current token, i.e., a '#' at the start of a line followed by an identifier
+static preprocessing_token_t* next_directive_name(preprocessing_token_t* token, bool line_start)
+{
+    for (; token; token = token->next)
+    {
+        if (is_whitespace(token))
+        {
+            if (contains_char(token->whitespace, '\n'))
+                line_start = true;
+            continue;
+        }
+        if (line_start && is_punctuator(token, P_HASH))
+        {
+            preprocessing_token_t* name = token;
+            advance_token_impl(&name);
+            if (is_pp_type(name, PPT_IDENTIFIER))
+                return name;
+        }
+        line_start = false;
+    }
+    return NULL;
+}
+
+// returns the name of the guard macro if the file has the form:
+//   #ifndef X
+//   #define X
+//   ...
+//   #endif
+// with nothing but whitespace and comments outside of the group
+static char* find_include_guard(preprocessing_token_t* tokens)
+{
+    preprocessing_token_t* token = get_first_token_forward(tokens);
+    if (!is_punctuator(token, P_HASH)) return NULL;
+    if (!is_identifier(advance_token, "ifndef")) return NULL;
+    preprocessing_token_t* guard = advance_token;
+    if (!is_pp_type(guard, PPT_IDENTIFIER)) return NULL;
+    if (!is_whitespace_containing_newline(guard->next)) return NULL;
+    if (!is_punctuator(advance_token, P_HASH)) return NULL;
+    if (!is_identifier(advance_token, "define")) return NULL;
+    if (!is_identifier(advance_token, guard->identifier)) return NULL;
+    int depth = 1;
+    for (token = next_directive_name(token->next, false); token; token = next_directive_name(token->next, false))
+    {
+        if (is_identifier(token, "if") || is_identifier(token, "ifdef") || is_identifier(token, "ifndef"))
+            ++depth;
+        else if (depth == 1 && (is_identifier(token, "elif") || is_identifier(token, "else")))
+            return NULL;
+        else if (is_identifier(token, "endif") && !--depth)
+            break;
+    }
+    if (!token) return NULL;
+    // the closing #endif must be the last thing in the file
+    if (get_first_token_forward(token->next)) return NULL;
+    return guard->identifier;
+}
+
+map_t* include_cache_init(void)
+{
+    map_t* cache = map_init((comparator_t) strcmp, (hash_function_t) hash);
+    map_set_deleters(cache, free, (void (*)(void*)) include_cache_entry_delete);
+    return cache;
+}
+
+char* include_cache_key(char* path)
+{
+    char* key = realpath(path, NULL);
+    return key ? key : strdup(path);
+}
+
+// records the raw tokens of a file that was just lexed (the tokens are copied)
+include_cache_entry_t* include_cache_record(map_t* cache, char* path, preprocessing_token_t* tokens)
+{
+    char* key = include_cache_key(path);
+    include_cache_entry_t* entry = map_get(cache, key);
+    if (entry)
+    {
+        free(key);
+        pp_token_delete_all(entry->tokens);
+    }
+    else
+    {
+        entry = calloc(1, sizeof *entry);
+        map_add(cache, key, entry);
+    }
+    entry->tokens = copy_raw_tokens(tokens);
+    entry->guard = find_include_guard(tokens);
+    return entry;
+}
+
 bool preprocess_include_file(FILE* file, char* path, preprocessing_state_t* state, preprocessing_token_t** tokens)
 {
-    preprocessing_token_t* pp_tokens = lex(file, false);
-    if (!pp_tokens)
-        return false;
+    map_t* cache = state->settings->include_cache;
+    include_cache_entry_t* entry = NULL;
+    if (cache)
+    {
+        char* key = include_cache_key(path);
+        entry = map_get(cache, key);
+        free(key);
+    }
+    // a guarded file whose guard is already defined will not produce anything, so don't bother expanding it
+    if (entry && entry->guard && preprocessing_table_get(state->table, entry->guard, NULL, NULL, NULL))
+    {
+        if (tokens) *tokens = NULL;
+        return true;
+    }
+    preprocessing_token_t* pp_tokens = NULL;
+    // entries loaded from a precompiled header only know their guard, so they still have to be lexed once
+    if (entry && entry->tokens)
+        pp_tokens = copy_raw_tokens(entry->tokens);
+    else
+    {
+        pp_tokens = lex(file, false);
+        if (!pp_tokens)
+            return false;
+        if (cache)
+            (void) include_cache_record(cache, path, pp_tokens);
+    }
 
     preprocessing_settings_t settings;
     settings.translation_time = state->settings->translation_time;
     settings.filepath = path;
     settings.error = state->settings->error;
     settings.table = state->table;
+    settings.include_cache = cache;
+    settings.dependencies = state->settings->dependencies;
+    settings.options = state->settings->options;
     if (!preprocess(&pp_tokens, &settings))
         return false;
     
@@ -2071,6 +2222,10 @@ bool preprocess_include_line(preprocessing_component_t* comp, preprocessing_stat
         return false;
     }
 
+    vector_t* dependencies = state->settings->dependencies;
+    if (dependencies && vector_contains(dependencies, path, (int (*)(void*, void*)) strcmp) == -1)
+        vector_add(dependencies, strdup(path));
+
     preprocessing_token_t* included = NULL;
     if (!preprocess_include_file(file, path, state, &included))
     {
@@ -2271,10 +2426,12 @@ bool preprocess_error_line(preprocessing_component_t* comp, preprocessing_state_
         (void) fail(comp->start, "#error directive");
         return false;
     }
-    quickbuffer_setup(MAX_ERROR_LENGTH);
-    pp_token_normal_print_range(comp->errl_sequence->start, comp->errl_sequence->end, quickbuffer_printf);
-    (void) fail(comp->start, "#error directive: %s", quickbuffer());
-    quickbuffer_release();
+    char message[MAX_ERROR_LENGTH];
+    message[0] = '\0';
+    size_t length = 0;
+    for (preprocessing_token_t* token = comp->errl_sequence->start; token && token != comp->errl_sequence->end && length < sizeof message; token = token->next)
+        length += pp_token_normal_snprint(message + length, sizeof message - length, token, snprintf);
+    (void) fail(comp->start, "#error directive: %s", message);
     remove_token_sequence(comp->start, comp->end);
     return false;
 }
@@ -2384,6 +2541,10 @@ bool preprocess(preprocessing_token_t** tokens, preprocessing_settings_t* settin
         state->table = settings->table;
     else
         state->table = preprocessing_table_init();
+    // the outermost call owns the include cache
+    bool owns_cache = !settings->include_cache;
+    if (owns_cache)
+        settings->include_cache = include_cache_init();
     preprocessing_token_t* tmp = *tokens;
 
     // part 1: treeify
@@ -2393,10 +2554,15 @@ bool preprocess(preprocessing_token_t** tokens, preprocessing_settings_t* settin
         if (settings->table)
             state->table = NULL;
         state_delete(state);
+        if (owns_cache)
+        {
+            map_delete(settings->include_cache);
+            settings->include_cache = NULL;
+        }
         return false;
     }
 
-    if (get_program_options()->iflag)
+    if (state->settings->options->iflag)
     {
         printf("<<preprocessing tree>>\n");
         pp_component_print(pp_file, printf);
@@ -2405,7 +2571,7 @@ bool preprocess(preprocessing_token_t** tokens, preprocessing_settings_t* settin
     // part 2: analyze tree
     bool success = preprocess_preprocessing_file(pp_file, state);
 
-    if (get_program_options()->iflag)
+    if (state->settings->options->iflag)
     {
         printf("<<preprocessing table>>\n");
         preprocessing_table_print(state->table, printf);
@@ -2415,6 +2581,11 @@ bool preprocess(preprocessing_token_t** tokens, preprocessing_settings_t* settin
         state->table = NULL;
     state_delete(state);
     pp_component_delete(pp_file);
+    if (owns_cache)
+    {
+        map_delete(settings->include_cache);
+        settings->include_cache = NULL;
+    }
 
     for (preprocessing_token_t* token = dummy->next; token;)
     {
@@ -2431,7 +2602,7 @@ bool preprocess(preprocessing_token_t** tokens, preprocessing_settings_t* settin
     if (*tokens)
         (*tokens)->prev = NULL;
     
-    if (get_program_options()->iflag)
+    if (settings->options->iflag)
     {
         printf("<<preprocessor output>>\n");
         pp_token_print_all(*tokens, printf);
@@ -0,0 +1,346 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ecc.h"
+
+/*
+
+whole-program mode (-W), which compiles every file it's given as one program instead of each on its own. the files
+go through the front end separately, each into a syntax tree, symbol table, and AIR of its own, which are then merged
+into the first file's. from there on the rest of the compiler sees a single translation unit: opt1 inlines calls
+from one file into another and propagates the constants that brings in along with them, and only one object comes
+out to be linked.
+
+merging has to settle what the files' symbols mean together:
+
+    external linkage    every declaration of the name is the same object or function, so they're all replaced by
+                        one of them, its definition if it has one (an initialized one over a tentative one). any other
+                        definitions of it are dropped
+    file-scope statics  the same goes for a file's declarations of one of its statics, but only within the file
+    everything else     statics and literals are different things in different files even when they have the same
+                        name, so where a name is declared in more than one file they're renamed apart by their place
+                        in the merged table, e.g. count.2 and __sl0.5
+
+calls and references are made to whichever declaration was in scope, so with every declaration replaced by one,
+finding the routine a call reaches is a matter of comparing symbols, like opt1's inlining already does.
+
+the program is all there is besides the libraries, so a routine that can't be reached from main can never be called,
+and is dropped along with any read-only or internal data only such routines used. this runs once after merging and
+again after opt1, which leaves routines behind once every call to them has been inlined. data with external linkage
+is always kept since the libraries could refer to it by name, and so is everything if there's no main.
+
+*/
+
+// whether every declaration of the symbol in the program refers to the same object or function. functions declared
+// in a block without a storage class link externally too
+static bool links_externally(symbol_t* sy)
+{
+    if (!sy->declarer || sy->declarer->type != SC_DECLARATOR_IDENTIFIER || !sy->type)
+        return false;
+    if (syntax_has_specifier(syntax_get_declspecs(sy->declarer), SC_STORAGE_CLASS_SPECIFIER, SCS_TYPEDEF))
+        return false;
+    linkage_t linkage = symbol_get_linkage(sy);
+    return linkage == LK_EXTERNAL || (linkage == LK_NONE && sy->type->class == CTC_FUNCTION);
+}
+
+// whether the symbol names storage of its own that's labeled by its name without the linker's help
+static bool is_local_storage(symbol_t* sy)
+{
+    if (!sy->declarer || links_externally(sy))
+        return false;
+    switch (sy->declarer->type)
+    {
+        case SC_DECLARATOR_IDENTIFIER:
+            if (syntax_has_specifier(syntax_get_declspecs(sy->declarer), SC_STORAGE_CLASS_SPECIFIER, SCS_TYPEDEF))
+                return false;
+            break;
+        case SC_STRING_LITERAL:
+        case SC_FLOATING_CONSTANT:
+        case SC_COMPOUND_LITERAL:
+            break;
+        default:
+            return false;
+    }
+    // block-scope statics are labeled with their disambiguator already
+    return symbol_get_storage_duration(sy) == SD_STATIC && !x86_symbol_requires_disambiguation(sy);
+}
+
+// 2 for a function body or an initialized object, 1 for a tentative definition, 0 for a declaration
+static int definition_rank(symbol_t* sy, map_t* defined)
+{
+    if (!map_get(defined, sy))
+        return 0;
+    if (sy->type->class == CTC_FUNCTION)
+        return 2;
+    syntax_component_t* ideclr = syntax_get_full_declarator(sy->declarer);
+    return ideclr && ideclr->type == SC_INIT_DECLARATOR && ideclr->ideclr_initializer ? 2 : 1;
+}
+
+// the declaration that stands for all of a file's declarations of the same file-scope static, which is the one
+// that defines it if any of them do
+static symbol_t* internal_canonical(symbol_t* sylist, symbol_t* sy, map_t* defined)
+{
+    if (sy->declarer->type != SC_DECLARATOR_IDENTIFIER || !scope_is_file(symbol_get_scope(sy)))
+        return sy;
+    syntax_component_t* tlu = syntax_get_translation_unit(sy->declarer);
+    symbol_t* canonical = NULL;
+    int rank = -1;
+    for (symbol_t* other = sylist; other; other = other->next)
+    {
+        if (!is_local_storage(other) || other->declarer->type != SC_DECLARATOR_IDENTIFIER ||
+            !scope_is_file(symbol_get_scope(other)) || syntax_get_translation_unit(other->declarer) != tlu)
+            continue;
+        int r = definition_rank(other, defined);
+        if (r > rank)
+        {
+            canonical = other;
+            rank = r;
+        }
+    }
+    return canonical;
+}
+
+// settles what the symbols declared under a name stand for, renaming them if they're from more than one file
+static void resolve_name(symbol_t* sylist, bool shared, map_t* defined, map_t* replacements)
+{
+    symbol_t* external = NULL;
+    int rank = -1;
+    for (symbol_t* sy = sylist; sy; sy = sy->next)
+    {
+        if (!links_externally(sy))
+            continue;
+        int r = definition_rank(sy, defined);
+        if (r > rank)
+        {
+            external = sy;
+            rank = r;
+        }
+    }
+
+    // the names are all worked out before any of them change, since they're made from the original
+    vector_t* renamed = vector_init(); // vector_t<symbol_t*>
+    vector_t* names = vector_init(); // vector_t<char*>
+    for (symbol_t* sy = sylist; sy; sy = sy->next)
+    {
+        symbol_t* canonical = sy;
+        if (links_externally(sy))
+            canonical = external;
+        else if (is_local_storage(sy))
+            canonical = internal_canonical(sylist, sy, defined);
+        else
+            continue;
+        if (canonical != sy)
+            map_add(replacements, sy, canonical);
+        if (!shared || !is_local_storage(sy))
+            continue;
+        char* name = symbol_get_name(sy);
+        size_t length = strlen(name) + 1 + MAX_STRINGIFIED_INTEGER_LENGTH + 1;
+        char* rename = malloc(length);
+        snprintf(rename, length, "%s.%lu", name, canonical->disambiguator);
+        vector_add(renamed, sy);
+        vector_add(names, rename);
+    }
+    for (size_t i = 0; i < renamed->size; ++i)
+    {
+        symbol_t* sy = vector_get(renamed, i);
+        free(sy->name);
+        sy->name = vector_get(names, i);
+    }
+    vector_delete(renamed);
+    vector_delete(names);
+}
+
+static symbol_t* replacement(map_t* replacements, symbol_t* sy)
+{
+    symbol_t* r = map_get(replacements, sy);
+    return r ? r : sy;
+}
+
+static void replace_in_data(vector_t* data, map_t* replacements)
+{
+    VECTOR_FOR(air_data_t*, d, data)
+    {
+        if (!d->addresses)
+            continue;
+        VECTOR_FOR(init_address_t*, ia, d->addresses)
+            ia->sy = replacement(replacements, ia->sy);
+    }
+}
+
+// points everything in the AIR at the symbols that replace the ones it uses
+static void replace_symbols(air_t* air, map_t* replacements)
+{
+    VECTOR_FOR(air_routine_t*, routine, air->routines)
+    {
+        for (air_insn_t* insn = routine->insns; insn; insn = insn->next)
+        {
+            for (size_t i = 0; i < insn->noops; ++i)
+            {
+                air_insn_operand_t* op = insn->ops[i];
+                if (op && op->type == AOP_SYMBOL)
+                    op->content.sy = replacement(replacements, op->content.sy);
+                else if (op && op->type == AOP_INDIRECT_SYMBOL)
+                    op->content.insy.sy = replacement(replacements, op->content.insy.sy);
+            }
+        }
+    }
+    replace_in_data(air->data, replacements);
+    replace_in_data(air->rodata, replacements);
+}
+
+// keeps the data the map has for its symbol, or that keep_external says to keep regardless
+static vector_t* filter_data(vector_t* data, map_t* keep, bool keep_external)
+{
+    vector_t* kept = vector_init();
+    VECTOR_FOR(air_data_t*, d, data)
+    {
+        if (map_get(keep, d->sy) || (keep_external && links_externally(d->sy)))
+            vector_add(kept, d);
+        else
+            air_data_delete(d);
+    }
+    vector_delete(data);
+    return kept;
+}
+
+static vector_t* filter_routines(vector_t* routines, map_t* keep)
+{
+    vector_t* kept = vector_init();
+    VECTOR_FOR(air_routine_t*, routine, routines)
+    {
+        if (map_get(keep, routine->sy))
+            vector_add(kept, routine);
+        else
+            air_routine_delete(routine);
+    }
+    vector_delete(routines);
+    return kept;
+}
+
+static void reach(map_t* reached, vector_t* worklist, symbol_t* sy)
+{
+    if (!sy || map_get(reached, sy))
+        return;
+    map_add(reached, sy, sy);
+    vector_add(worklist, sy);
+}
+
+// drops the routines main can't reach, and the read-only and internal data only they used
+void program_prune(air_t* air)
+{
+    air_routine_t* entry = NULL;
+    map_t* routines = map_init(pointer_comparator, pointer_hash); // map_t<symbol_t*, air_routine_t*>
+    VECTOR_FOR(air_routine_t*, routine, air->routines)
+    {
+        map_add(routines, routine->sy, routine);
+        if (links_externally(routine->sy) && streq(symbol_get_name(routine->sy), "main"))
+            entry = routine;
+    }
+    if (!entry)
+    {
+        map_delete(routines);
+        return;
+    }
+    map_t* data = map_init(pointer_comparator, pointer_hash); // map_t<symbol_t*, air_data_t*>
+    VECTOR_FOR(air_data_t*, d, air->data)
+        map_add(data, d->sy, d);
+    VECTOR_FOR(air_data_t*, rd, air->rodata)
+        map_add(data, rd->sy, rd);
+
+    map_t* reached = map_init(pointer_comparator, pointer_hash); // map_t<symbol_t*, symbol_t*>
+    vector_t* worklist = vector_init(); // vector_t<symbol_t*>
+    reach(reached, worklist, entry->sy);
+    VECTOR_FOR(air_data_t*, external, air->data)
+    {
+        if (links_externally(external->sy))
+            reach(reached, worklist, external->sy);
+    }
+    while (worklist->size)
+    {
+        symbol_t* sy = vector_pop(worklist);
+        air_routine_t* routine = map_get(routines, sy);
+        for (air_insn_t* insn = routine ? routine->insns : NULL; insn; insn = insn->next)
+        {
+            for (size_t i = 0; i < insn->noops; ++i)
+            {
+                air_insn_operand_t* op = insn->ops[i];
+                if (op && op->type == AOP_SYMBOL)
+                    reach(reached, worklist, op->content.sy);
+                else if (op && op->type == AOP_INDIRECT_SYMBOL)
+                    reach(reached, worklist, op->content.insy.sy);
+            }
+        }
+        air_data_t* initialized = map_get(data, sy);
+        if (initialized && initialized->addresses)
+        {
+            VECTOR_FOR(init_address_t*, ia, initialized->addresses)
+                reach(reached, worklist, ia->sy);
+        }
+    }
+
+    air->routines = filter_routines(air->routines, reached);
+    air->data = filter_data(air->data, reached, true);
+    air->rodata = filter_data(air->rodata, reached, false);
+
+    vector_delete(worklist);
+    map_delete(reached);
+    map_delete(data);
+    map_delete(routines);
+}
+
+// merges the AIR of every file, in order, into the first one's, which is returned. the symbol tables are merged into
+// the first file's too, so the syntax trees all have to stay around until the AIR is gone
+air_t* program_merge(vector_t* airs)
+{
+    air_t* program = vector_get(airs, 0);
+    map_t* shared = map_init(pointer_comparator, pointer_hash); // map_t<char*, char*>, names declared in more than one file
+    for (size_t u = 1; u < airs->size; ++u)
+    {
+        air_t* air = vector_get(airs, u);
+        SYMBOL_TABLE_FOR_ENTRIES_START(k, sylist, air->st)
+        {
+            (void) sylist;
+            if (symbol_table_get_all(program->st, k))
+                map_add(shared, k, k);
+        }
+        SYMBOL_TABLE_FOR_ENTRIES_END
+        symbol_table_merge(program->st, air->st);
+        air_merge(program, air);
+    }
+
+    map_t* defined = map_init(pointer_comparator, pointer_hash); // map_t<symbol_t*, symbol_t*>
+    VECTOR_FOR(air_routine_t*, routine, program->routines)
+        map_add(defined, routine->sy, routine->sy);
+    VECTOR_FOR(air_data_t*, d, program->data)
+        map_add(defined, d->sy, d->sy);
+
+    map_t* replacements = map_init(pointer_comparator, pointer_hash); // map_t<symbol_t*, symbol_t*>
+    SYMBOL_TABLE_FOR_ENTRIES_START(k, sylist, program->st)
+        resolve_name(sylist, map_get(shared, k) != NULL, defined, replacements);
+    SYMBOL_TABLE_FOR_ENTRIES_END
+
+    // a definition that was replaced is one too many, since the one that replaced it is a definition as well
+    map_t* kept = map_init(pointer_comparator, pointer_hash); // map_t<symbol_t*, symbol_t*>
+    VECTOR_FOR(air_routine_t*, defined_routine, program->routines)
+    {
+        if (!map_get(replacements, defined_routine->sy))
+            map_add(kept, defined_routine->sy, defined_routine->sy);
+    }
+    VECTOR_FOR(air_data_t*, defined_data, program->data)
+    {
+        if (!map_get(replacements, defined_data->sy))
+            map_add(kept, defined_data->sy, defined_data->sy);
+    }
+    program->routines = filter_routines(program->routines, kept);
+    program->data = filter_data(program->data, kept, false);
+    replace_symbols(program, replacements);
+
+    map_delete(kept);
+    map_delete(replacements);
+    map_delete(defined);
+    map_delete(shared);
+
+    program_prune(program);
+    return program;
+}
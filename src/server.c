@@ -0,0 +1,501 @@
+#define _DEFAULT_SOURCE 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "ecc.h"
+
+/*
+
+the compile server -s runs: a long-lived ecc listening on a Unix socket that runs the command lines of the ecc processes
+given -w. a client sends its working directory, its arguments, and its standard input, output, and error, then waits for
+the exit status. if there's no server to connect to, it compiles on its own instead.
+
+every request runs in a process forked from the server, so requests run in parallel and nothing one does can leak into
+another. what makes the server worth having is what the children inherit:
+    headers             the raw tokens (and include guard) of every header any request has included
+    identifiers         interned from every one of those headers, so the tokenizer finds them already there
+    precompiled headers the macro table, guards, and tokens of every one given to -u, as they were read
+
+the children can't change the server's copy of anything, so they tell it what they read instead, writing a line into a
+pipe shared by all of them for each header and precompiled header it didn't already have. the server reads it in
+between requests. before a child uses anything it inherited, it checks that the file hasn't changed since the server
+read it, and forgets it if it has.
+
+a precompiled header is taken apart by the translation unit it's the prefix of, so each child can only hand the one it
+inherited to the first unit that uses it. the rest read it like they would without a server.
+
+*/
+
+#define SERVER_BACKLOG 64
+
+// what a file looked like when the server read it
+typedef struct file_stamp
+{
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+} file_stamp_t;
+
+typedef struct warm_pch
+{
+    file_stamp_t stamp;
+    preprocessing_table_t* table;
+    map_t* include_cache;
+    preprocessing_token_t* tokens;
+} warm_pch_t;
+
+static char* socket_path = NULL;
+static bool serving = false; // in a child running a request
+static int learned[2] = { -1, -1 }; // the pipe children tell the server what they read through
+
+static map_t* includes = NULL; // map_t<char*, include_cache_entry_t*>, by resolved path, see include_cache_key
+static map_t* include_stamps = NULL; // map_t<char*, file_stamp_t*>, also everything a child has reported already
+static map_t* pchs = NULL; // map_t<char*, warm_pch_t*>, by resolved path
+
+static bool stamp_file(char* path, file_stamp_t* stamp)
+{
+    struct stat st;
+    if (stat(path, &st))
+        return false;
+    stamp->dev = st.st_dev;
+    stamp->ino = st.st_ino;
+    stamp->size = st.st_size;
+    stamp->mtime = st.st_mtim;
+    return true;
+}
+
+static bool stamp_equals(file_stamp_t* a, file_stamp_t* b)
+{
+    return a->dev == b->dev && a->ino == b->ino && a->size == b->size &&
+        a->mtime.tv_sec == b->mtime.tv_sec && a->mtime.tv_nsec == b->mtime.tv_nsec;
+}
+
+// whether the file is still how the stamp has it
+static bool stamp_current(char* path, file_stamp_t* stamp)
+{
+    file_stamp_t now;
+    return stamp_file(path, &now) && stamp_equals(&now, stamp);
+}
+
+static void warm_pch_delete(warm_pch_t* pch)
+{
+    if (!pch) return;
+    preprocessing_table_delete(pch->table);
+    map_delete(pch->include_cache);
+    pp_token_delete_all(pch->tokens);
+    free(pch);
+}
+
+// lexes a header for every request after this one, unless what's there is still current
+static void warm_include(char* path)
+{
+    file_stamp_t* stamp = map_get(include_stamps, path);
+    if (stamp && stamp_current(path, stamp))
+        return;
+    file_stamp_t now;
+    if (!stamp_file(path, &now))
+        return;
+    FILE* file = fopen(path, "r");
+    if (!file)
+        return;
+    preprocessing_token_t* tokens = lex(file, false);
+    fclose(file);
+    if (!tokens)
+        return;
+    for (preprocessing_token_t* token = tokens; token; token = token->next)
+    {
+        if (token->type == PPT_IDENTIFIER)
+            (void) intern(token->identifier);
+    }
+    (void) include_cache_record(includes, path, tokens);
+    pp_token_delete_all(tokens);
+    if (!stamp)
+        map_add(include_stamps, strdup(path), stamp = malloc(sizeof *stamp));
+    *stamp = now;
+}
+
+// reads a precompiled header for every request after this one, unless what's there is still current
+static void warm_pch(char* path)
+{
+    warm_pch_t* pch = map_get(pchs, path);
+    if (pch && stamp_current(path, &pch->stamp))
+        return;
+    warm_pch_t* read = calloc(1, sizeof *read);
+    if (!stamp_file(path, &read->stamp) || !pch_read(path, &read->table, &read->include_cache, &read->tokens))
+    {
+        free(read);
+        return;
+    }
+    if (pch)
+        map_remove(pchs, path);
+    map_add(pchs, strdup(path), read);
+}
+
+// what a child wrote into the pipe: a line of "i <path>" for a header or "u <path>" for a precompiled header
+static void learn(char* line)
+{
+    if (line[0] == 'i' && line[1] == ' ')
+        warm_include(line + 2);
+    else if (line[0] == 'u' && line[1] == ' ')
+        warm_pch(line + 2);
+}
+
+static void tell_server(char kind, char* path)
+{
+    if (!serving)
+        return;
+    char line[LINUX_MAX_PATH_LENGTH + 4];
+    int length = snprintf(line, sizeof line, "%c %s\n", kind, path);
+    // lines shorter than PIPE_BUF go in whole even with other children writing at once
+    if (length > 0 && length < (int) sizeof line)
+        (void) !write(learned[1], line, length);
+}
+
+// the headers every compilation a server runs starts with, or NULL without one
+map_t* server_include_cache(void)
+{
+    return serving ? includes : NULL;
+}
+
+// tells the server about the headers a translation unit lexed that it didn't already have
+void server_learn_includes(map_t* include_cache)
+{
+    if (!serving || include_cache != includes)
+        return;
+    for (size_t i = 0; i < include_cache->capacity; ++i)
+    {
+        char* path = include_cache->key[i];
+        if (!path || path == (void*) -1 || map_contains_key(include_stamps, path))
+            continue;
+        tell_server('i', path);
+        // so it isn't told twice
+        map_add(include_stamps, strdup(path), calloc(1, sizeof(file_stamp_t)));
+    }
+}
+
+// hands over the precompiled header the server read before, if there's one for the path it can still give away
+bool server_pch(char* path, preprocessing_table_t** table, map_t** include_cache, preprocessing_token_t** tokens)
+{
+    if (!serving)
+        return false;
+    char* key = include_cache_key(path);
+    warm_pch_t* pch = map_get(pchs, key);
+    if (!pch)
+    {
+        tell_server('u', key);
+        free(key);
+        return false;
+    }
+    *table = pch->table;
+    *include_cache = pch->include_cache;
+    *tokens = pch->tokens;
+    pch->table = NULL;
+    pch->include_cache = NULL;
+    pch->tokens = NULL;
+    map_remove(pchs, key);
+    free(key);
+    return true;
+}
+
+// forgets every header inherited from the server that's changed since it read it
+static void forget_stale_includes(void)
+{
+    vector_t* stale = vector_init();
+    MAP_FOR(char*, file_stamp_t*, include_stamps)
+    {
+        if (k && k != (void*) -1 && !stamp_current(k, v))
+            vector_add(stale, k);
+    }
+    VECTOR_FOR(char*, path, stale)
+    {
+        map_remove(includes, path);
+        map_remove(include_stamps, path);
+    }
+    vector_delete(stale);
+}
+
+// and every precompiled header
+static void forget_stale_pchs(void)
+{
+    vector_t* stale = vector_init();
+    MAP_FOR(char*, warm_pch_t*, pchs)
+    {
+        if (k && k != (void*) -1 && !stamp_current(k, &v->stamp))
+            vector_add(stale, k);
+    }
+    VECTOR_FOR(char*, path, stale)
+        map_remove(pchs, path);
+    vector_delete(stale);
+}
+
+static bool write_all(int fd, void* data, size_t length)
+{
+    for (char* p = data; length;)
+    {
+        ssize_t written = write(fd, p, length);
+        if (written == -1 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+        p += written, length -= written;
+    }
+    return true;
+}
+
+static bool read_all(int fd, void* data, size_t length)
+{
+    for (char* p = data; length;)
+    {
+        ssize_t got = read(fd, p, length);
+        if (got == -1 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            return false;
+        p += got, length -= got;
+    }
+    return true;
+}
+
+/*
+
+a request is a message carrying the client's standard input, output, and error as SCM_RIGHTS along with the length of
+what follows it, then that many bytes of NUL-terminated strings: the working directory, then every argument. the reply
+is the exit status.
+
+*/
+
+typedef struct request_header
+{
+    uint32_t length;
+} request_header_t;
+
+// runs a request on a connection, in a child of the server
+static int run_request(int conn)
+{
+    request_header_t header;
+    char control[CMSG_SPACE(3 * sizeof(int))];
+    struct iovec iov = { .iov_base = &header, .iov_len = sizeof header };
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control,
+        .msg_controllen = sizeof control
+    };
+    if (recvmsg(conn, &msg, MSG_WAITALL) != sizeof header)
+        return EXIT_FAILURE;
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(3 * sizeof(int)))
+        return EXIT_FAILURE;
+    int fds[3];
+    memcpy(fds, CMSG_DATA(cmsg), sizeof fds);
+
+    char* body = malloc(header.length + 1);
+    if (!read_all(conn, body, header.length))
+        return EXIT_FAILURE;
+    body[header.length] = '\0';
+
+    // the working directory, then the arguments
+    vector_t* args = vector_init();
+    for (char* p = body; p < body + header.length; p += strlen(p) + 1)
+        vector_add(args, p);
+    if (args->size < 2 || chdir(vector_get(args, 0)))
+        return EXIT_FAILURE;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        dup2(fds[i], i);
+        close(fds[i]);
+    }
+
+    int argc = args->size - 1;
+    char** argv = calloc(argc + 1, sizeof(char*));
+    for (int i = 0; i < argc; ++i)
+        argv[i] = vector_get(args, i + 1);
+
+    forget_stale_includes();
+    forget_stale_pchs();
+    // getopt has to start over for the request's arguments
+    optind = 0;
+    int status = get_options(argc, argv) ? drive(argc, argv) : EXIT_FAILURE;
+    fflush(stdout);
+    fflush(stderr);
+    return status;
+}
+
+static void stop(int sig)
+{
+    if (socket_path)
+        unlink(socket_path);
+    _exit(EXIT_SUCCESS);
+}
+
+// serves requests on the socket at path until killed
+int serve(char* path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof addr.sun_path)
+    {
+        errorf("socket path '%s' is too long\n", path);
+        return EXIT_FAILURE;
+    }
+    strcpy(addr.sun_path, path);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path);
+    if (listener == -1 || bind(listener, (struct sockaddr*) &addr, sizeof addr) || listen(listener, SERVER_BACKLOG))
+    {
+        errorf("could not listen on '%s'\n", path);
+        return EXIT_FAILURE;
+    }
+    if (pipe(learned))
+    {
+        errorf("could not create a pipe for the server\n");
+        return EXIT_FAILURE;
+    }
+
+    socket_path = path;
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    // children are never waited on, so they're reaped as soon as they exit
+    signal(SIGCHLD, SIG_IGN);
+
+    includes = include_cache_init();
+    include_stamps = map_init((comparator_t) strcmp, (hash_function_t) hash);
+    map_set_deleters(include_stamps, free, free);
+    pchs = map_init((comparator_t) strcmp, (hash_function_t) hash);
+    map_set_deleters(pchs, free, (void (*)(void*)) warm_pch_delete);
+
+    char pending[LINUX_MAX_PATH_LENGTH + 4];
+    size_t pending_length = 0;
+    for (;;)
+    {
+        struct pollfd fds[2] = {
+            { .fd = learned[0], .events = POLLIN },
+            { .fd = listener, .events = POLLIN }
+        };
+        if (poll(fds, 2, -1) == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            errorf("server could not wait for requests\n");
+            return EXIT_FAILURE;
+        }
+
+        // what children read is taken in before anything new is started, so the next request gets it
+        if (fds[0].revents & POLLIN)
+        {
+            ssize_t got = read(learned[0], pending + pending_length, sizeof pending - pending_length - 1);
+            if (got > 0)
+                pending_length += got;
+            char* line = pending;
+            for (char* end; (end = memchr(line, '\n', pending + pending_length - line)); line = end + 1)
+            {
+                *end = '\0';
+                learn(line);
+            }
+            pending_length -= line - pending;
+            memmove(pending, line, pending_length);
+            // a line that doesn't fit is no line the children would write
+            if (pending_length == sizeof pending - 1)
+                pending_length = 0;
+            continue;
+        }
+
+        if (!(fds[1].revents & POLLIN))
+            continue;
+        int conn = accept(listener, NULL, NULL);
+        if (conn == -1)
+            continue;
+        fflush(stdout);
+        fflush(stderr);
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            signal(SIGINT, SIG_DFL);
+            signal(SIGTERM, SIG_DFL);
+            signal(SIGCHLD, SIG_DFL);
+            close(listener);
+            close(learned[0]);
+            serving = true;
+            int status = run_request(conn);
+            (void) write_all(conn, &status, sizeof status);
+            exit(status);
+        }
+        close(conn);
+    }
+}
+
+// has the server at path run this command line, returning its exit status, or -1 if there's no server there
+int server_request(char* path, int argc, char** argv)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof addr.sun_path)
+        return -1;
+    strcpy(addr.sun_path, path);
+    int conn = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (conn == -1)
+        return -1;
+    if (connect(conn, (struct sockaddr*) &addr, sizeof addr))
+    {
+        close(conn);
+        return -1;
+    }
+
+    char cwd[LINUX_MAX_PATH_LENGTH];
+    if (!getcwd(cwd, sizeof cwd))
+    {
+        close(conn);
+        return -1;
+    }
+    size_t length = strlen(cwd) + 1;
+    for (int i = 0; i < argc; ++i)
+        length += strlen(argv[i]) + 1;
+    char* body = malloc(length);
+    char* p = body;
+    p = stpcpy(p, cwd) + 1;
+    for (int i = 0; i < argc; ++i)
+        p = stpcpy(p, argv[i]) + 1;
+
+    request_header_t header = { .length = length };
+    int fds[3] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+    char control[CMSG_SPACE(sizeof fds)];
+    memset(control, 0, sizeof control);
+    struct iovec iov = { .iov_base = &header, .iov_len = sizeof header };
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control,
+        .msg_controllen = sizeof control
+    };
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof fds);
+    memcpy(CMSG_DATA(cmsg), fds, sizeof fds);
+
+    // anything buffered would come out after what the server writes
+    fflush(stdout);
+    fflush(stderr);
+    int status = -1;
+    if (sendmsg(conn, &msg, 0) != sizeof header || !write_all(conn, body, length) || !read_all(conn, &status, sizeof status))
+    {
+        // once the request's gone out it may have run, so there's no falling back to running it here
+        errorf("lost the connection to the server at '%s'\n", path);
+        status = EXIT_FAILURE;
+    }
+    free(body);
+    close(conn);
+    return status;
+}
@@ -0,0 +1,291 @@
+#define _DEFAULT_SOURCE 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "ecc.h"
+
+/*
+
+the report -t prints and -T appends to a file: where a translation unit's compile time and memory went, phase by phase.
+
+each phase is timed by taking a mark before it and handing the mark back after it. the marks are taken per thread, so
+the phases the back end runs a routine at a time add up across every routine and every thread, and can add up to
+more than the whole compilation took when it has more than one thread. the total comes from the process as a whole.
+
+memory is what the heap grew by over a phase, read from the allocator with mallinfo2 at either end of it, and only
+when a report was asked for. it's net of frees, so a phase that gives back more than it takes comes out negative.
+unlike the times it's the process's heap, not the thread's, so while the back end has more than one thread a phase is
+charged for what the others allocated meanwhile too. the total is still right. with a C library that has no mallinfo2,
+or a sanitizer that keeps its own heap, it's zero throughout.
+
+the assembler and linker are timed from the outside, with their processor time and peak memory coming from the kernel
+once they've exited. the kernel counts what a child had before it exec'd too, which is a copy of the compiler, so
+their peak is only an upper bound.
+
+the optimizers' passes each get a phase of their own (see pass.c), which is named after the optimizer and counted in
+its phase as well.
+
+*/
+
+static const char* PHASE_NAMES[PHASE_NO_ELEMENTS] = {
+    "lex",
+    "preprocess",
+    "strlitconcat",
+    "tokenize",
+    "parse",
+    "type",
+    "analyze",
+    "airinize",
+    "merge",
+    "opt1",
+    "opt1.inline",
+    "opt1.propagate",
+    "opt1.number",
+    "opt1.loops",
+    "opt1.dce",
+    "opt1.calls",
+    "opt1.lifetimes",
+    "layout",
+    "localize",
+    "allocate",
+    "generate",
+    "opt4",
+    "opt4.peephole",
+    "emit",
+    "write",
+    "assemble",
+    "link"
+};
+
+static const char* COUNTER_NAMES[COUNTER_NO_ELEMENTS] = {
+    "tokens",
+    "syntax_nodes",
+    "air_insns",
+    "optimized_air_insns",
+    "x86_insns"
+};
+
+typedef struct phase_stats
+{
+    uint64_t runs;
+    uint64_t wall; // ns
+    uint64_t cpu; // ns
+    int64_t heap; // bytes
+} phase_stats_t;
+
+static bool counting = false;
+
+static char* unit = NULL;
+static stats_mark_t unit_start;
+static uint64_t unit_cpu_start;
+static phase_stats_t phases[PHASE_NO_ELEMENTS];
+static uint64_t counters[COUNTER_NO_ELEMENTS];
+static long child_peak_rss = 0; // KB
+
+// the bytes the heap has handed out and not had back, mapped chunks included
+static uint64_t heap_in_use(void)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+static uint64_t clock_ns(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t timeval_ns(struct timeval tv)
+{
+    return (uint64_t) tv.tv_sec * 1000000000 + (uint64_t) tv.tv_usec * 1000;
+}
+
+bool stats_enabled(void)
+{
+    return counting;
+}
+
+// starts a report on a translation unit (or on the link), throwing away whatever was counted before
+void stats_start(char* name)
+{
+    program_options_t* options = get_program_options();
+    counting = options->tflag || options->ttflag;
+    if (!counting)
+        return;
+    unit = name;
+    memset(phases, 0, sizeof phases);
+    memset(counters, 0, sizeof counters);
+    child_peak_rss = 0;
+    unit_cpu_start = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+    unit_start = stats_begin();
+}
+
+stats_mark_t stats_begin(void)
+{
+    stats_mark_t mark = {0};
+    if (!counting)
+        return mark;
+    mark.wall = clock_ns(CLOCK_MONOTONIC);
+    mark.cpu = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+    mark.heap = heap_in_use();
+    return mark;
+}
+
+// charges everything since the mark was taken on this thread to the phase
+void stats_end(compile_phase_t phase, stats_mark_t* mark)
+{
+    if (!counting)
+        return;
+    phase_stats_t* p = &phases[phase];
+    __atomic_fetch_add(&p->runs, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&p->wall, clock_ns(CLOCK_MONOTONIC) - mark->wall, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&p->cpu, clock_ns(CLOCK_THREAD_CPUTIME_ID) - mark->cpu, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&p->heap, (int64_t) (heap_in_use() - mark->heap), __ATOMIC_RELAXED);
+}
+
+void stats_count(compile_counter_t counter, uint64_t n)
+{
+    if (counting)
+        __atomic_fetch_add(&counters[counter], n, __ATOMIC_RELAXED);
+}
+
+// waits on a child started after the mark was taken, charging the phase for its time
+pid_t stats_wait(pid_t pid, int* status, compile_phase_t phase, stats_mark_t* mark)
+{
+    if (!counting)
+        return waitpid(pid, status, 0);
+    struct rusage usage;
+    pid_t waited = wait4(pid, status, 0, &usage);
+    if (waited == -1)
+        return waited;
+    phase_stats_t* p = &phases[phase];
+    ++p->runs;
+    p->wall += clock_ns(CLOCK_MONOTONIC) - mark->wall;
+    p->cpu += timeval_ns(usage.ru_utime) + timeval_ns(usage.ru_stime);
+    child_peak_rss = max(child_peak_rss, usage.ru_maxrss);
+    return waited;
+}
+
+static double ms(uint64_t ns)
+{
+    return ns / 1000000.0;
+}
+
+static void print_report(FILE* file, phase_stats_t* total, long peak_rss)
+{
+    fprintf(file, "ecc: report for %s\n", unit);
+    fprintf(file, "  %-14s %12s %12s %14s\n", "phase", "wall (ms)", "cpu (ms)", "heap (bytes)");
+    for (compile_phase_t i = 0; i < PHASE_NO_ELEMENTS; ++i)
+    {
+        phase_stats_t* p = &phases[i];
+        if (!p->runs) continue;
+        fprintf(file, "  %-14s %12.3f %12.3f %14lld\n", PHASE_NAMES[i], ms(p->wall), ms(p->cpu), (long long) p->heap);
+    }
+    fprintf(file, "  %-14s %12.3f %12.3f %14lld\n", "total", ms(total->wall), ms(total->cpu), (long long) total->heap);
+    fprintf(file, "  peak rss: %ld KB", peak_rss);
+    if (child_peak_rss)
+        fprintf(file, " (assembler/linker: %ld KB)", child_peak_rss);
+    fprintf(file, "\n");
+    bool any = false;
+    for (compile_counter_t i = 0; i < COUNTER_NO_ELEMENTS; ++i)
+    {
+        if (!counters[i]) continue;
+        fprintf(file, "%s%s: %llu", any ? ", " : "  ", COUNTER_NAMES[i], (unsigned long long) counters[i]);
+        any = true;
+    }
+    if (any)
+        fprintf(file, "\n");
+}
+
+static void print_json_string(FILE* file, char* str)
+{
+    fputc('"', file);
+    for (; *str; ++str)
+    {
+        if (*str == '"' || *str == '\\')
+            fprintf(file, "\\%c", *str);
+        else if ((unsigned char) *str < 0x20)
+            fprintf(file, "\\u%04x", *str);
+        else
+            fputc(*str, file);
+    }
+    fputc('"', file);
+}
+
+// one object per line, so reports from several processes can go to the same file
+static void print_json_report(FILE* file, phase_stats_t* total, long peak_rss)
+{
+    fprintf(file, "{\"unit\":");
+    print_json_string(file, unit);
+    fprintf(file, ",\"phases\":[");
+    bool first = true;
+    for (compile_phase_t i = 0; i < PHASE_NO_ELEMENTS; ++i)
+    {
+        phase_stats_t* p = &phases[i];
+        if (!p->runs) continue;
+        fprintf(file, "%s{\"name\":\"%s\",\"wall_ms\":%.3f,\"cpu_ms\":%.3f,\"heap_bytes\":%lld}",
+            first ? "" : ",", PHASE_NAMES[i], ms(p->wall), ms(p->cpu), (long long) p->heap);
+        first = false;
+    }
+    fprintf(file, "],\"total\":{\"wall_ms\":%.3f,\"cpu_ms\":%.3f,\"heap_bytes\":%lld}",
+        ms(total->wall), ms(total->cpu), (long long) total->heap);
+    fprintf(file, ",\"peak_rss_kb\":%ld,\"child_peak_rss_kb\":%ld", peak_rss, child_peak_rss);
+    for (compile_counter_t i = 0; i < COUNTER_NO_ELEMENTS; ++i)
+        fprintf(file, ",\"%s\":%llu", COUNTER_NAMES[i], (unsigned long long) counters[i]);
+    fprintf(file, "}\n");
+}
+
+// ends the report stats_start began, printing it for -t and appending it to the file given to -T
+bool stats_finish(void)
+{
+    if (!counting)
+        return true;
+    phase_stats_t total = {
+        .runs = 1,
+        .wall = clock_ns(CLOCK_MONOTONIC) - unit_start.wall,
+        .cpu = clock_ns(CLOCK_PROCESS_CPUTIME_ID) - unit_cpu_start,
+        .heap = (int64_t) (heap_in_use() - unit_start.heap)
+    };
+    counting = false;
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    program_options_t* options = get_program_options();
+    if (options->tflag)
+    {
+        print_report(stderr, &total, usage.ru_maxrss);
+        fflush(stderr);
+    }
+    if (!options->ttflag)
+        return true;
+
+    // the whole line goes out in one write so that lines from processes writing at once don't interleave
+    char* line = NULL;
+    size_t length = 0;
+    FILE* stream = open_memstream(&line, &length);
+    if (!stream)
+        return false;
+    print_json_report(stream, &total, usage.ru_maxrss);
+    fclose(stream);
+    int fd = open(options->ttflag, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    bool success = fd != -1 && write(fd, line, length) == (ssize_t) length;
+    if (fd != -1)
+        close(fd);
+    free(line);
+    if (!success)
+        errorf("could not write the report to '%s'\n", options->ttflag);
+    return success;
+}
@@ -261,60 +261,27 @@ void symbol_delete(symbol_t* sy)
 
 static void symbol_delete_list(symbol_t* sy)
 {
-    if (!sy)
-        return;
-    symbol_delete_list(sy->next);
-    symbol_delete(sy);
-}
-
-// this impl optionally asks for a ptr to retrieve the index of the element as well
-static symbol_t* symbol_table_get_internal(symbol_table_t* t, char* k, int* i)
-{
-    unsigned long index = hash(k) % t->capacity;
-    unsigned long oidx = index;
-    do
+    while (sy)
     {
-        if (t->key[index] != NULL && !strcmp(t->key[index], k))
-        {
-            if (i) *i = index;
-            return t->value[index];
-        }
-        index = (index + 1 == t->capacity ? 0 : index + 1);
+        symbol_t* next = sy->next;
+        symbol_delete(sy);
+        sy = next;
     }
-    while (index != oidx);
-    if (i) *i = -1;
-    return NULL;
 }
 
 symbol_table_t* symbol_table_init(void)
 {
     symbol_table_t* t = calloc(1, sizeof *t);
-    t->key = calloc(50, sizeof(char*));
-    memset(t->key, 0, 50 * sizeof(char*));
-    t->value = calloc(50, sizeof(symbol_t*));
-    memset(t->value, 0, 50 * sizeof(symbol_t*));
-    t->size = 0;
-    t->capacity = 50;
+    // names are interned
+    t->map = map_init((comparator_t) intern_comparator, (hash_function_t) intern_hash);
     t->unique_types = vector_init();
     return t;
 }
 
-symbol_table_t* symbol_table_resize(symbol_table_t* t)
-{
-    unsigned old_capacity = t->capacity;
-    t->key = realloc(t->key, (t->capacity = (unsigned) (t->capacity * 1.5)) * sizeof(char*));
-    memset(t->key + old_capacity, 0, (t->capacity - old_capacity) * sizeof(char*));
-    t->value = realloc(t->value, t->capacity * sizeof(symbol_t*));
-    memset(t->value + old_capacity, 0, (t->capacity - old_capacity) * sizeof(char*));
-    return t;
-}
-
 symbol_t* symbol_table_add(symbol_table_t* t, char* k, symbol_t* sy)
 {
-    if (t->size >= t->capacity)
-        (void) symbol_table_resize(t);
-    int exi;
-    symbol_t* ex = symbol_table_get_internal(t, k, &exi);
+    k = intern(k);
+    symbol_t* ex = map_get(t->map, k);
     if (ex) // append to the end
     {
         uint64_t disambiguator = 1;
@@ -324,28 +291,15 @@ symbol_t* symbol_table_add(symbol_table_t* t, char* k, symbol_t* sy)
         sy->disambiguator = disambiguator;
         return sy;
     }
-    else
-        sy->disambiguator = 0;
-    unsigned long index = hash(k) % t->capacity;
-    for (unsigned long i = index;;)
-    {
-        if (t->key[i] == NULL)
-        {
-            t->key[i] = strdup(k);
-            t->value[i] = sy;
-            ++(t->size);
-            break;
-        }
-        i = (i + 1) % t->capacity;
-        if (i == index) // for safety but this should never happen
-            return NULL;
-    }
+    sy->disambiguator = 0;
+    map_add(t->map, intern(k), sy);
     return sy;
 }
 
+// k must be interned
 symbol_t* symbol_table_get_all(symbol_table_t* t, char* k)
 {
-    return symbol_table_get_internal(t, k, NULL);
+    return map_get(t->map, k);
 }
 
 symbol_t* symbol_table_get_by_classes(symbol_table_t* t, char* k, c_type_class_t ctc, c_namespace_class_t nsc)
@@ -438,73 +392,83 @@ symbol_t* symbol_table_count(symbol_table_t* t, syntax_component_t* id, c_namesp
 symbol_t* symbol_table_remove(symbol_table_t* t, syntax_component_t* id)
 {
     char* k = id->id;
-    unsigned long index = hash(k) % t->capacity;
-    for (unsigned long i = index;;)
+    symbol_t* sy = map_get(t->map, k);
+    symbol_t* prev = NULL;
+    symbol_t* sylist = sy;
+    for (; sylist; prev = sylist, sylist = sylist->next)
     {
-        if (t->key[i] != NULL && !strcmp(t->key[i], k))
+        if (sylist->declarer == id)
         {
-            symbol_t* prev = NULL;
-            symbol_t* sy = t->value[i];
-            symbol_t* sylist = sy;
-            for (; sylist; prev = sylist, sylist = sylist->next)
-            {
-                if (sylist->declarer == id)
-                {
-                    if (prev)
-                        prev->next = sylist->next;
-                    else
-                        sy = sylist->next;
-                    break;
-                }
-            }
-            if (!sylist)
-                return NULL;
-            if (!sy)
-            {
-                t->key[i] = NULL;
-                --(t->size);
-            }
-            t->value[i] = sy;
-            return sylist;
-        }
-        i = (i + 1) % t->capacity;
-        if (i == index)
+            if (prev)
+                prev->next = sylist->next;
+            else
+                sy = sylist->next;
             break;
+        }
     }
-    return NULL;
+    if (!sylist)
+        return NULL;
+    if (sy)
+        map_add(t->map, k, sy);
+    else
+        map_remove(t->map, k);
+    return sylist;
+}
+
+// moves every symbol in from into t, each after those already there by the same name, leaving from empty
+void symbol_table_merge(symbol_table_t* t, symbol_table_t* from)
+{
+    SYMBOL_TABLE_FOR_ENTRIES_START(k, sylist, from)
+    {
+        symbol_t* ex = map_get(t->map, k);
+        if (!ex)
+        {
+            map_add(t->map, k, sylist);
+            continue;
+        }
+        uint64_t disambiguator = 1;
+        symbol_t* last = ex;
+        for (; last->next; last = last->next, ++disambiguator);
+        last->next = sylist;
+        for (symbol_t* sy = sylist; sy; sy = sy->next)
+            sy->disambiguator = disambiguator++;
+    }
+    SYMBOL_TABLE_FOR_ENTRIES_END
+    map_delete(from->map);
+    from->map = map_init((comparator_t) intern_comparator, (hash_function_t) intern_hash);
 }
 
 void symbol_table_print(symbol_table_t* t, int (*printer)(const char*, ...))
 {
     printer("[symbol table]\n");
-    for (unsigned i = 0; i < t->capacity; ++i)
+    SYMBOL_TABLE_FOR_ENTRIES_START(k, sylist, t)
     {
-        char* k = t->key[i];
-        if (k != NULL)
+        printer("  \"%s\" -> [", k);
+        for (symbol_t* sy = sylist; sy; sy = sy->next)
         {
-            printer("  \"%s\" -> [", k);
-            for (symbol_t* sy = t->value[i]; sy; sy = sy->next)
-            {
-                if (sy != t->value[i])
-                    printer(", ");
-                symbol_print(sy, printer);
-            }
-            printer("]\n");
+            if (sy != sylist)
+                printer(", ");
+            symbol_print(sy, printer);
         }
+        printer("]\n");
     }
+    SYMBOL_TABLE_FOR_ENTRIES_END
 }
 
 void symbol_table_delete(symbol_table_t* t, bool free_contents)
 {
-    for (unsigned i = 0; i < t->capacity; ++i)
+    if (free_contents)
     {
-        if (free_contents && t->key[i])
-            symbol_delete_list(t->value[i]);
-        free(t->key[i]);
+        SYMBOL_TABLE_FOR_ENTRIES_START(k, sylist, t)
+        {
+            (void) k;
+            symbol_delete_list(sylist);
+        }
+        SYMBOL_TABLE_FOR_ENTRIES_END
     }
-    vector_deep_delete(t->unique_types, (void (*)(void*)) symbol_type_delete);
-    free(t->key);
-    free(t->value);
+    map_delete(t->map);
+    map_delete(t->interned_types);
+    symbol_types_delete(t->unique_types);
     free(t);
 }
 
@@ -701,6 +701,14 @@ void contains_default_after(syntax_traverser_t* trav, syntax_component_t* syn)
 
 bool syntax_contains_subelement(syntax_component_t* syn, syntax_component_type_t type)
 {
+    if (syn->contains[type / 64] & (1ULL << (type % 64)))
+        return true;
+    for (unsigned i = 0; i < SC_SUMMARY_WORDS; ++i)
+    {
+        // summarized and the bit isn't there
+        if (syn->contains[i])
+            return false;
+    }
     contains_traverser_t* trav = (contains_traverser_t*) traverse_init(syn, sizeof(contains_traverser_t));
     trav->type = type;
     trav->found = false;
@@ -1393,7 +1401,6 @@ void free_syntax(syntax_component_t* syn, syntax_component_t* tlu)
             // remove the id from the symbol table if it defines a symbol
             if (tlu && syn->id)
                 symbol_delete(symbol_table_remove(tlu->tlu_st, syn));
-            free(syn->id);
             break;
         }
         case SC_POINTER:
@@ -1595,7 +1602,6 @@ void free_syntax(syntax_component_t* syn, syntax_component_t* tlu)
         {
             free(syn->strl_reg);
             free(syn->strl_wide);
-            free(syn->strl_id);
             break;
         }
         case SC_IF_STATEMENT:
@@ -1653,7 +1659,6 @@ void free_syntax(syntax_component_t* syn, syntax_component_t* tlu)
         {
             free_syntax(syn->cl_inlist, tlu);
             free_syntax(syn->cl_type_name, tlu);
-            free(syn->cl_id);
             break;
         }
         case SC_MEMBER_EXPRESSION:
@@ -1704,7 +1709,8 @@ void free_syntax(syntax_component_t* syn, syntax_component_t* tlu)
     syn->initializer_ctype = NULL;
     type_delete(syn->ctype);
     syn->ctype = NULL;
-    air_insn_delete_all(syn->code);
+    for (unsigned i = 0; i < sizeof(syn->constexprs) / sizeof(syn->constexprs[0]); ++i)
+        constexpr_delete(syn->constexprs[i]);
     free(syn);
 }
 
@@ -4,7 +4,6 @@
 #include "ecc.h"
 
 #define init_token(t) \
-    token_t* token = calloc(1, sizeof *token); \
     token->type = (t); \
     token->row = pp_token->row; \
     token->col = pp_token->col;
@@ -99,19 +98,19 @@ void token_print(token_t* token, int (*printer)(const char* fmt, ...))
             printer(", identifier: %s", token->identifier);
             break;
         case T_INTEGER_CONSTANT:
-            printer(", integer constant (ULL): %llu, type: %s", token->integer_constant.value, C_TYPE_CLASS_NAMES[token->integer_constant.class]);
+            printer(", integer constant (ULL): %llu, type: %s", token->integer_constant, C_TYPE_CLASS_NAMES[token->class]);
             break;
         case T_FLOATING_CONSTANT:
-            printer(", floating constant (LD): %Lf, type: %s", token->floating_constant.value, C_TYPE_CLASS_NAMES[token->floating_constant.class]);
+            printer(", floating constant (LD): %Lf, type: %s", *token->floating_constant, C_TYPE_CLASS_NAMES[token->class]);
             break;
         case T_CHARACTER_CONSTANT:
-            printer(", character constant: %d, wide: %s", token->character_constant.value, BOOL_NAMES[token->character_constant.wide]);
+            printer(", character constant: %d, wide: %s", token->character_constant, BOOL_NAMES[token->wide]);
             break;
         case T_STRING_LITERAL:
-            if (token->string_literal.value_reg)
-                printer(", string literal: \"%s\"", token->string_literal.value_reg);
+            if (!token->wide)
+                printer(", string literal: \"%s\"", token->string_literal);
             else
-                printer(", string literal: L\"%ls\"", token->string_literal.value_wide);
+                printer(", string literal: L\"%ls\"", token->string_literal_wide);
             break;
         case T_PUNCTUATOR:
             printer(", punctuator: %s", PUNCTUATOR_STRING_REPRS[token->punctuator]);
@@ -122,45 +121,85 @@ void token_print(token_t* token, int (*printer)(const char* fmt, ...))
     printer(" }");
 }
 
-void token_delete(token_t* token)
-{
-    if (!token) return;
-    switch (token->type)
-    {
-        case T_STRING_LITERAL:
-            free(token->string_literal.value_reg);
-            free(token->string_literal.value_wide);
-            break;
-        case T_IDENTIFIER:
-            free(token->identifier);
-            break;
-        default:
-            break;
-    }
-    free(token);
-}
+/*
+
+no two keywords share a slot under this hash of their first character, last character, and length, so a single
+comparison against the keyword in an identifier's slot says whether it is one. the table holds the keyword plus one,
+leaving zero for the empty slots.
+
+*/
+
+#define KEYWORD_HASH(str, length) (((unsigned char) (str)[0] + (unsigned char) (str)[(length) - 1] * 22 + (length) * 11) & 127)
+#define KEYWORD_MIN_LENGTH 2
+#define KEYWORD_MAX_LENGTH 10
 
-void token_delete_all(token_t* token)
+static const unsigned char KEYWORD_TABLE[128] = {
+    [2] = KW_INT + 1,
+    [4] = KW_DO + 1,
+    [5] = KW_TYPEDEF + 1,
+    [7] = KW_COMPLEX + 1,
+    [18] = KW_CONST + 1,
+    [21] = KW_FLOAT + 1,
+    [22] = KW_REGISTER + 1,
+    [23] = KW_AUTO + 1,
+    [27] = KW_EXTERN + 1,
+    [29] = KW_GOTO + 1,
+    [32] = KW_UNION + 1,
+    [34] = KW_SHORT + 1,
+    [37] = KW_SWITCH + 1,
+    [40] = KW_RETURN + 1,
+    [41] = KW_DEFAULT + 1,
+    [45] = KW_STRUCT + 1,
+    [51] = KW_IMAGINARY + 1,
+    [55] = KW_STATIC + 1,
+    [58] = KW_VOID + 1,
+    [61] = KW_CASE + 1,
+    [63] = KW_ELSE + 1,
+    [66] = KW_RESTRICT + 1,
+    [67] = KW_IF + 1,
+    [75] = KW_BREAK + 1,
+    [77] = KW_SIGNED + 1,
+    [83] = KW_FOR + 1,
+    [84] = KW_DOUBLE + 1,
+    [89] = KW_INLINE + 1,
+    [91] = KW_CHAR + 1,
+    [92] = KW_WHILE + 1,
+    [94] = KW_BOOL + 1,
+    [101] = KW_UNSIGNED + 1,
+    [105] = KW_CONTINUE + 1,
+    [111] = KW_ENUM + 1,
+    [114] = KW_LONG + 1,
+    [121] = KW_SIZEOF + 1,
+    [124] = KW_VOLATILE + 1,
+};
+
+// the keyword spelled by str, or -1 if it isn't one
+int keyword_lookup(char* str)
 {
-    if (!token) return;
-    token_delete_all(token->next);
-    token_delete(token);
+    size_t length = strlen(str);
+    if (length < KEYWORD_MIN_LENGTH || length > KEYWORD_MAX_LENGTH)
+        return -1;
+    int entry = KEYWORD_TABLE[KEYWORD_HASH(str, length)];
+    if (!entry || strcmp(KEYWORDS[entry - 1], str))
+        return -1;
+    return entry - 1;
 }
 
-token_t* tokenize_identifier(preprocessing_token_t* pp_token, tokenizing_settings_t* settings)
+static token_t* tokenize_identifier(preprocessing_token_t* pp_token, tokenizing_settings_t* settings, token_t* token)
 {
     if (!pp_token || pp_token->type != PPT_IDENTIFIER)
         return fail_token("expected identifier");
-    int idx = contains((void**) KEYWORDS, KW_ELEMENTS, pp_token->identifier, (int (*)(void*, void*)) strcmp);
+    // identifiers are interned, and whether each is a keyword was settled when it was
+    int idx = intern_keyword(pp_token->identifier);
     init_token(idx == -1 ? T_IDENTIFIER : T_KEYWORD);
     if (idx == -1)
-        token->identifier = strdup(pp_token->identifier);
+        token->identifier = pp_token->identifier;
     else
         token->keyword = (c_keyword_t) idx;
     return token;
 }
 
-token_t* tokenize_punctuator(preprocessing_token_t* pp_token, tokenizing_settings_t* settings)
+static token_t* tokenize_punctuator(preprocessing_token_t* pp_token, tokenizing_settings_t* settings, token_t* token)
 {
     if (!pp_token || pp_token->type != PPT_PUNCTUATOR)
         return fail_token("expected punctuator");
@@ -169,7 +208,7 @@ token_t* tokenize_punctuator(preprocessing_token_t* pp_token, tokenizing_setting
     return token;
 }
 
-token_t* tokenize_string_literal(preprocessing_token_t* pp_token, tokenizing_settings_t* settings)
+static token_t* tokenize_string_literal(preprocessing_token_t* pp_token, tokenizing_settings_t* settings, token_t* token)
 {
     if (!pp_token || pp_token->type != PPT_STRING_LITERAL)
         return fail_token("expected string literal");
@@ -188,7 +227,9 @@ token_t* tokenize_string_literal(preprocessing_token_t* pp_token, tokenizing_set
                 warnf("[%s:%d:%d] character in wide string literal out of representable range\n", get_file_name(settings->filepath, false), token->row, token->col);
             buffer_append_wide(buf, (int) value);
         }
-        token->string_literal.value_wide = buffer_export_wide(buf);
+        buffer_append_wide(buf, 0);
+        token->wide = true;
+        token->string_literal_wide = arena_memdup(settings->arena, buf->data, buf->size);
         buffer_delete(buf);
     }
     else
@@ -205,13 +246,14 @@ token_t* tokenize_string_literal(preprocessing_token_t* pp_token, tokenizing_set
                 warnf("[%s:%d:%d] character in string literal out of representable range\n", get_file_name(settings->filepath, false), token->row, token->col);
             buffer_append(buf, (char) value);
         }
-        token->string_literal.value_reg = buffer_export(buf);
+        buffer_append(buf, '\0');
+        token->string_literal = arena_memdup(settings->arena, buf->data, buf->size);
         buffer_delete(buf);
     }
     return token;
 }
 
-token_t* tokenize_pp_number(preprocessing_token_t* pp_token, tokenizing_settings_t* settings)
+static token_t* tokenize_pp_number(preprocessing_token_t* pp_token, tokenizing_settings_t* settings, token_t* token)
 {
     if (!pp_token || pp_token->type != PPT_PP_NUMBER)
         return fail_token("expected preprocessing number");
@@ -220,20 +262,20 @@ token_t* tokenize_pp_number(preprocessing_token_t* pp_token, tokenizing_settings
     if (c != CTC_ERROR)
     {
         init_token(T_INTEGER_CONSTANT);
-        token->integer_constant.class = c;
-        token->integer_constant.value = ivalue;
+        token->class = c;
+        token->integer_constant = ivalue;
         return token;
     }
     long double fvalue = process_floating_constant(pp_token->pp_number, &c);
     if (c == CTC_ERROR)
         return fail_token("expected integer or floating constant");
     init_token(T_FLOATING_CONSTANT);
-    token->floating_constant.class = c;
-    token->floating_constant.value = fvalue;
+    token->class = c;
+    token->floating_constant = arena_memdup(settings->arena, &fvalue, sizeof fvalue);
     return token;
 }
 
-token_t* tokenize_character_constant(preprocessing_token_t* pp_token, tokenizing_settings_t* settings)
+static token_t* tokenize_character_constant(preprocessing_token_t* pp_token, tokenizing_settings_t* settings, token_t* token)
 {
     if (!pp_token || pp_token->type != PPT_CHARACTER_CONSTANT)
         return fail_token("expected character constant");
@@ -245,53 +287,53 @@ token_t* tokenize_character_constant(preprocessing_token_t* pp_token, tokenizing
     if (length > C_TYPE_WCHAR_T_WIDTH * 8)
         return fail_token("character constant value too big for its type");
     init_token(T_CHARACTER_CONSTANT);
-    token->character_constant.value = value;
-    token->character_constant.wide = pp_token->character_constant.wide;
+    token->character_constant = value;
+    token->wide = pp_token->character_constant.wide;
     return token;
 }
 
+// tokens are laid out contiguously and terminated by a T_END token
 token_t* tokenize_sequence(preprocessing_token_t* pp_tokens, preprocessing_token_t* end, tokenizing_settings_t* settings)
 {
-    token_t* head = NULL;
-    token_t* current = NULL;
+    size_t count = 0;
+    for (preprocessing_token_t* pp_token = pp_tokens; pp_token && pp_token != end; pp_token = pp_token->next)
+        ++count;
+    token_t* tokens = arena_alloc(settings->arena, (count + 1) * sizeof *tokens);
+    token_t* slot = tokens;
     for (; pp_tokens && pp_tokens != end; pp_tokens = pp_tokens->next)
     {
         token_t* token = NULL;
         switch (pp_tokens->type)
         {
             case PPT_IDENTIFIER:
-                token = tokenize_identifier(pp_tokens, settings);
+                token = tokenize_identifier(pp_tokens, settings, slot);
                 break;
             case PPT_PUNCTUATOR:
-                token = tokenize_punctuator(pp_tokens, settings);
+                token = tokenize_punctuator(pp_tokens, settings, slot);
                 break;
             case PPT_STRING_LITERAL:
-                token = tokenize_string_literal(pp_tokens, settings);
+                token = tokenize_string_literal(pp_tokens, settings, slot);
                 break;
             case PPT_PP_NUMBER:
-                token = tokenize_pp_number(pp_tokens, settings);
+                token = tokenize_pp_number(pp_tokens, settings, slot);
                 break;
             case PPT_CHARACTER_CONSTANT:
-                token = tokenize_character_constant(pp_tokens, settings);
+                token = tokenize_character_constant(pp_tokens, settings, slot);
                 break;
             // ignore everything else
             default:
                 continue;
         }
         if (!token)
-        {
-            token_delete_all(head);
             return NULL;
-        }
-        if (current)
-            current = current->next = token;
-        else
-            head = current = token;
+        ++slot;
     }
-    return head;
+    slot->type = T_END;
+    return tokens;
 }
 
 // translation phase 7 (part I)
+// the tokens live in settings->arena and are released all at once by deleting it
 token_t* tokenize(preprocessing_token_t* pp_tokens, tokenizing_settings_t* settings)
 {
     return tokenize_sequence(pp_tokens, NULL, settings);
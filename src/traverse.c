@@ -7,14 +7,15 @@
 #define BEFORE trav->before[syn->type] ? trav->before[syn->type](trav, syn) : trav->default_before(trav, syn)
 #define AFTER trav->after[syn->type] ? trav->after[syn->type](trav, syn) : trav->default_after(trav, syn)
 
-static void no_action(syntax_traverser_t* trav, syntax_component_t* syn) {}
+// handlers set to this count as doing nothing, so subtrees made up only of such nodes are skipped
+void traverse_no_action(syntax_traverser_t* trav, syntax_component_t* syn) {}
 
 syntax_traverser_t* traverse_init(syntax_component_t* tlu, size_t size)
 {
     syntax_traverser_t* trav = calloc(1, max(size, sizeof *trav));
     trav->tlu = tlu;
-    trav->default_before = no_action;
-    trav->default_after = no_action;
+    trav->default_before = traverse_no_action;
+    trav->default_after = traverse_no_action;
     return trav;
 }
 
@@ -26,9 +27,24 @@ void traverse_delete(syntax_traverser_t* trav)
 
 #define traverse_vector(trav, v) if (v) { VECTOR_FOR(syntax_component_t*, s, (v)) traverse_syntax(trav, s); }
 
+// a subtree can be skipped if it has been summarized and none of its node types are handled.
+// unsummarized nodes (e.g., #if expressions) have an empty summary and are always visited.
+static bool prunable(syntax_traverser_t* trav, syntax_component_t* syn)
+{
+    bool summarized = false;
+    for (unsigned i = 0; i < SC_SUMMARY_WORDS; ++i)
+    {
+        if (syn->contains[i] & trav->handled[i])
+            return false;
+        summarized = summarized || syn->contains[i];
+    }
+    return summarized;
+}
+
 static void traverse_syntax(syntax_traverser_t* trav, syntax_component_t* syn)
 {
     if (!syn) return;
+    if (prunable(trav, syn)) return;
     BEFORE;
     switch (syn->type)
     {
@@ -452,7 +468,79 @@ static void traverse_syntax(syntax_traverser_t* trav, syntax_component_t* syn)
     AFTER;
 }
 
+static bool handles(traversal_function specific, traversal_function fallback)
+{
+    return (specific ? specific : fallback) != traverse_no_action;
+}
+
 void traverse(syntax_traverser_t* trav)
 {
+    for (unsigned i = 0; i < SC_SUMMARY_WORDS; ++i)
+        trav->handled[i] = 0;
+    for (syntax_component_type_t t = 0; t < SC_NO_ELEMENTS; ++t)
+    {
+        if (handles(trav->before[t], trav->default_before) || handles(trav->after[t], trav->default_after))
+            trav->handled[t / 64] |= 1ULL << (t % 64);
+    }
     return traverse_syntax(trav, trav->tlu);
-}
\ No newline at end of file
+}
+
+typedef struct summarizing_traverser
+{
+    syntax_traverser_t base;
+    vector_t* path;
+} summarizing_traverser_t;
+
+static void summarize_before(syntax_traverser_t* trav, syntax_component_t* syn)
+{
+    vector_add(((summarizing_traverser_t*) trav)->path, syn);
+}
+
+static void summarize_after(syntax_traverser_t* trav, syntax_component_t* syn)
+{
+    vector_t* path = ((summarizing_traverser_t*) trav)->path;
+    vector_pop(path);
+    syn->contains[syn->type / 64] |= 1ULL << (syn->type % 64);
+    // the analyzer turns some identifiers into enumeration constants after this runs
+    if (syn->type == SC_PRIMARY_EXPRESSION_IDENTIFIER)
+        syn->contains[SC_PRIMARY_EXPRESSION_ENUMERATION_CONSTANT / 64] |= 1ULL << (SC_PRIMARY_EXPRESSION_ENUMERATION_CONSTANT % 64);
+    if (!path->size)
+        return;
+    syntax_component_t* parent = vector_peek(path);
+    for (unsigned i = 0; i < SC_SUMMARY_WORDS; ++i)
+        parent->contains[i] |= syn->contains[i];
+}
+
+// records in each node which types of node appear in its subtree, so traversals can skip the parts they have no use for.
+// done once after parsing; the tree's shape must not change afterward.
+void traverse_summarize(syntax_component_t* syn)
+{
+    summarizing_traverser_t* trav = (summarizing_traverser_t*) traverse_init(syn, sizeof(summarizing_traverser_t));
+    trav->base.default_before = summarize_before;
+    trav->base.default_after = summarize_after;
+    trav->path = vector_init();
+    traverse((syntax_traverser_t*) trav);
+    vector_delete(trav->path);
+    traverse_delete((syntax_traverser_t*) trav);
+}
+typedef struct counting_traverser
+{
+    syntax_traverser_t base;
+    size_t count;
+} counting_traverser_t;
+
+static void count_before(syntax_traverser_t* trav, syntax_component_t* syn)
+{
+    ++((counting_traverser_t*) trav)->count;
+}
+
+// how many nodes there are in the tree, for the -t report
+size_t traverse_count(syntax_component_t* syn)
+{
+    counting_traverser_t* trav = (counting_traverser_t*) traverse_init(syn, sizeof(counting_traverser_t));
+    trav->base.default_before = count_before;
+    traverse((syntax_traverser_t*) trav);
+    size_t count = trav->count;
+    traverse_delete((syntax_traverser_t*) trav);
+    return count;
+}
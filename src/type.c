@@ -12,6 +12,8 @@ how types work (mainly so i don't forget):
     the same instance of the struct/union/enum type will be used each time it is needed or used in a derived data structure.
  - in the same manner, type_delete will NOT delete any structs, unions, or enums. these data structures must be deleted with symbol_type_delete, which
     should only be used by the symbol table (because the symbols in the symbol table are the only owners of these types)
+ - interned types (see type_intern) are treated the same way: type_copy hands back the same node and type_delete leaves it alone, since it's shared
+    and owned by the translation unit's symbol table. they must never be modified.
 
 */
 
@@ -25,7 +27,7 @@ c_type_t* make_basic_type(c_type_class_t class)
 c_type_t* type_copy(c_type_t* ct)
 {
     if (!ct) return NULL;
-    if (ct->class == CTC_STRUCTURE || ct->class == CTC_UNION || ct->class == CTC_ENUMERATED)
+    if (ct->interned || ct->class == CTC_STRUCTURE || ct->class == CTC_UNION || ct->class == CTC_ENUMERATED)
         return ct;
     c_type_t* nct = calloc(1, sizeof *nct);
     nct->class = ct->class;
@@ -37,6 +39,9 @@ c_type_t* type_copy(c_type_t* ct)
             nct->array.length_expression = ct->array.length_expression;
             nct->array.length = ct->array.length;
             break;
+        case CTC_VECTOR:
+            nct->array.length = ct->array.length;
+            break;
         case CTC_STRUCTURE:
         case CTC_UNION:
             if (ct->struct_union.name)
@@ -62,9 +67,121 @@ c_type_t* type_copy(c_type_t* ct)
     return nct;
 }
 
+// the parts of an interned type, with everything it's derived from already interned
+static unsigned long interned_type_hash(c_type_t* ct)
+{
+    unsigned long hash = ct->class;
+    hash = hash * 31 + ct->qualifiers;
+    hash = hash * 31 + ct->function_specifiers;
+    hash = hash * 31 + (unsigned long) ct->derived_from;
+    switch (ct->class)
+    {
+        case CTC_ARRAY:
+            hash = hash * 31 + (unsigned long) ct->array.length_expression;
+            hash = hash * 31 + ct->array.unspecified_size;
+            // fallthrough
+        case CTC_VECTOR:
+            hash = hash * 31 + ct->array.length;
+            break;
+        case CTC_FUNCTION:
+            hash = hash * 31 + ct->function.variadic;
+            if (ct->function.param_types)
+            {
+                VECTOR_FOR(c_type_t*, param, ct->function.param_types)
+                    hash = hash * 31 + (unsigned long) param;
+            }
+            break;
+        default:
+            break;
+    }
+    return hash;
+}
+
+static int interned_type_comparator(c_type_t* t1, c_type_t* t2)
+{
+    if (t1->class != t2->class ||
+        t1->qualifiers != t2->qualifiers ||
+        t1->function_specifiers != t2->function_specifiers ||
+        t1->derived_from != t2->derived_from)
+        return 1;
+    switch (t1->class)
+    {
+        case CTC_ARRAY:
+            if (t1->array.length_expression != t2->array.length_expression ||
+                t1->array.unspecified_size != t2->array.unspecified_size)
+                return 1;
+            // fallthrough
+        case CTC_VECTOR:
+            return t1->array.length != t2->array.length;
+        case CTC_FUNCTION:
+        {
+            vector_t* p1 = t1->function.param_types;
+            vector_t* p2 = t2->function.param_types;
+            if (t1->function.variadic != t2->function.variadic || !p1 != !p2)
+                return 1;
+            if (!p1)
+                return 0;
+            if (p1->size != p2->size)
+                return 1;
+            for (unsigned i = 0; i < p1->size; ++i)
+            {
+                if (vector_get(p1, i) != vector_get(p2, i))
+                    return 1;
+            }
+            return 0;
+        }
+        default:
+            return 0;
+    }
+}
+
+/*
+
+hash-consing for types that stop changing once they're made, which is every type in AIR.
+the node given back is shared by every equal type in the translation unit, so it costs
+nothing to copy or delete and checking two of them for equality is a pointer comparison.
+the given type isn't taken, so it's still the caller's to delete.
+
+*/
+c_type_t* type_intern(symbol_table_t* st, c_type_t* ct)
+{
+    if (!ct) return NULL;
+    if (ct->interned || ct->class == CTC_STRUCTURE || ct->class == CTC_UNION || ct->class == CTC_ENUMERATED)
+        return ct;
+    if (!st->interned_types)
+        st->interned_types = map_init((comparator_t) interned_type_comparator, (hash_function_t) interned_type_hash);
+    c_type_t key = *ct;
+    key.derived_from = type_intern(st, ct->derived_from);
+    if (ct->class == CTC_FUNCTION && ct->function.param_types)
+    {
+        key.function.param_types = vector_init();
+        VECTOR_FOR(c_type_t*, param, ct->function.param_types)
+            vector_add(key.function.param_types, type_intern(st, param));
+    }
+    c_type_t* found = map_get(st->interned_types, &key);
+    if (found)
+    {
+        if (ct->class == CTC_FUNCTION)
+            vector_delete(key.function.param_types);
+        return found;
+    }
+    c_type_t* nct = malloc(sizeof *nct);
+    *nct = key;
+    nct->interned = true;
+    map_add(st->interned_types, nct, nct);
+    vector_add(st->unique_types, nct);
+    return nct;
+}
+
+c_type_t* type_intern_basic(symbol_table_t* st, c_type_class_t class)
+{
+    c_type_t ct = { .class = class };
+    return type_intern(st, &ct);
+}
+
 bool type_is_compatible(c_type_t* t1, c_type_t* t2)
 {
-    if (!t1 && !t2) return true;
+    if (t1 == t2) return true;
     if (!t1) return false;
     if (!t2) return false;
     if (t1 == t2) return true;
@@ -419,6 +536,11 @@ bool type_is_sse_floating(c_type_t* ct)
     return type_is_sse_floating_type(ct->class);
 }
 
+bool type_is_vector(c_type_t* ct)
+{
+    return ct && ct->class == CTC_VECTOR;
+}
+
 bool type_is_real_floating_type(c_type_class_t class)
 {
     return class == CTC_FLOAT ||
@@ -590,6 +712,16 @@ c_type_t* make_reference_type(c_type_t* ct)
     return nct;
 }
 
+// a whole SSE register's worth of the given element type, for packed arithmetic
+c_type_t* make_vector_type(c_type_t* element, long long lanes)
+{
+    if (!element) return NULL;
+    c_type_t* nct = make_basic_type(CTC_VECTOR);
+    nct->array.length = lanes;
+    nct->derived_from = type_copy(element);
+    return nct;
+}
+
 c_type_class_t retain_type_domain(c_type_class_t old, c_type_class_t new_real)
 {
     if (old == CTC_FLOAT_COMPLEX ||
@@ -751,16 +883,18 @@ void type_get_struct_union_member_info(c_type_t* ct, char* name, long long* inde
     VECTOR_FOR(c_type_t*, mt, ct->struct_union.member_types)
     {
         char* mn = vector_get(ct->struct_union.member_names, i);
+        long long alignment = type_alignment(mt);
+        // union members all start at the beginning
+        if (offset && ct->class == CTC_STRUCTURE)
+            *offset += (alignment - (*offset % alignment)) % alignment;
         if (streq(mn, name))
         {
             if (index) *index = i;
             return;
         }
-        if (offset)
+        if (offset && ct->class == CTC_STRUCTURE)
         {
             long long size = type_size(mt);
-            long long alignment = type_alignment(mt);
-            *offset += (alignment - (*offset % alignment)) % alignment;
             *offset += size != -1 ? size : 0;
         }
     }
@@ -801,6 +935,7 @@ long long type_alignment(c_type_t* ct)
         case CTC_DOUBLE:
             return 8;
         case CTC_LONG_DOUBLE:
+        case CTC_VECTOR:
             return 16;
         case CTC_POINTER:
         case CTC_FUNCTION:
@@ -872,6 +1007,8 @@ long long type_size(c_type_t* ct)
                 return -1;
             return length * dsize;
         }
+        case CTC_VECTOR:
+            return ct->array.length * type_size(ct->derived_from);
         case CTC_STRUCTURE:
         {
             long long size = 0;
@@ -935,6 +1072,9 @@ void type_humanized_print(c_type_t* ct, int (*printer)(const char*, ...))
                 printer("[%lld]", length);
             printer(" of ");
             break;
+        case CTC_VECTOR:
+            printer("[%lld] of ", ct->array.length);
+            break;
         case CTC_STRUCTURE:
         case CTC_UNION:
             if (ct->struct_union.name)
@@ -973,11 +1113,17 @@ void type_humanized_print(c_type_t* ct, int (*printer)(const char*, ...))
     type_humanized_print(ct->derived_from, printer);
 }
 
-static void type_delete_internal(c_type_t* ct, bool ignore_owned)
+static void type_delete_internal(c_type_t* ct, bool ignore_owned);
+
+// everything the type holds on to, leaving the type itself
+static void type_delete_contents(c_type_t* ct, bool ignore_owned)
 {
-    if (!ct) return;
-    if (ignore_owned && (ct->class == CTC_STRUCTURE || ct->class == CTC_UNION || ct->class == CTC_ENUMERATED))
+    if (ct->interned)
+    {
+        if (ct->class == CTC_FUNCTION)
+            vector_delete(ct->function.param_types);
         return;
+    }
     type_delete_internal(ct->derived_from, ignore_owned);
     switch (ct->class)
     {
@@ -997,6 +1143,15 @@ static void type_delete_internal(c_type_t* ct, bool ignore_owned)
         default:
             break;
     }
+}
+
+static void type_delete_internal(c_type_t* ct, bool ignore_owned)
+{
+    if (!ct) return;
+    // whatever an interned type is derived from is interned too, and gets deleted on its own by the symbol table
+    if (ignore_owned && (ct->interned || ct->class == CTC_STRUCTURE || ct->class == CTC_UNION || ct->class == CTC_ENUMERATED))
+        return;
+    type_delete_contents(ct, ignore_owned);
     free(ct);
 }
 
@@ -1010,6 +1165,15 @@ void symbol_type_delete(c_type_t* ct)
     type_delete_internal(ct, false);
 }
 
+// the types a symbol table owns can be members of each other, so every one of them is emptied before any is freed
+void symbol_types_delete(vector_t* types)
+{
+    if (!types) return;
+    VECTOR_FOR(c_type_t*, ct, types)
+        type_delete_contents(ct, false);
+    vector_deep_delete(types, free);
+}
+
 #define ADD_ERROR(syn, fmt, ...) errors = error_list_add(errors, error_init(syn, false, fmt, ## __VA_ARGS__ ))
 #define ADD_WARNING(syn, fmt, ...) errors = error_list_add(errors, error_init(syn, true, fmt, ## __VA_ARGS__ ))
 
@@ -1926,6 +2090,8 @@ analysis_error_t* type(syntax_component_t* tlu)
     SYMBOL_TABLE_FOR_ENTRIES_END
 
     analysis_error_t* start_errors = errors->next;
+    if (start_errors)
+        start_errors->last = errors->last;
     error_delete(errors);
     return start_errors;
 }
\ No newline at end of file
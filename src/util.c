@@ -3,6 +3,7 @@
 #define _DEFAULT_SOURCE 1
 
 #include <libgen.h>
+#include <unistd.h>
 
 #elif defined(_WIN32) || defined(__CYGWIN__)
 
@@ -18,6 +19,8 @@
 
 #include "ecc.h"
 
+#define TEMP_FILEPATH_TEMPLATE "/tmp/eccXXXXXX"
+
 #define max(x, y) ((x) > (y) ? (x) : (y))
 
 const bool debug_m = true;
@@ -259,39 +262,6 @@ int contains(void** array, unsigned length, void* el, int (*c)(void*, void*))
     return -1;
 }
 
-char* qb = NULL;
-size_t qb_size = 0;
-size_t qb_offset = 0;
-
-int quickbuffer_printf(const char* fmt, ...)
-{
-    if (!qb) return -1;
-    va_list args;
-    va_start(args, fmt);
-    int i = qb_offset += vsnprintf(qb + qb_offset, qb_size - qb_offset, fmt, args);
-    va_end(args);
-    return i;
-}
-
-void quickbuffer_setup(size_t size)
-{
-    qb = malloc(qb_size = size);
-    qb_offset = 0;
-}
-
-void quickbuffer_release(void)
-{
-    free(qb);
-    qb = NULL;
-    qb_size = 0;
-    qb_offset = 0;
-}
-
-char* quickbuffer(void)
-{
-    return qb;
-}
-
 // gets the actual value hex value for a char 0-9 or A-F or a-f
 int hexadecimal_digit_value(int c)
 {
@@ -330,22 +300,20 @@ unsigned get_universal_character_utf8_encoding(unsigned value)
     return 0;
 }
 
+// the file is created so the name can't be handed out again, even to a concurrent compilation
 char* temp_filepath_gen(char* ext)
 {
-    char* cs = "1234567890qwertyuiopasdfghjklzxcvbnmQWERTYUIOPASDFGHJKLZXCVBNM";
     size_t extlen = strlen(ext);
-    size_t pathlen = 5 + 32 + extlen + 1;
+    size_t pathlen = strlen(TEMP_FILEPATH_TEMPLATE) + extlen + 1;
     char* filepath = malloc(pathlen);
-    filepath[0] = '/';
-    filepath[1] = 't';
-    filepath[2] = 'm';
-    filepath[3] = 'p';
-    filepath[4] = '/';
-    for (int i = 0; i < 32; ++i)
-        filepath[i + 5] = cs[rand() % 62];
-    for (int i = 0; i < extlen; ++i)
-        filepath[37 + i] = ext[i];
-    filepath[pathlen - 1] = '\0';
+    snprintf(filepath, pathlen, "%s%s", TEMP_FILEPATH_TEMPLATE, ext);
+    int fd = mkstemps(filepath, extlen);
+    if (fd == -1)
+    {
+        free(filepath);
+        return NULL;
+    }
+    close(fd);
     return filepath;
 }
 
@@ -359,6 +327,17 @@ unsigned long regid_hash(regid_t x)
     return (unsigned long) x;
 }
 
+// for maps keyed by identity, like instructions
+int pointer_comparator(void* a, void* b)
+{
+    return a != b;
+}
+
+unsigned long pointer_hash(void* p)
+{
+    return (unsigned long) p >> 4;
+}
+
 int regid_print(regid_t reg, int (*printer)(const char*, ...))
 {
     if (reg > NO_PHYSICAL_REGISTERS)
@@ -127,3 +127,41 @@ void vector_merge(vector_t* v, vector_t* u, int (*c)(void*, void*))
     for (unsigned i = 0; i < u->size; ++i)
         vector_add_if_new(v, vector_get(u, i), c);
 }
+
+void svector_add(svector_t* v, uint64_t el)
+{
+    if (v->size == v->capacity)
+    {
+        if (!v->capacity)
+        {
+            v->data = v->inline_data;
+            v->capacity = SVECTOR_INLINE;
+        }
+        else if (v->data == v->inline_data)
+        {
+            v->data = malloc(v->capacity * 2 * sizeof(uint64_t));
+            memcpy(v->data, v->inline_data, v->size * sizeof(uint64_t));
+            v->capacity *= 2;
+        }
+        else
+            v->data = realloc(v->data, (v->capacity *= 2) * sizeof(uint64_t));
+    }
+    v->data[v->size++] = el;
+}
+
+void svector_add_if_new(svector_t* v, uint64_t el)
+{
+    for (unsigned i = 0; i < v->size; ++i)
+        if (v->data[i] == el)
+            return;
+    svector_add(v, el);
+}
+
+// frees what it allocated, leaving it empty
+void svector_free(svector_t* v)
+{
+    if (v->data != v->inline_data)
+        free(v->data);
+    v->data = NULL;
+    v->capacity = v->size = 0;
+}
@@ -47,6 +47,13 @@ void x86_asm_init_address_delete(x86_asm_init_address_t* ia)
     free(ia);
 }
 
+static void x86_asm_alias_delete(x86_asm_alias_t* alias)
+{
+    if (!alias) return;
+    free(alias->label);
+    free(alias);
+}
+
 const char* register_name(regid_t reg, x86_insn_size_t size)
 {
     if (x86_64_is_sse_register(reg))
@@ -149,6 +156,7 @@ void x86_asm_data_delete(x86_asm_data_t* data)
     if (!data) return;
     free(data->data);
     vector_deep_delete(data->addresses, (deleter_t) x86_asm_init_address_delete);
+    vector_deep_delete(data->aliases, (deleter_t) x86_asm_alias_delete);
     free(data->label);
     free(data);
 }
@@ -157,7 +165,9 @@ void x86_asm_routine_delete(x86_asm_routine_t* routine)
 {
     if (!routine) return;
     free(routine->label);
+    free(routine->cold_label);
     x86_insn_delete_all(routine->insns);
+    vector_deep_delete(routine->rodata, (deleter_t) x86_asm_data_delete);
     free(routine);
 }
 
@@ -166,17 +176,20 @@ void x86_asm_file_delete(x86_asm_file_t* file)
     if (!file) return;
     vector_deep_delete(file->data, (deleter_t) x86_asm_data_delete);
     vector_deep_delete(file->rodata, (deleter_t) x86_asm_data_delete);
+    vector_deep_delete(file->profile, (deleter_t) x86_asm_data_delete);
     vector_deep_delete(file->routines, (deleter_t) x86_asm_routine_delete);
+    x86_asm_file_discard_elf(file);
     free(file);
 }
 
-static char* x86_asm_file_create_next_label(x86_asm_file_t* file)
+// numbered within the routine so that they don't depend on the order routines are generated in
+static char* x86_asm_routine_create_next_label(x86_asm_routine_t* routine)
 {
-    if (!file) return NULL;
-    // .LGEN(num)\0
-    size_t length = 5 + 1 + MAX_STRINGIFIED_INTEGER_LENGTH;
+    if (!routine) return NULL;
+    // .LGEN(routine)_(num)\0
+    size_t length = 5 + 2 * MAX_STRINGIFIED_INTEGER_LENGTH + 2;
     char* str = malloc(length);
-    snprintf(str, length, ".LGEN%lu", ++(file->next_constant_local_label));
+    snprintf(str, length, ".LGEN%lu_%lu", routine->id, ++(routine->next_constant_local_label));
     return str;
 }
 
@@ -235,10 +248,19 @@ bool x86_insn_uses_suffix(x86_insn_t* insn)
         case X86I_LEAVE:
         case X86I_RET:
         case X86I_JMP:
+        case X86I_TAIL_JMP:
         case X86I_JE:
         case X86I_JNE:
         case X86I_JNB:
         case X86I_JS:
+        case X86I_JL:
+        case X86I_JLE:
+        case X86I_JG:
+        case X86I_JGE:
+        case X86I_JA:
+        case X86I_JB:
+        case X86I_JBE:
+        case X86I_JP:
         case X86I_CMP:
         case X86I_SETE:
         case X86I_SETNE:
@@ -267,6 +289,8 @@ bool x86_insn_uses_suffix(x86_insn_t* insn)
         case X86I_SKIP:
         case X86I_SETA:
         case X86I_SETNB:
+        case X86I_SETB:
+        case X86I_SETBE:
         case X86I_SETP:
         case X86I_SETNP:
         case X86I_CVTTSD2SI:
@@ -298,6 +322,22 @@ bool x86_insn_uses_suffix(x86_insn_t* insn)
         case X86I_STC:
         case X86I_REP_STOSB:
         case X86I_SYSCALL:
+        case X86I_CQTO:
+        case X86I_MOVUPS:
+        case X86I_MOVUPD:
+        case X86I_MOVDQU:
+        case X86I_ADDPS:
+        case X86I_ADDPD:
+        case X86I_PADDD:
+        case X86I_PADDQ:
+        case X86I_SUBPS:
+        case X86I_SUBPD:
+        case X86I_PSUBD:
+        case X86I_PSUBQ:
+        case X86I_MULPS:
+        case X86I_MULPD:
+        case X86I_DIVPS:
+        case X86I_DIVPD:
             return false;
     }
     return true;
@@ -321,10 +361,19 @@ uint8_t x86_insn_writes(x86_insn_t* insn)
         case X86I_LEAVE:
         case X86I_RET:
         case X86I_JMP:
+        case X86I_TAIL_JMP:
         case X86I_JE:
         case X86I_JNE:
         case X86I_JNB:
         case X86I_JS:
+        case X86I_JL:
+        case X86I_JLE:
+        case X86I_JG:
+        case X86I_JGE:
+        case X86I_JA:
+        case X86I_JB:
+        case X86I_JBE:
+        case X86I_JP:
         case X86I_CMP:
         case X86I_COMISS:
         case X86I_COMISD:
@@ -337,6 +386,7 @@ uint8_t x86_insn_writes(x86_insn_t* insn)
         case X86I_STC:
         case X86I_REP_STOSB:
         case X86I_SYSCALL:
+        case X86I_CQTO:
             return 0;
         case X86I_POP:
         case X86I_SETE:
@@ -347,6 +397,8 @@ uint8_t x86_insn_writes(x86_insn_t* insn)
         case X86I_SETG:
         case X86I_SETA:
         case X86I_SETNB:
+        case X86I_SETB:
+        case X86I_SETBE:
         case X86I_SETP:
         case X86I_SETNP:
         case X86I_NOT:
@@ -387,6 +439,21 @@ uint8_t x86_insn_writes(x86_insn_t* insn)
         case X86I_CVTSI2SD:
         case X86I_CVTTSS2SI:
         case X86I_CVTTSD2SI:
+        case X86I_MOVUPS:
+        case X86I_MOVUPD:
+        case X86I_MOVDQU:
+        case X86I_ADDPS:
+        case X86I_ADDPD:
+        case X86I_PADDD:
+        case X86I_PADDQ:
+        case X86I_SUBPS:
+        case X86I_SUBPD:
+        case X86I_PSUBD:
+        case X86I_PSUBQ:
+        case X86I_MULPS:
+        case X86I_MULPD:
+        case X86I_DIVPS:
+        case X86I_DIVPD:
             return X86_INSN_WRITES_OP2;
     }
     return 0;
@@ -405,9 +472,55 @@ x86_insn_size_t c_type_to_x86_operand_size(c_type_t* ct)
     }
 }
 
+/*
+
+the text writer runs once per instruction and operand, so it avoids fprintf: integers are converted by hand and
+everything else goes out with fputs/putc into the stream's buffer. write_assembly gives that stream a large
+buffer, so a whole file leaves in a handful of write calls.
+
+*/
+
+static void write_unsigned(unsigned long long value, FILE* file)
+{
+    char digits[MAX_STRINGIFIED_INTEGER_LENGTH];
+    char* end = digits + sizeof(digits);
+    char* start = end;
+    *--start = '\0';
+    do
+        *--start = '0' + value % 10;
+    while (value /= 10);
+    fputs(start, file);
+}
+
+static void write_signed(long long value, FILE* file)
+{
+    if (value < 0)
+    {
+        putc('-', file);
+        write_unsigned(-(unsigned long long) value, file);
+    }
+    else
+        write_unsigned(value, file);
+}
+
+// uppercase, with a 0x in front, like %X used to produce
+static void write_hex(unsigned long long value, FILE* file)
+{
+    char digits[2 + 2 * sizeof(value) + 1];
+    char* start = digits + sizeof(digits);
+    *--start = '\0';
+    do
+        *--start = "0123456789ABCDEF"[value & 0xF];
+    while (value >>= 4);
+    *--start = 'x';
+    *--start = '0';
+    fputs(start, file);
+}
+
 void x86_write_register(regid_t reg, x86_insn_size_t size, FILE* file)
 {
-    fprintf(file, "%%%s", register_name(reg, size));
+    putc('%', file);
+    fputs(register_name(reg, size), file);
 }
 
 void x86_write_operand(x86_operand_t* op, x86_insn_size_t size, FILE* file)
@@ -419,46 +532,51 @@ void x86_write_operand(x86_operand_t* op, x86_insn_size_t size, FILE* file)
             x86_write_register(op->reg, op->size ? op->size : size, file);
             break;
         case X86OP_PTR_REGISTER:
-            fprintf(file, "*");
+            putc('*', file);
             x86_write_register(op->reg, op->size ? op->size : size, file);
             break;
         case X86OP_DEREF_REGISTER:
             if (op->deref_reg.offset != 0)
-                fprintf(file, "%lld", op->deref_reg.offset);
-            fprintf(file, "(");
+                write_signed(op->deref_reg.offset, file);
+            putc('(', file);
             x86_write_register(op->deref_reg.reg_addr, X86SZ_QWORD, file);
-            fprintf(file, ")");
+            putc(')', file);
             break;
         case X86OP_ARRAY:
             if (op->array.offset != 0)
-                fprintf(file, "%lld", op->array.offset);
-            fprintf(file, "(");
+                write_signed(op->array.offset, file);
+            putc('(', file);
             if (op->array.reg_base != INVALID_VREGID)
                 x86_write_register(op->array.reg_base, X86SZ_QWORD, file);
-            fprintf(file, ", ");
+            fputs(", ", file);
             if (op->array.reg_offset != INVALID_VREGID)
                 x86_write_register(op->array.reg_offset, X86SZ_QWORD, file);
-            fprintf(file, ", %lld)", op->array.scale);
+            fputs(", ", file);
+            write_signed(op->array.scale, file);
+            putc(')', file);
             break;
         case X86OP_LABEL:
-            fprintf(file, "%s", op->label);
+            fputs(op->label, file);
             break;
         case X86OP_TEXT:
-            fprintf(file, "%s", op->text);
+            fputs(op->text, file);
             break;
         case X86OP_STRING:
-            fprintf(file, "\"%s\"", op->string);
+            putc('"', file);
+            fputs(op->string, file);
+            putc('"', file);
             break;
         case X86OP_LABEL_REF:
+            fputs(op->label_ref.label, file);
             if (op->label_ref.offset > 0)
-                fprintf(file, "%s+%lld(%%rip)", op->label_ref.label, op->label_ref.offset);
-            else if (op->label_ref.offset < 0)
-                fprintf(file, "%s-%lld(%%rip)", op->label_ref.label, llabs(op->label_ref.offset));
-            else
-                fprintf(file, "%s(%%rip)", op->label_ref.label);
+                putc('+', file);
+            if (op->label_ref.offset != 0)
+                write_signed(op->label_ref.offset, file);
+            fputs("(%rip)", file);
             break;
         case X86OP_IMMEDIATE:
-            fprintf(file, "$%llu", op->immediate);
+            putc('$', file);
+            write_unsigned(op->immediate, file);
             break;
         default:
             break;
@@ -469,121 +587,172 @@ void x86_write_insn(x86_insn_t* insn, FILE* file)
 {
     if (!insn) return;
     #define INDENT "    "
-    char suffix[32];
+    char suffix[3] = { ' ', '\0', '\0' };
     if (x86_insn_uses_suffix(insn))
-        snprintf(suffix, 32, "%c", x86_operand_size_character(insn->size));
-    else
-        suffix[0] = '\0';
-    #define USUAL_START(name) fprintf(file, INDENT name "%s ", suffix)
+        suffix[0] = x86_operand_size_character(insn->size), suffix[1] = ' ';
+    #define USUAL_START(name) (fputs(INDENT name, file), fputs(suffix, file))
     #define USUAL_1OP(name) USUAL_START(name); goto op1;
     #define USUAL_2OP(name) USUAL_START(name); goto op2;
     switch (insn->type)
     {
         case X86I_LABEL:
-            fprintf(file, "%s:", insn->op1->label);
+            fputs(insn->op1->label, file);
+            putc(':', file);
             break;
         
         case X86I_LEAVE:
-            fprintf(file, INDENT "leave");
+            fputs(INDENT "leave", file);
             break;
 
         case X86I_RET:
-            fprintf(file, INDENT "ret");
+            fputs(INDENT "ret", file);
             break;
 
         case X86I_STC:
-            fprintf(file, INDENT "stc");
+            fputs(INDENT "stc", file);
             break;
 
         case X86I_NOP:
-            fprintf(file, INDENT "nop");
+            fputs(INDENT "nop", file);
             break;
 
         case X86I_SYSCALL:
-            fprintf(file, INDENT "syscall");
+            fputs(INDENT "syscall", file);
             break;
         
         case X86I_CALL:
-            fprintf(file, INDENT "call ");
+            fputs(INDENT "call ", file);
             x86_write_operand(insn->op1, X86SZ_QWORD, file);
             break;
 
         case X86I_JMP:
-            fprintf(file, INDENT "jmp ");
+        case X86I_TAIL_JMP:
+            fputs(INDENT "jmp ", file);
             x86_write_operand(insn->op1, X86SZ_QWORD, file);
             break;
 
         case X86I_JE:
-            fprintf(file, INDENT "je ");
+            fputs(INDENT "je ", file);
             x86_write_operand(insn->op1, X86SZ_QWORD, file);
             break;
 
         case X86I_JNE:
-            fprintf(file, INDENT "jne ");
+            fputs(INDENT "jne ", file);
             x86_write_operand(insn->op1, X86SZ_QWORD, file);
             break;
 
         case X86I_JNB:
-            fprintf(file, INDENT "jnb ");
+            fputs(INDENT "jnb ", file);
             x86_write_operand(insn->op1, X86SZ_QWORD, file);
             break;
 
         case X86I_JS:
-            fprintf(file, INDENT "js ");
+            fputs(INDENT "js ", file);
+            x86_write_operand(insn->op1, X86SZ_QWORD, file);
+            break;
+
+        case X86I_JL:
+            fputs(INDENT "jl ", file);
+            x86_write_operand(insn->op1, X86SZ_QWORD, file);
+            break;
+
+        case X86I_JLE:
+            fputs(INDENT "jle ", file);
+            x86_write_operand(insn->op1, X86SZ_QWORD, file);
+            break;
+
+        case X86I_JG:
+            fputs(INDENT "jg ", file);
+            x86_write_operand(insn->op1, X86SZ_QWORD, file);
+            break;
+
+        case X86I_JGE:
+            fputs(INDENT "jge ", file);
+            x86_write_operand(insn->op1, X86SZ_QWORD, file);
+            break;
+
+        case X86I_JA:
+            fputs(INDENT "ja ", file);
+            x86_write_operand(insn->op1, X86SZ_QWORD, file);
+            break;
+
+        case X86I_JB:
+            fputs(INDENT "jb ", file);
+            x86_write_operand(insn->op1, X86SZ_QWORD, file);
+            break;
+
+        case X86I_JBE:
+            fputs(INDENT "jbe ", file);
+            x86_write_operand(insn->op1, X86SZ_QWORD, file);
+            break;
+
+        case X86I_JP:
+            fputs(INDENT "jp ", file);
             x86_write_operand(insn->op1, X86SZ_QWORD, file);
             break;
 
         case X86I_SETE:
-            fprintf(file, INDENT "sete ");
+            fputs(INDENT "sete ", file);
             x86_write_operand(insn->op1, X86SZ_BYTE, file);
             break;
 
         case X86I_SETNE:
-            fprintf(file, INDENT "setne ");
+            fputs(INDENT "setne ", file);
             x86_write_operand(insn->op1, X86SZ_BYTE, file);
             break;
 
         case X86I_SETLE:
-            fprintf(file, INDENT "setle ");
+            fputs(INDENT "setle ", file);
             x86_write_operand(insn->op1, X86SZ_BYTE, file);
             break;
 
         case X86I_SETL:
-            fprintf(file, INDENT "setl ");
+            fputs(INDENT "setl ", file);
             x86_write_operand(insn->op1, X86SZ_BYTE, file);
             break;
 
         case X86I_SETGE:
-            fprintf(file, INDENT "setge ");
+            fputs(INDENT "setge ", file);
             x86_write_operand(insn->op1, X86SZ_BYTE, file);
             break;
 
         case X86I_SETG:
-            fprintf(file, INDENT "setg ");
+            fputs(INDENT "setg ", file);
             x86_write_operand(insn->op1, X86SZ_BYTE, file);
             break;
         
         case X86I_SETA:
-            fprintf(file, INDENT "seta ");
+            fputs(INDENT "seta ", file);
             x86_write_operand(insn->op1, X86SZ_BYTE, file);
             break;
 
         case X86I_SETNB:
-            fprintf(file, INDENT "setnb ");
+            fputs(INDENT "setnb ", file);
+            x86_write_operand(insn->op1, X86SZ_BYTE, file);
+            break;
+
+        case X86I_SETB:
+            fputs(INDENT "setb ", file);
+            x86_write_operand(insn->op1, X86SZ_BYTE, file);
+            break;
+
+        case X86I_SETBE:
+            fputs(INDENT "setbe ", file);
             x86_write_operand(insn->op1, X86SZ_BYTE, file);
             break;
 
         case X86I_SETP:
-            fprintf(file, INDENT "setp ");
+            fputs(INDENT "setp ", file);
             x86_write_operand(insn->op1, X86SZ_BYTE, file);
             break;
 
         case X86I_SETNP:
-            fprintf(file, INDENT "setnp ");
+            fputs(INDENT "setnp ", file);
             x86_write_operand(insn->op1, X86SZ_BYTE, file);
             break;
         
         case X86I_PUSH: USUAL_1OP("push")
+        case X86I_POP: USUAL_1OP("pop")
         case X86I_NEG: USUAL_1OP("neg")
 
         case X86I_MOV: USUAL_2OP("mov")
@@ -637,35 +806,55 @@ void x86_write_insn(x86_insn_t* insn, FILE* file)
         case X86I_TEST: USUAL_2OP("test")
         case X86I_PTEST: USUAL_2OP("ptest")
 
+        case X86I_MOVUPS: USUAL_2OP("movups")
+        case X86I_MOVUPD: USUAL_2OP("movupd")
+        case X86I_MOVDQU: USUAL_2OP("movdqu")
+        case X86I_ADDPS: USUAL_2OP("addps")
+        case X86I_ADDPD: USUAL_2OP("addpd")
+        case X86I_PADDD: USUAL_2OP("paddd")
+        case X86I_PADDQ: USUAL_2OP("paddq")
+        case X86I_SUBPS: USUAL_2OP("subps")
+        case X86I_SUBPD: USUAL_2OP("subpd")
+        case X86I_PSUBD: USUAL_2OP("psubd")
+        case X86I_PSUBQ: USUAL_2OP("psubq")
+        case X86I_MULPS: USUAL_2OP("mulps")
+        case X86I_MULPD: USUAL_2OP("mulpd")
+        case X86I_DIVPS: USUAL_2OP("divps")
+        case X86I_DIVPD: USUAL_2OP("divpd")
+
         case X86I_REP_STOSB:
-            fprintf(file, INDENT "rep stosb");
+            fputs(INDENT "rep stosb", file);
+            break;
+
+        case X86I_CQTO:
+            fputs(insn->size == X86SZ_QWORD ? INDENT "cqto" : INDENT "cltd", file);
             break;
 
         case X86I_SHL:
             USUAL_START("shl");
             x86_write_operand(insn->op1, X86SZ_BYTE, file);
-            fprintf(file, ", ");
+            fputs(", ", file);
             x86_write_operand(insn->op2, insn->size, file);
             break;
         
         case X86I_SHR:
             USUAL_START("shr");
             x86_write_operand(insn->op1, X86SZ_BYTE, file);
-            fprintf(file, ", ");
+            fputs(", ", file);
             x86_write_operand(insn->op2, insn->size, file);
             break;
 
         case X86I_SAR:
             USUAL_START("sar");
             x86_write_operand(insn->op1, X86SZ_BYTE, file);
-            fprintf(file, ", ");
+            fputs(", ", file);
             x86_write_operand(insn->op2, insn->size, file);
             break;
 
         case X86I_ROR:
             USUAL_START("ror");
             x86_write_operand(insn->op1, X86SZ_BYTE, file);
-            fprintf(file, ", ");
+            fputs(", ", file);
             x86_write_operand(insn->op2, insn->size, file);
             break;
 
@@ -675,7 +864,7 @@ void x86_write_insn(x86_insn_t* insn, FILE* file)
         
         op2:
             x86_write_operand(insn->op1, insn->size, file);
-            fprintf(file, ", ");
+            fputs(", ", file);
             x86_write_operand(insn->op2, insn->size, file);
             break;
 
@@ -688,15 +877,40 @@ void x86_write_insn(x86_insn_t* insn, FILE* file)
     #undef USUAL_START
     #undef USUAL_1OP
     #undef USUAL_2OP
-    fprintf(file, "\n");
+    putc('\n', file);
+}
+
+static void write_directive(const char* directive, const char* label, FILE* out)
+{
+    fputs(directive, out);
+    fputs(label, out);
+    putc('\n', out);
+}
+
+static void write_hex_directive(const char* directive, unsigned long long value, FILE* out)
+{
+    fputs(directive, out);
+    write_hex(value, out);
+    putc('\n', out);
 }
 
 void x86_write_data(x86_asm_data_t* data, FILE* out)
 {
-    fprintf(out, "    .align %lu\n", data->alignment);
-    fprintf(out, "%s:\n", data->label);
-    for (size_t i = 0, j = 0; i < data->length;)
+    if (data->global)
+        write_directive("    .globl ", data->label, out);
+    fputs("    .align ", out);
+    write_unsigned(data->alignment, out);
+    putc('\n', out);
+    fputs(data->label, out);
+    fputs(":\n", out);
+    for (size_t i = 0, j = 0, k = 0; i < data->length;)
     {
+        // the constants pooled into this one are labeled where they start in it
+        for (; data->aliases && k < data->aliases->size && ((x86_asm_alias_t*) vector_get(data->aliases, k))->offset == i; ++k)
+        {
+            fputs(((x86_asm_alias_t*) vector_get(data->aliases, k))->label, out);
+            fputs(":\n", out);
+        }
         if (data->addresses && j < data->addresses->size)
         {
             x86_asm_init_address_t* ia = vector_get(data->addresses, j);
@@ -706,25 +920,43 @@ void x86_write_data(x86_asm_data_t* data, FILE* out)
                 int64_t offset = *((int64_t*) (data->data + ia->data_location));
                 if (ia->label)
                 {
+                    fputs("    .quad ", out);
+                    fputs(ia->label, out);
+                    if (offset > 0)
+                        putc('+', out);
                     if (offset != 0)
-                        fprintf(out, "    .quad %s%c%lld\n", ia->label, offset < 0 ? '-' : '+', llabs(offset));
-                    else
-                        fprintf(out, "    .quad %s\n", ia->label);
+                        write_signed(offset, out);
+                    putc('\n', out);
                 }
                 else
-                    fprintf(out, "    .quad 0x%lX\n", offset);
+                    write_hex_directive("    .quad ", offset, out);
                 i += POINTER_WIDTH;
                 continue;
             }
         }
-        if (i + UNSIGNED_LONG_LONG_INT_WIDTH <= data->length)
-            fprintf(out, "    .quad 0x%llX\n", *((unsigned long long*) (data->data + i))), i += UNSIGNED_LONG_LONG_INT_WIDTH;
-        else if (i + UNSIGNED_INT_WIDTH <= data->length)
-            fprintf(out, "    .long 0x%X\n", *((unsigned*) (data->data + i))), i += UNSIGNED_INT_WIDTH;
-        else if (i + UNSIGNED_SHORT_INT_WIDTH <= data->length)
-            fprintf(out, "    .word 0x%X\n", *((unsigned short*) (data->data + i))), i += UNSIGNED_SHORT_INT_WIDTH;
+        // long stretches of zeros, like buffers, are written all at once
+        size_t end = data->addresses && j < data->addresses->size ?
+            ((x86_asm_init_address_t*) vector_get(data->addresses, j))->data_location : data->length;
+        if (data->aliases && k < data->aliases->size)
+            end = min(end, ((x86_asm_alias_t*) vector_get(data->aliases, k))->offset);
+        size_t zeros = 0;
+        for (; i + zeros < end && !data->data[i + zeros]; ++zeros);
+        if (zeros >= 2 * UNSIGNED_LONG_LONG_INT_WIDTH)
+        {
+            fputs("    .zero ", out);
+            write_unsigned(zeros, out);
+            putc('\n', out);
+            i += zeros;
+            continue;
+        }
+        if (i + UNSIGNED_LONG_LONG_INT_WIDTH <= end)
+            write_hex_directive("    .quad ", *((unsigned long long*) (data->data + i)), out), i += UNSIGNED_LONG_LONG_INT_WIDTH;
+        else if (i + UNSIGNED_INT_WIDTH <= end)
+            write_hex_directive("    .long ", *((unsigned*) (data->data + i)), out), i += UNSIGNED_INT_WIDTH;
+        else if (i + UNSIGNED_SHORT_INT_WIDTH <= end)
+            write_hex_directive("    .word ", *((unsigned short*) (data->data + i)), out), i += UNSIGNED_SHORT_INT_WIDTH;
         else
-            fprintf(out, "    .byte 0x%X\n", *((unsigned char*) (data->data + i))), i += UNSIGNED_CHAR_WIDTH;
+            write_hex_directive("    .byte ", *((unsigned char*) (data->data + i)), out), i += UNSIGNED_CHAR_WIDTH;
     }
 }
 
@@ -732,8 +964,7 @@ static void x86_write_varargs_setup(x86_asm_routine_t* routine, FILE* out)
 {
     fprintf(out, "    movq %%r9, -8(%%rbp)\n");
     fprintf(out, "    movq %%r8, -16(%%rbp)\n");
-    fprintf(out, "    movq %%rcx, -16(%%rbp)\n");
-    fprintf(out, "    movq %%rdx, -24(%%rbp)\n");
+    fprintf(out, "    movq %%rcx, -24(%%rbp)\n");
     fprintf(out, "    movq %%rdx, -32(%%rbp)\n");
     fprintf(out, "    movq %%rsi, -40(%%rbp)\n");
     fprintf(out, "    movq %%rdi, -48(%%rbp)\n");
@@ -747,46 +978,24 @@ static void x86_write_varargs_setup(x86_asm_routine_t* routine, FILE* out)
     fprintf(out, "    movaps %%xmm0, -176(%%rbp)\n");
 }
 
-static void x86_find_used_nonvolatiles(x86_asm_routine_t* routine)
-{
-    for (x86_insn_t* insn = routine->insns; insn; insn = insn->next)
-    {
-        uint8_t writes = x86_insn_writes(insn);
-        x86_operand_t* ops[] = { insn->op1, insn->op2, insn->op3 };
-        static uint8_t write_states[] = { X86_INSN_WRITES_OP1, X86_INSN_WRITES_OP2, X86_INSN_WRITES_OP3 };
-        for (size_t i = 0; i < 3; ++i)
-        {
-            if (!ops[i]) continue;
-            if ((writes & write_states[i]) && ops[i]->type == X86OP_REGISTER)
-            {
-                switch (insn->op1->reg)
-                {
-                    case X86R_RBX: routine->used_nonvolatiles |= USED_NONVOLATILES_RBX; break;
-                    case X86R_R12: routine->used_nonvolatiles |= USED_NONVOLATILES_R12; break;
-                    case X86R_R13: routine->used_nonvolatiles |= USED_NONVOLATILES_R13; break;
-                    case X86R_R14: routine->used_nonvolatiles |= USED_NONVOLATILES_R14; break;
-                    case X86R_R15: routine->used_nonvolatiles |= USED_NONVOLATILES_R15; break;
-                    default: break;
-                }
-            }
-        }
-    }
-}
-
 static uint16_t NONVOLATILE_FLAGS[] = {
     USED_NONVOLATILES_RBX,
     USED_NONVOLATILES_R12,
     USED_NONVOLATILES_R13,
     USED_NONVOLATILES_R14,
-    USED_NONVOLATILES_R15
+    USED_NONVOLATILES_R15,
+    USED_NONVOLATILES_RBP
 };
 
+static const regid_t NONVOLATILE_REGISTERS[] = { X86R_RBX, X86R_R12, X86R_R13, X86R_R14, X86R_R15, X86R_RBP };
+
 static const char* NONVOLATILE_REGISTER_NAMES[] = {
     "rbx",
     "r12",
     "r13",
     "r14",
-    "r15"
+    "r15",
+    "rbp"
 };
 
 static void x86_write_routine_push_nonvolatiles(x86_asm_routine_t* routine, FILE* out)
@@ -798,6 +1007,139 @@ static void x86_write_routine_push_nonvolatiles(x86_asm_routine_t* routine, FILE
     }
 }
 
+// counts the nonvolatiles pushed in the body too, so the stack is aligned at calls after them
+static long long x86_routine_pushed_size(x86_asm_routine_t* routine)
+{
+    long long pushed = 0;
+    for (int i = 0; i < sizeof(NONVOLATILE_FLAGS) / sizeof(NONVOLATILE_FLAGS[0]); ++i)
+    {
+        if ((routine->used_nonvolatiles | routine->wrapped_nonvolatiles) & NONVOLATILE_FLAGS[i])
+            pushed += UNSIGNED_LONG_LONG_INT_WIDTH;
+    }
+    return pushed;
+}
+
+// the stack space to reserve below the frame pointer. the nonvolatiles are pushed below it, and calls need the
+// stack 16-byte aligned after all of that. with nothing pushed, the outgoing argument area is just the bottom of it
+long long x86_routine_frame_size(x86_asm_routine_t* routine)
+{
+    long long pushed = x86_routine_pushed_size(routine);
+    long long v = llabs(routine->stackalloc) + pushed;
+    v += (16 - (v % 16)) % 16 - pushed;
+    return pushed ? v : v + routine->outgoing;
+}
+
+// the space reserved for the outgoing argument area below the pushed nonvolatiles, if there are any
+long long x86_routine_outgoing_size(x86_asm_routine_t* routine)
+{
+    return x86_routine_pushed_size(routine) ? routine->outgoing : 0;
+}
+
+static bool x86_operand_uses_register(x86_operand_t* op, regid_t reg)
+{
+    if (!op) return false;
+    switch (op->type)
+    {
+        case X86OP_REGISTER:
+        case X86OP_PTR_REGISTER:
+            return op->reg == reg;
+        case X86OP_DEREF_REGISTER:
+            return op->deref_reg.reg_addr == reg;
+        case X86OP_ARRAY:
+            return op->array.reg_base == reg || op->array.reg_offset == reg;
+        default:
+            return false;
+    }
+}
+
+static bool x86_routine_calls(x86_asm_routine_t* routine)
+{
+    for (x86_insn_t* insn = routine->insns; insn; insn = insn->next)
+    {
+        if (insn->type == X86I_CALL)
+            return true;
+    }
+    return false;
+}
+
+/*
+
+a routine gets the usual %rbp frame unless it can do without one. a leaf that keeps nothing on the stack and doesn't
+read its caller's frame needs none at all. a routine compiled with -F addresses its locals from %rsp instead and is
+free to allocate %rbp, which is then saved like the other nonvolatiles:
+
+    pushq %rbx
+    subq $24, %rsp
+    ...
+    movl %eax, 12(%rsp)
+    ...
+    addq $24, %rsp
+    popq %rbx
+    ret
+
+a leaf with no more than the 128 bytes below %rsp the ABI leaves alone doesn't even move %rsp. otherwise the amount
+keeps %rsp 16-byte aligned at calls.
+
+*/
+
+#define X86_64_RED_ZONE_SIZE 128
+
+bool x86_routine_uses_frame_pointer(x86_asm_routine_t* routine)
+{
+    if (routine->omits_frame_pointer)
+        return false;
+    if (routine->uses_varargs || routine->stackalloc || x86_routine_calls(routine))
+        return true;
+    for (x86_insn_t* insn = routine->insns; insn; insn = insn->next)
+    {
+        if (insn->type == X86I_PUSH || insn->type == X86I_POP)
+            return true;
+        if (x86_operand_uses_register(insn->op1, X86R_RBP) || x86_operand_uses_register(insn->op2, X86R_RBP) ||
+            x86_operand_uses_register(insn->op3, X86R_RBP))
+            return true;
+    }
+    return false;
+}
+
+// how far %rsp is moved below the pushed nonvolatiles, for routines without a frame pointer
+long long x86_routine_stack_adjustment(x86_asm_routine_t* routine)
+{
+    long long slots = llabs(routine->stackalloc);
+    if (!x86_routine_calls(routine))
+        return slots <= X86_64_RED_ZONE_SIZE ? 0 : slots;
+    // the return address and the pushes leave %rsp 8 bytes off alignment
+    long long v = slots + x86_routine_pushed_size(routine) + 8;
+    return slots + (16 - (v % 16)) % 16;
+}
+
+static void rebase_stack_slot(x86_operand_t* op, long long delta)
+{
+    if (!op) return;
+    if (op->type == X86OP_DEREF_REGISTER && op->deref_reg.reg_addr == X86R_RSP)
+        op->deref_reg.offset += delta;
+    else if (op->type == X86OP_ARRAY && op->array.reg_base == X86R_RSP)
+        op->array.offset += delta;
+}
+
+// without a frame pointer, moves the stack slots' offsets from the top of the locals to %rsp once the adjustment is
+// known. it's safe to call again
+void x86_prepare_routine_frame(x86_asm_routine_t* routine)
+{
+    if (!routine->omits_frame_pointer)
+        return;
+    long long bias = x86_routine_stack_adjustment(routine);
+    long long delta = bias - routine->slot_bias;
+    routine->slot_bias = bias;
+    if (!delta)
+        return;
+    for (x86_insn_t* insn = routine->insns; insn; insn = insn->next)
+    {
+        rebase_stack_slot(insn->op1, delta);
+        rebase_stack_slot(insn->op2, delta);
+        rebase_stack_slot(insn->op3, delta);
+    }
+}
+
 static void x86_write_routine_pop_nonvolatiles(x86_asm_routine_t* routine, FILE* out)
 {
     for (int i = sizeof(NONVOLATILE_FLAGS) / sizeof(NONVOLATILE_FLAGS[0]) - 1; i >= 0; --i)
@@ -807,54 +1149,139 @@ static void x86_write_routine_pop_nonvolatiles(x86_asm_routine_t* routine, FILE*
     }
 }
 
+static void x86_write_routine_epilogue(x86_asm_routine_t* routine, bool framed, long long adjustment, FILE* out)
+{
+    if (framed)
+    {
+        if (x86_routine_outgoing_size(routine))
+            fprintf(out, "    addq $%lld, %%rsp\n", x86_routine_outgoing_size(routine));
+        x86_write_routine_pop_nonvolatiles(routine, out);
+        fprintf(out, "    leave\n");
+    }
+    else
+    {
+        if (adjustment)
+            fprintf(out, "    addq $%lld, %%rsp\n", adjustment);
+        x86_write_routine_pop_nonvolatiles(routine, out);
+    }
+}
+
+bool x86_is_return_jump(x86_insn_t* insn)
+{
+    return insn->type == X86I_JMP && insn->op1->type == X86OP_LABEL && starts_with_ignore_case(insn->op1->label, ".LR");
+}
+
+// the label starting what layout moved past the end of the routine, which goes after the epilogue.
+// everything before it ends in a jump or a return, so if it's gone, leaving it all in order is fine too.
+x86_insn_t* x86_routine_cold_start(x86_asm_routine_t* routine)
+{
+    if (!routine->cold_label)
+        return NULL;
+    for (x86_insn_t* insn = routine->insns; insn; insn = insn->next)
+    {
+        if (insn->type == X86I_LABEL && insn->op1->type == X86OP_LABEL && !strcmp(insn->op1->label, routine->cold_label))
+            return insn;
+    }
+    return NULL;
+}
+
 void x86_write_routine(x86_asm_routine_t* routine, FILE* out)
 {
-    x86_find_used_nonvolatiles(routine);
+    x86_prepare_routine_frame(routine);
     if (routine->global)
-        fprintf(out, "    .globl %s\n", routine->label);
-    fprintf(out, "%s:\n", routine->label);
-    fprintf(out, "    pushq %%rbp\n");
-    fprintf(out, "    movq %%rsp, %%rbp\n");
-    if (routine->stackalloc)
+        write_directive("    .globl ", routine->label, out);
+    fputs(routine->label, out);
+    fputs(":\n", out);
+    bool framed = x86_routine_uses_frame_pointer(routine);
+    long long adjustment = framed ? x86_routine_frame_size(routine) : x86_routine_stack_adjustment(routine);
+    if (framed)
     {
-        long long v = llabs(routine->stackalloc);
-        fprintf(out, "    subq $%lld, %%rsp\n", v + (16 - (v % 16)) % 16);
+        fprintf(out, "    pushq %%rbp\n");
+        fprintf(out, "    movq %%rsp, %%rbp\n");
+        if (adjustment)
+            fprintf(out, "    subq $%lld, %%rsp\n", adjustment);
+        x86_write_routine_push_nonvolatiles(routine, out);
+        if (x86_routine_outgoing_size(routine))
+            fprintf(out, "    subq $%lld, %%rsp\n", x86_routine_outgoing_size(routine));
+    }
+    else
+    {
+        x86_write_routine_push_nonvolatiles(routine, out);
+        if (adjustment)
+            fprintf(out, "    subq $%lld, %%rsp\n", adjustment);
     }
-    x86_write_routine_push_nonvolatiles(routine, out);
     if (routine->uses_varargs)
         x86_write_varargs_setup(routine, out);
+    x86_insn_t* cold = x86_routine_cold_start(routine);
     size_t lr_jumps = 0;
-    for (x86_insn_t* insn = routine->insns; insn; insn = insn->next)
+    x86_insn_t* last = NULL;
+    for (x86_insn_t* insn = routine->insns; insn != cold; insn = insn->next)
     {
-        if (insn->type == X86I_JMP && insn->op1->type == X86OP_LABEL && starts_with_ignore_case(insn->op1->label, ".LR"))
+        if (x86_is_return_jump(insn))
         {
-            if (!insn->next)
+            if (insn->next == cold)
                 continue;
             ++lr_jumps;
         }
+        if (insn->type == X86I_TAIL_JMP)
+            x86_write_routine_epilogue(routine, framed, adjustment, out);
         x86_write_insn(insn, out);
+        last = insn;
     }
-    if (lr_jumps > 0)
+    for (x86_insn_t* insn = cold; insn; insn = insn->next)
+        lr_jumps += x86_is_return_jump(insn);
+    // a routine ending in a tail call never gets to the epilogue unless something jumps there
+    if (lr_jumps || !last || last->type != X86I_TAIL_JMP)
     {
-        char buffer[6 + MAX_STRINGIFIED_INTEGER_LENGTH];
-        snprintf(buffer, sizeof(buffer), ".LR%lu:\n", routine->id);
-        fprintf(out, "%s", buffer);
+        if (lr_jumps > 0)
+        {
+            char buffer[6 + MAX_STRINGIFIED_INTEGER_LENGTH];
+            snprintf(buffer, sizeof(buffer), ".LR%lu:\n", routine->id);
+            fprintf(out, "%s", buffer);
+        }
+        x86_write_routine_epilogue(routine, framed, adjustment, out);
+        fprintf(out, "    ret\n");
+    }
+    for (x86_insn_t* insn = cold; insn; insn = insn->next)
+    {
+        if (insn->type == X86I_TAIL_JMP)
+            x86_write_routine_epilogue(routine, framed, adjustment, out);
+        x86_write_insn(insn, out);
     }
-    x86_write_routine_pop_nonvolatiles(routine, out);
-    fprintf(out, "    leave\n");
-    fprintf(out, "    ret\n");
 }
 
+static const char* RODATA_SECTION_DIRECTIVES[X86RS_NO_ELEMENTS] = {
+    "    .section .rodata\n",
+    "    .section .rodata.str1.1,\"aMS\",@progbits,1\n",
+    "    .section .rodata.str4.4,\"aMS\",@progbits,4\n",
+    "    .section .rodata.cst4,\"aM\",@progbits,4\n",
+    "    .section .rodata.cst8,\"aM\",@progbits,8\n",
+    "    .section .rodata.cst16,\"aM\",@progbits,16\n"
+};
+
 void x86_asm_file_write(x86_asm_file_t* file, FILE* out)
 {
     if (file->data->size)
         fprintf(out, "    .data\n");
     VECTOR_FOR(x86_asm_data_t*, data, file->data)
         x86_write_data(data, out);
-    if (file->rodata->size)
-        fprintf(out, "    .section .rodata\n");
-    VECTOR_FOR(x86_asm_data_t*, rodata, file->rodata)
-        x86_write_data(rodata, out);
+    for (x86_rodata_section_t section = X86RS_RODATA; section < X86RS_NO_ELEMENTS; ++section)
+    {
+        bool started = false;
+        VECTOR_FOR(x86_asm_data_t*, rodata, file->rodata)
+        {
+            if (rodata->section != section)
+                continue;
+            if (!started)
+                fputs(RODATA_SECTION_DIRECTIVES[section], out);
+            started = true;
+            x86_write_data(rodata, out);
+        }
+    }
+    if (file->profile->size)
+        fprintf(out, "    .section ecc_profile,\"aw\",@progbits\n");
+    VECTOR_FOR(x86_asm_data_t*, profile, file->profile)
+        x86_write_data(profile, out);
     if (file->routines->size)
         fprintf(out, "    .text\n");
     VECTOR_FOR(x86_asm_routine_t*, routine, file->routines)
@@ -964,8 +1391,10 @@ x86_operand_t* air_operand_to_x86_operand(air_insn_operand_t* aop, x86_asm_routi
             }
             
             // if it has a stack offset already, use that
+            // without a frame pointer, the offsets are from the top of the locals until x86_prepare_routine_frame
+            regid_t frame = routine->omits_frame_pointer ? X86R_RSP : X86R_RBP;
             if (sy->stack_offset)
-                return make_operand_deref_register(X86R_RBP, sy->stack_offset + offset);
+                return make_operand_deref_register(frame, sy->stack_offset + offset);
             
             // otherwise, give it a stack offset
             long long syoffset = routine->stackalloc;
@@ -973,7 +1402,7 @@ x86_operand_t* air_operand_to_x86_operand(air_insn_operand_t* aop, x86_asm_routi
             long long alignment = type_alignment(sy->type);
             syoffset -= size;
             syoffset -= abs(syoffset % alignment);
-            return make_operand_deref_register(X86R_RBP, (routine->stackalloc = sy->stack_offset = syoffset) + offset);
+            return make_operand_deref_register(frame, (routine->stackalloc = sy->stack_offset = syoffset) + offset);
         }
         case AOP_LABEL:
             char label[MAX_CONSTANT_LOCAL_LABEL_LENGTH];
@@ -1002,6 +1431,30 @@ x86_insn_t* make_x86_insn_clear_register(regid_t reg)
     return insn;
 }
 
+// the packed instruction for an operation on a vector, picked by its element type, or X86I_UNKNOWN if SSE2 has none
+static x86_insn_type_t x86_packed_insn_type(c_type_t* ct, air_insn_type_t type)
+{
+    c_type_t* et = ct->derived_from;
+    bool floating = type_is_sse_floating(et);
+    bool single = type_size(et) == 4;
+    switch (type)
+    {
+        case AIR_LOAD:
+        case AIR_ASSIGN:
+            return !floating ? X86I_MOVDQU : single ? X86I_MOVUPS : X86I_MOVUPD;
+        case AIR_ADD:
+            return !floating ? (single ? X86I_PADDD : X86I_PADDQ) : single ? X86I_ADDPS : X86I_ADDPD;
+        case AIR_SUBTRACT:
+            return !floating ? (single ? X86I_PSUBD : X86I_PSUBQ) : single ? X86I_SUBPS : X86I_SUBPD;
+        case AIR_MULTIPLY:
+            return !floating ? X86I_UNKNOWN : single ? X86I_MULPS : X86I_MULPD;
+        case AIR_DIVIDE:
+            return !floating ? X86I_UNKNOWN : single ? X86I_DIVPS : X86I_DIVPD;
+        default:
+            return X86I_UNKNOWN;
+    }
+}
+
 x86_insn_t* x86_generate_load(air_insn_t* ainsn, x86_asm_routine_t* routine, x86_asm_file_t* file)
 {
     x86_insn_type_t type = X86I_UNKNOWN;
@@ -1011,6 +1464,8 @@ x86_insn_t* x86_generate_load(air_insn_t* ainsn, x86_asm_routine_t* routine, x86
         type = X86I_MOVSS;
     else if (ainsn->ct->class == CTC_DOUBLE)
         type = X86I_MOVSD;
+    else if (type_is_vector(ainsn->ct))
+        type = x86_packed_insn_type(ainsn->ct, ainsn->type);
     else
         report_return_value(NULL);
     x86_insn_t* insn = make_basic_x86_insn(type);
@@ -1023,7 +1478,8 @@ x86_insn_t* x86_generate_load(air_insn_t* ainsn, x86_asm_routine_t* routine, x86
 x86_insn_t* x86_generate_load_addr(air_insn_t* ainsn, x86_asm_routine_t* routine, x86_asm_file_t* file)
 {
     x86_insn_t* insn = make_basic_x86_insn(X86I_LEA);
-    insn->size = X86SZ_QWORD;
+    // 32-bit arithmetic selected as lea only keeps the low half
+    insn->size = type_size(ainsn->ct) == 4 ? X86SZ_DWORD : X86SZ_QWORD;
     insn->op2 = air_operand_to_x86_operand(ainsn->ops[0], routine);
     insn->op1 = air_operand_to_x86_operand(ainsn->ops[1], routine);
     return insn;
@@ -1031,7 +1487,7 @@ x86_insn_t* x86_generate_load_addr(air_insn_t* ainsn, x86_asm_routine_t* routine
 
 x86_insn_t* x86_generate_func_call(air_insn_t* ainsn, x86_asm_routine_t* routine, x86_asm_file_t* file)
 {
-    x86_insn_t* insn = make_basic_x86_insn(X86I_CALL);
+    x86_insn_t* insn = make_basic_x86_insn(ainsn->metadata.fcall_tail ? X86I_TAIL_JMP : X86I_CALL);
     insn->size = X86SZ_QWORD;
     air_insn_operand_t* aop = ainsn->ops[1];
     switch (aop->type)
@@ -1074,7 +1530,14 @@ x86_insn_t* x86_generate_binary_operator(air_insn_t* ainsn, x86_asm_routine_t* r
 {
     x86_insn_type_t type = X86I_UNKNOWN;
     x86_insn_type_t movtype = X86I_UNKNOWN;
-    if (ainsn->ct->class == CTC_FLOAT)
+    if (type_is_vector(ainsn->ct))
+    {
+        movtype = x86_packed_insn_type(ainsn->ct, AIR_LOAD);
+        type = x86_packed_insn_type(ainsn->ct, ainsn->type);
+        if (type == X86I_UNKNOWN)
+            report_return_value(NULL);
+    }
+    else if (ainsn->ct->class == CTC_FLOAT)
     {
         movtype = X86I_MOVSS;
         switch (ainsn->type)
@@ -1172,7 +1635,7 @@ x86_insn_t* x86_generate_direct_binary_operator(air_insn_t* ainsn, x86_asm_routi
             default: report_return_value(NULL);
         }
     }
-    else if (type_is_signed_integer(ainsn->ct))
+    else if (type_is_signed_integer(ainsn->ct) || ainsn->ct->class == CTC_CHAR)
     {
         switch (ainsn->type)
         {
@@ -1215,28 +1678,34 @@ x86_insn_t* x86_generate_direct_binary_operator(air_insn_t* ainsn, x86_asm_routi
     return insn;
 }
 
+// the constant itself is defined by x86_generate_sections
 static symbol_t* x86_64_get_sse_zero_checker(c_type_class_t class, x86_asm_file_t* file)
 {
     bool is_float = class == CTC_FLOAT;
+    pool_lock();
     symbol_t* checker = is_float ? file->sse32_zero_checker : file->sse64_zero_checker;
-    if (checker)
-        return checker;
-    if (is_float)
-    {
-        checker = file->sse32_zero_checker = symbol_table_add(SYMBOL_TABLE, "__sse32_zero_checker", symbol_init(NULL));
-        checker->name = strdup("__sse32_zero_checker");
-    }
-    else
+    if (!checker)
     {
-        checker = file->sse64_zero_checker = symbol_table_add(SYMBOL_TABLE, "__sse64_zero_checker", symbol_init(NULL));
-        checker->name = strdup("__sse64_zero_checker");
+        char* name = is_float ? "__sse32_zero_checker" : "__sse64_zero_checker";
+        checker = symbol_table_add(SYMBOL_TABLE, name, symbol_init(NULL));
+        checker->name = strdup(name);
+        checker->type = make_basic_type(CTC_ARRAY);
+        checker->type->derived_from = make_basic_type(CTC_UNSIGNED_CHAR);
+        checker->sd = SD_STATIC;
+        if (is_float)
+            file->sse32_zero_checker = checker;
+        else
+            file->sse64_zero_checker = checker;
     }
-    checker->type = make_basic_type(CTC_ARRAY);
-    checker->type->derived_from = make_basic_type(CTC_UNSIGNED_CHAR);
-    checker->sd = SD_STATIC;
+    pool_unlock();
+    return checker;
+}
 
+static x86_asm_data_t* x86_generate_sse_zero_checker(symbol_t* checker, bool is_float)
+{
     x86_asm_data_t* data = calloc(1, sizeof *data);
     data->readonly = true;
+    data->section = X86RS_CST16;
     data->alignment = 16;
     data->length = 16;
     data->data = malloc(data->length);
@@ -1247,8 +1716,7 @@ static symbol_t* x86_64_get_sse_zero_checker(c_type_class_t class, x86_asm_file_
     else
         uint64_data[0] = 0x7FFFFFFFFFFFFFFF;
     uint64_data[1] = 0;
-    vector_add(file->rodata, data);
-    return checker;
+    return data;
 }
 
 /*
@@ -1388,8 +1856,120 @@ x86_insn_t* x86_generate_sse_conditional_jump_test(air_insn_t* ainsn, x86_asm_ro
     return ptest;
 }
 
+static air_insn_t* skip_sequence_points(air_insn_t* insn, bool forward)
+{
+    while (insn && insn->type == AIR_SEQUENCE_POINT)
+        insn = forward ? insn->next : insn->prev;
+    return insn;
+}
+
+// whether a comparison localize marked still sits right before the jump it feeds, nothing having been put in between since
+static bool x86_comparison_fuses(air_insn_t* cmp, air_insn_t* jump)
+{
+    if (!cmp || !jump || !cmp->metadata.fuses_branch) return false;
+    if (jump->type != AIR_JZ && jump->type != AIR_JNZ) return false;
+    if (skip_sequence_points(cmp->next, true) != jump) return false;
+    return cmp->ops[0]->type == AOP_REGISTER && jump->ops[1]->type == AOP_REGISTER &&
+        cmp->ops[0]->content.reg == jump->ops[1]->content.reg;
+}
+
+static x86_insn_t* make_branch(x86_insn_type_t type, air_insn_t* ainsn, x86_asm_routine_t* routine)
+{
+    x86_insn_t* jmp = make_basic_x86_insn(type);
+    jmp->op1 = air_operand_to_x86_operand(ainsn->ops[0], routine);
+    return jmp;
+}
+
+/*
+
+the jump after a fused comparison tests the flags the comparison left:
+
+    cmpl %esi, %edi
+    jl .L1
+
+SSE equality has to account for unordered operands (a NaN on either side), which set the parity flag along with
+the zero flag. jumping when equal becomes:
+
+    ucomisd %xmm1, %xmm0
+    jp .LGEN1
+    je .L1
+.LGEN1:
+
+and jumping when not equal:
+
+    ucomisd %xmm1, %xmm0
+    jne .L1
+    jp .L1
+
+SSE relational comparisons use the "above" forms with the operands flipped for < and <=, which are false when
+unordered just like C wants; their inverses are taken when unordered.
+
+*/
+static x86_insn_t* x86_generate_fused_branch(air_insn_t* cmp, air_insn_t* ainsn, x86_asm_routine_t* routine, x86_asm_file_t* file)
+{
+    c_type_t* opt = cmp->ops[1]->ct;
+    bool sse = type_is_sse_floating(opt);
+    bool when_true = ainsn->type == AIR_JNZ;
+    if (sse && (cmp->type == AIR_EQUAL || cmp->type == AIR_INEQUAL))
+    {
+        if (when_true == (cmp->type == AIR_EQUAL))
+        {
+            char* label_name = x86_asm_routine_create_next_label(routine);
+            x86_insn_t* jp = make_basic_x86_insn(X86I_JP);
+            jp->op1 = make_operand_label(label_name);
+            x86_insn_t* je = make_branch(X86I_JE, ainsn, routine);
+            x86_insn_t* label = make_basic_x86_insn(X86I_LABEL);
+            label->op1 = make_operand_label(label_name);
+            free(label_name);
+            jp->next = je;
+            je->next = label;
+            return jp;
+        }
+        x86_insn_t* jne = make_branch(X86I_JNE, ainsn, routine);
+        jne->next = make_branch(X86I_JP, ainsn, routine);
+        return jne;
+    }
+
+    bool opt_unsigned = type_is_unsigned_integer(opt);
+    x86_insn_type_t taken = X86I_UNKNOWN, not_taken = X86I_UNKNOWN;
+    switch (cmp->type)
+    {
+        case AIR_LESS:
+            taken = sse ? X86I_JA : opt_unsigned ? X86I_JB : X86I_JL;
+            not_taken = sse ? X86I_JBE : opt_unsigned ? X86I_JNB : X86I_JGE;
+            break;
+        case AIR_LESS_EQUAL:
+            taken = sse ? X86I_JNB : opt_unsigned ? X86I_JBE : X86I_JLE;
+            not_taken = sse ? X86I_JB : opt_unsigned ? X86I_JA : X86I_JG;
+            break;
+        case AIR_GREATER:
+            taken = sse || opt_unsigned ? X86I_JA : X86I_JG;
+            not_taken = sse || opt_unsigned ? X86I_JBE : X86I_JLE;
+            break;
+        case AIR_GREATER_EQUAL:
+            taken = sse || opt_unsigned ? X86I_JNB : X86I_JGE;
+            not_taken = sse || opt_unsigned ? X86I_JB : X86I_JL;
+            break;
+        case AIR_EQUAL:
+            taken = X86I_JE;
+            not_taken = X86I_JNE;
+            break;
+        case AIR_INEQUAL:
+            taken = X86I_JNE;
+            not_taken = X86I_JE;
+            break;
+        default:
+            report_return_value(NULL);
+    }
+    return make_branch(when_true ? taken : not_taken, ainsn, routine);
+}
+
 x86_insn_t* x86_generate_conditional_jump(air_insn_t* ainsn, x86_asm_routine_t* routine, x86_asm_file_t* file)
 {
+    air_insn_t* comparison = skip_sequence_points(ainsn->prev, false);
+    if (x86_comparison_fuses(comparison, ainsn))
+        return x86_generate_fused_branch(comparison, ainsn, routine, file);
+
     x86_insn_type_t type = X86I_UNKNOWN;
     switch (ainsn->type)
     {
@@ -1400,7 +1980,7 @@ x86_insn_t* x86_generate_conditional_jump(air_insn_t* ainsn, x86_asm_routine_t*
 
     x86_insn_t* cmp = NULL;
     
-    if (type_is_integer(ainsn->ct))
+    if (type_is_integer(ainsn->ct) || ainsn->ct->class == CTC_POINTER)
     {
         cmp = make_basic_x86_insn(X86I_CMP);
         cmp->size = c_type_to_x86_operand_size(ainsn->ct);
@@ -1428,6 +2008,67 @@ x86_insn_t* x86_generate_jmp(air_insn_t* ainsn, x86_asm_routine_t* routine, x86_
     return insn;
 }
 
+/*
+
+jmp_table(%rax, .L1, .L2, .L3);
+
+becomes:
+
+    leaq .LGEN1(%rip), %r11
+    movq (%r11, %rax, 8), %rax
+    jmp *%rax
+
+with the table in rodata:
+
+    .align 8
+.LGEN1:
+    .quad .L1
+    .quad .L2
+    .quad .L3
+
+*/
+x86_insn_t* x86_generate_jmp_table(air_insn_t* ainsn, x86_asm_routine_t* routine, x86_asm_file_t* file)
+{
+    x86_asm_data_t* data = calloc(1, sizeof *data);
+    data->readonly = true;
+    data->alignment = POINTER_WIDTH;
+    data->length = (ainsn->noops - 1) * POINTER_WIDTH;
+    data->data = calloc(data->length, 1);
+    data->label = x86_asm_routine_create_next_label(routine);
+    data->addresses = vector_init();
+    for (size_t i = 1; i < ainsn->noops; ++i)
+    {
+        x86_operand_t* target = air_operand_to_x86_operand(ainsn->ops[i], routine);
+        x86_asm_init_address_t* ia = calloc(1, sizeof *ia);
+        ia->label = strdup(target->label);
+        ia->data_location = (i - 1) * POINTER_WIDTH;
+        vector_add(data->addresses, ia);
+        x86_operand_delete(target);
+    }
+    vector_add(routine->rodata, data);
+
+    x86_operand_t* index = air_operand_to_x86_operand(ainsn->ops[0], routine);
+    if (index->type != X86OP_REGISTER) report_return_value(NULL);
+
+    x86_insn_t* lea = make_basic_x86_insn(X86I_LEA);
+    lea->size = X86SZ_QWORD;
+    lea->op1 = make_operand_label_ref(data->label, 0);
+    lea->op2 = make_operand_register(X86R_R11);
+
+    x86_insn_t* mov = make_basic_x86_insn(X86I_MOV);
+    mov->size = X86SZ_QWORD;
+    mov->op1 = make_operand_array(X86R_R11, index->reg, POINTER_WIDTH, 0);
+    mov->op2 = make_operand_register(index->reg);
+
+    x86_insn_t* jmp = make_basic_x86_insn(X86I_JMP);
+    jmp->op1 = make_operand_ptr_register(index->reg);
+
+    x86_operand_delete(index);
+    lea->next = mov;
+    mov->next = jmp;
+    return lea;
+}
+
 x86_insn_t* x86_generate_label(air_insn_t* ainsn, x86_asm_routine_t* routine, x86_asm_file_t* file)
 {
     x86_insn_t* insn = make_basic_x86_insn(X86I_LABEL);
@@ -1438,10 +2079,23 @@ x86_insn_t* x86_generate_label(air_insn_t* ainsn, x86_asm_routine_t* routine, x8
 x86_insn_t* x86_generate_push(air_insn_t* ainsn, x86_asm_routine_t* routine, x86_asm_file_t* file)
 {
     x86_insn_t* insn = make_basic_x86_insn(X86I_PUSH);
+    insn->size = c_type_to_x86_operand_size(ainsn->ct);
     insn->op1 = air_operand_to_x86_operand(ainsn->ops[0], routine);
     return insn;
 }
 
+// localize leaves out the zero extension of comparisons it expects to fuse, so it's made up here if that fell through
+static x86_insn_t* x86_generate_unfused_extension(air_insn_t* ainsn, x86_asm_routine_t* routine)
+{
+    if (!ainsn->metadata.fuses_branch)
+        return NULL;
+    x86_insn_t* and = make_basic_x86_insn(X86I_AND);
+    and->size = X86SZ_QWORD;
+    and->op1 = make_operand_immediate(1);
+    and->op2 = air_operand_to_x86_operand(ainsn->ops[0], routine);
+    return and;
+}
+
 x86_insn_t* x86_generate_relational_equality_operator(air_insn_t* ainsn, x86_asm_routine_t* routine, x86_asm_file_t* file)
 {
     // this type should also be equal to ainsn->ops[2]->ct
@@ -1450,6 +2104,9 @@ x86_insn_t* x86_generate_relational_equality_operator(air_insn_t* ainsn, x86_asm
 
     bool opt_sse = type_is_sse_floating(opt);
 
+    // unsigned integers are ordered by the carry flag instead of the sign and overflow flags
+    bool opt_unsigned = type_is_unsigned_integer(opt);
+
     x86_insn_type_t type = X86I_UNKNOWN;
     switch (ainsn->type)
     {
@@ -1459,7 +2116,7 @@ x86_insn_t* x86_generate_relational_equality_operator(air_insn_t* ainsn, x86_asm
                 type = X86I_SETNB;
                 break;
             }
-            type = X86I_SETLE;
+            type = opt_unsigned ? X86I_SETBE : X86I_SETLE;
             break;
         case AIR_LESS: 
             if (opt_sse)
@@ -1467,7 +2124,7 @@ x86_insn_t* x86_generate_relational_equality_operator(air_insn_t* ainsn, x86_asm
                 type = X86I_SETA;
                 break;
             }
-            type = X86I_SETL;
+            type = opt_unsigned ? X86I_SETB : X86I_SETL;
             break;
         case AIR_GREATER_EQUAL:
             if (opt_sse)
@@ -1475,7 +2132,7 @@ x86_insn_t* x86_generate_relational_equality_operator(air_insn_t* ainsn, x86_asm
                 type = X86I_SETNB;
                 break;
             }
-            type = X86I_SETGE;
+            type = opt_unsigned ? X86I_SETNB : X86I_SETGE;
             break;
         case AIR_GREATER:
             if (opt_sse)
@@ -1483,7 +2140,7 @@ x86_insn_t* x86_generate_relational_equality_operator(air_insn_t* ainsn, x86_asm
                 type = X86I_SETA;
                 break;
             }
-            type = X86I_SETG;
+            type = opt_unsigned ? X86I_SETA : X86I_SETG;
             break;
         case AIR_EQUAL:
             type = X86I_SETE;
@@ -1504,7 +2161,8 @@ x86_insn_t* x86_generate_relational_equality_operator(air_insn_t* ainsn, x86_asm
         // TODO: support long doubles and complex numbers
         report_return_value(NULL);
 
-    cmp->size = c_type_to_x86_operand_size(ainsn->ct);
+    // integers are compared at their own width, not the result's
+    cmp->size = c_type_to_x86_operand_size(opt_sse ? ainsn->ct : opt);
 
     // flip operands for SSE <= and <
     if (opt_sse && (ainsn->type == AIR_LESS_EQUAL || ainsn->type == AIR_LESS))
@@ -1518,11 +2176,15 @@ x86_insn_t* x86_generate_relational_equality_operator(air_insn_t* ainsn, x86_asm
         cmp->op2 = air_operand_to_x86_operand(ainsn->ops[1], routine);
     }
     
+    if (x86_comparison_fuses(ainsn, skip_sequence_points(ainsn->next, true)))
+        return cmp;
+
     x86_insn_t* insn = make_basic_x86_insn(type);
     insn->size = X86SZ_BYTE;
     insn->op1 = air_operand_to_x86_operand(ainsn->ops[0], routine);
 
     cmp->next = insn;
+    insn->next = x86_generate_unfused_extension(ainsn, routine);
 
     return cmp;
 }
@@ -1566,6 +2228,9 @@ x86_insn_t* x86_generate_sse_equality_operator(air_insn_t* ainsn, x86_asm_routin
     cmp1->op1 = air_operand_to_x86_operand(ainsn->ops[2], routine);
     cmp1->op2 = air_operand_to_x86_operand(ainsn->ops[1], routine);
 
+    if (x86_comparison_fuses(ainsn, skip_sequence_points(ainsn->next, true)))
+        return cmp1;
+
     x86_insn_t* parity = make_basic_x86_insn(eq ? X86I_SETNP : X86I_SETP);
     parity->size = X86SZ_BYTE;
     parity->op1 = air_operand_to_x86_operand(ainsn->ops[0], routine);
@@ -1578,7 +2243,7 @@ x86_insn_t* x86_generate_sse_equality_operator(air_insn_t* ainsn, x86_asm_routin
     parity->next = cmp2;
 
     x86_insn_t* je = make_basic_x86_insn(X86I_JE);
-    char* label_name = x86_asm_file_create_next_label(file);
+    char* label_name = x86_asm_routine_create_next_label(routine);
     je->op1 = make_operand_label(label_name);
     cmp2->next = je;
 
@@ -1591,6 +2256,7 @@ x86_insn_t* x86_generate_sse_equality_operator(air_insn_t* ainsn, x86_asm_routin
     x86_insn_t* label = make_basic_x86_insn(X86I_LABEL);
     label->op1 = make_operand_label(label_name);
     mov->next = label;
+    label->next = x86_generate_unfused_extension(ainsn, routine);
 
     free(label_name);
 
@@ -1615,8 +2281,18 @@ x86_insn_t* x86_generate_extension(air_insn_t* ainsn, x86_asm_routine_t* routine
     x86_insn_size_t dest_size = c_type_to_x86_operand_size(ainsn->ct);
     if (src_size == dest_size)
         return NULL;
+    // writing a doubleword clears the rest of the register. that's needed even within the same register, since a
+    // 32-bit value can be the low half of a 64-bit one that was truncated without an instruction
     if (ainsn->type == AIR_ZEXT && src_size == X86SZ_DWORD && dest_size == X86SZ_QWORD)
-        return NULL;
+    {
+        air_insn_operand_t* src = ainsn->ops[1];
+        air_insn_operand_t* dest = ainsn->ops[0];
+        x86_insn_t* insn = make_basic_x86_insn(X86I_MOV);
+        insn->size = X86SZ_DWORD;
+        insn->op1 = air_operand_to_x86_operand(src, routine);
+        insn->op2 = air_operand_to_x86_operand(dest, routine);
+        return insn;
+    }
     x86_insn_t* insn = make_basic_x86_insn(ainsn->type == AIR_SEXT ? X86I_MOVSX : X86I_MOVZX);
     insn->size = dest_size;
     insn->op1 = air_operand_to_x86_operand(ainsn->ops[1], routine);
@@ -1658,11 +2334,28 @@ x86_insn_t* x86_generate_multiply(air_insn_t* ainsn, x86_asm_routine_t* routine,
     return mul;
 }
 
+// idiv divides %edx:%eax, so the dividend's sign has to be extended into %edx first
+static x86_insn_t* x86_generate_sign_extend_dividend(x86_insn_t* div)
+{
+    x86_insn_t* cqto = make_basic_x86_insn(X86I_CQTO);
+    cqto->size = div->size;
+    cqto->next = div;
+    return cqto;
+}
+
 x86_insn_t* x86_generate_divide(air_insn_t* ainsn, x86_asm_routine_t* routine, x86_asm_file_t* file)
 {
     x86_insn_t* div = NULL;
     x86_insn_type_t type = X86I_UNKNOWN;
-    if (ainsn->ct->class == CTC_FLOAT || ainsn->ct->class == CTC_DOUBLE)
+    if (type_is_vector(ainsn->ct))
+    {
+        type = x86_packed_insn_type(ainsn->ct, AIR_LOAD);
+        div = make_basic_x86_insn(x86_packed_insn_type(ainsn->ct, AIR_DIVIDE));
+        div->size = c_type_to_x86_operand_size(ainsn->ct);
+        div->op1 = air_operand_to_x86_operand(ainsn->ops[2], routine);
+        div->op2 = air_operand_to_x86_operand(ainsn->ops[1], routine);
+    }
+    else if (ainsn->ct->class == CTC_FLOAT || ainsn->ct->class == CTC_DOUBLE)
     {
         type = ainsn->ct->class == CTC_FLOAT ? X86I_MOVSS : X86I_MOVSD;
         div = make_basic_x86_insn(ainsn->ct->class == CTC_FLOAT ? X86I_DIVSS : X86I_DIVSD);
@@ -1677,7 +2370,7 @@ x86_insn_t* x86_generate_divide(air_insn_t* ainsn, x86_asm_routine_t* routine, x
         div = make_basic_x86_insn(sig ? X86I_IDIV : X86I_DIV);
         div->size = c_type_to_x86_operand_size(ainsn->ct);
         div->op1 = air_operand_to_x86_operand(ainsn->ops[2], routine);
-        return div;
+        return sig ? x86_generate_sign_extend_dividend(div) : div;
     }
     else
         report_return_value(NULL);
@@ -1711,7 +2404,7 @@ x86_insn_t* x86_generate_direct_divide(air_insn_t* ainsn, x86_asm_routine_t* rou
         div = make_basic_x86_insn(sig ? X86I_IDIV : X86I_DIV);
         div->size = c_type_to_x86_operand_size(ainsn->ct);
         div->op1 = air_operand_to_x86_operand(ainsn->ops[1], routine);
-        return div;
+        return sig ? x86_generate_sign_extend_dividend(div) : div;
     }
     else
         report_return_value(NULL);
@@ -1790,43 +2483,48 @@ x86_insn_t* x86_generate_signed2sse(air_insn_t* ainsn, x86_asm_routine_t* routin
     return start;
 }
 
+// the constant itself is defined by x86_generate_sections
 static symbol_t* x86_64_get_sse_i64_limit(c_type_class_t class, x86_asm_file_t* file)
 {
     bool is_float = class == CTC_FLOAT;
+    pool_lock();
     symbol_t* limit = is_float ? file->sse32_i64_limit : file->sse64_i64_limit;
-    if (limit)
-        return limit;
-    if (is_float)
-    {
-        limit = file->sse32_i64_limit = symbol_table_add(SYMBOL_TABLE, "__sse32_i64_limit", symbol_init(NULL));
-        limit->name = strdup("__sse32_i64_limit");
-    }
-    else
+    if (!limit)
     {
-        limit = file->sse64_i64_limit = symbol_table_add(SYMBOL_TABLE, "__sse64_i64_limit", symbol_init(NULL));
-        limit->name = strdup("__sse64_i64_limit");
+        char* name = is_float ? "__sse32_i64_limit" : "__sse64_i64_limit";
+        limit = symbol_table_add(SYMBOL_TABLE, name, symbol_init(NULL));
+        limit->name = strdup(name);
+        limit->type = make_basic_type(is_float ? CTC_FLOAT : CTC_DOUBLE);
+        limit->sd = SD_STATIC;
+        if (is_float)
+            file->sse32_i64_limit = limit;
+        else
+            file->sse64_i64_limit = limit;
     }
-    limit->sd = SD_STATIC;
+    pool_unlock();
+    return limit;
+}
 
+static x86_asm_data_t* x86_generate_sse_i64_limit(symbol_t* limit, bool is_float)
+{
     x86_asm_data_t* data = calloc(1, sizeof *data);
     data->readonly = true;
     data->label = strdup(limit->name);
     if (is_float)
     {
-        limit->type = make_basic_type(CTC_FLOAT);
+        data->section = X86RS_CST4;
         data->alignment = data->length = FLOAT_WIDTH;
         data->data = malloc(data->length);
         *((float*) (data->data)) = 9223372036854775808.0f;
     }
     else
     {
-        limit->type = make_basic_type(CTC_DOUBLE);
+        data->section = X86RS_CST8;
         data->alignment = data->length = DOUBLE_WIDTH;
         data->data = malloc(data->length);
         *((double*) (data->data)) = 9223372036854775808.0;
     }
-    vector_add(file->rodata, data);
-    return limit;
+    return data;
 }
 
 /*
@@ -1872,8 +2570,8 @@ x86_insn_t* x86_generate_sse2u64(air_insn_t* ainsn, x86_asm_routine_t* routine,
     cmp->op2 = air_operand_to_x86_operand(ainsn->ops[1], routine);
     x86_insn_t* inserting = cmp;
 
-    char* gte_label_name = x86_asm_file_create_next_label(file);
-    char* after_label_name = x86_asm_file_create_next_label(file);
+    char* gte_label_name = x86_asm_routine_create_next_label(routine);
+    char* after_label_name = x86_asm_routine_create_next_label(routine);
 
     x86_insn_t* jnb = make_basic_x86_insn(X86I_JNB);
     jnb->op1 = make_operand_label(gte_label_name);
@@ -2002,8 +2700,8 @@ x86_insn_t* x86_generate_u642sse(air_insn_t* ainsn, x86_asm_routine_t* routine,
     test->op2 = air_operand_to_x86_operand(ainsn->ops[1], routine);
     inserting = inserting->next = test;
 
-    char* gte_label_name = x86_asm_file_create_next_label(file);
-    char* after_label_name = x86_asm_file_create_next_label(file);
+    char* gte_label_name = x86_asm_routine_create_next_label(routine);
+    char* after_label_name = x86_asm_routine_create_next_label(routine);
 
     x86_insn_t* js = make_basic_x86_insn(X86I_JS);
     js->op1 = make_operand_label(gte_label_name);
@@ -2140,6 +2838,7 @@ x86_insn_t* x86_generate_insn(air_insn_t* ainsn, x86_asm_routine_t* routine, x86
             return x86_generate_conditional_jump(ainsn, routine, file);
 
         case AIR_JMP: return x86_generate_jmp(ainsn, routine, file);
+        case AIR_JMP_TABLE: return x86_generate_jmp_table(ainsn, routine, file);
         case AIR_LABEL: return x86_generate_label(ainsn, routine, file);
         case AIR_PUSH: return x86_generate_push(ainsn, routine, file);
 
@@ -2233,13 +2932,59 @@ x86_insn_t* x86_generate_insn(air_insn_t* ainsn, x86_asm_routine_t* routine, x86
     return NULL;
 }
 
-x86_asm_routine_t* x86_generate_routine(air_routine_t* aroutine, x86_asm_file_t* file)
+static x86_insn_t* x86_insn_chain(x86_insn_t* first, x86_insn_t* second)
+{
+    if (!first) return second;
+    x86_insn_t* last = first;
+    for (; last->next; last = last->next);
+    last->next = second;
+    return first;
+}
+
+// pushes or pops the nonvolatiles the allocator moved out of the prologue, in the order the prologue would
+static x86_insn_t* x86_generate_nonvolatile_saves(x86_asm_routine_t* routine, bool restoring)
+{
+    x86_insn_t* first = NULL;
+    x86_insn_t* last = NULL;
+    size_t count = sizeof(NONVOLATILE_FLAGS) / sizeof(NONVOLATILE_FLAGS[0]);
+    for (size_t j = 0; j < count; ++j)
+    {
+        size_t i = restoring ? count - 1 - j : j;
+        if (!(routine->wrapped_nonvolatiles & NONVOLATILE_FLAGS[i]))
+            continue;
+        x86_insn_t* insn = make_basic_x86_insn(restoring ? X86I_POP : X86I_PUSH);
+        insn->size = X86SZ_QWORD;
+        insn->op1 = make_operand_register(NONVOLATILE_REGISTERS[i]);
+        if (!last)
+            first = last = insn;
+        else
+            last = last->next = insn;
+    }
+    return first;
+}
+
+// the id has to be unique in the file, and is best the routine's position in it so the output doesn't depend on
+// the order routines are generated in
+x86_asm_routine_t* x86_generate_routine(air_routine_t* aroutine, uint64_t id, x86_asm_file_t* file)
 {
     x86_asm_routine_t* routine = calloc(1, sizeof *routine);
-    routine->id = ++file->next_routine_id;
+    routine->id = id;
+    routine->rodata = vector_init();
     routine->global = symbol_get_linkage(aroutine->sy) == LK_EXTERNAL;
     routine->label = strdup(symbol_get_name(aroutine->sy));
     routine->stackalloc = 0;
+    routine->omits_frame_pointer = aroutine->omits_frame_pointer;
+    routine->outgoing = aroutine->outgoing;
+    if (aroutine->wraps_nonvolatiles)
+        routine->wrapped_nonvolatiles = aroutine->used_nonvolatiles;
+    else
+        routine->used_nonvolatiles = aroutine->used_nonvolatiles;
+    if (aroutine->cold_label)
+    {
+        char buffer[4 + MAX_STRINGIFIED_INTEGER_LENGTH];
+        snprintf(buffer, sizeof(buffer), ".LB%llu", aroutine->cold_label);
+        routine->cold_label = strdup(buffer);
+    }
     if (aroutine->uses_varargs)
     {
         routine->stackalloc -= 176;
@@ -2252,6 +2997,14 @@ x86_asm_routine_t* x86_generate_routine(air_routine_t* aroutine, x86_asm_file_t*
         if (ainsn == aroutine->insns && ainsn->type == AIR_NOP)
             continue;
         x86_insn_t* insn = x86_generate_insn(ainsn, routine, file);
+        // saves go after the label starting their block, so every way in runs them
+        if (ainsn->metadata.saves_nonvolatiles)
+        {
+            x86_insn_t* saves = x86_generate_nonvolatile_saves(routine, false);
+            insn = ainsn->type == AIR_LABEL ? x86_insn_chain(insn, saves) : x86_insn_chain(saves, insn);
+        }
+        if (ainsn->metadata.restores_nonvolatiles)
+            insn = x86_insn_chain(x86_generate_nonvolatile_saves(routine, true), insn);
         if (!insn) continue;
         if (!last)
             routine->insns = last = insn;
@@ -2262,6 +3015,34 @@ x86_asm_routine_t* x86_generate_routine(air_routine_t* aroutine, x86_asm_file_t*
     return routine;
 }
 
+// the mergeable section a constant can go in, if any
+static x86_rodata_section_t rodata_section(c_type_t* ct, x86_asm_data_t* data)
+{
+    if (ct->class != CTC_ARRAY)
+    {
+        switch (data->length)
+        {
+            case 4: return X86RS_CST4;
+            case 8: return X86RS_CST8;
+            case 16: return X86RS_CST16;
+            default: return X86RS_RODATA;
+        }
+    }
+    // the linker splits strings at their terminators, so they can't have any others
+    size_t element = type_size(ct->derived_from);
+    if ((element != 1 && element != 4) || !data->length || data->length % element)
+        return X86RS_RODATA;
+    for (size_t i = 0; i < data->length; i += element)
+    {
+        bool zero = true;
+        for (size_t j = 0; j < element; ++j)
+            zero = zero && !data->data[i + j];
+        if (zero != (i + element == data->length))
+            return X86RS_RODATA;
+    }
+    return element == 1 ? X86RS_STR1 : X86RS_STR4;
+}
+
 x86_asm_data_t* x86_generate_data(air_data_t* adata, x86_asm_file_t* file)
 {
     x86_asm_data_t* data = calloc(1, sizeof *data);
@@ -2294,20 +3075,222 @@ x86_asm_data_t* x86_generate_data(air_data_t* adata, x86_asm_file_t* file)
     else
         data->label = strdup(symbol_get_name(adata->sy));
     data->readonly = adata->readonly;
+    // AIR's read-only data is only ever the literals and constants made up for the code, which have no linkage (even
+    // at file scope) and can all be pooled
+    data->global = !data->readonly && symbol_get_linkage(adata->sy) == LK_EXTERNAL;
+    if (data->readonly)
+        data->section = rodata_section(adata->sy->type, data);
+    if (data->section >= X86RS_CST4)
+        data->alignment = data->length;
     return data;
 }
 
-x86_asm_file_t* x86_generate(air_t* air, symbol_table_t* st)
+x86_asm_file_t* x86_asm_file_init(air_t* air, symbol_table_t* st)
 {
     x86_asm_file_t* file = calloc(1, sizeof *file);
     file->st = st;
     file->air = air;
     file->data = vector_init();
     file->rodata = vector_init();
+    file->profile = vector_init();
     file->routines = vector_init();
+    return file;
+}
 
-    VECTOR_FOR(air_routine_t*, routine, air->routines)
-        vector_add(file->routines, x86_generate_routine(routine, file));
+/*
+
+a finished routine is either kept in the file until the whole thing is written, or, when the file is streaming,
+written or encoded straight away and freed. streaming keeps only one routine's instructions alive at a time, and
+since the data sections come out after .text, they can still pick up the constants routines generate along the way.
+
+returns false if the routine couldn't be encoded into the object being streamed to.
+
+*/
+bool x86_asm_file_add_routine(x86_asm_file_t* file, x86_asm_routine_t* routine)
+{
+    VECTOR_FOR(x86_asm_data_t*, rodata, routine->rodata)
+        vector_add(file->rodata, rodata);
+    vector_delete(routine->rodata);
+    routine->rodata = NULL;
+    if (file->object_stream)
+    {
+        bool success = x86_asm_file_encode_routine(file, routine);
+        x86_asm_routine_delete(routine);
+        return success;
+    }
+    if (file->text_stream)
+    {
+        if (!file->text_started)
+            fprintf(file->text_stream, "    .text\n");
+        file->text_started = true;
+        x86_write_routine(routine, file->text_stream);
+        x86_asm_routine_delete(routine);
+        return true;
+    }
+    vector_add(file->routines, routine);
+    return true;
+}
+
+/*
+
+the constants in mergeable sections are pooled: the same bytes in the same section are only kept once, and a string
+that's the tail of another one (like "world\n" of "hello world\n") points into it instead of being kept on its own.
+what's dropped becomes an alias, a label at an offset into what it's pooled into. the sections being mergeable lets
+the linker do the same between objects, so the format strings and SSE masks every file has end up in the program
+once.
+
+tails are found by sorting the strings by their bytes read backwards, which puts every string right before the first
+of the ones it's a tail of (if any). going through them from the back, each one whose successor ends in it joins the
+successor wherever that went.
+
+*/
+
+static int rodata_comparator(x86_asm_data_t* a, x86_asm_data_t* b)
+{
+    if (a->section != b->section)
+        return a->section < b->section ? -1 : 1;
+    if (a->length != b->length)
+        return a->length < b->length ? -1 : 1;
+    return memcmp(a->data, b->data, a->length);
+}
+
+static unsigned long rodata_hash(x86_asm_data_t* data)
+{
+    unsigned long h = 14695981039346656037UL ^ data->section;
+    for (size_t i = 0; i < data->length; ++i)
+        h = (h ^ data->data[i]) * 1099511628211UL;
+    return h;
+}
+
+// by section, then by their bytes from the end, with a string right before the longer ones ending in it
+static int tail_comparator(const void* x, const void* y)
+{
+    x86_asm_data_t* a = *(x86_asm_data_t* const*) x;
+    x86_asm_data_t* b = *(x86_asm_data_t* const*) y;
+    if (a->section != b->section)
+        return a->section < b->section ? -1 : 1;
+    for (size_t i = 1; i <= a->length && i <= b->length; ++i)
+    {
+        unsigned char ca = a->data[a->length - i], cb = b->data[b->length - i];
+        if (ca != cb)
+            return ca < cb ? -1 : 1;
+    }
+    return (a->length > b->length) - (a->length < b->length);
+}
+
+static bool is_tail(x86_asm_data_t* tail, x86_asm_data_t* of)
+{
+    return tail->section == of->section && tail->length <= of->length &&
+        !memcmp(tail->data, of->data + of->length - tail->length, tail->length);
+}
+
+static int alias_comparator(const void* x, const void* y)
+{
+    x86_asm_alias_t* a = *(x86_asm_alias_t* const*) x;
+    x86_asm_alias_t* b = *(x86_asm_alias_t* const*) y;
+    return (a->offset > b->offset) - (a->offset < b->offset);
+}
+
+// makes what's at offset in host answer to the data's labels too, deleting the data
+static void pool_into(x86_asm_data_t* host, x86_asm_data_t* data, size_t offset)
+{
+    if (!host->aliases)
+        host->aliases = vector_init();
+    x86_asm_alias_t* alias = calloc(1, sizeof *alias);
+    alias->label = data->label;
+    alias->offset = offset;
+    vector_add(host->aliases, alias);
+    data->label = NULL;
+    if (data->aliases)
+    {
+        VECTOR_FOR(x86_asm_alias_t*, moved, data->aliases)
+        {
+            moved->offset += offset;
+            vector_add(host->aliases, moved);
+        }
+        vector_delete(data->aliases);
+        data->aliases = NULL;
+    }
+    x86_asm_data_delete(data);
+}
+
+static void x86_pool_rodata(x86_asm_file_t* file)
+{
+    map_t* kept = map_init((comparator_t) rodata_comparator, (hash_function_t) rodata_hash); // map_t<x86_asm_data_t*, x86_asm_data_t*>
+    vector_t* rodata = vector_init();
+    vector_t* strings = vector_init();
+    VECTOR_FOR(x86_asm_data_t*, data, file->rodata)
+    {
+        if (data->section == X86RS_RODATA || data->global)
+        {
+            vector_add(rodata, data);
+            continue;
+        }
+        x86_asm_data_t* same = map_get(kept, data);
+        if (same)
+        {
+            pool_into(same, data, 0);
+            continue;
+        }
+        map_add(kept, data, data);
+        vector_add(rodata, data);
+        if (data->section == X86RS_STR1 || data->section == X86RS_STR4)
+            vector_add(strings, data);
+    }
+    map_delete(kept);
+
+    if (strings->size > 1)
+    {
+        qsort(strings->data, strings->size, sizeof(void*), tail_comparator);
+        // where each string ends up: its host, and its offset in it
+        x86_asm_data_t** hosts = malloc(strings->size * sizeof(x86_asm_data_t*));
+        size_t* offsets = calloc(strings->size, sizeof(size_t));
+        map_t* pooled = map_init(pointer_comparator, pointer_hash); // map_t<x86_asm_data_t*, x86_asm_data_t*>
+        hosts[strings->size - 1] = vector_get(strings, strings->size - 1);
+        for (size_t i = strings->size - 1; i-- > 0;)
+        {
+            x86_asm_data_t* tail = vector_get(strings, i);
+            x86_asm_data_t* next = vector_get(strings, i + 1);
+            hosts[i] = tail;
+            if (!is_tail(tail, next))
+                continue;
+            hosts[i] = hosts[i + 1];
+            offsets[i] = offsets[i + 1] + next->length - tail->length;
+            map_add(pooled, tail, tail);
+        }
+        vector_t* remaining = vector_init();
+        VECTOR_FOR(x86_asm_data_t*, string, rodata)
+        {
+            if (!map_get(pooled, string))
+                vector_add(remaining, string);
+        }
+        vector_delete(rodata);
+        rodata = remaining;
+        // every string goes straight to its host, which is never pooled itself
+        for (size_t i = 0; i < strings->size; ++i)
+        {
+            if (hosts[i] != vector_get(strings, i))
+                pool_into(hosts[i], vector_get(strings, i), offsets[i]);
+        }
+        map_delete(pooled);
+        free(hosts);
+        free(offsets);
+    }
+    vector_delete(strings);
+
+    VECTOR_FOR(x86_asm_data_t*, host, rodata)
+    {
+        if (host->aliases)
+            qsort(host->aliases->data, host->aliases->size, sizeof(void*), alias_comparator);
+    }
+    vector_delete(file->rodata);
+    file->rodata = rodata;
+}
+
+// generates the data sections, once every routine has been generated
+void x86_generate_sections(x86_asm_file_t* file)
+{
+    air_t* air = file->air;
 
     VECTOR_FOR(air_data_t*, data, air->data)
         vector_add(file->data, x86_generate_data(data, file));
@@ -2315,5 +3298,29 @@ x86_asm_file_t* x86_generate(air_t* air, symbol_table_t* st)
     VECTOR_FOR(air_data_t*, rodata, air->rodata)
         vector_add(file->rodata, x86_generate_data(rodata, file));
 
+    VECTOR_FOR(air_data_t*, profile, air->profile)
+        vector_add(file->profile, x86_generate_data(profile, file));
+
+    if (file->sse32_zero_checker)
+        vector_add(file->rodata, x86_generate_sse_zero_checker(file->sse32_zero_checker, true));
+    if (file->sse64_zero_checker)
+        vector_add(file->rodata, x86_generate_sse_zero_checker(file->sse64_zero_checker, false));
+    if (file->sse32_i64_limit)
+        vector_add(file->rodata, x86_generate_sse_i64_limit(file->sse32_i64_limit, true));
+    if (file->sse64_i64_limit)
+        vector_add(file->rodata, x86_generate_sse_i64_limit(file->sse64_i64_limit, false));
+
+    x86_pool_rodata(file);
+}
+
+x86_asm_file_t* x86_generate(air_t* air, symbol_table_t* st)
+{
+    x86_asm_file_t* file = x86_asm_file_init(air, st);
+
+    VECTOR_FOR(air_routine_t*, routine, air->routines)
+        x86_asm_file_add_routine(file, x86_generate_routine(routine, i + 1, file));
+
+    x86_generate_sections(file);
+
     return file;
 }
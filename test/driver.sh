@@ -0,0 +1,270 @@
+#!/bin/bash
+
+# checks of the driver's modes, which take more than compiling one file and comparing what it prints.
+# the exec tests are their inputs, along with programs written out to a scratch directory
+
+declare -i passed=0
+declare -i count=0
+
+work=$(mktemp -d)
+trap 'rm -rf $work' EXIT
+
+exec_tests=$(find . -name '*_exec_*.c' | sort)
+
+printf "*** DRIVER RESULTS ***\n"
+
+# check <function>: the check passes if the function succeeds, and what it printed is shown if it doesn't
+check()
+{
+    if $1 &> $work/log; then
+        printf " - %s: pass\n" $1
+        passed=$(($passed + 1))
+    else
+        printf " - %s: FAIL\n%s\n" $1 "$(cat $work/log)"
+    fi
+    count=$(($count + 1))
+}
+
+# -C: compiling again gives back the bytes the first compilation stored, and skips everything after preprocessing
+cache()
+{
+    for filepath in $exec_tests
+    do
+        base=$(basename $filepath .c)
+        ../ecc -S -o $work/$base.s $filepath || return 1
+        ../ecc -C $work/cache -t -S -o $work/$base.miss.s $filepath &> $work/$base.miss.txt || return 1
+        ../ecc -C $work/cache -t -S -o $work/$base.hit.s $filepath &> $work/$base.hit.txt || return 1
+        grep -q "^  parse " $work/$base.miss.txt || { echo "$base: not compiled on a miss"; return 1; }
+        # compilations with diagnostics aren't stored, so that they're given again
+        if grep -q "^ecc: warning" $work/$base.miss.txt; then
+            diff <(grep "^ecc: warning" $work/$base.miss.txt) <(grep "^ecc: warning" $work/$base.hit.txt) || return 1
+        else
+            grep -q "^  parse " $work/$base.hit.txt && { echo "$base: compiled again on a hit"; return 1; }
+        fi
+        cmp $work/$base.s $work/$base.miss.s && cmp $work/$base.s $work/$base.hit.s || return 1
+        ../ecc -c -o $work/$base.o $filepath || return 1
+        ../ecc -C $work/cache -c -o $work/$base.miss.o $filepath || return 1
+        ../ecc -C $work/cache -c -o $work/$base.hit.o $filepath || return 1
+        cmp $work/$base.o $work/$base.miss.o && cmp $work/$base.o $work/$base.hit.o || return 1
+    done
+}
+
+# -s and -w: what a server compiles for its clients, at once, matches compiling directly, diagnostics and status included
+server()
+{
+    ../ecc -s $work/socket &
+    declare -i pid=$!
+    for i in $(seq 50); do [[ -S $work/socket ]] && break; sleep 0.1; done
+    [[ -S $work/socket ]] || { echo "the server never listened"; kill $pid; return 1; }
+
+    declare -i status=0
+    clients=()
+    for filepath in $exec_tests
+    do
+        base=$(basename $filepath .c)
+        ../ecc -w $work/socket -S -o $work/$base.served.s $filepath 2> $work/$base.served.txt &
+        clients+=($!)
+    done
+    wait ${clients[@]}
+    printf 'int main(void) { return x; }\n' > $work/undefined.c
+    ../ecc -w $work/socket -S -o $work/undefined.s $work/undefined.c &> $work/undefined.served.txt
+    [[ $? -ne 0 ]] || { echo "a failed compilation succeeded through the server"; status=1; }
+    ../ecc -S -o $work/undefined.s $work/undefined.c &> $work/undefined.txt
+    diff $work/undefined.txt $work/undefined.served.txt || status=1
+    kill -0 $pid || { echo "the server didn't outlive its requests"; return 1; }
+    kill $pid
+    wait $pid
+
+    for filepath in $exec_tests
+    do
+        base=$(basename $filepath .c)
+        ../ecc -S -o $work/$base.s $filepath 2> $work/$base.txt || status=1
+        cmp $work/$base.s $work/$base.served.s && diff $work/$base.txt $work/$base.served.txt || status=1
+    done
+    return $status
+}
+
+# -H and -u: a file with a precompiled header as its prefix compiles the same as one that includes the header, and a
+# header from another version of the format, or one cut short, is turned away instead of read
+pch()
+{
+    d=$work/pch
+    mkdir -p $d
+    printf '#ifndef GUARDED_H\n#define GUARDED_H\nstatic int guarded(int x) { return x * 3; }\n#endif\n' > $d/guarded.h
+    cat > $d/common.h << 'EOF'
+#include "guarded.h"
+int printf(char* fmt, ...);
+#define SQUARE(x) ((x) * (x))
+#define JOIN(a, b) a##b
+#define SHOW(...) printf(__VA_ARGS__)
+struct point { int x, y; };
+static int dot(struct point* a, struct point* b) { return a->x * b->x + a->y * b->y; }
+EOF
+    # the guard the header left defined keeps its include from being read again
+    cat > $d/body.c << 'EOF'
+#include "guarded.h"
+int main(void)
+{
+    struct point p = { 3, 4 };
+    int JOIN(val, ue) = SQUARE(p.x + 1) + dot(&p, &p);
+    SHOW("%d %d\n", value, guarded(value));
+    return 0;
+}
+EOF
+    { printf '#include "common.h"\n'; cat $d/body.c; } > $d/included.c
+    printf '41 123\n' > $d/expected
+
+    ../ecc -H -o $d/common.pch $d/common.h && [[ -s $d/common.pch ]] || return 1
+    ../ecc -u $d/common.pch -S -o $d/prefixed.s $d/body.c && ../ecc -S -o $d/included.s $d/included.c || return 1
+    cmp $d/included.s $d/prefixed.s || return 1
+    as -o $d/prefixed.o $d/prefixed.s && ld -o $d/program $d/prefixed.o ../libc/libc.a ../libecc/libecc.a || return 1
+    $d/program > $d/actual && diff $d/expected $d/actual || return 1
+
+    # the version is the word after the six bytes of the magic
+    cp $d/common.pch $d/version.pch
+    printf '\x63' | dd of=$d/version.pch bs=1 seek=6 conv=notrunc status=none
+    head -c $(($(stat -c %s $d/common.pch) / 2)) $d/common.pch > $d/short.pch
+    for bad in version short
+    do
+        ../ecc -u $d/$bad.pch -S -o $d/$bad.s $d/body.c &> $d/$bad.txt && { echo "$bad.pch was read"; return 1; }
+        grep -q "could not read precompiled header" $d/$bad.txt || { cat $d/$bad.txt; return 1; }
+    done
+}
+
+# -M, -MM, -MD, -MMD and -MF: the rules written, from the top directory, since <...> is found from there
+dependencies()
+(
+    d=$work/dependencies
+    mkdir -p $d/sub
+    printf '#include "local.h"\n#include <stdbool.h>\n#include "my file.h"\nint main(void) { return VALUE + SPACED; }\n' > $d/main.c
+    printf '#include "sub/other.h"\n#include "sub/other.h"\n#define VALUE OTHER\n' > $d/local.h
+    printf '#ifndef OTHER\n#define OTHER 3\n#endif\n' > $d/sub/other.h
+    printf '#define SPACED 1\n' > "$d/my file.h"
+    cd ..
+
+    # every header once, in the order first included, with the system ones left out of the double-M forms
+    printf '%s: %s/main.c \\\n  %s/local.h \\\n  %s/sub/other.h \\\n  libc/include/stdbool.h \\\n  %s/my\\ file.h\n' \
+        $d/main.o $d $d $d $d > $d/expected.M
+    grep -v stdbool $d/expected.M > $d/expected.MM
+
+    # -M and -MM write the rule instead of compiling, to stdout, -MF, or -o
+    ./ecc -M $d/main.c > $d/M.d && diff $d/expected.M $d/M.d || return 1
+    ./ecc -MM $d/main.c > $d/MM.d && diff $d/expected.MM $d/MM.d || return 1
+    ./ecc -M -MF $d/MF.d $d/main.c > $d/stdout && diff $d/expected.M $d/MF.d && [[ ! -s $d/stdout ]] || return 1
+    ./ecc -MM -o $d/o.d $d/main.c && diff $d/expected.MM $d/o.d || return 1
+    [[ ! -e $d/main.o ]] || { echo "-M compiled"; return 1; }
+
+    # -MD and -MMD compile too, with the output as the target and the rule next to it
+    ./ecc -MMD -c -o $d/out.o $d/main.c && [[ -s $d/out.o ]] || return 1
+    sed "s|^$d/main.o:|$d/out.o:|" $d/expected.MM | diff - $d/out.d || return 1
+    ./ecc -MD -MF $d/S.d -S -o $d/main.s $d/main.c && [[ -s $d/main.s ]] || return 1
+    sed "s|^$d/main.o:|$d/main.s:|" $d/expected.M | diff - $d/S.d || return 1
+)
+
+# -O0, -O1 and -Os: the exec tests print what they print at -O2, the default test.sh runs them at. so do they at -O2
+# with -e, which writes the object itself instead of going through as
+levels()
+{
+    declare -i status=0
+    for level in -O0 -O1 -Os -e
+    do
+        for filepath in $exec_tests
+        do
+            base=$(basename $filepath .c)
+            expectedfile=expected/$base.txt
+            [[ -a $expectedfile ]] || expectedfile=/dev/null
+            if [[ $level == -e ]]; then
+                ../ecc -c -e -o $work/$base.o $filepath 2> /dev/null
+            else
+                ../ecc $level -S -o $work/$base.s $filepath 2> /dev/null && as -o $work/$base.o $work/$base.s
+            fi &&
+                ld -o $work/$base $work/$base.o ../libc/libc.a ../libecc/libecc.a || { echo "$base $level: didn't build"; status=1; continue; }
+            $work/$base &> $work/$base.txt
+            [[ $? -lt 128 ]] && diff -q $work/$base.txt $expectedfile > /dev/null || { echo "$base $level: FAIL"; status=1; }
+        done
+    done
+    return $status
+}
+
+# pooled constants: a string used in two objects, or ending another, is in the linked program once
+rodata()
+{
+    d=$work/rodata
+    mkdir -p $d
+    printf 'int printf(char* fmt, ...);\nint shared(void);\n' > $d/main.c
+    printf 'int main(void) { printf("pooled %%d\\n", 1); printf("qzx pooled tail\\n"); printf("pooled tail\\n"); return shared(); }\n' >> $d/main.c
+    printf 'int printf(char* fmt, ...);\nint shared(void) { printf("pooled %%d\\n", 2); return 0; }\n' > $d/shared.c
+    printf 'pooled 1\nqzx pooled tail\npooled tail\npooled 2\n' > $d/expected
+    for emit in as -e
+    do
+        for base in main shared
+        do
+            if [[ $emit == as ]]; then
+                ../ecc -S -o $d/$base.s $d/$base.c && as -o $d/$base.o $d/$base.s || return 1
+            else
+                ../ecc -c -e -o $d/$base.o $d/$base.c || return 1
+            fi
+        done
+        ld -o $d/program $d/main.o $d/shared.o ../libc/libc.a ../libecc/libecc.a || return 1
+        $d/program > $d/actual && diff $d/expected $d/actual || return 1
+        [[ $(grep -a -o "pooled %d" $d/program | wc -l) -eq 1 ]] || { echo "$emit: a shared string is in the program twice"; return 1; }
+        [[ $(grep -a -o "pooled tail" $d/program | wc -l) -eq 1 ]] || { echo "$emit: a string's tail is in the program twice"; return 1; }
+    done
+}
+
+# -W: files merged into one program run the same as when they're compiled apart, with same-named statics kept apart
+whole_program()
+(
+    d=$work/whole_program
+    mkdir -p $d
+    cat > $d/main.c << 'EOF'
+int printf(char* fmt, ...);
+int scale(int x, int by);
+int bump(void);
+extern int total;
+static int counter = 100;
+static char* name = "main";
+static int helper(int x) { return x + counter++; }
+int main(void)
+{
+    int a = helper(1);
+    int b = bump();
+    int c = bump();
+    printf("%s %d %d %d\n", name, a, b, c);
+    printf("%d %d\n", scale(7, 6), total);
+    return 0;
+}
+EOF
+    cat > $d/lib.c << 'EOF'
+static int counter = 5;
+static char* name = "lib";
+int total = 40;
+static int helper(int x) { return x * 2 + name[0]; }
+int scale(int x, int by) { return x * by; }
+int bump(void) { total += 2; return helper(counter++); }
+int unreachable_routine(void) { return helper(total); }
+EOF
+    printf 'main 101 118 120\n42 44\n' > $d/expected
+
+    link() { ld -o $d/program "$@" ../libc/libc.a ../libecc/libecc.a && $d/program > $d/actual && diff $d/expected $d/actual; }
+
+    # compiled apart, to check the program itself
+    ../ecc -c -o $d/main.o $d/main.c && ../ecc -c -o $d/lib.o $d/lib.c && link $d/main.o $d/lib.o || return 1
+    ../ecc -W -S -o $d/whole.s $d/main.c $d/lib.c && as -o $d/whole.o $d/whole.s && link $d/whole.o || return 1
+    ! grep -q unreachable_routine $d/whole.s || { echo "a routine main can't reach was kept"; return 1; }
+    ../ecc -W -c -o $d/whole.o $d/main.c $d/lib.c && link $d/whole.o || return 1
+    ../ecc -W -c -e -o $d/whole.o $d/main.c $d/lib.c && link $d/whole.o || return 1
+    # linking finds the libraries from the top directory
+    cd .. && ./ecc -W -o $d/program $d/main.c $d/lib.c && $d/program > $d/actual && diff $d/expected $d/actual
+)
+
+check cache
+check server
+check pch
+check dependencies
+check levels
+check rodata
+check whole_program
+
+[[ $count -eq 1 ]] && c="" || c="s"
+printf "passed %d/%d check%s\n" "$passed" "$count" "$c"
@@ -0,0 +1,66 @@
+/* identifiers, whitespace and comments, which are scanned sixteen bytes at a time, across blocks and line splices */
+
+#include "../test.h"
+
+// names of 15, 16, 17, 31, 32 and 33 characters, ending on either side of a block
+int abcdefghijklmno = 15;
+int abcdefghijklmnop = 16;
+int abcdefghijklmnopq = 17;
+int abcdefghijklmnopqrstuvwxyz01234 = 31;
+int abcdefghijklmnopqrstuvwxyz012345 = 32;
+int abcdefghijklmnopqrstuvwxyz0123456 = 33;
+int _0123456789_ABCDEFGHIJKLMNOPQRSTUVWXYZ_abcdefghijklmnopqrstuvwxyz_ = 64;
+
+// the same names, spliced before, at, and after the end of a block
+static int spliced_names(void)
+{
+    return abcdefghijklmno\
++ abcdefghijklmno\
+p + abcdefghijklmnop\
+q + abcdefghijklmnopqrstuvwxyz0\
+1234 + abcdefghijklmnopqrstuvwxyz01234\
+5 + a\
+bcdefghijklmnopqrstuvwxyz0123456 + _0123456789_ABCDEFGHIJKLMNOPQRSTUVWXYZ_abcdefghijklmnopqrstuv\
+wxyz_;
+}
+
+// runs of spaces, tabs, vertical tabs and form feeds, some broken by splices
+static int spaced(void)
+{
+    int a = 1;                                    int b = 2;
+	int	c	=			3;
+    int d = 4; int e = 5;
+    return a +                \
+                              b + \
+c\
++ d * e;
+}
+
+static int commented(void)
+{
+    int x = 1;
+    // a line comment that a splice carries onto the next line \
+    x = 100;
+    // a line comment several blocks long, with stars * and question marks ? and ?? that aren't a trigraph ?? ? ?
+    x += 2;
+    /* a block comment with ** stars, a * / lookalike, and a ??) trigraph,
+       over more than one line and several blocks, ending after a run of stars ****/ x += 4;
+    /* closed by a spliced star and slash *\
+/ x += 8;
+    /\
+* opened by a spliced slash and star */ x += 16;
+    /\
+/ a line comment opened by a spliced pair of slashes
+    x += 32;
+    /*****************************************************************/ x += 64;
+    return x;
+}
+
+int main(void)
+{
+    printf("%d\n", spliced_names());
+    printf("%d\n", spaced());
+    printf("%d\n", commented());
+    // lines still counted across the runs skipped above, and the splices in them
+    printf("%d\n", __LINE__);
+}
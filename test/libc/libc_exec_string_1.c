@@ -0,0 +1,208 @@
+/* the SSE2 string and memory routines, at every alignment and up against a page that can't be read */
+
+#include "../test.h"
+#include "../../libc/include/string.h"
+
+#define PAGE 4096
+
+static int checks;
+static int failures;
+
+static void check(int ok, char* what, int a, int b)
+{
+    ++checks;
+    if (ok) return;
+    if (++failures <= 10)
+        printf("%s failed at %d %d\n", what, a, b);
+}
+
+static int sign(int x)
+{
+    return x < 0 ? -1 : x > 0;
+}
+
+// the same comparisons done a byte at a time, with the bytes unsigned
+static int slow_memcmp(unsigned char* a, unsigned char* b, int n)
+{
+    for (int i = 0; i < n; ++i)
+        if (a[i] != b[i])
+            return a[i] < b[i] ? -1 : 1;
+    return 0;
+}
+
+static int slow_strcmp(unsigned char* a, unsigned char* b)
+{
+    for (; *a && *a == *b; ++a, ++b);
+    return *a < *b ? -1 : *a > *b;
+}
+
+static char source[256];
+static char target[256];
+static char reference[256];
+
+static void fill(char* p, int n, int seed)
+{
+    for (int i = 0; i < n; ++i)
+        p[i] = (char) ((i * 7 + seed) % 251 + 1);
+}
+
+static int lengths[] = { 0, 1, 2, 7, 15, 16, 17, 31, 32, 33, 47, 63, 64, 65, 100 };
+#define LENGTHS ((int) (sizeof lengths / sizeof lengths[0]))
+
+static void unaligned_memory(void)
+{
+    for (int so = 0; so < 16; ++so)
+    {
+        for (int doff = 0; doff < 16; ++doff)
+        {
+            for (int l = 0; l < LENGTHS; ++l)
+            {
+                int n = lengths[l];
+                fill(source, 256, so);
+                fill(target, 256, 100 + doff);
+                fill(reference, 256, 100 + doff);
+                for (int i = 0; i < n; ++i)
+                    reference[doff + i] = source[so + i];
+                check(memcpy(target + doff, source + so, n) == target + doff, "memcpy result", so, n);
+                check(!slow_memcmp((unsigned char*) target, (unsigned char*) reference, 256), "memcpy", so * 16 + doff, n);
+
+                fill(target, 256, 100 + doff);
+                fill(reference, 256, 100 + doff);
+                for (int i = 0; i < n; ++i)
+                    reference[doff + i] = (char) 0xA5;
+                check(memset(target + doff, 0xA5, n) == target + doff, "memset result", doff, n);
+                check(!slow_memcmp((unsigned char*) target, (unsigned char*) reference, 256), "memset", doff, n);
+
+                // equal, then differing at the last byte, with the difference above and below 128
+                fill(target, 256, 0);
+                for (int i = 0; i < n; ++i)
+                    target[doff + i] = source[so + i];
+                check(memcmp(target + doff, source + so, n) == 0, "memcmp equal", so * 16 + doff, n);
+                if (n)
+                {
+                    target[doff + n - 1] = (char) 0xF0;
+                    check(sign(memcmp(target + doff, source + so, n)) ==
+                        slow_memcmp((unsigned char*) target + doff, (unsigned char*) source + so, n), "memcmp", so, n);
+                    check(sign(memcmp(source + so, target + doff, n)) ==
+                        slow_memcmp((unsigned char*) source + so, (unsigned char*) target + doff, n), "memcmp reversed", so, n);
+                }
+
+                // a byte that's only present past the end, and one at the end
+                fill(source, 256, so);
+                source[so + n] = 0;
+                check(memchr(source + so, 0, n) == NULL, "memchr past end", so, n);
+                if (n)
+                {
+                    source[so + n - 1] = (char) 0xFE;
+                    check(memchr(source + so, 0xFE, n) == source + so + n - 1, "memchr", so, n);
+                }
+            }
+        }
+    }
+}
+
+static void overlapping_moves(void)
+{
+    for (int so = 0; so < 16; ++so)
+    {
+        for (int shift = -17; shift <= 17; ++shift)
+        {
+            for (int l = 0; l < LENGTHS; ++l)
+            {
+                int n = lengths[l];
+                int from = 64 + so;
+                int to = from + shift;
+                fill(target, 256, so);
+                fill(reference, 256, so);
+                for (int i = 0; i < n; ++i)
+                    reference[to + i] = target[from + i];
+                check(memmove(target + to, target + from, n) == target + to, "memmove result", so, n);
+                check(!slow_memcmp((unsigned char*) target, (unsigned char*) reference, 256), "memmove", so * 100 + shift, n);
+            }
+        }
+    }
+}
+
+static void unaligned_strings(void)
+{
+    for (int so = 0; so < 16; ++so)
+    {
+        for (int doff = 0; doff < 16; ++doff)
+        {
+            for (int l = 0; l < LENGTHS; ++l)
+            {
+                int n = lengths[l];
+                fill(source, 256, so);
+                source[so + n] = 0;
+                fill(target, 256, so);
+                target[doff + n] = 0;
+                for (int i = 0; i < n; ++i)
+                    target[doff + i] = source[so + i];
+                check(strlen(source + so) == (unsigned long) n, "strlen", so, n);
+                check(strchr(source + so, 0) == source + so + n, "strchr terminator", so, n);
+                check(strcmp(source + so, target + doff) == 0, "strcmp equal", so * 16 + doff, n);
+                if (n)
+                {
+                    check(strchr(source + so, source[so + n - 1]) ==
+                        memchr(source + so, source[so + n - 1], n), "strchr", so, n);
+                    target[doff + n - 1] = (char) 0x80;
+                    check(sign(strcmp(source + so, target + doff)) ==
+                        slow_strcmp((unsigned char*) source + so, (unsigned char*) target + doff), "strcmp", so, n);
+                    // one string a prefix of the other
+                    target[doff + n - 1] = 0;
+                    check(sign(strcmp(source + so, target + doff)) == 1, "strcmp prefix", so, n);
+                }
+                check(strchr(source + so, 0xFF) == NULL, "strchr missing", so, n);
+            }
+        }
+    }
+}
+
+// strings and ranges whose last byte is the last byte of a page, with the page after it unreadable
+static void page_ends(char* end)
+{
+    for (int n = 0; n < 80; ++n)
+    {
+        char* s = end - n - 1;
+        fill(s, n, n);
+        s[n] = 0;
+        fill(source, 256, n);
+        source[n] = 0;
+        check(strlen(s) == (unsigned long) n, "strlen at page end", n, 0);
+        check(strchr(s, 0) == s + n, "strchr at page end", n, 0);
+        check(strchr(s, 0xFF) == NULL, "strchr missing at page end", n, 0);
+        check(strcmp(s, source) == 0 && strcmp(source, s) == 0, "strcmp at page end", n, 0);
+
+        char* m = end - n;
+        fill(m, n, n);
+        check(memchr(m, 0, n) == NULL, "memchr at page end", n, 0);
+        check(memcmp(m, source, n) == 0, "memcmp at page end", n, 0);
+        check(memcpy(target, m, n) == target && memcmp(target, source, n) == 0, "memcpy from page end", n, 0);
+        fill(source, 256, n + 1);
+        check(memcpy(m, source, n) == m && memcmp(m, source, n) == 0, "memcpy to page end", n, 0);
+        check(memset(m, 'x', n) == m && (n == 0 || (m[0] == 'x' && m[n - 1] == 'x')), "memset to page end", n, 0);
+        if (n > 1)
+        {
+            fill(m, n, 3);
+            fill(reference, n, 3);
+            check(memmove(m + 1, m, n - 1) == m + 1 && memcmp(m + 1, reference, n - 1) == 0, "memmove to page end", n, 0);
+        }
+    }
+}
+
+int main(void)
+{
+    unaligned_memory();
+    overlapping_moves();
+    unaligned_strings();
+
+    // two pages no one can touch, with the first made readable again, so the second is a guard after it
+    char* region = __ecc_lsys_mmap((char*) 0, 2 * PAGE, 0, 0x22, -1, 0);
+    char* page = __ecc_lsys_mmap(region, PAGE, 3, 0x32, -1, 0);
+    if (page != region)
+        printf("could not map the pages\n");
+    else
+        page_ends(page + PAGE);
+
+    printf("%d checks, %d failures\n", checks, failures);
+}
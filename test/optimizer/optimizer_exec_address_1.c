@@ -0,0 +1,73 @@
+/* folding address arithmetic into memory operands, and lea */
+
+#include "../test.h"
+
+struct point
+{
+    int x, y;
+    long z;
+};
+
+static int scales(int i)
+{
+    char cs[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    short ss[8] = { 10, 20, 30, 40, 50, 60, 70, 80 };
+    int is[8] = { 100, 200, 300, 400, 500, 600, 700, 800 };
+    long ls[8] = { 1000, 2000, 3000, 4000, 5000, 6000, 7000, 8000 };
+    return cs[i] + ss[i + 1] + is[i + 2] + (int) ls[i + 3];
+}
+
+static int negative_index(int* p, int i)
+{
+    // the index is sign-extended before it's scaled
+    return p[i] + p[i - 1] + *(p - 2);
+}
+
+static int members(struct point* ps, int i)
+{
+    return ps[i].x + ps[i].y * 10 + (int) ps[i + 1].z * 100;
+}
+
+static long lea_shapes(long a, long b)
+{
+    long r = a + b * 4 + 7;
+    long s = a * 3;
+    long t = a * 9 - 5;
+    long u = b + a * 8;
+    return r + s * 10 + t * 100 + u * 1000;
+}
+
+static int pointer_walk(int* p, int n)
+{
+    int total = 0;
+    for (int* q = p + n - 1; q >= p; q -= 2)
+        total = total * 2 + *q;
+    return total;
+}
+
+static int negative_loops(int* p, int* q)
+{
+    // a loop's index starts out negative, both where it's strength-reduced and where it's vectorized
+    int total = 0;
+    for (int i = -3; i < 3; ++i)
+        total = total * 3 + p[i];
+    for (int i = -5; i < 4; ++i)
+        q[i] = q[i] + p[i];
+    for (int i = -5; i < 4; ++i)
+        total = total * 2 + q[i];
+    return total;
+}
+
+int main(void)
+{
+    printf("%d %d\n", scales(0), scales(4));
+    int xs[] = { 1, 2, 3, 4, 5, 6 };
+    printf("%d %d\n", negative_index(xs + 4, 1), negative_index(xs + 4, -1));
+    struct point ps[3] = { { 1, 2, 3 }, { 4, 5, 6 }, { 7, 8, 9 } };
+    printf("%d %d\n", members(ps, 0), members(ps, 1));
+    printf("%d\n", (int) lea_shapes(2, 3));
+    printf("%d\n", pointer_walk(xs, 6));
+    int ys[] = { 9, 8, 7, 6, 5, 4, 3, 2, 1 };
+    int zs[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    printf("%d\n", negative_loops(ys + 5, zs + 5));
+}
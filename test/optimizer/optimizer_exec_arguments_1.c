@@ -0,0 +1,90 @@
+/* call arguments marshalled into their registers and the outgoing argument area */
+
+#include "../test.h"
+
+struct pair { int a, b; };
+struct mixed { double d; long l; };
+struct floats { float x, y; int z; };
+struct doubles { double x, y; };
+struct big { long a, b, c; };
+struct bytes { char c[3]; short s; };
+struct longs { long a, b; };
+union number { double d; long l; };
+
+// more integers than there are registers, of every width
+static long integers(char a, short b, int c, long d, unsigned e, unsigned char f, int g, long h, short i, int j)
+{
+    return a + b * 2 + c * 3 + d * 4 + e * 5 + f * 6 + g * 7 + h * 8 + i * 9 + j * 10;
+}
+
+// more floating arguments than there are SSE registers, with a float on the stack
+static double floating(double a, float b, double c, double d, float e, double f, double g, double h, double i, float j, double k)
+{
+    return a + b * 2 + c * 3 + d * 4 + e * 5 + f * 6 + g * 7 + h * 8 + i * 9 + j * 10 + k * 11;
+}
+
+static double interleaved(int a, double b, long c, float d, int e, double f, long g, double h, int i, double j,
+    long k, double l, int m, double n, long o, double p, int q, double r)
+{
+    return a + b + c * 2 + d * 2 + e * 3 + f * 3 + g * 4 + h * 4 + i * 5 + j * 5 + k * 6 + l * 6 + m * 7 + n * 7 +
+        o * 8 + p * 8 + q * 9 + r * 9;
+}
+
+static long aggregates(struct pair p, struct mixed m, struct floats f, struct doubles d, struct big b, struct bytes y, union number n)
+{
+    return p.a + p.b * 2 + (long) m.d * 3 + m.l * 4 + (long) (f.x * 5) + (long) (f.y * 6) + f.z * 7 + (long) (d.x * 8) +
+        (long) (d.y * 9) + b.a * 10 + b.b * 11 + b.c * 12 + y.c[0] * 13 + y.c[2] * 14 + y.s * 15 + n.l % 1000;
+}
+
+// five integers leave one register, so the pair of longs goes on the stack whole and the int after it takes the register
+static long leftover(int a, int b, int c, int d, int e, struct longs l, int f)
+{
+    return a + b * 2 + c * 3 + d * 4 + e * 5 + l.a * 6 + l.b * 7 + f * 8;
+}
+
+// seven doubles leave one SSE register, which the pair of doubles can't fit in
+static double leftover_sse(double a, double b, double c, double d, double e, double f, double g, struct doubles p, double h)
+{
+    return a + b * 2 + c * 3 + d * 4 + e * 5 + f * 6 + g * 7 + p.x * 8 + p.y * 9 + h * 10;
+}
+
+static int twice(int x)
+{
+    return x * 2;
+}
+
+static long count_down(long a, long b, long c, long d, long e, long f, long g, long n)
+{
+    if (n == 0)
+        return a + b + c + d + e + f + g;
+    return count_down(b, c, d, e, f, g, a + n, n - 1);
+}
+
+int main(void)
+{
+    printf("%d\n", (int) integers(-1, -300, 70000, -5000000000L, 4000000000u, 250, -7, 8, -9, 10));
+    printf("%d\n", (int) floating(1.5, 2.25f, 3, 4, -5.5f, 6, 7, 8, 9, 10.75f, 11));
+    printf("%d\n", (int) interleaved(1, 1.5, 2, 2.5f, 3, 3.5, 4, 4.5, 5, 5.5, 6, 6.5, 7, 7.5, 8, 8.5, 9, 9.5));
+
+    struct pair p = { 3, -4 };
+    struct mixed m = { 5.75, 6 };
+    struct floats f = { 1.5f, 2.5f, 7 };
+    struct doubles d = { 8.25, 9.5 };
+    struct big b = { 10, 11, 12 };
+    struct bytes y = { { 'a', 'b', 'c' }, -300 };
+    union number n = { .l = 123456 };
+    printf("%d\n", (int) aggregates(p, m, f, d, b, y, n));
+
+    struct longs l = { 600, 700 };
+    printf("%d\n", (int) leftover(1, 2, 3, 4, 5, l, 8));
+    printf("%d\n", (int) leftover_sse(1, 2, 3, 4, 5, 6, 7, d, 10));
+
+    // arguments that are calls themselves, which need the registers the outer call is being set up in
+    int x = 5;
+    printf("%d\n", (int) integers(twice(1), twice(x), twice(3), twice(4), twice(x + 1), twice(6), twice(7), twice(8), twice(9), twice(10)));
+    printf("%d\n", (int) leftover(twice(x), x, twice(twice(x)), x - 1, twice(x - 2), l, twice(x + 3)));
+
+    long (*fp)(int, int, int, int, int, struct longs, int) = leftover;
+    printf("%d\n", (int) fp(8, 7, 6, 5, 4, l, 3));
+    printf("%d\n", (int) count_down(1, 2, 3, 4, 5, 6, 7, 20));
+}
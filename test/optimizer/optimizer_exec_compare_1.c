@@ -0,0 +1,103 @@
+/* comparisons fused into the conditional jumps that test them */
+
+#include "../test.h"
+
+// each comparison as a branch, one bit apiece
+#define BRANCHES(a, b) \
+    (((a) < (b) ? 1 : 0) | ((a) <= (b) ? 2 : 0) | ((a) > (b) ? 4 : 0) | \
+    ((a) >= (b) ? 8 : 0) | ((a) == (b) ? 16 : 0) | ((a) != (b) ? 32 : 0))
+
+// each comparison as a value, which still has to be materialized
+#define VALUES(a, b) \
+    (((a) < (b)) | ((a) <= (b)) << 1 | ((a) > (b)) << 2 | ((a) >= (b)) << 3 | ((a) == (b)) << 4 | ((a) != (b)) << 5)
+
+static int branches_int(int a, int b) { return BRANCHES(a, b); }
+static int values_int(int a, int b) { return VALUES(a, b); }
+static int branches_unsigned(unsigned a, unsigned b) { return BRANCHES(a, b); }
+static int values_unsigned(unsigned a, unsigned b) { return VALUES(a, b); }
+static int branches_long(long a, long b) { return BRANCHES(a, b); }
+static int branches_unsigned_long(unsigned long a, unsigned long b) { return BRANCHES(a, b); }
+static int branches_char(char a, char b) { return BRANCHES(a, b); }
+static int branches_unsigned_char(unsigned char a, unsigned char b) { return BRANCHES(a, b); }
+static int branches_pointer(int* a, int* b) { return BRANCHES(a, b); }
+static int branches_float(float a, float b) { return BRANCHES(a, b); }
+static int values_float(float a, float b) { return VALUES(a, b); }
+static int branches_double(double a, double b) { return BRANCHES(a, b); }
+static int values_double(double a, double b) { return VALUES(a, b); }
+
+// against constants, on either side
+static int constants(int a)
+{
+    int r = 0;
+    if (a < 5) r |= 1;
+    if (7 <= a) r |= 2;
+    if (a == -1) r |= 4;
+    if (0 != a) r |= 8;
+    if (a > 0) r |= 16;
+    return r;
+}
+
+// the negation of a comparison, and comparisons joined by && and ||
+static int logic(int a, int b, double x, double y)
+{
+    int r = 0;
+    if (!(a < b)) r |= 1;
+    if (!(x < y)) r |= 2;
+    if (a < b && x < y) r |= 4;
+    if (a == b || x == y) r |= 8;
+    if (!(x != y)) r |= 16;
+    return r;
+}
+
+static int count_down(long n, double limit)
+{
+    int steps = 0;
+    for (double d = 0; d < limit && n > 0; d += 1.5, --n)
+        ++steps;
+    while (n >= 3)
+        n -= 3, ++steps;
+    return steps;
+}
+
+int main(void)
+{
+    int ints[] = { -2147483647, -3, 0, 3, 2147483647 };
+    for (int i = 0; i < 5; ++i)
+    {
+        for (int j = 0; j < 5; ++j)
+        {
+            int b = branches_int(ints[i], ints[j]);
+            printf("%d %d %d", b, b == values_int(ints[i], ints[j]), branches_unsigned(ints[i], ints[j]));
+            printf(" %d %d\n", branches_unsigned(ints[i], ints[j]) == values_unsigned(ints[i], ints[j]),
+                branches_long(ints[i], ints[j]) == b);
+        }
+    }
+    long longs[] = { -4294967296L, -1, 0, 4294967296L };
+    for (int i = 0; i < 4; ++i)
+    {
+        for (int j = 0; j < 4; ++j)
+            printf("%d %d ", branches_long(longs[i], longs[j]), branches_unsigned_long(longs[i], longs[j]));
+        printf("\n");
+    }
+    printf("%d %d %d %d\n", branches_char(-1, 1), branches_unsigned_char(255, 1), branches_char('a', 'a'), branches_unsigned_char(0, 200));
+    int xs[2];
+    printf("%d %d %d\n", branches_pointer(xs, xs + 1), branches_pointer(xs + 1, xs), branches_pointer(xs, xs));
+
+    double zero = 0;
+    double nan = zero / zero;
+    double doubles[] = { -1.5, 0, 0.25, 1e300, nan };
+    for (int i = 0; i < 5; ++i)
+    {
+        for (int j = 0; j < 5; ++j)
+        {
+            int b = branches_double(doubles[i], doubles[j]);
+            int f = branches_float((float) doubles[i], (float) doubles[j]);
+            printf("%d %d %d ", b, b == values_double(doubles[i], doubles[j]), f == values_float((float) doubles[i], (float) doubles[j]));
+        }
+        printf("\n");
+    }
+
+    printf("%d %d %d %d %d\n", constants(-1), constants(0), constants(5), constants(7), constants(100));
+    printf("%d %d %d %d\n", logic(1, 2, 1, 2), logic(2, 1, 2, 1), logic(1, 1, nan, 0), logic(1, 2, nan, nan));
+    printf("%d %d %d\n", count_down(10, 6), count_down(2, 100), count_down(20, nan));
+}
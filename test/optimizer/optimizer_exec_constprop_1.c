@@ -0,0 +1,64 @@
+/* constant propagation and folding */
+
+#include "../test.h"
+
+static int pick(int k)
+{
+    int x = 3;
+    int y;
+    // only one side is reachable once k is known, but both give the same value anyway
+    if (k > 0)
+        y = x * 4;
+    else
+        y = 12;
+    return y + k;
+}
+
+static int fold_through_branches(void)
+{
+    int a = 10;
+    int b = a * 2 - 5;
+    int c;
+    if (b == 15)
+        c = b << 2;
+    else
+        c = -1;
+    while (c > 100)
+        c = 0;
+    return c;
+}
+
+static int narrow(void)
+{
+    // constants have to be folded at the width the instructions use them at
+    char c = (char) 300;
+    unsigned char uc = (unsigned char) -1;
+    short s = (short) 70000;
+    unsigned int u = 0xffffffffu;
+    u = u + 2;
+    int shifted = (int) (1u << 31) >> 31;
+    long long wide = (long long) 0x7fffffff + 1;
+    return c + uc + s + (int) u + shifted + (int) (wide >> 16);
+}
+
+static int loop_constant(void)
+{
+    int total = 0;
+    int step = 3;
+    for (int i = 0; i < 5; ++i)
+    {
+        // step stays 3 around the loop, total doesn't
+        total += step;
+        step = 6 / 2;
+    }
+    return total;
+}
+
+int main(void)
+{
+    printf("%d %d\n", pick(1), pick(-1));
+    printf("%d\n", fold_through_branches());
+    printf("%d\n", narrow());
+    printf("%d\n", loop_constant());
+    printf("%d\n", 7 / 2 + -7 / 2 + 7 % -3 + (-7) % 3);
+}
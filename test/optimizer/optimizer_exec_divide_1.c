@@ -0,0 +1,44 @@
+/* multiply, divide and modulo by constants */
+
+#include "../test.h"
+
+static int signed_divides(int x)
+{
+    return x / 2 ^ x / 3 ^ x / 4 ^ x / 7 ^ x / 10 ^ x / 16 ^ x / 641 ^ x / -5 ^ x / -8 ^ x / 1000000;
+}
+
+static int signed_modulos(int x)
+{
+    return x % 2 + x % 3 + x % 8 + x % 7 + x % 10 + x % -6 + x % 1024;
+}
+
+static unsigned unsigned_divides(unsigned x)
+{
+    return x / 2 + x / 3 + x / 7 + x / 10 + x / 64 + x / 641 + x / 0x80000001u + x % 7 + x % 32;
+}
+
+static int wide(long long x)
+{
+    long long q = x / 3 + x / 10 + x / 4096 + x % 9;
+    unsigned long long u = (unsigned long long) x;
+    unsigned long long uq = u / 7 + u / 1000 + u % 10;
+    return (int) (q ^ (q >> 32)) + (int) (uq ^ (uq >> 32));
+}
+
+static int multiplies(int x)
+{
+    return x * 3 + x * 5 + x * 9 + x * 10 + x * 15 + x * 17 + x * 24 + x * -7 + x * 1024 + x * 0 + x * 1;
+}
+
+int main(void)
+{
+    int probes[] = { 0, 1, -1, 2, -2, 3, 6, 7, -7, 9, 10, 100, -100, 641, 1023, -1024, 123456789, -123456789,
+        2147483647, -2147483647 - 1 };
+    int n = sizeof(probes) / sizeof(probes[0]);
+    for (int i = 0; i < n; ++i)
+    {
+        int x = probes[i];
+        printf("%d %d %d %d %d\n", signed_divides(x), signed_modulos(x), (int) unsigned_divides((unsigned) x),
+            wide((long long) x * 1000003), multiplies(x % 100000));
+    }
+}
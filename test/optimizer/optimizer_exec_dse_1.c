@@ -0,0 +1,86 @@
+/* dead code and dead store elimination */
+
+#include "../test.h"
+
+int global;
+int calls;
+
+static int bump(void)
+{
+    return ++calls;
+}
+
+static int read_global(void)
+{
+    return global;
+}
+
+static int overwritten(void)
+{
+    int x = 1;
+    x = 2;
+    x = 3;
+    return x;
+}
+
+static int through_pointer(void)
+{
+    // the first store is read through p, so it can't go even though x is stored to again
+    int x = 5;
+    int* p = &x;
+    int seen = *p;
+    x = 9;
+    return seen * 10 + *p;
+}
+
+static int global_before_call(void)
+{
+    // the callee reads the global, so the store before the call stays
+    global = 4;
+    int seen = read_global();
+    global = 6;
+    return seen * 10 + global;
+}
+
+static int unused_results(void)
+{
+    // the results go unused but the calls still have to happen
+    int a = bump();
+    int b = bump() * 2;
+    int unused = a + b;
+    return calls;
+}
+
+static int after_return(int k)
+{
+    if (k)
+        return 1;
+    return 2;
+    global = 100;
+}
+
+static void fill(int* xs, int n)
+{
+    for (int i = 0; i < n; ++i)
+        xs[i] = i * i;
+}
+
+static int array_stores(void)
+{
+    int xs[4];
+    xs[0] = 7;
+    fill(xs, 4);
+    return xs[0] + xs[3];
+}
+
+int main(void)
+{
+    printf("%d\n", overwritten());
+    printf("%d\n", through_pointer());
+    printf("%d\n", global_before_call());
+    printf("%d\n", global);
+    printf("%d\n", unused_results());
+    printf("%d %d\n", after_return(1), after_return(0));
+    printf("%d\n", global);
+    printf("%d\n", array_stores());
+}
@@ -0,0 +1,56 @@
+/* frame elision in leaf routines */
+
+#include "../test.h"
+
+static int leaf_registers(int a, int b)
+{
+    return a * b - (a ^ b);
+}
+
+static int leaf_locals(int a)
+{
+    // locals whose address is taken have to live in memory, below %rsp in a leaf without a frame
+    int x = a;
+    int y = a * 2;
+    int* p = &x;
+    int* q = &y;
+    *p += *q;
+    return x + y;
+}
+
+static int leaf_big_locals(int a)
+{
+    // more locals than fit below %rsp without a frame
+    int xs[64];
+    for (int i = 0; i < 64; ++i)
+        xs[i] = a + i;
+    int total = 0;
+    for (int i = 63; i >= 0; i -= 3)
+        total += xs[i];
+    return total;
+}
+
+static int caller(int a)
+{
+    // not a leaf, so it keeps the stack aligned for its calls
+    int local = leaf_locals(a);
+    int* p = &local;
+    return leaf_big_locals(*p) + leaf_registers(a, *p);
+}
+
+static int depth(int n)
+{
+    int here = n;
+    if (n == 0)
+        return 0;
+    return here + depth(n - 1);
+}
+
+int main(void)
+{
+    printf("%d\n", leaf_registers(6, 7));
+    printf("%d\n", leaf_locals(5));
+    printf("%d\n", leaf_big_locals(2));
+    printf("%d\n", caller(3));
+    printf("%d\n", depth(100));
+}
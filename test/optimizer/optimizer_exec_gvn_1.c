@@ -0,0 +1,67 @@
+/* global value numbering */
+
+#include "../test.h"
+
+int counter;
+
+static void touch(void)
+{
+    counter += 5;
+}
+
+static int redundant(int a, int b)
+{
+    int x = a * b + 3;
+    int y = b * a + 3;
+    int z = (a + b) * (a + b);
+    return x + y + z;
+}
+
+static int across_blocks(int a, int b, int k)
+{
+    int x = a - b;
+    if (k)
+        return x + (a - b);
+    // only dominated by the first computation, not by the one in the branch
+    return (a - b) * 2;
+}
+
+static int aliasing_store(int* p, int* q)
+{
+    // q may point at the same int as p, so the second load of *p can't reuse the first
+    int first = *p;
+    *q = first + 1;
+    int second = *p;
+    return first * 100 + second;
+}
+
+static int across_call(void)
+{
+    int before = counter * 2;
+    touch();
+    int after = counter * 2;
+    return after - before;
+}
+
+static int branches(int a, int k)
+{
+    int r;
+    // neither computation dominates the other
+    if (k)
+        r = a << 3;
+    else
+        r = (a << 3) + 1;
+    return r + (a << 3);
+}
+
+int main(void)
+{
+    printf("%d\n", redundant(3, 4));
+    printf("%d %d\n", across_blocks(9, 4, 1), across_blocks(9, 4, 0));
+    int v = 7;
+    int w = 7;
+    printf("%d\n", aliasing_store(&v, &v));
+    printf("%d\n", aliasing_store(&v, &w));
+    printf("%d\n", across_call());
+    printf("%d %d\n", branches(2, 1), branches(2, 0));
+}
@@ -0,0 +1,82 @@
+/* inlining small functions defined in the same translation unit */
+
+#include "../test.h"
+
+int log_total;
+
+static int square(int x)
+{
+    return x * x;
+}
+
+static int clamp(int x, int lo, int hi)
+{
+    if (x < lo)
+        return lo;
+    if (x > hi)
+        return hi;
+    return x;
+}
+
+static int sum_of_squares(int a, int b)
+{
+    return square(a) + square(b);
+}
+
+static void record(int x)
+{
+    log_total += x;
+}
+
+static int next_id(void)
+{
+    // each call shares the one counter, wherever it's inlined
+    static int id = 0;
+    return ++id;
+}
+
+static void swap(int* a, int* b)
+{
+    int t = *a;
+    *a = *b;
+    *b = t;
+}
+
+static int through_address(int x)
+{
+    int* p = &x;
+    *p += 1;
+    return x;
+}
+
+static int fact(int n)
+{
+    return n <= 1 ? 1 : n * fact(n - 1);
+}
+
+static int apply(int (*f)(int), int x)
+{
+    return f(x);
+}
+
+int main(void)
+{
+    int total = 0;
+    for (int i = -3; i < 8; ++i)
+    {
+        total += clamp(i, 0, 5);
+        record(i);
+    }
+    printf("%d %d\n", total, log_total);
+    printf("%d\n", sum_of_squares(3, 4));
+    int a = next_id();
+    int b = next_id();
+    printf("%d %d\n", a, b);
+    int x = 1;
+    int y = 2;
+    swap(&x, &y);
+    printf("%d %d\n", x, y);
+    printf("%d\n", through_address(41));
+    printf("%d\n", fact(6));
+    printf("%d\n", apply(square, 9));
+}
@@ -0,0 +1,112 @@
+/* block layout: cold regions that end in a return are moved past the epilogue */
+
+#include "../test.h"
+
+static int errors;
+
+static int check(int x)
+{
+    if (x < 0)
+    {
+        ++errors;
+        return -1;
+    }
+    return x * 2;
+}
+
+// a rare error path inside a loop
+static int sum_valid(int* p, int n)
+{
+    int total = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        if (p[i] == 99)
+        {
+            ++errors;
+            return -total;
+        }
+        total += p[i];
+    }
+    return total;
+}
+
+// several early returns in a row, then the hot path
+static int classify(int x, int y)
+{
+    if (x == 0)
+        return 100;
+    if (y == 0)
+        return 200;
+    if (x > 1000)
+    {
+        int t = x / 10;
+        return t + y;
+    }
+    return x * y;
+}
+
+// a cold region with a nested branch in it
+static int nested_cold(int x)
+{
+    if (x > 50)
+    {
+        if (x & 1)
+            return x * 3;
+        return x / 2;
+    }
+    int r = x + 7;
+    if (r == 10)
+        return 0;
+    return r;
+}
+
+// a region that falls back into the hot path isn't moved
+static int rejoin(int x)
+{
+    int r = x;
+    if (x < 0)
+        r = -x;
+    if (r > 10)
+        r = 10;
+    return r + 1;
+}
+
+static unsigned hash(char* s)
+{
+    unsigned h = 5381;
+    if (!s)
+        return 0;
+    while (*s)
+    {
+        if (*s == '#')
+            return h ^ 0xFFFFu;
+        h = h * 33 + (unsigned) *s++;
+    }
+    return h;
+}
+
+static int labelled(int x)
+{
+    if (x < 0)
+        goto fail;
+    x = x * 5;
+    if (x > 100)
+        goto fail;
+    return x;
+fail:
+    ++errors;
+    return -1;
+}
+
+int main(void)
+{
+    printf("%d %d %d\n", check(4), check(-4), check(0));
+    int xs[] = { 1, 2, 3, 99, 5 };
+    printf("%d %d\n", sum_valid(xs, 3), sum_valid(xs, 5));
+    printf("%d %d %d %d\n", classify(0, 5), classify(5, 0), classify(2000, 3), classify(6, 7));
+    printf("%d %d %d %d\n", nested_cold(51), nested_cold(60), nested_cold(3), nested_cold(5));
+    printf("%d %d %d\n", rejoin(-3), rejoin(25), rejoin(4));
+    printf("%d %d %d\n", (int) (hash("abc") & 0x7FFFFFFF), (int) (hash("a#c") & 0x7FFFFFFF), (int) hash(NULL));
+    printf("%d %d %d\n", labelled(3), labelled(-3), labelled(30));
+    printf("%d\n", errors);
+}
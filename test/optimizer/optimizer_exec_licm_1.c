@@ -0,0 +1,70 @@
+/* loop-invariant code motion and induction variable strength reduction */
+
+#include "../test.h"
+
+static int invariant_load(int* limit, int* out, int n)
+{
+    // out can point at *limit, in which case the load isn't invariant after all
+    int total = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        total += *limit;
+        out[0] = i;
+    }
+    return total;
+}
+
+static int invariant_expression(int a, int b, int n)
+{
+    int total = 0;
+    for (int i = 0; i < n; ++i)
+        total += a * b + i;
+    return total;
+}
+
+static int guarded_division(int x, int d, int n)
+{
+    // the loop doesn't run when d is zero, so the division mustn't be moved ahead of it
+    int total = 0;
+    for (int i = 0; i < n; ++i)
+        total += x / d;
+    return total;
+}
+
+static int strided(void)
+{
+    int xs[30];
+    for (int i = 0; i < 30; ++i)
+        xs[i] = i;
+    int total = 0;
+    for (int i = 0; i < 10; ++i)
+        total += xs[i * 3] * (i * 7);
+    return total;
+}
+
+static int nested(int n)
+{
+    int grid[6][5];
+    for (int i = 0; i < 6; ++i)
+        for (int j = 0; j < 5; ++j)
+            grid[i][j] = i * n + j;
+    int total = 0;
+    for (int j = 0; j < 5; ++j)
+        for (int i = 0; i < 6; ++i)
+            total += grid[i][j] * (j + 1);
+    return total;
+}
+
+int main(void)
+{
+    int limit = 10;
+    int other = 0;
+    int total = invariant_load(&limit, &other, 4);
+    printf("%d %d\n", total, other);
+    total = invariant_load(&limit, &limit, 4);
+    printf("%d %d\n", total, limit);
+    printf("%d\n", invariant_expression(3, 5, 6));
+    printf("%d %d\n", guarded_division(9, 0, 0), guarded_division(9, 2, 3));
+    printf("%d\n", strided());
+    printf("%d\n", nested(4));
+}
@@ -0,0 +1,78 @@
+/* register liveness across loops, branches and irregular control flow */
+
+#include "../test.h"
+
+static int around_back_edge(int n)
+{
+    // a and b swap each time around, so both are live along the back edge
+    int a = 1;
+    int b = 2;
+    for (int i = 0; i < n; ++i)
+    {
+        int t = a;
+        a = b;
+        b = t + b;
+    }
+    return a * 1000 + b;
+}
+
+static int through_loop(int x, int n)
+{
+    // x is never touched in the loop, but is live all the way through it
+    int total = 0;
+    int keep = x * 3;
+    for (int i = 0; i < n; ++i)
+        for (int j = 0; j < i; ++j)
+            total += j;
+    return total + keep;
+}
+
+static int gotos(int n)
+{
+    int total = 0;
+    int i = 0;
+    int late = n * 2;
+top:
+    if (i >= n)
+        goto done;
+    if (i % 3 == 0)
+        goto skip;
+    total += i;
+skip:
+    ++i;
+    goto top;
+done:
+    return total + late;
+}
+
+static int one_branch(int k)
+{
+    int value = k * 7;
+    int other = k + 1;
+    if (k > 2)
+        return value;
+    other *= 5;
+    return other;
+}
+
+static int early_exit(int* xs, int n, int target)
+{
+    int seen = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        if (xs[i] == target)
+            return i * 100 + seen;
+        seen += xs[i];
+    }
+    return -seen;
+}
+
+int main(void)
+{
+    printf("%d %d\n", around_back_edge(0), around_back_edge(7));
+    printf("%d\n", through_loop(5, 6));
+    printf("%d\n", gotos(10));
+    printf("%d %d\n", one_branch(1), one_branch(5));
+    int xs[] = { 4, 8, 15, 16, 23, 42 };
+    printf("%d %d\n", early_exit(xs, 6, 16), early_exit(xs, 6, 5));
+}
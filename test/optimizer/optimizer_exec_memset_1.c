@@ -0,0 +1,75 @@
+/* zeroing objects for initializers, inline or through memset */
+
+#include "../test.h"
+
+struct mixed
+{
+    char c;
+    int i;
+    short s[3];
+    long l;
+    char tail[5];
+};
+
+static int sum_bytes(void* p, int n)
+{
+    unsigned char* bytes = p;
+    unsigned total = 0;
+    for (int i = 0; i < n; ++i)
+        total = total * 3 + bytes[i];
+    return (int) total;
+}
+
+static int partial_struct(int k)
+{
+    // only the members the list leaves out need zeroing
+    struct mixed m = { .i = k, .l = k * 2 };
+    return m.c + m.i + m.s[0] + m.s[2] + (int) m.l + m.tail[4];
+}
+
+static int small_arrays(int k)
+{
+    char a1[1] = { 0 };
+    short a3[3] = { 1 };
+    int a5[5] = { [4] = k };
+    long a8[8] = { k, [6] = 2 };
+    return a1[0] + a3[0] + a3[2] + a5[0] + a5[4] + (int) a8[0] + (int) a8[6] + (int) a8[7];
+}
+
+static int large_array(int k)
+{
+    // too big to zero inline
+    int big[40] = { k, [39] = k + 1 };
+    unsigned total = 0;
+    for (int i = 0; i < 40; ++i)
+        total = total * 3 + big[i];
+    return (int) total;
+}
+
+static int overwritten(int k)
+{
+    // the stores right after the declaration cover part of what it would zero
+    int xs[6] = { 0 };
+    xs[0] = k;
+    xs[1] = k + 1;
+    xs[5] = k + 5;
+    return sum_bytes(xs, sizeof xs);
+}
+
+static int padding(void)
+{
+    struct mixed a = { 0 };
+    struct mixed b = { 0 };
+    a.c = 1;
+    b.c = 1;
+    return a.c + b.c + a.l + b.tail[0];
+}
+
+int main(void)
+{
+    printf("%d %d\n", partial_struct(3), partial_struct(-9));
+    printf("%d\n", small_arrays(7));
+    printf("%d\n", large_array(5));
+    printf("%d\n", overwritten(2));
+    printf("%d\n", padding());
+}
@@ -0,0 +1,71 @@
+/* peephole patterns over the generated x86 code */
+
+#include "../test.h"
+
+static int stack_forwarding(void)
+{
+    // x lives in a stack slot that's also written through p, so stores to it can't be forwarded past that
+    int x = 1;
+    int* p = &x;
+    x = 2;
+    *p = x + 3;
+    int y = x;
+    *p = 9;
+    return y * 10 + x;
+}
+
+static int partial_registers(int v)
+{
+    // narrow moves leave the upper bits alone and 32-bit ones clear them
+    unsigned char c = (unsigned char) v;
+    unsigned short s = (unsigned short) v;
+    unsigned long long w = (unsigned int) v;
+    signed char sc = (signed char) c;
+    return c + s + (int) (w >> 16) + sc;
+}
+
+static int zeroes(int k)
+{
+    // zeroing a register mustn't disturb a comparison still waiting to be tested
+    int zero = 0;
+    int result = k > 3;
+    if (k == 0)
+        zero = 0;
+    return result + zero;
+}
+
+static int compares(int a, int b)
+{
+    int r = 0;
+    if (a < b)
+        r += 1;
+    if (a < b)
+        r += 2;
+    if (a == 0)
+        r += 4;
+    if (a - b == 0)
+        r += 8;
+    return r;
+}
+
+static int branches(int n)
+{
+    int total = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        if (i & 1)
+            continue;
+        else
+            total += i;
+    }
+    return total;
+}
+
+int main(void)
+{
+    printf("%d\n", stack_forwarding());
+    printf("%d %d\n", partial_registers(0x12345), partial_registers(-1));
+    printf("%d %d %d\n", zeroes(0), zeroes(2), zeroes(9));
+    printf("%d %d %d %d\n", compares(1, 2), compares(2, 2), compares(0, 5), compares(3, 1));
+    printf("%d\n", branches(11));
+}
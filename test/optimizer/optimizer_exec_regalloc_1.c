@@ -0,0 +1,50 @@
+/* register allocation under pressure, with spilling */
+
+#include "../test.h"
+
+static int id(int x)
+{
+    return x;
+}
+
+static int pressure(unsigned s)
+{
+    // more values live at once than there are registers
+    unsigned a = s + 1, b = s + 2, c = s + 3, d = s + 4, e = s + 5, f = s + 6, g = s + 7, h = s + 8;
+    unsigned i = s + 9, j = s + 10, k = s + 11, l = s + 12, m = s + 13, n = s + 14, o = s + 15, p = s + 16;
+    unsigned q = s + 17, r = s + 18;
+    for (int t = 0; t < 3; ++t)
+    {
+        a += b * c; b += c * d; c += d * e; d += e * f; e += f * g; f += g * h; g += h * i; h += i * j;
+        i += j * k; j += k * l; k += l * m; l += m * n; m += n * o; n += o * p; o += p * q; p += q * r;
+        q += r * a; r += a * b;
+    }
+    return (int) (a ^ b ^ c ^ d ^ e ^ f ^ g ^ h ^ i ^ j ^ k ^ l ^ m ^ n ^ o ^ p ^ q ^ r);
+}
+
+static int across_calls(int s)
+{
+    // everything live across a call has to survive it in a callee-saved register or on the stack
+    int a = id(s), b = id(s * 2), c = id(s * 3), d = id(s * 4), e = id(s * 5), f = id(s * 6), g = id(s * 7), h = id(s * 8);
+    return a + b * 2 + c * 3 + d * 4 + e * 5 + f * 6 + g * 7 + h * 8 + id(1);
+}
+
+static int floating(int s)
+{
+    double a = s * 0.5, b = s * 1.5, c = s * 2.5, d = s * 3.5, e = s * 4.5, f = s * 5.5;
+    double g = s * 6.5, h = s * 7.5, i = s * 8.5, j = s * 9.5;
+    for (int t = 0; t < 4; ++t)
+    {
+        a += b; b += c; c += d; d += e; e += f; f += g; g += h; h += i; i += j; j += a;
+    }
+    double across = a + j;
+    int k = id(3);
+    return (int) (across + b + c + d + e + f + g + h + i) + k;
+}
+
+int main(void)
+{
+    printf("%d %d\n", pressure(1), pressure(-7));
+    printf("%d\n", across_calls(3));
+    printf("%d\n", floating(2));
+}
@@ -0,0 +1,54 @@
+/* read-only constants pooled into mergeable sections, with duplicates and tails of other strings shared */
+
+#include "../test.h"
+
+static char* greeting = "hello, world";
+static char* tail = "world";
+static char* names[] = { "alpha", "beta", "alpha", "pha", "" };
+
+static int sum_chars(char* s)
+{
+    int total = 0;
+    while (*s)
+        total = total * 3 + *s++;
+    return total;
+}
+
+static int wide_sum(int* s)
+{
+    int total = 0;
+    for (; *s; ++s)
+        total = total * 5 + *s;
+    return total;
+}
+
+static double scaled(double x)
+{
+    return x * 2.5 + 2.5;
+}
+
+static float scaled_float(float x)
+{
+    return x * 2.5f - 0.5f;
+}
+
+// negation and unsigned conversions use masks and limits from the pool
+static int masks(double d, float f, unsigned long u)
+{
+    double nd = -d;
+    float nf = -f;
+    double du = (double) u;
+    unsigned long back = (unsigned long) (du / 2);
+    return (int) nd + (int) nf * 10 + (int) (back >> 56);
+}
+
+int main(void)
+{
+    printf("%s %s %s\n", greeting, tail, "world");
+    printf("%d %d %d\n", sum_chars(greeting), sum_chars(tail), sum_chars("hello, world") == sum_chars(greeting));
+    for (int i = 0; i < 5; ++i)
+        printf("[%s] %d\n", names[i], sum_chars(names[i]));
+    printf("%d %d\n", wide_sum(L"wide"), wide_sum(L"de"));
+    printf("%d %d\n", (int) (scaled(4) * 10), (int) (scaled_float(4) * 10));
+    printf("%d %d\n", masks(3.5, 2.25f, 0xF000000000000000UL), masks(-7.0, -1.5f, 1));
+}
@@ -0,0 +1,91 @@
+/* callee-saved registers: values live across calls, and saves shrink-wrapped to the paths that call */
+
+#include "../test.h"
+
+static int calls;
+
+static int bump(int x)
+{
+    ++calls;
+    return x + 1;
+}
+
+// overwrites every caller-saved register it can
+static long clobber(long a, long b, long c, long d, long e, long f)
+{
+    ++calls;
+    return a ^ b ^ c ^ d ^ e ^ f;
+}
+
+static int across_one(int a, int b)
+{
+    int kept = a * 7 + b;
+    int r = bump(a);
+    return kept + r;
+}
+
+// more values live across the call than there are callee-saved registers
+static long across_many(long a, long b)
+{
+    long v1 = a + 1, v2 = a + 2, v3 = a + 3, v4 = b + 4, v5 = b + 5, v6 = b + 6, v7 = a * b;
+    long r = clobber(v1, v2, v3, v4, v5, v6);
+    return v1 + v2 * 2 + v3 * 3 + v4 * 4 + v5 * 5 + v6 * 6 + v7 * 7 + r * 8;
+}
+
+// the early exits don't call, so they don't need the saves
+static int early_exit(int* p, int n)
+{
+    if (!p)
+        return -1;
+    if (n <= 0)
+        return 0;
+    int total = 0;
+    for (int i = 0; i < n; ++i)
+        total += bump(p[i]) * (i + 1);
+    return total;
+}
+
+static int late_call(int x)
+{
+    int y = x * 3;
+    if (x < 10)
+        return y;
+    int z = bump(y);
+    return y + z;
+}
+
+static unsigned fib(unsigned n)
+{
+    if (n < 2)
+        return n;
+    unsigned a = fib(n - 1);
+    unsigned b = fib(n - 2);
+    return a + b;
+}
+
+// no value lives across the calls, so nothing has to be saved
+static int chain(int x)
+{
+    return bump(bump(bump(x)));
+}
+
+static long nested(long a, long b)
+{
+    long x = clobber(a, b, a, b, a, b);
+    long y = clobber(x, a, b, x, a, b);
+    long z = clobber(y, x, b, a, y, x);
+    return x * 100 + y * 10 + z + a - b;
+}
+
+int main(void)
+{
+    printf("%d %d\n", across_one(3, 4), across_one(-5, 2));
+    printf("%d %d\n", (int) across_many(3, 4), (int) across_many(-7, 11));
+    int xs[] = { 5, 4, 3, 2, 1 };
+    printf("%d %d %d\n", early_exit(NULL, 3), early_exit(xs, 0), early_exit(xs, 5));
+    printf("%d %d\n", late_call(4), late_call(40));
+    printf("%d\n", (int) fib(20));
+    printf("%d\n", chain(10));
+    printf("%d %d\n", (int) nested(6, 9), (int) nested(123, -45));
+    printf("%d\n", calls);
+}
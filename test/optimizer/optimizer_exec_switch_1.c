@@ -0,0 +1,82 @@
+/* switch lowering to jump tables and binary searches */
+
+#include "../test.h"
+
+static int dense(int x)
+{
+    // dense enough for a jump table, with a gap, a fallthrough and the default in the middle
+    switch (x)
+    {
+        case -2: return 100;
+        case -1: return 101;
+        case 0: return 102;
+        case 1:
+        case 2: return 103;
+        default: return -1;
+        case 4: x += 10;
+        case 5: return x + 200;
+        case 6: return 106;
+        case 7: return 107;
+    }
+}
+
+static int sparse(int x)
+{
+    switch (x)
+    {
+        case -2147483647: return 1;
+        case -1000: return 2;
+        case 7: return 3;
+        case 300: return 4;
+        case 4096: return 5;
+        case 99999: return 6;
+        case 2147483647: return 7;
+        default: return 0;
+    }
+}
+
+static int no_default(unsigned char c)
+{
+    int r = 50;
+    switch (c)
+    {
+        case 'a': r = 1; break;
+        case 'b': r = 2; break;
+        case 'c': r = 3; break;
+        case 'd': r = 4; break;
+        case 'e': r = 5; break;
+        case 255: r = 6; break;
+    }
+    return r;
+}
+
+static int in_loop(int n)
+{
+    int total = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        switch (i % 6)
+        {
+            case 0: total += 1; break;
+            case 1: total += 10; continue;
+            case 2: total += 100;
+            case 3: total += 1000; break;
+            case 5: total -= 3; break;
+        }
+        total *= 2;
+    }
+    return total;
+}
+
+int main(void)
+{
+    for (int i = -4; i < 10; ++i)
+        printf("%d ", dense(i));
+    printf("\n");
+    int probes[] = { -2147483647, -2147483646, -1000, -999, 6, 7, 8, 300, 4096, 99999, 100000, 2147483647, 0 };
+    for (int i = 0; i < sizeof(probes) / sizeof(probes[0]); ++i)
+        printf("%d ", sparse(probes[i]));
+    printf("\n");
+    printf("%d %d %d %d\n", no_default('a'), no_default('e'), no_default('z'), no_default(255));
+    printf("%d\n", in_loop(14));
+}
@@ -0,0 +1,90 @@
+/* calls in tail position turned into jumps */
+
+#include "../test.h"
+
+struct pair
+{
+    long a, b, c;
+};
+
+static int accumulate(int n, int total)
+{
+    if (n == 0)
+        return total;
+    return accumulate(n - 1, total + n % 7);
+}
+
+static int is_odd(int n);
+
+static int is_even(int n)
+{
+    if (n == 0)
+        return 1;
+    return is_odd(n - 1);
+}
+
+static int is_odd(int n)
+{
+    if (n == 0)
+        return 0;
+    return is_even(n - 1);
+}
+
+static int three(int a, int b, int c)
+{
+    return a * 100 + b * 10 + c;
+}
+
+static int sibling(int a)
+{
+    // the callee takes more arguments than the caller got
+    return three(a, a + 1, a + 2);
+}
+
+static int many(long a, long b, long c, long d, long e, long f, long g, long h)
+{
+    return (int) (a + b + c + d + e + f + g * 7 + h * 11);
+}
+
+static int stack_arguments(long a)
+{
+    // arguments on the stack would land in the caller's frame, so this stays a call
+    return many(a, a, a, a, a, a, a + 1, a + 2);
+}
+
+static struct pair make(long k)
+{
+    struct pair p;
+    p.a = k;
+    p.b = k * 2;
+    p.c = k * 3;
+    return p;
+}
+
+static struct pair forward(long k)
+{
+    return make(k + 1);
+}
+
+static int deref(int* p)
+{
+    return *p * 2;
+}
+
+static int local_address(int k)
+{
+    // the callee gets a pointer into this frame, so it can't be torn down first
+    int local = k + 4;
+    return deref(&local);
+}
+
+int main(void)
+{
+    printf("%d\n", accumulate(50000, 0));
+    printf("%d %d\n", is_even(10001), is_odd(10001));
+    printf("%d\n", sibling(4));
+    printf("%d\n", stack_arguments(3));
+    struct pair p = forward(2);
+    printf("%d %d %d\n", (int) p.a, (int) p.b, (int) p.c);
+    printf("%d\n", local_address(5));
+}
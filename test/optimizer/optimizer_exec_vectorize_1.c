@@ -0,0 +1,105 @@
+/* vectorizing simple counted loops with packed SSE2 */
+
+#include "../test.h"
+
+static void add_ints(int* a, int* b, int* c, int k, int n)
+{
+    for (int i = 0; i < n; ++i)
+        a[i] = b[i] + c[i] - k;
+}
+
+static void add_longs(long* a, long* b, long k, long n)
+{
+    for (long i = 0; i < n; ++i)
+        a[i] = b[i] + k;
+}
+
+static void scale_floats(float* a, float* b, float k, int n)
+{
+    for (int i = 0; i < n; ++i)
+        a[i] = b[i] * k + a[i];
+}
+
+static void divide_doubles(double* a, double* b, double* c, int n)
+{
+    for (int i = 0; i < n; ++i)
+        a[i] = b[i] / c[i];
+}
+
+static int sum_ints(int* a, int n)
+{
+    int s = 0;
+    for (int i = 0; i < n; ++i)
+        s += a[i];
+    return s;
+}
+
+static int checksum(int* a, int n)
+{
+    unsigned total = 0;
+    for (int i = 0; i < n; ++i)
+        total = total * 31 + (unsigned) a[i];
+    return (int) total;
+}
+
+int main(void)
+{
+    int a[40];
+    int b[40];
+    int c[40];
+    for (int i = 0; i < 40; ++i)
+    {
+        b[i] = i * 3;
+        c[i] = 100 - i;
+    }
+
+    // trip counts on both sides of multiples of the vector width
+    int counts[] = { 0, 1, 3, 4, 5, 7, 8, 9, 17, 31, 40 };
+    for (int j = 0; j < sizeof(counts) / sizeof(counts[0]); ++j)
+    {
+        for (int i = 0; i < 40; ++i)
+            a[i] = -1;
+        add_ints(a, b, c, 7, counts[j]);
+        printf("%d %d %d\n", counts[j], checksum(a, 40), sum_ints(b, counts[j]));
+    }
+
+    // the arrays overlap, so a store can change an element read later
+    for (int i = 0; i < 40; ++i)
+        a[i] = i;
+    add_ints(a + 1, a, c, 0, 30);
+    printf("%d\n", checksum(a, 40));
+    for (int i = 0; i < 40; ++i)
+        a[i] = i;
+    add_ints(a, a + 1, c, 0, 30);
+    printf("%d\n", checksum(a, 40));
+    add_ints(a, a, a, 0, 37);
+    printf("%d\n", checksum(a, 40));
+
+    long la[11];
+    long lb[11];
+    for (int i = 0; i < 11; ++i)
+        lb[i] = (long) i << 33;
+    add_longs(la, lb, 5, 11);
+    printf("%d %d\n", (int) (la[10] >> 33), (int) la[3]);
+
+    float fa[13];
+    float fb[13];
+    for (int i = 0; i < 13; ++i)
+    {
+        fa[i] = i;
+        fb[i] = i * 0.5f;
+    }
+    scale_floats(fa, fb, 4.0f, 13);
+    printf("%d %d\n", (int) fa[12], (int) (fa[5] * 10));
+
+    double da[7];
+    double db[7];
+    double dc[7];
+    for (int i = 0; i < 7; ++i)
+    {
+        db[i] = i * 9.0;
+        dc[i] = 4.0;
+    }
+    divide_doubles(da, db, dc, 7);
+    printf("%d %d\n", (int) (da[6] * 4), (int) (da[1] * 100));
+}
@@ -0,0 +1,19 @@
+/* ISO: 6.10.2 (2), 6.10.2 (3); repeated inclusion of the same header */
+
+#include "../../test.h"
+#include "../../test.h"
+
+#include "include_guard.h"
+#include "include_guard.h"
+
+#include "include_unguarded.h"
+#include "include_unguarded.h"
+
+int main(void)
+{
+    // the guarded header must only define guarded_value once
+    ASSERT_EQUALS(guarded_value, 4);
+
+    // the second inclusion of the unguarded header must see the first one's definition
+    ASSERT_EQUALS(UNGUARDED_COUNT, 2);
+}
@@ -0,0 +1,6 @@
+#ifndef INCLUDE_GUARD_H
+#define INCLUDE_GUARD_H
+
+int guarded_value = 4;
+
+#endif
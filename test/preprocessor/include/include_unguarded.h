@@ -0,0 +1,7 @@
+/* no include guard, so every inclusion must be expanded again */
+#ifdef UNGUARDED_COUNT
+#undef UNGUARDED_COUNT
+#define UNGUARDED_COUNT 2
+#else
+#define UNGUARDED_COUNT 1
+#endif
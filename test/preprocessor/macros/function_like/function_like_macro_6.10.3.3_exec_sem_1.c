@@ -0,0 +1,41 @@
+/* ISO: 6.10.3.3 (3); pasting tokens with ## into numbers and punctuators */
+
+#include "../../../test.h"
+
+#define PASTE(a, b) a##b
+#define PASTE3(a, b, c) a##b##c
+
+int main(void)
+{
+    // into numbers, including ones that aren't numbers until they're joined
+    ASSERT_EQUALS(PASTE(0x, 1F), 31);
+    ASSERT_EQUALS(PASTE(0, x10), 16);
+    ASSERT_EQUALS(PASTE3(0x, 1, F), 31);
+    ASSERT_EQUALS(PASTE(12, 34), 1234);
+    ASSERT_EQUALS((int) (PASTE(1., 5) * 10), 15);
+    ASSERT_EQUALS((int) PASTE(1e, 3), 1000);
+
+    // into punctuators, which have to come out as one token rather than two
+    int x = 5;
+    x PASTE(+, =) 3;
+    ASSERT_EQUALS(x, 8);
+    ASSERT_EQUALS(1 PASTE(<, <) 4, 16);
+    ASSERT_EQUALS(64 PASTE(>, >) 2, 16);
+    x PASTE(<<, =) 2;
+    ASSERT_EQUALS(x, 32);
+    x PASTE(>>, =) 1;
+    ASSERT_EQUALS(x, 16);
+    x PASTE(|, =) 1;
+    ASSERT_EQUALS(x, 17);
+    x PASTE(-, -);
+    ASSERT_EQUALS(x, 16);
+    ASSERT_EQUALS(x PASTE(=, =) 16, 1);
+    ASSERT_EQUALS(x PASTE(!, =) 16, 0);
+    ASSERT_EQUALS(1 PASTE(&, &) 0, 0);
+
+    // into identifiers, and with an empty argument on either side
+    int ab = 7;
+    ASSERT_EQUALS(PASTE(a, b), 7);
+    ASSERT_EQUALS(PASTE(, 9), 9);
+    ASSERT_EQUALS(PASTE(ab, ), 7);
+}
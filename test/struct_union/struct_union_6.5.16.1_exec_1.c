@@ -0,0 +1,89 @@
+/* ISO: 6.5.16.1 (2); struct and union assignment */
+
+#include "../test.h"
+
+struct v
+{
+    int x, y, z;
+};
+
+struct big
+{
+    long a, b, c;
+    char tag;
+};
+
+union u
+{
+    int i;
+    char c[6];
+};
+
+struct v make_v(int k)
+{
+    struct v r;
+    r.x = k;
+    r.y = k * 2;
+    r.z = k * 3;
+    return r;
+}
+
+struct big make_big(int k)
+{
+    struct big r;
+    r.a = k;
+    r.b = k + 1;
+    r.c = k + 2;
+    r.tag = 'a' + k;
+    return r;
+}
+
+int main(void)
+{
+    struct v a;
+    struct v b;
+    b.x = 1;
+    b.y = 2;
+    b.z = 3;
+
+    // from another object
+    a = b;
+    b.x = 100;
+    printf("%d %d ", a.x, a.y);
+    printf("%d %d\n", a.z, b.x);
+
+    // from a call returning in registers
+    a = make_v(4);
+    printf("%d %d ", a.x, a.y);
+    printf("%d\n", a.z);
+
+    // from a call returning in memory
+    struct big g;
+    g = make_big(7);
+    printf("%d %d ", (int) g.a, (int) g.b);
+    printf("%d %d\n", (int) g.c, g.tag);
+
+    // as an initializer
+    struct v c = make_v(5);
+    struct big h = make_big(1);
+    printf("%d %d ", c.x, c.y);
+    printf("%d %d ", c.z, (int) h.c);
+    printf("%d\n", h.tag);
+
+    // the value of an assignment is the assigned object
+    struct v d;
+    d = a = make_v(6);
+    printf("%d %d\n", d.z, a.z);
+
+    union u p;
+    union u q;
+    p.c[0] = 'x';
+    p.c[5] = 'y';
+    q = p;
+    p.c[5] = 'z';
+    printf("%d %d ", q.c[0], q.c[5]);
+    printf("%d\n", p.c[5]);
+    q.i = 12345;
+    p = q;
+    printf("%d\n", p.i);
+}